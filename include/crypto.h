@@ -56,6 +56,109 @@
 */
 #define TC_BLOCK_SIZE 16
 
+/*
+** Crypto Context
+*/
+// Everything one CryptoLib instance keeps between calls. The public API runs against the calling thread's current
+// context, the default context unless a _Ctx function or Crypto_Context_Enter selected another one. The default
+// context's state is the global variables declared at the end of this header; a context from Crypto_Context_Create
+// keeps its own copy in its state member.
+//
+// Limitation: only the state below is per context. The SA, key, MC and cryptography backends keep their own
+// process-wide state (the in-memory SA table, the internal key ring, the MC log, libgcrypt/KMC sessions, ...). Every
+// context that selects a backend shares that one instance, so an SA or key changed through one context is changed for
+// all of them.
+typedef enum
+{
+    CRYPTO_BACKEND_KEY = 0,
+    CRYPTO_BACKEND_MC,
+    CRYPTO_BACKEND_SA,
+    CRYPTO_BACKEND_CRYPTOGRAPHY,
+    CRYPTO_NUM_BACKENDS
+} CryptoBackend;
+
+typedef struct
+{
+    // Configuration
+    CryptoConfig_t crypto_config;
+    SadbMariaDBConfig_t* sa_mariadb_config;
+    SadbMmapConfig_t* sa_mmap_config;
+    KeyStoreConfig_t* key_store_config;
+    SadbSqliteConfig_t* sa_sqlite_config;
+    SadbShmConfig_t* sa_shm_config;
+    CryptographyKmcCryptoServiceConfig_t* cryptography_kmc_crypto_config;
+    CamConfig_t* cam_config;
+    GvcidManagedParameters_t* gvcid_managed_parameters;
+    GvcidManagedParameters_t* current_managed_parameters;
+    // Interfaces
+    KeyInterface key_if;
+    McInterface mc_if;
+    SaInterface sa_if;
+    CryptographyInterface cryptography_if;
+    // Data stores used in multiple components
+    CCSDS_t sdls_frame;
+    uint8_t tm_frame[1786];
+    TM_FramePrimaryHeader_t tm_frame_pri_hdr;
+    TM_FrameSecurityHeader_t tm_frame_sec_hdr; // Used to reduce bit math duplication
+    uint8_t aos_frame[1786];
+    AOS_FramePrimaryHeader_t aos_frame_pri_hdr;
+    AOS_FrameSecurityHeader_t aos_frame_sec_hdr; // Used to reduce bit math duplication
+    // OCF
+    SDLS_FSR_t report;
+    Telemetry_Frame_Clcw_t clcw;
+    // Flags
+    SDLS_MC_LOG_RPLY_t log_summary;
+    SDLS_MC_DUMP_BLK_RPLY_t mc_log;
+    uint8_t log_count;
+    uint16_t tm_offset;
+    // ESA Testing - 0 = disabled, 1 = enabled
+    uint8_t badSPI;
+    uint8_t badIV;
+    uint8_t badMAC;
+    uint8_t badFECF;
+} CryptoContextState_t;
+
+typedef struct
+{
+    // Where the context's state lives: the global variables for the default context, state for any other
+    CryptoConfig_t* crypto_config;
+    SadbMariaDBConfig_t** sa_mariadb_config;
+    SadbMmapConfig_t** sa_mmap_config;
+    KeyStoreConfig_t** key_store_config;
+    SadbSqliteConfig_t** sa_sqlite_config;
+    SadbShmConfig_t** sa_shm_config;
+    CryptographyKmcCryptoServiceConfig_t** cryptography_kmc_crypto_config;
+    CamConfig_t** cam_config;
+    GvcidManagedParameters_t** gvcid_managed_parameters;
+    GvcidManagedParameters_t** current_managed_parameters;
+    KeyInterface* key_if;
+    McInterface* mc_if;
+    SaInterface* sa_if;
+    CryptographyInterface* cryptography_if;
+    CCSDS_t* sdls_frame;
+    uint8_t (*tm_frame)[1786];
+    TM_FramePrimaryHeader_t* tm_frame_pri_hdr;
+    TM_FrameSecurityHeader_t* tm_frame_sec_hdr;
+    uint8_t (*aos_frame)[1786];
+    AOS_FramePrimaryHeader_t* aos_frame_pri_hdr;
+    AOS_FrameSecurityHeader_t* aos_frame_sec_hdr;
+    SDLS_FSR_t* report;
+    Telemetry_Frame_Clcw_t* clcw;
+    SDLS_MC_LOG_RPLY_t* log_summary;
+    SDLS_MC_DUMP_BLK_RPLY_t* mc_log;
+    uint8_t* log_count;
+    uint16_t* tm_offset;
+    uint8_t* badSPI;
+    uint8_t* badIV;
+    uint8_t* badMAC;
+    uint8_t* badFECF;
+    CryptoContextState_t state;
+    // Backends this context brought up or joined, see Crypto_Init
+    void* backends[CRYPTO_NUM_BACKENDS];
+} CryptoContext_t;
+
+extern CryptoContext_t crypto_context_default;
+
 /*
 ** User Prototypes
 */
@@ -66,16 +169,29 @@ extern int32_t Crypto_Config_CryptoLib(uint8_t key_type, uint8_t mc_type, uint8_
                                        uint8_t has_pus_hdr, uint8_t ignore_sa_state, uint8_t ignore_anti_replay,
                                        uint8_t unique_sa_per_mapid, uint8_t crypto_check_fecf, uint8_t vcid_bitmask, 
                                        uint8_t crypto_increment_nontransmitted_iv);
+extern int32_t Crypto_Config_Sa_Capacity(uint16_t sa_capacity);
+extern int32_t Crypto_Config_Key_Capacity(uint16_t key_capacity);
+extern int32_t Crypto_Config_Thread_Safety(uint8_t thread_safe);
+extern int32_t Crypto_Config_Key_Store(char* key_store_path, uint8_t* kek, uint32_t kek_len);
 extern int32_t Crypto_Config_MariaDB(char* mysql_hostname, char* mysql_database, uint16_t mysql_port,
                                      uint8_t mysql_require_secure_transport, uint8_t mysql_tls_verify_server,
                                      char* mysql_tls_ca, char* mysql_tls_capath, char* mysql_mtls_cert,
                                      char* mysql_mtls_key,
                                      char* mysql_mtls_client_key_password, char* mysql_username, char* mysql_password);
+extern int32_t Crypto_Config_MariaDB_Cache(uint8_t sa_cache_enabled, uint32_t sa_cache_poll_interval_ms);
+extern int32_t Crypto_Config_MariaDB_Write_Behind(uint8_t write_behind_enabled, uint32_t flush_frames,
+                                                  uint32_t flush_interval_ms, uint32_t max_staleness_ms);
+extern int32_t Crypto_Config_MariaDB_Pool(uint8_t pool_size, uint32_t health_check_interval_ms);
+extern int32_t Crypto_Config_Sa_Mmap(char* mmap_path, uint32_t checkpoint_interval, uint32_t checkpoint_interval_ms);
+extern int32_t Crypto_Config_Sa_Sqlite(char* sqlite_path, uint8_t sqlite_synchronous);
+extern int32_t Crypto_Config_Sa_Shm(char* shm_name);
 extern int32_t Crypto_Config_Kmc_Crypto_Service(char* protocol, char* kmc_crypto_hostname, uint16_t kmc_crypto_port,
                                                 char* kmc_crypto_app, char* kmc_tls_ca_bundle, char* kmc_tls_ca_path,
                                                 uint8_t kmc_ignore_ssl_hostname_validation, char* mtls_client_cert_path,
                                                 char* mtls_client_cert_type, char* mtls_client_key_path,
                                                 char* mtls_client_key_pass, char* mtls_issuer_cert);
+extern int32_t Crypto_Config_Kmc_Crypto_Service_Add_Endpoint(char* kmc_crypto_hostname, uint16_t kmc_crypto_port);
+extern int32_t Crypto_Config_Kmc_Crypto_Service_Hedging(uint8_t hedge_idempotent_requests, uint32_t hedge_min_delay_ms);
 extern int32_t Crypto_Config_Cam(uint8_t cam_enabled, char* cookie_file_path, char* keytab_file_path, uint8_t login_method, char* access_manager_uri, char* username, char* cam_home);
 extern int32_t Crypto_Config_Add_Gvcid_Managed_Parameter(uint8_t tfvn, uint16_t scid, uint8_t vcid, uint8_t has_fecf,
                                                          uint8_t has_segmentation_hdr, uint16_t max_frame_size, uint8_t aos_has_fhec,
@@ -91,10 +207,18 @@ extern int32_t Crypto_TC_Init(void);
 extern int32_t Crypto_Init_TC_Unit_Test(void);      // Initialize CryptoLib with unit test default Configurations
 extern int32_t Crypto_Init_TM_Unit_Test(void);      // Initialize CryptoLib with unit test default Configurations
 extern int32_t Crypto_Init_AOS_Unit_Test(void);      // Initialize CryptoLib with unit test default Configurations
+extern int32_t Crypto_Init_Static_Config(void); // Initialize CryptoLib from the tables built with CRYPTO_STATIC_CONFIG
 
 // Cleanup
 extern int32_t Crypto_Shutdown(void); // Free all allocated memory
 
+// Runtime State Snapshots (warm restart / standby failover)
+extern int32_t Crypto_Snapshot_Save(const char* path);
+extern int32_t Crypto_Snapshot_Load(const char* path, uint32_t counter_skip); // In place of Config + Crypto_Init
+extern void Crypto_Snapshot_Release(void);
+// Encrypted Key Store (internal key interface)
+extern int32_t Crypto_Key_Store_Save(const char* path);
+
 // Telecommand (TC)
 extern int32_t Crypto_TC_ApplySecurity(const uint8_t* p_in_frame, const uint16_t in_frame_length,
                                        uint8_t** pp_enc_frame, uint16_t* p_enc_frame_len);
@@ -102,6 +226,7 @@ extern int32_t Crypto_TC_ProcessSecurity(uint8_t* ingest, int *len_ingest, TC_t*
 extern int32_t Crypto_TC_ApplySecurity_Cam(const uint8_t* p_in_frame, const uint16_t in_frame_length,
                                        uint8_t** pp_enc_frame, uint16_t* p_enc_frame_len, char* cam_cookies);
 extern int32_t Crypto_TC_ProcessSecurity_Cam(uint8_t* ingest, int *len_ingest, TC_t* tc_sdls_processed_frame, char* cam_cookies);
+extern int32_t Crypto_TC_ApplySecurity_Batch(TcBatchFrame_t* frames, uint32_t num_frames);
 // Telemetry (TM)
 extern int32_t Crypto_TM_ApplySecurity(uint8_t* pTfBuffer);
 extern int32_t Crypto_TM_ProcessSecurity(uint8_t* p_ingest, uint16_t len_ingest, uint8_t** pp_processed_frame, uint16_t *p_decrypted_length);
@@ -109,9 +234,126 @@ extern int32_t Crypto_TM_ProcessSecurity(uint8_t* p_ingest, uint16_t len_ingest,
 extern int32_t Crypto_AOS_ApplySecurity(uint8_t* pTfBuffer);
 extern int32_t Crypto_AOS_ProcessSecurity(uint8_t* p_ingest, uint16_t len_ingest, uint8_t** pp_processed_frame, uint16_t* p_decrypted_length);
 
+// SA Authentication Bit Mask Functions
+extern int32_t Crypto_SA_Set_ABM(SecurityAssociation_t* sa_ptr, const uint8_t* abm, uint16_t abm_len);
+extern int32_t Crypto_SA_Fill_ABM(SecurityAssociation_t* sa_ptr, uint8_t value, uint16_t abm_len);
+extern int32_t Crypto_SA_Release_ABM(SecurityAssociation_t* sa_ptr);
+extern int32_t Crypto_Get_ABM_Pool_Stats(AbmPoolStats_t* stats);
+
+// Published SA / Key Record Functions (epoch-based reclamation)
+extern void Crypto_Epoch_Enter(void);
+extern void Crypto_Epoch_Exit(void);
+extern void Crypto_Epoch_Synchronize(void);
+extern void Crypto_Epoch_Writer_Lock(void);
+extern void Crypto_Epoch_Writer_Unlock(void);
+extern int32_t Crypto_Epoch_Retire(void* ptr, void (*free_fn)(void*));
+extern void Crypto_Epoch_Shutdown(void);
+
+// Per-SA Frame Lock Functions (Crypto_Config_Thread_Safety)
+extern void Crypto_SA_Lock(uint16_t spi);
+extern void Crypto_SA_Unlock(void);
+extern uint8_t Crypto_SA_Lock_Other(uint16_t spi);
+extern void Crypto_SA_Unlock_Other(uint16_t spi, uint8_t locked);
+
+// MariaDB SA Support Functions
+extern int32_t Crypto_Get_MariaDB_Write_Behind_Stats(SadbMariaDBWriteBehindStats_t* stats);
+
+// CAM Support Functions
+extern int32_t Crypto_Get_Cam_Token_Stats(CamTokenStats_t* stats);
+
+// KMC Crypto Service Support Functions
+extern int32_t Crypto_Get_Kmc_Endpoint_Stats(uint8_t endpoint_idx, KmcEndpointStats_t* stats);
+
 // Crypo Error Support Functions
 extern char* Crypto_Get_Error_Code_Enum_String(int32_t crypto_error_code);
 
+// Crypto Context Functions
+extern CryptoContext_t* Crypto_Context_Create(void);
+extern CryptoContext_t* Crypto_Context_Get(void); // The calling thread's current context
+extern int32_t Crypto_Context_Free(CryptoContext_t* ctx); // Shuts the context down first
+extern CryptoContext_t* Crypto_Context_Enter(CryptoContext_t* ctx); // Returns the context to hand to Crypto_Context_Exit
+extern void Crypto_Context_Exit(CryptoContext_t* prev_ctx);
+
+// Context Variants, the function of the same name run against ctx (NULL selects the default context)
+extern int32_t Crypto_Config_CryptoLib_Ctx(CryptoContext_t* ctx, uint8_t key_type, uint8_t mc_type, uint8_t sa_type,
+                                           uint8_t cryptography_type, uint8_t iv_type, uint8_t crypto_create_fecf,
+                                           uint8_t process_sdls_pdus, uint8_t has_pus_hdr, uint8_t ignore_sa_state,
+                                           uint8_t ignore_anti_replay, uint8_t unique_sa_per_mapid,
+                                           uint8_t crypto_check_fecf, uint8_t vcid_bitmask,
+                                           uint8_t crypto_increment_nontransmitted_iv);
+extern int32_t Crypto_Config_Sa_Capacity_Ctx(CryptoContext_t* ctx, uint16_t sa_capacity);
+extern int32_t Crypto_Config_Key_Capacity_Ctx(CryptoContext_t* ctx, uint16_t key_capacity);
+extern int32_t Crypto_Config_Thread_Safety_Ctx(CryptoContext_t* ctx, uint8_t thread_safe);
+extern int32_t Crypto_Config_Key_Store_Ctx(CryptoContext_t* ctx, char* key_store_path, uint8_t* kek, uint32_t kek_len);
+extern int32_t Crypto_Config_MariaDB_Ctx(CryptoContext_t* ctx, char* mysql_hostname, char* mysql_database,
+                                         uint16_t mysql_port, uint8_t mysql_require_secure_transport,
+                                         uint8_t mysql_tls_verify_server, char* mysql_tls_ca, char* mysql_tls_capath,
+                                         char* mysql_mtls_cert, char* mysql_mtls_key,
+                                         char* mysql_mtls_client_key_password, char* mysql_username,
+                                         char* mysql_password);
+extern int32_t Crypto_Config_MariaDB_Cache_Ctx(CryptoContext_t* ctx, uint8_t sa_cache_enabled,
+                                               uint32_t sa_cache_poll_interval_ms);
+extern int32_t Crypto_Config_MariaDB_Write_Behind_Ctx(CryptoContext_t* ctx, uint8_t write_behind_enabled,
+                                                      uint32_t flush_frames, uint32_t flush_interval_ms,
+                                                      uint32_t max_staleness_ms);
+extern int32_t Crypto_Config_MariaDB_Pool_Ctx(CryptoContext_t* ctx, uint8_t pool_size,
+                                              uint32_t health_check_interval_ms);
+extern int32_t Crypto_Config_Sa_Mmap_Ctx(CryptoContext_t* ctx, char* mmap_path, uint32_t checkpoint_interval,
+                                         uint32_t checkpoint_interval_ms);
+extern int32_t Crypto_Config_Sa_Sqlite_Ctx(CryptoContext_t* ctx, char* sqlite_path, uint8_t sqlite_synchronous);
+extern int32_t Crypto_Config_Sa_Shm_Ctx(CryptoContext_t* ctx, char* shm_name);
+extern int32_t Crypto_Config_Kmc_Crypto_Service_Ctx(CryptoContext_t* ctx, char* protocol, char* kmc_crypto_hostname,
+                                                    uint16_t kmc_crypto_port, char* kmc_crypto_app,
+                                                    char* kmc_tls_ca_bundle, char* kmc_tls_ca_path,
+                                                    uint8_t kmc_ignore_ssl_hostname_validation,
+                                                    char* mtls_client_cert_path, char* mtls_client_cert_type,
+                                                    char* mtls_client_key_path, char* mtls_client_key_pass,
+                                                    char* mtls_issuer_cert);
+extern int32_t Crypto_Config_Kmc_Crypto_Service_Add_Endpoint_Ctx(CryptoContext_t* ctx, char* kmc_crypto_hostname,
+                                                                 uint16_t kmc_crypto_port);
+extern int32_t Crypto_Config_Kmc_Crypto_Service_Hedging_Ctx(CryptoContext_t* ctx, uint8_t hedge_idempotent_requests,
+                                                            uint32_t hedge_min_delay_ms);
+extern int32_t Crypto_Config_Cam_Ctx(CryptoContext_t* ctx, uint8_t cam_enabled, char* cookie_file_path,
+                                     char* keytab_file_path, uint8_t login_method, char* access_manager_uri,
+                                     char* username, char* cam_home);
+extern int32_t Crypto_Config_Add_Gvcid_Managed_Parameter_Ctx(CryptoContext_t* ctx, uint8_t tfvn, uint16_t scid,
+                                                             uint8_t vcid, uint8_t has_fecf,
+                                                             uint8_t has_segmentation_hdr, uint16_t max_frame_size,
+                                                             uint8_t aos_has_fhec, uint8_t aos_has_iz,
+                                                             uint16_t aos_iz_len);
+extern int32_t Crypto_Init_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Init_With_Configs_Ctx(CryptoContext_t* ctx, CryptoConfig_t* crypto_config_p,
+                                            GvcidManagedParameters_t* gvcid_managed_parameters_p,
+                                            SadbMariaDBConfig_t* sa_mariadb_config_p,
+                                            CryptographyKmcCryptoServiceConfig_t* cryptography_kmc_crypto_config_p);
+extern int32_t Crypto_TC_Init_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Init_TC_Unit_Test_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Init_TM_Unit_Test_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Init_AOS_Unit_Test_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Init_Static_Config_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Shutdown_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Snapshot_Save_Ctx(CryptoContext_t* ctx, const char* path);
+extern int32_t Crypto_Snapshot_Load_Ctx(CryptoContext_t* ctx, const char* path, uint32_t counter_skip);
+extern void Crypto_Snapshot_Release_Ctx(CryptoContext_t* ctx);
+extern int32_t Crypto_Key_Store_Save_Ctx(CryptoContext_t* ctx, const char* path);
+extern int32_t Crypto_TC_ApplySecurity_Ctx(CryptoContext_t* ctx, const uint8_t* p_in_frame,
+                                           const uint16_t in_frame_length, uint8_t** pp_enc_frame,
+                                           uint16_t* p_enc_frame_len);
+extern int32_t Crypto_TC_ProcessSecurity_Ctx(CryptoContext_t* ctx, uint8_t* ingest, int* len_ingest,
+                                             TC_t* tc_sdls_processed_frame);
+extern int32_t Crypto_TC_ApplySecurity_Cam_Ctx(CryptoContext_t* ctx, const uint8_t* p_in_frame,
+                                               const uint16_t in_frame_length, uint8_t** pp_enc_frame,
+                                               uint16_t* p_enc_frame_len, char* cam_cookies);
+extern int32_t Crypto_TC_ProcessSecurity_Cam_Ctx(CryptoContext_t* ctx, uint8_t* ingest, int* len_ingest,
+                                                 TC_t* tc_sdls_processed_frame, char* cam_cookies);
+extern int32_t Crypto_TC_ApplySecurity_Batch_Ctx(CryptoContext_t* ctx, TcBatchFrame_t* frames, uint32_t num_frames);
+extern int32_t Crypto_TM_ApplySecurity_Ctx(CryptoContext_t* ctx, uint8_t* pTfBuffer);
+extern int32_t Crypto_TM_ProcessSecurity_Ctx(CryptoContext_t* ctx, uint8_t* p_ingest, uint16_t len_ingest,
+                                             uint8_t** pp_processed_frame, uint16_t* p_decrypted_length);
+extern int32_t Crypto_AOS_ApplySecurity_Ctx(CryptoContext_t* ctx, uint8_t* pTfBuffer);
+extern int32_t Crypto_AOS_ProcessSecurity_Ctx(CryptoContext_t* ctx, uint8_t* p_ingest, uint16_t len_ingest,
+                                              uint8_t** pp_processed_frame, uint16_t* p_decrypted_length);
+
 /*
 ** Internal Prototypes
 */
@@ -122,7 +364,7 @@ int32_t Crypto_Get_tmLength(int len);
 uint8_t Crypto_Is_AEAD_Algorithm(uint32_t cipher_suite_id);
 void Crypto_TM_updatePDU(uint8_t* ingest, int len_ingest);
 void Crypto_TM_updateOCF(void);
-uint8_t* Crypto_Prepare_TC_AAD(uint8_t* buffer, uint16_t len_aad, uint8_t* abm_buffer);
+uint8_t* Crypto_Prepare_TC_AAD(uint8_t* buffer, uint16_t len_aad, const uint8_t* abm_buffer);
 uint32_t Crypto_Prepare_TM_AAD(const uint8_t* buffer, uint16_t len_aad, const uint8_t* abm_buffer, uint8_t* aad);
 uint32_t Crypto_Prepare_AOS_AAD(const uint8_t* buffer, uint16_t len_aad, const uint8_t* abm_buffer, uint8_t* aad);
 void Crypto_Local_Config(void);
@@ -143,6 +385,8 @@ int32_t Crypto_Key_OTAR(void);
 int32_t Crypto_Key_update(uint8_t state);
 int32_t Crypto_Key_inventory(uint8_t* );
 int32_t Crypto_Key_verify(uint8_t* , TC_t* tc_frame);
+int32_t Crypto_Key_Publish(uint32_t key_id, const crypto_key_t* key);
+uint32_t Crypto_Key_Generation(uint32_t key_id);
 
 // Security Monitoring & Control Procedure
 int32_t Crypto_MC_ping(uint8_t* ingest);
@@ -182,12 +426,20 @@ int32_t crypto_config_add_gvcid_managed_parameter_recursion(uint8_t tfvn, uint16
                                                                    GvcidManagedParameters_t* managed_parameter);
 void Crypto_Free_Managed_Parameters(GvcidManagedParameters_t* managed_parameters);
 
+// SA Lookup Functions
+int32_t Crypto_Get_Operational_SA(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid,
+                                  SecurityAssociation_t** security_association);
+
+// Crypto Context Support Functions
+uint8_t Crypto_Context_Backends_In_Use(void);
+
 // Project-wide support functions
 extern char* crypto_deep_copy_string(char* src_string);
 
 /*
 ** Extern Global Variables
-*/ 
+*/
+// The default context's state, see CryptoContext_t. Library code reaches the current context's state instead.
 // Data stores used in multiple components
 extern CCSDS_t sdls_frame;
 // extern TM_t tm_frame;
@@ -195,12 +447,17 @@ extern uint8_t tm_frame[1786];
 extern TM_FramePrimaryHeader_t tm_frame_pri_hdr; 
 extern TM_FrameSecurityHeader_t tm_frame_sec_hdr; // Used to reduce bit math duplication
 // exterm AOS_t aos_frame
+extern uint8_t aos_frame[1786];
 extern AOS_FramePrimaryHeader_t aos_frame_pri_hdr; 
 extern AOS_FrameSecurityHeader_t aos_frame_sec_hdr; // Used to reduce bit math duplication
 
 // Global configuration structs
 extern CryptoConfig_t crypto_config;
 extern SadbMariaDBConfig_t* sa_mariadb_config;
+extern SadbMmapConfig_t* sa_mmap_config;
+extern KeyStoreConfig_t* key_store_config;
+extern SadbSqliteConfig_t* sa_sqlite_config;
+extern SadbShmConfig_t* sa_shm_config;
 extern CryptographyKmcCryptoServiceConfig_t* cryptography_kmc_crypto_config;
 extern CamConfig_t* cam_config;
 extern GvcidManagedParameters_t* gvcid_managed_parameters;
@@ -211,10 +468,6 @@ extern SaInterface sa_if;
 extern CryptographyInterface cryptography_if;
 
 // extern crypto_key_t ak_ring[NUM_KEYS];
-extern CCSDS_t sdls_frame;
-extern SadbMariaDBConfig_t* sa_mariadb_config;
-extern GvcidManagedParameters_t* gvcid_managed_parameters;
-extern GvcidManagedParameters_t* current_managed_parameters;
 // OCF
 extern uint8_t ocf;
 extern SDLS_FSR_t report;
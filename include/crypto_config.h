@@ -107,11 +107,12 @@
 #define SA_AUTHENTICATED_ENCRYPTION 3
 
 // Generic Defines
-#define NUM_SA 64
+#define NUM_SA 64 /* Default in-memory SA table capacity, see Crypto_Config_Sa_Capacity */
 #define SPI_LEN 2 /* bytes */
 #define KEY_SIZE 512 /* bytes */
 #define KEY_ID_SIZE 8
 #define NUM_KEYS 256
+#define KEY_STORE_KEK_SIZE 32 /* bytes, see Crypto_Config_Key_Store */
 #define DISABLED 0
 #define ENABLED 1
 #define IV_SIZE 16   /* TM IV size bytes */
@@ -128,6 +129,8 @@
 #define PAD_SIZE 32           /* bytes */
 #define CHALLENGE_SIZE 16     /* bytes */
 #define CHALLENGE_MAC_SIZE 16 /* bytes */
+#define OTAR_IV_SIZE 12       /* bytes */
+#define OTAR_KEY_SIZE 32      /* bytes, AES-256 session key in an OTAR key block */
 
 // Monitoring and Control Defines
 #define EMV_SIZE 4  /* bytes */
@@ -51,7 +51,10 @@ typedef enum
     SA_TYPE_UNITIALIZED = 0,
     SA_TYPE_CUSTOM,
     SA_TYPE_INMEMORY,
-    SA_TYPE_MARIADB
+    SA_TYPE_MARIADB,
+    SA_TYPE_MMAP,
+    SA_TYPE_SQLITE,
+    SA_TYPE_SHM
 } SadbType;
 typedef enum
 {
@@ -175,6 +178,11 @@ typedef enum
     CAM_LOGIN_KERBEROS, // Using already logged-in Kerberos to generate CAM cookies
     CAM_LOGIN_KEYTAB_FILE // using keytab file to login and generate CAM cookies
 } CamLoginMethod;
+typedef enum
+{
+    CRYPTO_THREAD_SAFE_FALSE,
+    CRYPTO_THREAD_SAFE_TRUE // Frames may run on several threads at once, see Crypto_Config_Thread_Safety
+} ThreadSafeBool;
 /*
 **  Used for selecting supported algorithms
 */
@@ -215,6 +223,9 @@ typedef struct
     CheckFecfBool crypto_check_fecf;
     uint8_t vcid_bitmask;
     uint8_t crypto_increment_nontransmitted_iv; // Whether or not CryptoLib increments the non-transmitted portion of the IV field
+    uint16_t sa_capacity; // Maximum number of SAs held by the in-memory SA interface, 0 selects NUM_SA
+    uint16_t key_capacity; // Key IDs held by the internal key interface, 0 selects NUM_KEYS
+    ThreadSafeBool thread_safe; // Frames advance SA counters under per-SA locks
 } CryptoConfig_t;
 #define CRYPTO_CONFIG_SIZE (sizeof(CryptoConfig_t))
 
@@ -252,10 +263,79 @@ typedef struct
     uint8_t mysql_tls_verify_server;
     char* mysql_mtls_client_key_password;
     uint8_t mysql_require_secure_transport;
+    uint8_t sa_cache_enabled;           // Serve SAs from a read-through cache, see Crypto_Config_MariaDB_Cache
+    uint32_t sa_cache_poll_interval_ms; // Minimum time between sadb_version polls, 0 polls on every lookup
+    uint8_t write_behind_enabled;       // Queue IV/ARSN saves for a background writer, see Crypto_Config_MariaDB_Write_Behind
+    uint32_t write_behind_flush_frames; // Saves that trigger a flush, 0 for no frame trigger
+    uint32_t write_behind_flush_interval_ms; // Age of the oldest queued save that triggers a flush
+    uint32_t write_behind_max_staleness_ms;  // Age at which saves wait for the writer, 0 for no limit
+    uint8_t pool_size;                  // Connections opened for SA access, see Crypto_Config_MariaDB_Pool
+    uint32_t pool_health_check_interval_ms; // Idle time after which a connection is pinged before use, 0 never pings
 
 } SadbMariaDBConfig_t;
 #define SADB_MARIADB_CONFIG_SIZE (sizeof(SadbMariaDBConfig_t))
 
+/*
+** Memory-Mapped SA Store Configuration Block
+*/
+typedef struct
+{
+    char* mmap_path;                 // File backing the SA table
+    uint32_t checkpoint_interval;    // Checkpoint after this many sa_save_sa calls, must be set: after a crash the
+                                     // counters are advanced by twice this when the live table is lost
+    uint32_t checkpoint_interval_ms; // Checkpoint on the first sa_save_sa this long after the last one, 0 to disable
+
+} SadbMmapConfig_t;
+#define SADB_MMAP_CONFIG_SIZE (sizeof(SadbMmapConfig_t))
+
+/*
+** Encrypted Key Store Configuration Block
+*/
+typedef struct
+{
+    char* key_store_path;                      // Key store file the internal key interface maps at key_init
+    uint8_t key_store_kek[KEY_STORE_KEK_SIZE]; // AES-256-GCM key the records are sealed with
+} KeyStoreConfig_t;
+#define KEY_STORE_CONFIG_SIZE (sizeof(KeyStoreConfig_t))
+
+/*
+** SaDB SQLite Configuration Block
+*/
+typedef enum
+{
+    SA_SQLITE_SYNC_NORMAL, // WAL is synced at checkpoints, a power loss may drop the last committed saves
+    SA_SQLITE_SYNC_FULL    // WAL is synced on every commit
+} SaSqliteSync;
+typedef struct
+{
+    char* sqlite_path;           // Database file, created with the SADB schema if it does not exist
+    uint8_t sqlite_synchronous;  // SaSqliteSync
+
+} SadbSqliteConfig_t;
+#define SADB_SQLITE_CONFIG_SIZE (sizeof(SadbSqliteConfig_t))
+
+/*
+** Shared-Memory SA Table Configuration Block
+*/
+typedef struct
+{
+    char* shm_name; // POSIX shared memory object holding the SA table, e.g. "/cryptolib_sa"
+
+} SadbShmConfig_t;
+#define SADB_SHM_CONFIG_SIZE (sizeof(SadbShmConfig_t))
+
+/*
+** KMC Cryptography Service Replica Endpoint
+*/
+typedef struct _KmcCryptoEndpoint_t KmcCryptoEndpoint_t;
+struct _KmcCryptoEndpoint_t
+{
+    char* hostname;
+    uint16_t port;
+    KmcCryptoEndpoint_t* next; // Next configured replica, NULL if last
+};
+#define KMC_CRYPTO_ENDPOINT_SIZE (sizeof(KmcCryptoEndpoint_t))
+
 /*
 ** KMC Cryptography Service Configuration Block
 */
@@ -273,6 +353,9 @@ typedef struct
     char* mtls_ca_path;
     char* mtls_issuer_cert;
     uint8_t ignore_ssl_hostname_validation;
+    KmcCryptoEndpoint_t* replica_endpoints; // Additional endpoints serving the same KMC Crypto Service
+    uint8_t hedge_idempotent_requests;      // Duplicate slow decrypt/verify requests to a second endpoint
+    uint32_t hedge_min_delay_ms;            // Lower bound on the wait before a hedge is sent
 
 } CryptographyKmcCryptoServiceConfig_t;
 #define CRYPTOGRAPHY_KMC_CRYPTO_SERVICE_CONFIG_SIZE (sizeof(CryptographyKmcCryptoServiceConfig_t))
@@ -293,4 +376,53 @@ typedef struct
 } CamConfig_t;
 #define CAM_CONFIG_SIZE (sizeof(CamConfig_t))
 
+/*
+** Common Access Manager (CAM) SSO Token Cache Statistics
+*/
+typedef struct
+{
+    uint32_t refresh_count;         // Successful SSO token logins (initial, proactive and reactive)
+    uint32_t refresh_failure_count; // Failed SSO token login attempts
+    int64_t token_expiry;           // Earliest expiry of the cached token cookies (epoch seconds), 0 if unknown
+    uint8_t token_cached;           // Whether an SSO token is currently cached in memory
+
+} CamTokenStats_t;
+#define CAM_TOKEN_STATS_SIZE (sizeof(CamTokenStats_t))
+
+/*
+** KMC Cryptography Service Endpoint Routing Statistics
+*/
+typedef struct
+{
+    uint32_t num_requests;    // Requests sent to this endpoint, including hedges
+    uint32_t num_errors;      // Transport failures and 5xx responses
+    uint32_t num_hedges_sent; // Hedged duplicates sent to this endpoint
+    uint32_t num_hedges_won;  // Hedged duplicates that answered first
+    double ewma_latency_ms;
+    double ewma_error_rate;
+    double p99_latency_ms;    // Over the most recent requests
+
+} KmcEndpointStats_t;
+#define KMC_ENDPOINT_STATS_SIZE (sizeof(KmcEndpointStats_t))
+
+/*
+** SaDB MariaDB Write-Behind Statistics
+*/
+typedef struct
+{
+    uint64_t num_saves;          // sa_save_sa calls queued for the writer
+    uint64_t num_saves_flushed;  // Queued saves covered by a committed flush
+    uint64_t num_rows_written;   // Rows updated by committed flushes, one per SPI per flush
+    uint32_t num_flushes;        // Committed flush transactions
+    uint32_t num_flush_failures; // Flushes rolled back, their updates stay queued
+    uint32_t num_stale_waits;    // Saves that waited on the writer because of max staleness
+    uint32_t num_pending;        // SPIs with a queued update
+    double last_flush_latency_ms;
+    double ewma_flush_latency_ms;
+    double max_flush_latency_ms;
+    double coalescing_ratio;     // num_saves_flushed / num_rows_written
+
+} SadbMariaDBWriteBehindStats_t;
+#define SADB_MARIADB_WRITE_BEHIND_STATS_SIZE (sizeof(SadbMariaDBWriteBehindStats_t))
+
 #endif //CRYPTO_CONFIG_STRUCTS_H
\ No newline at end of file
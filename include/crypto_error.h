@@ -27,14 +27,38 @@
 #define CRYPTO_MANAGED_PARAM_CONFIGURATION_NOT_COMPLETE 101
 #define CRYPTO_MARIADB_CONFIGURATION_NOT_COMPLETE 102
 #define MANAGED_PARAMETERS_FOR_GVCID_NOT_FOUND 103
+#define CRYPTO_MMAP_CONFIGURATION_NOT_COMPLETE 104
+#define CRYPTO_SQLITE_CONFIGURATION_NOT_COMPLETE 105
+#define CRYPTO_SHM_CONFIGURATION_NOT_COMPLETE 106
+#define CRYPTO_SNAPSHOT_FILE_ERROR 107
+#define CRYPTO_SNAPSHOT_INVALID 108
+#define CRYPTO_STATIC_CONFIG_NOT_AVAILABLE 109
+#define CRYPTO_KEY_STORE_CONFIGURATION_NOT_COMPLETE 110
+#define CRYPTO_KEY_STORE_FILE_ERROR 111
+#define CRYPTO_KEY_STORE_INVALID 112
+#define CRYPTO_THREAD_SAFETY_NOT_SUPPORTED 113
 
 #define SADB_INVALID_SADB_TYPE 200
 #define SADB_NULL_SA_USED 201
+#define SADB_SPI_NOT_FOUND 202
+#define SADB_SA_TABLE_FULL 203
+#define SADB_MMAP_OPEN_FAILED 204
+#define SADB_MMAP_STORE_CORRUPT 205
+#define SADB_MMAP_STORE_INCOMPATIBLE 206
+#define SADB_MMAP_SYNC_FAILED 207
+#define SADB_SQLITE_OPEN_FAILED 208
+#define SADB_SHM_OPEN_FAILED 209
+#define SADB_SHM_TABLE_INCOMPATIBLE 210
+#define SADB_SHM_LOCK_FAILED 211
+#define SADB_SA_WRONG_STATE 212
+#define SADB_MMAP_CHECKPOINT_BEHIND 213
+#define SADB_SHM_SA_CHANGED 214
 
 #define SADB_MARIADB_CONNECTION_FAILED 300
 #define SADB_QUERY_FAILED 301
 #define SADB_QUERY_EMPTY_RESULTS 302
 #define SADB_INSERT_FAILED 303
+#define SADB_MARIADB_WRITE_BEHIND_STALE 304
 
 #define CRYPTOGRAPHY_INVALID_CRYPTO_INTERFACE_TYPE  400
 #define CRYPTOGRAPHY_UNSUPPORTED_OPERATION_FOR_KEY_RING 401
@@ -56,6 +80,7 @@
 #define CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_EMPTY_RESPONSE 513
 #define CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_DECRYPT_ERROR 514
 #define CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_ENCRYPT_ERROR 515
+#define CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_ENDPOINT_OUT_OF_RANGE 516
 
 #define CAM_CONFIG_NOT_SUPPORTED_ERROR 600
 #define CAM_INVALID_COOKIE_FILE_CONFIGURATION_NULL 601
@@ -120,6 +145,8 @@
 #define CRYPTO_LIB_ERR_MC_INIT (-48)
 #define CRYPTO_LIB_ERR_INPUT_FRAME_TOO_SHORT_FOR_AOS_STANDARD (-49)
 #define CRYPTO_LIB_ERR_TC_ENUM_USED_FOR_AOS_CONFIG (-50)
+#define CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE (-51)
+#define CRYPTO_LIB_ERR_ABM_POOL_FULL (-52)
 
 extern char *crypto_enum_errlist_core[];
 extern char *crypto_enum_errlist_config[];
@@ -45,6 +45,10 @@ typedef struct
 
 /*
 ** Security Association
+** Fields consulted on every frame are grouped at the front of the structure so that SA lookup and header
+** processing touch as few cache lines as possible; configuration-only fields follow. The Authentication Bit
+** Mask is not stored inline, it references a shared, deduplicated entry in the ABM pool (see crypto_abm.c)
+** and must only be changed through Crypto_SA_Set_ABM / Crypto_SA_Fill_ABM.
 */
 typedef struct
 {
@@ -52,12 +56,7 @@ typedef struct
     uint16_t spi;  // Security Parameter Index
     uint16_t ekid; // Encryption Key ID  (Used with numerically indexed keystores, EG inmemory keyring)
     uint16_t akid; // Authentication Key ID
-    char*    ek_ref; // Encryption Key Reference (Used with string-referenced keystores,EG-PKCS12 keystores, KMC crypto)
-    char*    ak_ref; // Authentication Key Reference (Used with string-referenced keystores,EG-PKCS12 keystores, KMC crypto)
     uint8_t sa_state : 2;
-    crypto_gvcid_t gvcid_blk;
-    // crypto_gvcid_t gvcid_tm_blk[NUM_GVCID];
-    uint8_t lpid;
 
     // Configuration
     uint8_t est : 1;        // Encryption Service Type
@@ -67,21 +66,71 @@ typedef struct
     uint8_t shplf_len : 2;  // Sec. Header PL Field Length
     uint8_t stmacf_len : 8; // Sec. Trailer MAC Field Length
     uint8_t ecs;            // Encryption Cipher Suite (algorithm / mode ID)
-    uint8_t ecs_len : 8;    // Encryption Cipher Suite Length
-    uint8_t iv[IV_SIZE];    // Initialization Vector
-    uint8_t iv_len;         // Length of entire IV
-    uint8_t acs_len : 8;    // Authentication Cipher Suite Length
     uint8_t acs;            // Authentication Cipher Suite (algorithm / mode ID)
-    uint16_t abm_len : 16;  // Authentication Bit Mask Length
-    uint8_t abm[ABM_SIZE];  // Authentication Bit Mask (Primary Hdr. through Security Hdr.)
+    uint8_t iv_len;         // Length of entire IV
     uint8_t arsn_len : 8;   // Anti-Replay Seq Num Length
-    uint8_t arsn[ARSN_SIZE];// Anti-Replay Seq Num
     uint8_t arsnw_len : 8;  // Anti-Replay Seq Num Window Length
     uint16_t arsnw;         // Anti-Replay Seq Num Window
+    uint16_t abm_len : 16;  // Authentication Bit Mask Length
+    crypto_gvcid_t gvcid_blk;
+    // crypto_gvcid_t gvcid_tm_blk[NUM_GVCID];
+    const uint8_t* abm;     // Authentication Bit Mask (Primary Hdr. through Security Hdr.), ABM_SIZE bytes, read-only
+    uint8_t iv[IV_SIZE];    // Initialization Vector
+    uint8_t arsn[ARSN_SIZE];// Anti-Replay Seq Num
+
+    // Cold
+    char*    ek_ref; // Encryption Key Reference (Used with string-referenced keystores,EG-PKCS12 keystores, KMC crypto)
+    char*    ak_ref; // Authentication Key Reference (Used with string-referenced keystores,EG-PKCS12 keystores, KMC crypto)
+    uint8_t lpid;
+    uint8_t ecs_len : 8;    // Encryption Cipher Suite Length
+    uint8_t acs_len : 8;    // Authentication Cipher Suite Length
+    uint16_t abm_idx;       // ABM pool entry backing abm, 0 if none
 
 } SecurityAssociation_t;
 #define SA_SIZE (sizeof(SecurityAssociation_t))
 
+/*
+** Authentication Bit Mask Pool Statistics
+*/
+typedef struct
+{
+    uint16_t num_entries; // Distinct ABMs currently held by the pool
+    uint32_t num_refs;    // Security Associations referencing a pooled ABM
+    uint32_t bytes_saved; // Bytes not allocated thanks to deduplication
+
+} AbmPoolStats_t;
+#define ABM_POOL_STATS_SIZE (sizeof(AbmPoolStats_t))
+
+/*
+** SA Provisioning Operation
+** One SA procedure in a batch passed to the SA interface's sa_provision
+*/
+typedef struct
+{
+    uint8_t procedure;               // SA_CREATE, SA_REKEY, SA_START, SA_STOP, SA_EXPIRE or SA_DELETE
+    uint16_t spi;
+    const SecurityAssociation_t* sa; // SA_CREATE: the SA to store, in the state it is in. SA_REKEY: new ekid and IV
+    crypto_gvcid_t gvcid;            // SA_START: channel the SA becomes operational on
+    int32_t status;                  // Set by sa_provision
+
+} SaProvisionOp_t;
+#define SA_PROVISION_OP_SIZE (sizeof(SaProvisionOp_t))
+
+/*
+** TC Batch Frame
+** One frame in a batch passed to Crypto_TC_ApplySecurity_Batch
+*/
+typedef struct
+{
+    const uint8_t* in_frame;
+    uint16_t in_frame_length;
+    uint8_t* enc_frame;        // Set by Crypto_TC_ApplySecurity_Batch, freed by the caller
+    uint16_t enc_frame_length; // Set by Crypto_TC_ApplySecurity_Batch
+    int32_t status;            // Set by Crypto_TC_ApplySecurity_Batch
+
+} TcBatchFrame_t;
+#define TC_BATCH_FRAME_SIZE (sizeof(TcBatchFrame_t))
+
 /*
 ** SDLS Definitions
 */
@@ -111,18 +160,18 @@ typedef struct
 
 typedef struct
 {
-    uint16_t ekid;        // Encrypted Key ID
-    uint8_t ek[KEY_SIZE]; // Encrypted Key
+    uint16_t ekid;             // Encrypted Key ID
+    uint8_t ek[OTAR_KEY_SIZE]; // Encrypted Key
     // uint8_t	ekcrc[4];			// Encrypted Key CRC
 } SDLS_EKB_t;
 #define SDLS_EKB_SIZE (sizeof(SDLS_EKB_t))
 
 typedef struct
 {
-    uint16_t mkid;         // Master Key ID
-    uint8_t iv[IV_SIZE];   // Initialization Vector
-    SDLS_EKB_t EKB[30];    // Encrypted Key Block
-    uint8_t mac[MAC_SIZE]; // Message Authentication Code
+    uint16_t mkid;            // Master Key ID
+    uint8_t iv[OTAR_IV_SIZE]; // Initialization Vector
+    SDLS_EKB_t EKB[30];       // Encrypted Key Block
+    uint8_t mac[MAC_SIZE];    // Message Authentication Code
 } SDLS_OTAR_t;
 #define SDLS_OTAR_SIZE (sizeof(SDLS_OTAR_t))
 
@@ -80,7 +80,10 @@ typedef struct
                                          uint8_t aad_bool, uint8_t* ecs, uint8_t* acs, char* cam_cookies);
     int32_t (*cryptography_get_acs_algo)(int8_t algo_enum);
     int32_t (*cryptography_get_ecs_algo)(int8_t algo_enum);
-    
+    // Optional, drops anything cached for a key that has just been replaced
+    int32_t (*cryptography_key_invalidate)(uint32_t key_id);
+    // Optional, sets up a key for ecs before its first use
+    int32_t (*cryptography_key_warm)(uint32_t key_id, uint8_t* key, uint32_t len_key, uint8_t* ecs);
 
 } CryptographyInterfaceStruct, *CryptographyInterface;
 
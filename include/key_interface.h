@@ -36,6 +36,7 @@ typedef struct
     crypto_key_t* (*get_key)(uint32_t key_id);
     int32_t (*key_init)(void);
     int32_t (*key_shutdown)(void);
+    int32_t (*key_publish)(uint32_t key_id, const crypto_key_t* key); // Optional, NULL if keys are updated in place
 
     /* Key Interface, SDLS-EP */
 
@@ -36,6 +36,7 @@ typedef struct
     int32_t (*sa_get_from_spi)(uint16_t, SecurityAssociation_t** );
     int32_t (*sa_get_operational_sa_from_gvcid)(uint8_t, uint16_t, uint16_t, uint8_t, SecurityAssociation_t**);
     int32_t (*sa_save_sa)(SecurityAssociation_t* );
+    int32_t (*sa_diagnose_gvcid)(uint8_t, uint16_t, uint16_t, uint8_t); // Optional, NULL if the backend has none
     // Security Association Utility Functions
     int32_t (*sa_stop)(void);
     int32_t (*sa_start)(TC_t* tc_frame);
@@ -46,12 +47,24 @@ typedef struct
     int32_t (*sa_setARSN)(void);
     int32_t (*sa_setARSNW)(void);
     int32_t (*sa_delete)(void);
+    // Security Association Snapshot Functions, NULL if the backend keeps its SAs itself
+    int32_t (*sa_get_from_index)(uint32_t, SecurityAssociation_t** ); // SADB_SPI_NOT_FOUND past the last SA
+    int32_t (*sa_insert)(const SecurityAssociation_t* );               // Adds the SA or replaces the one with its SPI
+    // Security Association Provisioning Functions, NULL if the backend has none
+    int32_t (*sa_provision)(SaProvisionOp_t*, uint32_t); // Runs each operation, returns the first one's failure
+    // Security Association Batch Functions, NULL if the backend has none
+    int32_t (*sa_batch_begin)(void); // Until sa_batch_end, the calling thread's saves may complete after they return
+    int32_t (*sa_prefetch_operational_sa_from_gvcid)(uint8_t, uint16_t, uint16_t, uint8_t); // Hint for a later lookup
+    int32_t (*sa_batch_end)(void);   // Waits for the calling thread's saves, returns the first failure
 
 } SaInterfaceStruct, *SaInterface;
 
 SaInterface get_sa_interface_custom(void);
 SaInterface get_sa_interface_inmemory(void);
 SaInterface get_sa_interface_mariadb(void);
+SaInterface get_sa_interface_mmap(void);
+SaInterface get_sa_interface_sqlite(void);
+SaInterface get_sa_interface_shm(void);
 // SaInterface init_parse_sa_routine(uint8_t* );
 
 #endif //CRYPTOLIB_SA_INTERFACE_H
@@ -20,7 +20,11 @@
 ** Includes
 */
 #include "crypto.h"
+#include "crypto_context_internal.h"
 #include <string.h>
+#ifdef CRYPTO_STATIC_CONFIG
+#include "crypto_static_tables.h"
+#endif
 
 /*
 ** Static Library Declaration
@@ -32,30 +36,6 @@ CFS_MODULE_DECLARE_LIB(crypto);
 /*
 ** Global Variables
 */
-// crypto_key_t ak_ring[NUM_KEYS];
-CCSDS_t sdls_frame;
-// TM_t tm_frame;
-uint8_t tm_frame[1786];                    // Testing
-TM_FramePrimaryHeader_t tm_frame_pri_hdr;  // Used to reduce bit math duplication
-TM_FrameSecurityHeader_t tm_frame_sec_hdr; // Used to reduce bit math duplication
-// AOS_t aos_frame
-uint8_t aos_frame[1786];                    // Testing
-AOS_FramePrimaryHeader_t aos_frame_pri_hdr;  // Used to reduce bit math duplication
-AOS_FrameSecurityHeader_t aos_frame_sec_hdr; // Used to reduce bit math duplication
-// OCF
-uint8_t ocf = 0;
-SDLS_FSR_t report;
-Telemetry_Frame_Clcw_t clcw;
-// Flags
-SDLS_MC_LOG_RPLY_t log_summary;
-SDLS_MC_DUMP_BLK_RPLY_t mc_log;
-uint8_t log_count = 0;
-uint16_t tm_offset = 0;
-// ESA Testing - 0 = disabled, 1 = enabled
-uint8_t badSPI = 0;
-uint8_t badIV = 0;
-uint8_t badMAC = 0;
-uint8_t badFECF = 0;
 //  CRC
 uint32_t crc32Table[256];
 uint16_t crc16Table[256];
@@ -302,12 +282,12 @@ int32_t Crypto_FECF(int fecf, uint8_t* ingest, int len_ingest,TC_t* tc_frame)
                 {
                     Crypto_increment((uint8_t*)&log_summary.num_se, 4);
                     log_summary.rs--;
-                    mc_log.blk[log_count].emt = FECF_ERR_EID;
-                    mc_log.blk[log_count].emv[0] = 0x4E;
-                    mc_log.blk[log_count].emv[1] = 0x41;
-                    mc_log.blk[log_count].emv[2] = 0x53;
-                    mc_log.blk[log_count].emv[3] = 0x41;
-                    mc_log.blk[log_count++].em_len = 4;
+                    crypto_context_current->mc_log->blk[log_count].emt = FECF_ERR_EID;
+                    crypto_context_current->mc_log->blk[log_count].emv[0] = 0x4E;
+                    crypto_context_current->mc_log->blk[log_count].emv[1] = 0x41;
+                    crypto_context_current->mc_log->blk[log_count].emv[2] = 0x53;
+                    crypto_context_current->mc_log->blk[log_count].emv[3] = 0x41;
+                    crypto_context_current->mc_log->blk[log_count++].em_len = 4;
                 }
                 #ifdef FECF_DEBUG
                     printf("\t Calculated = 0x%04x \n\t Received   = 0x%04x \n", calc_fecf,
@@ -696,6 +676,34 @@ int32_t Crypto_Get_Managed_Parameters_For_Gvcid(uint8_t tfvn, uint16_t scid, uin
     }
 }
 
+/**
+ * @brief Function: Crypto_Get_Operational_SA
+ * The SA the TC, TM and AOS frame functions apply security with. On a miss the backend's sa_diagnose_gvcid, if it
+ * has one, names the mismatched field; an SA it finds after all (started since the lookup) is looked up once more.
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8 // tc only
+ * @param security_association: SecurityAssociation_t**
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Get_Operational_SA(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid,
+                                  SecurityAssociation_t** security_association)
+{
+    int32_t status = sa_if->sa_get_operational_sa_from_gvcid(tfvn, scid, vcid, mapid, security_association);
+
+    if ((status != CRYPTO_LIB_ERR_NO_OPERATIONAL_SA) || (sa_if->sa_diagnose_gvcid == NULL))
+    {
+        return status;
+    }
+    status = sa_if->sa_diagnose_gvcid(tfvn, scid, vcid, mapid);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_if->sa_get_operational_sa_from_gvcid(tfvn, scid, vcid, mapid, security_association);
+    }
+    return status;
+}
+
 /**
  * @brief Function: Crypto_Free_Managed_Parameters
  * Managed parameters are expected to live the duration of the program, this may not be necessary.
@@ -707,6 +715,13 @@ void Crypto_Free_Managed_Parameters(GvcidManagedParameters_t* managed_parameters
     {
         return; // Nothing to free, just return!
     }
+#ifdef CRYPTO_STATIC_CONFIG
+    if ((managed_parameters >= crypto_static_managed_parameters) &&
+        (managed_parameters < crypto_static_managed_parameters + CRYPTO_STATIC_NUM_GVCIDS))
+    {
+        return; // Generated list, not allocated
+    }
+#endif
     if (managed_parameters->next != NULL)
     {
         Crypto_Free_Managed_Parameters(managed_parameters->next);
@@ -0,0 +1,302 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/*
+** Includes
+*/
+#include "crypto.h"
+
+#include <pthread.h>
+
+/*
+** Authentication Bit Mask Pool
+** Missions configure a handful of distinct bit masks that are shared by most of their SAs. Each distinct mask is
+** stored once, zero padded to ABM_SIZE, and referenced by its 1-based pool index from SecurityAssociation_t.
+** Entries are reference counted and freed when the last SA lets go of them. A frame may still be reading a freed
+** mask through a version of its SA published before the change, so the mask itself is retired through the epoch API.
+*/
+#define ABM_POOL_NUM_BUCKETS 64
+#define ABM_POOL_INITIAL_SLOTS 8
+#define ABM_POOL_MAX_SLOTS 0xFFFF
+
+typedef struct
+{
+    uint8_t* abm;      // ABM_SIZE bytes, NULL if the slot is free
+    uint32_t hash;
+    uint32_t refcount;
+    uint16_t next;     // Next entry in the same bucket, 0 terminates the chain
+} abm_pool_entry_t;
+
+static abm_pool_entry_t* abm_pool = NULL;
+static uint32_t abm_pool_num_slots = 0;
+static uint16_t abm_pool_num_entries = 0;
+static uint32_t abm_pool_num_refs = 0;
+static uint16_t abm_pool_buckets[ABM_POOL_NUM_BUCKETS];
+// SAs of every context share the pool, and SDLS procedures on thread-safe contexts change SAs from several threads
+static pthread_mutex_t abm_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+** Local Prototypes
+*/
+static uint32_t crypto_abm_pool_hash(const uint8_t* abm);
+static int32_t crypto_abm_pool_acquire(const uint8_t* abm, uint16_t abm_len, uint16_t* abm_idx);
+static int32_t crypto_abm_pool_release(uint16_t abm_idx);
+
+/**
+ * @brief Function: crypto_abm_pool_hash
+ * FNV-1a over a zero padded ABM
+ * @param abm: const uint8_t*
+ * @return uint32_t: hash
+ **/
+static uint32_t crypto_abm_pool_hash(const uint8_t* abm)
+{
+    uint32_t hash = 2166136261u;
+    int i;
+
+    for (i = 0; i < ABM_SIZE; i++)
+    {
+        hash ^= abm[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Function: crypto_abm_pool_acquire
+ * Takes a reference on the pool entry matching abm, creating it if this is the first SA to use the mask.
+ * Called with abm_pool_lock held.
+ * @param abm: const uint8_t*
+ * @param abm_len: uint16_t
+ * @param abm_idx: uint16_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t crypto_abm_pool_acquire(const uint8_t* abm, uint16_t abm_len, uint16_t* abm_idx)
+{
+    uint8_t padded[ABM_SIZE];
+    uint32_t hash;
+    uint32_t bucket;
+    uint16_t idx;
+    uint32_t slot;
+
+    memset(padded, 0x00, ABM_SIZE);
+    memcpy(padded, abm, abm_len);
+    hash = crypto_abm_pool_hash(padded);
+    bucket = hash % ABM_POOL_NUM_BUCKETS;
+
+    for (idx = abm_pool_buckets[bucket]; idx != 0; idx = abm_pool[idx - 1].next)
+    {
+        if ((abm_pool[idx - 1].hash == hash) && (memcmp(abm_pool[idx - 1].abm, padded, ABM_SIZE) == 0))
+        {
+            abm_pool[idx - 1].refcount++;
+            abm_pool_num_refs++;
+            *abm_idx = idx;
+            return CRYPTO_LIB_SUCCESS;
+        }
+    }
+
+    // New mask, reuse a released slot or grow the pool
+    for (slot = 0; slot < abm_pool_num_slots; slot++)
+    {
+        if (abm_pool[slot].abm == NULL)
+        {
+            break;
+        }
+    }
+    if (slot == abm_pool_num_slots)
+    {
+        uint32_t num_slots = (abm_pool_num_slots == 0) ? ABM_POOL_INITIAL_SLOTS : (abm_pool_num_slots * 2);
+        abm_pool_entry_t* pool;
+
+        if (num_slots > ABM_POOL_MAX_SLOTS)
+        {
+            num_slots = ABM_POOL_MAX_SLOTS;
+        }
+        if (num_slots <= abm_pool_num_slots)
+        {
+            return CRYPTO_LIB_ERR_ABM_POOL_FULL;
+        }
+        pool = realloc(abm_pool, num_slots * sizeof(abm_pool_entry_t));
+        if (pool == NULL)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+        memset(&pool[abm_pool_num_slots], 0, (num_slots - abm_pool_num_slots) * sizeof(abm_pool_entry_t));
+        abm_pool = pool;
+        abm_pool_num_slots = num_slots;
+    }
+
+    abm_pool[slot].abm = malloc(ABM_SIZE);
+    if (abm_pool[slot].abm == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    memcpy(abm_pool[slot].abm, padded, ABM_SIZE);
+    abm_pool[slot].hash = hash;
+    abm_pool[slot].refcount = 1;
+    abm_pool[slot].next = abm_pool_buckets[bucket];
+    abm_pool_buckets[bucket] = (uint16_t)(slot + 1);
+    abm_pool_num_entries++;
+    abm_pool_num_refs++;
+    *abm_idx = (uint16_t)(slot + 1);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: crypto_abm_pool_release
+ * Drops a reference on a pool entry, retiring the mask once it is no longer used. Called with abm_pool_lock held.
+ * @param abm_idx: uint16_t
+ * @return int32: Success/Failure
+ **/
+static int32_t crypto_abm_pool_release(uint16_t abm_idx)
+{
+    abm_pool_entry_t* entry;
+    uint16_t* link;
+
+    if (abm_idx == 0)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    if ((abm_idx > abm_pool_num_slots) || (abm_pool[abm_idx - 1].abm == NULL))
+    {
+        return CRYPTO_LIB_ERR_NULL_ABM;
+    }
+
+    entry = &abm_pool[abm_idx - 1];
+    entry->refcount--;
+    abm_pool_num_refs--;
+    if (entry->refcount > 0)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+
+    for (link = &abm_pool_buckets[entry->hash % ABM_POOL_NUM_BUCKETS]; *link != abm_idx; link = &abm_pool[*link - 1].next)
+        ;
+    *link = entry->next;
+    Crypto_Epoch_Retire(entry->abm, free);
+    memset(entry, 0, sizeof(abm_pool_entry_t));
+    abm_pool_num_entries--;
+
+    if (abm_pool_num_entries == 0)
+    {
+        free(abm_pool);
+        abm_pool = NULL;
+        abm_pool_num_slots = 0;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: Crypto_SA_Set_ABM
+ * Points an SA at the pooled copy of abm, releasing the mask it previously referenced
+ * @param sa_ptr: SecurityAssociation_t*
+ * @param abm: const uint8_t*
+ * @param abm_len: uint16_t
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_SA_Set_ABM(SecurityAssociation_t* sa_ptr, const uint8_t* abm, uint16_t abm_len)
+{
+    int32_t status;
+    uint16_t abm_idx = 0;
+
+    if (sa_ptr == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_SA;
+    }
+    if (abm == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_ABM;
+    }
+    if (abm_len > ABM_SIZE)
+    {
+        return CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE;
+    }
+
+    // Acquire before releasing so an unchanged mask keeps its entry
+    pthread_mutex_lock(&abm_pool_lock);
+    status = crypto_abm_pool_acquire(abm, abm_len, &abm_idx);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        crypto_abm_pool_release(sa_ptr->abm_idx);
+        sa_ptr->abm_idx = abm_idx;
+        sa_ptr->abm = abm_pool[abm_idx - 1].abm;
+        sa_ptr->abm_len = abm_len;
+    }
+    pthread_mutex_unlock(&abm_pool_lock);
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_SA_Fill_ABM
+ * Sets an SA's ABM to abm_len bytes of value
+ * @param sa_ptr: SecurityAssociation_t*
+ * @param value: uint8_t
+ * @param abm_len: uint16_t
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_SA_Fill_ABM(SecurityAssociation_t* sa_ptr, uint8_t value, uint16_t abm_len)
+{
+    uint8_t abm[ABM_SIZE];
+
+    if (abm_len > ABM_SIZE)
+    {
+        return CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE;
+    }
+    memset(abm, value, abm_len);
+    return Crypto_SA_Set_ABM(sa_ptr, abm, abm_len);
+}
+
+/**
+ * @brief Function: Crypto_SA_Release_ABM
+ * Drops an SA's reference on its ABM, must be called before an SA holding one is freed or discarded
+ * @param sa_ptr: SecurityAssociation_t*
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_SA_Release_ABM(SecurityAssociation_t* sa_ptr)
+{
+    int32_t status;
+
+    if (sa_ptr == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_SA;
+    }
+    pthread_mutex_lock(&abm_pool_lock);
+    status = crypto_abm_pool_release(sa_ptr->abm_idx);
+    pthread_mutex_unlock(&abm_pool_lock);
+    sa_ptr->abm_idx = 0;
+    sa_ptr->abm = NULL;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Get_ABM_Pool_Stats
+ * @param stats: AbmPoolStats_t*
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Get_ABM_Pool_Stats(AbmPoolStats_t* stats)
+{
+    if (stats == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    pthread_mutex_lock(&abm_pool_lock);
+    stats->num_entries = abm_pool_num_entries;
+    stats->num_refs = abm_pool_num_refs;
+    stats->bytes_saved = (abm_pool_num_refs - abm_pool_num_entries) * ABM_SIZE;
+    pthread_mutex_unlock(&abm_pool_lock);
+    return CRYPTO_LIB_SUCCESS;
+}
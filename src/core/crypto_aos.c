@@ -20,9 +20,15 @@
  * Includes
  **/
 #include "crypto.h"
+#include "crypto_context_internal.h"
 
 #include <string.h> // memcpy/memset
 
+/* Helper functions */
+static int32_t crypto_aos_apply_security(uint8_t* pTfBuffer);
+static int32_t crypto_aos_process_security(uint8_t* p_ingest, uint16_t len_ingest, uint8_t** pp_processed_frame,
+                                           uint16_t* p_decrypted_length);
+
 /**
  * @brief Function: Crypto_AOS_ApplySecurity
  * @param ingest: uint8_t*
@@ -42,6 +48,17 @@
  * Security Header
    **/
 int32_t Crypto_AOS_ApplySecurity(uint8_t* pTfBuffer)
+{
+    int32_t status;
+
+    Crypto_Epoch_Enter();
+    status = crypto_aos_apply_security(pTfBuffer);
+    Crypto_SA_Unlock();
+    Crypto_Epoch_Exit();
+    return status;
+}
+
+static int32_t crypto_aos_apply_security(uint8_t* pTfBuffer)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
     int mac_loc = 0;
@@ -93,7 +110,7 @@ int32_t Crypto_AOS_ApplySecurity(uint8_t* pTfBuffer)
     printf("\n");
 #endif
 
-    status = sa_if->sa_get_operational_sa_from_gvcid(tfvn, scid, vcid, 0, &sa_ptr);
+    status = Crypto_Get_Operational_SA(tfvn, scid, vcid, 0, &sa_ptr);
 
     // No operational/valid SA found
     if (status != CRYPTO_LIB_SUCCESS)
@@ -104,6 +121,8 @@ int32_t Crypto_AOS_ApplySecurity(uint8_t* pTfBuffer)
         mc_if->mc_log(status);
         return status;
     }
+    // Held until Crypto_AOS_ApplySecurity returns, the IV and ARSN are advanced below
+    Crypto_SA_Lock(sa_ptr->spi);
 
     status = Crypto_Get_Managed_Parameters_For_Gvcid(tfvn, scid, vcid, gvcid_managed_parameters, &current_managed_parameters);
 
@@ -879,6 +898,17 @@ int32_t Crypto_AOS_ApplySecurity(uint8_t* pTfBuffer)
  * @return int32: Success/Failure
    **/
 int32_t Crypto_AOS_ProcessSecurity(uint8_t* p_ingest, uint16_t len_ingest, uint8_t** pp_processed_frame, uint16_t* p_decrypted_length)
+{
+    int32_t status;
+
+    Crypto_Epoch_Enter();
+    status = crypto_aos_process_security(p_ingest, len_ingest, pp_processed_frame, p_decrypted_length);
+    Crypto_Epoch_Exit();
+    return status;
+}
+
+static int32_t crypto_aos_process_security(uint8_t* p_ingest, uint16_t len_ingest, uint8_t** pp_processed_frame,
+                                           uint16_t* p_decrypted_length)
 {
     // Local Variables
     int32_t status = CRYPTO_LIB_SUCCESS;
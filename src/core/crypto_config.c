@@ -19,29 +19,20 @@
 /*
 ** Includes
 */
+#include <pthread.h>
 #include <string.h>
 #include "crypto.h"
-
-/*
-** Global Variables
-*/
-CryptographyInterface cryptography_if = NULL;
-KeyInterface key_if = NULL;
-McInterface mc_if = NULL;
-SaInterface sa_if = NULL;
-
-SadbMariaDBConfig_t* sa_mariadb_config = NULL;
-
-CryptoConfig_t crypto_config;
-
-CryptographyKmcCryptoServiceConfig_t* cryptography_kmc_crypto_config = NULL;
-CamConfig_t* cam_config = NULL;
-
-GvcidManagedParameters_t* gvcid_managed_parameters = NULL;
-GvcidManagedParameters_t* current_managed_parameters = NULL;
+#include "crypto_context_internal.h"
+#ifdef CRYPTO_STATIC_CONFIG
+#include "crypto_static_tables.h"
+#endif
 
 // Free all configuration structs
 int32_t crypto_free_config_structs(void);
+static void crypto_calc_crc_init_table_once(void);
+static uint8_t crypto_thread_safe_backends(void);
+
+static pthread_once_t crypto_crc_table_once = PTHREAD_ONCE_INIT;
 
 /*
 ** Initialization Functions
@@ -140,6 +131,29 @@ int32_t Crypto_Init_With_Configs(CryptoConfig_t* crypto_config_p, GvcidManagedPa
     return status;
 }
 
+/**
+ * @brief Function: Crypto_Init_Static_Config
+ * Initializes from the configuration and managed parameters generated by the crypto_static_config target, in place
+ * of the Crypto_Config calls. The generated managed parameter list is used where it is, in read-only memory.
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Init_Static_Config(void)
+{
+#ifdef CRYPTO_STATIC_CONFIG
+    if ((crypto_static_crypto_config.init_status != INITIALIZED) || (CRYPTO_STATIC_NUM_GVCIDS == 0))
+    {
+        return CRYPTO_STATIC_CONFIG_NOT_AVAILABLE;
+    }
+    crypto_config = crypto_static_crypto_config;
+    current_managed_parameters = NULL;
+    Crypto_Free_Managed_Parameters(gvcid_managed_parameters);
+    gvcid_managed_parameters = (GvcidManagedParameters_t*)crypto_static_managed_parameters;
+    return Crypto_Init();
+#else
+    return CRYPTO_STATIC_CONFIG_NOT_AVAILABLE;
+#endif
+}
+
 /**
  * @brief Function Crypto_Init
  * Initializes libgcrypt, Security Associations
@@ -147,6 +161,7 @@ int32_t Crypto_Init_With_Configs(CryptoConfig_t* crypto_config_p, GvcidManagedPa
 int32_t Crypto_Init(void)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
+    int32_t sa_shared;
 
     if (crypto_config.init_status == UNITIALIZED)
     {
@@ -160,6 +175,12 @@ int32_t Crypto_Init(void)
         printf(KRED "ERROR: CryptoLib  Managed Parameters must be configured before intializing!\n" RESET);
         return status; // No Managed Parameter configuration set -- return!
     }
+    if ((crypto_config.thread_safe == CRYPTO_THREAD_SAFE_TRUE) && !crypto_thread_safe_backends())
+    {
+        status = CRYPTO_THREAD_SAFETY_NOT_SUPPORTED;
+        printf(KRED "ERROR: CryptoLib thread safety needs backends that can run frames on several threads!\n" RESET);
+        return status;
+    }
 
 // #ifdef TC_DEBUG
     // Crypto_mpPrint(gvcid_managed_parameters, 1);
@@ -178,8 +199,15 @@ int32_t Crypto_Init(void)
     {
         key_if = get_key_interface_kmc();
     }
-    key_if->key_init();
-    // TODO: Check and return status on error
+    // A backend that another context already runs is joined as it is
+    if (Crypto_Context_Acquire_Backend(CRYPTO_BACKEND_KEY, key_if) == 0)
+    {
+        status = key_if->key_init();
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            return status;
+        }
+    }
 
     /* MC Interface */
     if (crypto_config.mc_type == MC_TYPE_CUSTOM)
@@ -194,7 +222,10 @@ int32_t Crypto_Init(void)
     {
         mc_if = get_mc_interface_internal();
     }
-    mc_if->mc_initialize();
+    if (Crypto_Context_Acquire_Backend(CRYPTO_BACKEND_MC, mc_if) == 0)
+    {
+        mc_if->mc_initialize();
+    }
     // TODO: Check and return status on error
 
     /* SA Interface */
@@ -217,6 +248,36 @@ int32_t Crypto_Init(void)
         }
         sa_if = get_sa_interface_mariadb();
     }
+    else if (crypto_config.sa_type == SA_TYPE_MMAP)
+    {
+        if (sa_mmap_config == NULL)
+        {
+            status = CRYPTO_MMAP_CONFIGURATION_NOT_COMPLETE;
+            printf(KRED "ERROR: CryptoLib memory-mapped SA store must be configured before intializing!\n" RESET);
+            return status;
+        }
+        sa_if = get_sa_interface_mmap();
+    }
+    else if (crypto_config.sa_type == SA_TYPE_SQLITE)
+    {
+        if (sa_sqlite_config == NULL)
+        {
+            status = CRYPTO_SQLITE_CONFIGURATION_NOT_COMPLETE;
+            printf(KRED "ERROR: CryptoLib SQLite must be configured before intializing!\n" RESET);
+            return status;
+        }
+        sa_if = get_sa_interface_sqlite();
+    }
+    else if (crypto_config.sa_type == SA_TYPE_SHM)
+    {
+        if (sa_shm_config == NULL)
+        {
+            status = CRYPTO_SHM_CONFIGURATION_NOT_COMPLETE;
+            printf(KRED "ERROR: CryptoLib shared-memory SA table must be configured before intializing!\n" RESET);
+            return status;
+        }
+        sa_if = get_sa_interface_shm();
+    }
     else
     {
         status = SADB_INVALID_SADB_TYPE;
@@ -244,26 +305,36 @@ int32_t Crypto_Init(void)
         return status;
     }
 
-    // Initialize the cryptography library.
-    status = cryptography_if->cryptography_init();
-    if(status != CRYPTO_LIB_SUCCESS){
-        fprintf(stderr, "Fatal Error: Unable to initialize Cryptography Interface.\n");
-        return status;
-    }
+    if (Crypto_Context_Acquire_Backend(CRYPTO_BACKEND_CRYPTOGRAPHY, cryptography_if) == 0)
+    {
+        // Initialize the cryptography library.
+        status = cryptography_if->cryptography_init();
+        if(status != CRYPTO_LIB_SUCCESS){
+            fprintf(stderr, "Fatal Error: Unable to initialize Cryptography Interface.\n");
+            return status;
+        }
 
-    // Configure the cryptography library.
-    status = cryptography_if->cryptography_config();
+        // Configure the cryptography library.
+        status = cryptography_if->cryptography_config();
 
-    if(status != CRYPTO_LIB_SUCCESS){
-        fprintf(stderr, "Fatal Error: Unable to configure Cryptography Interface.\n");
-        return status;
+        if(status != CRYPTO_LIB_SUCCESS){
+            fprintf(stderr, "Fatal Error: Unable to configure Cryptography Interface.\n");
+            return status;
+        }
     }
 
     // Init Security Associations
-    status = sa_if->sa_init();
+    sa_shared = Crypto_Context_Acquire_Backend(CRYPTO_BACKEND_SA, sa_if);
+    if (sa_shared == 0)
+    {
+        status = sa_if->sa_init();
+    }
     if (status==CRYPTO_LIB_SUCCESS)
     {
-        status = sa_if->sa_config();
+        if (sa_shared == 0)
+        {
+            status = sa_if->sa_config();
+        }
 
         Crypto_Local_Init();
         Crypto_Local_Config();
@@ -297,8 +368,6 @@ int32_t Crypto_Shutdown(void)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
 
-    crypto_free_config_structs();
-
     current_managed_parameters = NULL;
     if (gvcid_managed_parameters != NULL)
     {
@@ -306,28 +375,53 @@ int32_t Crypto_Shutdown(void)
         gvcid_managed_parameters = NULL;
     }
 
-    if(key_if != NULL)
+    // Backends other contexts still hold stay up
+    if (key_if != NULL)
     {
-        key_if->key_shutdown();
+        if (Crypto_Context_Release_Backend(CRYPTO_BACKEND_KEY) == 0)
+        {
+            key_if->key_shutdown();
+        }
+        key_if = NULL;
     }
 
-    if(mc_if != NULL)
+    if (mc_if != NULL)
     {
-        mc_if->mc_shutdown();
+        if (Crypto_Context_Release_Backend(CRYPTO_BACKEND_MC) == 0)
+        {
+            mc_if->mc_shutdown();
+        }
+        mc_if = NULL;
     }
 
     if (sa_if != NULL)    
     {
-        sa_if->sa_close();
+        if (Crypto_Context_Release_Backend(CRYPTO_BACKEND_SA) == 0)
+        {
+            sa_if->sa_close();
+        }
         sa_if = NULL;
     }
 
     if (cryptography_if != NULL)
     {
-        cryptography_if->cryptography_shutdown();
+        if (Crypto_Context_Release_Backend(CRYPTO_BACKEND_CRYPTOGRAPHY) == 0)
+        {
+            cryptography_if->cryptography_shutdown();
+        }
         cryptography_if = NULL;
     }
 
+    // No frames are in flight any more, free the SA and key versions still waiting on readers
+    if (!Crypto_Context_Backends_In_Use())
+    {
+        Crypto_Snapshot_Release();
+        Crypto_Epoch_Shutdown();
+    }
+
+    // Interfaces may still reference configuration (e.g. CAM refresh), free it last
+    crypto_free_config_structs();
+
     return status;
 }
 
@@ -367,6 +461,104 @@ int32_t Crypto_Config_CryptoLib(uint8_t key_type, uint8_t mc_type, uint8_t sa_ty
     crypto_config.crypto_check_fecf = crypto_check_fecf;
     crypto_config.vcid_bitmask = vcid_bitmask;
     crypto_config.crypto_increment_nontransmitted_iv = crypto_increment_nontransmitted_iv;
+    crypto_config.sa_capacity = 0;
+    crypto_config.key_capacity = 0;
+    crypto_config.thread_safe = CRYPTO_THREAD_SAFE_FALSE;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Sa_Capacity
+ * Sets how many SAs the in-memory SA interface may hold. Must follow Crypto_Config_CryptoLib.
+ * @param sa_capacity: uint16, 0 selects NUM_SA
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Config_Sa_Capacity(uint16_t sa_capacity)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    if (crypto_config.init_status == UNITIALIZED)
+    {
+        status = CRYPTO_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    crypto_config.sa_capacity = sa_capacity;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Key_Capacity
+ * Sets how many key IDs the internal key interface holds, IDs from key_capacity up are not available. Must follow
+ * Crypto_Config_CryptoLib.
+ * @param key_capacity: uint16, 0 selects NUM_KEYS
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Config_Key_Capacity(uint16_t key_capacity)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    if (crypto_config.init_status == UNITIALIZED)
+    {
+        status = CRYPTO_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    if (key_capacity > NUM_KEYS)
+    {
+        status = CRYPTO_LIB_ERR_KEY_ID_ERROR;
+        return status;
+    }
+    crypto_config.key_capacity = key_capacity;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Thread_Safety
+ * Lets frames run on several threads at once, each thread with its own context. A frame that advances an SA's IV or
+ * ARSN then holds that SA's lock until it returns, so frames on the same SA take turns while frames on different SAs
+ * run side by side. Set it in every context that runs frames, and only with backends that can be called from several
+ * threads at once: in-memory, memory-mapped or custom SAs, internal or custom keys, libgcrypt or wolfSSL. Crypto_Init
+ * refuses the others. Must follow Crypto_Config_CryptoLib.
+ * @param thread_safe: uint8, CRYPTO_THREAD_SAFE_TRUE or CRYPTO_THREAD_SAFE_FALSE
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Config_Thread_Safety(uint8_t thread_safe)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    if (crypto_config.init_status == UNITIALIZED)
+    {
+        status = CRYPTO_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    crypto_config.thread_safe = thread_safe;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Key_Store
+ * Has the internal key interface take its keys from an encrypted key store file, see Crypto_Key_Store_Save
+ * @param key_store_path: char*
+ * @param kek: uint8_t*, key encryption key the store was saved with
+ * @param kek_len: uint32_t, KEY_STORE_KEK_SIZE
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Config_Key_Store(char* key_store_path, uint8_t* kek, uint32_t kek_len)
+{
+    int32_t status = CRYPTO_LIB_ERROR;
+    if ((key_store_path == NULL) || (kek == NULL) || (kek_len != KEY_STORE_KEK_SIZE))
+    {
+        return CRYPTO_KEY_STORE_CONFIGURATION_NOT_COMPLETE;
+    }
+    if (key_store_config != NULL)
+    {
+        free(key_store_config->key_store_path);
+        memset(key_store_config, 0, KEY_STORE_CONFIG_SIZE);
+        free(key_store_config);
+    }
+    key_store_config = (KeyStoreConfig_t*)calloc(1, KEY_STORE_CONFIG_SIZE);
+    if (key_store_config != NULL)
+    {
+        key_store_config->key_store_path = crypto_deep_copy_string(key_store_path);
+        memcpy(key_store_config->key_store_kek, kek, KEY_STORE_KEK_SIZE);
+        status = CRYPTO_LIB_SUCCESS;
+    }
     return status;
 }
 
@@ -408,6 +600,162 @@ int32_t Crypto_Config_MariaDB(char* mysql_hostname, char* mysql_database, uint16
     return status;
 }
 
+/**
+ * @brief Function: Crypto_Config_MariaDB_Cache
+ * Serves SAs from a read-through cache, dropped whenever the sadb_version table changes.
+ * @param sa_cache_enabled: uint8_t
+ * @param sa_cache_poll_interval_ms: uint32_t, 0 checks sadb_version on every lookup
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Config_MariaDB_Cache(uint8_t sa_cache_enabled, uint32_t sa_cache_poll_interval_ms)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if(sa_mariadb_config == NULL)
+    {
+        status = CRYPTO_MARIADB_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    sa_mariadb_config->sa_cache_enabled = sa_cache_enabled;
+    sa_mariadb_config->sa_cache_poll_interval_ms = sa_cache_poll_interval_ms;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_MariaDB_Write_Behind
+ * Queues IV/ARSN saves per SPI and lets a background writer commit them in batches.
+ * @param write_behind_enabled: uint8_t
+ * @param flush_frames: uint32_t, queued saves that trigger a flush, 0 for none
+ * @param flush_interval_ms: uint32_t, age of the oldest queued save that triggers a flush
+ * @param max_staleness_ms: uint32_t, age at which saves block until the writer catches up, 0 for no limit
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Config_MariaDB_Write_Behind(uint8_t write_behind_enabled, uint32_t flush_frames,
+                                           uint32_t flush_interval_ms, uint32_t max_staleness_ms)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if(sa_mariadb_config == NULL)
+    {
+        status = CRYPTO_MARIADB_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    sa_mariadb_config->write_behind_enabled = write_behind_enabled;
+    sa_mariadb_config->write_behind_flush_frames = flush_frames;
+    sa_mariadb_config->write_behind_flush_interval_ms = flush_interval_ms;
+    sa_mariadb_config->write_behind_max_staleness_ms = max_staleness_ms;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_MariaDB_Pool
+ * Sizes the pool of connections the MariaDB SA backend shares between threads.
+ * @param pool_size: uint8_t, 0 for a single connection
+ * @param health_check_interval_ms: uint32_t, idle time after which a connection is pinged before use, 0 never pings
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Config_MariaDB_Pool(uint8_t pool_size, uint32_t health_check_interval_ms)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if(sa_mariadb_config == NULL)
+    {
+        status = CRYPTO_MARIADB_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    sa_mariadb_config->pool_size = pool_size;
+    sa_mariadb_config->pool_health_check_interval_ms = health_check_interval_ms;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Sa_Mmap
+ * Configures the memory-mapped SA store used by SA_TYPE_MMAP
+ * @param mmap_path: char*
+ * @param checkpoint_interval: uint32_t, at least 1; bounds how far IVs and ARSNs run ahead of the last checkpoint
+ * @param checkpoint_interval_ms: uint32_t, 0 to checkpoint on the save count alone
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Config_Sa_Mmap(char* mmap_path, uint32_t checkpoint_interval, uint32_t checkpoint_interval_ms)
+{
+    int32_t status = CRYPTO_LIB_ERROR;
+    if ((mmap_path == NULL) || (checkpoint_interval == 0))
+    {
+        return CRYPTO_MMAP_CONFIGURATION_NOT_COMPLETE;
+    }
+    if (sa_mmap_config != NULL)
+    {
+        free(sa_mmap_config->mmap_path);
+        free(sa_mmap_config);
+    }
+    sa_mmap_config = (SadbMmapConfig_t*)calloc(1, SADB_MMAP_CONFIG_SIZE);
+    if (sa_mmap_config != NULL)
+    {
+        sa_mmap_config->mmap_path = crypto_deep_copy_string(mmap_path);
+        sa_mmap_config->checkpoint_interval = checkpoint_interval;
+        sa_mmap_config->checkpoint_interval_ms = checkpoint_interval_ms;
+        status = CRYPTO_LIB_SUCCESS;
+    }
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Sa_Sqlite
+ * Configures the SQLite database used by SA_TYPE_SQLITE
+ * @param sqlite_path: char*
+ * @param sqlite_synchronous: uint8_t
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Config_Sa_Sqlite(char* sqlite_path, uint8_t sqlite_synchronous)
+{
+    int32_t status = CRYPTO_LIB_ERROR;
+    if (sqlite_path == NULL)
+    {
+        return CRYPTO_SQLITE_CONFIGURATION_NOT_COMPLETE;
+    }
+    if (sa_sqlite_config != NULL)
+    {
+        free(sa_sqlite_config->sqlite_path);
+        free(sa_sqlite_config);
+    }
+    sa_sqlite_config = (SadbSqliteConfig_t*)calloc(1, SADB_SQLITE_CONFIG_SIZE);
+    if (sa_sqlite_config != NULL)
+    {
+        sa_sqlite_config->sqlite_path = crypto_deep_copy_string(sqlite_path);
+        sa_sqlite_config->sqlite_synchronous = sqlite_synchronous;
+        status = CRYPTO_LIB_SUCCESS;
+    }
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Sa_Shm
+ * Configures the POSIX shared memory object used by SA_TYPE_SHM. The object outlives the processes using it,
+ * remove it with shm_unlink() once no process needs the SA state.
+ * @param shm_name: char*
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Config_Sa_Shm(char* shm_name)
+{
+    int32_t status = CRYPTO_LIB_ERROR;
+    if (shm_name == NULL)
+    {
+        return CRYPTO_SHM_CONFIGURATION_NOT_COMPLETE;
+    }
+    if (sa_shm_config != NULL)
+    {
+        free(sa_shm_config->shm_name);
+        free(sa_shm_config);
+    }
+    sa_shm_config = (SadbShmConfig_t*)calloc(1, SADB_SHM_CONFIG_SIZE);
+    if (sa_shm_config != NULL)
+    {
+        sa_shm_config->shm_name = crypto_deep_copy_string(shm_name);
+        status = CRYPTO_LIB_SUCCESS;
+    }
+    return status;
+}
+
 int32_t Crypto_Config_Kmc_Crypto_Service(char* protocol, char* kmc_crypto_hostname, uint16_t kmc_crypto_port,
                                                 char* kmc_crypto_app, char* kmc_tls_ca_bundle, char* kmc_tls_ca_path,
                                                 uint8_t kmc_ignore_ssl_hostname_validation, char* mtls_client_cert_path,
@@ -437,6 +785,68 @@ int32_t Crypto_Config_Kmc_Crypto_Service(char* protocol, char* kmc_crypto_hostna
     return status;
 }
 
+/**
+ * @brief Function: Crypto_Config_Kmc_Crypto_Service_Add_Endpoint
+ * Adds a replica of the configured KMC Crypto Service. Replicas share the protocol, app URI and TLS
+ * settings of the primary endpoint; requests are routed to whichever endpoint is currently fastest.
+ * @param kmc_crypto_hostname: char*
+ * @param kmc_crypto_port: uint16_t
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Config_Kmc_Crypto_Service_Add_Endpoint(char* kmc_crypto_hostname, uint16_t kmc_crypto_port)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    KmcCryptoEndpoint_t** tail = NULL;
+    uint16_t num_endpoints = 1;
+
+    if(cryptography_kmc_crypto_config == NULL)
+    {
+        status = CRYPTOGRAPHY_KMC_CRYPTO_SERVICE_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    tail = &cryptography_kmc_crypto_config->replica_endpoints;
+    while(*tail != NULL)
+    {
+        tail = &(*tail)->next;
+        num_endpoints++;
+    }
+    if(num_endpoints >= UINT8_MAX)
+    {
+        status = CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_ENDPOINT_OUT_OF_RANGE;
+        return status;
+    }
+    *tail = (KmcCryptoEndpoint_t*) calloc(1, KMC_CRYPTO_ENDPOINT_SIZE);
+    if(*tail == NULL)
+    {
+        status = CRYPTO_LIB_ERR_NULL_BUFFER;
+        return status;
+    }
+    (*tail)->hostname = crypto_deep_copy_string(kmc_crypto_hostname);
+    (*tail)->port = kmc_crypto_port;
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Config_Kmc_Crypto_Service_Hedging
+ * Enables hedged decrypt and ICV verify requests when replica endpoints are configured.
+ * @param hedge_idempotent_requests: uint8_t
+ * @param hedge_min_delay_ms: uint32_t
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Config_Kmc_Crypto_Service_Hedging(uint8_t hedge_idempotent_requests, uint32_t hedge_min_delay_ms)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if(cryptography_kmc_crypto_config == NULL)
+    {
+        status = CRYPTOGRAPHY_KMC_CRYPTO_SERVICE_CONFIGURATION_NOT_COMPLETE;
+        return status;
+    }
+    cryptography_kmc_crypto_config->hedge_idempotent_requests = hedge_idempotent_requests;
+    cryptography_kmc_crypto_config->hedge_min_delay_ms = hedge_min_delay_ms;
+    return status;
+}
+
 /**
  * @brief Function: Crypto_Config_Cam
  * @param cam_enabled: uint8_t
@@ -460,6 +870,35 @@ int32_t Crypto_Config_Cam(uint8_t cam_enabled, char* cookie_file_path, char* key
     return status;
 }
 
+#ifdef CRYPTO_STATIC_CONFIG
+/**
+ * @brief Function: crypto_config_copy_static_managed_parameters
+ * Replaces the generated managed parameter list with a heap copy that can be appended to
+ * @return int32: Success/Failure
+ **/
+static int32_t crypto_config_copy_static_managed_parameters(void)
+{
+    GvcidManagedParameters_t* copy = NULL;
+    GvcidManagedParameters_t** tail = &copy;
+    const GvcidManagedParameters_t* mp;
+
+    for (mp = crypto_static_managed_parameters; mp != NULL; mp = mp->next)
+    {
+        *tail = (GvcidManagedParameters_t*)malloc(GVCID_MANAGED_PARAMETERS_SIZE);
+        if (*tail == NULL)
+        {
+            Crypto_Free_Managed_Parameters(copy);
+            return CRYPTO_LIB_ERR_NULL_BUFFER;
+        }
+        **tail = *mp;
+        (*tail)->next = NULL;
+        tail = &(*tail)->next;
+    }
+    gvcid_managed_parameters = copy;
+    return CRYPTO_LIB_SUCCESS;
+}
+#endif
+
 /**
  * @brief Function: Crypto_Config_Add_Gvcid_Managed_Parameter
  * @param tfvn: uint8
@@ -477,6 +916,17 @@ int32_t Crypto_Config_Add_Gvcid_Managed_Parameter(uint8_t tfvn, uint16_t scid, u
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
 
+#ifdef CRYPTO_STATIC_CONFIG
+    if (gvcid_managed_parameters == crypto_static_managed_parameters)
+    {
+        status = crypto_config_copy_static_managed_parameters();
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            return status;
+        }
+    }
+#endif
+
     if (gvcid_managed_parameters == NULL)
     { // case: Global Root Node not Set
         gvcid_managed_parameters = (GvcidManagedParameters_t* )calloc(1, GVCID_MANAGED_PARAMETERS_SIZE);
@@ -531,6 +981,31 @@ int32_t crypto_free_config_structs(void)
         free(sa_mariadb_config);
         sa_mariadb_config=NULL;
     }
+    if(sa_mmap_config != NULL)
+    {
+        free(sa_mmap_config->mmap_path);
+        free(sa_mmap_config);
+        sa_mmap_config=NULL;
+    }
+    if(key_store_config != NULL)
+    {
+        free(key_store_config->key_store_path);
+        memset(key_store_config, 0, KEY_STORE_CONFIG_SIZE);
+        free(key_store_config);
+        key_store_config=NULL;
+    }
+    if(sa_sqlite_config != NULL)
+    {
+        free(sa_sqlite_config->sqlite_path);
+        free(sa_sqlite_config);
+        sa_sqlite_config=NULL;
+    }
+    if(sa_shm_config != NULL)
+    {
+        free(sa_shm_config->shm_name);
+        free(sa_shm_config);
+        sa_shm_config=NULL;
+    }
     if(cryptography_kmc_crypto_config != NULL)
     {
         free(cryptography_kmc_crypto_config->kmc_crypto_hostname);
@@ -543,6 +1018,14 @@ int32_t crypto_free_config_structs(void)
         free(cryptography_kmc_crypto_config->mtls_ca_bundle);
         free(cryptography_kmc_crypto_config->mtls_ca_path);
         free(cryptography_kmc_crypto_config->mtls_issuer_cert);
+        KmcCryptoEndpoint_t* replica = cryptography_kmc_crypto_config->replica_endpoints;
+        while(replica != NULL)
+        {
+            KmcCryptoEndpoint_t* next = replica->next;
+            free(replica->hostname);
+            free(replica);
+            replica = next;
+        }
         free(cryptography_kmc_crypto_config);
         cryptography_kmc_crypto_config=NULL;
     }
@@ -628,19 +1111,19 @@ void Crypto_Local_Config(void)
     log_summary.rs = LOG_SIZE;
     // Add a two messages to the log
     log_summary.rs--;
-    mc_log.blk[log_count].emt = STARTUP;
-    mc_log.blk[log_count].emv[0] = 0x4E;
-    mc_log.blk[log_count].emv[1] = 0x41;
-    mc_log.blk[log_count].emv[2] = 0x53;
-    mc_log.blk[log_count].emv[3] = 0x41;
-    mc_log.blk[log_count++].em_len = 4;
+    crypto_context_current->mc_log->blk[log_count].emt = STARTUP;
+    crypto_context_current->mc_log->blk[log_count].emv[0] = 0x4E;
+    crypto_context_current->mc_log->blk[log_count].emv[1] = 0x41;
+    crypto_context_current->mc_log->blk[log_count].emv[2] = 0x53;
+    crypto_context_current->mc_log->blk[log_count].emv[3] = 0x41;
+    crypto_context_current->mc_log->blk[log_count++].em_len = 4;
     log_summary.rs--;
-    mc_log.blk[log_count].emt = STARTUP;
-    mc_log.blk[log_count].emv[0] = 0x4E;
-    mc_log.blk[log_count].emv[1] = 0x41;
-    mc_log.blk[log_count].emv[2] = 0x53;
-    mc_log.blk[log_count].emv[3] = 0x41;
-    mc_log.blk[log_count++].em_len = 4;
+    crypto_context_current->mc_log->blk[log_count].emt = STARTUP;
+    crypto_context_current->mc_log->blk[log_count].emv[0] = 0x4E;
+    crypto_context_current->mc_log->blk[log_count].emv[1] = 0x41;
+    crypto_context_current->mc_log->blk[log_count].emv[2] = 0x53;
+    crypto_context_current->mc_log->blk[log_count].emv[3] = 0x41;
+    crypto_context_current->mc_log->blk[log_count++].em_len = 4;
 
 }
 
@@ -724,6 +1207,15 @@ void Crypto_Local_Init(void)
  * Initialize CRC Table
  **/
 void Crypto_Calc_CRC_Init_Table(void)
+{
+    pthread_once(&crypto_crc_table_once, crypto_calc_crc_init_table_once);
+}
+
+/**
+ * @brief Function: crypto_calc_crc_init_table_once
+ * Fills the CRC tables, shared by all contexts
+ **/
+static void crypto_calc_crc_init_table_once(void)
 {
     uint16_t val;
     uint32_t poly = 0xEDB88320;
@@ -767,3 +1259,23 @@ void Crypto_Calc_CRC_Init_Table(void)
         // printf("crc16Table[%d] = 0x%04x \n", i, crc16Table[i]);
     }
 }
+
+/**
+ * @brief Function: crypto_thread_safe_backends
+ * The SA backends that hand frames a copy of the SA, and the KMC backends that share one HTTP handle, cannot run
+ * frames from several threads at once
+ * @return uint8: CRYPTO_TRUE if every configured backend can
+ **/
+static uint8_t crypto_thread_safe_backends(void)
+{
+    if ((crypto_config.sa_type != SA_TYPE_INMEMORY) && (crypto_config.sa_type != SA_TYPE_MMAP) &&
+        (crypto_config.sa_type != SA_TYPE_CUSTOM))
+    {
+        return CRYPTO_FALSE;
+    }
+    if ((crypto_config.key_type == KEY_TYPE_KMC) || (crypto_config.cryptography_type == CRYPTOGRAPHY_TYPE_KMCCRYPTO))
+    {
+        return CRYPTO_FALSE;
+    }
+    return CRYPTO_TRUE;
+}
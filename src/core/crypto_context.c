@@ -0,0 +1,713 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/*
+** Includes
+*/
+#include "crypto.h"
+
+#include <pthread.h>
+
+/*
+** Crypto Contexts
+** Each thread runs the library against its current context, which starts out as the default context. The _Ctx
+** functions make ctx current for the length of the call, so a thread may drive several contexts, and several threads
+** may each drive their own context at the same time. One context must not be used from two threads at once.
+**
+** The backend behind each interface is shared by every context that selects it. The first context to select a
+** backend brings it up in Crypto_Init and the last one to let go of it shuts it down in Crypto_Shutdown; contexts in
+** between join the backend as it is. Backends that run threads of their own (CAM token refresh, MariaDB
+** write-behind) run them under the context that brought them up, so that context is shut down last.
+*/
+#define CRYPTO_CONTEXT_MAX_BACKENDS 16
+
+typedef struct
+{
+    void* interface; // Interface struct returned by the backend's get_*_interface function
+    uint32_t users;  // Contexts holding the backend
+} crypto_context_backend_t;
+
+/*
+** Global Variables
+*/
+// The default context's state, see crypto_context_default
+// Data stores used in multiple components
+// crypto_key_t ak_ring[NUM_KEYS];
+CCSDS_t sdls_frame;
+// TM_t tm_frame;
+uint8_t tm_frame[1786];                    // Testing
+TM_FramePrimaryHeader_t tm_frame_pri_hdr;  // Used to reduce bit math duplication
+TM_FrameSecurityHeader_t tm_frame_sec_hdr; // Used to reduce bit math duplication
+// AOS_t aos_frame
+uint8_t aos_frame[1786];                    // Testing
+AOS_FramePrimaryHeader_t aos_frame_pri_hdr;  // Used to reduce bit math duplication
+AOS_FrameSecurityHeader_t aos_frame_sec_hdr; // Used to reduce bit math duplication
+// Configuration structs
+CryptographyInterface cryptography_if = NULL;
+KeyInterface key_if = NULL;
+McInterface mc_if = NULL;
+SaInterface sa_if = NULL;
+SadbMariaDBConfig_t* sa_mariadb_config = NULL;
+SadbMmapConfig_t* sa_mmap_config = NULL;
+KeyStoreConfig_t* key_store_config = NULL;
+SadbSqliteConfig_t* sa_sqlite_config = NULL;
+SadbShmConfig_t* sa_shm_config = NULL;
+CryptoConfig_t crypto_config;
+CryptographyKmcCryptoServiceConfig_t* cryptography_kmc_crypto_config = NULL;
+CamConfig_t* cam_config = NULL;
+GvcidManagedParameters_t* gvcid_managed_parameters = NULL;
+GvcidManagedParameters_t* current_managed_parameters = NULL;
+// OCF
+uint8_t ocf = 0;
+SDLS_FSR_t report;
+Telemetry_Frame_Clcw_t clcw;
+// Flags
+SDLS_MC_LOG_RPLY_t log_summary;
+SDLS_MC_DUMP_BLK_RPLY_t mc_log;
+uint8_t log_count = 0;
+uint16_t tm_offset = 0;
+// ESA Testing - 0 = disabled, 1 = enabled
+uint8_t badSPI = 0;
+uint8_t badIV = 0;
+uint8_t badMAC = 0;
+uint8_t badFECF = 0;
+
+CryptoContext_t crypto_context_default = {
+    .crypto_config = &crypto_config,
+    .sa_mariadb_config = &sa_mariadb_config,
+    .sa_mmap_config = &sa_mmap_config,
+    .key_store_config = &key_store_config,
+    .sa_sqlite_config = &sa_sqlite_config,
+    .sa_shm_config = &sa_shm_config,
+    .cryptography_kmc_crypto_config = &cryptography_kmc_crypto_config,
+    .cam_config = &cam_config,
+    .gvcid_managed_parameters = &gvcid_managed_parameters,
+    .current_managed_parameters = &current_managed_parameters,
+    .key_if = &key_if,
+    .mc_if = &mc_if,
+    .sa_if = &sa_if,
+    .cryptography_if = &cryptography_if,
+    .sdls_frame = &sdls_frame,
+    .tm_frame = &tm_frame,
+    .tm_frame_pri_hdr = &tm_frame_pri_hdr,
+    .tm_frame_sec_hdr = &tm_frame_sec_hdr,
+    .aos_frame = &aos_frame,
+    .aos_frame_pri_hdr = &aos_frame_pri_hdr,
+    .aos_frame_sec_hdr = &aos_frame_sec_hdr,
+    .report = &report,
+    .clcw = &clcw,
+    .log_summary = &log_summary,
+    .mc_log = &mc_log,
+    .log_count = &log_count,
+    .tm_offset = &tm_offset,
+    .badSPI = &badSPI,
+    .badIV = &badIV,
+    .badMAC = &badMAC,
+    .badFECF = &badFECF,
+};
+__thread CryptoContext_t* crypto_context_current = &crypto_context_default;
+
+static crypto_context_backend_t crypto_context_backends[CRYPTO_CONTEXT_MAX_BACKENDS];
+static pthread_mutex_t crypto_context_backends_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+** Local Prototypes
+*/
+static crypto_context_backend_t* crypto_context_backend_find(void* interface, uint8_t create);
+
+/**
+ * @brief Function: Crypto_Context_Create
+ * Allocates an unconfigured context. Configure and initialize it through the _Ctx functions.
+ * @return CryptoContext_t*: NULL on allocation failure
+ **/
+CryptoContext_t* Crypto_Context_Create(void)
+{
+    CryptoContext_t* ctx = (CryptoContext_t*)calloc(1, sizeof(CryptoContext_t));
+
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+    ctx->crypto_config = &ctx->state.crypto_config;
+    ctx->sa_mariadb_config = &ctx->state.sa_mariadb_config;
+    ctx->sa_mmap_config = &ctx->state.sa_mmap_config;
+    ctx->key_store_config = &ctx->state.key_store_config;
+    ctx->sa_sqlite_config = &ctx->state.sa_sqlite_config;
+    ctx->sa_shm_config = &ctx->state.sa_shm_config;
+    ctx->cryptography_kmc_crypto_config = &ctx->state.cryptography_kmc_crypto_config;
+    ctx->cam_config = &ctx->state.cam_config;
+    ctx->gvcid_managed_parameters = &ctx->state.gvcid_managed_parameters;
+    ctx->current_managed_parameters = &ctx->state.current_managed_parameters;
+    ctx->key_if = &ctx->state.key_if;
+    ctx->mc_if = &ctx->state.mc_if;
+    ctx->sa_if = &ctx->state.sa_if;
+    ctx->cryptography_if = &ctx->state.cryptography_if;
+    ctx->sdls_frame = &ctx->state.sdls_frame;
+    ctx->tm_frame = &ctx->state.tm_frame;
+    ctx->tm_frame_pri_hdr = &ctx->state.tm_frame_pri_hdr;
+    ctx->tm_frame_sec_hdr = &ctx->state.tm_frame_sec_hdr;
+    ctx->aos_frame = &ctx->state.aos_frame;
+    ctx->aos_frame_pri_hdr = &ctx->state.aos_frame_pri_hdr;
+    ctx->aos_frame_sec_hdr = &ctx->state.aos_frame_sec_hdr;
+    ctx->report = &ctx->state.report;
+    ctx->clcw = &ctx->state.clcw;
+    ctx->log_summary = &ctx->state.log_summary;
+    ctx->mc_log = &ctx->state.mc_log;
+    ctx->log_count = &ctx->state.log_count;
+    ctx->tm_offset = &ctx->state.tm_offset;
+    ctx->badSPI = &ctx->state.badSPI;
+    ctx->badIV = &ctx->state.badIV;
+    ctx->badMAC = &ctx->state.badMAC;
+    ctx->badFECF = &ctx->state.badFECF;
+    return ctx;
+}
+
+/**
+ * @brief Function: Crypto_Context_Get
+ * @return CryptoContext_t*: The calling thread's current context
+ **/
+CryptoContext_t* Crypto_Context_Get(void)
+{
+    return crypto_context_current;
+}
+
+/**
+ * @brief Function: Crypto_Context_Free
+ * Shuts the context down and frees it. The default context is only shut down.
+ * @param ctx: CryptoContext_t*
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Context_Free(CryptoContext_t* ctx)
+{
+    int32_t status;
+
+    if (ctx == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    status = Crypto_Shutdown_Ctx(ctx);
+    if (ctx == &crypto_context_default)
+    {
+        return status;
+    }
+    if (crypto_context_current == ctx)
+    {
+        crypto_context_current = &crypto_context_default;
+    }
+    memset(ctx, 0, sizeof(CryptoContext_t));
+    free(ctx);
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Context_Enter
+ * Makes ctx the calling thread's current context, so the functions without _Ctx run against it
+ * @param ctx: CryptoContext_t*, NULL selects the default context
+ * @return CryptoContext_t*: the previous context, to hand back to Crypto_Context_Exit
+ **/
+CryptoContext_t* Crypto_Context_Enter(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = crypto_context_current;
+
+    crypto_context_current = (ctx != NULL) ? ctx : &crypto_context_default;
+    return prev_ctx;
+}
+
+/**
+ * @brief Function: Crypto_Context_Exit
+ * Restores the context that was current before the matching Crypto_Context_Enter
+ * @param prev_ctx: CryptoContext_t*
+ **/
+void Crypto_Context_Exit(CryptoContext_t* prev_ctx)
+{
+    crypto_context_current = (prev_ctx != NULL) ? prev_ctx : &crypto_context_default;
+}
+
+/**
+ * @brief Function: Crypto_Context_Acquire_Backend
+ * Records that the current context uses the backend behind interface, dropping the one it held in that slot before
+ * @param backend: CryptoBackend
+ * @param interface: void*
+ * @return int32: Number of other contexts using the backend, 0 when the caller has to (re)initialize it
+ **/
+int32_t Crypto_Context_Acquire_Backend(CryptoBackend backend, void* interface)
+{
+    crypto_context_backend_t* entry;
+    void* held = crypto_context_current->backends[backend];
+    int32_t others = 0;
+
+    pthread_mutex_lock(&crypto_context_backends_lock);
+    if (held != interface)
+    {
+        // Selecting another backend leaves the old one up, as re-initializing always has
+        entry = crypto_context_backend_find(held, 0);
+        if (entry != NULL)
+        {
+            entry->users--;
+        }
+        crypto_context_current->backends[backend] = NULL;
+        entry = crypto_context_backend_find(interface, 1);
+        if (entry != NULL)
+        {
+            entry->users++;
+            crypto_context_current->backends[backend] = interface;
+        }
+    }
+    entry = crypto_context_backend_find(interface, 0);
+    if (entry != NULL)
+    {
+        others = (int32_t)entry->users - 1;
+    }
+    pthread_mutex_unlock(&crypto_context_backends_lock);
+    return others;
+}
+
+/**
+ * @brief Function: Crypto_Context_Release_Backend
+ * Drops the current context's hold on the backend in the given slot
+ * @param backend: CryptoBackend
+ * @return int32: Number of contexts still using the backend, 0 when the caller has to shut it down
+ **/
+int32_t Crypto_Context_Release_Backend(CryptoBackend backend)
+{
+    crypto_context_backend_t* entry;
+    int32_t left = 0;
+
+    pthread_mutex_lock(&crypto_context_backends_lock);
+    entry = crypto_context_backend_find(crypto_context_current->backends[backend], 0);
+    if (entry != NULL)
+    {
+        entry->users--;
+        left = (int32_t)entry->users;
+    }
+    crypto_context_current->backends[backend] = NULL;
+    pthread_mutex_unlock(&crypto_context_backends_lock);
+    return left;
+}
+
+/**
+ * @brief Function: Crypto_Context_Backends_In_Use
+ * @return uint8: CRYPTO_TRUE while any context holds a backend
+ **/
+uint8_t Crypto_Context_Backends_In_Use(void)
+{
+    uint8_t in_use = CRYPTO_FALSE;
+    uint32_t i;
+
+    pthread_mutex_lock(&crypto_context_backends_lock);
+    for (i = 0; i < CRYPTO_CONTEXT_MAX_BACKENDS; i++)
+    {
+        if (crypto_context_backends[i].users > 0)
+        {
+            in_use = CRYPTO_TRUE;
+        }
+    }
+    pthread_mutex_unlock(&crypto_context_backends_lock);
+    return in_use;
+}
+
+/**
+ * @brief Function: crypto_context_backend_find
+ * @param interface: void*
+ * @param create: uint8, take a free entry when interface has none
+ * @return crypto_context_backend_t*: NULL for a NULL interface, or when the table is full
+ **/
+static crypto_context_backend_t* crypto_context_backend_find(void* interface, uint8_t create)
+{
+    crypto_context_backend_t* free_entry = NULL;
+    uint32_t i;
+
+    if (interface == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0; i < CRYPTO_CONTEXT_MAX_BACKENDS; i++)
+    {
+        if ((crypto_context_backends[i].interface == interface) && (crypto_context_backends[i].users > 0))
+        {
+            return &crypto_context_backends[i];
+        }
+        if ((free_entry == NULL) && (crypto_context_backends[i].users == 0))
+        {
+            free_entry = &crypto_context_backends[i];
+        }
+    }
+    if ((create == 0) || (free_entry == NULL))
+    {
+        return NULL;
+    }
+    free_entry->interface = interface;
+    return free_entry;
+}
+
+/*
+** Context Variants
+** Each runs the function of the same name with ctx as the calling thread's current context
+*/
+int32_t Crypto_Config_CryptoLib_Ctx(CryptoContext_t* ctx, uint8_t key_type, uint8_t mc_type, uint8_t sa_type,
+                                    uint8_t cryptography_type, uint8_t iv_type, uint8_t crypto_create_fecf,
+                                    uint8_t process_sdls_pdus, uint8_t has_pus_hdr, uint8_t ignore_sa_state,
+                                    uint8_t ignore_anti_replay, uint8_t unique_sa_per_mapid,
+                                    uint8_t crypto_check_fecf, uint8_t vcid_bitmask,
+                                    uint8_t crypto_increment_nontransmitted_iv)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_CryptoLib(key_type, mc_type, sa_type, cryptography_type, iv_type,
+                                             crypto_create_fecf, process_sdls_pdus, has_pus_hdr, ignore_sa_state,
+                                             ignore_anti_replay, unique_sa_per_mapid, crypto_check_fecf,
+                                             vcid_bitmask, crypto_increment_nontransmitted_iv);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Sa_Capacity_Ctx(CryptoContext_t* ctx, uint16_t sa_capacity)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Sa_Capacity(sa_capacity);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Key_Capacity_Ctx(CryptoContext_t* ctx, uint16_t key_capacity)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Key_Capacity(key_capacity);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Thread_Safety_Ctx(CryptoContext_t* ctx, uint8_t thread_safe)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Thread_Safety(thread_safe);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Key_Store_Ctx(CryptoContext_t* ctx, char* key_store_path, uint8_t* kek, uint32_t kek_len)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Key_Store(key_store_path, kek, kek_len);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_MariaDB_Ctx(CryptoContext_t* ctx, char* mysql_hostname, char* mysql_database,
+                                  uint16_t mysql_port, uint8_t mysql_require_secure_transport,
+                                  uint8_t mysql_tls_verify_server, char* mysql_tls_ca, char* mysql_tls_capath,
+                                  char* mysql_mtls_cert, char* mysql_mtls_key, char* mysql_mtls_client_key_password,
+                                  char* mysql_username, char* mysql_password)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_MariaDB(mysql_hostname, mysql_database, mysql_port, mysql_require_secure_transport,
+                                           mysql_tls_verify_server, mysql_tls_ca, mysql_tls_capath, mysql_mtls_cert,
+                                           mysql_mtls_key, mysql_mtls_client_key_password, mysql_username,
+                                           mysql_password);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_MariaDB_Cache_Ctx(CryptoContext_t* ctx, uint8_t sa_cache_enabled,
+                                        uint32_t sa_cache_poll_interval_ms)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_MariaDB_Cache(sa_cache_enabled, sa_cache_poll_interval_ms);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_MariaDB_Write_Behind_Ctx(CryptoContext_t* ctx, uint8_t write_behind_enabled,
+                                               uint32_t flush_frames, uint32_t flush_interval_ms,
+                                               uint32_t max_staleness_ms)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status =
+        Crypto_Config_MariaDB_Write_Behind(write_behind_enabled, flush_frames, flush_interval_ms, max_staleness_ms);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_MariaDB_Pool_Ctx(CryptoContext_t* ctx, uint8_t pool_size, uint32_t health_check_interval_ms)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_MariaDB_Pool(pool_size, health_check_interval_ms);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Sa_Mmap_Ctx(CryptoContext_t* ctx, char* mmap_path, uint32_t checkpoint_interval,
+                                  uint32_t checkpoint_interval_ms)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Sa_Mmap(mmap_path, checkpoint_interval, checkpoint_interval_ms);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Sa_Sqlite_Ctx(CryptoContext_t* ctx, char* sqlite_path, uint8_t sqlite_synchronous)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Sa_Sqlite(sqlite_path, sqlite_synchronous);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Sa_Shm_Ctx(CryptoContext_t* ctx, char* shm_name)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Sa_Shm(shm_name);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Kmc_Crypto_Service_Ctx(CryptoContext_t* ctx, char* protocol, char* kmc_crypto_hostname,
+                                             uint16_t kmc_crypto_port, char* kmc_crypto_app, char* kmc_tls_ca_bundle,
+                                             char* kmc_tls_ca_path, uint8_t kmc_ignore_ssl_hostname_validation,
+                                             char* mtls_client_cert_path, char* mtls_client_cert_type,
+                                             char* mtls_client_key_path, char* mtls_client_key_pass,
+                                             char* mtls_issuer_cert)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Kmc_Crypto_Service(protocol, kmc_crypto_hostname, kmc_crypto_port, kmc_crypto_app,
+                                                      kmc_tls_ca_bundle, kmc_tls_ca_path,
+                                                      kmc_ignore_ssl_hostname_validation, mtls_client_cert_path,
+                                                      mtls_client_cert_type, mtls_client_key_path,
+                                                      mtls_client_key_pass, mtls_issuer_cert);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Kmc_Crypto_Service_Add_Endpoint_Ctx(CryptoContext_t* ctx, char* kmc_crypto_hostname,
+                                                          uint16_t kmc_crypto_port)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Kmc_Crypto_Service_Add_Endpoint(kmc_crypto_hostname, kmc_crypto_port);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Kmc_Crypto_Service_Hedging_Ctx(CryptoContext_t* ctx, uint8_t hedge_idempotent_requests,
+                                                     uint32_t hedge_min_delay_ms)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Kmc_Crypto_Service_Hedging(hedge_idempotent_requests, hedge_min_delay_ms);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Cam_Ctx(CryptoContext_t* ctx, uint8_t cam_enabled, char* cookie_file_path,
+                              char* keytab_file_path, uint8_t login_method, char* access_manager_uri, char* username,
+                              char* cam_home)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Cam(cam_enabled, cookie_file_path, keytab_file_path, login_method,
+                                       access_manager_uri, username, cam_home);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Config_Add_Gvcid_Managed_Parameter_Ctx(CryptoContext_t* ctx, uint8_t tfvn, uint16_t scid, uint8_t vcid,
+                                                      uint8_t has_fecf, uint8_t has_segmentation_hdr,
+                                                      uint16_t max_frame_size, uint8_t aos_has_fhec,
+                                                      uint8_t aos_has_iz, uint16_t aos_iz_len)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Config_Add_Gvcid_Managed_Parameter(tfvn, scid, vcid, has_fecf, has_segmentation_hdr,
+                                                               max_frame_size, aos_has_fhec, aos_has_iz, aos_iz_len);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Init_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Init();
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Init_With_Configs_Ctx(CryptoContext_t* ctx, CryptoConfig_t* crypto_config_p,
+                                     GvcidManagedParameters_t* gvcid_managed_parameters_p,
+                                     SadbMariaDBConfig_t* sa_mariadb_config_p,
+                                     CryptographyKmcCryptoServiceConfig_t* cryptography_kmc_crypto_config_p)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Init_With_Configs(crypto_config_p, gvcid_managed_parameters_p, sa_mariadb_config_p,
+                                              cryptography_kmc_crypto_config_p);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TC_Init_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_TC_Init();
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Init_TC_Unit_Test_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Init_TM_Unit_Test_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Init_TM_Unit_Test();
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Init_AOS_Unit_Test_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Init_AOS_Unit_Test();
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Init_Static_Config_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Init_Static_Config();
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Shutdown_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Shutdown();
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Snapshot_Save_Ctx(CryptoContext_t* ctx, const char* path)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Snapshot_Save(path);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_Snapshot_Load_Ctx(CryptoContext_t* ctx, const char* path, uint32_t counter_skip)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Snapshot_Load(path, counter_skip);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+void Crypto_Snapshot_Release_Ctx(CryptoContext_t* ctx)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    Crypto_Snapshot_Release();
+    Crypto_Context_Exit(prev_ctx);
+}
+
+int32_t Crypto_Key_Store_Save_Ctx(CryptoContext_t* ctx, const char* path)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_Key_Store_Save(path);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TC_ApplySecurity_Ctx(CryptoContext_t* ctx, const uint8_t* p_in_frame, const uint16_t in_frame_length,
+                                    uint8_t** pp_enc_frame, uint16_t* p_enc_frame_len)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_TC_ApplySecurity(p_in_frame, in_frame_length, pp_enc_frame, p_enc_frame_len);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TC_ProcessSecurity_Ctx(CryptoContext_t* ctx, uint8_t* ingest, int* len_ingest,
+                                      TC_t* tc_sdls_processed_frame)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_TC_ProcessSecurity(ingest, len_ingest, tc_sdls_processed_frame);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TC_ApplySecurity_Cam_Ctx(CryptoContext_t* ctx, const uint8_t* p_in_frame,
+                                        const uint16_t in_frame_length, uint8_t** pp_enc_frame,
+                                        uint16_t* p_enc_frame_len, char* cam_cookies)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status =
+        Crypto_TC_ApplySecurity_Cam(p_in_frame, in_frame_length, pp_enc_frame, p_enc_frame_len, cam_cookies);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TC_ProcessSecurity_Cam_Ctx(CryptoContext_t* ctx, uint8_t* ingest, int* len_ingest,
+                                          TC_t* tc_sdls_processed_frame, char* cam_cookies)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_TC_ProcessSecurity_Cam(ingest, len_ingest, tc_sdls_processed_frame, cam_cookies);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TC_ApplySecurity_Batch_Ctx(CryptoContext_t* ctx, TcBatchFrame_t* frames, uint32_t num_frames)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_TC_ApplySecurity_Batch(frames, num_frames);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TM_ApplySecurity_Ctx(CryptoContext_t* ctx, uint8_t* pTfBuffer)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_TM_ApplySecurity(pTfBuffer);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_TM_ProcessSecurity_Ctx(CryptoContext_t* ctx, uint8_t* p_ingest, uint16_t len_ingest,
+                                      uint8_t** pp_processed_frame, uint16_t* p_decrypted_length)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_TM_ProcessSecurity(p_ingest, len_ingest, pp_processed_frame, p_decrypted_length);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_AOS_ApplySecurity_Ctx(CryptoContext_t* ctx, uint8_t* pTfBuffer)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_AOS_ApplySecurity(pTfBuffer);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+int32_t Crypto_AOS_ProcessSecurity_Ctx(CryptoContext_t* ctx, uint8_t* p_ingest, uint16_t len_ingest,
+                                       uint8_t** pp_processed_frame, uint16_t* p_decrypted_length)
+{
+    CryptoContext_t* prev_ctx = Crypto_Context_Enter(ctx);
+    int32_t status = Crypto_AOS_ProcessSecurity(p_ingest, len_ingest, pp_processed_frame, p_decrypted_length);
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
@@ -0,0 +1,76 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+#ifndef CRYPTO_CONTEXT_INTERNAL_H
+#define CRYPTO_CONTEXT_INTERNAL_H
+
+/*
+** Library-private view of the Crypto Context. Include right after crypto.h: from there on the names of the global
+** variables in crypto.h refer to the calling thread's current context instead.
+*/
+#include "crypto.h"
+
+extern __thread CryptoContext_t* crypto_context_current;
+
+/*
+** Crypto Context Support Functions
+*/
+int32_t Crypto_Context_Acquire_Backend(CryptoBackend backend, void* interface);
+int32_t Crypto_Context_Release_Backend(CryptoBackend backend);
+
+/*
+** Current Context State
+*/
+// Data stores used in multiple components
+#define sdls_frame (*crypto_context_current->sdls_frame)
+#define tm_frame (*crypto_context_current->tm_frame)
+#define tm_frame_pri_hdr (*crypto_context_current->tm_frame_pri_hdr)
+#define tm_frame_sec_hdr (*crypto_context_current->tm_frame_sec_hdr)
+#define aos_frame (*crypto_context_current->aos_frame)
+#define aos_frame_pri_hdr (*crypto_context_current->aos_frame_pri_hdr)
+#define aos_frame_sec_hdr (*crypto_context_current->aos_frame_sec_hdr)
+
+// Configuration structs
+#define crypto_config (*crypto_context_current->crypto_config)
+#define sa_mariadb_config (*crypto_context_current->sa_mariadb_config)
+#define sa_mmap_config (*crypto_context_current->sa_mmap_config)
+#define key_store_config (*crypto_context_current->key_store_config)
+#define sa_sqlite_config (*crypto_context_current->sa_sqlite_config)
+#define sa_shm_config (*crypto_context_current->sa_shm_config)
+#define cryptography_kmc_crypto_config (*crypto_context_current->cryptography_kmc_crypto_config)
+#define cam_config (*crypto_context_current->cam_config)
+#define gvcid_managed_parameters (*crypto_context_current->gvcid_managed_parameters)
+#define current_managed_parameters (*crypto_context_current->current_managed_parameters)
+#define key_if (*crypto_context_current->key_if)
+#define mc_if (*crypto_context_current->mc_if)
+#define sa_if (*crypto_context_current->sa_if)
+#define cryptography_if (*crypto_context_current->cryptography_if)
+
+// OCF
+#define report (*crypto_context_current->report)
+#define clcw (*crypto_context_current->clcw)
+// Flags, the MC dump log is crypto_context_current->mc_log as mc_log also names an McInterface function
+#define log_summary (*crypto_context_current->log_summary)
+#define log_count (*crypto_context_current->log_count)
+#define tm_offset (*crypto_context_current->tm_offset)
+// ESA Testing - 0 = disabled, 1 = enabled
+#define badSPI (*crypto_context_current->badSPI)
+#define badIV (*crypto_context_current->badIV)
+#define badMAC (*crypto_context_current->badMAC)
+#define badFECF (*crypto_context_current->badFECF)
+
+#endif // CRYPTO_CONTEXT_INTERNAL_H
@@ -0,0 +1,365 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/*
+** Includes
+*/
+#include "crypto.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+/*
+** Epoch-Based Reclamation
+** SA and key records are published through pointers that readers load without taking a lock. A reader brackets its
+** use of published records with Crypto_Epoch_Enter / Crypto_Epoch_Exit; the TC, TM and AOS frame functions do this
+** for the whole frame. A writer publishes the new version of a record and then either waits for the readers that
+** might still hold the old one (Crypto_Epoch_Synchronize) or hands it to Crypto_Epoch_Retire to be freed once they
+** have all left.
+**
+** Each thread that enters an epoch claims one of CRYPTO_EPOCH_MAX_THREADS records, released when the thread exits.
+** A record holds the global epoch the thread entered at, or 0 while it is outside.
+**
+** Writers that publish SA versions (SDLS procedures and provisioning) run one at a time under
+** Crypto_Epoch_Writer_Lock, and may be called from inside a read section, e.g. for SDLS PDUs in TC ProcessSecurity.
+** A thread leaves its read section while it waits for the writer lock or in Crypto_Epoch_Synchronize, so a writer
+** never waits on another one that is waiting on it. Records it loaded before may be reclaimed meanwhile; SA slots,
+** which are never freed while the library is up, stay valid.
+*/
+#define CRYPTO_EPOCH_MAX_THREADS 64
+
+typedef struct
+{
+    uint64_t epoch;  // Global epoch when the thread entered, 0 while quiescent
+    uint32_t in_use; // Claimed by a thread
+} crypto_epoch_record_t;
+
+typedef struct crypto_epoch_retired
+{
+    void* ptr;
+    void (*free_fn)(void*);
+    uint64_t epoch; // Global epoch the record was unpublished in
+    struct crypto_epoch_retired* next;
+} crypto_epoch_retired_t;
+
+static crypto_epoch_record_t crypto_epoch_records[CRYPTO_EPOCH_MAX_THREADS];
+static uint64_t crypto_epoch_global = 1;
+static crypto_epoch_retired_t* crypto_epoch_retired = NULL;
+static uint32_t crypto_epoch_num_retired = 0;
+static pthread_mutex_t crypto_epoch_retired_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t crypto_epoch_writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t crypto_epoch_once = PTHREAD_ONCE_INIT;
+static pthread_key_t crypto_epoch_thread_key;
+static __thread crypto_epoch_record_t* crypto_epoch_self = NULL;
+static __thread uint32_t crypto_epoch_nesting = 0;
+static __thread uint32_t crypto_epoch_writer_nesting = 0;
+
+/*
+** Local Prototypes
+*/
+static void crypto_epoch_key_create(void);
+static void crypto_epoch_thread_exit(void* record);
+static crypto_epoch_record_t* crypto_epoch_claim(void);
+static uint8_t crypto_epoch_quiescent_since(uint64_t epoch, const crypto_epoch_record_t* ignore);
+static void crypto_epoch_reclaim(void);
+static void crypto_epoch_suspend(void);
+static void crypto_epoch_resume(void);
+
+/**
+ * @brief Function: Crypto_Epoch_Enter
+ * Marks the calling thread as reading published SA and key records. Calls nest.
+ **/
+void Crypto_Epoch_Enter(void)
+{
+    if (crypto_epoch_nesting++ > 0)
+    {
+        return;
+    }
+    if (crypto_epoch_self == NULL)
+    {
+        crypto_epoch_self = crypto_epoch_claim();
+    }
+    crypto_epoch_resume();
+}
+
+/**
+ * @brief Function: Crypto_Epoch_Exit
+ * Ends the calling thread's read section, records it loaded may be freed after this
+ **/
+void Crypto_Epoch_Exit(void)
+{
+    if ((crypto_epoch_nesting == 0) || (--crypto_epoch_nesting > 0))
+    {
+        return;
+    }
+    __atomic_store_n(&crypto_epoch_self->epoch, 0, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&crypto_epoch_num_retired, __ATOMIC_RELAXED) > 0)
+    {
+        crypto_epoch_reclaim();
+    }
+}
+
+/**
+ * @brief Function: Crypto_Epoch_Synchronize
+ * Waits until every other thread that was reading when it was called has left its read section. A caller inside a
+ * read section leaves it for the wait and comes back in at the new epoch, so writers may run from inside a frame
+ * function (e.g. SDLS PDUs from TC ProcessSecurity).
+ **/
+void Crypto_Epoch_Synchronize(void)
+{
+    uint64_t epoch = __atomic_fetch_add(&crypto_epoch_global, 1, __ATOMIC_SEQ_CST);
+
+    crypto_epoch_suspend();
+    while (!crypto_epoch_quiescent_since(epoch, NULL))
+    {
+        sched_yield();
+    }
+    crypto_epoch_resume();
+    crypto_epoch_reclaim();
+}
+
+/**
+ * @brief Function: Crypto_Epoch_Writer_Lock
+ * Serializes the writers that publish SA versions. Calls nest. A caller inside a read section leaves it while it
+ * waits, the writer holding the lock may be waiting for that read section to end.
+ **/
+void Crypto_Epoch_Writer_Lock(void)
+{
+    if (crypto_epoch_writer_nesting++ > 0)
+    {
+        return;
+    }
+    if (pthread_mutex_trylock(&crypto_epoch_writer_lock) != 0)
+    {
+        crypto_epoch_suspend();
+        pthread_mutex_lock(&crypto_epoch_writer_lock);
+        crypto_epoch_resume();
+    }
+}
+
+/**
+ * @brief Function: Crypto_Epoch_Writer_Unlock
+ **/
+void Crypto_Epoch_Writer_Unlock(void)
+{
+    if ((crypto_epoch_writer_nesting == 0) || (--crypto_epoch_writer_nesting > 0))
+    {
+        return;
+    }
+    pthread_mutex_unlock(&crypto_epoch_writer_lock);
+}
+
+/**
+ * @brief Function: Crypto_Epoch_Retire
+ * Frees a record that is no longer published once no reader can still hold it
+ * @param ptr: void*
+ * @param free_fn: void (*)(void*), called on ptr
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Epoch_Retire(void* ptr, void (*free_fn)(void*))
+{
+    crypto_epoch_retired_t* retired;
+
+    if ((ptr == NULL) || (free_fn == NULL))
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    retired = (crypto_epoch_retired_t*)malloc(sizeof(crypto_epoch_retired_t));
+    if (retired == NULL)
+    {
+        // Better to wait than to leak or free under a reader
+        Crypto_Epoch_Synchronize();
+        free_fn(ptr);
+        return CRYPTO_LIB_SUCCESS;
+    }
+    retired->ptr = ptr;
+    retired->free_fn = free_fn;
+    retired->epoch = __atomic_fetch_add(&crypto_epoch_global, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&crypto_epoch_retired_lock);
+    retired->next = crypto_epoch_retired;
+    crypto_epoch_retired = retired;
+    __atomic_add_fetch(&crypto_epoch_num_retired, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&crypto_epoch_retired_lock);
+
+    crypto_epoch_reclaim();
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: Crypto_Epoch_Shutdown
+ * Frees every retired record. Only called once no thread is reading, e.g. from Crypto_Shutdown.
+ **/
+void Crypto_Epoch_Shutdown(void)
+{
+    crypto_epoch_retired_t* retired;
+
+    pthread_mutex_lock(&crypto_epoch_retired_lock);
+    while (crypto_epoch_retired != NULL)
+    {
+        retired = crypto_epoch_retired;
+        crypto_epoch_retired = retired->next;
+        retired->free_fn(retired->ptr);
+        free(retired);
+    }
+    __atomic_store_n(&crypto_epoch_num_retired, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&crypto_epoch_retired_lock);
+}
+
+/**
+ * @brief Function: crypto_epoch_key_create
+ **/
+static void crypto_epoch_key_create(void)
+{
+    pthread_key_create(&crypto_epoch_thread_key, crypto_epoch_thread_exit);
+}
+
+/**
+ * @brief Function: crypto_epoch_thread_exit
+ * Gives a thread's record back when the thread ends
+ * @param record: void*
+ **/
+static void crypto_epoch_thread_exit(void* record)
+{
+    crypto_epoch_record_t* self = (crypto_epoch_record_t*)record;
+
+    __atomic_store_n(&self->epoch, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&self->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: crypto_epoch_claim
+ * Claims a free record for the calling thread, waiting for a thread to exit if all are in use
+ * @return crypto_epoch_record_t*
+ **/
+static crypto_epoch_record_t* crypto_epoch_claim(void)
+{
+    uint32_t expected;
+    uint32_t i;
+
+    pthread_once(&crypto_epoch_once, crypto_epoch_key_create);
+    for (;;)
+    {
+        for (i = 0; i < CRYPTO_EPOCH_MAX_THREADS; i++)
+        {
+            expected = 0;
+            if (__atomic_compare_exchange_n(&crypto_epoch_records[i].in_use, &expected, 1, 0, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_RELAXED))
+            {
+                pthread_setspecific(crypto_epoch_thread_key, &crypto_epoch_records[i]);
+                return &crypto_epoch_records[i];
+            }
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * @brief Function: crypto_epoch_quiescent_since
+ * @param epoch: uint64_t
+ * @param ignore: const crypto_epoch_record_t*, a record not to wait for, may be NULL
+ * @return uint8_t: 1 if no reader other than ignore entered at or before epoch is still inside
+ **/
+static uint8_t crypto_epoch_quiescent_since(uint64_t epoch, const crypto_epoch_record_t* ignore)
+{
+    uint64_t reader_epoch;
+    uint32_t i;
+
+    for (i = 0; i < CRYPTO_EPOCH_MAX_THREADS; i++)
+    {
+        if (&crypto_epoch_records[i] == ignore)
+        {
+            continue;
+        }
+        reader_epoch = __atomic_load_n(&crypto_epoch_records[i].epoch, __ATOMIC_SEQ_CST);
+        if ((reader_epoch != 0) && (reader_epoch <= epoch))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Function: crypto_epoch_reclaim
+ * Frees the retired records no reader can still hold
+ **/
+static void crypto_epoch_reclaim(void)
+{
+    crypto_epoch_retired_t** link;
+    crypto_epoch_retired_t* retired;
+    crypto_epoch_retired_t* reclaimed = NULL;
+
+    if (pthread_mutex_trylock(&crypto_epoch_retired_lock) != 0)
+    {
+        return; // Another thread is reclaiming
+    }
+    link = &crypto_epoch_retired;
+    while (*link != NULL)
+    {
+        retired = *link;
+        if (crypto_epoch_quiescent_since(retired->epoch, NULL))
+        {
+            *link = retired->next;
+            retired->next = reclaimed;
+            reclaimed = retired;
+            __atomic_sub_fetch(&crypto_epoch_num_retired, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            link = &retired->next;
+        }
+    }
+    pthread_mutex_unlock(&crypto_epoch_retired_lock);
+
+    while (reclaimed != NULL)
+    {
+        retired = reclaimed;
+        reclaimed = retired->next;
+        retired->free_fn(retired->ptr);
+        free(retired);
+    }
+}
+
+/**
+ * @brief Function: crypto_epoch_suspend
+ * Marks the calling thread quiescent without ending its read section, if it is in one
+ **/
+static void crypto_epoch_suspend(void)
+{
+    if (crypto_epoch_nesting > 0)
+    {
+        __atomic_store_n(&crypto_epoch_self->epoch, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Function: crypto_epoch_resume
+ * Marks the calling thread as reading again at the current epoch, if it is in a read section
+ **/
+static void crypto_epoch_resume(void)
+{
+    if (crypto_epoch_nesting == 0)
+    {
+        return;
+    }
+    // The store must be visible before any published pointer is loaded
+    __atomic_store_n(&crypto_epoch_self->epoch, __atomic_load_n(&crypto_epoch_global, __ATOMIC_SEQ_CST),
+                     __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
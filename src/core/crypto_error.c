@@ -72,6 +72,8 @@ char *crypto_enum_errlist_core[] =
         (char*) "CRYPTO_LIB_ERR_MC_INIT",
         (char*) "CRYPTO_LIB_ERR_INPUT_FRAME_TOO_SHORT_FOR_AOS_STANDARD",
         (char*) "CRYPTO_LIB_ERR_TC_ENUM_USED_FOR_AOS_CONFIG",
+        (char*) "CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE",
+        (char*) "CRYPTO_LIB_ERR_ABM_POOL_FULL",
 };
 
 char *crypto_enum_errlist_config[] =
@@ -80,12 +82,35 @@ char *crypto_enum_errlist_config[] =
         (char*) "CRYPTO_MANAGED_PARAM_CONFIGURATION_NOT_COMPLETE",
         (char*) "CRYPTO_MARIADB_CONFIGURATION_NOT_COMPLETE",
         (char*) "MANAGED_PARAMETERS_FOR_GVCID_NOT_FOUND",
+        (char*) "CRYPTO_MMAP_CONFIGURATION_NOT_COMPLETE",
+        (char*) "CRYPTO_SQLITE_CONFIGURATION_NOT_COMPLETE",
+        (char*) "CRYPTO_SHM_CONFIGURATION_NOT_COMPLETE",
+        (char*) "CRYPTO_SNAPSHOT_FILE_ERROR",
+        (char*) "CRYPTO_SNAPSHOT_INVALID",
+        (char*) "CRYPTO_STATIC_CONFIG_NOT_AVAILABLE",
+        (char*) "CRYPTO_KEY_STORE_CONFIGURATION_NOT_COMPLETE",
+        (char*) "CRYPTO_KEY_STORE_FILE_ERROR",
+        (char*) "CRYPTO_KEY_STORE_INVALID",
+        (char*) "CRYPTO_THREAD_SAFETY_NOT_SUPPORTED",
 };
 
 char *crypto_enum_errlist_sa_if[] =
 {
         (char*) "SADB_INVALID_SADB_TYPE",
         (char*) "SADB_NULL_SA_USED",
+        (char*) "SADB_SPI_NOT_FOUND",
+        (char*) "SADB_SA_TABLE_FULL",
+        (char*) "SADB_MMAP_OPEN_FAILED",
+        (char*) "SADB_MMAP_STORE_CORRUPT",
+        (char*) "SADB_MMAP_STORE_INCOMPATIBLE",
+        (char*) "SADB_MMAP_SYNC_FAILED",
+        (char*) "SADB_SQLITE_OPEN_FAILED",
+        (char*) "SADB_SHM_OPEN_FAILED",
+        (char*) "SADB_SHM_TABLE_INCOMPATIBLE",
+        (char*) "SADB_SHM_LOCK_FAILED",
+        (char*) "SADB_SA_WRONG_STATE",
+        (char*) "SADB_MMAP_CHECKPOINT_BEHIND",
+        (char*) "SADB_SHM_SA_CHANGED",
 };
 char *crypto_enum_errlist_sa_mariadb[] =
 {
@@ -93,6 +118,7 @@ char *crypto_enum_errlist_sa_mariadb[] =
         (char*) "SADB_QUERY_FAILED",
         (char*) "SADB_QUERY_EMPTY_RESULTS",
         (char*) "SADB_INSERT_FAILED",
+        (char*) "SADB_MARIADB_WRITE_BEHIND_STALE",
 };
 char *crypto_enum_errlist_crypto_if[] =
 {
@@ -118,6 +144,7 @@ char *crypto_enum_errlist_crypto_kmc[] =
         (char*) "CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_EMPTY_RESPONSE",
         (char*) "CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_DECRYPT_ERROR",
         (char*) "CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_ENCRYPT_ERROR",
+        (char*) "CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_ENDPOINT_OUT_OF_RANGE",
 };
 
 char *crypto_enum_errlist_crypto_cam[] =
@@ -154,7 +181,7 @@ char* Crypto_Get_Error_Code_Enum_String(int32_t crypto_error_code)
     }
     else if(crypto_error_code >= 500) // KMC Error Codes
     {
-        if(crypto_error_code > 515)
+        if(crypto_error_code > 516)
         {
             return CRYPTO_UNDEFINED_ERROR;
         }
@@ -177,7 +204,7 @@ char* Crypto_Get_Error_Code_Enum_String(int32_t crypto_error_code)
     }
     else if(crypto_error_code >= 300) // SADB MariadDB Error Codes
     {
-        if(crypto_error_code > 303)
+        if(crypto_error_code > 304)
         {
             return CRYPTO_UNDEFINED_ERROR;
         }
@@ -189,7 +216,7 @@ char* Crypto_Get_Error_Code_Enum_String(int32_t crypto_error_code)
     }
     else if(crypto_error_code >= 200) // SADB Interface Error Codes
     {
-        if(crypto_error_code > 201)
+        if(crypto_error_code > 214)
         {
             return CRYPTO_UNDEFINED_ERROR;
         }
@@ -200,7 +227,7 @@ char* Crypto_Get_Error_Code_Enum_String(int32_t crypto_error_code)
     }
     else if(crypto_error_code >= 100) // Configuration Error Codes
     {
-        if(crypto_error_code > 103)
+        if(crypto_error_code > 113)
         {
             return CRYPTO_UNDEFINED_ERROR;
         }
@@ -215,7 +242,7 @@ char* Crypto_Get_Error_Code_Enum_String(int32_t crypto_error_code)
     }
     else if(crypto_error_code <= 0) // Cryptolib Core Error Codes
     {
-        if(crypto_error_code < -45)
+        if(crypto_error_code < -52)
         {
             return CRYPTO_UNDEFINED_ERROR;
         }
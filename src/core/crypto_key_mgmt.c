@@ -20,10 +20,97 @@
 ** Includes
 */
 #include "crypto.h"
+#include "crypto_context_internal.h"
+
+/*
+** Module Variables
+*/
+// Bumped whenever a key is published with new key material, so cached key schedules of the previous version are not
+// reused
+static uint32_t crypto_key_generation[NUM_KEYS] = {0};
 
 /*
 ** Key Management Services
 */
+/**
+ * @brief Function: Crypto_Key_Publish
+ * Makes key the current version of a key. Key rings that publish versions swap it in without disturbing frames
+ * that hold the previous one; others have the key overwritten in place.
+ * @param key_id: uint32_t
+ * @param key: const crypto_key_t*
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Key_Publish(uint32_t key_id, const crypto_key_t* key)
+{
+    crypto_key_t* ekp = NULL;
+    uint8_t same_material = CRYPTO_FALSE;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if ((key_if == NULL) || (key == NULL))
+    {
+        return CRYPTOGRAPHY_UNSUPPORTED_OPERATION_FOR_KEY_RING;
+    }
+
+    // Activation and deactivation keep the key material, and with it any key schedule already set up for it
+    Crypto_Epoch_Enter();
+    ekp = key_if->get_key(key_id);
+    if ((ekp != NULL) && (ekp->key_len == key->key_len) && (key->key_len <= KEY_SIZE) &&
+        (memcmp(ekp->value, key->value, key->key_len) == 0) && (key->key_state != KEY_DESTROYED) &&
+        (key->key_state != KEY_CORRUPTED))
+    {
+        same_material = CRYPTO_TRUE;
+    }
+    Crypto_Epoch_Exit();
+
+    if (key_if->key_publish != NULL)
+    {
+        status = key_if->key_publish(key_id, key);
+    }
+    else
+    {
+        ekp = key_if->get_key(key_id);
+        if (ekp == NULL)
+        {
+            return CRYPTO_LIB_ERR_KEY_ID_ERROR;
+        }
+        *ekp = *key;
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+
+    // Covers OTAR and destruction, which publish new key material
+    if (same_material == CRYPTO_TRUE)
+    {
+        return status;
+    }
+    if (key_id < NUM_KEYS)
+    {
+        __atomic_add_fetch(&crypto_key_generation[key_id], 1, __ATOMIC_RELEASE);
+    }
+    if ((cryptography_if != NULL) && (cryptography_if->cryptography_key_invalidate != NULL))
+    {
+        cryptography_if->cryptography_key_invalidate(key_id);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Key_Generation
+ * Returns how many times new material has been published for a key, for caches of material derived from it
+ * @param key_id: uint32_t
+ * @return uint32: Generation, 0 for key IDs outside the key ring
+ **/
+uint32_t Crypto_Key_Generation(uint32_t key_id)
+{
+    if (key_id >= NUM_KEYS)
+    {
+        return 0;
+    }
+    return __atomic_load_n(&crypto_key_generation[key_id], __ATOMIC_ACQUIRE);
+}
+
 /**
  * @brief Function: Crypto_Key_OTAR
  * The OTAR Rekeying procedure shall have the following Service Parameters:
@@ -39,67 +126,81 @@
 int32_t Crypto_Key_OTAR(void)
 {
     // Local variables
-    SDLS_OTAR_t packet;
-    int count = 0;
-    int x = 0;
-    int y;
+    SecurityAssociation_t key_ref_sa;
+    uint8_t iv[OTAR_IV_SIZE];
+    uint8_t mac[MAC_SIZE];
+    uint8_t ecs = CRYPTO_CIPHER_AES256_GCM;
+    uint8_t* ekb = &(sdls_frame.pdu.data[2 + OTAR_IV_SIZE]);
+    uint16_t mkid;
+    uint16_t ekid;
+    int pdu_keys = (sdls_frame.pdu.pdu_len - (2 + OTAR_IV_SIZE + MAC_SIZE)) / (2 + OTAR_KEY_SIZE);
+    int x;
     int32_t status = CRYPTO_LIB_SUCCESS;
-    int pdu_keys = (sdls_frame.pdu.pdu_len - 30) / (2 + KEY_SIZE);
-    int w;
     crypto_key_t* ekp = NULL;
+    crypto_key_t new_key;
+
+    if ((key_if == NULL) || (cryptography_if == NULL))
+    {
+        return CRYPTOGRAPHY_UNSUPPORTED_OPERATION_FOR_KEY_RING;
+    }
 
     // Master Key ID
-    packet.mkid = (sdls_frame.pdu.data[0] << 8) | (sdls_frame.pdu.data[1]);
+    mkid = (sdls_frame.pdu.data[0] << 8) | (sdls_frame.pdu.data[1]);
 
-    if (packet.mkid >= 128)
+    if (mkid >= 128)
     {
         report.af = 1;
         if (log_summary.rs > 0)
         {
             Crypto_increment((uint8_t* )&log_summary.num_se, 4);
             log_summary.rs--;
-            mc_log.blk[log_count].emt = MKID_INVALID_EID;
-            mc_log.blk[log_count].emv[0] = 0x4E;
-            mc_log.blk[log_count].emv[1] = 0x41;
-            mc_log.blk[log_count].emv[2] = 0x53;
-            mc_log.blk[log_count].emv[3] = 0x41;
-            mc_log.blk[log_count++].em_len = 4;
+            crypto_context_current->mc_log->blk[log_count].emt = MKID_INVALID_EID;
+            crypto_context_current->mc_log->blk[log_count].emv[0] = 0x4E;
+            crypto_context_current->mc_log->blk[log_count].emv[1] = 0x41;
+            crypto_context_current->mc_log->blk[log_count].emv[2] = 0x53;
+            crypto_context_current->mc_log->blk[log_count].emv[3] = 0x41;
+            crypto_context_current->mc_log->blk[log_count++].em_len = 4;
         }
         printf(KRED "Error: MKID is not valid! \n" RESET);
         status = CRYPTO_LIB_ERROR;
         return status;
     }
-
-    for (count = 2; count < (2 + IV_SIZE); count++)
-    { // Initialization Vector
-        packet.iv[count - 2] = sdls_frame.pdu.data[count];
-        // printf("packet.iv[%d] = 0x%02x\n", count-2, packet.iv[count-2]);
+    if (sdls_frame.pdu.pdu_len > TLV_DATA_SIZE)
+    {
+        printf(KRED "Error: OTAR PDU length %d is not valid! \n" RESET, sdls_frame.pdu.pdu_len);
+        return CRYPTO_LIB_ERROR;
     }
-
-    count = sdls_frame.pdu.pdu_len - MAC_SIZE;
-    for (w = 0; w < 16; w++)
-    { // MAC
-        packet.mac[w] = sdls_frame.pdu.data[count + w];
-        // printf("packet.mac[%d] = 0x%02x\n", w, packet.mac[w]);
+    if (pdu_keys <= 0)
+    {
+        // No key blocks, nothing to install
+        return CRYPTO_LIB_SUCCESS;
     }
 
-    ekp = key_if->get_key(packet.mkid);
+    // Initialization Vector and MAC, the key blocks are between them
+    memcpy(iv, &(sdls_frame.pdu.data[2]), OTAR_IV_SIZE);
+    memcpy(mac, &(sdls_frame.pdu.data[sdls_frame.pdu.pdu_len - MAC_SIZE]), MAC_SIZE);
+
+    ekp = key_if->get_key(mkid);
     if (ekp == NULL)
     {
         return CRYPTO_LIB_ERR_KEY_ID_ERROR;
     }
 
-    uint8_t ecs = CRYPTO_CIPHER_AES256_GCM;
-    status = cryptography_if->cryptography_aead_decrypt(&(sdls_frame.pdu.data[14]), // plaintext output
-                                                        (size_t)(pdu_keys * (2 + KEY_SIZE)), // length of data
+    // Names the master key to the cryptography backend, so OTARs under the same master key share its key schedule
+    memset(&key_ref_sa, 0, sizeof(key_ref_sa));
+    key_ref_sa.ekid = mkid;
+
+    // All key blocks are decrypted in one pass and checked against the one MAC before any key is installed
+    status = cryptography_if->cryptography_aead_decrypt(ekb, // plaintext output
+                                                        (size_t)(pdu_keys * (2 + OTAR_KEY_SIZE)), // length of data
                                                         NULL,                               // in place decryption
                                                         0,                                  // in data length
                                                         &(ekp->value[0]), //key
-                                                        KEY_SIZE, //key length
-                                                        NULL, //SA reference
-                                                        &(packet.iv[0]), //IV
-                                                        IV_SIZE, //IV length
-                                                        &(packet.mac[0]), // tag input
+                                                        ekp->key_len, //key length
+                                                        &key_ref_sa, //SA reference
+                                                        &(iv[0]), //IV
+                                                        OTAR_IV_SIZE, //IV length
+                                                        &(mac[0]), // tag input
                                                         MAC_SIZE,          // tag size
                                                         NULL, // AAD
                                                         0, // AAD Length
@@ -110,70 +211,76 @@ int32_t Crypto_Key_OTAR(void)
                                                         NULL,  // authentication cipher
                                                         NULL // cam_cookies
                                                         );
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        memset(ekb, 0, pdu_keys * (2 + OTAR_KEY_SIZE));
+        printf(KRED "Error: OTAR key blocks did not authenticate! \n" RESET);
+        return status;
+    }
 
-    // Read in Decrypted Data
-    for (count = 14; x < pdu_keys; x++)
+    for (x = 0; x < pdu_keys; x++)
     { // Encrypted Key Blocks
-        packet.EKB[x].ekid = (sdls_frame.pdu.data[count] << 8) | (sdls_frame.pdu.data[count + 1]);
-        if (packet.EKB[x].ekid < 128)
+        ekid = (ekb[x * (2 + OTAR_KEY_SIZE)] << 8) | (ekb[(x * (2 + OTAR_KEY_SIZE)) + 1]);
+        if (ekid < 128)
         {
             report.af = 1;
             if (log_summary.rs > 0)
             {
                 Crypto_increment((uint8_t* )&log_summary.num_se, 4);
                 log_summary.rs--;
-                mc_log.blk[log_count].emt = OTAR_MK_ERR_EID;
-                mc_log.blk[log_count].emv[0] = 0x4E; // N
-                mc_log.blk[log_count].emv[1] = 0x41; // A
-                mc_log.blk[log_count].emv[2] = 0x53; // S
-                mc_log.blk[log_count].emv[3] = 0x41; // A
-                mc_log.blk[log_count++].em_len = 4;
+                crypto_context_current->mc_log->blk[log_count].emt = OTAR_MK_ERR_EID;
+                crypto_context_current->mc_log->blk[log_count].emv[0] = 0x4E; // N
+                crypto_context_current->mc_log->blk[log_count].emv[1] = 0x41; // A
+                crypto_context_current->mc_log->blk[log_count].emv[2] = 0x53; // S
+                crypto_context_current->mc_log->blk[log_count].emv[3] = 0x41; // A
+                crypto_context_current->mc_log->blk[log_count++].em_len = 4;
             }
             printf(KRED "Error: Cannot OTAR master key! \n" RESET);
+            memset(ekb, 0, pdu_keys * (2 + OTAR_KEY_SIZE));
             status = CRYPTO_LIB_ERROR;
             return status;
         }
-        else
+        if (key_if->get_key(ekid) == NULL)
         {
-            ekp = key_if->get_key(packet.EKB[x].ekid);
-            if (ekp == NULL)
-            {
-                return CRYPTO_LIB_ERR_KEY_ID_ERROR;
-            }
-            
-            count = count + 2;
-            for (y = count; y < (KEY_SIZE + count); y++)
-            { 
-                // Encrypted Key
-                packet.EKB[x].ek[y - count] = sdls_frame.pdu.data[y];
-#ifdef SA_DEBUG
-                printf("\t packet.EKB[%d].ek[%d] = 0x%02x\n", x, y - count, packet.EKB[x].ek[y - count]);
-#endif
-                // Setup Key Ring
-                ekp->value[y - count] = sdls_frame.pdu.data[y];
-            }
-            count = count + KEY_SIZE;
-
-            // Set state to PREACTIVE
-            ekp->key_state = KEY_PREACTIVE;
+            memset(ekb, 0, pdu_keys * (2 + OTAR_KEY_SIZE));
+            return CRYPTO_LIB_ERR_KEY_ID_ERROR;
         }
     }
 
 #ifdef PDU_DEBUG
-    printf("Received %d keys via master key %d: \n", pdu_keys, packet.mkid);
+    printf("Received %d keys via master key %d: \n", pdu_keys, mkid);
     for (x = 0; x < pdu_keys; x++)
     {
-        printf("%d) Key ID = %d, 0x", x + 1, packet.EKB[x].ekid);
-        for (y = 0; y < KEY_SIZE; y++)
+        printf("%d) Key ID = %d, 0x", x + 1,
+               (ekb[x * (2 + OTAR_KEY_SIZE)] << 8) | (ekb[(x * (2 + OTAR_KEY_SIZE)) + 1]));
+        for (int y = 0; y < OTAR_KEY_SIZE; y++)
         {
-            printf("%02x", packet.EKB[x].ek[y]);
+            printf("%02x", ekb[(x * (2 + OTAR_KEY_SIZE)) + 2 + y]);
         }
         printf("\n");
     }
 #endif
 
-    return CRYPTO_LIB_SUCCESS;
+    // Install the keys as PREACTIVE and set them up ahead of their first use
+    memset(&new_key, 0, sizeof(new_key));
+    new_key.key_len = OTAR_KEY_SIZE;
+    new_key.key_state = KEY_PREACTIVE;
+    for (x = 0; (x < pdu_keys) && (status == CRYPTO_LIB_SUCCESS); x++)
+    {
+        ekid = (ekb[x * (2 + OTAR_KEY_SIZE)] << 8) | (ekb[(x * (2 + OTAR_KEY_SIZE)) + 1]);
+        memcpy(new_key.value, &(ekb[(x * (2 + OTAR_KEY_SIZE)) + 2]), OTAR_KEY_SIZE);
+        status = Crypto_Key_Publish(ekid, &new_key);
+        if ((status == CRYPTO_LIB_SUCCESS) && (cryptography_if->cryptography_key_warm != NULL))
+        {
+            cryptography_if->cryptography_key_warm(ekid, new_key.value, OTAR_KEY_SIZE, &ecs);
+        }
+    }
+    memset(new_key.value, 0, OTAR_KEY_SIZE);
+    memset(ekb, 0, pdu_keys * (2 + OTAR_KEY_SIZE));
+
+    return status;
 }
+
 /**
  * @brief Function: Crypto_Key_update
  * Updates the state of the all keys in the received SDLS EP PDU
@@ -187,6 +294,7 @@ int32_t Crypto_Key_update(uint8_t state)
     int pdu_keys = sdls_frame.pdu.pdu_len / 2;
     int32_t status;
     crypto_key_t* ekp = NULL;
+    crypto_key_t new_key;
     int x;
 
     if (key_if == NULL)
@@ -248,12 +356,12 @@ int32_t Crypto_Key_update(uint8_t state)
             {
                 Crypto_increment((uint8_t* )&log_summary.num_se, 4);
                 log_summary.rs--;
-                mc_log.blk[log_count].emt = MKID_STATE_ERR_EID;
-                mc_log.blk[log_count].emv[0] = 0x4E;
-                mc_log.blk[log_count].emv[1] = 0x41;
-                mc_log.blk[log_count].emv[2] = 0x53;
-                mc_log.blk[log_count].emv[3] = 0x41;
-                mc_log.blk[log_count++].em_len = 4;
+                crypto_context_current->mc_log->blk[log_count].emt = MKID_STATE_ERR_EID;
+                crypto_context_current->mc_log->blk[log_count].emv[0] = 0x4E;
+                crypto_context_current->mc_log->blk[log_count].emv[1] = 0x41;
+                crypto_context_current->mc_log->blk[log_count].emv[2] = 0x53;
+                crypto_context_current->mc_log->blk[log_count].emv[3] = 0x41;
+                crypto_context_current->mc_log->blk[log_count++].em_len = 4;
             }
             printf(KRED "Error: MKID state cannot be changed! \n" RESET);
             // TODO: Exit
@@ -267,7 +375,13 @@ int32_t Crypto_Key_update(uint8_t state)
 
         if (ekp->key_state == (state - 1))
         {
-            ekp->key_state = state;
+            new_key = *ekp;
+            new_key.key_state = state;
+            status = Crypto_Key_Publish(packet.kblk[x].kid, &new_key);
+            if (status != CRYPTO_LIB_SUCCESS)
+            {
+                return status;
+            }
 #ifdef PDU_DEBUG
             // printf("Key ID %d state changed to ", packet.kblk[x].kid);
 #endif
@@ -278,12 +392,12 @@ int32_t Crypto_Key_update(uint8_t state)
             {
                 Crypto_increment((uint8_t* )&log_summary.num_se, 4);
                 log_summary.rs--;
-                mc_log.blk[log_count].emt = KEY_TRANSITION_ERR_EID;
-                mc_log.blk[log_count].emv[0] = 0x4E;
-                mc_log.blk[log_count].emv[1] = 0x41;
-                mc_log.blk[log_count].emv[2] = 0x53;
-                mc_log.blk[log_count].emv[3] = 0x41;
-                mc_log.blk[log_count++].em_len = 4;
+                crypto_context_current->mc_log->blk[log_count].emt = KEY_TRANSITION_ERR_EID;
+                crypto_context_current->mc_log->blk[log_count].emv[0] = 0x4E;
+                crypto_context_current->mc_log->blk[log_count].emv[1] = 0x41;
+                crypto_context_current->mc_log->blk[log_count].emv[2] = 0x53;
+                crypto_context_current->mc_log->blk[log_count].emv[3] = 0x41;
+                crypto_context_current->mc_log->blk[log_count++].em_len = 4;
             }
             printf(KRED "Error: Key %d cannot transition to desired state! \n" RESET, packet.kblk[x].kid);
         }
@@ -351,94 +465,92 @@ int32_t Crypto_Key_inventory(uint8_t* ingest)
 int32_t Crypto_Key_verify(uint8_t* ingest, TC_t* tc_frame)
 {
     // Local variables
-    SDLS_KEYV_CMD_t packet;
+    SecurityAssociation_t key_ref_sa;
+    uint8_t* blk;
+    uint16_t kid;
     int count = 0;
     int pdu_keys = sdls_frame.pdu.pdu_len / SDLS_KEYV_CMD_BLK_SIZE;
-
-    uint8_t iv_loc;
-    // uint8_t tmp_mac[MAC_SIZE];
+    int iv_loc;
     int x;
-    int y;
     int32_t status;
     crypto_key_t* ekp = NULL;
+    uint8_t ecs = CRYPTO_CIPHER_AES256_GCM;
 
     if (key_if == NULL)
     {
         status = CRYPTOGRAPHY_UNSUPPORTED_OPERATION_FOR_KEY_RING;
         return status;
     }
+    if (sdls_frame.pdu.pdu_len > TLV_DATA_SIZE)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
 
 #ifdef PDU_DEBUG
     printf("Crypto_Key_verify: Requested %d key(s) to verify \n", pdu_keys);
 #endif
-    
-    // Read in PDU
-    for (x = 0; x < pdu_keys; x++)
-    {
-        // Key ID
-        packet.blk[x].kid = ((uint8_t)sdls_frame.pdu.data[count] << 8) | ((uint8_t)sdls_frame.pdu.data[count + 1]);
-        count = count + 2;
-#ifdef PDU_DEBUG
-        printf("Crypto_Key_verify: Block %d Key ID is %d \n", x, packet.blk[x].kid);
-#endif
-        // Key Challenge
-        for (y = 0; y < CHALLENGE_SIZE; y++)
-        {
-            packet.blk[x].challenge[y] = sdls_frame.pdu.data[count++];
-        }
-#ifdef PDU_DEBUG
-        printf("\n");
-#endif
-    }
-    
+
+    // Names each key to the cryptography backend, so challenges on a key that frames or OTAR already set up reuse
+    // its key schedule
+    memset(&key_ref_sa, 0, sizeof(key_ref_sa));
+
     // Prepare for Reply
     sdls_frame.pdu.pdu_len = pdu_keys * (2 + IV_SIZE + CHALLENGE_SIZE + CHALLENGE_MAC_SIZE);
     sdls_frame.hdr.pkt_length = sdls_frame.pdu.pdu_len + 9;
     count = Crypto_Prep_Reply(ingest, 128);
 
+    // The challenges are encrypted straight out of the command blocks
     for (x = 0; x < pdu_keys; x++)
-    {   
+    {
+        blk = &(sdls_frame.pdu.data[x * SDLS_KEYV_CMD_BLK_SIZE]);
+        kid = (blk[0] << 8) | blk[1];
+#ifdef PDU_DEBUG
+        printf("Crypto_Key_verify: Block %d Key ID is %d \n", x, kid);
+#endif
+
         // Key ID
-        ingest[count++] = (packet.blk[x].kid & 0xFF00) >> 8;
-        ingest[count++] = (packet.blk[x].kid & 0x00FF);
+        ingest[count++] = (kid & 0xFF00) >> 8;
+        ingest[count++] = (kid & 0x00FF);
 
         // Get Key
-        ekp = key_if->get_key(x);
+        ekp = key_if->get_key(kid);
         if (ekp == NULL)
         {
             return CRYPTO_LIB_ERR_KEY_ID_ERROR;
         }
+        key_ref_sa.ekid = kid;
 
         // Initialization Vector
         iv_loc = count;
-        for (y = 0; y < IV_SIZE; y++)
-        {
-            ingest[count++] = *(tc_frame->tc_sec_header.iv + y);
-        }
+        memcpy(&(ingest[count]), tc_frame->tc_sec_header.iv, IV_SIZE);
+        count += IV_SIZE;
         ingest[count - 1] = ingest[count - 1] + x + 1;
 
         // Encrypt challenge
-        uint8_t ecs = CRYPTO_CIPHER_AES256_GCM;
-        cryptography_if->cryptography_aead_encrypt(&(ingest[count]), // ciphertext output
-                                                   (size_t)CHALLENGE_SIZE, // length of data
-                                                   &(packet.blk[x].challenge[0]), // plaintext input
-                                                   (size_t)CHALLENGE_SIZE, // in data length
-                                                   &(ekp->value[0]), // Key Index
-                                                   KEY_SIZE, // Key Length
-                                                   NULL, // SA Reference for key
-                                                   &(ingest[iv_loc]), // IV
-                                                   IV_SIZE, // IV Length
-                                                   &(ingest[(count + CHALLENGE_SIZE)]), // MAC
-                                                   CHALLENGE_MAC_SIZE, // MAC Size
-                                                   NULL,
-                                                   0,
-                                                   CRYPTO_TRUE, // Encrypt
-                                                   CRYPTO_TRUE, // Authenticate
-                                                   CRYPTO_FALSE, // AAD
-                                                   &ecs, // encryption cipher
-                                                   NULL,  // authentication cipher
-                                                   NULL // cam_cookies
-                                                   );
+        status = cryptography_if->cryptography_aead_encrypt(&(ingest[count]), // ciphertext output
+                                                            (size_t)CHALLENGE_SIZE, // length of data
+                                                            &(blk[2]), // plaintext input
+                                                            (size_t)CHALLENGE_SIZE, // in data length
+                                                            &(ekp->value[0]), // Key
+                                                            ekp->key_len, // Key Length
+                                                            &key_ref_sa, // SA Reference for key
+                                                            &(ingest[iv_loc]), // IV
+                                                            IV_SIZE, // IV Length
+                                                            &(ingest[(count + CHALLENGE_SIZE)]), // MAC
+                                                            CHALLENGE_MAC_SIZE, // MAC Size
+                                                            NULL,
+                                                            0,
+                                                            CRYPTO_TRUE, // Encrypt
+                                                            CRYPTO_TRUE, // Authenticate
+                                                            CRYPTO_FALSE, // AAD
+                                                            &ecs, // encryption cipher
+                                                            NULL,  // authentication cipher
+                                                            NULL // cam_cookies
+                                                            );
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            return status;
+        }
 
         count += CHALLENGE_SIZE + CHALLENGE_MAC_SIZE; // Don't forget to increment count!
     }
@@ -448,4 +560,4 @@ int32_t Crypto_Key_verify(uint8_t* ingest, TC_t* tc_frame)
 #endif
 
     return count;
-}
\ No newline at end of file
+}
@@ -20,6 +20,7 @@
 ** Includes
 */
 #include "crypto.h"
+#include "crypto_context_internal.h"
 
 /*
 ** Security Association Monitoring and Control
@@ -92,12 +93,12 @@ int32_t Crypto_MC_dump(uint8_t* ingest)
     // PDU
     for (x = 0; x < log_count; x++)
     {
-        ingest[count++] = mc_log.blk[x].emt;
+        ingest[count++] = crypto_context_current->mc_log->blk[x].emt;
         // ingest[count++] = (mc_log.blk[x].em_len & 0xFF00) >> 8;
-        ingest[count++] = (mc_log.blk[x].em_len & 0x00FF);
+        ingest[count++] = (crypto_context_current->mc_log->blk[x].em_len & 0x00FF);
         for (y = 0; y < EMV_SIZE; y++)
         {
-            ingest[count++] = mc_log.blk[x].emv[y];
+            ingest[count++] = crypto_context_current->mc_log->blk[x].emv[y];
         }
     }
 
@@ -125,11 +126,11 @@ int32_t Crypto_MC_erase(uint8_t* ingest)
     // Zero Logs
     for (x = 0; x < LOG_SIZE; x++)
     {
-        mc_log.blk[x].emt = 0;
-        mc_log.blk[x].em_len = 0;
+        crypto_context_current->mc_log->blk[x].emt = 0;
+        crypto_context_current->mc_log->blk[x].em_len = 0;
         for (y = 0; y < EMV_SIZE; y++)
         {
-            mc_log.blk[x].emv[y] = 0;
+            crypto_context_current->mc_log->blk[x].emv[y] = 0;
         }
     }
 
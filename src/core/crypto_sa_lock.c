@@ -0,0 +1,134 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/*
+** Includes
+*/
+#include "crypto.h"
+#include "crypto_context_internal.h"
+
+#include <pthread.h>
+
+/*
+** Per-SA Frame Locks
+** With Crypto_Config_Thread_Safety set, a frame that advances an SA's IV or ARSN locks the SA once it has found it,
+** and the frame function unlocks it on return, so no two frames take the same counter value. The locks live here
+** rather than in the SA, which backends persist, and are striped by SPI: SAs in different stripes never wait on each
+** other. A thread holds one stripe at a time, and lets go of it before running SDLS procedures, so a frame never
+** waits on a stripe while Crypto_Epoch_Synchronize waits on that frame. The procedures themselves run one at a time
+** under Crypto_Epoch_Writer_Lock.
+*/
+#define CRYPTO_SA_LOCK_STRIPES 256 // Must be a power of two
+#define CRYPTO_SA_LOCK_NONE -1
+
+typedef struct
+{
+    pthread_mutex_t lock;
+} __attribute__((aligned(64))) crypto_sa_lock_stripe_t; // A cache line each, neighbouring stripes do not share one
+
+/*
+** Global Variables
+*/
+static crypto_sa_lock_stripe_t crypto_sa_locks[CRYPTO_SA_LOCK_STRIPES];
+static pthread_once_t crypto_sa_lock_once = PTHREAD_ONCE_INIT;
+static __thread int32_t crypto_sa_lock_held = CRYPTO_SA_LOCK_NONE;
+
+/*
+** Local Prototypes
+*/
+static void crypto_sa_lock_init(void);
+
+/**
+ * @brief Function: Crypto_SA_Lock
+ * Locks the SA for the rest of the calling frame function, if thread safety is set. A stripe the thread already
+ * holds for another SA is let go first.
+ * @param spi: uint16
+ **/
+void Crypto_SA_Lock(uint16_t spi)
+{
+    int32_t stripe = spi & (CRYPTO_SA_LOCK_STRIPES - 1);
+
+    if ((crypto_config.thread_safe != CRYPTO_THREAD_SAFE_TRUE) || (crypto_sa_lock_held == stripe))
+    {
+        return;
+    }
+    Crypto_SA_Unlock();
+    pthread_once(&crypto_sa_lock_once, crypto_sa_lock_init);
+    pthread_mutex_lock(&crypto_sa_locks[stripe].lock);
+    crypto_sa_lock_held = stripe;
+}
+
+/**
+ * @brief Function: Crypto_SA_Unlock
+ * Lets go of the SA the calling thread locked, if any
+ **/
+void Crypto_SA_Unlock(void)
+{
+    if (crypto_sa_lock_held == CRYPTO_SA_LOCK_NONE)
+    {
+        return;
+    }
+    pthread_mutex_unlock(&crypto_sa_locks[crypto_sa_lock_held].lock);
+    crypto_sa_lock_held = CRYPTO_SA_LOCK_NONE;
+}
+
+/**
+ * @brief Function: Crypto_SA_Lock_Other
+ * For backends that copy SAs frames may be advancing, e.g. a checkpoint run from sa_save_sa. Waits for frames on the
+ * SA to finish its update unless the calling thread already holds the SA's stripe.
+ * @param spi: uint16
+ * @return uint8: CRYPTO_TRUE if the stripe was locked, to hand to Crypto_SA_Unlock_Other
+ **/
+uint8_t Crypto_SA_Lock_Other(uint16_t spi)
+{
+    int32_t stripe = spi & (CRYPTO_SA_LOCK_STRIPES - 1);
+
+    if ((crypto_config.thread_safe != CRYPTO_THREAD_SAFE_TRUE) || (crypto_sa_lock_held == stripe))
+    {
+        return CRYPTO_FALSE;
+    }
+    pthread_once(&crypto_sa_lock_once, crypto_sa_lock_init);
+    pthread_mutex_lock(&crypto_sa_locks[stripe].lock);
+    return CRYPTO_TRUE;
+}
+
+/**
+ * @brief Function: Crypto_SA_Unlock_Other
+ * @param spi: uint16
+ * @param locked: uint8, as returned by Crypto_SA_Lock_Other
+ **/
+void Crypto_SA_Unlock_Other(uint16_t spi, uint8_t locked)
+{
+    if (locked)
+    {
+        pthread_mutex_unlock(&crypto_sa_locks[spi & (CRYPTO_SA_LOCK_STRIPES - 1)].lock);
+    }
+}
+
+/**
+ * @brief Function: crypto_sa_lock_init
+ **/
+static void crypto_sa_lock_init(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < CRYPTO_SA_LOCK_STRIPES; i++)
+    {
+        pthread_mutex_init(&crypto_sa_locks[i].lock, NULL);
+    }
+}
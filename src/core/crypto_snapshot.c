@@ -0,0 +1,524 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/*
+** Includes
+*/
+#include "crypto.h"
+#include "crypto_context_internal.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+** Runtime State Snapshots
+** A snapshot is a single image holding the CryptoLib configuration, the managed parameters, the key ring and the
+** SA table with its current IV / ARSN counters. Records are stored as this build lays them out, so an image is only
+** accepted by a build with the same record sizes; the header CRC covers everything after the header.
+**
+**   crypto_snapshot_header_t
+**   CryptoConfig_t
+**   crypto_snapshot_gvcid_t[num_gvcids]
+**   crypto_snapshot_key_t[num_keys]
+**   crypto_snapshot_sa_t[num_sas]
+**
+** Each section starts on an 8 byte boundary. Loading maps the image and keeps it mapped until Crypto_Shutdown,
+** since restored SAs reference their key reference strings in place.
+*/
+#define CRYPTO_SNAPSHOT_MAGIC 0x50414E53 // "SNAP"
+#define CRYPTO_SNAPSHOT_VERSION 1
+#define CRYPTO_SNAPSHOT_KEY_REF_SIZE 256 // Longest ek_ref / ak_ref kept, including the terminator
+#define CRYPTO_SNAPSHOT_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t crc;        // CRC-32 of the image after the header
+    uint32_t image_size; // Including the header
+    uint32_t config_size;
+    uint32_t gvcid_size;
+    uint32_t key_size;
+    uint32_t sa_size;
+    uint32_t num_gvcids;
+    uint32_t num_keys;
+    uint32_t num_sas;
+    uint32_t reserved;
+} crypto_snapshot_header_t;
+
+typedef struct
+{
+    uint16_t scid;
+    uint16_t aos_iz_len;
+    uint16_t max_frame_size;
+    uint8_t tfvn;
+    uint8_t vcid;
+    uint8_t has_fecf;
+    uint8_t aos_has_fhec;
+    uint8_t aos_has_iz;
+    uint8_t has_segmentation_hdr;
+    uint8_t has_ocf;
+} crypto_snapshot_gvcid_t;
+
+typedef struct
+{
+    uint32_t key_id;
+    crypto_key_t key;
+} crypto_snapshot_key_t;
+
+typedef struct
+{
+    SecurityAssociation_t sa; // abm, ek_ref and ak_ref are stored below, the pointers are cleared
+    uint8_t abm[ABM_SIZE];
+    char ek_ref[CRYPTO_SNAPSHOT_KEY_REF_SIZE];
+    char ak_ref[CRYPTO_SNAPSHOT_KEY_REF_SIZE];
+} crypto_snapshot_sa_t;
+
+typedef struct
+{
+    size_t config;
+    size_t gvcids;
+    size_t keys;
+    size_t sas;
+    size_t end;
+} crypto_snapshot_layout_t;
+
+static uint8_t* crypto_snapshot_image = NULL;
+static size_t crypto_snapshot_image_size = 0;
+
+/*
+** Local Prototypes
+*/
+static void crypto_snapshot_layout(const crypto_snapshot_header_t* header, crypto_snapshot_layout_t* layout);
+static uint32_t crypto_snapshot_crc32(const uint8_t* data, size_t len);
+static void crypto_snapshot_advance(uint8_t* num, uint8_t len, uint32_t count);
+static int32_t crypto_snapshot_write(const char* path, const uint8_t* image, size_t image_size);
+static int32_t crypto_snapshot_restore_managed_parameters(const crypto_snapshot_gvcid_t* gvcids, uint32_t num_gvcids);
+
+/**
+ * @brief Function: Crypto_Snapshot_Save
+ * Writes the complete runtime state to path. The file is replaced atomically, so a crash while saving leaves the
+ * previous snapshot in place.
+ * @param path: const char*
+ * @return int32: Success/Failure
+ * @note SA backends that persist SAs themselves (MariaDB, SQLite, shared memory) have no SAs in the snapshot
+ **/
+int32_t Crypto_Snapshot_Save(const char* path)
+{
+    crypto_snapshot_header_t header;
+    crypto_snapshot_layout_t layout;
+    crypto_snapshot_gvcid_t* gvcid_rec;
+    crypto_snapshot_key_t* key_rec;
+    crypto_snapshot_sa_t* sa_rec;
+    GvcidManagedParameters_t* mp;
+    SecurityAssociation_t* sa_ptr = NULL;
+    crypto_key_t* key;
+    uint8_t* image;
+    uint32_t i;
+    int32_t status;
+
+    if (path == NULL)
+    {
+        return CRYPTO_SNAPSHOT_FILE_ERROR;
+    }
+    if ((crypto_config.init_status == UNITIALIZED) || (sa_if == NULL) || (key_if == NULL))
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = CRYPTO_SNAPSHOT_MAGIC;
+    header.version = CRYPTO_SNAPSHOT_VERSION;
+    header.config_size = CRYPTO_CONFIG_SIZE;
+    header.gvcid_size = sizeof(crypto_snapshot_gvcid_t);
+    header.key_size = sizeof(crypto_snapshot_key_t);
+    header.sa_size = sizeof(crypto_snapshot_sa_t);
+
+    Crypto_Epoch_Enter();
+    for (mp = gvcid_managed_parameters; mp != NULL; mp = mp->next)
+    {
+        header.num_gvcids++;
+    }
+    // The KMC key ring has no local keys and complains on every get_key
+    if (crypto_config.key_type != KEY_TYPE_KMC)
+    {
+        for (i = 0; i < NUM_KEYS; i++)
+        {
+            if (key_if->get_key(i) != NULL)
+            {
+                header.num_keys++;
+            }
+        }
+    }
+    if (sa_if->sa_get_from_index != NULL)
+    {
+        while (sa_if->sa_get_from_index(header.num_sas, &sa_ptr) == CRYPTO_LIB_SUCCESS)
+        {
+            header.num_sas++;
+        }
+    }
+
+    crypto_snapshot_layout(&header, &layout);
+    header.image_size = (uint32_t)layout.end;
+    image = (uint8_t*)calloc(1, layout.end);
+    if (image == NULL)
+    {
+        Crypto_Epoch_Exit();
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+
+    memcpy(image + layout.config, &crypto_config, CRYPTO_CONFIG_SIZE);
+
+    gvcid_rec = (crypto_snapshot_gvcid_t*)(image + layout.gvcids);
+    for (mp = gvcid_managed_parameters; mp != NULL; mp = mp->next, gvcid_rec++)
+    {
+        gvcid_rec->tfvn = mp->tfvn;
+        gvcid_rec->scid = mp->scid;
+        gvcid_rec->vcid = mp->vcid;
+        gvcid_rec->has_fecf = mp->has_fecf;
+        gvcid_rec->aos_has_fhec = mp->aos_has_fhec;
+        gvcid_rec->aos_has_iz = mp->aos_has_iz;
+        gvcid_rec->aos_iz_len = mp->aos_iz_len;
+        gvcid_rec->has_segmentation_hdr = mp->has_segmentation_hdr;
+        gvcid_rec->max_frame_size = mp->max_frame_size;
+        gvcid_rec->has_ocf = mp->has_ocf;
+    }
+
+    key_rec = (crypto_snapshot_key_t*)(image + layout.keys);
+    for (i = 0; (i < NUM_KEYS) && (key_rec < (crypto_snapshot_key_t*)(image + layout.sas)); i++)
+    {
+        key = (crypto_config.key_type != KEY_TYPE_KMC) ? key_if->get_key(i) : NULL;
+        if (key != NULL)
+        {
+            key_rec->key_id = i;
+            key_rec->key = *key;
+            key_rec++;
+        }
+    }
+
+    // SAs added since they were counted are left for the next snapshot
+    sa_rec = (crypto_snapshot_sa_t*)(image + layout.sas);
+    for (i = 0; i < header.num_sas; i++, sa_rec++)
+    {
+        if (sa_if->sa_get_from_index(i, &sa_ptr) != CRYPTO_LIB_SUCCESS)
+        {
+            break;
+        }
+        sa_rec->sa = *sa_ptr;
+        sa_rec->sa.abm = NULL;
+        sa_rec->sa.abm_idx = 0;
+        sa_rec->sa.ek_ref = NULL;
+        sa_rec->sa.ak_ref = NULL;
+        if (sa_ptr->abm != NULL)
+        {
+            memcpy(sa_rec->abm, sa_ptr->abm, ABM_SIZE);
+        }
+        if (sa_ptr->ek_ref != NULL)
+        {
+            strncpy(sa_rec->ek_ref, sa_ptr->ek_ref, CRYPTO_SNAPSHOT_KEY_REF_SIZE - 1);
+        }
+        if (sa_ptr->ak_ref != NULL)
+        {
+            strncpy(sa_rec->ak_ref, sa_ptr->ak_ref, CRYPTO_SNAPSHOT_KEY_REF_SIZE - 1);
+        }
+    }
+    Crypto_Epoch_Exit();
+
+    header.crc = crypto_snapshot_crc32(image + sizeof(header), layout.end - sizeof(header));
+    memcpy(image, &header, sizeof(header));
+    status = crypto_snapshot_write(path, image, layout.end);
+    free(image);
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Snapshot_Load
+ * Configures and initializes CryptoLib from a snapshot, in place of the Crypto_Config_* and Crypto_Init calls.
+ * Configuration blocks that hold paths or credentials (MariaDB, SA store files, KMC, CAM) are not part of a snapshot
+ * and must still be set beforehand when the snapshot's SA or cryptography type needs them.
+ * @param path: const char*
+ * @param counter_skip: uint32, advances every IV and ARSN by this many frames to cover frames sent after the
+ * snapshot was written. 0 resumes with the saved counters, e.g. for a snapshot written at shutdown.
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Snapshot_Load(const char* path, uint32_t counter_skip)
+{
+    const crypto_snapshot_header_t* header;
+    const crypto_snapshot_key_t* key_rec;
+    const crypto_snapshot_sa_t* sa_rec;
+    crypto_snapshot_layout_t layout;
+    SecurityAssociation_t sa;
+    crypto_key_t* key;
+    struct stat st;
+    uint32_t i;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    int fd;
+
+    if (path == NULL)
+    {
+        return CRYPTO_SNAPSHOT_FILE_ERROR;
+    }
+    Crypto_Snapshot_Release();
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return CRYPTO_SNAPSHOT_FILE_ERROR;
+    }
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(crypto_snapshot_header_t)))
+    {
+        close(fd);
+        return CRYPTO_SNAPSHOT_INVALID;
+    }
+    crypto_snapshot_image = (uint8_t*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (crypto_snapshot_image == MAP_FAILED)
+    {
+        crypto_snapshot_image = NULL;
+        return CRYPTO_SNAPSHOT_FILE_ERROR;
+    }
+    crypto_snapshot_image_size = st.st_size;
+
+    header = (const crypto_snapshot_header_t*)crypto_snapshot_image;
+    crypto_snapshot_layout(header, &layout);
+    if ((header->magic != CRYPTO_SNAPSHOT_MAGIC) || (header->version != CRYPTO_SNAPSHOT_VERSION) ||
+        (header->config_size != CRYPTO_CONFIG_SIZE) || (header->gvcid_size != sizeof(crypto_snapshot_gvcid_t)) ||
+        (header->key_size != sizeof(crypto_snapshot_key_t)) || (header->sa_size != sizeof(crypto_snapshot_sa_t)) ||
+        (header->image_size != crypto_snapshot_image_size) || (layout.end != crypto_snapshot_image_size) ||
+        (header->crc != crypto_snapshot_crc32(crypto_snapshot_image + sizeof(crypto_snapshot_header_t),
+                                              crypto_snapshot_image_size - sizeof(crypto_snapshot_header_t))))
+    {
+        Crypto_Snapshot_Release();
+        return CRYPTO_SNAPSHOT_INVALID;
+    }
+    // Configuration
+    memcpy(&crypto_config, crypto_snapshot_image + layout.config, CRYPTO_CONFIG_SIZE);
+    crypto_config.init_status = INITIALIZED;
+    status = crypto_snapshot_restore_managed_parameters(
+        (const crypto_snapshot_gvcid_t*)(crypto_snapshot_image + layout.gvcids), header->num_gvcids);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = Crypto_Init();
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        Crypto_Snapshot_Release();
+        return status;
+    }
+
+    // No frame can be in flight before Crypto_Init returns, so the key ring is written in place
+    key_rec = (const crypto_snapshot_key_t*)(crypto_snapshot_image + layout.keys);
+    for (i = 0; i < header->num_keys; i++, key_rec++)
+    {
+        key = key_if->get_key(key_rec->key_id);
+        if (key != NULL)
+        {
+            *key = key_rec->key;
+        }
+    }
+
+    if ((header->num_sas > 0) && (sa_if->sa_insert == NULL))
+    {
+        return CRYPTO_SNAPSHOT_INVALID;
+    }
+    sa_rec = (const crypto_snapshot_sa_t*)(crypto_snapshot_image + layout.sas);
+    for (i = 0; (i < header->num_sas) && (status == CRYPTO_LIB_SUCCESS); i++, sa_rec++)
+    {
+        sa = sa_rec->sa;
+        sa.abm = sa_rec->abm;
+        sa.ek_ref = (sa_rec->ek_ref[0] != '\0') ? (char*)sa_rec->ek_ref : NULL;
+        sa.ak_ref = (sa_rec->ak_ref[0] != '\0') ? (char*)sa_rec->ak_ref : NULL;
+        if (counter_skip > 0)
+        {
+            crypto_snapshot_advance(sa.iv, sa.iv_len, counter_skip);
+            crypto_snapshot_advance(sa.arsn, sa.arsn_len, counter_skip);
+        }
+        status = sa_if->sa_insert(&sa);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_Snapshot_Release
+ * Unmaps the snapshot loaded by Crypto_Snapshot_Load. Called from Crypto_Shutdown, once no SA references it.
+ **/
+void Crypto_Snapshot_Release(void)
+{
+    if (crypto_snapshot_image != NULL)
+    {
+        munmap(crypto_snapshot_image, crypto_snapshot_image_size);
+        crypto_snapshot_image = NULL;
+        crypto_snapshot_image_size = 0;
+    }
+}
+
+/**
+ * @brief Function: crypto_snapshot_layout
+ * @param header: const crypto_snapshot_header_t*
+ * @param layout: crypto_snapshot_layout_t*, section offsets and image size for the counts in header
+ **/
+static void crypto_snapshot_layout(const crypto_snapshot_header_t* header, crypto_snapshot_layout_t* layout)
+{
+    layout->config = CRYPTO_SNAPSHOT_ALIGN(sizeof(crypto_snapshot_header_t));
+    layout->gvcids = CRYPTO_SNAPSHOT_ALIGN(layout->config + CRYPTO_CONFIG_SIZE);
+    layout->keys = CRYPTO_SNAPSHOT_ALIGN(layout->gvcids + (size_t)header->num_gvcids * sizeof(crypto_snapshot_gvcid_t));
+    layout->sas = CRYPTO_SNAPSHOT_ALIGN(layout->keys + (size_t)header->num_keys * sizeof(crypto_snapshot_key_t));
+    layout->end = layout->sas + (size_t)header->num_sas * sizeof(crypto_snapshot_sa_t);
+}
+
+/**
+ * @brief Function: crypto_snapshot_crc32
+ * @param data: const uint8_t*
+ * @param len: size_t
+ * @return uint32_t: CRC-32 of data
+ **/
+static uint32_t crypto_snapshot_crc32(const uint8_t* data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    size_t i;
+
+    // crc32Table is filled by Crypto_Init, which may not have run yet when loading
+    Crypto_Calc_CRC_Init_Table();
+    for (i = 0; i < len; i++)
+    {
+        crc = (crc >> 8) ^ crc32Table[(crc ^ data[i]) & 0xFF];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+/**
+ * @brief Function: crypto_snapshot_advance
+ * Adds count to a big-endian counter, equivalent to count calls of Crypto_increment
+ * @param num: uint8_t*
+ * @param len: uint8_t
+ * @param count: uint32_t
+ **/
+static void crypto_snapshot_advance(uint8_t* num, uint8_t len, uint32_t count)
+{
+    uint64_t carry = count;
+    int i;
+
+    for (i = (int)len - 1; (i >= 0) && (carry > 0); i--)
+    {
+        carry += num[i];
+        num[i] = (uint8_t)carry;
+        carry >>= 8;
+    }
+}
+
+/**
+ * @brief Function: crypto_snapshot_write
+ * Writes the image next to path, syncs it, then renames it over path
+ * @param path: const char*
+ * @param image: const uint8_t*
+ * @param image_size: size_t
+ * @return int32: Success/Failure
+ **/
+static int32_t crypto_snapshot_write(const char* path, const uint8_t* image, size_t image_size)
+{
+    char* tmp_path;
+    size_t written = 0;
+    ssize_t rc;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    int fd;
+
+    tmp_path = (char*)malloc(strlen(path) + 5);
+    if (tmp_path == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    sprintf(tmp_path, "%s.tmp", path);
+
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        free(tmp_path);
+        return CRYPTO_SNAPSHOT_FILE_ERROR;
+    }
+    while (written < image_size)
+    {
+        rc = write(fd, image + written, image_size - written);
+        if (rc <= 0)
+        {
+            status = CRYPTO_SNAPSHOT_FILE_ERROR;
+            break;
+        }
+        written += (size_t)rc;
+    }
+    if ((status == CRYPTO_LIB_SUCCESS) && (fsync(fd) != 0))
+    {
+        status = CRYPTO_SNAPSHOT_FILE_ERROR;
+    }
+    close(fd);
+    if ((status == CRYPTO_LIB_SUCCESS) && (rename(tmp_path, path) != 0))
+    {
+        status = CRYPTO_SNAPSHOT_FILE_ERROR;
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    return status;
+}
+
+/**
+ * @brief Function: crypto_snapshot_restore_managed_parameters
+ * Replaces the managed parameter list with the snapshot's, appending in order without walking the list per entry
+ * @param gvcids: const crypto_snapshot_gvcid_t*
+ * @param num_gvcids: uint32_t
+ * @return int32: Success/Failure
+ **/
+static int32_t crypto_snapshot_restore_managed_parameters(const crypto_snapshot_gvcid_t* gvcids, uint32_t num_gvcids)
+{
+    GvcidManagedParameters_t** tail;
+    GvcidManagedParameters_t* mp;
+    uint32_t i;
+
+    current_managed_parameters = NULL;
+    if (gvcid_managed_parameters != NULL)
+    {
+        Crypto_Free_Managed_Parameters(gvcid_managed_parameters);
+        gvcid_managed_parameters = NULL;
+    }
+
+    tail = &gvcid_managed_parameters;
+    for (i = 0; i < num_gvcids; i++)
+    {
+        mp = (GvcidManagedParameters_t*)calloc(1, GVCID_MANAGED_PARAMETERS_SIZE);
+        if (mp == NULL)
+        {
+            return CRYPTO_LIB_ERR_NULL_BUFFER;
+        }
+        mp->tfvn = gvcids[i].tfvn;
+        mp->scid = gvcids[i].scid;
+        mp->vcid = gvcids[i].vcid;
+        mp->has_fecf = gvcids[i].has_fecf;
+        mp->aos_has_fhec = gvcids[i].aos_has_fhec;
+        mp->aos_has_iz = gvcids[i].aos_has_iz;
+        mp->aos_iz_len = gvcids[i].aos_iz_len;
+        mp->has_segmentation_hdr = gvcids[i].has_segmentation_hdr;
+        mp->max_frame_size = gvcids[i].max_frame_size;
+        mp->has_ocf = gvcids[i].has_ocf;
+        *tail = mp;
+        tail = &mp->next;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
@@ -20,11 +20,17 @@
 ** Includes
 */
 #include "crypto.h"
+#include "crypto_context_internal.h"
 
 #include <string.h> // memcpy
 
 /* Helper functions */
+static int32_t crypto_tc_apply_security(const uint8_t* p_in_frame, const uint16_t in_frame_length,
+                                        uint8_t** pp_in_frame, uint16_t* p_enc_frame_len, char* cam_cookies);
+static int32_t crypto_tc_process_security(uint8_t* ingest, int* len_ingest, TC_t* tc_sdls_processed_frame,
+                                          char* cam_cookies);
 static int32_t crypto_tc_validate_sa(SecurityAssociation_t* sa);
+static void crypto_tc_prefetch_sa(const TcBatchFrame_t* frame);
 static int32_t crypto_handle_incrementing_nontransmitted_counter(uint8_t* dest, uint8_t* src, int src_full_len, int transmitted_len, int window);
 
 /**
@@ -54,6 +60,72 @@ int32_t Crypto_TC_ApplySecurity(const uint8_t* p_in_frame, const uint16_t in_fra
  **/
 int32_t Crypto_TC_ApplySecurity_Cam(const uint8_t* p_in_frame, const uint16_t in_frame_length, uint8_t** pp_in_frame,
                                     uint16_t* p_enc_frame_len, char* cam_cookies)
+{
+    int32_t status;
+
+    // SA and key records used by this frame stay valid, and unchanged by SDLS procedures, until it is done
+    Crypto_Epoch_Enter();
+    status = crypto_tc_apply_security(p_in_frame, in_frame_length, pp_in_frame, p_enc_frame_len, cam_cookies);
+    Crypto_SA_Unlock();
+    Crypto_Epoch_Exit();
+    return status;
+}
+
+/**
+ * @brief Function: Crypto_TC_ApplySecurity_Batch
+ * Applies Security to each frame in turn. With an SA backend that supports it, the SA of the next frame is looked up
+ * and the counters of earlier frames are saved while a frame is being encrypted.
+ * @param frames: TcBatchFrame_t*
+ * @param num_frames: uint32
+ * @return int32: First failure of a frame or of the backend's deferred saves, Success otherwise
+ **/
+int32_t Crypto_TC_ApplySecurity_Batch(TcBatchFrame_t* frames, uint32_t num_frames)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    int32_t batch_status = CRYPTO_LIB_SUCCESS;
+    uint32_t i;
+
+    if ((frames == NULL) && (num_frames > 0))
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    if ((crypto_config.init_status == UNITIALIZED) || (sa_if == NULL))
+    {
+        return CRYPTO_LIB_ERR_NO_CONFIG;
+    }
+
+    if (sa_if->sa_batch_begin != NULL)
+    {
+        batch_status = sa_if->sa_batch_begin();
+    }
+    if ((num_frames > 0) && (batch_status == CRYPTO_LIB_SUCCESS))
+    {
+        crypto_tc_prefetch_sa(&frames[0]);
+    }
+    for (i = 0; i < num_frames; i++)
+    {
+        if ((i + 1 < num_frames) && (batch_status == CRYPTO_LIB_SUCCESS))
+        {
+            crypto_tc_prefetch_sa(&frames[i + 1]);
+        }
+        frames[i].enc_frame = NULL;
+        frames[i].enc_frame_length = 0;
+        frames[i].status = Crypto_TC_ApplySecurity(frames[i].in_frame, frames[i].in_frame_length,
+                                                   &frames[i].enc_frame, &frames[i].enc_frame_length);
+        if ((frames[i].status != CRYPTO_LIB_SUCCESS) && (status == CRYPTO_LIB_SUCCESS))
+        {
+            status = frames[i].status;
+        }
+    }
+    if ((sa_if->sa_batch_end != NULL) && (batch_status == CRYPTO_LIB_SUCCESS))
+    {
+        batch_status = sa_if->sa_batch_end();
+    }
+    return (status != CRYPTO_LIB_SUCCESS) ? status : batch_status;
+}
+
+static int32_t crypto_tc_apply_security(const uint8_t* p_in_frame, const uint16_t in_frame_length,
+                                        uint8_t** pp_in_frame, uint16_t* p_enc_frame_len, char* cam_cookies)
 {
     // Local Variables
     int32_t status = CRYPTO_LIB_SUCCESS;
@@ -167,14 +239,16 @@ int32_t Crypto_TC_ApplySecurity_Cam(const uint8_t* p_in_frame, const uint16_t in
 
     if (status == CRYPTO_LIB_SUCCESS)
     {
-        status = sa_if->sa_get_operational_sa_from_gvcid(temp_tc_header.tfvn, temp_tc_header.scid,
-                                                         temp_tc_header.vcid, map_id, &sa_ptr);
+        status = Crypto_Get_Operational_SA(temp_tc_header.tfvn, temp_tc_header.scid, temp_tc_header.vcid, map_id,
+                                           &sa_ptr);
         // If unable to get operational SA, can return
         if (status != CRYPTO_LIB_SUCCESS)
         {
             mc_if->mc_log(status);
             return status;
         }
+        // Held until Crypto_TC_ApplySecurity_Cam returns, the IV and ARSN are advanced below
+        Crypto_SA_Lock(sa_ptr->spi);
 
         // Try to assure SA is sane
         status = crypto_tc_validate_sa(sa_ptr);
@@ -822,6 +896,18 @@ int32_t Crypto_TC_ProcessSecurity(uint8_t* ingest, int* len_ingest, TC_t* tc_sdl
  * @return int32: Success/Failure
 **/
 int32_t Crypto_TC_ProcessSecurity_Cam(uint8_t* ingest, int* len_ingest, TC_t* tc_sdls_processed_frame, char* cam_cookies)
+{
+    int32_t status;
+
+    Crypto_Epoch_Enter();
+    status = crypto_tc_process_security(ingest, len_ingest, tc_sdls_processed_frame, cam_cookies);
+    Crypto_SA_Unlock();
+    Crypto_Epoch_Exit();
+    return status;
+}
+
+static int32_t crypto_tc_process_security(uint8_t* ingest, int* len_ingest, TC_t* tc_sdls_processed_frame,
+                                          char* cam_cookies)
 // Loads the ingest frame into the global tc_frame while performing decryption
 {
     // Local Variables
@@ -901,6 +987,8 @@ int32_t Crypto_TC_ProcessSecurity_Cam(uint8_t* ingest, int* len_ingest, TC_t* tc
     printf("vcid = %d \n", tc_sdls_processed_frame->tc_header.vcid);
     printf("spi  = %d \n", tc_sdls_processed_frame->tc_sec_header.spi);
 #endif
+    // Held until Crypto_TC_ProcessSecurity_Cam returns, the anti-replay check and the ARSN update are one step
+    Crypto_SA_Lock(tc_sdls_processed_frame->tc_sec_header.spi);
     status = sa_if->sa_get_from_spi(tc_sdls_processed_frame->tc_sec_header.spi, &sa_ptr);
     // If no valid SPI, return
     if (status != CRYPTO_LIB_SUCCESS)
@@ -1279,18 +1367,28 @@ int32_t Crypto_TC_ProcessSecurity_Cam(uint8_t* ingest, int* len_ingest, TC_t* tc
     }
     else
     {
-        if (crypto_config.sa_type == SA_TYPE_MARIADB)
+        if ((crypto_config.sa_type == SA_TYPE_MARIADB) || (crypto_config.sa_type == SA_TYPE_SQLITE) ||
+            (crypto_config.sa_type == SA_TYPE_SHM))
         {
             if (sa_ptr->ek_ref != NULL)
                 free(sa_ptr->ek_ref);
+            if (sa_ptr->ak_ref != NULL)
+                free(sa_ptr->ak_ref);
+            Crypto_SA_Release_ABM(sa_ptr);
             free(sa_ptr);
         }
     }
 
-    // Extended PDU processing, if applicable
+    // SDLS procedures may wait on frames in other threads, which may be waiting on this SA
+    Crypto_SA_Unlock();
+
+    // Extended PDU processing, if applicable. Procedures from frames on other threads run one at a time, each may wait
+    // for the others' frames to end.
     if (status == CRYPTO_LIB_SUCCESS && crypto_config.process_sdls_pdus == TC_PROCESS_SDLS_PDUS_TRUE)
     {
+        Crypto_Epoch_Writer_Lock();
         status = Crypto_Process_Extended_Procedure_Pdu(tc_sdls_processed_frame, ingest);
+        Crypto_Epoch_Writer_Unlock();
     }
     if (!aad) free(aad);
     mc_if->mc_log(status);
@@ -1336,9 +1434,9 @@ fecf))); #endif
  * Note: Function caller is responsible for freeing the returned buffer!
  * @param buffer: uint8_t*
  * @param len_aad: uint16_t
- * @param abm_buffer: uint8_t*
+ * @param abm_buffer: const uint8_t*
 **/
-uint8_t* Crypto_Prepare_TC_AAD(uint8_t* buffer, uint16_t len_aad, uint8_t* abm_buffer)
+uint8_t* Crypto_Prepare_TC_AAD(uint8_t* buffer, uint16_t len_aad, const uint8_t* abm_buffer)
 {
     uint8_t* aad = (uint8_t*)calloc(1, len_aad * sizeof(uint8_t));
     int i;
@@ -1402,6 +1500,40 @@ static int32_t crypto_tc_validate_sa(SecurityAssociation_t* sa)
     return CRYPTO_LIB_SUCCESS;
 }
 
+/**
+ * @brief Function: crypto_tc_prefetch_sa
+ * Passes the GVCID a batch frame will be looked up with to the SA backend. Frames that would fail are left to
+ * Crypto_TC_ApplySecurity.
+ * @param frame: const TcBatchFrame_t*
+ **/
+static void crypto_tc_prefetch_sa(const TcBatchFrame_t* frame)
+{
+    GvcidManagedParameters_t* mp = NULL;
+    uint8_t tfvn;
+    uint16_t scid;
+    uint16_t vcid;
+    uint8_t map_id = 0;
+
+    if ((sa_if->sa_prefetch_operational_sa_from_gvcid == NULL) || (frame->in_frame == NULL) ||
+        (frame->in_frame_length < 6))
+    {
+        return;
+    }
+    tfvn = ((uint8_t)frame->in_frame[0] & 0xC0) >> 6;
+    scid = (((uint8_t)frame->in_frame[0] & 0x03) << 8) | (uint8_t)frame->in_frame[1];
+    vcid = ((uint8_t)frame->in_frame[2] & 0xFC) >> 2 & crypto_config.vcid_bitmask;
+    if (Crypto_Get_Managed_Parameters_For_Gvcid(tfvn, scid, vcid, gvcid_managed_parameters, &mp) !=
+        CRYPTO_LIB_SUCCESS)
+    {
+        return;
+    }
+    if (mp->has_segmentation_hdr == TC_HAS_SEGMENT_HDRS)
+    {
+        map_id = frame->in_frame[5] & 0x3F;
+    }
+    sa_if->sa_prefetch_operational_sa_from_gvcid(tfvn, scid, vcid, map_id);
+}
+
 static int32_t crypto_handle_incrementing_nontransmitted_counter(uint8_t* dest, uint8_t* src, int src_full_len, int transmitted_len, int window)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
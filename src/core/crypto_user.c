@@ -20,6 +20,7 @@
 ** Includes
 */
 #include "crypto.h"
+#include "crypto_context_internal.h"
 
 /**
  * @brief Function: Crypto_User_IdleTrigger
@@ -125,29 +126,31 @@ int32_t Crypto_User_ModifyKey(void)
     uint8_t mod = (uint8_t)sdls_frame.pdu.data[2];
 
     crypto_key_t* ekp = NULL;
+    crypto_key_t new_key;
 
     ekp = key_if->get_key(kid);
     if (ekp == NULL)
     {
         return CRYPTO_LIB_ERR_KEY_ID_ERROR;
     }
+    new_key = *ekp;
 
     switch (mod)
     {
     case 1: // Invalidate Key
-        ekp->value[KEY_SIZE - 1]++;
+        new_key.value[KEY_SIZE - 1]++;
         printf("Key %d value invalidated! \n", kid);
         break;
     case 2: // Modify key state
-        ekp->key_state = (uint8_t)sdls_frame.pdu.data[3] & 0x0F;
+        new_key.key_state = (uint8_t)sdls_frame.pdu.data[3] & 0x0F;
         printf("Key %d state changed to %d! \n", kid, mod);
         break;
     default:
         // Error
-        break;
+        return CRYPTO_LIB_SUCCESS;
     }
 
-    return CRYPTO_LIB_SUCCESS;
+    return Crypto_Key_Publish(kid, &new_key);
 }
 
 /**
@@ -174,10 +177,16 @@ int32_t Crypto_User_ModifyVCID(void)
     SecurityAssociation_t* sa_ptr;
     int i;
     int j;
+    int32_t status;
 
     for (i = 0; i < NUM_GVCID; i++)
     {
-        if (sa_if->sa_get_from_spi(i, &sa_ptr) != CRYPTO_LIB_SUCCESS)
+        status = sa_if->sa_get_from_spi(i, &sa_ptr);
+        if (status == SADB_SPI_NOT_FOUND)
+        {
+            continue; // SPI not configured, no channel to match
+        }
+        if (status != CRYPTO_LIB_SUCCESS)
         {
             // TODO - Error handling
             return CRYPTO_LIB_ERROR; // Error -- unable to get SA from SPI.
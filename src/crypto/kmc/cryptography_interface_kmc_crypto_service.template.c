@@ -15,9 +15,12 @@
 #include "crypto_error.h"
 #include "cryptography_interface.h"
 #include "crypto.h"
+#include "crypto_context_internal.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 #include <curl/curl.h>
 
@@ -29,6 +32,18 @@
 
 #define CAM_MAX_AUTH_RETRIES 4
 
+// CAM SSO token cache refresh timing (seconds)
+#define CAM_TOKEN_REFRESH_MARGIN 300     // Refresh this long before the earliest cached cookie expires
+#define CAM_TOKEN_DEFAULT_LIFETIME 3600  // Assumed lifetime when CAM only issues session cookies
+#define CAM_TOKEN_RETRY_MIN 5            // First back-off after a failed refresh
+#define CAM_TOKEN_RETRY_MAX 300          // Back-off ceiling for repeated failed refreshes
+
+// KMC Crypto Service endpoint routing
+#define KMC_LATENCY_WINDOW 128           // Recent latency samples kept per endpoint for the p99 estimate
+#define KMC_EWMA_ALPHA 0.2               // Weight of the newest sample in latency/error EWMAs
+#define KMC_ERROR_PENALTY 4.0            // Latency multiplier per unit of EWMA error rate when ranking endpoints
+#define KMC_ENDPOINT_PROBE_INTERVAL 100  // Re-measure an endpoint not used for this many requests
+
 // libcurl call-back response handling Structures
 typedef struct {
     char* response;
@@ -41,6 +56,39 @@ typedef struct  {
 } memory_read;
 #define MEMORY_READ_SIZE (sizeof(memory_read))
 
+// KMC Crypto Service endpoint (primary or replica) with its routing statistics
+typedef struct {
+    char* root_uri;
+    uint16_t port;
+    double ewma_latency_ms;
+    double ewma_error_rate;
+    uint32_t num_requests;
+    uint32_t num_errors;
+    uint32_t num_hedges_sent;
+    uint32_t num_hedges_won;
+    uint64_t last_used_request;
+    double latency_samples[KMC_LATENCY_WINDOW];
+    uint32_t num_samples;
+    uint32_t next_sample;
+} kmc_endpoint_t;
+
+// CAM SSO token cache, shared between the frame path and the background refresh thread
+typedef struct {
+    char* cookies;           // Cookie header value ("name=value; name=value"), NULL if nothing cached
+    time_t expiry;           // Earliest expiry of the cached cookies, 0 if unknown (session cookies)
+    time_t next_refresh;     // When the refresh thread should next log in
+    uint32_t retry_interval; // Current back-off after failed refreshes
+    uint32_t refresh_count;
+    uint32_t refresh_failure_count;
+    uint8_t refresh_in_flight;    // A getSsoToken login is under way, others wait for its result
+    uint32_t refresh_generation;  // Bumped each time a login completes
+    int32_t last_refresh_status;
+    uint8_t refresh_thread_running;
+    pthread_t refresh_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} cam_token_cache_t;
+
 // Cryptography Interface Initialization & Management Functions
 static int32_t cryptography_config(void);
 static int32_t cryptography_init(void);
@@ -98,12 +146,28 @@ static int32_t cryptography_get_ecs_algo(int8_t algo_enum);
 static int32_t get_auth_algorithm_from_acs(uint8_t acs_enum, const char** algo_ptr);
 static int32_t get_cam_sso_token(void);
 static int32_t initialize_kerberos_keytab_file_login(void);
-static int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_write, memory_read* chunk_read);
+static int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_write, memory_read* chunk_read,
+                                             const char* uri, int32_t endpoint_idx, uint8_t idempotent);
+static char* kmc_build_root_uri(const char* hostname, uint16_t port);
+static int32_t kmc_select_endpoint(int32_t exclude_idx);
+static void kmc_record_endpoint_result(int32_t endpoint_idx, double latency_ms, uint8_t error);
+static double kmc_endpoint_p99_latency(const kmc_endpoint_t* endpoint);
+static CURLcode kmc_perform(CURL* curl_handle, const char* uri, int32_t endpoint_idx, uint8_t idempotent,
+                            memory_write* chunk_write, long* response_code);
+static CURLcode kmc_perform_hedged(CURL* curl_handle, const char* uri, int32_t endpoint_idx,
+                                   memory_write* chunk_write, long* response_code);
+static int32_t cam_token_refresh(void);
+static int32_t cam_token_await_refresh(void);
+static void cam_token_cache_store(CURL* curl_handle);
+static void cam_token_schedule_refresh(int32_t refresh_status);
+static void* cam_token_refresh_thread(void* arg);
+static int32_t cam_token_refresh_start(void);
+static void cam_token_refresh_stop(void);
 
 // libcurl call back and support function declarations
-static int32_t configure_curl_connect_opts(CURL* curl, char* cam_cookies);
+static int32_t configure_curl_connect_opts(CURL* curl, char* cam_cookies, int32_t* endpoint_idx);
 static int32_t handle_cam_cookies(CURL* curl,char* cam_cookies);
-static int32_t curl_response_error_check(CURL* curl, char* response);
+static int32_t curl_response_error_check(long response_code, char* response);
 static size_t write_callback(void* data, size_t size, size_t nmemb, void* userp);
 static size_t read_callback(char* dest, size_t size, size_t nmemb, void* userp);
 static char* int_to_str(uint32_t int_src, uint32_t* converted_str_length);
@@ -118,7 +182,9 @@ static CryptographyInterfaceStruct cryptography_if_struct;
 static CURL* curl;
 struct curl_slist *http_headers_list;
 // KMC Crypto Service Endpoints
-static char* kmc_root_uri;
+static kmc_endpoint_t* kmc_endpoints;
+static uint8_t kmc_num_endpoints;
+static uint64_t kmc_request_count;
 //static const char* status_endpoint = "/status";
 static const char* encrypt_endpoint = "encrypt?keyRef=%s&transformation=%s&iv=%s";
 static const char* encrypt_endpoint_null_iv = "encrypt?keyRef=%s&transformation=%s";
@@ -129,6 +195,9 @@ static const char* decrypt_offset_endpoint = "decrypt?metadata=keyLength:%s,keyR
 static const char* icv_create_endpoint = "icv-create?keyRef=%s";
 static const char* icv_verify_endpoint = "icv-verify?metadata=integrityCheckValue:%s,keyRef:%s,cryptoAlgorithm:%s,macLength:%s,metadataType:IntegrityCheckMetadata";
 
+// CAM SSO Token Cache
+static cam_token_cache_t cam_token_cache = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
 // CAM Security Endpoints
 static const char* cam_kerberos_uri = "%s/cam-api/ssoToken?loginMethod=kerberos";
 
@@ -173,23 +242,30 @@ static int32_t cryptography_config(void)
 
     if(curl)
     {
-        //Determine length of port and convert to string for use in URL
-        uint32_t port_str_len = 0;
-        char* port_str = int_to_str(cryptography_kmc_crypto_config->kmc_crypto_port, &port_str_len);
-
-        // Form Root URI
-        //len(protocol)+len(://)+len(hostname)+ len(:) + len(port_str) + len(/) + len(app_uri) + strlen('\0')
-        uint32_t len_root_uri = strlen(cryptography_kmc_crypto_config->protocol) + 3 + // "://"
-                            strlen(cryptography_kmc_crypto_config->kmc_crypto_hostname) + 1 + // ":"
-                            port_str_len + 1 + // "/"
-                            strlen(cryptography_kmc_crypto_config->kmc_crypto_app_uri) + 2; // "/\0"
-
-        kmc_root_uri = malloc(len_root_uri);
-        snprintf(kmc_root_uri,len_root_uri,"%s://%s:%s/%s/",cryptography_kmc_crypto_config->protocol,
-                 cryptography_kmc_crypto_config->kmc_crypto_hostname, port_str,
-                 cryptography_kmc_crypto_config->kmc_crypto_app_uri);
-
-        free(port_str);
+        // Primary endpoint followed by any configured replicas
+        uint8_t num_endpoints = 1;
+        KmcCryptoEndpoint_t* replica = cryptography_kmc_crypto_config->replica_endpoints;
+        for(; replica != NULL; replica = replica->next)
+        {
+            num_endpoints++;
+        }
+        kmc_endpoints = (kmc_endpoint_t*) calloc(num_endpoints, sizeof(kmc_endpoint_t));
+        if(kmc_endpoints == NULL)
+        {
+            status = CRYPTO_LIB_ERR_NULL_BUFFER;
+            return status;
+        }
+        kmc_num_endpoints = num_endpoints;
+        kmc_endpoints[0].root_uri = kmc_build_root_uri(cryptography_kmc_crypto_config->kmc_crypto_hostname,
+                                                       cryptography_kmc_crypto_config->kmc_crypto_port);
+        kmc_endpoints[0].port = cryptography_kmc_crypto_config->kmc_crypto_port;
+        replica = cryptography_kmc_crypto_config->replica_endpoints;
+        for(uint8_t i = 1; replica != NULL; replica = replica->next, i++)
+        {
+            kmc_endpoints[i].root_uri = kmc_build_root_uri(replica->hostname, replica->port);
+            kmc_endpoints[i].port = replica->port;
+        }
+        kmc_request_count = 0;
         //KMC Crypto Service status check is impossible in certain CAM configs, commenting it out.
         // Also, when this library is started up (EG by SDLS service), there's no guarantee the Crypto Service is available at config time.
         //char* status_uri = (char*) malloc(strlen(kmc_root_uri)+strlen(status_endpoint) + 1);
@@ -198,7 +274,7 @@ static int32_t cryptography_config(void)
         //strcat(status_uri, status_endpoint);
 #ifdef DEBUG
         printf("Setting up cURL connection to KMC Crypto Service with Params:\n");
-        printf("\tKMC Root URI: %s\n",kmc_root_uri);
+        printf("\tKMC Root URI: %s\n",kmc_endpoints[0].root_uri);
         //printf("\tKMC Status URL: %s\n",status_uri);
         //printf("\tPort: %d\n",cryptography_kmc_crypto_config->kmc_crypto_port);
         printf("\tSSL Client Cert: %s\n",cryptography_kmc_crypto_config->mtls_client_cert_path);
@@ -244,6 +320,10 @@ static int32_t cryptography_config(void)
 //        printf("cURL response:\n\t %s\n",chunk->response);
 //#endif
         //free(status_uri);
+
+        // Log in to CAM up front and keep the SSO token fresh in the background,
+        // so frames never wait on a Kerberos/keytab login round trip.
+        status = cam_token_refresh_start();
     }
     return status;
 }
@@ -262,11 +342,13 @@ static int32_t cryptography_init(void)
     if(curl == NULL) {
         status = CRYPTOGRAPHY_KMC_CURL_INITIALIZATION_FAILURE;
     }
-    kmc_root_uri = NULL;
+    kmc_endpoints = NULL;
+    kmc_num_endpoints = 0;
     return status;
 }
 static int32_t cryptography_shutdown(void)
 {
+   cam_token_refresh_stop();
    if(curl){
        curl_easy_cleanup(curl);
        curl_global_cleanup();
@@ -274,8 +356,14 @@ static int32_t cryptography_shutdown(void)
    if(http_headers_list != NULL){
        curl_slist_free_all(http_headers_list);
    }
-    if(kmc_root_uri != NULL){
-        free(kmc_root_uri);
+    if(kmc_endpoints != NULL){
+        for(uint8_t i = 0; i < kmc_num_endpoints; i++)
+        {
+            free(kmc_endpoints[i].root_uri);
+        }
+        free(kmc_endpoints);
+        kmc_endpoints = NULL;
+        kmc_num_endpoints = 0;
     }
     return CRYPTO_LIB_SUCCESS;
 }
@@ -304,7 +392,8 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
     #endif
 
     curl_easy_reset(curl);
-    status = configure_curl_connect_opts(curl, cam_cookies);
+    int32_t endpoint_idx = 0; // Endpoint this request is routed to
+    status = configure_curl_connect_opts(curl, cam_cookies, &endpoint_idx);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -337,9 +426,9 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
         snprintf(encrypt_endpoint_final,len_encrypt_endpoint,encrypt_endpoint,sa_ptr->ek_ref,AES_CBC_TRANSFORMATION, iv_base64);
     }
 
-    encrypt_uri = (char*) malloc(strlen(kmc_root_uri)+len_encrypt_endpoint);
+    encrypt_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_encrypt_endpoint);
     encrypt_uri[0] = '\0';
-    strcat(encrypt_uri, kmc_root_uri);
+    strcat(encrypt_uri, kmc_endpoints[endpoint_idx].root_uri);
     strcat(encrypt_uri, encrypt_endpoint_final);
     
 #ifdef DEBUG
@@ -375,7 +464,7 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read);
+    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read, encrypt_uri, endpoint_idx, CRYPTO_FALSE);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -548,7 +637,8 @@ static int32_t cryptography_decrypt(uint8_t* data_out, size_t len_data_out,
     char* key_len_in_bits_str = int_to_str(key_len_in_bits, &key_len_in_bits);
 
     curl_easy_reset(curl);
-    status = configure_curl_connect_opts(curl, cam_cookies);
+    int32_t endpoint_idx = 0; // Endpoint this request is routed to
+    status = configure_curl_connect_opts(curl, cam_cookies, &endpoint_idx);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -578,9 +668,9 @@ static int32_t cryptography_decrypt(uint8_t* data_out, size_t len_data_out,
 
     snprintf(decrypt_endpoint_final,len_decrypt_endpoint,decrypt_endpoint,key_len_in_bits_str,sa_ptr->ek_ref,AES_CBC_TRANSFORMATION, iv_base64, AES_CRYPTO_ALGORITHM);
     free(key_len_in_bits_str);
-    decrypt_uri = (char*) malloc(strlen(kmc_root_uri)+len_decrypt_endpoint);
+    decrypt_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_decrypt_endpoint);
     decrypt_uri[0] = '\0';
-    strcat(decrypt_uri, kmc_root_uri);
+    strcat(decrypt_uri, kmc_endpoints[endpoint_idx].root_uri);
     strcat(decrypt_uri, decrypt_endpoint_final);
 
 #ifdef DEBUG
@@ -617,7 +707,7 @@ static int32_t cryptography_decrypt(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read);
+    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read, decrypt_uri, endpoint_idx, CRYPTO_TRUE);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -734,7 +824,8 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
     ecs = ecs;
     
     curl_easy_reset(curl);
-    status = configure_curl_connect_opts(curl, cam_cookies);
+    int32_t endpoint_idx = 0; // Endpoint this request is routed to
+    status = configure_curl_connect_opts(curl, cam_cookies, &endpoint_idx);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -773,9 +864,9 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
     char* auth_endpoint_final = (char*) malloc(len_auth_endpoint);
     snprintf(auth_endpoint_final,len_auth_endpoint,icv_create_endpoint,sa_ptr->ak_ref);
 
-    char* auth_uri = (char*) malloc(strlen(kmc_root_uri)+len_auth_endpoint);
+    char* auth_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_auth_endpoint);
     auth_uri[0] = '\0';
-    strcat(auth_uri, kmc_root_uri);
+    strcat(auth_uri, kmc_endpoints[endpoint_idx].root_uri);
     strcat(auth_uri, auth_endpoint_final);
 
 #ifdef DEBUG
@@ -812,7 +903,7 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read);
+    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read, auth_uri, endpoint_idx, CRYPTO_FALSE);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -978,7 +1069,8 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
     }
 
     curl_easy_reset(curl);
-    status = configure_curl_connect_opts(curl, cam_cookies);
+    int32_t endpoint_idx = 0; // Endpoint this request is routed to
+    status = configure_curl_connect_opts(curl, cam_cookies, &endpoint_idx);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -1012,9 +1104,9 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
     char* auth_endpoint_final = (char*) malloc(len_auth_endpoint);
     snprintf(auth_endpoint_final,len_auth_endpoint,icv_verify_endpoint,mac_base64,sa_ptr->ak_ref,auth_algorithm,mac_size_str);
     free(mac_size_str);
-    char* auth_uri = (char*) malloc(strlen(kmc_root_uri)+len_auth_endpoint);
+    char* auth_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_auth_endpoint);
     auth_uri[0] = '\0';
-    strcat(auth_uri, kmc_root_uri);
+    strcat(auth_uri, kmc_endpoints[endpoint_idx].root_uri);
     strcat(auth_uri, auth_endpoint_final);
 
 #ifdef DEBUG
@@ -1052,7 +1144,7 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
     printf("\n");
 #endif
 
-    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read);
+    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read, auth_uri, endpoint_idx, CRYPTO_TRUE);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -1154,7 +1246,8 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
     acs = acs;
 
     curl_easy_reset(curl);
-    status = configure_curl_connect_opts(curl, cam_cookies);
+    int32_t endpoint_idx = 0; // Endpoint this request is routed to
+    status = configure_curl_connect_opts(curl, cam_cookies, &endpoint_idx);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -1215,11 +1308,11 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
         free(aad_offset_str);
         free(mac_size_str);
 #ifdef DEBUG
-        printf("KMC ROOT URI: %s\n",kmc_root_uri);
+        printf("KMC ROOT URI: %s\n",kmc_endpoints[endpoint_idx].root_uri);
 #endif
-        encrypt_uri = (char*) malloc(strlen(kmc_root_uri)+len_encrypt_endpoint);
+        encrypt_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_encrypt_endpoint);
         encrypt_uri[0] = '\0';
-        strcat(encrypt_uri, kmc_root_uri);
+        strcat(encrypt_uri, kmc_endpoints[endpoint_idx].root_uri);
         strcat(encrypt_uri, encrypt_endpoint_final);
 
         // Prepare encrypt_payload with AAD at the front for KMC Crypto Service.
@@ -1257,9 +1350,9 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
         }
         
 
-        encrypt_uri = (char*) malloc(strlen(kmc_root_uri)+len_encrypt_endpoint);
+        encrypt_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_encrypt_endpoint);
         encrypt_uri[0] = '\0';
-        strcat(encrypt_uri, kmc_root_uri);
+        strcat(encrypt_uri, kmc_endpoints[endpoint_idx].root_uri);
         strcat(encrypt_uri, encrypt_endpoint_final);
         free(encrypt_endpoint_final);
     }
@@ -1297,7 +1390,7 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    status = curl_perform_with_cam_retries(curl,chunk_write,chunk_read);
+    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read, encrypt_uri, endpoint_idx, CRYPTO_FALSE);
 #ifdef DEBUG
     printf("Curl Perform Final Status Code: %d\n",status);
     if(chunk_write->response != NULL)
@@ -1535,7 +1628,8 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
 
 
     curl_easy_reset(curl);
-    status = configure_curl_connect_opts(curl, cam_cookies);
+    int32_t endpoint_idx = 0; // Endpoint this request is routed to
+    status = configure_curl_connect_opts(curl, cam_cookies, &endpoint_idx);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         return status;
@@ -1581,9 +1675,9 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
         free(aad_offset_str);
         free(mac_size_str);
 
-        decrypt_uri = (char*) malloc(strlen(kmc_root_uri)+len_decrypt_endpoint);
+        decrypt_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_decrypt_endpoint);
         decrypt_uri[0] = '\0';
-        strcat(decrypt_uri, kmc_root_uri);
+        strcat(decrypt_uri, kmc_endpoints[endpoint_idx].root_uri);
         strcat(decrypt_uri, decrypt_endpoint_final);
 
         // Prepare decrypt_payload with AAD at the front for KMC Crypto Service.
@@ -1620,9 +1714,9 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
 
         snprintf(decrypt_endpoint_final,len_decrypt_endpoint,decrypt_endpoint,key_len_in_bits_str,sa_ptr->ek_ref,AES_GCM_TRANSFORMATION, iv_base64, AES_CRYPTO_ALGORITHM);
 
-        decrypt_uri = (char*) malloc(strlen(kmc_root_uri)+len_decrypt_endpoint);
+        decrypt_uri = (char*) malloc(strlen(kmc_endpoints[endpoint_idx].root_uri)+len_decrypt_endpoint);
         decrypt_uri[0] = '\0';
-        strcat(decrypt_uri, kmc_root_uri);
+        strcat(decrypt_uri, kmc_endpoints[endpoint_idx].root_uri);
         strcat(decrypt_uri, decrypt_endpoint_final);
         free(decrypt_endpoint_final);
     }
@@ -1660,7 +1754,7 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read);
+    status = curl_perform_with_cam_retries(curl, chunk_write, chunk_read, decrypt_uri, endpoint_idx, CRYPTO_TRUE);
     if(status != CRYPTO_LIB_SUCCESS)
     {
         //free(decrypt_payload);
@@ -1861,7 +1955,7 @@ static size_t read_callback(char* dest, size_t size, size_t nmemb, void* userp)
     return 0; /* no more data left to deliver */
 }
 
-static int32_t configure_curl_connect_opts(CURL* curl_handle, char* cam_cookies)
+static int32_t configure_curl_connect_opts(CURL* curl_handle, char* cam_cookies, int32_t* endpoint_idx)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
 
@@ -1890,7 +1984,9 @@ static int32_t configure_curl_connect_opts(CURL* curl_handle, char* cam_cookies)
         printf("KMC mTLS Client Issuer Cert: %s\n",cryptography_kmc_crypto_config->mtls_issuer_cert);
     }
 #endif
-    curl_easy_setopt(curl_handle, CURLOPT_PORT, cryptography_kmc_crypto_config->kmc_crypto_port);
+    // Route this request to the best performing endpoint; callers build their URI from its root
+    *endpoint_idx = kmc_select_endpoint(-1);
+    curl_easy_setopt(curl_handle, CURLOPT_PORT, (long) kmc_endpoints[*endpoint_idx].port);
     curl_easy_setopt(curl_handle, CURLOPT_SSLCERT, cryptography_kmc_crypto_config->mtls_client_cert_path);
     curl_easy_setopt(curl_handle, CURLOPT_SSLKEY, cryptography_kmc_crypto_config->mtls_client_key_path);
     if(cryptography_kmc_crypto_config->mtls_client_cert_type != NULL){
@@ -1930,6 +2026,17 @@ static int32_t handle_cam_cookies(CURL* curl_handle, char* cam_cookies)
                 return status;
             }
 
+            // Cached SSO token cookies avoid re-reading the cookie file on every request
+            pthread_mutex_lock(&cam_token_cache.lock);
+            if(cam_token_cache.cookies != NULL)
+            {
+                // CURLOPT_COOKIE copies the string, so the cache may be swapped out afterwards
+                curl_easy_setopt(curl_handle, CURLOPT_COOKIE, cam_token_cache.cookies);
+                pthread_mutex_unlock(&cam_token_cache.lock);
+                return status;
+            }
+            pthread_mutex_unlock(&cam_token_cache.lock);
+
             if(cam_config->cookie_file_path == NULL) // all auth methods rely on cookie file sets/gets, error if null
             {
                 status = CAM_INVALID_COOKIE_FILE_CONFIGURATION_NULL;
@@ -2055,6 +2162,10 @@ static int32_t get_cam_sso_token()
     {
         status = CAM_GET_SSO_TOKEN_FAILURE;
     }
+    else if(status == CRYPTO_LIB_SUCCESS)
+    {
+        cam_token_cache_store(curl_cam);
+    }
     // Cookies don't write to COOKIEJAR until cleanup.
     curl_easy_cleanup(curl_cam);
     free(kerberos_endpoint_final);
@@ -2083,13 +2194,10 @@ static int jsoneq(const char* json, jsmntok_t* tok, const char* s)
     return -1;
 }
 
-int32_t curl_response_error_check(CURL* curl_handle, char* response)
+int32_t curl_response_error_check(long response_code, char* response)
 {
     int32_t response_status = CRYPTO_LIB_SUCCESS;
 
-    long response_code;
-    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &response_code);
-
 #ifdef DEBUG
     printf("cURL response code: %ld\n",response_code);
 #endif
@@ -2137,7 +2245,8 @@ int32_t curl_response_error_check(CURL* curl_handle, char* response)
 
 }
 
-int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_write, memory_read* chunk_read)
+int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_write, memory_read* chunk_read,
+                                      const char* uri, int32_t endpoint_idx, uint8_t idempotent)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
     uint8_t cam_retry = 0;
@@ -2147,7 +2256,8 @@ int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_writ
         printf("Entering CAM Authentication Retry Loop, Loop #: %d\n",cam_retry);
 #endif
         CURLcode res;
-        res = curl_easy_perform(curl_handle);
+        long response_code = 0;
+        res = kmc_perform(curl_handle, uri, endpoint_idx, idempotent, chunk_write, &response_code);
 
         if(res != CURLE_OK) // This is not a response w/return code, this is something breaking!
         {
@@ -2157,7 +2267,7 @@ int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_writ
             break; // Go to Post retry loop cleanup and return status.
         }
 
-        status = curl_response_error_check(curl_handle, chunk_write->response);
+        status = curl_response_error_check(response_code, chunk_write->response);
 
         if(status == CRYPTO_LIB_SUCCESS) // Crypto Service REST call worked! Break out of retry loop.
         {
@@ -2175,7 +2285,7 @@ int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_writ
 #ifdef DEBUG
             printf("Attempting to authenticate and retrieve CAM SSO Token.\n");
 #endif
-            status = get_cam_sso_token();
+            status = cam_token_await_refresh();
             if(status == CAM_KERBEROS_REQUEST_TIME_OUT)
             {
                 //Non-fatal getSsoToken failure... Attempt CAM retry...
@@ -2206,6 +2316,634 @@ int32_t curl_perform_with_cam_retries(CURL* curl_handle,memory_write* chunk_writ
     return status;
 }
 
+/**
+ * @brief Function: kmc_build_root_uri
+ *  Builds "<protocol>://<hostname>:<port>/<app_uri>/" for a KMC Crypto Service endpoint.
+ * @return char*: malloc'd root URI
+**/
+static char* kmc_build_root_uri(const char* hostname, uint16_t port)
+{
+    //Determine length of port and convert to string for use in URL
+    uint32_t port_str_len = 0;
+    char* port_str = int_to_str(port, &port_str_len);
+
+    // Form Root URI
+    //len(protocol)+len(://)+len(hostname)+ len(:) + len(port_str) + len(/) + len(app_uri) + strlen('\0')
+    uint32_t len_root_uri = strlen(cryptography_kmc_crypto_config->protocol) + 3 + // "://"
+                        strlen(hostname) + 1 + // ":"
+                        port_str_len + 1 + // "/"
+                        strlen(cryptography_kmc_crypto_config->kmc_crypto_app_uri) + 2; // "/\0"
+
+    char* root_uri = malloc(len_root_uri);
+    snprintf(root_uri,len_root_uri,"%s://%s:%s/%s/",cryptography_kmc_crypto_config->protocol,
+             hostname, port_str, cryptography_kmc_crypto_config->kmc_crypto_app_uri);
+
+    free(port_str);
+    return root_uri;
+}
+
+/**
+ * @brief Function: kmc_select_endpoint
+ *  Picks the endpoint with the lowest error-penalized EWMA latency. Endpoints that have never
+ *  been measured, or have not been used for KMC_ENDPOINT_PROBE_INTERVAL requests, are tried first
+ *  so a recovered replica is noticed.
+ * @param exclude_idx: endpoint to skip (the one already in flight when hedging), -1 for none
+ * @return int32_t: endpoint index, -1 if no other endpoint exists
+**/
+static int32_t kmc_select_endpoint(int32_t exclude_idx)
+{
+    int32_t best_idx = -1;
+    double best_score = 0;
+
+    for(int32_t i = 0; i < kmc_num_endpoints; i++)
+    {
+        if(i == exclude_idx)
+        {
+            continue;
+        }
+        const kmc_endpoint_t* endpoint = &kmc_endpoints[i];
+        if(endpoint->num_requests == 0 ||
+           kmc_request_count - endpoint->last_used_request > KMC_ENDPOINT_PROBE_INTERVAL)
+        {
+            return i;
+        }
+        double score = endpoint->ewma_latency_ms * (1.0 + KMC_ERROR_PENALTY * endpoint->ewma_error_rate);
+        if(best_idx < 0 || score < best_score)
+        {
+            best_idx = i;
+            best_score = score;
+        }
+    }
+    return best_idx;
+}
+
+/**
+ * @brief Function: kmc_record_endpoint_result
+ *  Folds a request outcome into the endpoint's latency and error-rate EWMAs and p99 sample window.
+**/
+static void kmc_record_endpoint_result(int32_t endpoint_idx, double latency_ms, uint8_t error)
+{
+    kmc_endpoint_t* endpoint = &kmc_endpoints[endpoint_idx];
+
+    if(endpoint->num_requests == 0)
+    {
+        endpoint->ewma_latency_ms = latency_ms;
+    }
+    else
+    {
+        endpoint->ewma_latency_ms += KMC_EWMA_ALPHA * (latency_ms - endpoint->ewma_latency_ms);
+    }
+    endpoint->ewma_error_rate += KMC_EWMA_ALPHA * ((error ? 1.0 : 0.0) - endpoint->ewma_error_rate);
+    endpoint->num_requests++;
+    if(error)
+    {
+        endpoint->num_errors++;
+    }
+    endpoint->last_used_request = kmc_request_count;
+
+    endpoint->latency_samples[endpoint->next_sample] = latency_ms;
+    endpoint->next_sample = (endpoint->next_sample + 1) % KMC_LATENCY_WINDOW;
+    if(endpoint->num_samples < KMC_LATENCY_WINDOW)
+    {
+        endpoint->num_samples++;
+    }
+}
+
+static int compare_latency(const void* a, const void* b)
+{
+    double diff = *(const double*)a - *(const double*)b;
+    return (diff > 0) - (diff < 0);
+}
+
+/**
+ * @brief Function: kmc_endpoint_p99_latency
+ * @return double: 99th percentile of the endpoint's recent latencies in ms, 0 if never measured
+**/
+static double kmc_endpoint_p99_latency(const kmc_endpoint_t* endpoint)
+{
+    double sorted[KMC_LATENCY_WINDOW];
+
+    if(endpoint->num_samples == 0)
+    {
+        return 0;
+    }
+    memcpy(sorted, endpoint->latency_samples, endpoint->num_samples * sizeof(double));
+    qsort(sorted, endpoint->num_samples, sizeof(double), compare_latency);
+    uint32_t p99_idx = (endpoint->num_samples * 99 + 99) / 100 - 1;
+    return sorted[p99_idx];
+}
+
+static double kmc_now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+/**
+ * @brief Function: kmc_perform
+ *  Performs the configured request against the selected endpoint, hedging idempotent requests
+ *  when enabled, and records the outcome for routing.
+ * @param endpoint_idx: endpoint chosen by configure_curl_connect_opts, whose root prefixes uri
+ * @param response_code: HTTP response code of the response written into chunk_write
+ * @return CURLcode: transfer result
+**/
+static CURLcode kmc_perform(CURL* curl_handle, const char* uri, int32_t endpoint_idx, uint8_t idempotent,
+                            memory_write* chunk_write, long* response_code)
+{
+    CURLcode res;
+
+    kmc_request_count++;
+    if(idempotent && cryptography_kmc_crypto_config->hedge_idempotent_requests == CRYPTO_TRUE && kmc_num_endpoints > 1)
+    {
+        return kmc_perform_hedged(curl_handle, uri, endpoint_idx, chunk_write, response_code);
+    }
+
+    double start_ms = kmc_now_ms();
+    res = curl_easy_perform(curl_handle);
+    curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, response_code);
+    kmc_record_endpoint_result(endpoint_idx, kmc_now_ms() - start_ms,
+                               (res != CURLE_OK || *response_code == 0 || *response_code >= 500));
+    return res;
+}
+
+/**
+ * @brief Function: kmc_perform_hedged
+ *  Sends the request to the selected endpoint and, if no good response has arrived after the
+ *  endpoint's p99 latency (at least hedge_min_delay_ms), duplicates it to the next best replica.
+ *  The first HTTP 200 wins; the other transfer is abandoned. A primary that fails in transport or with
+ *  a 5xx is failed over immediately. Any other response from the primary (4xx, CAM redirect) would be
+ *  the same from every replica, so it is returned as is.
+**/
+static CURLcode kmc_perform_hedged(CURL* curl_handle, const char* uri, int32_t endpoint_idx,
+                                   memory_write* chunk_write, long* response_code)
+{
+    CURLcode res = CURLE_OK;
+    CURLcode hedge_res = CURLE_OK;
+    CURL* hedge_handle = NULL;
+    char* hedge_uri = NULL;
+    memory_write hedge_write = {NULL, 0};
+    int32_t primary_idx = endpoint_idx;
+    int32_t hedge_idx = kmc_select_endpoint(primary_idx);
+    uint8_t primary_done = CRYPTO_FALSE;
+    uint8_t hedge_done = CRYPTO_FALSE;
+    uint8_t hedge_won = CRYPTO_FALSE;
+    long hedge_response_code = 0;
+    double primary_latency_ms = 0;
+    double hedge_latency_ms = 0;
+    double hedge_start_ms = 0;
+
+    double hedge_delay_ms = kmc_endpoint_p99_latency(&kmc_endpoints[primary_idx]);
+    if(hedge_delay_ms < cryptography_kmc_crypto_config->hedge_min_delay_ms)
+    {
+        hedge_delay_ms = cryptography_kmc_crypto_config->hedge_min_delay_ms;
+    }
+
+    // The hedge URI keeps the request path and swaps the endpoint's root
+    const char* request_path = uri + strlen(kmc_endpoints[primary_idx].root_uri);
+    hedge_uri = malloc(strlen(kmc_endpoints[hedge_idx].root_uri) + strlen(request_path) + 1);
+    strcpy(hedge_uri, kmc_endpoints[hedge_idx].root_uri);
+    strcat(hedge_uri, request_path);
+
+    CURLM* multi_handle = curl_multi_init();
+    curl_multi_add_handle(multi_handle, curl_handle);
+    double start_ms = kmc_now_ms();
+
+    *response_code = 0;
+    while(!primary_done || (hedge_handle != NULL && !hedge_done))
+    {
+        int still_running = 0;
+        curl_multi_perform(multi_handle, &still_running);
+
+        CURLMsg* msg;
+        int msgs_left = 0;
+        while((msg = curl_multi_info_read(multi_handle, &msgs_left)) != NULL)
+        {
+            if(msg->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+            if(msg->easy_handle == curl_handle)
+            {
+                primary_done = CRYPTO_TRUE;
+                res = msg->data.result;
+                curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, response_code);
+                primary_latency_ms = kmc_now_ms() - start_ms;
+            }
+            else if(msg->easy_handle == hedge_handle)
+            {
+                hedge_done = CRYPTO_TRUE;
+                hedge_res = msg->data.result;
+                curl_easy_getinfo(hedge_handle, CURLINFO_RESPONSE_CODE, &hedge_response_code);
+                hedge_latency_ms = kmc_now_ms() - hedge_start_ms;
+            }
+        }
+
+        if(primary_done && res == CURLE_OK && *response_code != 0 && *response_code < 500)
+        {
+            break;
+        }
+        if(hedge_done && hedge_res == CURLE_OK && hedge_response_code == 200)
+        {
+            hedge_won = CRYPTO_TRUE;
+            break;
+        }
+
+        double elapsed_ms = kmc_now_ms() - start_ms;
+        if(hedge_handle == NULL && (primary_done || elapsed_ms >= hedge_delay_ms))
+        {
+            hedge_handle = curl_easy_duphandle(curl_handle);
+            if(hedge_handle == NULL)
+            {
+                break;
+            }
+            curl_easy_setopt(hedge_handle, CURLOPT_URL, hedge_uri);
+            curl_easy_setopt(hedge_handle, CURLOPT_PORT, (long) kmc_endpoints[hedge_idx].port);
+            curl_easy_setopt(hedge_handle, CURLOPT_WRITEDATA, &hedge_write);
+            curl_multi_add_handle(multi_handle, hedge_handle);
+            kmc_endpoints[hedge_idx].num_hedges_sent++;
+            hedge_start_ms = kmc_now_ms();
+#ifdef DEBUG
+            printf("Hedging KMC request to %s after %.1f ms\n", kmc_endpoints[hedge_idx].root_uri, elapsed_ms);
+#endif
+            continue;
+        }
+
+        int timeout_ms = 100;
+        if(hedge_handle == NULL && (hedge_delay_ms - elapsed_ms) < timeout_ms)
+        {
+            timeout_ms = (int) (hedge_delay_ms - elapsed_ms) + 1;
+        }
+        curl_multi_poll(multi_handle, NULL, 0, timeout_ms, NULL);
+    }
+
+    // Abandoned transfers still count against their endpoint with the time they were given
+    double end_ms = kmc_now_ms();
+    kmc_record_endpoint_result(primary_idx, primary_done ? primary_latency_ms : end_ms - start_ms,
+                               primary_done && (res != CURLE_OK || *response_code == 0 || *response_code >= 500));
+    if(hedge_handle != NULL)
+    {
+        kmc_record_endpoint_result(hedge_idx, hedge_done ? hedge_latency_ms : end_ms - hedge_start_ms,
+                                   hedge_done && (hedge_res != CURLE_OK || hedge_response_code == 0 ||
+                                                  hedge_response_code >= 500));
+        curl_multi_remove_handle(multi_handle, hedge_handle);
+        curl_easy_cleanup(hedge_handle);
+    }
+    curl_multi_remove_handle(multi_handle, curl_handle);
+    curl_multi_cleanup(multi_handle);
+    free(hedge_uri);
+
+    if(hedge_won)
+    {
+        kmc_endpoints[hedge_idx].num_hedges_won++;
+        free(chunk_write->response);
+        chunk_write->response = hedge_write.response;
+        chunk_write->size = hedge_write.size;
+        *response_code = hedge_response_code;
+        return hedge_res;
+    }
+    free(hedge_write.response);
+    return res;
+}
+
+/**
+ * @brief Function: Crypto_Get_Kmc_Endpoint_Stats
+ *  Reports routing statistics for a KMC Crypto Service endpoint.
+ * @param endpoint_idx: 0 for the primary endpoint, 1.. for replicas in the order they were added
+ * @param stats: KmcEndpointStats_t* to populate
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Get_Kmc_Endpoint_Stats(uint8_t endpoint_idx, KmcEndpointStats_t* stats)
+{
+    if(stats == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    if(endpoint_idx >= kmc_num_endpoints)
+    {
+        return CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_ENDPOINT_OUT_OF_RANGE;
+    }
+    const kmc_endpoint_t* endpoint = &kmc_endpoints[endpoint_idx];
+    stats->num_requests = endpoint->num_requests;
+    stats->num_errors = endpoint->num_errors;
+    stats->num_hedges_sent = endpoint->num_hedges_sent;
+    stats->num_hedges_won = endpoint->num_hedges_won;
+    stats->ewma_latency_ms = endpoint->ewma_latency_ms;
+    stats->ewma_error_rate = endpoint->ewma_error_rate;
+    stats->p99_latency_ms = kmc_endpoint_p99_latency(endpoint);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: cam_token_refresh
+ *  Logs in to CAM, refreshes the SSO token cache and schedules the next proactive refresh.
+ *  Single flight: a caller that finds a login under way waits for it and shares its result,
+ *  so the cookie file is only ever written by one getSsoToken request at a time.
+ * @return int32_t: Success/Failure of the getSsoToken request
+**/
+static int32_t cam_token_refresh(void)
+{
+    int32_t status;
+    uint32_t generation;
+
+    pthread_mutex_lock(&cam_token_cache.lock);
+    if(cam_token_cache.refresh_in_flight)
+    {
+        generation = cam_token_cache.refresh_generation;
+        while(cam_token_cache.refresh_generation == generation)
+        {
+            pthread_cond_wait(&cam_token_cache.cond, &cam_token_cache.lock);
+        }
+        status = cam_token_cache.last_refresh_status;
+        pthread_mutex_unlock(&cam_token_cache.lock);
+        return status;
+    }
+    cam_token_cache.refresh_in_flight = CRYPTO_TRUE;
+    pthread_mutex_unlock(&cam_token_cache.lock);
+
+    status = get_cam_sso_token();
+    cam_token_schedule_refresh(status);
+    return status;
+}
+
+/**
+ * @brief Function: cam_token_await_refresh
+ *  Frame path handling of a rejected token. With the refresh thread running, frames never log in
+ *  themselves: they wait for the login under way, or have the thread log in now and wait for that.
+ *  Without the thread (cookies managed outside CryptoLib) this is cam_token_refresh.
+ * @return int32_t: Success/Failure of the getSsoToken request waited for
+**/
+static int32_t cam_token_await_refresh(void)
+{
+    int32_t status = CAM_GET_SSO_TOKEN_FAILURE;
+    uint32_t generation;
+
+    pthread_mutex_lock(&cam_token_cache.lock);
+    if(!cam_token_cache.refresh_thread_running && !cam_token_cache.refresh_in_flight)
+    {
+        pthread_mutex_unlock(&cam_token_cache.lock);
+        return cam_token_refresh();
+    }
+    generation = cam_token_cache.refresh_generation;
+    if(!cam_token_cache.refresh_in_flight)
+    {
+        cam_token_cache.next_refresh = 0;
+        pthread_cond_broadcast(&cam_token_cache.cond);
+    }
+    while(cam_token_cache.refresh_generation == generation &&
+          (cam_token_cache.refresh_in_flight || cam_token_cache.refresh_thread_running))
+    {
+        pthread_cond_wait(&cam_token_cache.cond, &cam_token_cache.lock);
+    }
+    if(cam_token_cache.refresh_generation != generation)
+    {
+        status = cam_token_cache.last_refresh_status;
+    }
+    pthread_mutex_unlock(&cam_token_cache.lock);
+    return status;
+}
+
+/**
+ * @brief Function: cam_token_cache_store
+ *  Replaces the cached CAM cookies with those held by a handle that just completed getSsoToken.
+ *  Cookies are read from the handle's cookie engine in Netscape format:
+ *  domain, tailmatch, path, secure, expiry, name, value (tab separated).
+ * @param curl_handle: CURL* handle used for the getSsoToken request
+**/
+static void cam_token_cache_store(CURL* curl_handle)
+{
+    struct curl_slist* cookie_list = NULL;
+    struct curl_slist* cookie = NULL;
+    size_t cookies_size = 1;
+    time_t expiry = 0;
+
+    if(curl_easy_getinfo(curl_handle, CURLINFO_COOKIELIST, &cookie_list) != CURLE_OK || cookie_list == NULL)
+    {
+        return; // Nothing to cache, requests fall back to the cookie file
+    }
+
+    for(cookie = cookie_list; cookie != NULL; cookie = cookie->next)
+    {
+        cookies_size += strlen(cookie->data) + 2; // "; " separator
+    }
+    char* cookies = (char*) calloc(1, cookies_size);
+
+    for(cookie = cookie_list; cookie != NULL && cookies != NULL; cookie = cookie->next)
+    {
+        char* line = crypto_deep_copy_string(cookie->data);
+        char* fields[7] = {NULL};
+        char* save_ptr = NULL;
+        int num_fields = 0;
+        for(char* tok = strtok_r(line, "\t", &save_ptr); tok != NULL && num_fields < 7; tok = strtok_r(NULL, "\t", &save_ptr))
+        {
+            fields[num_fields++] = tok;
+        }
+        if(num_fields >= 6) // Empty cookie values collapse the final field
+        {
+            time_t cookie_expiry = (time_t) strtoll(fields[4], NULL, 10);
+            if(cookie_expiry > 0 && (expiry == 0 || cookie_expiry < expiry))
+            {
+                expiry = cookie_expiry;
+            }
+            if(cookies[0] != '\0')
+            {
+                strcat(cookies, "; ");
+            }
+            strcat(cookies, fields[5]);
+            strcat(cookies, "=");
+            strcat(cookies, (num_fields == 7) ? fields[6] : "");
+        }
+        free(line);
+    }
+    curl_slist_free_all(cookie_list);
+
+    if(cookies == NULL || cookies[0] == '\0')
+    {
+        free(cookies);
+        return;
+    }
+
+    pthread_mutex_lock(&cam_token_cache.lock);
+    free(cam_token_cache.cookies);
+    cam_token_cache.cookies = cookies;
+    cam_token_cache.expiry = expiry;
+    pthread_mutex_unlock(&cam_token_cache.lock);
+#ifdef DEBUG
+    printf("Cached CAM SSO token cookies, expiry: %ld\n", (long) expiry);
+#endif
+}
+
+/**
+ * @brief Function: cam_token_schedule_refresh
+ *  Updates refresh counters and decides when the background thread next logs in:
+ *  ahead of the cached token's expiry on success, with exponential back-off on failure.
+ *  Completes the in-flight login and wakes everyone waiting for its result.
+ * @param refresh_status: int32_t status of the refresh attempt
+**/
+static void cam_token_schedule_refresh(int32_t refresh_status)
+{
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&cam_token_cache.lock);
+    if(refresh_status == CRYPTO_LIB_SUCCESS)
+    {
+        cam_token_cache.refresh_count++;
+        cam_token_cache.retry_interval = CAM_TOKEN_RETRY_MIN;
+        if(cam_token_cache.expiry == 0)
+        {
+            cam_token_cache.next_refresh = now + CAM_TOKEN_DEFAULT_LIFETIME - CAM_TOKEN_REFRESH_MARGIN;
+        }
+        else
+        {
+            cam_token_cache.next_refresh = cam_token_cache.expiry - CAM_TOKEN_REFRESH_MARGIN;
+            if(cam_token_cache.next_refresh <= now) // Short-lived token, refresh half way through its life
+            {
+                cam_token_cache.next_refresh = now + (cam_token_cache.expiry - now) / 2;
+            }
+        }
+        if(cam_token_cache.next_refresh <= now)
+        {
+            cam_token_cache.next_refresh = now + CAM_TOKEN_RETRY_MIN;
+        }
+    }
+    else
+    {
+        cam_token_cache.refresh_failure_count++;
+        if(cam_token_cache.retry_interval == 0)
+        {
+            cam_token_cache.retry_interval = CAM_TOKEN_RETRY_MIN;
+        }
+        cam_token_cache.next_refresh = now + cam_token_cache.retry_interval;
+        cam_token_cache.retry_interval *= 2;
+        if(cam_token_cache.retry_interval > CAM_TOKEN_RETRY_MAX)
+        {
+            cam_token_cache.retry_interval = CAM_TOKEN_RETRY_MAX;
+        }
+    }
+    cam_token_cache.last_refresh_status = refresh_status;
+    cam_token_cache.refresh_in_flight = CRYPTO_FALSE;
+    cam_token_cache.refresh_generation++;
+    pthread_cond_broadcast(&cam_token_cache.cond);
+    pthread_mutex_unlock(&cam_token_cache.lock);
+}
+
+/**
+ * @brief Function: cam_token_refresh_thread
+ *  Sleeps until the scheduled refresh time and logs in again, until stopped at shutdown.
+ * @param arg: CryptoContext_t*, the context the backend was brought up in
+**/
+static void* cam_token_refresh_thread(void* arg)
+{
+    // Reads the configuration of the context that started the backend
+    Crypto_Context_Enter((CryptoContext_t*)arg);
+    pthread_mutex_lock(&cam_token_cache.lock);
+    while(cam_token_cache.refresh_thread_running)
+    {
+        if(time(NULL) < cam_token_cache.next_refresh)
+        {
+            struct timespec wake_time = { .tv_sec = cam_token_cache.next_refresh, .tv_nsec = 0 };
+            pthread_cond_timedwait(&cam_token_cache.cond, &cam_token_cache.lock, &wake_time);
+            continue;
+        }
+        pthread_mutex_unlock(&cam_token_cache.lock);
+#ifdef DEBUG
+        printf("Proactively refreshing CAM SSO token.\n");
+#endif
+        cam_token_refresh();
+        pthread_mutex_lock(&cam_token_cache.lock);
+    }
+    pthread_mutex_unlock(&cam_token_cache.lock);
+    return NULL;
+}
+
+/**
+ * @brief Function: cam_token_refresh_start
+ *  Performs the initial CAM login and starts the background refresh thread.
+ *  A failed initial login is not fatal; the thread retries with back-off.
+ * @return int32_t: Success/Failure
+**/
+static int32_t cam_token_refresh_start(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if(cam_config == NULL || !cam_config->cam_enabled || cam_config->login_method == CAM_LOGIN_NONE)
+    {
+        return status; // Nothing to refresh, cookies are managed outside CryptoLib
+    }
+    if(cam_token_cache.refresh_thread_running)
+    {
+        return status;
+    }
+
+    if(cam_token_refresh() != CRYPTO_LIB_SUCCESS)
+    {
+        fprintf(stderr, "Initial CAM SSO token retrieval failed, retrying in the background.\n");
+    }
+
+    pthread_mutex_lock(&cam_token_cache.lock);
+    cam_token_cache.refresh_thread_running = CRYPTO_TRUE;
+    pthread_mutex_unlock(&cam_token_cache.lock);
+    if(pthread_create(&cam_token_cache.refresh_thread, NULL, cam_token_refresh_thread, crypto_context_current) != 0)
+    {
+        pthread_mutex_lock(&cam_token_cache.lock);
+        cam_token_cache.refresh_thread_running = CRYPTO_FALSE;
+        pthread_mutex_unlock(&cam_token_cache.lock);
+        status = CAM_GET_SSO_TOKEN_FAILURE;
+    }
+    return status;
+}
+
+/**
+ * @brief Function: cam_token_refresh_stop
+ *  Stops the background refresh thread and wipes the cached SSO token.
+**/
+static void cam_token_refresh_stop(void)
+{
+    pthread_mutex_lock(&cam_token_cache.lock);
+    uint8_t was_running = cam_token_cache.refresh_thread_running;
+    cam_token_cache.refresh_thread_running = CRYPTO_FALSE;
+    pthread_cond_broadcast(&cam_token_cache.cond);
+    pthread_mutex_unlock(&cam_token_cache.lock);
+
+    if(was_running)
+    {
+        pthread_join(cam_token_cache.refresh_thread, NULL);
+    }
+
+    pthread_mutex_lock(&cam_token_cache.lock);
+    if(cam_token_cache.cookies != NULL)
+    {
+        memset(cam_token_cache.cookies, 0, strlen(cam_token_cache.cookies));
+        free(cam_token_cache.cookies);
+        cam_token_cache.cookies = NULL;
+    }
+    cam_token_cache.expiry = 0;
+    cam_token_cache.next_refresh = 0;
+    cam_token_cache.retry_interval = 0;
+    pthread_mutex_unlock(&cam_token_cache.lock);
+}
+
+/**
+ * @brief Function: Crypto_Get_Cam_Token_Stats
+ *  Reports CAM SSO token refresh counters and the expiry of the cached token.
+ * @param stats: CamTokenStats_t* to populate
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Get_Cam_Token_Stats(CamTokenStats_t* stats)
+{
+    if(stats == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    pthread_mutex_lock(&cam_token_cache.lock);
+    stats->refresh_count = cam_token_cache.refresh_count;
+    stats->refresh_failure_count = cam_token_cache.refresh_failure_count;
+    stats->token_expiry = (int64_t) cam_token_cache.expiry;
+    stats->token_cached = (cam_token_cache.cookies != NULL) ? CRYPTO_TRUE : CRYPTO_FALSE;
+    pthread_mutex_unlock(&cam_token_cache.lock);
+    return CRYPTO_LIB_SUCCESS;
+}
+
 /**
  * @brief Function: initialize_kerberos_keytab_file_login
  *
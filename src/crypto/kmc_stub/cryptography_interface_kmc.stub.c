@@ -12,9 +12,23 @@
  * foreign persons.
  */
 
+#include "crypto.h"
 #include "cryptography_interface.h"
 
 CryptographyInterface get_cryptography_interface_kmc_crypto_service(void)
 {
     return NULL;
-}
\ No newline at end of file
+}
+
+int32_t Crypto_Get_Cam_Token_Stats(CamTokenStats_t* stats)
+{
+    stats = stats;
+    return CAM_CONFIG_NOT_SUPPORTED_ERROR;
+}
+
+int32_t Crypto_Get_Kmc_Endpoint_Stats(uint8_t endpoint_idx, KmcEndpointStats_t* stats)
+{
+    endpoint_idx = endpoint_idx;
+    stats = stats;
+    return CRYPTOGRAPHY_INVALID_CRYPTO_INTERFACE_TYPE;
+}
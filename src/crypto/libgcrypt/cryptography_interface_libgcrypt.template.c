@@ -13,6 +13,7 @@
  */
 
 #include <gcrypt.h>
+#include <pthread.h>
 
 
 #include "crypto.h"
@@ -73,12 +74,58 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
 static int32_t cryptography_get_acs_algo(int8_t algo_enum);
 static int32_t cryptography_get_ecs_algo(int8_t algo_enum);
 static int32_t cryptography_get_ecs_mode(int8_t algo_enum);
+static int32_t cryptography_key_invalidate(uint32_t key_id);
+static int32_t cryptography_key_warm(uint32_t key_id, uint8_t* key, uint32_t len_key, uint8_t* ecs);
+
+/*
+** Key Schedule Cache
+** Keyed cipher and MAC handles, so that frames on the same key reuse the expanded key schedule (and GCM hash table
+** or CMAC subkeys) instead of setting the key up again. An entry is looked up by the SA's key ID and the generation
+** from Crypto_Key_Generation, and compared with the key bytes passed in, as key rings can be written in place.
+** Entries are checked out while a frame uses them. Publishing a key closes its entries, which wipes the schedules.
+*/
+#define LIBGCRYPT_KEY_CACHE_SIZE 16
+#define LIBGCRYPT_KEY_CACHE_MAX_KEY_LEN 64
+
+typedef struct
+{
+    uint8_t in_use;
+    uint8_t busy;
+    uint8_t stale; // Invalidated while checked out, closed when released
+    uint8_t is_mac;
+    uint32_t key_id;
+    uint32_t generation;
+    int32_t algo;
+    int32_t mode;
+    uint32_t flags;
+    uint32_t len_key;
+    uint64_t last_used;
+    uint8_t key[LIBGCRYPT_KEY_CACHE_MAX_KEY_LEN];
+    gcry_cipher_hd_t cipher_hd;
+    gcry_mac_hd_t mac_hd;
+} cryptography_key_cache_entry_t;
+
+static int32_t cryptography_key_cache_acquire(uint8_t is_mac, SecurityAssociation_t* sa_ptr, const uint8_t* key,
+                                              uint32_t len_key, int32_t algo, int32_t mode, uint32_t flags,
+                                              cryptography_key_cache_entry_t* scratch,
+                                              cryptography_key_cache_entry_t** handle);
+static int32_t cryptography_key_cache_acquire_id(uint8_t is_mac, uint8_t cacheable, uint32_t key_id,
+                                                 const uint8_t* key, uint32_t len_key, int32_t algo, int32_t mode,
+                                                 uint32_t flags, cryptography_key_cache_entry_t* scratch,
+                                                 cryptography_key_cache_entry_t** handle);
+static void cryptography_key_cache_release(cryptography_key_cache_entry_t* handle);
+static void cryptography_key_cache_close(cryptography_key_cache_entry_t* entry);
+static void cryptography_key_cache_flush(void);
 
 /*
 ** Module Variables
 */
 // Cryptography Interface
 static CryptographyInterfaceStruct cryptography_if_struct;
+// Key Schedule Cache
+static cryptography_key_cache_entry_t cryptography_key_cache[LIBGCRYPT_KEY_CACHE_SIZE];
+static pthread_mutex_t cryptography_key_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t cryptography_key_cache_clock = 0;
 
 CryptographyInterface get_cryptography_interface_libgcrypt(void)
 {
@@ -93,6 +140,8 @@ CryptographyInterface get_cryptography_interface_libgcrypt(void)
     cryptography_if_struct.cryptography_aead_decrypt = cryptography_aead_decrypt;
     cryptography_if_struct.cryptography_get_acs_algo = cryptography_get_acs_algo;
     cryptography_if_struct.cryptography_get_ecs_algo = cryptography_get_ecs_algo;
+    cryptography_if_struct.cryptography_key_invalidate = cryptography_key_invalidate;
+    cryptography_if_struct.cryptography_key_warm = cryptography_key_warm;
     return &cryptography_if_struct;
 }
 
@@ -116,10 +165,15 @@ static int32_t cryptography_init(void)
         printf(KRED "ERROR: gcrypt self test failed\n" RESET);
     }
     gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    cryptography_key_cache_flush();
 
     return status;
 }
-static int32_t cryptography_shutdown(void){ return CRYPTO_LIB_SUCCESS; }
+static int32_t cryptography_shutdown(void)
+{
+    cryptography_key_cache_flush();
+    return CRYPTO_LIB_SUCCESS;
+}
 
 static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
                                          uint8_t* data_in, size_t len_data_in,
@@ -132,11 +186,11 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
 { 
     gcry_error_t gcry_error = GPG_ERR_NO_ERROR;
     gcry_mac_hd_t tmp_mac_hd;
+    cryptography_key_cache_entry_t key_scratch;
+    cryptography_key_cache_entry_t* key_handle = NULL;
     int32_t status = CRYPTO_LIB_SUCCESS;
     uint8_t* key_ptr = key;
 
-    sa_ptr = sa_ptr; // Unused in this implementation
-
     // Need to copy the data over, since authentication won't change/move the data directly
     if(data_out != NULL)
     {
@@ -158,15 +212,13 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
         return CRYPTO_LIB_ERR_UNSUPPORTED_ACS;
     }
 
-    gcry_error = gcry_mac_open(&(tmp_mac_hd), algo, GCRY_MAC_FLAG_SECURE, NULL);
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
+    status = cryptography_key_cache_acquire(CRYPTO_TRUE, sa_ptr, key_ptr, len_key, algo, 0, GCRY_MAC_FLAG_SECURE,
+                                            &key_scratch, &key_handle);
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        printf(KRED "ERROR: gcry_mac_open error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
-    gcry_error = gcry_mac_setkey(tmp_mac_hd, key_ptr, len_key);
+    tmp_mac_hd = key_handle->mac_hd;
     
 #ifdef SA_DEBUG
     uint32_t i;
@@ -177,14 +229,6 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
     }
     printf("\n");
 #endif
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
-    {
-        printf(KRED "ERROR: gcry_mac_setkey error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        gcry_mac_close(tmp_mac_hd);
-        return status;
-    }
 
     // If MAC needs IV, set it (only for certain ciphers)
     if (iv_len > 0)
@@ -195,7 +239,7 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
             printf(KRED "ERROR: gcry_mac_setiv error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
             printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
             status = CRYPTO_LIB_ERROR;
-            gcry_mac_close(tmp_mac_hd);
+            cryptography_key_cache_release(key_handle);
             return status;
         }
     }
@@ -210,7 +254,7 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
                 gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
         status = CRYPTO_LIB_ERROR;
-        gcry_mac_close(tmp_mac_hd);
+        cryptography_key_cache_release(key_handle);
         return status;
     }
 
@@ -224,12 +268,12 @@ static int32_t cryptography_authenticate(uint8_t* data_out, size_t len_data_out,
         printf(KRED "ERROR: gcry_mac_read error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
         status = CRYPTO_LIB_ERR_MAC_RETRIEVAL_ERROR;
-        gcry_mac_close(tmp_mac_hd);
+        cryptography_key_cache_release(key_handle);
         return status;
     }
 
     // Zeroise any sensitive information
-    gcry_mac_close(tmp_mac_hd);
+    cryptography_key_cache_release(key_handle);
     return status; 
 }
 static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t len_data_out,
@@ -243,13 +287,13 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
 { 
     gcry_error_t gcry_error = GPG_ERR_NO_ERROR;
     gcry_mac_hd_t tmp_mac_hd;
+    cryptography_key_cache_entry_t key_scratch;
+    cryptography_key_cache_entry_t* key_handle = NULL;
     int32_t status = CRYPTO_LIB_SUCCESS;
     uint8_t* key_ptr = key;
     size_t len_in = len_data_in; // Unused
     len_in = len_in;
 
-    sa_ptr = sa_ptr; // Unused in this implementation
-
     // Need to copy the data over, since authentication won't change/move the data directly
     // If you don't want data out, don't set a data out length
 
@@ -272,16 +316,13 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
         return CRYPTO_LIB_ERR_UNSUPPORTED_ACS;
     }
 
-    gcry_error = gcry_mac_open(&(tmp_mac_hd), algo, GCRY_MAC_FLAG_SECURE, NULL);
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
+    status = cryptography_key_cache_acquire(CRYPTO_TRUE, sa_ptr, key_ptr, len_key, algo, 0, GCRY_MAC_FLAG_SECURE,
+                                            &key_scratch, &key_handle);
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        printf(KRED "ERROR: gcry_mac_open error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n" RESET, gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
-
-    gcry_error = gcry_mac_setkey(tmp_mac_hd, key_ptr, len_key);
+    tmp_mac_hd = key_handle->mac_hd;
 #ifdef SA_DEBUG
     uint32_t i;
     printf(KYEL "Validate MAC Printing Key:\n\t");
@@ -291,14 +332,6 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
     }
     printf("\n" RESET);
 #endif
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
-    {
-        printf(KRED "ERROR: gcry_mac_setkey error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n" RESET, gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        gcry_mac_close(tmp_mac_hd);
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        return status;
-    }
     // If MAC needs IV, set it (only for certain ciphers)
     if (iv_len > 0)
     {
@@ -307,7 +340,7 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
         {
             printf(KRED "ERROR: gcry_mac_setiv error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
             printf(KRED "Failure: %s/%s\n" RESET, gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-            gcry_mac_close(tmp_mac_hd);
+            cryptography_key_cache_release(key_handle);
             status = CRYPTO_LIB_ERROR;
             return status;
         }
@@ -321,7 +354,7 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
         printf(KRED "ERROR: gcry_mac_write error code %d\n" RESET,
                 gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n" RESET, gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        gcry_mac_close(tmp_mac_hd);
+        cryptography_key_cache_release(key_handle);
         status = CRYPTO_LIB_ERROR;
         return status;
     }
@@ -337,6 +370,7 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
     {
         printf(KRED "ERROR: gcry_mac_read error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         status = CRYPTO_LIB_ERR_MAC_RETRIEVAL_ERROR;
+        cryptography_key_cache_release(key_handle);
         return status;
     }
 
@@ -368,7 +402,7 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
     {
         printf(KRED "ERROR: gcry_mac_verify error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n" RESET, gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        gcry_mac_close(tmp_mac_hd);
+        cryptography_key_cache_release(key_handle);
         status = CRYPTO_LIB_ERR_MAC_VALIDATION_ERROR;
         return status;
     }
@@ -379,8 +413,7 @@ static int32_t cryptography_validate_authentication(uint8_t* data_out, size_t le
     }
 #endif
     // Zeroise any sensitive information
-    gcry_mac_reset(tmp_mac_hd);
-    gcry_mac_close(tmp_mac_hd);
+    cryptography_key_cache_release(key_handle);
     return status; 
 }
 
@@ -392,6 +425,8 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
 {
     gcry_error_t gcry_error = GPG_ERR_NO_ERROR;
     gcry_cipher_hd_t tmp_hd;
+    cryptography_key_cache_entry_t key_scratch;
+    cryptography_key_cache_entry_t* key_handle = NULL;
     int32_t status = CRYPTO_LIB_SUCCESS;
     uint8_t* key_ptr = key;
 
@@ -400,8 +435,6 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
     padding = padding;
     cam_cookies = cam_cookies;
 
-    sa_ptr = sa_ptr; // Unused in this implementation
-
     // Select correct libgcrypt algorith enum
     int32_t algo = -1;
     if (ecs != NULL)
@@ -425,16 +458,13 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
         return CRYPTO_LIB_ERR_UNSUPPORTED_MODE;
     }
 
-    gcry_error = gcry_cipher_open(&(tmp_hd), algo, mode, GCRY_CIPHER_NONE);
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
+    status = cryptography_key_cache_acquire(CRYPTO_FALSE, sa_ptr, key_ptr, len_key, algo, mode,
+                                            GCRY_CIPHER_NONE, &key_scratch, &key_handle);
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        printf(KRED "ERROR: gcry_cipher_open error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
-    gcry_error = gcry_cipher_setkey(tmp_hd, key_ptr, len_key);
-
+    tmp_hd = key_handle->cipher_hd;
 #ifdef SA_DEBUG
     uint32_t i;
     printf(KYEL "Printing Key:\n\t");
@@ -445,21 +475,13 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
-    {
-        printf(KRED "ERROR: gcry_cipher_setkey error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        gcry_cipher_close(tmp_hd);
-        return status;
-    }
     gcry_error = gcry_cipher_setiv(tmp_hd, iv, iv_len);
     if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
     {
         printf(KRED "ERROR: gcry_cipher_setiv error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
         status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        gcry_cipher_close(tmp_hd);
+        cryptography_key_cache_release(key_handle);
         return status;
     }
 
@@ -491,7 +513,7 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
         printf(KRED "ERROR: gcry_cipher_encrypt error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
         status = CRYPTO_LIB_ERR_ENCRYPTION_ERROR;
-        gcry_cipher_close(tmp_hd);
+        cryptography_key_cache_release(key_handle);
         return status;
     }
 
@@ -505,7 +527,7 @@ static int32_t cryptography_encrypt(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    gcry_cipher_close(tmp_hd);
+    cryptography_key_cache_release(key_handle);
     return status;
 }
 
@@ -521,6 +543,8 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
 {
     gcry_error_t gcry_error = GPG_ERR_NO_ERROR;
     gcry_cipher_hd_t tmp_hd;
+    cryptography_key_cache_entry_t key_scratch;
+    cryptography_key_cache_entry_t* key_handle = NULL;
     int32_t status = CRYPTO_LIB_SUCCESS;
     uint8_t* key_ptr = key;
 
@@ -528,8 +552,6 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
     acs = acs;
     cam_cookies = cam_cookies;
 
-    sa_ptr = sa_ptr; // Unused in this implementation
-
     // Select correct libgcrypt ecs enum
     int32_t algo = -1;
     if (ecs != NULL)
@@ -551,22 +573,14 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
     if (mode == CRYPTO_LIB_ERR_UNSUPPORTED_ECS_MODE) return CRYPTO_LIB_ERR_UNSUPPORTED_ECS_MODE;
     
     // TODO: Get Flag Functionality
-    if(mode == CRYPTO_CIPHER_AES256_CBC_MAC)
-    {
-        gcry_error = gcry_cipher_open(&(tmp_hd), algo, mode, GCRY_CIPHER_CBC_MAC);
-    }
-    else
+    status = cryptography_key_cache_acquire(CRYPTO_FALSE, sa_ptr, key_ptr, len_key, algo, mode,
+                                            (mode == CRYPTO_CIPHER_AES256_CBC_MAC) ? GCRY_CIPHER_CBC_MAC : GCRY_CIPHER_NONE,
+                                            &key_scratch, &key_handle);
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        gcry_error = gcry_cipher_open(&(tmp_hd), algo, mode, GCRY_CIPHER_NONE);
-    } 
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
-    {
-        printf(KRED "ERROR: gcry_cipher_open error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
-    gcry_error = gcry_cipher_setkey(tmp_hd, key_ptr, len_key);
+    tmp_hd = key_handle->cipher_hd;
 #ifdef SA_DEBUG
     uint32_t i;
     printf(KYEL "AEAD MAC: Printing Key:\n\t");
@@ -577,21 +591,13 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
     printf("\n");
 #endif
 
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
-    {
-        printf(KRED "ERROR: gcry_cipher_setkey error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        gcry_cipher_close(tmp_hd);
-        return status;
-    }
     gcry_error = gcry_cipher_setiv(tmp_hd, iv, iv_len);
     if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
     {
         printf(KRED "ERROR: gcry_cipher_setiv error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
         status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        gcry_cipher_close(tmp_hd);
+        cryptography_key_cache_release(key_handle);
         return status;
     }
 
@@ -618,7 +624,7 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
                    gcry_error & GPG_ERR_CODE_MASK);
             printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
             status = CRYPTO_LIB_ERR_AUTHENTICATION_ERROR;
-            gcry_cipher_close(tmp_hd);
+            cryptography_key_cache_release(key_handle);
             return status;
         }
     }
@@ -649,7 +655,7 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
         printf(KRED "ERROR: gcry_cipher_encrypt error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
         status = CRYPTO_LIB_ERR_ENCRYPTION_ERROR;
-        gcry_cipher_close(tmp_hd);
+        cryptography_key_cache_release(key_handle);
         return status;
     }
 
@@ -675,7 +681,7 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
                    gcry_error & GPG_ERR_CODE_MASK);
             printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
             status = CRYPTO_LIB_ERR_MAC_RETRIEVAL_ERROR;
-            gcry_cipher_close(tmp_hd);
+            cryptography_key_cache_release(key_handle);
             return status;
         }
 
@@ -689,7 +695,7 @@ static int32_t cryptography_aead_encrypt(uint8_t* data_out, size_t len_data_out,
 #endif
     }
 
-    gcry_cipher_close(tmp_hd);
+    cryptography_key_cache_release(key_handle);
     return status;
 }
 
@@ -701,6 +707,8 @@ static int32_t cryptography_decrypt(uint8_t* data_out, size_t len_data_out,
                                          uint8_t* ecs, uint8_t* acs, char* cam_cookies)
 {
     gcry_cipher_hd_t tmp_hd;
+    cryptography_key_cache_entry_t key_scratch;
+    cryptography_key_cache_entry_t* key_handle = NULL;
     gcry_error_t gcry_error = GPG_ERR_NO_ERROR;
     int32_t status = CRYPTO_LIB_SUCCESS;
     uint8_t* key_ptr = key;
@@ -709,8 +717,6 @@ static int32_t cryptography_decrypt(uint8_t* data_out, size_t len_data_out,
     acs = acs;
     cam_cookies = cam_cookies;
 
-    sa_ptr = sa_ptr; // Unused in this implementation
-
     // Select correct libgcrypt ecs enum
     int32_t algo = -1;
     if (ecs != NULL)
@@ -734,30 +740,20 @@ static int32_t cryptography_decrypt(uint8_t* data_out, size_t len_data_out,
         return CRYPTO_LIB_ERR_UNSUPPORTED_MODE;
     } 
 
-    gcry_error = gcry_cipher_open(&(tmp_hd), algo, mode, GCRY_CIPHER_NONE);
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
+    status = cryptography_key_cache_acquire(CRYPTO_FALSE, sa_ptr, key_ptr, len_key, algo, mode,
+                                            GCRY_CIPHER_NONE, &key_scratch, &key_handle);
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        printf(KRED "ERROR: gcry_cipher_open error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        return status;
-    }
-    gcry_error = gcry_cipher_setkey(tmp_hd, key_ptr, len_key);
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
-    {
-        printf(KRED "ERROR: gcry_cipher_setkey error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        gcry_cipher_close(tmp_hd);
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
+    tmp_hd = key_handle->cipher_hd;
 
     gcry_error = gcry_cipher_setiv(tmp_hd, iv, iv_len);
     if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
     {
         printf(KRED "ERROR: gcry_cipher_setiv error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        gcry_cipher_close(tmp_hd);
+        cryptography_key_cache_release(key_handle);
         status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
@@ -771,13 +767,13 @@ static int32_t cryptography_decrypt(uint8_t* data_out, size_t len_data_out,
     if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
     {
         printf(KRED "ERROR: gcry_cipher_decrypt error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        gcry_cipher_close(tmp_hd);
+        cryptography_key_cache_release(key_handle);
         status = CRYPTO_LIB_ERR_DECRYPT_ERROR;
         return status;
     }
 
 
-    gcry_cipher_close(tmp_hd);
+    cryptography_key_cache_release(key_handle);
     return status;
 
 }
@@ -793,6 +789,8 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
                                          uint8_t aad_bool, uint8_t* ecs, uint8_t* acs, char* cam_cookies)
 {
     gcry_cipher_hd_t tmp_hd;
+    cryptography_key_cache_entry_t key_scratch;
+    cryptography_key_cache_entry_t* key_handle = NULL;
     gcry_error_t gcry_error = GPG_ERR_NO_ERROR;
     int32_t status = CRYPTO_LIB_SUCCESS;
     uint8_t* key_ptr = key;
@@ -801,8 +799,6 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
     acs = acs;
     cam_cookies = cam_cookies;
 
-    sa_ptr = sa_ptr; // Unused in this implementation
-
     // Select correct libgcrypt ecs enum
     int32_t algo = -1;
     if (ecs != NULL)
@@ -826,29 +822,19 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
         return status;
     }
 
-    gcry_error = gcry_cipher_open(&(tmp_hd), GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM, GCRY_CIPHER_NONE);
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
-    {
-        printf(KRED "ERROR: gcry_cipher_open error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
-        return status;
-    }
-    gcry_error = gcry_cipher_setkey(tmp_hd, key_ptr, len_key);
-    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
+    status = cryptography_key_cache_acquire(CRYPTO_FALSE, sa_ptr, key_ptr, len_key, GCRY_CIPHER_AES256,
+                                            GCRY_CIPHER_MODE_GCM, GCRY_CIPHER_NONE, &key_scratch, &key_handle);
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        printf(KRED "ERROR: gcry_cipher_setkey error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-        printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        gcry_cipher_close(tmp_hd);
-        status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
+    tmp_hd = key_handle->cipher_hd;
     gcry_error = gcry_cipher_setiv(tmp_hd, iv, iv_len);
     if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
     {
         printf(KRED "ERROR: gcry_cipher_setiv error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
         printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-        gcry_cipher_close(tmp_hd);
+        cryptography_key_cache_release(key_handle);
         status = CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
         return status;
     }
@@ -863,7 +849,7 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
         {
             printf(KRED "ERROR: gcry_cipher_authenticate error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
             printf(KRED "Failure: %s/%s\n", gcry_strsource(gcry_error), gcry_strerror(gcry_error));
-            gcry_cipher_close(tmp_hd);
+            cryptography_key_cache_release(key_handle);
             status = CRYPTO_LIB_ERR_AUTHENTICATION_ERROR;
             return status;
         }
@@ -880,7 +866,7 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
         if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
         {
             printf(KRED "ERROR: gcry_cipher_decrypt error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-            gcry_cipher_close(tmp_hd);
+            cryptography_key_cache_release(key_handle);
             status = CRYPTO_LIB_ERR_DECRYPT_ERROR;
             return status;
         }
@@ -895,7 +881,7 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
         if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
         {
             printf(KRED "ERROR: gcry_cipher_decrypt error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
-            gcry_cipher_close(tmp_hd);
+            cryptography_key_cache_release(key_handle);
             status = CRYPTO_LIB_ERR_DECRYPT_ERROR;
             return status;
         }
@@ -938,16 +924,315 @@ static int32_t cryptography_aead_decrypt(uint8_t* data_out, size_t len_data_out,
         {
             printf(KRED "ERROR: gcry_cipher_checktag error code %d\n" RESET, gcry_error & GPG_ERR_CODE_MASK);
             fprintf(stderr, "gcry_cipher_decrypt failed: %s\n", gpg_strerror(gcry_error));
-            gcry_cipher_close(tmp_hd);
+            cryptography_key_cache_release(key_handle);
             status = CRYPTO_LIB_ERR_MAC_VALIDATION_ERROR;
             return status;
         }
     }
 
-    gcry_cipher_close(tmp_hd);
+    cryptography_key_cache_release(key_handle);
     return status;
 }
 
+/**
+ * @brief Function: cryptography_key_invalidate
+ * Closes the cached handles of a key that has been replaced, wiping its key schedules
+ * @param key_id: uint32_t
+ * @return int32: Success/Failure
+ **/
+static int32_t cryptography_key_invalidate(uint32_t key_id)
+{
+    pthread_mutex_lock(&cryptography_key_cache_lock);
+    for (uint32_t i = 0; i < LIBGCRYPT_KEY_CACHE_SIZE; i++)
+    {
+        if (!cryptography_key_cache[i].in_use || (cryptography_key_cache[i].key_id != key_id))
+        {
+            continue;
+        }
+        if (cryptography_key_cache[i].busy)
+        {
+            cryptography_key_cache[i].stale = 1;
+        }
+        else
+        {
+            cryptography_key_cache_close(&cryptography_key_cache[i]);
+        }
+    }
+    pthread_mutex_unlock(&cryptography_key_cache_lock);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: cryptography_key_warm
+ * Sets up and caches the cipher handle of a key before its first use, so the first frames or key verifications on a
+ * key installed by OTAR do not pay for the key schedule
+ * @param key_id: uint32_t
+ * @param key: uint8_t*
+ * @param len_key: uint32_t
+ * @param ecs: uint8_t*, cipher the key will be used with
+ * @return int32: Success/Failure
+ **/
+static int32_t cryptography_key_warm(uint32_t key_id, uint8_t* key, uint32_t len_key, uint8_t* ecs)
+{
+    cryptography_key_cache_entry_t key_scratch;
+    cryptography_key_cache_entry_t* key_handle = NULL;
+    int32_t algo;
+    int32_t mode;
+    int32_t status;
+
+    if (ecs == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_ECS_PTR;
+    }
+    algo = cryptography_get_ecs_algo(*ecs);
+    if (algo == CRYPTO_LIB_ERR_UNSUPPORTED_ECS)
+    {
+        return CRYPTO_LIB_ERR_UNSUPPORTED_ECS;
+    }
+    mode = cryptography_get_ecs_mode(*ecs);
+    if (mode == CRYPTO_LIB_ERR_UNSUPPORTED_ECS_MODE)
+    {
+        return CRYPTO_LIB_ERR_UNSUPPORTED_ECS_MODE;
+    }
+
+    status = cryptography_key_cache_acquire_id(CRYPTO_FALSE, CRYPTO_TRUE, key_id, key, len_key, algo, mode,
+                                               (mode == CRYPTO_CIPHER_AES256_CBC_MAC) ? GCRY_CIPHER_CBC_MAC : GCRY_CIPHER_NONE,
+                                               &key_scratch, &key_handle);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        cryptography_key_cache_release(key_handle);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: cryptography_key_cache_acquire
+ * Checks out a handle keyed with key, from the cache when a frame already set the same key up. Handles for calls
+ * without an SA, for long keys, or when every entry is checked out are opened for the one call.
+ * @param is_mac: uint8_t, CRYPTO_TRUE for a gcry_mac handle, otherwise a gcry_cipher handle
+ * @param sa_ptr: SecurityAssociation_t*, supplies the key ID (akid for MACs, ekid otherwise), may be NULL
+ * @param key: const uint8_t*
+ * @param len_key: uint32_t
+ * @param algo: int32_t, libgcrypt cipher or MAC algorithm
+ * @param mode: int32_t, libgcrypt cipher mode, unused for MACs
+ * @param flags: uint32_t, passed to the open call
+ * @param scratch: cryptography_key_cache_entry_t*, holds a handle that is not cached
+ * @param handle: cryptography_key_cache_entry_t**, set to the handle to use and pass to the release
+ * @return int32: Success/Failure
+ **/
+static int32_t cryptography_key_cache_acquire(uint8_t is_mac, SecurityAssociation_t* sa_ptr, const uint8_t* key,
+                                              uint32_t len_key, int32_t algo, int32_t mode, uint32_t flags,
+                                              cryptography_key_cache_entry_t* scratch,
+                                              cryptography_key_cache_entry_t** handle)
+{
+    uint32_t key_id = 0;
+
+    if (sa_ptr != NULL)
+    {
+        key_id = (is_mac == CRYPTO_TRUE) ? sa_ptr->akid : sa_ptr->ekid;
+    }
+    return cryptography_key_cache_acquire_id(is_mac, (sa_ptr != NULL), key_id, key, len_key, algo, mode, flags,
+                                             scratch, handle);
+}
+
+/**
+ * @brief Function: cryptography_key_cache_acquire_id
+ * cryptography_key_cache_acquire for callers that name the key by ID
+ * @param is_mac: uint8_t
+ * @param cacheable: uint8_t, CRYPTO_FALSE opens a handle for the one call
+ * @param key_id: uint32_t
+ * @param key: const uint8_t*
+ * @param len_key: uint32_t
+ * @param algo: int32_t
+ * @param mode: int32_t
+ * @param flags: uint32_t
+ * @param scratch: cryptography_key_cache_entry_t*
+ * @param handle: cryptography_key_cache_entry_t**
+ * @return int32: Success/Failure
+ **/
+static int32_t cryptography_key_cache_acquire_id(uint8_t is_mac, uint8_t cacheable, uint32_t key_id,
+                                                 const uint8_t* key, uint32_t len_key, int32_t algo, int32_t mode,
+                                                 uint32_t flags, cryptography_key_cache_entry_t* scratch,
+                                                 cryptography_key_cache_entry_t** handle)
+{
+    gcry_error_t gcry_error = GPG_ERR_NO_ERROR;
+    cryptography_key_cache_entry_t* entry = NULL;
+    uint32_t generation = 0;
+    uint32_t i;
+
+    cacheable = cacheable && (len_key <= LIBGCRYPT_KEY_CACHE_MAX_KEY_LEN);
+    memset(scratch, 0, sizeof(cryptography_key_cache_entry_t));
+    if (cacheable)
+    {
+        generation = Crypto_Key_Generation(key_id);
+
+        pthread_mutex_lock(&cryptography_key_cache_lock);
+        for (i = 0; i < LIBGCRYPT_KEY_CACHE_SIZE; i++)
+        {
+            entry = &cryptography_key_cache[i];
+            if (entry->in_use && !entry->busy && !entry->stale && (entry->is_mac == is_mac) &&
+                (entry->key_id == key_id) && (entry->generation == generation) && (entry->algo == algo) &&
+                (entry->mode == mode) && (entry->flags == flags) && (entry->len_key == len_key) &&
+                (memcmp(entry->key, key, len_key) == 0))
+            {
+                entry->busy = 1;
+                entry->last_used = ++cryptography_key_cache_clock;
+                pthread_mutex_unlock(&cryptography_key_cache_lock);
+                *handle = entry;
+                return CRYPTO_LIB_SUCCESS;
+            }
+        }
+        pthread_mutex_unlock(&cryptography_key_cache_lock);
+    }
+
+    // Miss, set the key up outside the lock
+    scratch->is_mac = is_mac;
+    if (is_mac == CRYPTO_TRUE)
+    {
+        gcry_error = gcry_mac_open(&(scratch->mac_hd), algo, flags, NULL);
+    }
+    else
+    {
+        gcry_error = gcry_cipher_open(&(scratch->cipher_hd), algo, mode, flags);
+    }
+    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
+    {
+        printf(KRED "ERROR: %s error code %d\n" RESET, (is_mac == CRYPTO_TRUE) ? "gcry_mac_open" : "gcry_cipher_open",
+               gcry_error & GPG_ERR_CODE_MASK);
+        printf(KRED "Failure: %s/%s\n" RESET, gcry_strsource(gcry_error), gcry_strerror(gcry_error));
+        return CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
+    }
+    if (is_mac == CRYPTO_TRUE)
+    {
+        gcry_error = gcry_mac_setkey(scratch->mac_hd, key, len_key);
+    }
+    else
+    {
+        gcry_error = gcry_cipher_setkey(scratch->cipher_hd, key, len_key);
+    }
+    if ((gcry_error & GPG_ERR_CODE_MASK) != GPG_ERR_NO_ERROR)
+    {
+        printf(KRED "ERROR: %s error code %d\n" RESET, (is_mac == CRYPTO_TRUE) ? "gcry_mac_setkey" : "gcry_cipher_setkey",
+               gcry_error & GPG_ERR_CODE_MASK);
+        printf(KRED "Failure: %s/%s\n" RESET, gcry_strsource(gcry_error), gcry_strerror(gcry_error));
+        cryptography_key_cache_close(scratch);
+        return CRYPTO_LIB_ERR_LIBGCRYPT_ERROR;
+    }
+    scratch->in_use = 1;
+    *handle = scratch;
+    if (!cacheable)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+
+    // Take a free entry, or the least recently used one that is not checked out
+    entry = NULL;
+    pthread_mutex_lock(&cryptography_key_cache_lock);
+    for (i = 0; i < LIBGCRYPT_KEY_CACHE_SIZE; i++)
+    {
+        if (!cryptography_key_cache[i].in_use)
+        {
+            entry = &cryptography_key_cache[i];
+            break;
+        }
+        if (!cryptography_key_cache[i].busy &&
+            ((entry == NULL) || (cryptography_key_cache[i].last_used < entry->last_used)))
+        {
+            entry = &cryptography_key_cache[i];
+        }
+    }
+    if (entry != NULL)
+    {
+        if (entry->in_use)
+        {
+            cryptography_key_cache_close(entry);
+        }
+        *entry = *scratch;
+        entry->busy = 1;
+        entry->key_id = key_id;
+        entry->generation = generation;
+        entry->algo = algo;
+        entry->mode = mode;
+        entry->flags = flags;
+        entry->len_key = len_key;
+        entry->last_used = ++cryptography_key_cache_clock;
+        memcpy(entry->key, key, len_key);
+        memset(scratch, 0, sizeof(cryptography_key_cache_entry_t));
+        *handle = entry;
+    }
+    pthread_mutex_unlock(&cryptography_key_cache_lock);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: cryptography_key_cache_release
+ * Returns a handle from cryptography_key_cache_acquire. The handle is reset so no IV, data or tag state outlives
+ * the call; the key schedule stays for the next frame.
+ * @param handle: cryptography_key_cache_entry_t*
+ **/
+static void cryptography_key_cache_release(cryptography_key_cache_entry_t* handle)
+{
+    if ((handle < &cryptography_key_cache[0]) || (handle >= &cryptography_key_cache[LIBGCRYPT_KEY_CACHE_SIZE]))
+    {
+        cryptography_key_cache_close(handle);
+        return;
+    }
+    if (handle->is_mac == CRYPTO_TRUE)
+    {
+        gcry_mac_reset(handle->mac_hd);
+    }
+    else
+    {
+        gcry_cipher_reset(handle->cipher_hd);
+    }
+    pthread_mutex_lock(&cryptography_key_cache_lock);
+    if (handle->stale)
+    {
+        cryptography_key_cache_close(handle);
+    }
+    else
+    {
+        handle->busy = 0;
+    }
+    pthread_mutex_unlock(&cryptography_key_cache_lock);
+}
+
+/**
+ * @brief Function: cryptography_key_cache_close
+ * Closes an entry's handle, which wipes the key schedule, and clears the key copy
+ * @param entry: cryptography_key_cache_entry_t*
+ **/
+static void cryptography_key_cache_close(cryptography_key_cache_entry_t* entry)
+{
+    // Both close calls accept a NULL handle
+    if (entry->is_mac == CRYPTO_TRUE)
+    {
+        gcry_mac_close(entry->mac_hd);
+    }
+    else
+    {
+        gcry_cipher_close(entry->cipher_hd);
+    }
+    memset(entry, 0, sizeof(cryptography_key_cache_entry_t));
+}
+
+/**
+ * @brief Function: cryptography_key_cache_flush
+ * Closes every cached handle, only called while no frame is being processed
+ **/
+static void cryptography_key_cache_flush(void)
+{
+    pthread_mutex_lock(&cryptography_key_cache_lock);
+    for (uint32_t i = 0; i < LIBGCRYPT_KEY_CACHE_SIZE; i++)
+    {
+        if (cryptography_key_cache[i].in_use)
+        {
+            cryptography_key_cache_close(&cryptography_key_cache[i]);
+        }
+    }
+    pthread_mutex_unlock(&cryptography_key_cache_lock);
+}
+
 /**
  * @brief Function: cryptography_get_acs_algo. Maps Cryptolib ACS enums to libgcrypt enums 
  * It is possible for supported algos to vary between crypto libraries
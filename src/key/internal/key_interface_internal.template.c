@@ -15,16 +15,151 @@
    NASA IV&V
    jstar-development-team@mail.nasa.gov
 */
+#include "crypto.h"
+#include "crypto_context_internal.h"
 #include "key_interface.h"
+#ifdef CRYPTO_STATIC_CONFIG
+#include "crypto_static_tables.h"
+#endif
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+** Key Ring Arena
+** The key ring and every published key version live in anonymous mappings that are locked in memory (best effort,
+** see RLIMIT_MEMLOCK), left out of core dumps and fenced by a PROT_NONE page on each side. The key ring mapping holds
+** only the key IDs below the configured capacity and is replaced by key_init. Published versions are carved from
+** chunks that stay mapped for the life of the process, as a retired version can be handed back by the epoch code after
+** key_shutdown.
+*/
+
+/*
+** Encrypted Key Store
+** Crypto_Config_Key_Store has key_init take the keys from a file written by Crypto_Key_Store_Save instead of the built
+** in ones: a header, an index holding one record offset per key ID (0 when the ID has no key) and one AES-256-GCM
+** sealed record per key. key_init only maps the file and checks the header, a key is opened the first time get_key
+** asks for it, so start-up does not depend on how many keys the store holds. The header and the record's key ID,
+** length and state are authenticated along with the value; a record that fails to open reads as KEY_CORRUPTED.
+*/
+
+/* Constants */
+#define KEY_VERSION_CHUNK_SIZE 32
+#define KEY_STORE_MAGIC 0x5359454B // "KEYS"
+#define KEY_STORE_VERSION 1
+#define KEY_STORE_ID_SIZE 16
+#define KEY_STORE_IV_SIZE 12
+#define KEY_STORE_TAG_SIZE 16
+#define KEY_STORE_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+/* Types */
+typedef struct
+{
+    uint8_t* base; // Leading guard page
+    size_t size;   // Whole mapping, guard pages included
+    uint8_t locked;
+} key_arena_t;
+
+typedef struct
+{
+    uint16_t key_id;
+    uint8_t key_state;
+    uint8_t value[32];
+} key_default_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t store_size; // Including the header
+    uint32_t num_ids;    // Index entries, the highest key ID plus one
+    uint32_t num_keys;
+    uint32_t reserved;
+    uint8_t store_id[KEY_STORE_ID_SIZE]; // Random per save, keeps records from being moved between stores
+} key_store_header_t;
+
+typedef struct
+{
+    uint32_t key_id;
+    uint32_t key_len;
+    uint8_t key_state;
+    uint8_t reserved[3];
+    uint8_t iv[KEY_STORE_IV_SIZE];
+    uint8_t tag[KEY_STORE_TAG_SIZE];
+    // key_len bytes of sealed key value follow
+} key_store_record_t;
 
 /* Variables */
-static crypto_key_t key_ring[NUM_KEYS] = {0};
+static key_arena_t key_ring_arena = {0};
+static crypto_key_t* key_ring = NULL;
+static uint32_t key_ring_capacity = 0;
+// Current version of each key, NULL while it is still the one in key_ring. Loaded without locks by the frame paths,
+// replaced by key_publish; replaced versions are freed through epoch-based reclamation.
+static crypto_key_t* key_ring_published[NUM_KEYS] = {0};
+static crypto_key_t* key_version_free_list = NULL;
+static pthread_mutex_t key_version_lock = PTHREAD_MUTEX_INITIALIZER;
 static KeyInterfaceStruct key_if_struct;
+// Mapped key store, NULL unless Crypto_Config_Key_Store was called. The KEK is kept in the key ring arena.
+static uint8_t* key_store_image = NULL;
+static size_t key_store_image_size = 0;
+static uint8_t* key_store_kek = NULL;
+static uint8_t key_store_loaded[NUM_KEYS] = {0};
+static pthread_mutex_t key_store_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#ifndef CRYPTO_STATIC_CONFIG
+// Unit test keys
+static const key_default_t key_defaults[] = {
+    // Master Keys
+    {0, KEY_ACTIVE, {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+                     0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F}},
+    {1, KEY_ACTIVE, {0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+                     0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F}},
+    {2, KEY_ACTIVE, {0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+                     0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F}},
+    // Session Keys
+    {128, KEY_ACTIVE, {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+                       0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF}},
+    {129, KEY_ACTIVE, {0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89,
+                       0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89}},
+    {130, KEY_ACTIVE, {0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10,
+                       0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10}},
+    {131, KEY_ACTIVE, {0x98, 0x76, 0x54, 0x32, 0x10, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10, 0xFE, 0xDC, 0xBA,
+                       0x98, 0x76, 0x54, 0x32, 0x10, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10, 0xFE, 0xDC, 0xBA}},
+    {132, KEY_PREACTIVE, {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89,
+                          0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89}},
+    {133, KEY_ACTIVE, {0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF,
+                       0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF}},
+    {134, KEY_DEACTIVATED, {0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10,
+                            0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67, 0x89, 0xFE, 0xDC, 0xBA, 0x98, 0x76, 0x54, 0x32, 0x10}},
+    {135, KEY_DEACTIVATED, {0x00}},
+    // Reference:
+    // https://csrc.nist.gov/CSRC/media/Projects/Cryptographic-Algorithm-Validation-Program/documents/mac/gcmtestvectors.zip
+    {136, KEY_DEACTIVATED, {0xff, 0x9f, 0x92, 0x84, 0xcf, 0x59, 0x9e, 0xac, 0x3b, 0x11, 0x99, 0x05, 0xa7, 0xd1, 0x88, 0x51,
+                            0xe7, 0xe3, 0x74, 0xcf, 0x63, 0xae, 0xa0, 0x43, 0x58, 0x58, 0x6b, 0x0f, 0x75, 0x76, 0x70, 0xf9}},
+};
+#endif
 
 /* Prototypes */
 static crypto_key_t* get_key(uint32_t key_id);
 static int32_t key_init(void);
 static int32_t key_shutdown(void);
+static int32_t key_publish(uint32_t key_id, const crypto_key_t* key);
+static void key_release_published(void);
+static uint8_t* key_arena_map(key_arena_t* arena, size_t bytes);
+static void key_arena_unmap(key_arena_t* arena);
+static crypto_key_t* key_version_alloc(void);
+static void key_version_free(void* ptr);
+static int32_t key_load_builtin(void);
+static int32_t key_store_open(const char* path, const uint8_t* kek);
+static void key_store_close(void);
+static void key_store_load(uint32_t key_id);
+static void key_store_aad(uint8_t* aad, const key_store_header_t* header, const key_store_record_t* record);
+static int32_t key_store_write(const char* path, const uint8_t* image, size_t image_size);
 
 /* Functions */
 KeyInterface get_key_interface_internal(void)
@@ -33,6 +168,7 @@ KeyInterface get_key_interface_internal(void)
     key_if_struct.get_key = get_key;
     key_if_struct.key_init = key_init;
     key_if_struct.key_shutdown = key_shutdown;
+    key_if_struct.key_publish = key_publish;
 
     /* Key Interface, SDLS-EP */
 
@@ -42,466 +178,569 @@ KeyInterface get_key_interface_internal(void)
 static crypto_key_t* get_key(uint32_t key_id)
 {
     crypto_key_t* key_ptr = NULL;
-    
-    if(key_id < NUM_KEYS)
+
+    if(key_id < key_ring_capacity)
     {
-        key_ptr = &key_ring[key_id];
+        key_ptr = __atomic_load_n(&key_ring_published[key_id], __ATOMIC_ACQUIRE);
+        if (key_ptr == NULL)
+        {
+            key_ptr = &key_ring[key_id];
+            if ((key_store_image != NULL) && (__atomic_load_n(&key_store_loaded[key_id], __ATOMIC_ACQUIRE) == 0))
+            {
+                key_store_load(key_id);
+            }
+        }
     }
-    
+
     return key_ptr;
 }
 
 static int32_t key_init(void)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
+    uint32_t capacity = crypto_config.key_capacity;
+    // Configurations built without Crypto_Config_Key_Capacity get the whole key ring
+    if ((capacity == 0) || (capacity > NUM_KEYS))
+    {
+        capacity = NUM_KEYS;
+    }
 
-    // Initialize all to zero
+    key_release_published();
+    key_store_close();
+    key_ring_capacity = 0;
+    key_ring = NULL;
+    key_arena_unmap(&key_ring_arena);
+
+    // A fresh mapping starts zeroed, the key store KEK goes after the key ring
+    key_ring = (crypto_key_t*)key_arena_map(&key_ring_arena, (capacity * sizeof(crypto_key_t)) + KEY_STORE_KEK_SIZE);
+    if (key_ring == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    key_ring_capacity = capacity;
+
+    if (key_store_config != NULL)
+    {
+        status = key_store_open(key_store_config->key_store_path, key_store_config->key_store_kek);
+    }
+    else
+    {
+        status = key_load_builtin();
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+
+    #ifdef DEBUG
+        printf(KGRN "Key internal interface intialized, %u keys%s%s \n" RESET, key_ring_capacity,
+               key_ring_arena.locked ? "" : " (not locked in memory)", (key_store_image != NULL) ? " from key store" : "");
+    #endif
+
+    return status;
+}
+
+/**
+ * @brief Function: key_load_builtin
+ * Fills the key ring with the generated static configuration keys, or the unit test keys
+ * @return int32: Success/Failure
+ **/
+static int32_t key_load_builtin(void)
+{
+#ifdef CRYPTO_STATIC_CONFIG
+    // Keys generated by the crypto_static_config target
+#if CRYPTO_STATIC_NUM_KEYS > 0
+    for(uint32_t i = 0; i < CRYPTO_STATIC_NUM_KEYS; i++)
+    {
+        if (crypto_static_keys[i].key_id >= key_ring_capacity)
+        {
+            return CRYPTO_LIB_ERR_KEY_ID_ERROR;
+        }
+        key_ring[crypto_static_keys[i].key_id] = crypto_static_keys[i].key;
+    }
+#endif
+#else
+    // Unit test keys above a configured capacity are left out
+    for(uint32_t i = 0; i < (sizeof(key_defaults) / sizeof(key_defaults[0])); i++)
+    {
+        if (key_defaults[i].key_id >= key_ring_capacity)
+        {
+            continue;
+        }
+        memcpy(key_ring[key_defaults[i].key_id].value, key_defaults[i].value, sizeof(key_defaults[i].value));
+        key_ring[key_defaults[i].key_id].key_len = sizeof(key_defaults[i].value);
+        key_ring[key_defaults[i].key_id].key_state = key_defaults[i].key_state;
+    }
+#endif
+
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t key_shutdown(void)
+{
+    key_release_published();
+    key_store_close();
+    key_ring_capacity = 0;
+    key_ring = NULL;
+    key_arena_unmap(&key_ring_arena);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: key_publish
+ * Replaces a key with a new version. Readers that already hold the old version keep a consistent copy of it until
+ * they leave their epoch.
+ * @param key_id: uint32_t
+ * @param key: const crypto_key_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t key_publish(uint32_t key_id, const crypto_key_t* key)
+{
+    crypto_key_t* version;
+    crypto_key_t* old;
+
+    if (key_id >= key_ring_capacity)
+    {
+        return CRYPTO_LIB_ERR_KEY_ID_ERROR;
+    }
+    version = key_version_alloc();
+    if (version == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    *version = *key;
+    old = __atomic_exchange_n(&key_ring_published[key_id], version, __ATOMIC_ACQ_REL);
+    if (old != NULL)
+    {
+        Crypto_Epoch_Retire(old, key_version_free);
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: key_release_published
+ * Drops every published key version, only called while no frame is being processed
+ **/
+static void key_release_published(void)
+{
     for(uint32_t i = 0; i < NUM_KEYS; i++)
     {
-        for(uint32_t j = 0; j < KEY_SIZE; j++)
+        if (key_ring_published[i] != NULL)
         {
-            key_ring[i].value[j] = 0;
+            key_version_free(key_ring_published[i]);
+            key_ring_published[i] = NULL;
         }
-        key_ring[i].key_len = 0;
-        key_ring[i].key_state = 0;
     }
+}
 
-    // Master Keys
-    // 0 - 000102030405060708090A0B0C0D0E0F000102030405060708090A0B0C0D0E0F -> ACTIVE
-    key_ring[0].value[0] = 0x00;
-    key_ring[0].value[1] = 0x01;
-    key_ring[0].value[2] = 0x02;
-    key_ring[0].value[3] = 0x03;
-    key_ring[0].value[4] = 0x04;
-    key_ring[0].value[5] = 0x05;
-    key_ring[0].value[6] = 0x06;
-    key_ring[0].value[7] = 0x07;
-    key_ring[0].value[8] = 0x08;
-    key_ring[0].value[9] = 0x09;
-    key_ring[0].value[10] = 0x0A;
-    key_ring[0].value[11] = 0x0B;
-    key_ring[0].value[12] = 0x0C;
-    key_ring[0].value[13] = 0x0D;
-    key_ring[0].value[14] = 0x0E;
-    key_ring[0].value[15] = 0x0F;
-    key_ring[0].value[16] = 0x00;
-    key_ring[0].value[17] = 0x01;
-    key_ring[0].value[18] = 0x02;
-    key_ring[0].value[19] = 0x03;
-    key_ring[0].value[20] = 0x04;
-    key_ring[0].value[21] = 0x05;
-    key_ring[0].value[22] = 0x06;
-    key_ring[0].value[23] = 0x07;
-    key_ring[0].value[24] = 0x08;
-    key_ring[0].value[25] = 0x09;
-    key_ring[0].value[26] = 0x0A;
-    key_ring[0].value[27] = 0x0B;
-    key_ring[0].value[28] = 0x0C;
-    key_ring[0].value[29] = 0x0D;
-    key_ring[0].value[30] = 0x0E;
-    key_ring[0].value[31] = 0x0F;
-    key_ring[0].key_len = 32;
-    key_ring[0].key_state = KEY_ACTIVE;
-    // 1 - 101112131415161718191A1B1C1D1E1F101112131415161718191A1B1C1D1E1F -> ACTIVE
-    key_ring[1].value[0] = 0x10;
-    key_ring[1].value[1] = 0x11;
-    key_ring[1].value[2] = 0x12;
-    key_ring[1].value[3] = 0x13;
-    key_ring[1].value[4] = 0x14;
-    key_ring[1].value[5] = 0x15;
-    key_ring[1].value[6] = 0x16;
-    key_ring[1].value[7] = 0x17;
-    key_ring[1].value[8] = 0x18;
-    key_ring[1].value[9] = 0x19;
-    key_ring[1].value[10] = 0x1A;
-    key_ring[1].value[11] = 0x1B;
-    key_ring[1].value[12] = 0x1C;
-    key_ring[1].value[13] = 0x1D;
-    key_ring[1].value[14] = 0x1E;
-    key_ring[1].value[15] = 0x1F;
-    key_ring[1].value[16] = 0x10;
-    key_ring[1].value[17] = 0x11;
-    key_ring[1].value[18] = 0x12;
-    key_ring[1].value[19] = 0x13;
-    key_ring[1].value[20] = 0x14;
-    key_ring[1].value[21] = 0x15;
-    key_ring[1].value[22] = 0x16;
-    key_ring[1].value[23] = 0x17;
-    key_ring[1].value[24] = 0x18;
-    key_ring[1].value[25] = 0x19;
-    key_ring[1].value[26] = 0x1A;
-    key_ring[1].value[27] = 0x1B;
-    key_ring[1].value[28] = 0x1C;
-    key_ring[1].value[29] = 0x1D;
-    key_ring[1].value[30] = 0x1E;
-    key_ring[1].value[31] = 0x1F;
-    key_ring[1].key_len = 32;
-    key_ring[1].key_state = KEY_ACTIVE;
-    // 2 - 202122232425262728292A2B2C2D2E2F202122232425262728292A2B2C2D2E2F -> ACTIVE
-    key_ring[2].value[0] = 0x20;
-    key_ring[2].value[1] = 0x21;
-    key_ring[2].value[2] = 0x22;
-    key_ring[2].value[3] = 0x23;
-    key_ring[2].value[4] = 0x24;
-    key_ring[2].value[5] = 0x25;
-    key_ring[2].value[6] = 0x26;
-    key_ring[2].value[7] = 0x27;
-    key_ring[2].value[8] = 0x28;
-    key_ring[2].value[9] = 0x29;
-    key_ring[2].value[10] = 0x2A;
-    key_ring[2].value[11] = 0x2B;
-    key_ring[2].value[12] = 0x2C;
-    key_ring[2].value[13] = 0x2D;
-    key_ring[2].value[14] = 0x2E;
-    key_ring[2].value[15] = 0x2F;
-    key_ring[2].value[16] = 0x20;
-    key_ring[2].value[17] = 0x21;
-    key_ring[2].value[18] = 0x22;
-    key_ring[2].value[19] = 0x23;
-    key_ring[2].value[20] = 0x24;
-    key_ring[2].value[21] = 0x25;
-    key_ring[2].value[22] = 0x26;
-    key_ring[2].value[23] = 0x27;
-    key_ring[2].value[24] = 0x28;
-    key_ring[2].value[25] = 0x29;
-    key_ring[2].value[26] = 0x2A;
-    key_ring[2].value[27] = 0x2B;
-    key_ring[2].value[28] = 0x2C;
-    key_ring[2].value[29] = 0x2D;
-    key_ring[2].value[30] = 0x2E;
-    key_ring[2].value[31] = 0x2F;
-    key_ring[2].key_len = 32;
-    key_ring[2].key_state = KEY_ACTIVE;
+/**
+ * @brief Function: key_arena_map
+ * Maps a zeroed, locked region between two guard pages
+ * @param arena: key_arena_t*, filled in for key_arena_unmap
+ * @param bytes: size_t, rounded up to whole pages
+ * @return uint8_t*: The usable region, NULL if it could not be mapped
+ **/
+static uint8_t* key_arena_map(key_arena_t* arena, size_t bytes)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t data_size = ((bytes + page - 1) / page) * page;
+    uint8_t* base;
 
-    // Session Keys
-    // 128 - 0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF -> ACTIVE
-    key_ring[128].value[0] = 0x01;
-    key_ring[128].value[1] = 0x23;
-    key_ring[128].value[2] = 0x45;
-    key_ring[128].value[3] = 0x67;
-    key_ring[128].value[4] = 0x89;
-    key_ring[128].value[5] = 0xAB;
-    key_ring[128].value[6] = 0xCD;
-    key_ring[128].value[7] = 0xEF;
-    key_ring[128].value[8] = 0x01;
-    key_ring[128].value[9] = 0x23;
-    key_ring[128].value[10] = 0x45;
-    key_ring[128].value[11] = 0x67;
-    key_ring[128].value[12] = 0x89;
-    key_ring[128].value[13] = 0xAB;
-    key_ring[128].value[14] = 0xCD;
-    key_ring[128].value[15] = 0xEF;
-    key_ring[128].value[16] = 0x01;
-    key_ring[128].value[17] = 0x23;
-    key_ring[128].value[18] = 0x45;
-    key_ring[128].value[19] = 0x67;
-    key_ring[128].value[20] = 0x89;
-    key_ring[128].value[21] = 0xAB;
-    key_ring[128].value[22] = 0xCD;
-    key_ring[128].value[23] = 0xEF;
-    key_ring[128].value[24] = 0x01;
-    key_ring[128].value[25] = 0x23;
-    key_ring[128].value[26] = 0x45;
-    key_ring[128].value[27] = 0x67;
-    key_ring[128].value[28] = 0x89;
-    key_ring[128].value[29] = 0xAB;
-    key_ring[128].value[30] = 0xCD;
-    key_ring[128].value[31] = 0xEF;
-    key_ring[128].key_len = 32;
-    key_ring[128].key_state = KEY_ACTIVE;
-    // 129 - ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789 -> ACTIVE
-    key_ring[129].value[0] = 0xAB;
-    key_ring[129].value[1] = 0xCD;
-    key_ring[129].value[2] = 0xEF;
-    key_ring[129].value[3] = 0x01;
-    key_ring[129].value[4] = 0x23;
-    key_ring[129].value[5] = 0x45;
-    key_ring[129].value[6] = 0x67;
-    key_ring[129].value[7] = 0x89;
-    key_ring[129].value[8] = 0xAB;
-    key_ring[129].value[9] = 0xCD;
-    key_ring[129].value[10] = 0xEF;
-    key_ring[129].value[11] = 0x01;
-    key_ring[129].value[12] = 0x23;
-    key_ring[129].value[13] = 0x45;
-    key_ring[129].value[14] = 0x67;
-    key_ring[129].value[15] = 0x89;
-    key_ring[129].value[16] = 0xAB;
-    key_ring[129].value[17] = 0xCD;
-    key_ring[129].value[18] = 0xEF;
-    key_ring[129].value[19] = 0x01;
-    key_ring[129].value[20] = 0x23;
-    key_ring[129].value[21] = 0x45;
-    key_ring[129].value[22] = 0x67;
-    key_ring[129].value[23] = 0x89;
-    key_ring[129].value[24] = 0xAB;
-    key_ring[129].value[25] = 0xCD;
-    key_ring[129].value[26] = 0xEF;
-    key_ring[129].value[27] = 0x01;
-    key_ring[129].value[28] = 0x23;
-    key_ring[129].value[29] = 0x45;
-    key_ring[129].value[30] = 0x67;
-    key_ring[129].value[31] = 0x89;
-    key_ring[129].key_len = 32;
-    key_ring[129].key_state = KEY_ACTIVE;
-    // 130 - FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210 -> ACTIVE
-    key_ring[130].value[0] = 0xFE;
-    key_ring[130].value[1] = 0xDC;
-    key_ring[130].value[2] = 0xBA;
-    key_ring[130].value[3] = 0x98;
-    key_ring[130].value[4] = 0x76;
-    key_ring[130].value[5] = 0x54;
-    key_ring[130].value[6] = 0x32;
-    key_ring[130].value[7] = 0x10;
-    key_ring[130].value[8] = 0xFE;
-    key_ring[130].value[9] = 0xDC;
-    key_ring[130].value[10] = 0xBA;
-    key_ring[130].value[11] = 0x98;
-    key_ring[130].value[12] = 0x76;
-    key_ring[130].value[13] = 0x54;
-    key_ring[130].value[14] = 0x32;
-    key_ring[130].value[15] = 0x10;
-    key_ring[130].value[16] = 0xFE;
-    key_ring[130].value[17] = 0xDC;
-    key_ring[130].value[18] = 0xBA;
-    key_ring[130].value[19] = 0x98;
-    key_ring[130].value[20] = 0x76;
-    key_ring[130].value[21] = 0x54;
-    key_ring[130].value[22] = 0x32;
-    key_ring[130].value[23] = 0x10;
-    key_ring[130].value[24] = 0xFE;
-    key_ring[130].value[25] = 0xDC;
-    key_ring[130].value[26] = 0xBA;
-    key_ring[130].value[27] = 0x98;
-    key_ring[130].value[28] = 0x76;
-    key_ring[130].value[29] = 0x54;
-    key_ring[130].value[30] = 0x32;
-    key_ring[130].value[31] = 0x10;
-    key_ring[130].key_len = 32;
-    key_ring[130].key_state = KEY_ACTIVE;
-    // 131 - 9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA -> ACTIVE
-    key_ring[131].value[0] = 0x98;
-    key_ring[131].value[1] = 0x76;
-    key_ring[131].value[2] = 0x54;
-    key_ring[131].value[3] = 0x32;
-    key_ring[131].value[4] = 0x10;
-    key_ring[131].value[5] = 0xFE;
-    key_ring[131].value[6] = 0xDC;
-    key_ring[131].value[7] = 0xBA;
-    key_ring[131].value[8] = 0x98;
-    key_ring[131].value[9] = 0x76;
-    key_ring[131].value[10] = 0x54;
-    key_ring[131].value[11] = 0x32;
-    key_ring[131].value[12] = 0x10;
-    key_ring[131].value[13] = 0xFE;
-    key_ring[131].value[14] = 0xDC;
-    key_ring[131].value[15] = 0xBA;
-    key_ring[131].value[16] = 0x98;
-    key_ring[131].value[17] = 0x76;
-    key_ring[131].value[18] = 0x54;
-    key_ring[131].value[19] = 0x32;
-    key_ring[131].value[20] = 0x10;
-    key_ring[131].value[21] = 0xFE;
-    key_ring[131].value[22] = 0xDC;
-    key_ring[131].value[23] = 0xBA;
-    key_ring[131].value[24] = 0x98;
-    key_ring[131].value[25] = 0x76;
-    key_ring[131].value[26] = 0x54;
-    key_ring[131].value[27] = 0x32;
-    key_ring[131].value[28] = 0x10;
-    key_ring[131].value[29] = 0xFE;
-    key_ring[131].value[30] = 0xDC;
-    key_ring[131].value[31] = 0xBA;
-    key_ring[131].key_len = 32;
-    key_ring[131].key_state = KEY_ACTIVE;
-    // 132 - 0123456789ABCDEFABCDEF01234567890123456789ABCDEFABCDEF0123456789 -> PRE_ACTIVATION
-    key_ring[132].value[0] = 0x01;
-    key_ring[132].value[1] = 0x23;
-    key_ring[132].value[2] = 0x45;
-    key_ring[132].value[3] = 0x67;
-    key_ring[132].value[4] = 0x89;
-    key_ring[132].value[5] = 0xAB;
-    key_ring[132].value[6] = 0xCD;
-    key_ring[132].value[7] = 0xEF;
-    key_ring[132].value[8] = 0xAB;
-    key_ring[132].value[9] = 0xCD;
-    key_ring[132].value[10] = 0xEF;
-    key_ring[132].value[11] = 0x01;
-    key_ring[132].value[12] = 0x23;
-    key_ring[132].value[13] = 0x45;
-    key_ring[132].value[14] = 0x67;
-    key_ring[132].value[15] = 0x89;
-    key_ring[132].value[16] = 0x01;
-    key_ring[132].value[17] = 0x23;
-    key_ring[132].value[18] = 0x45;
-    key_ring[132].value[19] = 0x67;
-    key_ring[132].value[20] = 0x89;
-    key_ring[132].value[21] = 0xAB;
-    key_ring[132].value[22] = 0xCD;
-    key_ring[132].value[23] = 0xEF;
-    key_ring[132].value[24] = 0xAB;
-    key_ring[132].value[25] = 0xCD;
-    key_ring[132].value[26] = 0xEF;
-    key_ring[132].value[27] = 0x01;
-    key_ring[132].value[28] = 0x23;
-    key_ring[132].value[29] = 0x45;
-    key_ring[132].value[30] = 0x67;
-    key_ring[132].value[31] = 0x89;
-    key_ring[132].key_len = 32;
-    key_ring[132].key_state = KEY_PREACTIVE;
-    // 133 - ABCDEF01234567890123456789ABCDEFABCDEF01234567890123456789ABCDEF -> ACTIVE
-    key_ring[133].value[0] = 0xAB;
-    key_ring[133].value[1] = 0xCD;
-    key_ring[133].value[2] = 0xEF;
-    key_ring[133].value[3] = 0x01;
-    key_ring[133].value[4] = 0x23;
-    key_ring[133].value[5] = 0x45;
-    key_ring[133].value[6] = 0x67;
-    key_ring[133].value[7] = 0x89;
-    key_ring[133].value[8] = 0x01;
-    key_ring[133].value[9] = 0x23;
-    key_ring[133].value[10] = 0x45;
-    key_ring[133].value[11] = 0x67;
-    key_ring[133].value[12] = 0x89;
-    key_ring[133].value[13] = 0xAB;
-    key_ring[133].value[14] = 0xCD;
-    key_ring[133].value[15] = 0xEF;
-    key_ring[133].value[16] = 0xAB;
-    key_ring[133].value[17] = 0xCD;
-    key_ring[133].value[18] = 0xEF;
-    key_ring[133].value[19] = 0x01;
-    key_ring[133].value[20] = 0x23;
-    key_ring[133].value[21] = 0x45;
-    key_ring[133].value[22] = 0x67;
-    key_ring[133].value[23] = 0x89;
-    key_ring[133].value[24] = 0x01;
-    key_ring[133].value[25] = 0x23;
-    key_ring[133].value[26] = 0x45;
-    key_ring[133].value[27] = 0x67;
-    key_ring[133].value[28] = 0x89;
-    key_ring[133].value[29] = 0xAB;
-    key_ring[133].value[30] = 0xCD;
-    key_ring[133].value[31] = 0xEF;
-    key_ring[133].key_len = 32;
-    key_ring[133].key_state = KEY_ACTIVE;
-    // 134 - ABCDEF0123456789FEDCBA9876543210ABCDEF0123456789FEDCBA9876543210 -> DEACTIVE
-    key_ring[134].value[0] = 0xAB;
-    key_ring[134].value[1] = 0xCD;
-    key_ring[134].value[2] = 0xEF;
-    key_ring[134].value[3] = 0x01;
-    key_ring[134].value[4] = 0x23;
-    key_ring[134].value[5] = 0x45;
-    key_ring[134].value[6] = 0x67;
-    key_ring[134].value[7] = 0x89;
-    key_ring[134].value[8] = 0xFE;
-    key_ring[134].value[9] = 0xDC;
-    key_ring[134].value[10] = 0xBA;
-    key_ring[134].value[11] = 0x98;
-    key_ring[134].value[12] = 0x76;
-    key_ring[134].value[13] = 0x54;
-    key_ring[134].value[14] = 0x32;
-    key_ring[134].value[15] = 0x10;
-    key_ring[134].value[16] = 0xAB;
-    key_ring[134].value[17] = 0xCD;
-    key_ring[134].value[18] = 0xEF;
-    key_ring[134].value[19] = 0x01;
-    key_ring[134].value[20] = 0x23;
-    key_ring[134].value[21] = 0x45;
-    key_ring[134].value[22] = 0x67;
-    key_ring[134].value[23] = 0x89;
-    key_ring[134].value[24] = 0xFE;
-    key_ring[134].value[25] = 0xDC;
-    key_ring[134].value[26] = 0xBA;
-    key_ring[134].value[27] = 0x98;
-    key_ring[134].value[28] = 0x76;
-    key_ring[134].value[29] = 0x54;
-    key_ring[134].value[30] = 0x32;
-    key_ring[134].value[31] = 0x10;
-    key_ring[134].key_len = 32;
-    key_ring[134].key_state = KEY_DEACTIVATED;
-
-    // 135 - ABCDEF0123456789FEDCBA9876543210ABCDEF0123456789FEDCBA9876543210 -> DEACTIVE
-    key_ring[135].value[0] = 0x00;
-    key_ring[135].value[1] = 0x00;
-    key_ring[135].value[2] = 0x00;
-    key_ring[135].value[3] = 0x00;
-    key_ring[135].value[4] = 0x00;
-    key_ring[135].value[5] = 0x00;
-    key_ring[135].value[6] = 0x00;
-    key_ring[135].value[7] = 0x00;
-    key_ring[135].value[8] = 0x00;
-    key_ring[135].value[9] = 0x00;
-    key_ring[135].value[10] = 0x00;
-    key_ring[135].value[11] = 0x00;
-    key_ring[135].value[12] = 0x00;
-    key_ring[135].value[13] = 0x00;
-    key_ring[135].value[14] = 0x00;
-    key_ring[135].value[15] = 0x00;
-    key_ring[135].value[16] = 0x00;
-    key_ring[135].value[17] = 0x00;
-    key_ring[135].value[18] = 0x00;
-    key_ring[135].value[19] = 0x00;
-    key_ring[135].value[20] = 0x00;
-    key_ring[135].value[21] = 0x00;
-    key_ring[135].value[22] = 0x00;
-    key_ring[135].value[23] = 0x00;
-    key_ring[135].value[24] = 0x00;
-    key_ring[135].value[25] = 0x00;
-    key_ring[135].value[26] = 0x00;
-    key_ring[135].value[27] = 0x00;
-    key_ring[135].value[28] = 0x00;
-    key_ring[135].value[29] = 0x00;
-    key_ring[135].value[30] = 0x00;
-    key_ring[135].value[31] = 0x00;
-    key_ring[135].key_len = 32;
-    key_ring[135].key_state = KEY_DEACTIVATED;
-
-    // 136 - ff9f9284cf599eac3b119905a7d18851e7e374cf63aea04358586b0f757670f9
-    // Reference:
-    // https://csrc.nist.gov/CSRC/media/Projects/Cryptographic-Algorithm-Validation-Program/documents/mac/gcmtestvectors.zip
-    key_ring[136].value[0] = 0xff;
-    key_ring[136].value[1] = 0x9f;
-    key_ring[136].value[2] = 0x92;
-    key_ring[136].value[3] = 0x84;
-    key_ring[136].value[4] = 0xcf;
-    key_ring[136].value[5] = 0x59;
-    key_ring[136].value[6] = 0x9e;
-    key_ring[136].value[7] = 0xac;
-    key_ring[136].value[8] = 0x3b;
-    key_ring[136].value[9] = 0x11;
-    key_ring[136].value[10] = 0x99;
-    key_ring[136].value[11] = 0x05;
-    key_ring[136].value[12] = 0xa7;
-    key_ring[136].value[13] = 0xd1;
-    key_ring[136].value[14] = 0x88;
-    key_ring[136].value[15] = 0x51;
-    key_ring[136].value[16] = 0xe7;
-    key_ring[136].value[17] = 0xe3;
-    key_ring[136].value[18] = 0x74;
-    key_ring[136].value[19] = 0xcf;
-    key_ring[136].value[20] = 0x63;
-    key_ring[136].value[21] = 0xae;
-    key_ring[136].value[22] = 0xa0;
-    key_ring[136].value[23] = 0x43;
-    key_ring[136].value[24] = 0x58;
-    key_ring[136].value[25] = 0x58;
-    key_ring[136].value[26] = 0x6b;
-    key_ring[136].value[27] = 0x0f;
-    key_ring[136].value[28] = 0x75;
-    key_ring[136].value[29] = 0x76;
-    key_ring[136].value[30] = 0x70;
-    key_ring[136].value[31] = 0xf9;
-    key_ring[136].key_len = 32;
-    key_ring[136].key_state = KEY_DEACTIVATED;
+    base = (uint8_t*)mmap(NULL, data_size + (2 * page), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    if (mprotect(base + page, data_size, PROT_READ | PROT_WRITE) != 0)
+    {
+        munmap(base, data_size + (2 * page));
+        return NULL;
+    }
+#ifdef MADV_DONTDUMP
+    madvise(base + page, data_size, MADV_DONTDUMP);
+#endif
+    // Unprivileged processes may be over RLIMIT_MEMLOCK, the keys are still usable unlocked
+    arena->locked = (mlock(base + page, data_size) == 0);
+    arena->base = base;
+    arena->size = data_size + (2 * page);
+    return base + page;
+}
 
-    #ifdef DEBUG
-        printf(KGRN "Key internal interface intialized \n" RESET);
-    #endif
+/**
+ * @brief Function: key_arena_unmap
+ * Wipes and releases a region from key_arena_map
+ * @param arena: key_arena_t*
+ **/
+static void key_arena_unmap(key_arena_t* arena)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (arena->base == NULL)
+    {
+        return;
+    }
+    memset(arena->base + page, 0, arena->size - (2 * page));
+    if (arena->locked)
+    {
+        munlock(arena->base + page, arena->size - (2 * page));
+    }
+    munmap(arena->base, arena->size);
+    arena->base = NULL;
+    arena->size = 0;
+    arena->locked = 0;
+}
+
+/**
+ * @brief Function: key_version_alloc
+ * Takes a record for a published key version, mapping another chunk when none is free
+ * @return crypto_key_t*: NULL if no chunk could be mapped
+ **/
+static crypto_key_t* key_version_alloc(void)
+{
+    key_arena_t chunk = {0};
+    crypto_key_t* records;
+    crypto_key_t* version;
+
+    pthread_mutex_lock(&key_version_lock);
+    if (key_version_free_list == NULL)
+    {
+        records = (crypto_key_t*)key_arena_map(&chunk, KEY_VERSION_CHUNK_SIZE * sizeof(crypto_key_t));
+        for (uint32_t i = 0; (records != NULL) && (i < KEY_VERSION_CHUNK_SIZE); i++)
+        {
+            memcpy(records[i].value, &key_version_free_list, sizeof(crypto_key_t*));
+            key_version_free_list = &records[i];
+        }
+    }
+    version = key_version_free_list;
+    if (version != NULL)
+    {
+        memcpy(&key_version_free_list, version->value, sizeof(crypto_key_t*));
+    }
+    pthread_mutex_unlock(&key_version_lock);
+    return version;
+}
+
+/**
+ * @brief Function: key_version_free
+ * Wipes a published key version and returns its record to the free list
+ * @param ptr: void*, a crypto_key_t* from key_version_alloc
+ **/
+static void key_version_free(void* ptr)
+{
+    crypto_key_t* version = (crypto_key_t*)ptr;
+
+    memset(version, 0, sizeof(crypto_key_t));
+    pthread_mutex_lock(&key_version_lock);
+    memcpy(version->value, &key_version_free_list, sizeof(crypto_key_t*));
+    key_version_free_list = version;
+    pthread_mutex_unlock(&key_version_lock);
+}
+
+/**
+ * @brief Function: Crypto_Key_Store_Save
+ * Seals every key the key interface holds into a key store file for Crypto_Config_Key_Store, using the KEK that was
+ * configured with it. The file is replaced atomically.
+ * @param path: const char*
+ * @return int32: Success/Failure
+ **/
+int32_t Crypto_Key_Store_Save(const char* path)
+{
+    key_store_header_t header;
+    key_store_record_t* record;
+    crypto_key_t* key;
+    uint8_t aad[sizeof(key_store_header_t) + offsetof(key_store_record_t, iv)];
+    uint8_t ecs = CRYPTO_CIPHER_AES256_GCM;
+    uint32_t* index;
+    uint8_t* image = NULL;
+    size_t offset;
+    uint32_t i;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if (path == NULL)
+    {
+        return CRYPTO_KEY_STORE_FILE_ERROR;
+    }
+    if ((crypto_config.init_status == UNITIALIZED) || (key_if == NULL) || (cryptography_if == NULL))
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    if (key_store_config == NULL)
+    {
+        return CRYPTO_KEY_STORE_CONFIGURATION_NOT_COMPLETE;
+    }
+    // The KMC key ring has no local keys to seal
+    if (crypto_config.key_type == KEY_TYPE_KMC)
+    {
+        return CRYPTOGRAPHY_UNSUPPORTED_OPERATION_FOR_KEY_RING;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = KEY_STORE_MAGIC;
+    header.version = KEY_STORE_VERSION;
+    if (getrandom(header.store_id, KEY_STORE_ID_SIZE, 0) != KEY_STORE_ID_SIZE)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+
+    Crypto_Epoch_Enter();
+    offset = 0;
+    for (i = 0; i < NUM_KEYS; i++)
+    {
+        key = key_if->get_key(i);
+        if ((key != NULL) && (key->key_len > 0) && (key->key_len <= KEY_SIZE))
+        {
+            header.num_ids = i + 1;
+            header.num_keys++;
+            offset += KEY_STORE_ALIGN(sizeof(key_store_record_t) + key->key_len);
+        }
+    }
+    offset += KEY_STORE_ALIGN(sizeof(key_store_header_t) + (header.num_ids * sizeof(uint32_t)));
+    header.store_size = (uint32_t)offset;
+    image = (uint8_t*)calloc(1, offset);
+    if (image == NULL)
+    {
+        Crypto_Epoch_Exit();
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    memcpy(image, &header, sizeof(header));
+    index = (uint32_t*)(image + sizeof(key_store_header_t));
 
+    offset = KEY_STORE_ALIGN(sizeof(key_store_header_t) + (header.num_ids * sizeof(uint32_t)));
+    for (i = 0; (i < header.num_ids) && (status == CRYPTO_LIB_SUCCESS); i++)
+    {
+        key = key_if->get_key(i);
+        if ((key == NULL) || (key->key_len == 0) || (key->key_len > KEY_SIZE))
+        {
+            continue;
+        }
+        index[i] = (uint32_t)offset;
+        record = (key_store_record_t*)(image + offset);
+        record->key_id = i;
+        record->key_len = key->key_len;
+        record->key_state = key->key_state;
+        if (getrandom(record->iv, KEY_STORE_IV_SIZE, 0) != KEY_STORE_IV_SIZE)
+        {
+            status = CRYPTO_LIB_ERROR;
+            break;
+        }
+        key_store_aad(aad, &header, record);
+        status = cryptography_if->cryptography_aead_encrypt((uint8_t*)(record + 1), key->key_len, key->value,
+                                                            key->key_len, key_store_config->key_store_kek,
+                                                            KEY_STORE_KEK_SIZE, NULL, record->iv, KEY_STORE_IV_SIZE,
+                                                            record->tag, KEY_STORE_TAG_SIZE, aad, sizeof(aad),
+                                                            CRYPTO_TRUE, CRYPTO_TRUE, CRYPTO_TRUE, &ecs, NULL, NULL);
+        offset += KEY_STORE_ALIGN(sizeof(key_store_record_t) + key->key_len);
+    }
+    Crypto_Epoch_Exit();
+
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = key_store_write(path, image, header.store_size);
+    }
+    free(image);
     return status;
 }
 
-static int32_t key_shutdown(void)
+/**
+ * @brief Function: key_store_open
+ * Maps a key store and checks its header, the records are opened by key_store_load
+ * @param path: const char*
+ * @param kek: const uint8_t*, copied next to the key ring
+ * @return int32: Success/Failure
+ **/
+static int32_t key_store_open(const char* path, const uint8_t* kek)
 {
+    const key_store_header_t* header;
+    struct stat st;
+    uint8_t* image;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return CRYPTO_KEY_STORE_FILE_ERROR;
+    }
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(key_store_header_t)))
+    {
+        close(fd);
+        return CRYPTO_KEY_STORE_INVALID;
+    }
+    image = (uint8_t*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        return CRYPTO_KEY_STORE_FILE_ERROR;
+    }
+
+    header = (const key_store_header_t*)image;
+    if ((header->magic != KEY_STORE_MAGIC) || (header->version != KEY_STORE_VERSION) ||
+        (header->store_size != (uint32_t)st.st_size) || (header->num_ids > NUM_KEYS) ||
+        ((sizeof(key_store_header_t) + (header->num_ids * sizeof(uint32_t))) > (size_t)st.st_size))
+    {
+        munmap(image, st.st_size);
+        return CRYPTO_KEY_STORE_INVALID;
+    }
+    // Keys are looked up by ID, read-ahead would only pull in records that are not asked for
+    madvise(image, st.st_size, MADV_RANDOM);
+
+    key_store_kek = (uint8_t*)&key_ring[key_ring_capacity];
+    memcpy(key_store_kek, kek, KEY_STORE_KEK_SIZE);
+    memset(key_store_loaded, 0, sizeof(key_store_loaded));
+    key_store_image_size = (size_t)st.st_size;
+    __atomic_store_n(&key_store_image, image, __ATOMIC_RELEASE);
     return CRYPTO_LIB_SUCCESS;
 }
+
+/**
+ * @brief Function: key_store_close
+ * Unmaps the key store, only called while no frame is being processed
+ **/
+static void key_store_close(void)
+{
+    if (key_store_image != NULL)
+    {
+        munmap(key_store_image, key_store_image_size);
+        key_store_image = NULL;
+        key_store_image_size = 0;
+    }
+    if (key_store_kek != NULL)
+    {
+        memset(key_store_kek, 0, KEY_STORE_KEK_SIZE);
+        key_store_kek = NULL;
+    }
+}
+
+/**
+ * @brief Function: key_store_load
+ * Opens the key store record of a key ID into the key ring, once
+ * @param key_id: uint32_t, below key_ring_capacity
+ **/
+static void key_store_load(uint32_t key_id)
+{
+    const key_store_header_t* header = (const key_store_header_t*)key_store_image;
+    const uint32_t* index = (const uint32_t*)(key_store_image + sizeof(key_store_header_t));
+    const key_store_record_t* record;
+    crypto_key_t* key = &key_ring[key_id];
+    uint8_t aad[sizeof(key_store_header_t) + offsetof(key_store_record_t, iv)];
+    uint8_t ecs = CRYPTO_CIPHER_AES256_GCM;
+    uint32_t offset;
+    int32_t status = CRYPTO_LIB_ERROR;
+
+    // Nothing to open the records with before Crypto_Init has set up the cryptography interface, try again later
+    if (cryptography_if == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&key_store_lock);
+    if (key_store_loaded[key_id] != 0)
+    {
+        pthread_mutex_unlock(&key_store_lock);
+        return;
+    }
+    if ((key_id >= header->num_ids) || (index[key_id] == 0))
+    {
+        // Not in the store, the ID stays unused
+        __atomic_store_n(&key_store_loaded[key_id], 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&key_store_lock);
+        return;
+    }
+
+    offset = index[key_id];
+    record = (const key_store_record_t*)(key_store_image + offset);
+    if ((offset % 8 == 0) && (offset >= sizeof(key_store_header_t) + (header->num_ids * sizeof(uint32_t))) &&
+        ((size_t)offset + sizeof(key_store_record_t) <= key_store_image_size) && (record->key_id == key_id) &&
+        (record->key_len <= KEY_SIZE) &&
+        ((size_t)offset + sizeof(key_store_record_t) + record->key_len <= key_store_image_size))
+    {
+        key_store_aad(aad, header, record);
+        status = cryptography_if->cryptography_aead_decrypt(key->value, record->key_len, (uint8_t*)(record + 1),
+                                                            record->key_len, key_store_kek, KEY_STORE_KEK_SIZE, NULL,
+                                                            (uint8_t*)record->iv, KEY_STORE_IV_SIZE,
+                                                            (uint8_t*)record->tag, KEY_STORE_TAG_SIZE, aad,
+                                                            sizeof(aad), CRYPTO_TRUE, CRYPTO_TRUE, CRYPTO_TRUE, &ecs,
+                                                            NULL, NULL);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        key->key_len = record->key_len;
+        key->key_state = record->key_state;
+    }
+    else
+    {
+        memset(key->value, 0, KEY_SIZE);
+        key->key_len = 0;
+        key->key_state = KEY_CORRUPTED;
+    }
+    __atomic_store_n(&key_store_loaded[key_id], 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&key_store_lock);
+}
+
+/**
+ * @brief Function: key_store_aad
+ * Lays out the data authenticated with a record: the store header and the record fields ahead of the IV
+ * @param aad: uint8_t*, sizeof(key_store_header_t) + offsetof(key_store_record_t, iv) bytes
+ * @param header: const key_store_header_t*
+ * @param record: const key_store_record_t*
+ **/
+static void key_store_aad(uint8_t* aad, const key_store_header_t* header, const key_store_record_t* record)
+{
+    memcpy(aad, header, sizeof(key_store_header_t));
+    memcpy(aad + sizeof(key_store_header_t), record, offsetof(key_store_record_t, iv));
+}
+
+/**
+ * @brief Function: key_store_write
+ * Writes the key store next to path, syncs it, then renames it over path. A store that is mapped keeps the old file.
+ * @param path: const char*
+ * @param image: const uint8_t*
+ * @param image_size: size_t
+ * @return int32: Success/Failure
+ **/
+static int32_t key_store_write(const char* path, const uint8_t* image, size_t image_size)
+{
+    char* tmp_path;
+    size_t written = 0;
+    ssize_t rc;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    int fd;
+
+    tmp_path = (char*)malloc(strlen(path) + 5);
+    if (tmp_path == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    sprintf(tmp_path, "%s.tmp", path);
+
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        free(tmp_path);
+        return CRYPTO_KEY_STORE_FILE_ERROR;
+    }
+    while (written < image_size)
+    {
+        rc = write(fd, image + written, image_size - written);
+        if (rc <= 0)
+        {
+            status = CRYPTO_KEY_STORE_FILE_ERROR;
+            break;
+        }
+        written += (size_t)rc;
+    }
+    if ((status == CRYPTO_LIB_SUCCESS) && (fsync(fd) != 0))
+    {
+        status = CRYPTO_KEY_STORE_FILE_ERROR;
+    }
+    close(fd);
+    if ((status == CRYPTO_LIB_SUCCESS) && (rename(tmp_path, path) != 0))
+    {
+        status = CRYPTO_KEY_STORE_FILE_ERROR;
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    return status;
+}
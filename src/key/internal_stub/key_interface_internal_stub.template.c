@@ -16,6 +16,7 @@
    jstar-development-team@mail.nasa.gov
 */
 
+#include "crypto.h"
 #include "key_interface.h"
 
 /* Variables */
@@ -27,3 +28,10 @@ KeyInterface get_key_interface_internal(void)
     fprintf(stderr,"ERROR: Loading internal key interface stub source code. Rebuild CryptoLib with -DKEY_INTERNAL=ON to use implementation.\n");
     return &key_if_struct;
 }
+
+int32_t Crypto_Key_Store_Save(const char* path)
+{
+    path = path;
+    fprintf(stderr,"ERROR: Key stores are written by the internal key interface. Rebuild CryptoLib with -DKEY_INTERNAL=ON to use implementation.\n");
+    return CRYPTOGRAPHY_UNSUPPORTED_OPERATION_FOR_KEY_RING;
+}
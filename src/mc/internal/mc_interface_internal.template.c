@@ -66,9 +66,11 @@ static int32_t mc_initialize(void)
 static void mc_log(int32_t error_code)
 {
     time_t rawtime;
+    struct tm timebuf;
     struct tm* timeinfo;
     time(&rawtime);
-    timeinfo = localtime(&rawtime);
+    // Frames on several threads may log at once
+    timeinfo = localtime_r(&rawtime, &timebuf);
 
     /* Write to log if error code is valid */
     if (error_code != CRYPTO_LIB_SUCCESS)
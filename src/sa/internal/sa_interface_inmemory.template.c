@@ -13,6 +13,18 @@
  */
 
 #include "crypto.h"
+#include "crypto_context_internal.h"
+#ifdef CRYPTO_STATIC_CONFIG
+#include "crypto_static_tables.h"
+#endif
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 // Security Association Initialization Functions
 static int32_t sa_config(void);
@@ -22,6 +34,7 @@ static int32_t sa_close(void);
 static int32_t sa_get_from_spi(uint16_t, SecurityAssociation_t**);
 static int32_t sa_get_operational_sa_from_gvcid(uint8_t, uint16_t, uint16_t, uint8_t, SecurityAssociation_t**);
 static int32_t sa_save_sa(SecurityAssociation_t* sa);
+static int32_t sa_diagnose_gvcid(uint8_t, uint16_t, uint16_t, uint8_t);
 // Security Association Utility Functions
 static int32_t sa_stop(void);
 static int32_t sa_start(TC_t* tc_frame);
@@ -32,13 +45,204 @@ static int32_t sa_create(void);
 static int32_t sa_setARSN(void);
 static int32_t sa_setARSNW(void);
 static int32_t sa_delete(void);
+// Security Association Snapshot Functions
+static int32_t sa_get_from_index(uint32_t index, SecurityAssociation_t** security_association);
+static int32_t sa_insert(const SecurityAssociation_t* security_association);
+// Security Association Provisioning Functions
+static int32_t sa_provision(SaProvisionOp_t* ops, uint32_t num_ops);
+static uint32_t sa_provision_group(SaProvisionOp_t* ops, uint32_t first, uint32_t num_ops);
+static int32_t sa_provision_check(const SaProvisionOp_t* op, uint16_t* slot);
+static int32_t sa_provision_apply(SecurityAssociation_t* sa_ptr, const SaProvisionOp_t* op);
+static uint8_t sa_provision_sets_counters(const SaProvisionOp_t* op);
+static int32_t sa_provision_one(uint8_t procedure, uint16_t spi, const SecurityAssociation_t* security_association);
+// SA Table Functions
+static void sa_table_release(void);
+static uint16_t sa_table_find_slot(uint16_t spi);
+static SecurityAssociation_t* sa_table_find(uint16_t spi);
+static SecurityAssociation_t* sa_table_add(uint16_t spi);
+static int32_t sa_table_map_spi(uint16_t spi, uint16_t slot);
+static void* sa_table_realloc(void* ptr, size_t old_size, size_t size);
+static void sa_table_free(void* ptr);
+#ifdef CRYPTO_STATIC_CONFIG
+// Static Configuration Functions
+static int32_t sa_static_config(void);
+static uint8_t sa_static_owns(const void* ptr);
+#endif
+// Published SA Version Functions
+static SecurityAssociation_t* sa_version_open(uint16_t slot, uint8_t* synchronize);
+static uint8_t sa_version_publish(uint16_t slot, uint8_t counters_set);
+static void sa_version_commit(uint16_t slot, uint8_t shadow_changed, uint8_t counters_set);
+static void sa_version_close(uint16_t slot, uint8_t shadow_changed, uint8_t counters_set);
+static void sa_version_carry_counters(SecurityAssociation_t* dst, const SecurityAssociation_t* src);
+// Operational SA Index Functions
+static uint16_t sa_gvcid_index_hash(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint32_t size);
+static int32_t sa_gvcid_index_update(uint16_t slot, uint8_t quiesced);
+static void sa_gvcid_index_remove(uint16_t slot);
+static int32_t sa_gvcid_index_rebuild(void);
+static uint8_t sa_gvcid_index_stale(uint16_t slot);
+static void sa_gvcid_index_lock(void);
+static void sa_gvcid_index_unlock(void);
+static int32_t sa_gvcid_index_find(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid, uint16_t* slot);
+static int32_t sa_gvcid_index_repair(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid, uint16_t* slot);
+static void sa_gvcid_index_loosen(uint16_t slot);
+static void sa_gvcid_index_tighten(void);
+// Memory-Mapped SA Store Functions
+static int32_t sa_mmap_configure(void);
+static int32_t sa_mmap_init(void);
+static int32_t sa_mmap_close(void);
+static int32_t sa_mmap_save_sa(SecurityAssociation_t* sa);
+static int32_t sa_mmap_stop(void);
+static int32_t sa_mmap_start(TC_t* tc_frame);
+static int32_t sa_mmap_expire(void);
+static int32_t sa_mmap_rekey(void);
+static int32_t sa_mmap_create(void);
+static int32_t sa_mmap_setARSN(void);
+static int32_t sa_mmap_setARSNW(void);
+static int32_t sa_mmap_delete(void);
+static int32_t sa_mmap_insert(const SecurityAssociation_t* security_association);
+static int32_t sa_mmap_provision(SaProvisionOp_t* ops, uint32_t num_ops);
+static int32_t sa_mmap_open(uint8_t* fresh);
+static void sa_mmap_unmap(void);
+static int32_t sa_mmap_checkpoint(uint8_t clean);
+static int32_t sa_mmap_checkpoint_after(int32_t status);
+static void sa_mmap_lock(void);
+static void sa_mmap_unlock(void);
+static uint8_t sa_mmap_live_usable(void);
+static void sa_mmap_live_claim(void);
+static void sa_mmap_boot_id(char* boot_id);
+static void sa_mmap_advance(uint8_t* num, uint8_t len, uint32_t by);
+static uint32_t sa_mmap_crc32(const void* data, size_t len, uint32_t crc);
+static uint64_t sa_mmap_now_ms(void);
+
+/*
+** Defines
+*/
+#define SA_MMAP_MAGIC 0x53414D4D   // "SAMM"
+#define SA_MMAP_VERSION 6
+#define SA_MMAP_PAGE_SIZE 4096     // Alignment of every region in the store file
+#define SA_MMAP_KEY_REF_SIZE 256   // Longest persisted ek_ref / ak_ref, including the terminator
+#define SA_MMAP_BOOT_ID_SIZE 40    // /proc/sys/kernel/random/boot_id, including the terminator
+#define SA_MMAP_LIVE_STATE_OFFSET (2 * SA_MMAP_PAGE_SIZE) // Live table state follows the two headers
+#define SA_MMAP_LIVE_OFFSET (3 * SA_MMAP_PAGE_SIZE)       // Live table follows its state
+#define SA_SLOT_NONE 0xFFFF
+#define SA_TABLE_CHUNK_SIZE 16     // SAs per storage chunk; chunks never move, so SA pointers stay valid as the table grows
+#define SA_SLOT_MAP_PAGE_SIZE 256  // SPIs per page of the SPI to slot map
+#define SA_SLOT_MAP_NUM_PAGES ((0xFFFF / SA_SLOT_MAP_PAGE_SIZE) + 1)
+#define SA_GVCID_INDEX_MIN_SIZE 64 // Initial number of hash buckets, must be a power of two
+#define SA_PROVISION_GROUP_SIZE 64 // Provisioning operations applied behind one set of epoch waits
+
+#ifdef CRYPTO_STATIC_CONFIG
+#if (CRYPTO_STATIC_SA_TABLE_CHUNK_SIZE != SA_TABLE_CHUNK_SIZE) ||                                                    \
+    (CRYPTO_STATIC_SA_SLOT_MAP_PAGE_SIZE != SA_SLOT_MAP_PAGE_SIZE) ||                                                \
+    (CRYPTO_STATIC_SA_GVCID_INDEX_MIN_SIZE != SA_GVCID_INDEX_MIN_SIZE)
+#error "crypto_static_tables.h was generated for a different SA table layout, update crypto_static_config.py"
+#endif
+#endif
+
+/*
+** Structures
+*/
+typedef struct
+{
+    SecurityAssociation_t sa;
+    SecurityAssociation_t shadow; // Version handed to readers while an SDLS procedure changes sa, see sa_version_open
+    uint16_t spi;
+    uint8_t published_shadow; // Readers are given shadow rather than sa
+    uint8_t handed_out;       // sa_get_from_spi has given out a pointer the caller may change the SA through
+} sa_slot_t;
+
+// Operational SA index, keyed on (tfvn, scid, vcid). Each bucket is a chain of slots in ascending SPI order, so a
+// lookup returns the same SA a scan of the table in SPI order would.
+typedef struct
+{
+    uint32_t size;     // Buckets, a power of two no smaller than the number of slots
+    uint16_t* buckets; // First slot of each chain
+    uint16_t* next;    // Per slot, next slot in the same chain
+    uint16_t* bucket;  // Per slot, bucket the slot is linked into, SA_SLOT_NONE if not indexed
+    uint16_t* loose;   // Slots handed out by sa_get_from_spi, re-checked by every lookup
+    uint32_t num_loose;
+} sa_gvcid_index_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t abm_size;
+    uint32_t slot_size;
+    uint32_t capacity;     // Slots in the live table and in each snapshot
+    uint32_t num_slots;    // Slots in use when the snapshot was taken
+    uint32_t snapshot_crc;
+    uint64_t generation;   // Header and snapshot (generation % 2) hold this checkpoint
+    uint8_t clean;         // Checkpoint written by sa_close, the live table was not touched afterwards
+    uint8_t reserved[3];
+    uint32_t header_crc;   // Over every field above
+} sa_mmap_header_t;
+
+typedef struct
+{
+    char ek_ref[SA_MMAP_KEY_REF_SIZE];
+    char ak_ref[SA_MMAP_KEY_REF_SIZE];
+} sa_mmap_key_refs_t;
+
+// Tells whether the live table can be trusted after an unclean shutdown. Stores into the mapping outlive a process
+// that dies, but not the kernel, so the live table is only as good as the boot it was written under.
+typedef struct
+{
+    uint32_t magic;
+    uint8_t busy;                          // An SDLS procedure, provisioning or sa_insert is changing the table
+    uint8_t reserved[3];
+    char boot_id[SA_MMAP_BOOT_ID_SIZE];    // Boot the store was last opened under
+} sa_mmap_live_state_t;
+
+// Memory-Mapped SA Store Functions that take the store structures
+static int sa_mmap_select(sa_mmap_header_t* header);
+static int32_t sa_mmap_restore(uint8_t snapshot_idx, const sa_mmap_header_t* header, uint8_t live_usable);
+// Published SA Version Functions that take a slot
+static SecurityAssociation_t* sa_slot_current(sa_slot_t* entry);
+// Operational SA Index Functions that take an index
+static sa_gvcid_index_t* sa_gvcid_index_alloc(uint32_t size);
+static uint16_t sa_gvcid_index_target(const sa_gvcid_index_t* index, uint16_t slot);
+static void sa_gvcid_index_link(sa_gvcid_index_t* index, uint16_t slot, uint16_t bucket);
+static void sa_gvcid_index_publish(sa_gvcid_index_t* index);
 
 /*
 ** Global Variables
 */
 // Security
 static SaInterfaceStruct sa_if_struct;
-static SecurityAssociation_t sa[NUM_SA];
+// SA table. Slots are handed out in configuration order and found through a two level SPI to slot map, so memory
+// follows the number of SAs configured rather than the SPI range.
+static sa_slot_t** sa_chunks = NULL;
+static uint16_t sa_num_chunks = 0;
+static uint32_t sa_num_slots = 0;
+static uint32_t sa_capacity = 0;
+static uint16_t* sa_slot_map[SA_SLOT_MAP_NUM_PAGES];
+// Operational SA index. SDLS procedures and provisioning keep it up to date. An SA whose state or GVCID is changed in
+// place through the pointer from sa_get_from_spi is re-indexed when it is saved with sa_save_sa.
+// Lookups load it without a lock, see sa_gvcid_index_find; only changes to it take sa_gvcid_index_mutex.
+static sa_gvcid_index_t* sa_gvcid_index = NULL;
+static pthread_mutex_t sa_gvcid_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Memory-mapped store (SA_TYPE_MMAP). While mapped, table chunks are carved out of the live table in the file.
+static uint8_t* sa_mmap_base = NULL;
+static size_t sa_mmap_size = 0;
+static int sa_mmap_fd = -1;
+static uint32_t sa_mmap_capacity = 0;
+static size_t sa_mmap_live_size = 0;
+static size_t sa_mmap_snapshot_size = 0;
+static uint64_t sa_mmap_generation = 0;
+static uint8_t sa_mmap_recovered = 0;
+static uint32_t sa_mmap_saves = 0;
+static uint64_t sa_mmap_last_checkpoint_ms = 0;
+// Held while a checkpoint is written and while the table is changed other than by frames, see sa_mmap_lock
+static pthread_mutex_t sa_mmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t sa_mmap_crc_table[256];
+#ifdef CRYPTO_STATIC_CONFIG
+// Writable home of the generated SAs and operational SA index, see the Static Configuration Functions
+static sa_slot_t sa_static_slots[CRYPTO_STATIC_NUM_SA_CHUNKS * SA_TABLE_CHUNK_SIZE];
+static sa_slot_t* sa_static_chunks[CRYPTO_STATIC_NUM_SA_CHUNKS];
+static sa_gvcid_index_t sa_static_gvcid_index;
+static uint16_t sa_static_gvcid_index_data[4 * CRYPTO_STATIC_SA_GVCID_INDEX_SIZE];
+#endif
 
 /**
  * @brief Function: get_sa_interface_inmemory
@@ -53,6 +257,7 @@ SaInterface get_sa_interface_inmemory(void)
     sa_if_struct.sa_get_operational_sa_from_gvcid = sa_get_operational_sa_from_gvcid;
     sa_if_struct.sa_stop = sa_stop;
     sa_if_struct.sa_save_sa = sa_save_sa;
+    sa_if_struct.sa_diagnose_gvcid = sa_diagnose_gvcid;
     sa_if_struct.sa_start = sa_start;
     sa_if_struct.sa_expire = sa_expire;
     sa_if_struct.sa_rekey = sa_rekey;
@@ -61,6 +266,38 @@ SaInterface get_sa_interface_inmemory(void)
     sa_if_struct.sa_setARSN = sa_setARSN;
     sa_if_struct.sa_setARSNW = sa_setARSNW;
     sa_if_struct.sa_delete = sa_delete;
+    sa_if_struct.sa_get_from_index = sa_get_from_index;
+    sa_if_struct.sa_insert = sa_insert;
+    sa_if_struct.sa_provision = sa_provision;
+    return &sa_if_struct;
+}
+
+/**
+ * @brief Function: get_sa_interface_mmap
+ * The in-memory SA table kept in a memory-mapped file, see the Memory-Mapped SA Store Functions
+ * @return SaInterface
+ **/
+SaInterface get_sa_interface_mmap(void)
+{
+    sa_if_struct.sa_config = sa_mmap_configure;
+    sa_if_struct.sa_init = sa_mmap_init;
+    sa_if_struct.sa_close = sa_mmap_close;
+    sa_if_struct.sa_get_from_spi = sa_get_from_spi;
+    sa_if_struct.sa_get_operational_sa_from_gvcid = sa_get_operational_sa_from_gvcid;
+    sa_if_struct.sa_stop = sa_mmap_stop;
+    sa_if_struct.sa_save_sa = sa_mmap_save_sa;
+    sa_if_struct.sa_diagnose_gvcid = sa_diagnose_gvcid;
+    sa_if_struct.sa_start = sa_mmap_start;
+    sa_if_struct.sa_expire = sa_mmap_expire;
+    sa_if_struct.sa_rekey = sa_mmap_rekey;
+    sa_if_struct.sa_status = sa_status;
+    sa_if_struct.sa_create = sa_mmap_create;
+    sa_if_struct.sa_setARSN = sa_mmap_setARSN;
+    sa_if_struct.sa_setARSNW = sa_mmap_setARSNW;
+    sa_if_struct.sa_delete = sa_mmap_delete;
+    sa_if_struct.sa_get_from_index = sa_get_from_index;
+    sa_if_struct.sa_insert = sa_mmap_insert;
+    sa_if_struct.sa_provision = sa_mmap_provision;
     return &sa_if_struct;
 }
 
@@ -70,313 +307,348 @@ SaInterface get_sa_interface_inmemory(void)
  **/
 int32_t sa_config(void)
 {
+#ifdef CRYPTO_STATIC_CONFIG
+    return sa_static_config();
+#else
     int32_t status = CRYPTO_LIB_SUCCESS;
+    SecurityAssociation_t* sa_ptr = NULL;
+    uint16_t spi;
+
+    // Allocate the default SAs up front so the blocks below cannot run out of table.
+    // SPI 0 is left in SA_NONE, as it always existed in the fixed size table.
+    for (spi = 0; spi <= 17; spi++)
+    {
+        if (sa_table_add(spi) == NULL)
+        {
+            return SADB_SA_TABLE_FULL;
+        }
+    }
 
     // Security Associations
     // SA 1 - CLEAR MODE
     // SA 1 VC0/1 is now SA 1-VC0, SA 8-VC1
-    sa[1].spi = 1;
-    sa[1].sa_state = SA_OPERATIONAL;
-    sa[1].est = 0;
-    sa[1].ast = 0;
-    sa[1].shivf_len = 0;
-    sa[1].shsnf_len = 2;
-    sa[1].arsn_len = 2;
-    sa[1].arsnw_len = 1;
-    sa[1].arsnw = 5;
-    sa[1].gvcid_blk.tfvn = 0;
-    sa[1].gvcid_blk.scid = SCID & 0x3FF;
-    sa[1].gvcid_blk.vcid = 0;
-    sa[1].gvcid_blk.mapid = TYPE_TC;
+    sa_ptr = sa_table_find(1);
+    sa_ptr->spi = 1;
+    sa_ptr->sa_state = SA_OPERATIONAL;
+    sa_ptr->est = 0;
+    sa_ptr->ast = 0;
+    sa_ptr->shivf_len = 0;
+    sa_ptr->shsnf_len = 2;
+    sa_ptr->arsn_len = 2;
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
+    sa_ptr->gvcid_blk.mapid = TYPE_TC;
 
     // SA 2 - KEYED;  ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: 128
-    sa[2].spi = 2;
-    sa[2].ekid = 128;
-    sa[2].sa_state = SA_KEYED;
-    sa[2].est = 1;
-    sa[2].ast = 1;
-    sa[2].ecs_len = 1;
-    sa[2].ecs = CRYPTO_CIPHER_AES256_GCM;    
-    sa[2].shivf_len = 12;
-    sa[2].iv_len = 12;
-    *(sa[2].iv + sa[2].shivf_len - 1) = 0;
-    sa[2].abm_len = ABM_SIZE; // 20
-    sa[2].arsnw_len = 1;
-    sa[2].arsnw = 5;
-    sa[2].arsn_len = (sa[2].arsnw * 2) + 1;
+    sa_ptr = sa_table_find(2);
+    sa_ptr->spi = 2;
+    sa_ptr->ekid = 128;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;    
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = (sa_ptr->arsnw * 2) + 1;
 
     // SA 3 - KEYED;   ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: 129
-    sa[3].spi = 3;
-    sa[3].ekid = 129;
-    sa[3].sa_state = SA_KEYED;
-    sa[3].est = 1;
-    sa[3].ast = 1;
-    sa[3].ecs_len = 1;
-    sa[3].ecs = CRYPTO_CIPHER_AES256_GCM;
-    sa[3].shivf_len = 12;
-    sa[3].iv_len = 12;
-    *(sa[3].iv + sa[3].shivf_len - 1) = 0;
-    sa[3].abm_len = ABM_SIZE; // 20
-    sa[3].arsnw_len = 1;
-    sa[3].arsnw = 5;
-    sa[3].arsn_len = (sa[3].arsnw * 2) + 1;
+    sa_ptr = sa_table_find(3);
+    sa_ptr->spi = 3;
+    sa_ptr->ekid = 129;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = (sa_ptr->arsnw * 2) + 1;
 
     // SA 4 - KEYED;  ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: 130
     // SA 4 VC0/1 is now 4-VC0, 7-VC1
-    sa[4].spi = 4;
-    sa[4].ekid = 130;
-    sa[4].sa_state = SA_OPERATIONAL;
-    sa[4].est = 1;
-    sa[4].ast = 1;
-    sa[4].ecs_len = 1;
-    sa[4].ecs = CRYPTO_CIPHER_AES256_GCM;
-    sa[4].shivf_len = 12;
-    sa[4].iv_len = 12;
-    sa[4].stmacf_len = 16;
-    *(sa[4].iv + 11) = 0;
-    sa[4].abm_len = ABM_SIZE; // 20
-    sa[4].arsnw_len = 1;
-    sa[4].arsnw = 5;
-    sa[4].arsn_len = 0;
-    sa[4].gvcid_blk.tfvn = 0;
-    sa[4].gvcid_blk.scid = SCID & 0x3FF;
-    sa[4].gvcid_blk.vcid = 4;
-    sa[4].gvcid_blk.mapid = TYPE_TC;
+    sa_ptr = sa_table_find(4);
+    sa_ptr->spi = 4;
+    sa_ptr->ekid = 130;
+    sa_ptr->sa_state = SA_OPERATIONAL;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    sa_ptr->stmacf_len = 16;
+    *(sa_ptr->iv + 11) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = 0;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 4;
+    sa_ptr->gvcid_blk.mapid = TYPE_TC;
 
     // SA 5 - KEYED;   ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: 131
-    sa[5].spi = 5;
-    sa[5].ekid = 131;
-    sa[5].sa_state = SA_KEYED;
-    sa[5].est = 1;
-    sa[5].ast = 1;
-    sa[5].ecs_len = 1;
-    sa[5].ecs = CRYPTO_CIPHER_AES256_GCM;    
-    sa[5].shivf_len = 12;
-    sa[5].iv_len = 12;
-    *(sa[5].iv + sa[5].shivf_len - 1) = 0;
-    sa[5].abm_len = ABM_SIZE; // 20
-    sa[5].arsnw_len = 1;
-    sa[5].arsnw = 5;
-    sa[5].arsn_len = (sa[5].arsnw * 2) + 1;
+    sa_ptr = sa_table_find(5);
+    sa_ptr->spi = 5;
+    sa_ptr->ekid = 131;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;    
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = (sa_ptr->arsnw * 2) + 1;
 
     // SA 6 - UNKEYED; ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: -
-    sa[6].spi = 6;
-    sa[6].sa_state = SA_UNKEYED;
-    sa[6].est = 1;
-    sa[6].ast = 1;
-    sa[6].ecs_len = 1;
-    sa[6].ecs = CRYPTO_CIPHER_AES256_GCM;    
-    sa[6].shivf_len = 12;
-    sa[6].iv_len = 12;
-    *(sa[6].iv + sa[6].shivf_len - 1) = 0;
-    sa[6].abm_len = ABM_SIZE; // 20
-    sa[6].arsnw_len = 1;
-    sa[6].arsnw = 5;
-    sa[6].arsn_len = (sa[6].arsnw * 2) + 1;
+    sa_ptr = sa_table_find(6);
+    sa_ptr->spi = 6;
+    sa_ptr->sa_state = SA_UNKEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;    
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = (sa_ptr->arsnw * 2) + 1;
 
     // SA 7 - KEYED;  ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: 130
-    sa[7].spi = 7;
-    sa[7].ekid = 130;
-    sa[7].sa_state = SA_KEYED;
-    sa[7].est = 1;
-    sa[7].ast = 1;
-    sa[7].ecs_len = 1;
-    sa[7].ecs = CRYPTO_CIPHER_AES256_GCM;    
-    sa[7].shivf_len = 12;
-    sa[7].iv_len = 12;
-    *(sa[7].iv + sa[7].shivf_len - 1) = 0;
-    sa[7].abm_len = ABM_SIZE; // 20
-    sa[7].arsnw_len = 1;
-    sa[7].arsnw = 5;
-    sa[7].arsn_len = (sa[7].arsnw * 2) + 1;
-    sa[7].gvcid_blk.tfvn = 0;
-    sa[7].gvcid_blk.scid = SCID & 0x3FF;
-    sa[7].gvcid_blk.vcid = 1;
-    sa[7].gvcid_blk.mapid = TYPE_TC;
+    sa_ptr = sa_table_find(7);
+    sa_ptr->spi = 7;
+    sa_ptr->ekid = 130;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;    
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = (sa_ptr->arsnw * 2) + 1;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 1;
+    sa_ptr->gvcid_blk.mapid = TYPE_TC;
 
     // SA 8 - CLEAR MODE
-    sa[8].spi = 8;
-    sa[8].sa_state = SA_NONE;
-    sa[8].est = 0;
-    sa[8].ast = 0;
-    sa[8].arsn_len = 1;
-    sa[8].arsnw_len = 1;
-    sa[8].arsnw = 5;
-    sa[8].gvcid_blk.tfvn = 0;
-    sa[8].gvcid_blk.scid = SCID & 0x3FF;
-    sa[8].gvcid_blk.vcid = 1;
-    sa[8].gvcid_blk.mapid = TYPE_TC;
+    sa_ptr = sa_table_find(8);
+    sa_ptr->spi = 8;
+    sa_ptr->sa_state = SA_NONE;
+    sa_ptr->est = 0;
+    sa_ptr->ast = 0;
+    sa_ptr->arsn_len = 1;
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 1;
+    sa_ptr->gvcid_blk.mapid = TYPE_TC;
 
     // SA 9 - Validation Tests
-    sa[9].spi = 9;
-    sa[9].ekid = 136;
-    sa[9].sa_state = SA_KEYED;
-    sa[9].est = 1;
-    sa[9].ast = 0;
-    sa[9].shivf_len = 12;
-    sa[9].iv_len = 12;
-    *(sa[9].iv + 11) = 0;
-    sa[9].abm_len = ABM_SIZE; // 20
-    sa[9].arsnw_len = 1;
-    sa[9].arsnw = 5;
-    sa[9].arsn_len = 0;
-    sa[9].gvcid_blk.tfvn = 0;
-    sa[9].gvcid_blk.scid = SCID & 0x3FF;
-    sa[9].gvcid_blk.vcid = 0;
-    sa[9].gvcid_blk.mapid = TYPE_TC;
+    sa_ptr = sa_table_find(9);
+    sa_ptr->spi = 9;
+    sa_ptr->ekid = 136;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 0;
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    *(sa_ptr->iv + 11) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = 0;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
+    sa_ptr->gvcid_blk.mapid = TYPE_TC;
 
     // SA 10 - KEYED;  ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: 130
     // SA 10 VC0/1 is now 4-VC0, 7-VC1
-    sa[10].spi = 10;
-    sa[10].ekid = 130;
-    sa[10].sa_state = SA_KEYED;
-    sa[10].est = 1;
-    sa[10].ast = 1;
-    sa[10].ecs_len = 1;
-    sa[10].ecs = CRYPTO_CIPHER_AES256_GCM;
-    sa[10].shivf_len = 12;
-    sa[10].iv_len = 12;
-    sa[10].stmacf_len = 16;
-    *(sa[10].iv + 11) = 0;
-    sa[10].abm_len = ABM_SIZE; // 20
-    sa[10].arsnw_len = 1;
-    sa[10].arsnw = 5;
-    sa[10].arsn_len = 0;
-    sa[10].gvcid_blk.tfvn = 0x00;
-    sa[10].gvcid_blk.scid = 0x002C;
-    sa[10].gvcid_blk.vcid = 1;
-    sa[10].gvcid_blk.mapid = TYPE_TC;
-    sa[10].ek_ref = (char*) "kmc/test/key130";
+    sa_ptr = sa_table_find(10);
+    sa_ptr->spi = 10;
+    sa_ptr->ekid = 130;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;
+    sa_ptr->shivf_len = 12;
+    sa_ptr->iv_len = 12;
+    sa_ptr->stmacf_len = 16;
+    *(sa_ptr->iv + 11) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 1;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = 0;
+    sa_ptr->gvcid_blk.tfvn = 0x00;
+    sa_ptr->gvcid_blk.scid = 0x002C;
+    sa_ptr->gvcid_blk.vcid = 1;
+    sa_ptr->gvcid_blk.mapid = TYPE_TC;
+    sa_ptr->ek_ref = (char*) "kmc/test/key130";
     
     // SA 11 - KEYED;  ARSNW:5; AES-GCM; IV:00...00; IV-len:12; MAC-len:16; Key-ID: 130
     // SA 11 VC0/1 is now 4-VC0, 7-VC1
-    sa[11].spi = 11;
-    sa[11].ekid = 130;
-    sa[11].sa_state = SA_KEYED;
-    sa[11].est = 1;
-    sa[11].ast = 0;
-    sa[11].ecs_len = 1;
-    sa[11].ecs = CRYPTO_CIPHER_AES256_CBC;
-    sa[11].shivf_len = 16;
-    sa[11].iv_len = 16;
-    sa[11].shplf_len = 1;
-    sa[11].stmacf_len = 0;
-    *(sa[11].iv + (sa[11].iv_len - 1)) = 0;
-    sa[11].abm_len = ABM_SIZE; // 20
-    sa[11].arsnw_len = 0;
-    sa[11].arsnw = 5;
-    sa[11].arsn_len = 0;
-    sa[11].gvcid_blk.tfvn = 0;
-    sa[11].gvcid_blk.scid = SCID & 0x3FF;
-    sa[11].gvcid_blk.vcid = 0;
-    sa[11].gvcid_blk.mapid = TYPE_TC;
-    sa[11].ek_ref = (char*) "kmc/test/key130";
+    sa_ptr = sa_table_find(11);
+    sa_ptr->spi = 11;
+    sa_ptr->ekid = 130;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 0;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_CBC;
+    sa_ptr->shivf_len = 16;
+    sa_ptr->iv_len = 16;
+    sa_ptr->shplf_len = 1;
+    sa_ptr->stmacf_len = 0;
+    *(sa_ptr->iv + (sa_ptr->iv_len - 1)) = 0;
+    sa_ptr->abm_len = ABM_SIZE; // 20
+    sa_ptr->arsnw_len = 0;
+    sa_ptr->arsnw = 5;
+    sa_ptr->arsn_len = 0;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
+    sa_ptr->gvcid_blk.mapid = TYPE_TC;
+    sa_ptr->ek_ref = (char*) "kmc/test/key130";
 
     // SA 12 - TM CLEAR MODE
     // SA 12
-    sa[12].spi = 12;
-    sa[12].sa_state = SA_OPERATIONAL;
-    sa[12].est = 0;
-    sa[12].ast = 0;
-    sa[12].shivf_len = 0;
-    sa[12].shsnf_len = 0;
-    sa[12].arsn_len = 0;
-    sa[12].arsnw_len = 0;
-    sa[12].arsnw = 5;
-    sa[12].gvcid_blk.tfvn = 0;
-    sa[12].gvcid_blk.scid = SCID & 0x3FF;
-    sa[12].gvcid_blk.vcid = 0;
-    sa[12].gvcid_blk.mapid = TYPE_TM;
+    sa_ptr = sa_table_find(12);
+    sa_ptr->spi = 12;
+    sa_ptr->sa_state = SA_OPERATIONAL;
+    sa_ptr->est = 0;
+    sa_ptr->ast = 0;
+    sa_ptr->shivf_len = 0;
+    sa_ptr->shsnf_len = 0;
+    sa_ptr->arsn_len = 0;
+    sa_ptr->arsnw_len = 0;
+    sa_ptr->arsnw = 5;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
+    sa_ptr->gvcid_blk.mapid = TYPE_TM;
 
     // SA 13 - TM Authentication Only
     // SA 13
-    sa[13].spi = 13;
-    sa[13].akid = 130;
-    sa[13].ekid = 130;
-    sa[13].sa_state = SA_OPERATIONAL;
-    sa[13].est = 1;
-    sa[13].ast = 1;
-    sa[13].acs_len = 0;
-    sa[13].acs = CRYPTO_MAC_NONE;
-    sa[13].ecs_len = 1;
-    sa[13].ecs = CRYPTO_CIPHER_AES256_GCM;
-    sa[13].shivf_len = 16;
-    sa[13].iv_len = 16;
-    *(sa[13].iv + sa[13].shivf_len - 1) = 0;
-    sa[13].stmacf_len = 16;
-    sa[13].shsnf_len = 0;
-    sa[13].abm_len = ABM_SIZE;
-    memset(sa[13].abm, 0xFF, (sa[13].abm_len * sizeof(uint8_t))); // Bitmask 
-    sa[13].arsn_len = 0;
-    sa[13].arsnw_len = 0;
-    sa[13].arsnw = 5;
-    sa[13].gvcid_blk.tfvn = 0;
-    sa[13].gvcid_blk.scid = SCID & 0x3FF;
-    sa[13].gvcid_blk.vcid = 0;
-    sa[13].gvcid_blk.mapid = TYPE_TM;
+    sa_ptr = sa_table_find(13);
+    sa_ptr->spi = 13;
+    sa_ptr->akid = 130;
+    sa_ptr->ekid = 130;
+    sa_ptr->sa_state = SA_OPERATIONAL;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->acs_len = 0;
+    sa_ptr->acs = CRYPTO_MAC_NONE;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;
+    sa_ptr->shivf_len = 16;
+    sa_ptr->iv_len = 16;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->stmacf_len = 16;
+    sa_ptr->shsnf_len = 0;
+    sa_ptr->abm_len = ABM_SIZE;
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
+    sa_ptr->arsn_len = 0;
+    sa_ptr->arsnw_len = 0;
+    sa_ptr->arsnw = 5;
+    sa_ptr->gvcid_blk.tfvn = 0;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
+    sa_ptr->gvcid_blk.mapid = TYPE_TM;
 
     // SA 14 - AOS Clear Mode
-    sa[14].spi = 14;
-    sa[14].sa_state = SA_OPERATIONAL;
-    sa[14].est = 0;
-    sa[14].ast = 0;
-    sa[14].shivf_len = 0;
-    sa[14].gvcid_blk.tfvn = 0x01;
-    sa[14].gvcid_blk.scid = SCID & 0x3FF;
-    sa[14].gvcid_blk.vcid = 0;
+    sa_ptr = sa_table_find(14);
+    sa_ptr->spi = 14;
+    sa_ptr->sa_state = SA_OPERATIONAL;
+    sa_ptr->est = 0;
+    sa_ptr->ast = 0;
+    sa_ptr->shivf_len = 0;
+    sa_ptr->gvcid_blk.tfvn = 0x01;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
 
     // SA 15 - AOS Authentication Only
-    sa[15].spi = 15;
-    sa[15].akid = 130;
-    sa[15].sa_state = SA_KEYED;
-    sa[15].est = 0;
-    sa[15].ast = 1;
-    sa[15].acs_len = 1;
-    sa[15].acs = CRYPTO_MAC_CMAC_AES256;
-    sa[15].stmacf_len = 16;
-    sa[15].abm_len = ABM_SIZE;
-    memset(sa[15].abm, 0xFF, (sa[15].abm_len * sizeof(uint8_t))); // Bitmask 
-    sa[15].gvcid_blk.tfvn = 0x01;
-    sa[15].gvcid_blk.scid = SCID & 0x3FF;
-    sa[15].gvcid_blk.vcid = 0;
+    sa_ptr = sa_table_find(15);
+    sa_ptr->spi = 15;
+    sa_ptr->akid = 130;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 0;
+    sa_ptr->ast = 1;
+    sa_ptr->acs_len = 1;
+    sa_ptr->acs = CRYPTO_MAC_CMAC_AES256;
+    sa_ptr->stmacf_len = 16;
+    sa_ptr->abm_len = ABM_SIZE;
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
+    sa_ptr->gvcid_blk.tfvn = 0x01;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
 
     // SA 16 - AOS Encryption Only
-    sa[16].spi = 16;
-    sa[16].ekid = 130;
-    sa[16].sa_state = SA_KEYED;
-    sa[16].est = 1;
-    sa[16].ast = 0;
-    sa[16].ecs_len = 1;
-    sa[16].ecs = CRYPTO_CIPHER_AES256_GCM;
-    sa[16].iv_len = 16;
-    sa[16].shivf_len = 16;
-    *(sa[16].iv + sa[16].shivf_len - 1) = 0;
-    sa[16].stmacf_len = 0;
-    sa[16].abm_len = ABM_SIZE;
-    memset(sa[16].abm, 0xFF, (sa[16].abm_len * sizeof(uint8_t))); // Bitmask 
-    sa[16].gvcid_blk.tfvn = 0x01;
-    sa[16].gvcid_blk.scid = SCID & 0x3FF;
-    sa[16].gvcid_blk.vcid = 0;
+    sa_ptr = sa_table_find(16);
+    sa_ptr->spi = 16;
+    sa_ptr->ekid = 130;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 0;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;
+    sa_ptr->iv_len = 16;
+    sa_ptr->shivf_len = 16;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->stmacf_len = 0;
+    sa_ptr->abm_len = ABM_SIZE;
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
+    sa_ptr->gvcid_blk.tfvn = 0x01;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
 
     // SA 17 - AOS AEAD
-    sa[17].spi = 17;
-    sa[17].ekid = 130;
-    sa[17].sa_state = SA_KEYED;
-    sa[17].est = 1;
-    sa[17].ast = 1;
-    sa[17].ecs_len = 1;
-    sa[17].ecs = CRYPTO_CIPHER_AES256_GCM;
-    sa[17].iv_len = 16;
-    sa[17].shivf_len = 16;
-    *(sa[17].iv + sa[17].shivf_len - 1) = 0;
-    sa[17].stmacf_len = 16;
-    sa[17].abm_len = ABM_SIZE;
-    memset(sa[17].abm, 0xFF, (sa[17].abm_len * sizeof(uint8_t))); // Bitmask 
-    sa[17].gvcid_blk.tfvn = 0x01;
-    sa[17].gvcid_blk.scid = SCID & 0x3FF;
-    sa[17].gvcid_blk.vcid = 0;
+    sa_ptr = sa_table_find(17);
+    sa_ptr->spi = 17;
+    sa_ptr->ekid = 130;
+    sa_ptr->sa_state = SA_KEYED;
+    sa_ptr->est = 1;
+    sa_ptr->ast = 1;
+    sa_ptr->ecs_len = 1;
+    sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;
+    sa_ptr->iv_len = 16;
+    sa_ptr->shivf_len = 16;
+    *(sa_ptr->iv + sa_ptr->shivf_len - 1) = 0;
+    sa_ptr->stmacf_len = 16;
+    sa_ptr->abm_len = ABM_SIZE;
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
+    sa_ptr->gvcid_blk.tfvn = 0x01;
+    sa_ptr->gvcid_blk.scid = SCID & 0x3FF;
+    sa_ptr->gvcid_blk.vcid = 0;
+
+    status = sa_gvcid_index_rebuild();
 
     return status;
+#endif
 }
 
 /**
@@ -387,33 +659,10 @@ int32_t sa_init(void)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
 
-    for (int x = 0; x < NUM_SA; x++)
-    {
-        sa[x].ekid = x;
-        sa[x].akid = x;
-        sa[x].sa_state = SA_NONE;
-        sa[x].ecs_len = 0;
-        sa[x].ecs = 0;
-        sa[x].shivf_len = 0;
-        for (int y = 0; y < IV_SIZE; y++)
-        {
-            sa[x].iv[y] = 0;
-        }
-        sa[x].iv_len = 0;
-        for (int y = 0; y < ABM_SIZE; y++)
-        {
-            sa[x].abm[y] = 0;
-        }
-        sa[x].abm_len = 0;
-        sa[x].acs_len = 0;
-        sa[x].acs = 0;
-        sa[x].shsnf_len = 0;
-        sa[x].arsn_len = 0;
-        for (int y = 0; y < ARSN_SIZE; y++)
-        {
-            sa[x].arsn[y] = 0;
-        }
-    }
+    sa_table_release();
+    sa_mmap_unmap();
+    sa_capacity = (crypto_config.sa_capacity == 0) ? NUM_SA : crypto_config.sa_capacity;
+    status = sa_gvcid_index_rebuild();
     return status;
 }
 
@@ -424,6 +673,7 @@ int32_t sa_init(void)
 static int32_t sa_close(void)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
+    sa_table_release();
     return status;
 }
 
@@ -439,16 +689,25 @@ static int32_t sa_close(void)
 static int32_t sa_get_from_spi(uint16_t spi, SecurityAssociation_t** security_association)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
-    if (sa == NULL)
+    uint16_t slot;
+    SecurityAssociation_t* sa_ptr;
+    if (sa_chunks == NULL)
     {
         return CRYPTO_LIB_ERR_NO_INIT;
     }
-    *security_association = &sa[spi];
-    if (sa[spi].iv == NULL && (sa[spi].shivf_len > 0) && crypto_config.cryptography_type != CRYPTOGRAPHY_TYPE_KMCCRYPTO)
+    slot = sa_table_find_slot(spi);
+    if (slot == SA_SLOT_NONE)
+    {
+        return SADB_SPI_NOT_FOUND;
+    }
+    sa_gvcid_index_loosen(slot);
+    sa_ptr = sa_slot_current(&sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE]);
+    *security_association = sa_ptr;
+    if (sa_ptr->iv == NULL && (sa_ptr->shivf_len > 0) && crypto_config.cryptography_type != CRYPTOGRAPHY_TYPE_KMCCRYPTO)
     {
         return CRYPTO_LIB_ERR_NULL_IV;
     } // Must have IV if doing encryption or authentication
-    if (sa[spi].abm == NULL && sa[spi].ast)
+    if (sa_ptr->abm == NULL && sa_ptr->ast)
     {
         return CRYPTO_LIB_ERR_NULL_ABM;
     } // Must have abm if doing authentication
@@ -467,238 +726,1508 @@ static int32_t sa_get_from_spi(uint16_t spi, SecurityAssociation_t** security_as
  * @param mapid: uint8 // tc only
  * @param security_association: SecurityAssociation_t**
  * @return int32: Success/Failure
+ * @note SAs changed in place through the pointer from sa_get_from_spi are re-indexed before the index is consulted,
+ * and a miss falls back to a scan of the table; use sa_diagnose_gvcid for the mismatched field.
  **/
 static int32_t sa_get_operational_sa_from_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid,
                                            SecurityAssociation_t** security_association)
 {
     int32_t status = CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
-    int i;
-    if (sa == NULL)
+    uint16_t slot = SA_SLOT_NONE;
+    SecurityAssociation_t* sa_ptr;
+    if (sa_chunks == NULL)
     {
         return CRYPTO_LIB_ERR_NO_INIT;
     }
 
-    for (i = 0; i < NUM_SA; i++)
+    sa_gvcid_index_tighten();
+    status = sa_gvcid_index_find(tfvn, scid, vcid, mapid, &slot);
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        // If valid match found
-        if ((sa[i].gvcid_blk.tfvn == tfvn) && (sa[i].gvcid_blk.scid == scid) &&
-            (sa[i].gvcid_blk.vcid == vcid) && (sa[i].sa_state == SA_OPERATIONAL) &&
-            (crypto_config.unique_sa_per_mapid == TC_UNIQUE_SA_PER_MAP_ID_FALSE ||
-             sa[i].gvcid_blk.mapid == mapid))
-             // only require MapID match is unique SA per MapID set (only relevant
-             // when using segmentation hdrs)
-        {
-            *security_association = &sa[i];
+        status = sa_gvcid_index_repair(tfvn, scid, vcid, mapid, &slot);
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+#ifdef SA_DEBUG
+        printf(KRED "Error - No operational SA found for tfvn %02X scid %d vcid %d mapid %02X\n" RESET, tfvn, scid,
+               vcid, mapid);
+#endif
+        return status;
+    }
 
-            // Must have IV if using libgcrypt and auth/enc
-            if (sa[i].iv == NULL && (sa[i].ast == 1 || sa[i].est == 1) && crypto_config.cryptography_type != CRYPTOGRAPHY_TYPE_KMCCRYPTO)
-            {
-                return CRYPTO_LIB_ERR_NULL_IV;
-            }
-            // Must have ABM if doing authentication
-            if (sa[i].abm == NULL && sa[i].ast)
-            {
-                return CRYPTO_LIB_ERR_NULL_ABM;
-            } 
+    sa_ptr = sa_slot_current(&sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE]);
+    *security_association = sa_ptr;
+
+    // Must have IV if using libgcrypt and auth/enc
+    if (sa_ptr->iv == NULL && (sa_ptr->ast == 1 || sa_ptr->est == 1) && crypto_config.cryptography_type != CRYPTOGRAPHY_TYPE_KMCCRYPTO)
+    {
+        return CRYPTO_LIB_ERR_NULL_IV;
+    }
+    // Must have ABM if doing authentication
+    if (sa_ptr->abm == NULL && sa_ptr->ast)
+    {
+        return CRYPTO_LIB_ERR_NULL_ABM;
+    }
 
 #ifdef SA_DEBUG
-            printf("Valid operational SA found at index %d.\n", i);
-            printf("\t Tfvn: %d\n", tfvn);
-            printf("\t Scid: %d\n", scid);
-            printf("\t Vcid: %d\n", vcid);
+    printf("Valid operational SA found at SPI %d.\n", sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE].spi);
+    printf("\t Tfvn: %d\n", tfvn);
+    printf("\t Scid: %d\n", scid);
+    printf("\t Vcid: %d\n", vcid);
 #endif
 
+    return status;
+}
+
+/**
+ * @brief Function: sa_gvcid_index_repair
+ * Scans the table for an operational SA on a GVCID the index missed, e.g. one started or moved in place through the
+ * pointer from sa_get_from_spi without sa_save_sa, and links it where it belongs so the next lookup hits the index.
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8 // tc only
+ * @param slot: uint16*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_gvcid_index_repair(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid, uint16_t* slot)
+{
+    int32_t status = CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
+    sa_slot_t* entry;
+    SecurityAssociation_t* sa_ptr;
+    uint32_t i;
+
+    for (i = 0; i < sa_num_slots; i++)
+    {
+        entry = &sa_chunks[i / SA_TABLE_CHUNK_SIZE][i % SA_TABLE_CHUNK_SIZE];
+        sa_ptr = sa_slot_current(entry);
+        // Lowest SPI wins, as it does in the index
+        if ((sa_ptr->gvcid_blk.tfvn == tfvn) && (sa_ptr->gvcid_blk.scid == scid) &&
+            (sa_ptr->gvcid_blk.vcid == vcid) && (sa_ptr->sa_state == SA_OPERATIONAL) &&
+            (crypto_config.unique_sa_per_mapid == TC_UNIQUE_SA_PER_MAP_ID_FALSE ||
+             sa_ptr->gvcid_blk.mapid == mapid) &&
+            ((status != CRYPTO_LIB_SUCCESS) ||
+             (entry->spi < sa_chunks[*slot / SA_TABLE_CHUNK_SIZE][*slot % SA_TABLE_CHUNK_SIZE].spi)))
+        {
+            *slot = i;
             status = CRYPTO_LIB_SUCCESS;
-            break;
         }
     }
+    if ((status == CRYPTO_LIB_SUCCESS) && sa_gvcid_index_stale(*slot))
+    {
+        sa_gvcid_index_lock();
+        // A failed relink only leaves the SA to be found by this scan again
+        sa_gvcid_index_update(*slot, 0);
+        sa_gvcid_index_unlock();
+    }
+    return status;
+}
 
-    // If not a success, attempt to generate a meaningful error code
-    if (status != CRYPTO_LIB_SUCCESS)
+/**
+ * @brief Function: sa_gvcid_index_loosen
+ * Adds a slot to the index's loose list the first time sa_get_from_spi hands it out. Callers, the tests among them,
+ * start, stop and move SAs through that pointer without sa_save_sa, so lookups re-check these slots.
+ * @param slot: uint16
+ **/
+static void sa_gvcid_index_loosen(uint16_t slot)
+{
+    sa_slot_t* entry = &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE];
+    sa_gvcid_index_t* index;
+
+    if (__atomic_load_n(&entry->handed_out, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    sa_gvcid_index_lock();
+    index = sa_gvcid_index;
+    if (!entry->handed_out && (index != NULL) && (index->num_loose < index->size))
+    {
+        index->loose[index->num_loose] = slot;
+        __atomic_store_n(&index->num_loose, index->num_loose + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&entry->handed_out, 1, __ATOMIC_RELEASE);
+    }
+    sa_gvcid_index_unlock();
+}
+
+/**
+ * @brief Function: sa_gvcid_index_tighten
+ * Re-indexes every loose slot whose SA was changed in place since it was last indexed, so the lookup that follows
+ * sees the table as a scan would. Checking a slot that has not changed costs a hash and a compare.
+ **/
+static void sa_gvcid_index_tighten(void)
+{
+    const sa_gvcid_index_t* index = __atomic_load_n(&sa_gvcid_index, __ATOMIC_ACQUIRE);
+    uint32_t i;
+
+    for (i = 0; (index != NULL) && (i < __atomic_load_n(&index->num_loose, __ATOMIC_ACQUIRE)); i++)
+    {
+        if (sa_gvcid_index_stale(index->loose[i]))
+        {
+            sa_gvcid_index_lock();
+            sa_gvcid_index_update(index->loose[i], 0);
+            sa_gvcid_index_unlock();
+            // The update may have published a new index and freed this one; its loose list is in the same order
+            index = __atomic_load_n(&sa_gvcid_index, __ATOMIC_ACQUIRE);
+        }
+    }
+}
+
+/**
+ * @brief Function: sa_diagnose_gvcid
+ * Makes a best attempt at a useful error code for a GVCID that has no operational SA.
+ * Scans the whole table, so it is only meant for error reporting after a failed lookup, see Crypto_Get_Operational_SA.
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8 // tc only
+ * @return int32: Success if an operational SA matches, otherwise the most accurate mismatch error
+ **/
+static int32_t sa_diagnose_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid)
+{
+    int32_t status = CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
+    uint16_t slot = SA_SLOT_NONE;
+    SecurityAssociation_t* sa_ptr;
+    uint32_t i;
+    if (sa_chunks == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+
+    status = sa_gvcid_index_find(tfvn, scid, vcid, mapid, &slot);
+    if (status == CRYPTO_LIB_SUCCESS)
     {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    status = CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
+
 #ifdef SA_DEBUG
-        printf(KRED "Error - Making best attempt at a useful error code:\n\t" RESET);
+    printf(KRED "Error - Making best attempt at a useful error code:\n\t" RESET);
 #endif
-        for (i = 0; i < NUM_SA; i++)
+    for (i = 0; i < sa_num_slots; i++)
+    {
+        sa_ptr = sa_slot_current(&sa_chunks[i / SA_TABLE_CHUNK_SIZE][i % SA_TABLE_CHUNK_SIZE]);
+        // Could possibly have more than one field mismatched,
+        // ordering so the 'most accurate' SA's error is returned
+        // (determined by matching header fields L to R)
+        if ((sa_ptr->gvcid_blk.tfvn != tfvn) && (sa_ptr->gvcid_blk.scid == scid) &&
+            (sa_ptr->gvcid_blk.vcid == vcid) &&
+            (sa_ptr->gvcid_blk.mapid == mapid && sa_ptr->sa_state == SA_OPERATIONAL))
         {
-            // Could possibly have more than one field mismatched,
-            // ordering so the 'most accurate' SA's error is returned
-            // (determined by matching header fields L to R)
-            if ((sa[i].gvcid_blk.tfvn != tfvn) && (sa[i].gvcid_blk.scid == scid) &&
-                (sa[i].gvcid_blk.vcid == vcid) &&
-                (sa[i].gvcid_blk.mapid == mapid && sa[i].sa_state == SA_OPERATIONAL))
-            {
 #ifdef SA_DEBUG
-                printf(KRED "An operational SA was found - but mismatched tfvn.\n" RESET);
-                printf(KRED "SA is %d\n", i);
-                printf(KRED "Incoming tfvn is %d\n", tfvn);
-                printf(KRED "SA tfvn is %d\n", sa[i].gvcid_blk.tfvn);
+            printf(KRED "An operational SA was found - but mismatched tfvn.\n" RESET);
+            printf(KRED "SA is %d\n", sa_ptr->spi);
+            printf(KRED "Incoming tfvn is %d\n", tfvn);
+            printf(KRED "SA tfvn is %d\n", sa_ptr->gvcid_blk.tfvn);
 #endif
-                status = CRYPTO_LIB_ERR_INVALID_TFVN;
-            }
-            else if ((sa[i].gvcid_blk.tfvn == tfvn) && (sa[i].gvcid_blk.scid != scid) &&
-                (sa[i].gvcid_blk.vcid == vcid) &&
-                (sa[i].gvcid_blk.mapid == mapid && sa[i].sa_state == SA_OPERATIONAL))
-            {
+            status = CRYPTO_LIB_ERR_INVALID_TFVN;
+        }
+        else if ((sa_ptr->gvcid_blk.tfvn == tfvn) && (sa_ptr->gvcid_blk.scid != scid) &&
+            (sa_ptr->gvcid_blk.vcid == vcid) &&
+            (sa_ptr->gvcid_blk.mapid == mapid && sa_ptr->sa_state == SA_OPERATIONAL))
+        {
 #ifdef SA_DEBUG
-                printf(KRED "An operational SA was found - but mismatched scid.\n" RESET);
-                printf(KRED "SA is %d\n", i);
-                printf(KRED "SCID is %d\n", scid);
-                printf(KRED "gvcid_blk SCID is %d\n", sa[i].gvcid_blk.scid);
+            printf(KRED "An operational SA was found - but mismatched scid.\n" RESET);
+            printf(KRED "SA is %d\n", sa_ptr->spi);
+            printf(KRED "SCID is %d\n", scid);
+            printf(KRED "gvcid_blk SCID is %d\n", sa_ptr->gvcid_blk.scid);
 #endif
-                status = CRYPTO_LIB_ERR_INVALID_SCID;
-            }
-            else if ((sa[i].gvcid_blk.tfvn == tfvn) && (sa[i].gvcid_blk.scid == scid) &&
-                (sa[i].gvcid_blk.vcid != vcid) &&
-                (sa[i].gvcid_blk.mapid == mapid && sa[i].sa_state == SA_OPERATIONAL))
-            {
+            status = CRYPTO_LIB_ERR_INVALID_SCID;
+        }
+        else if ((sa_ptr->gvcid_blk.tfvn == tfvn) && (sa_ptr->gvcid_blk.scid == scid) &&
+            (sa_ptr->gvcid_blk.vcid != vcid) &&
+            (sa_ptr->gvcid_blk.mapid == mapid && sa_ptr->sa_state == SA_OPERATIONAL))
+        {
 #ifdef SA_DEBUG
-                printf(KRED "An operational SA was found - but mismatched vcid.\n" RESET);
-                printf(KRED "SA is %d\n", i);
+            printf(KRED "An operational SA was found - but mismatched vcid.\n" RESET);
+            printf(KRED "SA is %d\n", sa_ptr->spi);
 #endif
-                status = CRYPTO_LIB_ERR_INVALID_VCID;
-            }
-            else if ((sa[i].gvcid_blk.tfvn == tfvn) && (sa[i].gvcid_blk.scid == scid) &&
-                (sa[i].gvcid_blk.vcid == vcid) &&
-                (sa[i].gvcid_blk.mapid != mapid && sa[i].sa_state == SA_OPERATIONAL))
-            {
+            status = CRYPTO_LIB_ERR_INVALID_VCID;
+        }
+        else if ((sa_ptr->gvcid_blk.tfvn == tfvn) && (sa_ptr->gvcid_blk.scid == scid) &&
+            (sa_ptr->gvcid_blk.vcid == vcid) &&
+            (sa_ptr->gvcid_blk.mapid != mapid && sa_ptr->sa_state == SA_OPERATIONAL))
+        {
 #ifdef SA_DEBUG
-                printf(KRED "An operational SA was found - but mismatched mapid.\n" RESET);
+            printf(KRED "An operational SA was found - but mismatched mapid.\n" RESET);
 #endif
-                status = CRYPTO_LIB_ERR_INVALID_MAPID;
-            }
-            else if ((sa[i].gvcid_blk.tfvn == tfvn) && (sa[i].gvcid_blk.scid == scid) &&
-                (sa[i].gvcid_blk.vcid == vcid) &&
-                (sa[i].gvcid_blk.mapid == mapid && sa[i].sa_state != SA_OPERATIONAL))
-            {
+            status = CRYPTO_LIB_ERR_INVALID_MAPID;
+        }
+        else if ((sa_ptr->gvcid_blk.tfvn == tfvn) && (sa_ptr->gvcid_blk.scid == scid) &&
+            (sa_ptr->gvcid_blk.vcid == vcid) &&
+            (sa_ptr->gvcid_blk.mapid == mapid && sa_ptr->sa_state != SA_OPERATIONAL))
+        {
 #ifdef SA_DEBUG
-                printf(KRED "A valid but non-operational SA was found: SPI: %d.\n" RESET, sa[i].spi);
+            printf(KRED "A valid but non-operational SA was found: SPI: %d.\n" RESET, sa_ptr->spi);
 #endif
-                status = CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
-            }
-            else
-            {
-                // Don't set status, could overwrite useful error message above
-            }
+            status = CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
+        }
+        else
+        {
+            // Don't set status, could overwrite useful error message above
         }
-            // Detailed debug block
+    }
+    // Detailed debug block
 #ifdef SA_DEBUG
-            printf(KYEL "Incoming frame parameters:\n" RESET);
-            printf(KYEL "\ttfvn %02X\n" RESET, tfvn);
-            printf(KYEL "\tscid %d\n" RESET, scid);
-            printf(KYEL "\tvcid %d\n" RESET, vcid);
-            printf(KYEL "\tmapid %02X\n" RESET, mapid);
+    printf(KYEL "Incoming frame parameters:\n" RESET);
+    printf(KYEL "\ttfvn %02X\n" RESET, tfvn);
+    printf(KYEL "\tscid %d\n" RESET, scid);
+    printf(KYEL "\tvcid %d\n" RESET, vcid);
+    printf(KYEL "\tmapid %02X\n" RESET, mapid);
 #endif
-    }
 
     return status;
 }
 
-// TODO: Nothing actually happens here
+/*
+** Security Association Snapshot Functions
+*/
 /**
- * @brief Function: sa_save_sa
- * @param sa: SecurityAssociation_t*
+ * @brief Function: sa_get_from_index
+ * Walks the table in slot order, e.g. for Crypto_Snapshot_Save
+ * @param index: uint32
+ * @param security_association: SecurityAssociation_t**
+ * @return int32: Success, SADB_SPI_NOT_FOUND once index is past the last SA
+ **/
+static int32_t sa_get_from_index(uint32_t index, SecurityAssociation_t** security_association)
+{
+    if (sa_chunks == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    if (index >= sa_num_slots)
+    {
+        return SADB_SPI_NOT_FOUND;
+    }
+    *security_association = sa_slot_current(&sa_chunks[index / SA_TABLE_CHUNK_SIZE][index % SA_TABLE_CHUNK_SIZE]);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_insert
+ * Adds a complete SA, or replaces the one with the same SPI, and indexes it if it is operational.
+ * The ABM is copied into the pool; ek_ref and ak_ref are kept as given and must outlive the table.
+ * @param security_association: const SecurityAssociation_t*
  * @return int32: Success/Failure
- * @note Nothing currently actually happens in this function
  **/
-static int32_t sa_save_sa(SecurityAssociation_t* sa)
+static int32_t sa_insert(const SecurityAssociation_t* security_association)
 {
-    int32_t status = CRYPTO_LIB_SUCCESS;
-    sa = sa; // TODO - use argument
-    // We could do a memory copy of the SA into the sa[NUM_SA] array at the given SPI, however, the inmemory code
-    // currently updates in place so no need for that.
-    //  If we change the in-place update logic, we should update this function to actually update the SA.
-    return status;
+    if (sa_chunks == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    if (security_association == NULL)
+    {
+        return SADB_NULL_SA_USED;
+    }
+    return sa_provision_one(SA_CREATE, security_association->spi, security_association);
 }
 
 /*
-** Security Association Management Services
+** Security Association Provisioning Functions
 */
 /**
- * @brief sa_start
- * @param tc_frame: TC_t
- * @return int32: Success/Failure
+ * @brief Function: sa_provision
+ * Runs a batch of SA procedures in order, each checked like its SDLS counterpart and given its own status; a failed
+ * operation does not stop the ones after it. Operations are applied a group at a time, and the group shares one set
+ * of waits for frames using the SAs it changes instead of paying them per SA. Runs under the epoch writer lock, one
+ * caller at a time.
+ * @param ops: SaProvisionOp_t*
+ * @param num_ops: uint32
+ * @return int32: Success, or the status of the first operation that failed
  **/
-static int32_t sa_start(TC_t* tc_frame)
+static int32_t sa_provision(SaProvisionOp_t* ops, uint32_t num_ops)
 {
-    // Local variables
-    uint8_t count = 0;
-    uint16_t spi = 0x0000;
-    crypto_gvcid_t gvcid;
-    int x;
-    int i;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    uint32_t i = 0;
 
-    // Read ingest
-    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+    if (sa_chunks == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    if ((ops == NULL) && (num_ops > 0))
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
 
-    // Overwrite last PID
-    sa[spi].lpid =
-        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    Crypto_Epoch_Writer_Lock();
+    while (i < num_ops)
+    {
+        i = sa_provision_group(ops, i, num_ops);
+    }
+    Crypto_Epoch_Writer_Unlock();
+    for (i = 0; (i < num_ops) && (status == CRYPTO_LIB_SUCCESS); i++)
+    {
+        status = ops[i].status;
+    }
+    return status;
+}
 
-    // Check SPI exists and in 'Keyed' state
-    if (spi < NUM_SA)
+/**
+ * @brief Function: sa_provision_group
+ * Applies operations from first on, up to SA_PROVISION_GROUP_SIZE of them or the first that names an SA already
+ * changed by the group, which is left for the next group so it sees the earlier result.
+ * @param ops: SaProvisionOp_t*
+ * @param first: uint32
+ * @param num_ops: uint32
+ * @return uint32: Index of the first operation not handled
+ **/
+static uint32_t sa_provision_group(SaProvisionOp_t* ops, uint32_t first, uint32_t num_ops)
+{
+    SaProvisionOp_t* group[SA_PROVISION_GROUP_SIZE];
+    SecurityAssociation_t* versions[SA_PROVISION_GROUP_SIZE];
+    uint16_t slots[SA_PROVISION_GROUP_SIZE];
+    uint8_t shadow_changed[SA_PROVISION_GROUP_SIZE];
+    uint8_t synchronize = 0;
+    uint32_t num = 0;
+    uint32_t i;
+    uint32_t j;
+    uint16_t slot;
+    int32_t status;
+
+    for (i = first; (i < num_ops) && (num < SA_PROVISION_GROUP_SIZE); i++)
     {
-        if (sa[spi].sa_state == SA_KEYED)
+        slot = sa_table_find_slot(ops[i].spi);
+        for (j = 0; j < num; j++)
         {
-            count = 2;
+            if (slots[j] == slot)
+            {
+                break;
+            }
+        }
+        if (j < num)
+        {
+            break;
+        }
 
-            for (x = 0; x <= ((sdls_frame.pdu.pdu_len - 2) / 4); x++)
-            { // Read in GVCID
-                gvcid.tfvn = (sdls_frame.pdu.data[count] >> 4);
-                gvcid.scid = (sdls_frame.pdu.data[count] << 12) | (sdls_frame.pdu.data[count + 1] << 4) |
-                             (sdls_frame.pdu.data[count + 2] >> 4);
-                gvcid.vcid = (sdls_frame.pdu.data[count + 2] << 4) | (sdls_frame.pdu.data[count + 3] && 0x3F);
-                if (current_managed_parameters->has_segmentation_hdr == TC_HAS_SEGMENT_HDRS)
-                {
-                    gvcid.mapid = (sdls_frame.pdu.data[count + 3]);
-                }
-                else
-                {
-                    gvcid.mapid = 0;
-                }
+        ops[i].status = sa_provision_check(&ops[i], &slot);
+        if (ops[i].status != CRYPTO_LIB_SUCCESS)
+        {
+            continue;
+        }
+        sa_gvcid_index_lock();
+        sa_gvcid_index_remove(slot);
+        sa_gvcid_index_unlock();
+        group[num] = &ops[i];
+        slots[num] = slot;
+        versions[num] = sa_version_open(slot, &synchronize);
+        num++;
+    }
+    if (num == 0)
+    {
+        return i;
+    }
 
-                // TC
-                if (gvcid.vcid != tc_frame->tc_header.vcid)
-                { // Clear all GVCIDs for provided SPI
-                    if (gvcid.mapid == TYPE_TC)
-                    {
-                        sa[spi].gvcid_blk.tfvn = 0;
-                        sa[spi].gvcid_blk.scid = 0;
-                        sa[spi].gvcid_blk.vcid = 0;
-                        sa[spi].gvcid_blk.mapid = 0;
-                    }
-                    // Write channel to SA
-                    if (gvcid.mapid != TYPE_MAP)
-                    { // TC
-                        sa[spi].gvcid_blk.tfvn = gvcid.tfvn;
-                        sa[spi].gvcid_blk.scid = gvcid.scid;
-                        sa[spi].gvcid_blk.mapid = gvcid.mapid;
-                    }
-                    else
-                    {
-                        // TODO: Handle TYPE_MAP
-                    }
-                }
-                // TM
-                if (gvcid.vcid != tm_frame_pri_hdr.vcid) // TODO Check this tm_frame.tm_header.vcid)
-                { // Clear all GVCIDs for provided SPI
-                    if (gvcid.mapid == TYPE_TM)
-                    {
-                        for (i = 0; i < NUM_GVCID; i++)
-                        { // TM
-                            sa[spi].gvcid_blk.tfvn = 0;
-                            sa[spi].gvcid_blk.scid = 0;
-                            sa[spi].gvcid_blk.vcid = 0;
-                            sa[spi].gvcid_blk.mapid = 0;
-                        }
-                    }
-                    // Write channel to SA
+    // One wait for every version handed back to frames when the group was opened
+    if (synchronize)
+    {
+        Crypto_Epoch_Synchronize();
+    }
+    synchronize = 0;
+    for (j = 0; j < num; j++)
+    {
+        group[j]->status = sa_provision_apply(versions[j], group[j]);
+        shadow_changed[j] = sa_version_publish(slots[j], sa_provision_sets_counters(group[j]));
+        synchronize |= shadow_changed[j];
+    }
+    if (synchronize)
+    {
+        Crypto_Epoch_Synchronize();
+    }
+    for (j = 0; j < num; j++)
+    {
+        sa_version_commit(slots[j], shadow_changed[j], sa_provision_sets_counters(group[j]));
+    }
+    Crypto_Epoch_Synchronize();
+    for (j = 0; j < num; j++)
+    {
+        sa_version_close(slots[j], shadow_changed[j], sa_provision_sets_counters(group[j]));
+        // Unlinked when the group was opened, before the wait above, so no lookup can still be standing on the slot
+        sa_gvcid_index_lock();
+        status = sa_gvcid_index_update(slots[j], 1);
+        sa_gvcid_index_unlock();
+        if (group[j]->status == CRYPTO_LIB_SUCCESS)
+        {
+            group[j]->status = status;
+        }
+    }
+    return i;
+}
+
+/**
+ * @brief Function: sa_provision_check
+ * Validates an operation against the SA it names. SA_CREATE adds the SPI to the table if it is new.
+ * @param op: const SaProvisionOp_t*
+ * @param slot: uint16*, set to the SA's slot
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_provision_check(const SaProvisionOp_t* op, uint16_t* slot)
+{
+    uint8_t from_state;
+
+    switch (op->procedure)
+    {
+    case SA_CREATE:
+        if (op->sa == NULL)
+        {
+            return SADB_NULL_SA_USED;
+        }
+        if (op->sa->abm_len > ABM_SIZE)
+        {
+            return CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE;
+        }
+        if (sa_table_add(op->spi) == NULL)
+        {
+            return SADB_SA_TABLE_FULL;
+        }
+        *slot = sa_table_find_slot(op->spi);
+        return CRYPTO_LIB_SUCCESS;
+    case SA_REKEY:
+        if (op->sa == NULL)
+        {
+            return SADB_NULL_SA_USED;
+        }
+        from_state = SA_UNKEYED;
+        break;
+    case SA_START:
+    case SA_EXPIRE:
+        from_state = SA_KEYED;
+        break;
+    case SA_STOP:
+        from_state = SA_OPERATIONAL;
+        break;
+    case SA_DELETE:
+        from_state = SA_UNKEYED;
+        break;
+    default:
+        return CRYPTO_LIB_ERROR;
+    }
+
+    *slot = sa_table_find_slot(op->spi);
+    if (*slot == SA_SLOT_NONE)
+    {
+        return SADB_SPI_NOT_FOUND;
+    }
+    if (sa_chunks[*slot / SA_TABLE_CHUNK_SIZE][*slot % SA_TABLE_CHUNK_SIZE].sa.sa_state != from_state)
+    {
+        return SADB_SA_WRONG_STATE;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_provision_apply
+ * Makes an operation's change to the version opened for it
+ * @param sa_ptr: SecurityAssociation_t*
+ * @param op: const SaProvisionOp_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_provision_apply(SecurityAssociation_t* sa_ptr, const SaProvisionOp_t* op)
+{
+    const uint8_t* abm;
+    uint16_t abm_idx;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    switch (op->procedure)
+    {
+    case SA_CREATE:
+        // The version's pool reference is kept so Crypto_SA_Set_ABM can let go of it
+        abm = sa_ptr->abm;
+        abm_idx = sa_ptr->abm_idx;
+        *sa_ptr = *op->sa;
+        sa_ptr->spi = op->spi;
+        sa_ptr->abm = abm;
+        sa_ptr->abm_idx = abm_idx;
+        if (op->sa->abm != NULL)
+        {
+            status = Crypto_SA_Set_ABM(sa_ptr, op->sa->abm, op->sa->abm_len);
+        }
+        break;
+    case SA_REKEY:
+        sa_ptr->ekid = op->sa->ekid;
+        memcpy(sa_ptr->iv, op->sa->iv, sa_ptr->shivf_len);
+        sa_ptr->sa_state = SA_KEYED;
+        break;
+    case SA_START:
+        sa_ptr->gvcid_blk = op->gvcid;
+        sa_ptr->sa_state = SA_OPERATIONAL;
+        break;
+    case SA_STOP:
+        memset(&sa_ptr->gvcid_blk, 0, sizeof(sa_ptr->gvcid_blk));
+        sa_ptr->sa_state = SA_KEYED;
+        break;
+    case SA_EXPIRE:
+        sa_ptr->sa_state = SA_UNKEYED;
+        break;
+    default: // SA_DELETE
+        sa_ptr->sa_state = SA_NONE;
+        break;
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_provision_sets_counters
+ * @param op: const SaProvisionOp_t*
+ * @return uint8: 1 if the operation sets the IV and ARSN, see sa_version_commit
+ **/
+static uint8_t sa_provision_sets_counters(const SaProvisionOp_t* op)
+{
+    return (op->procedure == SA_CREATE) || (op->procedure == SA_REKEY);
+}
+
+/**
+ * @brief Function: sa_provision_one
+ * Runs a single operation, as the SDLS procedures and sa_insert do
+ * @param procedure: uint8
+ * @param spi: uint16
+ * @param security_association: const SecurityAssociation_t*, for SA_CREATE and SA_REKEY
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_provision_one(uint8_t procedure, uint16_t spi, const SecurityAssociation_t* security_association)
+{
+    SaProvisionOp_t op;
+
+    memset(&op, 0, SA_PROVISION_OP_SIZE);
+    op.procedure = procedure;
+    op.spi = spi;
+    op.sa = security_association;
+    return sa_provision(&op, 1);
+}
+
+/*
+** SA Table Functions
+*/
+/**
+ * @brief Function: sa_table_release
+ * Frees the SA table, the SPI map and the operational SA index, dropping every SA's ABM pool reference.
+ **/
+static void sa_table_release(void)
+{
+    uint32_t i;
+    if (sa_chunks != NULL)
+    {
+        for (i = 0; i < sa_num_slots; i++)
+        {
+            Crypto_SA_Release_ABM(&sa_chunks[i / SA_TABLE_CHUNK_SIZE][i % SA_TABLE_CHUNK_SIZE].sa);
+        }
+        for (i = 0; (i < sa_num_chunks) && (sa_mmap_base == NULL); i++)
+        {
+            sa_table_free(sa_chunks[i]);
+        }
+        sa_table_free(sa_chunks);
+        sa_chunks = NULL;
+    }
+    sa_num_chunks = 0;
+    sa_num_slots = 0;
+    for (i = 0; i < SA_SLOT_MAP_NUM_PAGES; i++)
+    {
+        sa_table_free(sa_slot_map[i]);
+        sa_slot_map[i] = NULL;
+    }
+    sa_table_free(sa_gvcid_index);
+    sa_gvcid_index = NULL;
+}
+
+/**
+ * @brief Function: sa_table_find_slot
+ * @param spi: uint16
+ * @return uint16: Slot holding the SPI, SA_SLOT_NONE if it is not configured
+ **/
+static uint16_t sa_table_find_slot(uint16_t spi)
+{
+    uint16_t* page = sa_slot_map[spi / SA_SLOT_MAP_PAGE_SIZE];
+    if (page == NULL)
+    {
+        return SA_SLOT_NONE;
+    }
+    return page[spi % SA_SLOT_MAP_PAGE_SIZE];
+}
+
+/**
+ * @brief Function: sa_table_find
+ * @param spi: uint16
+ * @return SecurityAssociation_t*: NULL if the SPI is not configured
+ **/
+static SecurityAssociation_t* sa_table_find(uint16_t spi)
+{
+    uint16_t slot = sa_table_find_slot(spi);
+    if (slot == SA_SLOT_NONE)
+    {
+        return NULL;
+    }
+    return &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE].sa;
+}
+
+/**
+ * @brief Function: sa_table_add
+ * Returns the SA for an SPI, giving it a slot first if it has none. New SAs start in SA_NONE.
+ * @param spi: uint16
+ * @return SecurityAssociation_t*: NULL if the table is at capacity or out of memory
+ **/
+static SecurityAssociation_t* sa_table_add(uint16_t spi)
+{
+    uint16_t slot = sa_table_find_slot(spi);
+    sa_slot_t** chunks;
+    sa_slot_t* entry;
+
+    if (slot != SA_SLOT_NONE)
+    {
+        return &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE].sa;
+    }
+    if (sa_num_slots >= sa_capacity)
+    {
+        return NULL;
+    }
+
+    if (sa_table_map_spi(spi, SA_SLOT_NONE) != CRYPTO_LIB_SUCCESS)
+    {
+        return NULL;
+    }
+
+    if (sa_num_slots == (uint32_t)sa_num_chunks * SA_TABLE_CHUNK_SIZE)
+    {
+        chunks = (sa_slot_t**)sa_table_realloc(sa_chunks, sa_num_chunks * sizeof(sa_slot_t*),
+                                               (sa_num_chunks + 1) * sizeof(sa_slot_t*));
+        if (chunks == NULL)
+        {
+            return NULL;
+        }
+        sa_chunks = chunks;
+        if (sa_mmap_base != NULL)
+        {
+            // The store file is sized for sa_capacity up front
+            sa_chunks[sa_num_chunks] = (sa_slot_t*)(sa_mmap_base + SA_MMAP_LIVE_OFFSET) +
+                                       ((uint32_t)sa_num_chunks * SA_TABLE_CHUNK_SIZE);
+            memset(sa_chunks[sa_num_chunks], 0, SA_TABLE_CHUNK_SIZE * sizeof(sa_slot_t));
+        }
+        else
+        {
+            sa_chunks[sa_num_chunks] = (sa_slot_t*)calloc(SA_TABLE_CHUNK_SIZE, sizeof(sa_slot_t));
+        }
+        if (sa_chunks[sa_num_chunks] == NULL)
+        {
+            return NULL;
+        }
+        sa_num_chunks++;
+    }
+
+    entry = &sa_chunks[sa_num_slots / SA_TABLE_CHUNK_SIZE][sa_num_slots % SA_TABLE_CHUNK_SIZE];
+    // Every SA references the shared all-zero bitmask until it is configured with its own
+    if (Crypto_SA_Fill_ABM(&entry->sa, 0x00, 0) != CRYPTO_LIB_SUCCESS)
+    {
+        return NULL;
+    }
+    entry->spi = spi;
+    entry->sa.ekid = spi;
+    entry->sa.akid = spi;
+    entry->sa.sa_state = SA_NONE;
+    // Index rebuilds walk every slot up to sa_num_slots
+    sa_gvcid_index_lock();
+    slot = (uint16_t)sa_num_slots++;
+
+    // Keep the load factor of the operational SA index at or below one, the index has room for a slot per bucket
+    if (((sa_gvcid_index == NULL) || (sa_num_slots > sa_gvcid_index->size)) &&
+        (sa_gvcid_index_rebuild() != CRYPTO_LIB_SUCCESS))
+    {
+        sa_num_slots--;
+        sa_gvcid_index_unlock();
+        Crypto_SA_Release_ABM(&entry->sa);
+        return NULL;
+    }
+    sa_table_map_spi(spi, slot);
+    sa_gvcid_index_unlock();
+    return &entry->sa;
+}
+
+/**
+ * @brief Function: sa_table_map_spi
+ * Points an SPI at a slot, allocating its page of the SPI to slot map if needed
+ * @param spi: uint16
+ * @param slot: uint16
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_table_map_spi(uint16_t spi, uint16_t slot)
+{
+    uint16_t** page = &sa_slot_map[spi / SA_SLOT_MAP_PAGE_SIZE];
+    uint32_t i;
+
+    if (*page == NULL)
+    {
+        *page = (uint16_t*)malloc(SA_SLOT_MAP_PAGE_SIZE * sizeof(uint16_t));
+        if (*page == NULL)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+        for (i = 0; i < SA_SLOT_MAP_PAGE_SIZE; i++)
+        {
+            (*page)[i] = SA_SLOT_NONE;
+        }
+    }
+#ifdef CRYPTO_STATIC_CONFIG
+    else if (sa_static_owns(*page))
+    {
+        // Pages of the generated map are read-only, the first change to one goes to a copy
+        uint16_t* copy = (uint16_t*)sa_table_realloc(*page, SA_SLOT_MAP_PAGE_SIZE * sizeof(uint16_t),
+                                                     SA_SLOT_MAP_PAGE_SIZE * sizeof(uint16_t));
+        if (copy == NULL)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+        *page = copy;
+    }
+#endif
+    (*page)[spi % SA_SLOT_MAP_PAGE_SIZE] = slot;
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_table_realloc
+ * realloc for the table's arrays, which may still be the static ones the generated configuration was loaded into, or
+ * with thread safety set still be read by frames on other threads
+ * @param ptr: void*
+ * @param old_size: size_t, bytes in use at ptr
+ * @param size: size_t
+ * @return void*: NULL if out of memory, ptr is left as it was
+ **/
+static void* sa_table_realloc(void* ptr, size_t old_size, size_t size)
+{
+    void* copy;
+    uint8_t keep_old = (ptr != NULL) && (crypto_config.thread_safe == CRYPTO_THREAD_SAFE_TRUE);
+#ifdef CRYPTO_STATIC_CONFIG
+    keep_old = keep_old || sa_static_owns(ptr);
+#endif
+    if (!keep_old)
+    {
+        return realloc(ptr, size);
+    }
+    copy = malloc(size);
+    if (copy != NULL)
+    {
+        memcpy(copy, ptr, (old_size < size) ? old_size : size);
+#ifdef CRYPTO_STATIC_CONFIG
+        if (sa_static_owns(ptr))
+        {
+            return copy;
+        }
+#endif
+        // Frames on other threads may still be reading the old array
+        Crypto_Epoch_Retire(ptr, free);
+    }
+    return copy;
+}
+
+/**
+ * @brief Function: sa_table_free
+ * @param ptr: void*, table array to free, static arrays are left alone
+ **/
+static void sa_table_free(void* ptr)
+{
+#ifdef CRYPTO_STATIC_CONFIG
+    if (sa_static_owns(ptr))
+    {
+        return;
+    }
+#endif
+    free(ptr);
+}
+
+#ifdef CRYPTO_STATIC_CONFIG
+/*
+** Static Configuration Functions
+** With CRYPTO_STATIC_CONFIG set, support/scripts/crypto_static_config.py lays out the SAs, the SPI to slot map and
+** the operational SA index at build time. sa_config then has nothing to allocate, hash or fill in: the map pages are
+** used in place, and the SAs and index are copied whole into static storage. The table outgrows that storage onto
+** the heap like any other, and a map page is copied out of read-only memory the first time it changes.
+*/
+/**
+ * @brief Function: sa_static_config
+ * Loads the generated SAs in place of the defaults of sa_config
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_static_config(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    SecurityAssociation_t* sa_ptr;
+    sa_slot_t* entry;
+    uint32_t i;
+
+    if (CRYPTO_STATIC_NUM_SAS > sa_capacity)
+    {
+        return SADB_SA_TABLE_FULL;
+    }
+
+    if (sa_mmap_base != NULL)
+    {
+        // The table lives in the store file, which is filled an SA at a time
+        for (i = 0; i < CRYPTO_STATIC_NUM_SAS; i++)
+        {
+            sa_ptr = sa_table_add(crypto_static_sas[i].spi);
+            if (sa_ptr == NULL)
+            {
+                return SADB_SA_TABLE_FULL;
+            }
+            Crypto_SA_Release_ABM(sa_ptr);
+            *sa_ptr = crypto_static_sas[i];
+        }
+        return sa_gvcid_index_rebuild();
+    }
+
+    sa_table_release();
+    memset(sa_static_slots, 0, sizeof(sa_static_slots));
+    for (i = 0; i < CRYPTO_STATIC_NUM_SA_CHUNKS; i++)
+    {
+        sa_static_chunks[i] = &sa_static_slots[i * SA_TABLE_CHUNK_SIZE];
+    }
+    for (i = 0; i < CRYPTO_STATIC_NUM_SAS; i++)
+    {
+        // Bit masks stay in read-only memory; abm_idx 0 keeps them out of the ABM pool
+        entry = &sa_static_slots[i];
+        entry->sa = crypto_static_sas[i];
+        entry->spi = crypto_static_sas[i].spi;
+    }
+    memcpy(sa_slot_map, crypto_static_sa_slot_map, sizeof(sa_slot_map));
+
+    sa_static_gvcid_index.size = CRYPTO_STATIC_SA_GVCID_INDEX_SIZE;
+    sa_static_gvcid_index.buckets = sa_static_gvcid_index_data;
+    sa_static_gvcid_index.next = &sa_static_gvcid_index_data[CRYPTO_STATIC_SA_GVCID_INDEX_SIZE];
+    sa_static_gvcid_index.bucket = &sa_static_gvcid_index_data[2 * CRYPTO_STATIC_SA_GVCID_INDEX_SIZE];
+    sa_static_gvcid_index.loose = &sa_static_gvcid_index_data[3 * CRYPTO_STATIC_SA_GVCID_INDEX_SIZE];
+    sa_static_gvcid_index.num_loose = 0;
+    for (i = 0; i < 4 * CRYPTO_STATIC_SA_GVCID_INDEX_SIZE; i++)
+    {
+        sa_static_gvcid_index_data[i] = SA_SLOT_NONE;
+    }
+    memcpy(sa_static_gvcid_index.buckets, crypto_static_sa_gvcid_index, sizeof(crypto_static_sa_gvcid_index));
+    memcpy(sa_static_gvcid_index.next, crypto_static_sa_index_next, sizeof(crypto_static_sa_index_next));
+    memcpy(sa_static_gvcid_index.bucket, crypto_static_sa_index_bucket, sizeof(crypto_static_sa_index_bucket));
+
+    sa_chunks = sa_static_chunks;
+    sa_num_chunks = CRYPTO_STATIC_NUM_SA_CHUNKS;
+    sa_num_slots = CRYPTO_STATIC_NUM_SAS;
+    sa_gvcid_index = &sa_static_gvcid_index;
+    return status;
+}
+
+/**
+ * @brief Function: sa_static_owns
+ * @param ptr: const void*
+ * @return uint8: 1 if ptr is static storage or a generated map page rather than a heap block
+ **/
+static uint8_t sa_static_owns(const void* ptr)
+{
+    const uint8_t* p = (const uint8_t*)ptr;
+
+    if ((ptr == sa_static_chunks) || (ptr == &sa_static_gvcid_index))
+    {
+        return 1;
+    }
+    if ((p >= (const uint8_t*)sa_static_slots) && (p < (const uint8_t*)sa_static_slots + sizeof(sa_static_slots)))
+    {
+        return 1;
+    }
+    return (p >= (const uint8_t*)crypto_static_sa_slot_pages) &&
+           (p < (const uint8_t*)crypto_static_sa_slot_pages + sizeof(crypto_static_sa_slot_pages));
+}
+#endif
+
+/*
+** Published SA Version Functions
+** Frames read an SA without a lock. While an SDLS procedure changes one, readers are handed the slot's shadow copy
+** instead, and the change only becomes visible once Crypto_Epoch_Synchronize says no frame still holds the version
+** it replaces, so a frame never sees a half rekeyed or half stopped SA.
+*/
+/**
+ * @brief Function: sa_slot_current
+ * @param entry: sa_slot_t*
+ * @return SecurityAssociation_t*: The version of the SA frames are given
+ **/
+static SecurityAssociation_t* sa_slot_current(sa_slot_t* entry)
+{
+    return __atomic_load_n(&entry->published_shadow, __ATOMIC_ACQUIRE) ? &entry->shadow : &entry->sa;
+}
+
+/**
+ * @brief Function: sa_version_open
+ * Starts a change to the SA in a slot. The change is made once frames are waited off the returned version, then
+ * handed to frames by sa_version_publish, sa_version_commit and sa_version_close, each after the wait before it;
+ * sa_provision_group runs these steps for a group of slots at once.
+ * @param slot: uint16
+ * @param synchronize: uint8*, set if frames must be waited off the returned version before it is changed
+ * @return SecurityAssociation_t*: The version to change
+ **/
+static SecurityAssociation_t* sa_version_open(uint16_t slot, uint8_t* synchronize)
+{
+    sa_slot_t* entry = &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE];
+
+    entry->shadow = entry->sa;
+    entry->shadow.abm = NULL;
+    entry->shadow.abm_idx = 0;
+    if (entry->sa.abm != NULL)
+    {
+        // The shadow holds its own reference so either copy can let go of the mask first
+        Crypto_SA_Set_ABM(&entry->shadow, entry->sa.abm, ABM_SIZE);
+        entry->shadow.abm_len = entry->sa.abm_len;
+    }
+
+    if (entry->sa.sa_state == SA_OPERATIONAL)
+    {
+        // Frames are advancing the counters in sa, change the copy and publish it whole
+        return &entry->shadow;
+    }
+    __atomic_store_n(&entry->published_shadow, 1, __ATOMIC_RELEASE);
+    *synchronize = 1;
+    return &entry->sa;
+}
+
+/**
+ * @brief Function: sa_version_publish
+ * Hands frames the changed shadow, if the change was made to it. The counters frames advanced in sa since
+ * sa_version_open are carried into the shadow first, under the SA's frame lock, so they never go backwards.
+ * @param slot: uint16
+ * @param counters_set: uint8, the change set the IV and ARSN
+ * @return uint8: 1 if the shadow was published, frames must be waited off sa before sa_version_commit
+ **/
+static uint8_t sa_version_publish(uint16_t slot, uint8_t counters_set)
+{
+    sa_slot_t* entry = &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE];
+    uint8_t locked;
+
+    if (entry->published_shadow)
+    {
+        return 0;
+    }
+    locked = Crypto_SA_Lock_Other(entry->spi);
+    if (!counters_set)
+    {
+        sa_version_carry_counters(&entry->shadow, &entry->sa);
+    }
+    __atomic_store_n(&entry->published_shadow, 1, __ATOMIC_RELEASE);
+    Crypto_SA_Unlock_Other(entry->spi, locked);
+    return 1;
+}
+
+/**
+ * @brief Function: sa_version_commit
+ * Brings sa up to date with a changed shadow and hands frames sa again. Frames must then be waited off the shadow
+ * before sa_version_close.
+ * @param slot: uint16
+ * @param shadow_changed: uint8, as returned by sa_version_publish
+ * @param counters_set: uint8, the change set the IV and ARSN
+ **/
+static void sa_version_commit(uint16_t slot, uint8_t shadow_changed, uint8_t counters_set)
+{
+    sa_slot_t* entry = &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE];
+    SecurityAssociation_t* home = &entry->sa;
+    SecurityAssociation_t* shadow = &entry->shadow;
+    uint8_t locked;
+
+    // Frames are advancing the shadow's counters until sa is handed back
+    locked = Crypto_SA_Lock_Other(entry->spi);
+    if (shadow_changed)
+    {
+        if (!counters_set)
+        {
+            sa_version_carry_counters(shadow, home);
+        }
+        Crypto_SA_Release_ABM(home);
+        *home = *shadow;
+        home->abm = NULL;
+        home->abm_idx = 0;
+        if (shadow->abm != NULL)
+        {
+            Crypto_SA_Set_ABM(home, shadow->abm, ABM_SIZE);
+            home->abm_len = shadow->abm_len;
+        }
+    }
+    else if (!counters_set)
+    {
+        sa_version_carry_counters(home, shadow);
+    }
+    __atomic_store_n(&entry->published_shadow, 0, __ATOMIC_RELEASE);
+    Crypto_SA_Unlock_Other(entry->spi, locked);
+}
+
+/**
+ * @brief Function: sa_version_close
+ * Finishes the change once no frame holds the shadow. Frames that still had the shadow after sa_version_commit may
+ * have advanced its counters, so sa keeps the higher of the two.
+ * @param slot: uint16
+ * @param shadow_changed: uint8, as returned by sa_version_publish
+ * @param counters_set: uint8, the change set the IV and ARSN
+ **/
+static void sa_version_close(uint16_t slot, uint8_t shadow_changed, uint8_t counters_set)
+{
+    sa_slot_t* entry = &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE];
+    uint8_t locked;
+
+    // A change made to sa itself left the shadow with the counters it replaced
+    if (shadow_changed || !counters_set)
+    {
+        locked = Crypto_SA_Lock_Other(entry->spi);
+        sa_version_carry_counters(&entry->sa, &entry->shadow);
+        Crypto_SA_Unlock_Other(entry->spi, locked);
+    }
+    Crypto_SA_Release_ABM(&entry->shadow);
+}
+
+/**
+ * @brief Function: sa_version_carry_counters
+ * Raises the IV and ARSN in dst to those in src where src's are further on. Counters are big endian.
+ * @param dst: SecurityAssociation_t*
+ * @param src: const SecurityAssociation_t*
+ **/
+static void sa_version_carry_counters(SecurityAssociation_t* dst, const SecurityAssociation_t* src)
+{
+    if (memcmp(src->iv, dst->iv, dst->iv_len) > 0)
+    {
+        memcpy(dst->iv, src->iv, dst->iv_len);
+    }
+    if (memcmp(src->arsn, dst->arsn, dst->arsn_len) > 0)
+    {
+        memcpy(dst->arsn, src->arsn, dst->arsn_len);
+    }
+}
+
+/*
+** Operational SA Index Functions
+*/
+/**
+ * @brief Function: sa_gvcid_index_hash
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param size: uint32, buckets in the index, a power of two
+ * @return uint16: Bucket
+ * @note MapID is not hashed; whether it must match depends on crypto_config.unique_sa_per_mapid at lookup time
+ * @note support/scripts/crypto_static_config.py lays out the generated index with the same hash
+ **/
+static uint16_t sa_gvcid_index_hash(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint32_t size)
+{
+    uint32_t key = ((uint32_t)tfvn << 26) ^ ((uint32_t)scid << 6) ^ (uint32_t)vcid;
+    key = key * 2654435761u; // Knuth multiplicative hash
+    return (uint16_t)((key >> 16) & (size - 1));
+}
+
+/**
+ * @brief Function: sa_gvcid_index_alloc
+ * @param size: uint32, buckets, a power of two
+ * @return sa_gvcid_index_t*: Empty index with room for as many slots as buckets, NULL if out of memory
+ **/
+static sa_gvcid_index_t* sa_gvcid_index_alloc(uint32_t size)
+{
+    sa_gvcid_index_t* index = (sa_gvcid_index_t*)malloc(sizeof(sa_gvcid_index_t) + 4 * size * sizeof(uint16_t));
+    uint32_t i;
+
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    index->size = size;
+    index->buckets = (uint16_t*)(index + 1);
+    index->next = index->buckets + size;
+    index->bucket = index->next + size;
+    index->loose = index->bucket + size;
+    index->num_loose = 0;
+    for (i = 0; i < 4 * size; i++)
+    {
+        index->buckets[i] = SA_SLOT_NONE;
+    }
+    return index;
+}
+
+/**
+ * @brief Function: sa_gvcid_index_target
+ * @param index: const sa_gvcid_index_t*
+ * @param slot: uint16
+ * @return uint16: Bucket the slot's SA belongs in given its current state and GVCID, SA_SLOT_NONE if not operational
+ **/
+static uint16_t sa_gvcid_index_target(const sa_gvcid_index_t* index, uint16_t slot)
+{
+    sa_slot_t* entry = &sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE];
+    SecurityAssociation_t* sa_ptr = sa_slot_current(entry);
+
+    if (sa_ptr->sa_state != SA_OPERATIONAL)
+    {
+        return SA_SLOT_NONE;
+    }
+    return sa_gvcid_index_hash(sa_ptr->gvcid_blk.tfvn, sa_ptr->gvcid_blk.scid, sa_ptr->gvcid_blk.vcid, index->size);
+}
+
+/**
+ * @brief Function: sa_gvcid_index_link
+ * Links an unlinked slot into a bucket, keeping the chain in ascending SPI order. The slot is filled in before it is
+ * made reachable, so a lookup walking the chain meanwhile either skips it or sees it whole.
+ * @param index: sa_gvcid_index_t*
+ * @param slot: uint16, not linked into index, and no lookup still standing on it
+ * @param bucket: uint16
+ **/
+static void sa_gvcid_index_link(sa_gvcid_index_t* index, uint16_t slot, uint16_t bucket)
+{
+    uint16_t spi = sa_chunks[slot / SA_TABLE_CHUNK_SIZE][slot % SA_TABLE_CHUNK_SIZE].spi;
+    uint16_t* link = &index->buckets[bucket];
+
+    while (*link != SA_SLOT_NONE && sa_chunks[*link / SA_TABLE_CHUNK_SIZE][*link % SA_TABLE_CHUNK_SIZE].spi < spi)
+    {
+        link = &index->next[*link];
+    }
+    index->next[slot] = *link;
+    __atomic_store_n(&index->bucket[slot], bucket, __ATOMIC_RELAXED);
+    __atomic_store_n(link, slot, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: sa_gvcid_index_publish
+ * Swaps in a new index. A lookup loads the index once, so it walks either the old one or the new one from start to
+ * end; the old one is freed once no frame can still be walking it.
+ * @param index: sa_gvcid_index_t*
+ **/
+static void sa_gvcid_index_publish(sa_gvcid_index_t* index)
+{
+    sa_gvcid_index_t* old = sa_gvcid_index;
+
+    __atomic_store_n(&sa_gvcid_index, index, __ATOMIC_RELEASE);
+    if (old == NULL)
+    {
+        return;
+    }
+#ifdef CRYPTO_STATIC_CONFIG
+    if (sa_static_owns(old))
+    {
+        return;
+    }
+#endif
+    if (crypto_config.thread_safe == CRYPTO_THREAD_SAFE_TRUE)
+    {
+        Crypto_Epoch_Retire(old, free);
+    }
+    else
+    {
+        free(old);
+    }
+}
+
+/**
+ * @brief Function: sa_gvcid_index_update
+ * Links a slot where its SA's current state and GVCID put it, or unlinks it. Unlinking is done in place. Linking in
+ * place would rewrite the slot's next link under any lookup still standing on the slot and send it down the wrong
+ * chain, so unless the caller has waited those lookups out the slot is linked into a copy of the index instead.
+ * @param slot: uint16
+ * @param quiesced: uint8, the slot was unlinked before the caller's last Crypto_Epoch_Synchronize
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_gvcid_index_update(uint16_t slot, uint8_t quiesced)
+{
+    sa_gvcid_index_t* index = sa_gvcid_index;
+    uint16_t bucket = sa_gvcid_index_target(index, slot);
+
+    if (bucket == index->bucket[slot])
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    if (index->bucket[slot] != SA_SLOT_NONE)
+    {
+        sa_gvcid_index_remove(slot);
+        quiesced = 0;
+    }
+    if (bucket == SA_SLOT_NONE)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    if (quiesced)
+    {
+        sa_gvcid_index_link(index, slot, bucket);
+        return CRYPTO_LIB_SUCCESS;
+    }
+
+    index = sa_gvcid_index_alloc(sa_gvcid_index->size);
+    if (index == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    memcpy(index->buckets, sa_gvcid_index->buckets, 4 * index->size * sizeof(uint16_t));
+    index->num_loose = sa_gvcid_index->num_loose;
+    sa_gvcid_index_link(index, slot, bucket);
+    sa_gvcid_index_publish(index);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_gvcid_index_remove
+ * Unlinks a slot from the published index in place. The slot keeps its next link, so a lookup standing on it walks
+ * on down the rest of the chain.
+ * @param slot: uint16
+ **/
+static void sa_gvcid_index_remove(uint16_t slot)
+{
+    sa_gvcid_index_t* index = sa_gvcid_index;
+    uint16_t* link;
+
+    if (index->bucket[slot] == SA_SLOT_NONE)
+    {
+        return;
+    }
+
+    link = &index->buckets[index->bucket[slot]];
+    while (*link != SA_SLOT_NONE && *link != slot)
+    {
+        link = &index->next[*link];
+    }
+    if (*link == slot)
+    {
+        __atomic_store_n(link, index->next[slot], __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&index->bucket[slot], SA_SLOT_NONE, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Function: sa_gvcid_index_rebuild
+ * Indexes every operational SA in the table into a new index, growing it with the table, and publishes it.
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_gvcid_index_rebuild(void)
+{
+    uint32_t size = SA_GVCID_INDEX_MIN_SIZE;
+    sa_gvcid_index_t* index;
+    uint16_t bucket;
+    uint32_t i;
+
+    while (size < sa_num_slots)
+    {
+        size <<= 1;
+    }
+    index = sa_gvcid_index_alloc(size);
+    if (index == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    for (i = 0; i < sa_num_slots; i++)
+    {
+        bucket = sa_gvcid_index_target(index, i);
+        if (bucket != SA_SLOT_NONE)
+        {
+            sa_gvcid_index_link(index, i, bucket);
+        }
+        if (sa_chunks[i / SA_TABLE_CHUNK_SIZE][i % SA_TABLE_CHUNK_SIZE].handed_out)
+        {
+            index->loose[index->num_loose++] = (uint16_t)i;
+        }
+    }
+    sa_gvcid_index_publish(index);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_gvcid_index_stale
+ * @param slot: uint16
+ * @return uint8: 1 if the slot is not linked where its SA's current state and GVCID put it, e.g. after the SA was
+ * changed through the pointer from sa_get_from_spi
+ **/
+static uint8_t sa_gvcid_index_stale(uint16_t slot)
+{
+    const sa_gvcid_index_t* index = __atomic_load_n(&sa_gvcid_index, __ATOMIC_ACQUIRE);
+
+    return (index != NULL) &&
+           (sa_gvcid_index_target(index, slot) != __atomic_load_n(&index->bucket[slot], __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Function: sa_gvcid_index_lock
+ * With thread safety set, SDLS procedures, sa_save_sa and the table growing may change the index from several
+ * threads at once. Lookups never take it.
+ **/
+static void sa_gvcid_index_lock(void)
+{
+    if (crypto_config.thread_safe == CRYPTO_THREAD_SAFE_TRUE)
+    {
+        pthread_mutex_lock(&sa_gvcid_index_mutex);
+    }
+}
+
+/**
+ * @brief Function: sa_gvcid_index_unlock
+ **/
+static void sa_gvcid_index_unlock(void)
+{
+    if (crypto_config.thread_safe == CRYPTO_THREAD_SAFE_TRUE)
+    {
+        pthread_mutex_unlock(&sa_gvcid_index_mutex);
+    }
+}
+
+/**
+ * @brief Function: sa_gvcid_index_find
+ * Walks one bucket chain of the published index without a lock. Slots only ever link to higher SPIs, so the walk
+ * ends even while a writer unlinks a slot under it; a lookup that races a change can at most miss the SA being
+ * changed. Entries are re-checked against the SA itself, so an SA changed since it was indexed is skipped.
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8 // tc only
+ * @param slot: uint16*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_gvcid_index_find(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid, uint16_t* slot)
+{
+    const sa_gvcid_index_t* index = __atomic_load_n(&sa_gvcid_index, __ATOMIC_ACQUIRE);
+    uint16_t i;
+    sa_slot_t* entry;
+    SecurityAssociation_t* sa_ptr;
+
+    if (index == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
+    }
+    i = __atomic_load_n(&index->buckets[sa_gvcid_index_hash(tfvn, scid, vcid, index->size)], __ATOMIC_ACQUIRE);
+    while (i != SA_SLOT_NONE)
+    {
+        entry = &sa_chunks[i / SA_TABLE_CHUNK_SIZE][i % SA_TABLE_CHUNK_SIZE];
+        sa_ptr = sa_slot_current(entry);
+        if ((sa_ptr->gvcid_blk.tfvn == tfvn) && (sa_ptr->gvcid_blk.scid == scid) &&
+            (sa_ptr->gvcid_blk.vcid == vcid) && (sa_ptr->sa_state == SA_OPERATIONAL) &&
+            (crypto_config.unique_sa_per_mapid == TC_UNIQUE_SA_PER_MAP_ID_FALSE ||
+             sa_ptr->gvcid_blk.mapid == mapid))
+             // only require MapID match is unique SA per MapID set (only relevant
+             // when using segmentation hdrs)
+        {
+            *slot = i;
+            return CRYPTO_LIB_SUCCESS;
+        }
+        i = __atomic_load_n(&index->next[i], __ATOMIC_ACQUIRE);
+    }
+    return CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
+}
+
+/**
+ * @brief Function: sa_save_sa
+ * The table is updated in place through the pointer the caller holds, so there is nothing to copy. An SA whose state
+ * or GVCID was changed that way is re-indexed, so the next GVCID lookup finds it.
+ * @param sa: SecurityAssociation_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_save_sa(SecurityAssociation_t* sa)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    uint16_t slot;
+
+    if (sa == NULL)
+    {
+        return SADB_NULL_SA_USED;
+    }
+    if (sa_chunks == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    slot = sa_table_find_slot(sa->spi);
+    // Frames save after every IV and ARSN update; only a changed state or GVCID takes the index lock
+    if ((slot != SA_SLOT_NONE) && sa_gvcid_index_stale(slot))
+    {
+        sa_gvcid_index_lock();
+        status = sa_gvcid_index_update(slot, 0);
+        sa_gvcid_index_unlock();
+    }
+    return status;
+}
+
+/*
+** Security Association Management Services
+*/
+/**
+ * @brief sa_start
+ * @param tc_frame: TC_t
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_start(TC_t* tc_frame)
+{
+    // Local variables
+    uint8_t count = 0;
+    uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
+    SaProvisionOp_t op;
+    crypto_gvcid_t gvcid;
+    int x;
+    int i;
+
+    // Read ingest
+    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+
+    sa_ptr = sa_table_find(spi);
+
+    // Overwrite last PID
+    if (sa_ptr != NULL)
+    {
+        sa_ptr->lpid =
+            (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    }
+
+    // Check SPI exists and in 'Keyed' state
+    if (sa_ptr != NULL)
+    {
+        if (sa_ptr->sa_state == SA_KEYED)
+        {
+            // The GVCIDs are gathered into the operation, which also makes the SA operational
+            memset(&op, 0, SA_PROVISION_OP_SIZE);
+            op.procedure = SA_START;
+            op.spi = spi;
+            op.gvcid = sa_ptr->gvcid_blk;
+            count = 2;
+
+            for (x = 0; x <= ((sdls_frame.pdu.pdu_len - 2) / 4); x++)
+            { // Read in GVCID
+                gvcid.tfvn = (sdls_frame.pdu.data[count] >> 4);
+                gvcid.scid = (sdls_frame.pdu.data[count] << 12) | (sdls_frame.pdu.data[count + 1] << 4) |
+                             (sdls_frame.pdu.data[count + 2] >> 4);
+                gvcid.vcid = (sdls_frame.pdu.data[count + 2] << 4) | (sdls_frame.pdu.data[count + 3] && 0x3F);
+                if (current_managed_parameters->has_segmentation_hdr == TC_HAS_SEGMENT_HDRS)
+                {
+                    gvcid.mapid = (sdls_frame.pdu.data[count + 3]);
+                }
+                else
+                {
+                    gvcid.mapid = 0;
+                }
+
+                // TC
+                if (gvcid.vcid != tc_frame->tc_header.vcid)
+                { // Clear all GVCIDs for provided SPI
+                    if (gvcid.mapid == TYPE_TC)
+                    {
+                        op.gvcid.tfvn = 0;
+                        op.gvcid.scid = 0;
+                        op.gvcid.vcid = 0;
+                        op.gvcid.mapid = 0;
+                    }
+                    // Write channel to SA
+                    if (gvcid.mapid != TYPE_MAP)
+                    { // TC
+                        op.gvcid.tfvn = gvcid.tfvn;
+                        op.gvcid.scid = gvcid.scid;
+                        op.gvcid.mapid = gvcid.mapid;
+                    }
+                    else
+                    {
+                        // TODO: Handle TYPE_MAP
+                    }
+                }
+                // TM
+                if (gvcid.vcid != tm_frame_pri_hdr.vcid) // TODO Check this tm_frame.tm_header.vcid)
+                { // Clear all GVCIDs for provided SPI
+                    if (gvcid.mapid == TYPE_TM)
+                    {
+                        for (i = 0; i < NUM_GVCID; i++)
+                        { // TM
+                            op.gvcid.tfvn = 0;
+                            op.gvcid.scid = 0;
+                            op.gvcid.vcid = 0;
+                            op.gvcid.mapid = 0;
+                        }
+                    }
+                    // Write channel to SA
                     if (gvcid.mapid != TYPE_MAP)
                     { // TM
-                        sa[spi].gvcid_blk.tfvn = gvcid.tfvn; // Hope for the best
-                        sa[spi].gvcid_blk.scid = gvcid.scid; // Hope for the best
-                        sa[spi].gvcid_blk.vcid = gvcid.vcid; // Hope for the best
-                        sa[spi].gvcid_blk.mapid = gvcid.mapid; // Hope for the best
+                        op.gvcid.tfvn = gvcid.tfvn; // Hope for the best
+                        op.gvcid.scid = gvcid.scid; // Hope for the best
+                        op.gvcid.vcid = gvcid.vcid; // Hope for the best
+                        op.gvcid.mapid = gvcid.mapid; // Hope for the best
                     }
                     else
                     {
@@ -707,31 +2236,363 @@ static int32_t sa_start(TC_t* tc_frame)
                 }
 
 #ifdef PDU_DEBUG
-                printf("SPI %d changed to OPERATIONAL state. \n", spi);
-                switch (gvcid.mapid)
-                {
-                case TYPE_TC:
-                    printf("Type TC, ");
-                    break;
-                case TYPE_MAP:
-                    printf("Type MAP, ");
-                    break;
-                case TYPE_TM:
-                    printf("Type TM, ");
-                    break;
-                default:
-                    printf("Type Unknown, ");
-                    break;
-                }
+                printf("SPI %d changed to OPERATIONAL state. \n", spi);
+                switch (gvcid.mapid)
+                {
+                case TYPE_TC:
+                    printf("Type TC, ");
+                    break;
+                case TYPE_MAP:
+                    printf("Type MAP, ");
+                    break;
+                case TYPE_TM:
+                    printf("Type TM, ");
+                    break;
+                default:
+                    printf("Type Unknown, ");
+                    break;
+                }
+#endif
+            }
+            sa_provision(&op, 1);
+        }
+        else
+        {
+            printf(KRED "ERROR: SPI %d is not in the KEYED state.\n" RESET, spi);
+        }
+    }
+    else
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+
+#ifdef DEBUG
+    printf("\t spi = %d \n", spi);
+#endif
+
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_stop
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_stop(void)
+{
+    // Local variables
+    uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
+
+    // Read ingest
+    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+    printf("spi = %d \n", spi);
+
+    sa_ptr = sa_table_find(spi);
+
+    // Overwrite last PID
+    if (sa_ptr != NULL)
+    {
+        sa_ptr->lpid =
+            (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    }
+
+    // Check SPI exists and in 'Active' state
+    if (sa_ptr != NULL)
+    {
+        if (sa_ptr->sa_state == SA_OPERATIONAL)
+        {
+            // Remove all GVC/GMAP IDs and change to keyed state
+            sa_provision_one(SA_STOP, spi, NULL);
+#ifdef PDU_DEBUG
+            printf("SPI %d changed to KEYED state. \n", spi);
+#endif
+        }
+        else
+        {
+            printf(KRED "ERROR: SPI %d is not in the OPERATIONAL state.\n" RESET, spi);
+        }
+    }
+    else
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+
+#ifdef DEBUG
+    printf("\t spi = %d \n", spi);
+#endif
+
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_rekey
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_rekey(void)
+{
+    // Local variables
+    uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
+    SecurityAssociation_t rekey;
+    int count = 0;
+    int x = 0;
+
+    // Read ingest
+    spi = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count + 1];
+    count = count + 2;
+
+    sa_ptr = sa_table_find(spi);
+
+    // Overwrite last PID
+    if (sa_ptr != NULL)
+    {
+        sa_ptr->lpid =
+            (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    }
+
+    // Check SPI exists and in 'Unkeyed' state
+    if (sa_ptr != NULL)
+    {
+        if (sa_ptr->sa_state == SA_UNKEYED)
+        { // Read into a copy, the SA_REKEY operation takes the key and IV from it
+            rekey = *sa_ptr;
+            sa_ptr = &rekey;
+
+            // Encryption Key
+            sa_ptr->ekid = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count + 1];
+            count = count + 2;
+
+            // Authentication Key
+            // sa_ptr->akid = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count+1];
+            // count = count + 2;
+
+            // Anti-Replay Seq Num
+#ifdef PDU_DEBUG
+            printf("SPI %d IV updated to: 0x", spi);
+#endif
+            if (sa_ptr->shivf_len > 0)
+            { // Set IV - authenticated encryption
+                for (x = count; x < (sa_ptr->shivf_len + count); x++)
+                {
+                    // TODO: Uncomment once fixed in ESA implementation
+                    // TODO: Assuming this was fixed...
+                    *(sa_ptr->iv + x - count) = (uint8_t)sdls_frame.pdu.data[x];
+#ifdef PDU_DEBUG
+                    printf("%02x", sdls_frame.pdu.data[x]);
+#endif
+                }
+            }
+            else
+            { // Set SN
+              // TODO
+            }
+#ifdef PDU_DEBUG
+            printf("\n");
+#endif
+
+            // Change to keyed state
+            sa_provision_one(SA_REKEY, spi, &rekey);
+#ifdef PDU_DEBUG
+            printf("SPI %d changed to KEYED state with encrypted Key ID %d. \n", spi, sa_ptr->ekid);
+#endif
+        }
+        else
+        {
+            printf(KRED "ERROR: SPI %d is not in the UNKEYED state.\n" RESET, spi);
+        }
+    }
+    else
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+
+#ifdef DEBUG
+    printf("\t spi  = %d \n", spi);
+    printf("\t ekid = %d \n", sa_ptr->ekid);
+    // printf("\t akid = %d \n", sa_ptr->akid);
+#endif
+
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_expire
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_expire(void)
+{
+    // Local variables
+    uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
+
+    // Read ingest
+    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+    printf("spi = %d \n", spi);
+
+    sa_ptr = sa_table_find(spi);
+
+    // Overwrite last PID
+    if (sa_ptr != NULL)
+    {
+        sa_ptr->lpid =
+            (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    }
+
+    // Check SPI exists and in 'Keyed' state
+    if (sa_ptr != NULL)
+    {
+        if (sa_ptr->sa_state == SA_KEYED)
+        { // Change to 'Unkeyed' state
+            sa_provision_one(SA_EXPIRE, spi, NULL);
+#ifdef PDU_DEBUG
+            printf("SPI %d changed to UNKEYED state. \n", spi);
+#endif
+        }
+        else
+        {
+            printf(KRED "ERROR: SPI %d is not in the KEYED state.\n" RESET, spi);
+        }
+    }
+    else
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_create
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_create(void)
+{
+    // Local variables
+    uint16_t count = 6;
+    uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
+    SecurityAssociation_t new_sa;
+    uint8_t abm[ABM_SIZE];
+    uint16_t abm_len;
+    int x;
+
+    // Read sdls_frame.pdu.data
+    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+    printf("spi = %d \n", spi);
+
+    sa_ptr = sa_table_add(spi);
+    if (sa_ptr == NULL)
+    {
+        printf(KRED "ERROR: No room in the SA table for SPI %d.\n" RESET, spi);
+        return SADB_SA_TABLE_FULL;
+    }
+
+    // Read into a copy that is stored whole by an SA_CREATE operation
+    new_sa = *sa_ptr;
+    sa_ptr = &new_sa;
+    memset(abm, 0, ABM_SIZE);
+    sa_ptr->abm = abm;
+    sa_ptr->abm_idx = 0;
+
+    // Overwrite last PID
+    sa_ptr->lpid =
+        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+
+    // Write SA Configuration
+    sa_ptr->est = ((uint8_t)sdls_frame.pdu.data[2] & 0x80) >> 7;
+    sa_ptr->ast = ((uint8_t)sdls_frame.pdu.data[2] & 0x40) >> 6;
+    sa_ptr->shivf_len = ((uint8_t)sdls_frame.pdu.data[2] & 0x3F);
+    sa_ptr->shsnf_len = ((uint8_t)sdls_frame.pdu.data[3] & 0xFC) >> 2;
+    sa_ptr->shplf_len = ((uint8_t)sdls_frame.pdu.data[3] & 0x03);
+    sa_ptr->stmacf_len = ((uint8_t)sdls_frame.pdu.data[4]);
+    sa_ptr->ecs_len = ((uint8_t)sdls_frame.pdu.data[5]);
+    for (x = 0; x < sa_ptr->ecs_len; x++)
+    {
+        sa_ptr->ecs = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->shivf_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->shivf_len; x++)
+    {
+        sa_ptr->iv[x] = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->acs_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->acs_len; x++)
+    {
+        sa_ptr->acs = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    abm_len = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count + 1];
+    count = count + 2;
+    if ((abm_len > ABM_SIZE) || (count + abm_len > TLV_DATA_SIZE))
+    {
+        printf(KRED "ERROR: ABM length %d does not fit for SPI %d.\n" RESET, abm_len, spi);
+        return CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE;
+    }
+    for (x = 0; x < abm_len; x++)
+    {
+        abm[x] = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->abm_len = abm_len;
+    sa_ptr->arsn_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->arsn_len; x++)
+    {
+        *(sa_ptr->arsn + x) = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->arsnw_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->arsnw_len; x++)
+    {
+        sa_ptr->arsnw = sa_ptr->arsnw | (((uint8_t)sdls_frame.pdu.data[count++]) << (sa_ptr->arsnw_len - x));
+    }
+
+    // TODO: Checks for valid data
+
+    // Set state to unkeyed
+    sa_ptr->sa_state = SA_UNKEYED;
+
+#ifdef PDU_DEBUG
+    Crypto_saPrint(sa_ptr);
+#endif
+
+    return sa_provision_one(SA_CREATE, spi, &new_sa);
+}
+
+/**
+ * @brief Function: sa_delete
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_delete(void)
+{
+    // Local variables
+    uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
+
+    // Read ingest
+    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+    printf("spi = %d \n", spi);
+
+    sa_ptr = sa_table_find(spi);
+
+    // Overwrite last PID
+    if (sa_ptr != NULL)
+    {
+        sa_ptr->lpid =
+            (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    }
+
+    // Check SPI exists and in 'Unkeyed' state
+    if (sa_ptr != NULL)
+    {
+        if (sa_ptr->sa_state == SA_UNKEYED)
+        { // Change to 'None' state
+            sa_provision_one(SA_DELETE, spi, NULL);
+#ifdef PDU_DEBUG
+            printf("SPI %d changed to NONE state. \n", spi);
 #endif
 
-                // Change to operational state
-                sa[spi].sa_state = SA_OPERATIONAL;
-            }
+            // TODO: Zero entire SA
         }
         else
         {
-            printf(KRED "ERROR: SPI %d is not in the KEYED state.\n" RESET, spi);
+            printf(KRED "ERROR: SPI %d is not in the UNKEYED state.\n" RESET, spi);
         }
     }
     else
@@ -739,430 +2600,799 @@ static int32_t sa_start(TC_t* tc_frame)
         printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
     }
 
-#ifdef DEBUG
-    printf("\t spi = %d \n", spi);
-#endif
-
     return CRYPTO_LIB_SUCCESS;
 }
 
 /**
- * @brief Function: sa_stop
+ * @brief Function: sa_setASRN
  * @return int32: Success/Failure
  **/
-static int32_t sa_stop(void)
+static int32_t sa_setARSN(void)
 {
     // Local variables
     uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
     int x;
 
     // Read ingest
     spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
     printf("spi = %d \n", spi);
+    sa_ptr = sa_table_find(spi);
 
-    // Overwrite last PID
-    sa[spi].lpid =
-        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    // TODO: Check SA type (authenticated, encrypted, both) and set appropriately
+    // TODO: Add more checks on bounds
 
-    // Check SPI exists and in 'Active' state
-    if (spi < NUM_SA)
+    // Check SPI exists
+    if (sa_ptr != NULL)
     {
-        if (sa[spi].sa_state == SA_OPERATIONAL)
-        {
-            // Remove all GVC/GMAP IDs
-            sa[spi].gvcid_blk.tfvn = 0;
-            sa[spi].gvcid_blk.scid = 0;
-            sa[spi].gvcid_blk.vcid = 0;
-            sa[spi].gvcid_blk.mapid = 0;
-            for (x = 0; x < NUM_GVCID; x++)
+#ifdef PDU_DEBUG
+        printf("SPI %d IV updated to: 0x", spi);
+#endif
+        if (sa_ptr->shivf_len > 0)
+        { // Set IV - authenticated encryption
+            for (x = 0; x < IV_SIZE; x++)
             {
-                // TM
-                sa[spi].gvcid_blk.tfvn = 0; // TODO REVISIT
-                sa[spi].gvcid_blk.scid = 0; // TODO REVISIT
-                sa[spi].gvcid_blk.vcid = 0; // TODO REVISIT
-                sa[spi].gvcid_blk.mapid = 0; // TODO REVISIT
-            }
-
-            // Change to operational state
-            sa[spi].sa_state = SA_KEYED;
+                *(sa_ptr->iv + x) = (uint8_t)sdls_frame.pdu.data[x + 2];
 #ifdef PDU_DEBUG
-            printf("SPI %d changed to KEYED state. \n", spi);
+                printf("%02x", *(sa_ptr->iv + x));
 #endif
+            }
+            Crypto_increment(sa_ptr->iv, sa_ptr->shivf_len);
         }
         else
-        {
-            printf(KRED "ERROR: SPI %d is not in the OPERATIONAL state.\n" RESET, spi);
+        { // Set SN
+          // TODO
         }
+#ifdef PDU_DEBUG
+        printf("\n");
+#endif
     }
     else
     {
-        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+        printf("sa_setARSN ERROR: SPI %d does not exist.\n", spi);
     }
 
-#ifdef DEBUG
-    printf("\t spi = %d \n", spi);
-#endif
-
     return CRYPTO_LIB_SUCCESS;
 }
 
 /**
- * @brief Function: sa_rekey
+ * @brief Function: sa_setARSNW
  * @return int32: Success/Failure
  **/
-static int32_t sa_rekey(void)
+static int32_t sa_setARSNW(void)
 {
     // Local variables
     uint16_t spi = 0x0000;
-    int count = 0;
-    int x = 0;
+    SecurityAssociation_t* sa_ptr = NULL;
+    int x;
 
     // Read ingest
-    spi = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count + 1];
-    count = count + 2;
+    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+    printf("spi = %d \n", spi);
+    sa_ptr = sa_table_find(spi);
 
-    // Overwrite last PID
-    sa[spi].lpid =
-        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+    // Check SPI exists
+    if (sa_ptr != NULL)
+    {
+        sa_ptr->arsnw_len = (uint8_t)sdls_frame.pdu.data[2];
 
-    // Check SPI exists and in 'Unkeyed' state
-    if (spi < NUM_SA)
+        // Check for out of bounds
+        if (sa_ptr->arsnw_len > (ARSN_SIZE))
+        {
+            sa_ptr->arsnw_len = ARSN_SIZE;
+        }
+
+        for (x = 0; x < sa_ptr->arsnw_len; x++)
+        {
+            sa_ptr->arsnw = (((uint8_t)sdls_frame.pdu.data[x + 3]) << (sa_ptr->arsnw_len - x));
+        }
+    }
+    else
     {
-        if (sa[spi].sa_state == SA_UNKEYED)
-        { // Encryption Key
-            sa[spi].ekid = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count + 1];
-            count = count + 2;
+        printf("sa_setARSNW ERROR: SPI %d does not exist.\n", spi);
+    }
 
-            // Authentication Key
-            // sa[spi].akid = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count+1];
-            // count = count + 2;
+    return CRYPTO_LIB_SUCCESS;
+}
 
-            // Anti-Replay Seq Num
-#ifdef PDU_DEBUG
-            printf("SPI %d IV updated to: 0x", spi);
-#endif
-            if (sa[spi].shivf_len > 0)
-            { // Set IV - authenticated encryption
-                for (x = count; x < (sa[spi].shivf_len + count); x++)
-                {
-                    // TODO: Uncomment once fixed in ESA implementation
-                    // TODO: Assuming this was fixed...
-                    *(sa[spi].iv + x - count) = (uint8_t)sdls_frame.pdu.data[x];
-#ifdef PDU_DEBUG
-                    printf("%02x", sdls_frame.pdu.data[x]);
-#endif
-                }
-            }
-            else
-            { // Set SN
-              // TODO
-            }
-#ifdef PDU_DEBUG
-            printf("\n");
+/**
+ * @brief Function: sa_status
+ * @param ingest: uint8_t*
+ * @return int32: count
+ **/
+static int32_t sa_status(uint8_t* ingest)
+{
+    if(ingest == NULL) return CRYPTO_LIB_ERROR;
+    
+    // Local variables
+    int count = 0;
+    uint16_t spi = 0x0000;
+    SecurityAssociation_t* sa_ptr = NULL;
+
+    // Read ingest
+    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+    printf("spi = %d \n", spi);
+    sa_ptr = sa_table_find(spi);
+
+    // Check SPI exists
+    if (sa_ptr != NULL)
+    {
+        // Prepare for Reply
+        sdls_frame.pdu.pdu_len = 3;
+        sdls_frame.hdr.pkt_length = sdls_frame.pdu.pdu_len + 9;
+        count = Crypto_Prep_Reply(ingest, 128);
+        // PDU
+        ingest[count++] = (spi & 0xFF00) >> 8;
+        ingest[count++] = (spi & 0x00FF);
+        ingest[count++] = sa_ptr->lpid;
+    }
+    else
+    {
+        printf("sa_status ERROR: SPI %d does not exist.\n", spi);
+    }
+
+#ifdef SA_DEBUG
+    if (sa_ptr != NULL)
+    {
+        Crypto_saPrint(sa_ptr);
+    }
 #endif
 
-            // Change to keyed state
-            sa[spi].sa_state = SA_KEYED;
-#ifdef PDU_DEBUG
-            printf("SPI %d changed to KEYED state with encrypted Key ID %d. \n", spi, sa[spi].ekid);
-#endif
-        }
-        else
-        {
-            printf(KRED "ERROR: SPI %d is not in the UNKEYED state.\n" RESET, spi);
-        }
-    }
-    else
+    return count;
+}
+/*
+** Memory-Mapped SA Store Functions
+** SA_TYPE_MMAP keeps the in-memory SA table in a file. Every region of the file is page aligned:
+**   header 0 | header 1 | live state | live table | snapshot 0 | snapshot 1
+** The live table holds the table chunks themselves, so IV and ARSN advances are plain stores into the mapping.
+** A checkpoint copies the live table, the key references and the ABMs into the snapshot of the next generation,
+** msyncs it, then writes and msyncs that snapshot's header. On open, the newest header whose own checksum and
+** snapshot checksum both verify is restored, so a torn checkpoint falls back to the one before it.
+** After an unclean shutdown the counters come from the live table when it survived, i.e. only the process died.
+** Otherwise they come from the snapshot, advanced past the most any SA can have moved since: sa_mmap_save_sa holds
+** frames back once the table is more than twice the checkpoint interval of saves ahead of the last checkpoint.
+*/
+/**
+ * @brief Function: sa_mmap_configure
+ * Loads the default SAs only when the store did not hold any
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_mmap_configure(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if (sa_mmap_recovered)
+    {
+        return status;
+    }
+    status = sa_config();
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_mmap_checkpoint(0);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_mmap_init
+ * Maps the store and restores the last good checkpoint, if any
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_mmap_init(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    sa_mmap_header_t header;
+    uint8_t fresh = 0;
+    int snapshot_idx;
+
+    if (sa_mmap_config->checkpoint_interval == 0)
+    {
+        return CRYPTO_MMAP_CONFIGURATION_NOT_COMPLETE;
+    }
+
+    status = sa_init();
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    sa_mmap_recovered = 0;
+    sa_mmap_generation = 0;
+
+    status = sa_mmap_open(&fresh);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+
+    if (!fresh)
+    {
+        snapshot_idx = sa_mmap_select(&header);
+        if (snapshot_idx < 0)
+        {
+            printf(KRED "ERROR: No valid checkpoint in SA store %s\n" RESET, sa_mmap_config->mmap_path);
+            sa_mmap_unmap();
+            return SADB_MMAP_STORE_CORRUPT;
+        }
+        status = sa_mmap_restore((uint8_t)snapshot_idx, &header, sa_mmap_live_usable());
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            sa_table_release();
+            sa_mmap_unmap();
+            return status;
+        }
+        sa_mmap_recovered = 1;
+    }
+    sa_mmap_live_claim();
+    if (!fresh)
+    {
+        // Mark the store in use, so a crash from here on is recovered as unclean
+        status = sa_mmap_checkpoint(0);
+    }
+
+    sa_mmap_saves = 0;
+    sa_mmap_last_checkpoint_ms = sa_mmap_now_ms();
+    return status;
+}
+
+/**
+ * @brief Function: sa_mmap_close
+ * Writes a clean checkpoint and unmaps the store
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_mmap_close(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if (sa_mmap_base != NULL)
+    {
+        status = sa_mmap_checkpoint(1);
+    }
+    sa_table_release();
+    sa_mmap_unmap();
+    return status;
+}
+
+/**
+ * @brief Function: sa_mmap_save_sa
+ * The SA was already updated in the mapping, this only decides whether a checkpoint is due
+ * @param sa: SecurityAssociation_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_mmap_save_sa(SecurityAssociation_t* sa)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    uint32_t saves;
+
+    status = sa_save_sa(sa);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    saves = __atomic_add_fetch(&sa_mmap_saves, 1, __ATOMIC_RELAXED);
+    if ((saves >= sa_mmap_config->checkpoint_interval) ||
+        ((sa_mmap_config->checkpoint_interval_ms > 0) &&
+         ((sa_mmap_now_ms() - __atomic_load_n(&sa_mmap_last_checkpoint_ms, __ATOMIC_RELAXED)) >=
+          sa_mmap_config->checkpoint_interval_ms)))
+    {
+        // A frame holds its SA's stripe here, so it must not wait behind a checkpoint that may be waiting on that
+        // stripe. A checkpoint already being written still counts this save, the next one after it is due soon.
+        if (pthread_mutex_trylock(&sa_mmap_mutex) == 0)
+        {
+            status = sa_mmap_checkpoint(0);
+            pthread_mutex_unlock(&sa_mmap_mutex);
+        }
+        else if (saves > 2 * sa_mmap_config->checkpoint_interval)
+        {
+            // Further ahead than sa_mmap_restore skips after a crash, the frame must not go out
+            status = SADB_MMAP_CHECKPOINT_BEHIND;
+        }
+    }
+    return status;
+}
+
+// SDLS management procedures change the table outside of sa_save_sa, checkpoint after each of them
+static int32_t sa_mmap_stop(void)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_stop());
+}
+static int32_t sa_mmap_start(TC_t* tc_frame)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_start(tc_frame));
+}
+static int32_t sa_mmap_expire(void)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_expire());
+}
+static int32_t sa_mmap_rekey(void)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_rekey());
+}
+static int32_t sa_mmap_create(void)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_create());
+}
+static int32_t sa_mmap_setARSN(void)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_setARSN());
+}
+static int32_t sa_mmap_setARSNW(void)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_setARSNW());
+}
+static int32_t sa_mmap_delete(void)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_delete());
+}
+// Counted like a save, so loading a snapshot does not checkpoint the whole table once per SA
+static int32_t sa_mmap_insert(const SecurityAssociation_t* security_association)
+{
+    int32_t status;
+
+    sa_mmap_lock();
+    status = sa_insert(security_association);
+    sa_mmap_unlock();
+    if (status == CRYPTO_LIB_SUCCESS)
     {
-        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+        status = sa_mmap_save_sa(sa_table_find(security_association->spi));
     }
-
-#ifdef DEBUG
-    printf("\t spi  = %d \n", spi);
-    printf("\t ekid = %d \n", sa[spi].ekid);
-    // printf("\t akid = %d \n", sa[spi].akid);
-#endif
-
-    return CRYPTO_LIB_SUCCESS;
+    return status;
+}
+// A batch is checkpointed once, after its last operation
+static int32_t sa_mmap_provision(SaProvisionOp_t* ops, uint32_t num_ops)
+{
+    sa_mmap_lock();
+    return sa_mmap_checkpoint_after(sa_provision(ops, num_ops));
 }
 
 /**
- * @brief Function: sa_expire
+ * @brief Function: sa_mmap_open
+ * Opens and maps the store file, creating and sizing it for the configured capacity if it is new
+ * @param fresh: uint8_t*, set if the file was just created
  * @return int32: Success/Failure
  **/
-static int32_t sa_expire(void)
+static int32_t sa_mmap_open(uint8_t* fresh)
 {
-    // Local variables
-    uint16_t spi = 0x0000;
-
-    // Read ingest
-    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
-    printf("spi = %d \n", spi);
-
-    // Overwrite last PID
-    sa[spi].lpid =
-        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
-
-    // Check SPI exists and in 'Keyed' state
-    if (spi < NUM_SA)
+    struct stat st;
+    size_t size;
+
+    sa_mmap_capacity = ((sa_capacity + SA_TABLE_CHUNK_SIZE - 1) / SA_TABLE_CHUNK_SIZE) * SA_TABLE_CHUNK_SIZE;
+    sa_mmap_live_size = sa_mmap_capacity * (sizeof(sa_slot_t) + sizeof(sa_mmap_key_refs_t));
+    sa_mmap_live_size = ((sa_mmap_live_size + SA_MMAP_PAGE_SIZE - 1) / SA_MMAP_PAGE_SIZE) * SA_MMAP_PAGE_SIZE;
+    sa_mmap_snapshot_size = sa_mmap_capacity * (sizeof(sa_slot_t) + sizeof(sa_mmap_key_refs_t) + ABM_SIZE);
+    sa_mmap_snapshot_size = ((sa_mmap_snapshot_size + SA_MMAP_PAGE_SIZE - 1) / SA_MMAP_PAGE_SIZE) * SA_MMAP_PAGE_SIZE;
+    size = SA_MMAP_LIVE_OFFSET + sa_mmap_live_size + (2 * sa_mmap_snapshot_size);
+
+    sa_mmap_fd = open(sa_mmap_config->mmap_path, O_RDWR | O_CREAT, 0600);
+    if (sa_mmap_fd < 0)
     {
-        if (sa[spi].sa_state == SA_KEYED)
-        { // Change to 'Unkeyed' state
-            sa[spi].sa_state = SA_UNKEYED;
-#ifdef PDU_DEBUG
-            printf("SPI %d changed to UNKEYED state. \n", spi);
-#endif
-        }
-        else
+        printf(KRED "ERROR: Unable to open SA store %s\n" RESET, sa_mmap_config->mmap_path);
+        return SADB_MMAP_OPEN_FAILED;
+    }
+    if (fstat(sa_mmap_fd, &st) != 0)
+    {
+        sa_mmap_unmap();
+        return SADB_MMAP_OPEN_FAILED;
+    }
+    *fresh = (st.st_size == 0);
+    if (*fresh)
+    {
+        if (ftruncate(sa_mmap_fd, (off_t)size) != 0)
         {
-            printf(KRED "ERROR: SPI %d is not in the KEYED state.\n" RESET, spi);
+            sa_mmap_unmap();
+            return SADB_MMAP_OPEN_FAILED;
         }
     }
-    else
+    else if ((size_t)st.st_size != size)
     {
-        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+        printf(KRED "ERROR: SA store %s was created for a different SA capacity or build\n" RESET,
+               sa_mmap_config->mmap_path);
+        sa_mmap_unmap();
+        return SADB_MMAP_STORE_INCOMPATIBLE;
     }
 
+    sa_mmap_base = (uint8_t*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, sa_mmap_fd, 0);
+    if (sa_mmap_base == MAP_FAILED)
+    {
+        sa_mmap_base = NULL;
+        sa_mmap_unmap();
+        return SADB_MMAP_OPEN_FAILED;
+    }
+    sa_mmap_size = size;
     return CRYPTO_LIB_SUCCESS;
 }
 
 /**
- * @brief Function: sa_create
- * @return int32: Success/Failure
+ * @brief Function: sa_mmap_unmap
  **/
-static int32_t sa_create(void)
+static void sa_mmap_unmap(void)
 {
-    // Local variables
-    uint8_t count = 6;
-    uint16_t spi = 0x0000;
-    int x;
-
-    // Read sdls_frame.pdu.data
-    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
-    printf("spi = %d \n", spi);
-
-    // Overwrite last PID
-    sa[spi].lpid =
-        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
-
-    // Write SA Configuration
-    sa[spi].est = ((uint8_t)sdls_frame.pdu.data[2] & 0x80) >> 7;
-    sa[spi].ast = ((uint8_t)sdls_frame.pdu.data[2] & 0x40) >> 6;
-    sa[spi].shivf_len = ((uint8_t)sdls_frame.pdu.data[2] & 0x3F);
-    sa[spi].shsnf_len = ((uint8_t)sdls_frame.pdu.data[3] & 0xFC) >> 2;
-    sa[spi].shplf_len = ((uint8_t)sdls_frame.pdu.data[3] & 0x03);
-    sa[spi].stmacf_len = ((uint8_t)sdls_frame.pdu.data[4]);
-    sa[spi].ecs_len = ((uint8_t)sdls_frame.pdu.data[5]);
-    for (x = 0; x < sa[spi].ecs_len; x++)
+    if (sa_mmap_base != NULL)
     {
-        sa[spi].ecs = ((uint8_t)sdls_frame.pdu.data[count++]);
+        munmap(sa_mmap_base, sa_mmap_size);
+        sa_mmap_base = NULL;
+        sa_mmap_size = 0;
     }
-    sa[spi].shivf_len = ((uint8_t)sdls_frame.pdu.data[count++]);
-    for (x = 0; x < sa[spi].shivf_len; x++)
+    if (sa_mmap_fd >= 0)
     {
-        sa[spi].iv[x] = ((uint8_t)sdls_frame.pdu.data[count++]);
+        close(sa_mmap_fd);
+        sa_mmap_fd = -1;
     }
-    sa[spi].acs_len = ((uint8_t)sdls_frame.pdu.data[count++]);
-    for (x = 0; x < sa[spi].acs_len; x++)
+}
+
+/**
+ * @brief Function: sa_mmap_select
+ * Finds the newest checkpoint whose header and snapshot both verify
+ * @param header: sa_mmap_header_t*, receives the chosen header
+ * @return int: Snapshot index, -1 if there is none
+ **/
+static int sa_mmap_select(sa_mmap_header_t* header)
+{
+    sa_mmap_header_t candidate;
+    const uint8_t* snapshot;
+    uint32_t crc;
+    int selected = -1;
+    int i;
+
+    for (i = 0; i < 2; i++)
     {
-        sa[spi].acs = ((uint8_t)sdls_frame.pdu.data[count++]);
+        memcpy(&candidate, sa_mmap_base + (i * SA_MMAP_PAGE_SIZE), sizeof(sa_mmap_header_t));
+        if ((candidate.magic != SA_MMAP_MAGIC) || (candidate.version != SA_MMAP_VERSION) ||
+            (candidate.abm_size != ABM_SIZE) || (candidate.slot_size != sizeof(sa_slot_t)) ||
+            (candidate.capacity != sa_mmap_capacity) || (candidate.num_slots > sa_mmap_capacity) ||
+            ((candidate.generation % 2) != (uint64_t)i) ||
+            (candidate.header_crc != sa_mmap_crc32(&candidate, offsetof(sa_mmap_header_t, header_crc), 0)))
+        {
+            continue;
+        }
+
+        snapshot = sa_mmap_base + SA_MMAP_LIVE_OFFSET + sa_mmap_live_size + (i * sa_mmap_snapshot_size);
+        crc = sa_mmap_crc32(snapshot, candidate.num_slots * sizeof(sa_slot_t), 0);
+        crc = sa_mmap_crc32(snapshot + (sa_mmap_capacity * sizeof(sa_slot_t)),
+                            candidate.num_slots * sizeof(sa_mmap_key_refs_t), crc);
+        crc = sa_mmap_crc32(snapshot + (sa_mmap_capacity * (sizeof(sa_slot_t) + sizeof(sa_mmap_key_refs_t))),
+                            candidate.num_slots * ABM_SIZE, crc);
+        if (crc != candidate.snapshot_crc)
+        {
+#ifdef SA_DEBUG
+            printf("SA store checkpoint %lu is torn, ignoring it\n", (unsigned long)candidate.generation);
+#endif
+            continue;
+        }
+
+        if ((selected < 0) || (candidate.generation > header->generation))
+        {
+            memcpy(header, &candidate, sizeof(sa_mmap_header_t));
+            selected = i;
+        }
     }
-    sa[spi].abm_len = (uint8_t)((sdls_frame.pdu.data[count] << 8) | (sdls_frame.pdu.data[count + 1]));
-    count = count + 2;
-    for (x = 0; x < sa[spi].abm_len; x++)
+    return selected;
+}
+
+/**
+ * @brief Function: sa_mmap_restore
+ * Rebuilds the SA table from a snapshot. After an unclean shutdown the live table may have been ahead of the
+ * snapshot. If it is usable each SA keeps its counters from it, otherwise IVs and ARSNs are advanced by twice the
+ * checkpoint interval, the furthest sa_mmap_save_sa lets frames get ahead of a checkpoint.
+ * @param snapshot_idx: uint8_t
+ * @param header: const sa_mmap_header_t*
+ * @param live_usable: uint8_t, see sa_mmap_live_usable
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_mmap_restore(uint8_t snapshot_idx, const sa_mmap_header_t* header, uint8_t live_usable)
+{
+    uint8_t* snapshot = sa_mmap_base + SA_MMAP_LIVE_OFFSET + sa_mmap_live_size + (snapshot_idx * sa_mmap_snapshot_size);
+    const sa_mmap_key_refs_t* snapshot_refs = (const sa_mmap_key_refs_t*)(snapshot + (sa_mmap_capacity * sizeof(sa_slot_t)));
+    const uint8_t* snapshot_abms = (const uint8_t*)(snapshot_refs + sa_mmap_capacity);
+    sa_slot_t* live = (sa_slot_t*)(sa_mmap_base + SA_MMAP_LIVE_OFFSET);
+    sa_mmap_key_refs_t* live_refs = (sa_mmap_key_refs_t*)(live + sa_mmap_capacity);
+    uint16_t num_chunks = (uint16_t)((header->num_slots + SA_TABLE_CHUNK_SIZE - 1) / SA_TABLE_CHUNK_SIZE);
+    const sa_slot_t* snapshot_slots = (const sa_slot_t*)snapshot;
+    SecurityAssociation_t* sa_ptr;
+    SecurityAssociation_t counters;
+    uint8_t keep_counters;
+    uint32_t i;
+
+    for (i = 0; i < header->num_slots; i++)
     {
-        sa[spi].abm[x] = ((uint8_t)sdls_frame.pdu.data[count++]);
+        // Readers were given shadow while it was published, frames advanced its counters
+        keep_counters = !header->clean && live_usable && (live[i].spi == snapshot_slots[i].spi);
+        if (keep_counters)
+        {
+            memcpy(&counters, live[i].published_shadow ? &live[i].shadow : &live[i].sa, sizeof(counters));
+        }
+        memcpy(&live[i], &snapshot_slots[i], sizeof(sa_slot_t));
+        if (keep_counters && (counters.iv_len == live[i].sa.iv_len) && (counters.arsn_len == live[i].sa.arsn_len))
+        {
+            memcpy(live[i].sa.iv, counters.iv, IV_SIZE);
+            memcpy(live[i].sa.arsn, counters.arsn, ARSN_SIZE);
+        }
+        else if (!header->clean)
+        {
+            sa_mmap_advance(live[i].sa.iv, (live[i].sa.iv_len < IV_SIZE) ? live[i].sa.iv_len : IV_SIZE,
+                            2 * sa_mmap_config->checkpoint_interval);
+            sa_mmap_advance(live[i].sa.arsn, (live[i].sa.arsn_len < ARSN_SIZE) ? live[i].sa.arsn_len : ARSN_SIZE,
+                            2 * sa_mmap_config->checkpoint_interval);
+        }
     }
-    sa[spi].arsn_len = ((uint8_t)sdls_frame.pdu.data[count++]);
-    for (x = 0; x < sa[spi].arsn_len; x++)
+    memset(&live[header->num_slots], 0, ((uint32_t)num_chunks * SA_TABLE_CHUNK_SIZE - header->num_slots) * sizeof(sa_slot_t));
+    memcpy(live_refs, snapshot_refs, header->num_slots * sizeof(sa_mmap_key_refs_t));
+
+    if (num_chunks > 0)
     {
-        *(sa[spi].arsn + x) = ((uint8_t)sdls_frame.pdu.data[count++]);
+        sa_chunks = (sa_slot_t**)malloc(num_chunks * sizeof(sa_slot_t*));
+        if (sa_chunks == NULL)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
     }
-    sa[spi].arsnw_len = ((uint8_t)sdls_frame.pdu.data[count++]);
-    for (x = 0; x < sa[spi].arsnw_len; x++)
+    for (i = 0; i < num_chunks; i++)
     {
-        sa[spi].arsnw = sa[spi].arsnw | (((uint8_t)sdls_frame.pdu.data[count++]) << (sa[spi].arsnw_len - x));
+        sa_chunks[i] = &live[i * SA_TABLE_CHUNK_SIZE];
     }
+    sa_num_chunks = num_chunks;
 
-    // TODO: Checks for valid data
-
-    // Set state to unkeyed
-    sa[spi].sa_state = SA_UNKEYED;
+    for (i = 0; i < header->num_slots; i++)
+    {
+        // Pointers in the snapshot belong to the process that wrote it
+        sa_ptr = &live[i].sa;
+        memset(&live[i].shadow, 0, sizeof(live[i].shadow));
+        live[i].published_shadow = 0;
+        sa_ptr->abm = NULL;
+        sa_ptr->abm_idx = 0;
+        sa_ptr->ek_ref = (live_refs[i].ek_ref[0] != '\0') ? live_refs[i].ek_ref : NULL;
+        sa_ptr->ak_ref = (live_refs[i].ak_ref[0] != '\0') ? live_refs[i].ak_ref : NULL;
+        sa_num_slots = i + 1;
+        if ((Crypto_SA_Set_ABM(sa_ptr, &snapshot_abms[i * ABM_SIZE], sa_ptr->abm_len) != CRYPTO_LIB_SUCCESS) ||
+            (sa_table_map_spi(live[i].spi, (uint16_t)i) != CRYPTO_LIB_SUCCESS))
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+    }
+    sa_mmap_generation = header->generation;
 
-#ifdef PDU_DEBUG
-    Crypto_saPrint(&sa[spi]);
+#ifdef SA_DEBUG
+    printf("Restored %d SAs from SA store checkpoint %lu (%s)\n", header->num_slots, (unsigned long)header->generation,
+           header->clean ? "clean" : (live_usable ? "unclean, live counters" : "unclean, counters advanced"));
 #endif
-
-    return CRYPTO_LIB_SUCCESS;
+    return sa_gvcid_index_rebuild();
 }
 
 /**
- * @brief Function: sa_delete
+ * @brief Function: sa_mmap_checkpoint
+ * Writes the current table to the next snapshot and publishes it through its header
+ * @param clean: uint8_t, set by sa_close
  * @return int32: Success/Failure
  **/
-static int32_t sa_delete(void)
+static int32_t sa_mmap_checkpoint(uint8_t clean)
 {
-    // Local variables
-    uint16_t spi = 0x0000;
-
-    // Read ingest
-    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
-    printf("spi = %d \n", spi);
-
-    // Overwrite last PID
-    sa[spi].lpid =
-        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
-
-    // Check SPI exists and in 'Unkeyed' state
-    if (spi < NUM_SA)
+    uint8_t next = (uint8_t)((sa_mmap_generation + 1) % 2);
+    uint8_t* snapshot = sa_mmap_base + SA_MMAP_LIVE_OFFSET + sa_mmap_live_size + (next * sa_mmap_snapshot_size);
+    sa_slot_t* snapshot_slots = (sa_slot_t*)snapshot;
+    sa_mmap_key_refs_t* snapshot_refs = (sa_mmap_key_refs_t*)(snapshot_slots + sa_mmap_capacity);
+    uint8_t* snapshot_abms = (uint8_t*)(snapshot_refs + sa_mmap_capacity);
+    uint8_t* header_page = sa_mmap_base + (next * SA_MMAP_PAGE_SIZE);
+    sa_mmap_header_t header;
+    sa_slot_t* entry;
+    uint32_t saves = __atomic_load_n(&sa_mmap_saves, __ATOMIC_RELAXED);
+    uint32_t crc;
+    uint32_t i;
+    uint8_t locked;
+
+    for (i = 0; i < sa_num_slots; i++)
     {
-        if (sa[spi].sa_state == SA_UNKEYED)
-        { // Change to 'None' state
-            sa[spi].sa_state = SA_NONE;
-#ifdef PDU_DEBUG
-            printf("SPI %d changed to NONE state. \n", spi);
-#endif
-
-            // TODO: Zero entire SA
+        entry = &sa_chunks[i / SA_TABLE_CHUNK_SIZE][i % SA_TABLE_CHUNK_SIZE];
+        // Frames on other threads may be advancing the counters, copy them between frames
+        locked = Crypto_SA_Lock_Other(entry->spi);
+        memcpy(&snapshot_slots[i], entry, sizeof(sa_slot_t));
+        Crypto_SA_Unlock_Other(entry->spi, locked);
+        memset(&snapshot_refs[i], 0, sizeof(sa_mmap_key_refs_t));
+        if (entry->sa.ek_ref != NULL)
+        {
+            strncpy(snapshot_refs[i].ek_ref, entry->sa.ek_ref, SA_MMAP_KEY_REF_SIZE - 1);
+        }
+        if (entry->sa.ak_ref != NULL)
+        {
+            strncpy(snapshot_refs[i].ak_ref, entry->sa.ak_ref, SA_MMAP_KEY_REF_SIZE - 1);
+        }
+        if (entry->sa.abm != NULL)
+        {
+            memcpy(&snapshot_abms[i * ABM_SIZE], entry->sa.abm, ABM_SIZE);
         }
         else
         {
-            printf(KRED "ERROR: SPI %d is not in the UNKEYED state.\n" RESET, spi);
+            memset(&snapshot_abms[i * ABM_SIZE], 0, ABM_SIZE);
         }
     }
-    else
+    crc = sa_mmap_crc32(snapshot_slots, sa_num_slots * sizeof(sa_slot_t), 0);
+    crc = sa_mmap_crc32(snapshot_refs, sa_num_slots * sizeof(sa_mmap_key_refs_t), crc);
+    crc = sa_mmap_crc32(snapshot_abms, sa_num_slots * ABM_SIZE, crc);
+    if (msync(snapshot, sa_mmap_snapshot_size, MS_SYNC) != 0)
     {
-        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+        return SADB_MMAP_SYNC_FAILED;
+    }
+
+    memset(&header, 0, sizeof(sa_mmap_header_t));
+    header.magic = SA_MMAP_MAGIC;
+    header.version = SA_MMAP_VERSION;
+    header.abm_size = ABM_SIZE;
+    header.slot_size = sizeof(sa_slot_t);
+    header.capacity = sa_mmap_capacity;
+    header.num_slots = sa_num_slots;
+    header.snapshot_crc = crc;
+    header.generation = sa_mmap_generation + 1;
+    header.clean = clean;
+    header.header_crc = sa_mmap_crc32(&header, offsetof(sa_mmap_header_t, header_crc), 0);
+    memcpy(header_page, &header, sizeof(sa_mmap_header_t));
+    if (msync(header_page, SA_MMAP_PAGE_SIZE, MS_SYNC) != 0)
+    {
+        return SADB_MMAP_SYNC_FAILED;
     }
 
+    sa_mmap_generation++;
+    // Saves counted after the copy started may not be in it, they count towards the next checkpoint
+    __atomic_sub_fetch(&sa_mmap_saves, saves, __ATOMIC_RELAXED);
+    __atomic_store_n(&sa_mmap_last_checkpoint_ms, sa_mmap_now_ms(), __ATOMIC_RELAXED);
     return CRYPTO_LIB_SUCCESS;
 }
 
 /**
- * @brief Function: sa_setASRN
- * @return int32: Success/Failure
+ * @brief Function: sa_mmap_checkpoint_after
+ * Checkpoints and releases the table locked by sa_mmap_lock
+ * @param status: int32, result of the SDLS procedure
+ * @return int32: status, or the checkpoint's failure
  **/
-static int32_t sa_setARSN(void)
+static int32_t sa_mmap_checkpoint_after(int32_t status)
 {
-    // Local variables
-    uint16_t spi = 0x0000;
-    int x;
+    int32_t checkpoint_status = sa_mmap_checkpoint(0);
+    sa_mmap_unlock();
+    return (checkpoint_status != CRYPTO_LIB_SUCCESS) ? checkpoint_status : status;
+}
 
-    // Read ingest
-    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
-    printf("spi = %d \n", spi);
+/**
+ * @brief Function: sa_mmap_lock
+ * Keeps checkpoints out while an SDLS procedure, provisioning or sa_insert changes the table, so none of them
+ * snapshots a half made change. Frames never wait for it, see sa_mmap_save_sa. Released by sa_mmap_checkpoint_after.
+ * The live state is marked busy meanwhile, a crash part way through leaves the live table to be ignored. The epoch
+ * writer lock is taken first, so a caller inside a frame does not wait here on a writer waiting for that frame.
+ **/
+static void sa_mmap_lock(void)
+{
+    Crypto_Epoch_Writer_Lock();
+    pthread_mutex_lock(&sa_mmap_mutex);
+    ((sa_mmap_live_state_t*)(sa_mmap_base + SA_MMAP_LIVE_STATE_OFFSET))->busy = 1;
+}
 
-    // TODO: Check SA type (authenticated, encrypted, both) and set appropriately
-    // TODO: Add more checks on bounds
+/**
+ * @brief Function: sa_mmap_unlock
+ **/
+static void sa_mmap_unlock(void)
+{
+    ((sa_mmap_live_state_t*)(sa_mmap_base + SA_MMAP_LIVE_STATE_OFFSET))->busy = 0;
+    pthread_mutex_unlock(&sa_mmap_mutex);
+    Crypto_Epoch_Writer_Unlock();
+}
 
-    // Check SPI exists
-    if (spi < NUM_SA)
-    {
-#ifdef PDU_DEBUG
-        printf("SPI %d IV updated to: 0x", spi);
-#endif
-        if (sa[spi].shivf_len > 0)
-        { // Set IV - authenticated encryption
-            for (x = 0; x < IV_SIZE; x++)
-            {
-                *(sa[spi].iv + x) = (uint8_t)sdls_frame.pdu.data[x + 2];
-#ifdef PDU_DEBUG
-                printf("%02x", *(sa[spi].iv + x));
-#endif
-            }
-            Crypto_increment(sa[spi].iv, sa[spi].shivf_len);
-        }
-        else
-        { // Set SN
-          // TODO
-        }
-#ifdef PDU_DEBUG
-        printf("\n");
-#endif
-    }
-    else
-    {
-        printf("sa_setARSN ERROR: SPI %d does not exist.\n", spi);
-    }
+/**
+ * @brief Function: sa_mmap_live_usable
+ * The live table is only ever ahead of the last checkpoint by IV and ARSN advances, unless a change to the table was
+ * under way. It survives the process dying, but not the kernel going down with it.
+ * @return uint8_t: 1 if the store was last opened under this boot and no change to the table was under way
+ **/
+static uint8_t sa_mmap_live_usable(void)
+{
+    const sa_mmap_live_state_t* state = (const sa_mmap_live_state_t*)(sa_mmap_base + SA_MMAP_LIVE_STATE_OFFSET);
+    char boot_id[SA_MMAP_BOOT_ID_SIZE];
 
-    return CRYPTO_LIB_SUCCESS;
+    sa_mmap_boot_id(boot_id);
+    return (state->magic == SA_MMAP_MAGIC) && !state->busy && (boot_id[0] != '\0') &&
+           (strncmp(state->boot_id, boot_id, SA_MMAP_BOOT_ID_SIZE) == 0);
 }
 
 /**
- * @brief Function: sa_setARSNW
- * @return int32: Success/Failure
+ * @brief Function: sa_mmap_live_claim
+ * Records the boot the live table is written under from here on
  **/
-static int32_t sa_setARSNW(void)
+static void sa_mmap_live_claim(void)
 {
-    // Local variables
-    uint16_t spi = 0x0000;
-    int x;
+    sa_mmap_live_state_t* state = (sa_mmap_live_state_t*)(sa_mmap_base + SA_MMAP_LIVE_STATE_OFFSET);
 
-    // Read ingest
-    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
-    printf("spi = %d \n", spi);
-
-    // Check SPI exists
-    if (spi < NUM_SA)
-    {
-        sa[spi].arsnw_len = (uint8_t)sdls_frame.pdu.data[2];
+    memset(state, 0, sizeof(sa_mmap_live_state_t));
+    state->magic = SA_MMAP_MAGIC;
+    sa_mmap_boot_id(state->boot_id);
+    msync(state, SA_MMAP_PAGE_SIZE, MS_SYNC);
+}
 
-        // Check for out of bounds
-        if (sa[spi].arsnw_len > (ARSN_SIZE))
-        {
-            sa[spi].arsnw_len = ARSN_SIZE;
-        }
+/**
+ * @brief Function: sa_mmap_boot_id
+ * @param boot_id: char*, SA_MMAP_BOOT_ID_SIZE bytes, receives the kernel's boot ID or an empty string if unknown
+ **/
+static void sa_mmap_boot_id(char* boot_id)
+{
+    FILE* fp = fopen("/proc/sys/kernel/random/boot_id", "r");
 
-        for (x = 0; x < sa[spi].arsnw_len; x++)
-        {
-            sa[spi].arsnw = (((uint8_t)sdls_frame.pdu.data[x + 3]) << (sa[spi].arsnw_len - x));
-        }
+    memset(boot_id, 0, SA_MMAP_BOOT_ID_SIZE);
+    if (fp == NULL)
+    {
+        return;
     }
-    else
+    if (fgets(boot_id, SA_MMAP_BOOT_ID_SIZE, fp) == NULL)
     {
-        printf("sa_setARSNW ERROR: SPI %d does not exist.\n", spi);
+        boot_id[0] = '\0';
     }
-
-    return CRYPTO_LIB_SUCCESS;
+    fclose(fp);
 }
 
 /**
- * @brief Function: sa_status
- * @param ingest: uint8_t*
- * @return int32: count
+ * @brief Function: sa_mmap_advance
+ * Adds to a big-endian counter such as an IV or ARSN, wrapping like Crypto_increment
+ * @param num: uint8_t*
+ * @param len: uint8_t
+ * @param by: uint32_t
  **/
-static int32_t sa_status(uint8_t* ingest)
+static void sa_mmap_advance(uint8_t* num, uint8_t len, uint32_t by)
 {
-    if(ingest == NULL) return CRYPTO_LIB_ERROR;
-    
-    // Local variables
-    int count = 0;
-    uint16_t spi = 0x0000;
-
-    // Read ingest
-    spi = ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
-    printf("spi = %d \n", spi);
+    uint64_t carry = by;
+    int i;
 
-    // Check SPI exists
-    if (spi < NUM_SA)
+    for (i = len - 1; (i >= 0) && (carry > 0); i--)
     {
-        // Prepare for Reply
-        sdls_frame.pdu.pdu_len = 3;
-        sdls_frame.hdr.pkt_length = sdls_frame.pdu.pdu_len + 9;
-        count = Crypto_Prep_Reply(ingest, 128);
-        // PDU
-        ingest[count++] = (spi & 0xFF00) >> 8;
-        ingest[count++] = (spi & 0x00FF);
-        ingest[count++] = sa[spi].lpid;
+        carry += num[i];
+        num[i] = (uint8_t)(carry & 0xFF);
+        carry >>= 8;
     }
-    else
+}
+
+/**
+ * @brief Function: sa_mmap_crc32
+ * CRC-32 (IEEE 802.3), pass the previous result to continue over several buffers
+ * @param data: const void*
+ * @param len: size_t
+ * @param crc: uint32_t
+ * @return uint32_t: crc
+ **/
+static uint32_t sa_mmap_crc32(const void* data, size_t len, uint32_t crc)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t c;
+    size_t i;
+    int k;
+
+    if (sa_mmap_crc_table[1] == 0)
     {
-        printf("sa_status ERROR: SPI %d does not exist.\n", spi);
+        for (i = 0; i < 256; i++)
+        {
+            c = (uint32_t)i;
+            for (k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            sa_mmap_crc_table[i] = c;
+        }
     }
 
-#ifdef SA_DEBUG
-    Crypto_saPrint(&sa[spi]);
-#endif
+    crc = ~crc;
+    for (i = 0; i < len; i++)
+    {
+        crc = sa_mmap_crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
 
-    return count;
-}
\ No newline at end of file
+/**
+ * @brief Function: sa_mmap_now_ms
+ * @return uint64_t: Monotonic time in milliseconds
+ **/
+static uint64_t sa_mmap_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000) + ((uint64_t)ts.tv_nsec / 1000000);
+}
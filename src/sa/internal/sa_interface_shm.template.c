@@ -0,0 +1,1786 @@
+/*
+ * Copyright 2021, by the California Institute of Technology.
+ * ALL RIGHTS RESERVED. United States Government Sponsorship acknowledged.
+ * Any commercial use must be negotiated with the Office of Technology
+ * Transfer at the California Institute of Technology.
+ *
+ * This software may be subject to U.S. export control laws. By accepting
+ * this software, the user agrees to comply with all applicable U.S.
+ * export laws and regulations. User has the responsibility to obtain
+ * export licenses, or other export authority as may be required before
+ * exporting such information to foreign countries or providing access to
+ * foreign persons.
+ */
+
+/*
+** Shared-Memory SA Table (SA_TYPE_SHM)
+** The SA table lives in a POSIX shared memory object so that several CryptoLib processes on one host, e.g. a
+** TC apply process and a TM process process, see the same SA state and never hand out the same IV.
+**
+**   header | SPI to record map | records[capacity]
+**
+** Every record carries a process-shared robust mutex that serializes writers and a seqlock that lets readers
+** copy the record without taking the mutex. Like the SQL backends, lookups return a private copy of the SA that
+** sa_save_sa writes back and frees. The IV and ARSN only ever move forwards. Any other change is written back only
+** if nothing else changed the record since the copy was taken, which each record's generation count tracks.
+** Otherwise the caller gets SADB_SHM_SA_CHANGED.
+**
+** The SDLS procedures and sa_provision change the records under a table-wide robust mutex, taken before any record
+** mutex. The table mutex also guards the GVCID index: hash buckets chaining the operational records in record
+** order, so a frame's lookup only visits the SAs on its own channel. The index has its own seqlock, and lookups
+** retry while a procedure is changing it.
+**
+** The apply paths find their SA with sa_get_operational_sa_from_gvcid, and that lookup reserves the IV and ARSN the
+** caller is about to use: the shared counters are advanced by one frame while the record is held, and the copy
+** keeps the pre-advance values. This is a fetch-add on the counters; they are wider than a machine word, so the
+** add is done under the record mutex instead of as a single atomic instruction. Two processes applying security
+** on the same SA therefore always use different IVs, whatever order their saves land in.
+**
+** The first process to open the object creates it and loads the default SAs from the in-memory SA interface.
+** If a process dies holding a record mutex, the next locker gets EOWNERDEAD; if the seqlock shows the dead
+** process was part way through a write, the IV and ARSN are rolled back to the image taken before it, which is
+** safe since every IV up to that image has been reserved already. A procedure's write is rolled back whole. If a
+** process dies holding the table mutex, the next locker rebuilds the GVCID index from the records.
+*/
+
+#include "crypto.h"
+#include "crypto_context_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Security Association Initialization Functions
+static int32_t sa_config(void);
+static int32_t sa_init(void);
+static int32_t sa_close(void);
+// Security Association Interaction Functions
+static int32_t sa_get_from_spi(uint16_t, SecurityAssociation_t**);
+static int32_t sa_get_operational_sa_from_gvcid(uint8_t, uint16_t, uint16_t, uint8_t, SecurityAssociation_t**);
+static int32_t sa_save_sa(SecurityAssociation_t* sa);
+// Security Association Utility Functions
+static int32_t sa_stop(void);
+static int32_t sa_start(TC_t* tc_frame);
+static int32_t sa_expire(void);
+static int32_t sa_rekey(void);
+static int32_t sa_status(uint8_t* );
+static int32_t sa_create(void);
+static int32_t sa_setARSN(void);
+static int32_t sa_setARSNW(void);
+static int32_t sa_delete(void);
+static int32_t sa_provision(SaProvisionOp_t* ops, uint32_t num_ops);
+
+/*
+** Defines
+*/
+#define SA_SHM_MAGIC 0x5341534D   // "SASM"
+#define SA_SHM_VERSION 2
+#define SA_SHM_KEY_REF_SIZE 256   // Longest shared ek_ref / ak_ref, including the terminator
+#define SA_SHM_RECORD_NONE 0xFFFF
+#define SA_SHM_NUM_SPIS (0xFFFF + 1)
+#define SA_SHM_ATTACH_TIMEOUT_MS 5000 // How long a process waits for the creator to load the SAs
+#define SA_SHM_READ_SPINS 1024        // Odd seqlock reads before checking whether the writer died
+#define SA_SHM_GVCID_BUCKETS 1024     // Power of two
+
+/*
+** Structures
+*/
+typedef struct
+{
+    SecurityAssociation_t sa;          // Pointer fields are meaningless in shared memory and kept NULL
+    uint8_t abm[ABM_SIZE];
+    char ek_ref[SA_SHM_KEY_REF_SIZE];
+    char ak_ref[SA_SHM_KEY_REF_SIZE];
+} sa_shm_entry_t;
+
+typedef struct
+{
+    pthread_mutex_t lock;              // Process-shared, robust; held by writers only
+    uint32_t seq;                      // Seqlock sequence, odd while the entry is being written
+    uint32_t generation;               // Bumped by every write other than an IV or ARSN advance
+    uint16_t gvcid_next;               // Next operational record in the same GVCID bucket, always a higher index
+    uint8_t undo_full;                 // The write in progress is a procedure's, undo_entry holds the whole entry
+    uint8_t undo_iv[IV_SIZE];          // IV and ARSN before the write in progress
+    uint8_t undo_arsn[ARSN_SIZE];
+    sa_shm_entry_t undo_entry;
+    sa_shm_entry_t entry;
+} sa_shm_record_t;
+
+/*
+** Private copy handed to callers, sa_save_sa compares it with what was taken to find what the caller changed
+*/
+typedef struct
+{
+    SecurityAssociation_t sa;          // First, callers only see this
+    uint32_t generation;               // Record generation the copy was taken at
+    sa_shm_entry_t taken;
+} sa_shm_copy_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t capacity;
+    uint32_t num_records;
+    uint32_t ready;                    // Set by the creator once the SAs are loaded
+    pthread_mutex_t table_lock;        // Process-shared, robust; held by procedures, which change records and index
+    uint32_t index_seq;                // Seqlock sequence of gvcid_index, odd while it is being changed
+    uint16_t gvcid_index[SA_SHM_GVCID_BUCKETS]; // First operational record per bucket, SA_SHM_RECORD_NONE if none
+    uint16_t spi_map[SA_SHM_NUM_SPIS]; // SPI to record index, SA_SHM_RECORD_NONE if unused
+} sa_shm_header_t;
+
+// Shared-memory local functions
+static int32_t sa_shm_open(uint8_t* created);
+static uint8_t sa_shm_wait(uint32_t* waited_ms);
+static sa_shm_record_t* sa_shm_find_record(uint16_t spi);
+static int32_t sa_shm_lock(sa_shm_record_t* record);
+static void sa_shm_unlock(sa_shm_record_t* record);
+static void sa_shm_begin_write(sa_shm_record_t* record);
+static void sa_shm_end_write(sa_shm_record_t* record);
+static void sa_shm_begin_update(sa_shm_record_t* record);
+static void sa_shm_read(sa_shm_record_t* record, sa_shm_entry_t* entry, uint32_t* generation);
+static void sa_shm_reserve(SecurityAssociation_t* sa);
+static int32_t sa_shm_copy_out(const sa_shm_entry_t* entry, uint32_t generation,
+                               SecurityAssociation_t** security_association);
+static void sa_shm_free_copy(SecurityAssociation_t* sa);
+static void sa_shm_entry_image(const SecurityAssociation_t* sa, sa_shm_entry_t* image);
+static uint8_t sa_shm_config_changed(const sa_shm_entry_t* image, const sa_shm_entry_t* taken);
+static int32_t sa_shm_table_lock(void);
+static void sa_shm_table_unlock(void);
+static void sa_shm_write_entry(uint16_t idx, const sa_shm_entry_t* image, uint8_t set_counters);
+static int32_t sa_shm_provision_one(SaProvisionOp_t* op);
+static int32_t sa_shm_modify(uint16_t spi, void (*modify)(sa_shm_entry_t*));
+static int32_t sa_shm_procedure(uint8_t procedure, uint16_t spi, const SecurityAssociation_t* sa,
+                                const crypto_gvcid_t* gvcid);
+static uint16_t sa_shm_pdu_spi(void);
+static void sa_shm_set_lpid(sa_shm_entry_t* entry);
+static void sa_shm_set_arsn(sa_shm_entry_t* entry);
+static void sa_shm_set_arsnw(sa_shm_entry_t* entry);
+// GVCID index functions
+static uint32_t sa_shm_index_hash(uint8_t tfvn, uint16_t scid, uint16_t vcid);
+static uint8_t sa_shm_matches(const SecurityAssociation_t* sa, uint8_t tfvn, uint16_t scid, uint16_t vcid,
+                              uint8_t mapid);
+static uint16_t sa_shm_index_find(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid);
+static void sa_shm_index_begin(void);
+static void sa_shm_index_end(void);
+static void sa_shm_index_add(uint16_t idx);
+static void sa_shm_index_remove(uint16_t idx);
+static void sa_shm_index_rebuild(void);
+
+/*
+** Global Variables
+*/
+static SaInterfaceStruct sa_if_struct;
+static sa_shm_header_t* sa_shm_header = NULL;
+static sa_shm_record_t* sa_shm_records = NULL;
+static size_t sa_shm_size = 0;
+static uint8_t sa_shm_created = 0;
+
+/**
+ * @brief Function: get_sa_interface_shm
+ * @return SaInterface
+ **/
+SaInterface get_sa_interface_shm(void)
+{
+    sa_if_struct.sa_config = sa_config;
+    sa_if_struct.sa_init = sa_init;
+    sa_if_struct.sa_close = sa_close;
+    sa_if_struct.sa_get_from_spi = sa_get_from_spi;
+    sa_if_struct.sa_get_operational_sa_from_gvcid = sa_get_operational_sa_from_gvcid;
+    sa_if_struct.sa_stop = sa_stop;
+    sa_if_struct.sa_save_sa = sa_save_sa;
+    sa_if_struct.sa_start = sa_start;
+    sa_if_struct.sa_expire = sa_expire;
+    sa_if_struct.sa_rekey = sa_rekey;
+    sa_if_struct.sa_status = sa_status;
+    sa_if_struct.sa_create = sa_create;
+    sa_if_struct.sa_setARSN = sa_setARSN;
+    sa_if_struct.sa_setARSNW = sa_setARSNW;
+    sa_if_struct.sa_delete = sa_delete;
+    sa_if_struct.sa_provision = sa_provision;
+    return &sa_if_struct;
+}
+
+/**
+ * @brief Function: sa_config
+ * Loads the default SAs into a table this process created, attaching processes use the table as it is
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_config(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    SaInterface inmemory_if;
+    SecurityAssociation_t* sa_ptr;
+    sa_shm_record_t* record;
+    uint32_t spi;
+
+    if (sa_shm_header == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    if (!sa_shm_created)
+    {
+        return status;
+    }
+
+    inmemory_if = get_sa_interface_inmemory();
+    status = inmemory_if->sa_init();
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = inmemory_if->sa_config();
+    }
+    for (spi = 0; (status == CRYPTO_LIB_SUCCESS) && (spi < SA_SHM_NUM_SPIS); spi++)
+    {
+        if (inmemory_if->sa_get_from_spi(spi, &sa_ptr) == SADB_SPI_NOT_FOUND)
+        {
+            continue;
+        }
+        if (sa_shm_header->num_records == sa_shm_header->capacity)
+        {
+            status = SADB_SA_TABLE_FULL;
+            break;
+        }
+        record = &sa_shm_records[sa_shm_header->num_records];
+        sa_shm_entry_image(sa_ptr, &record->entry);
+        sa_shm_header->spi_map[spi] = (uint16_t)sa_shm_header->num_records;
+        sa_shm_header->num_records++;
+    }
+    inmemory_if->sa_close();
+
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        sa_shm_index_rebuild();
+        __atomic_store_n(&sa_shm_header->ready, 1, __ATOMIC_RELEASE);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_init
+ * Creates or attaches to the shared memory object
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_init(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    pthread_mutexattr_t attr;
+    uint32_t waited_ms = 0;
+    uint32_t i;
+
+    sa_close();
+    if (sa_shm_config == NULL)
+    {
+        return CRYPTO_SHM_CONFIGURATION_NOT_COMPLETE;
+    }
+    status = sa_shm_open(&sa_shm_created);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+
+    if (sa_shm_created)
+    {
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&sa_shm_header->table_lock, &attr);
+        for (i = 0; i < sa_shm_header->capacity; i++)
+        {
+            pthread_mutex_init(&sa_shm_records[i].lock, &attr);
+        }
+        pthread_mutexattr_destroy(&attr);
+        for (i = 0; i < SA_SHM_NUM_SPIS; i++)
+        {
+            sa_shm_header->spi_map[i] = SA_SHM_RECORD_NONE;
+        }
+        return status;
+    }
+
+    // Attaching, wait for the creator to finish loading the SAs
+    while (!__atomic_load_n(&sa_shm_header->ready, __ATOMIC_ACQUIRE))
+    {
+        if (!sa_shm_wait(&waited_ms))
+        {
+            printf(KRED "ERROR: Shared SA table %s was never made ready\n" RESET, sa_shm_config->shm_name);
+            sa_close();
+            return SADB_SHM_OPEN_FAILED;
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_close
+ * Unmaps the table, which stays in place for the other processes
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_close(void)
+{
+    if (sa_shm_header != NULL)
+    {
+        munmap(sa_shm_header, sa_shm_size);
+    }
+    sa_shm_header = NULL;
+    sa_shm_records = NULL;
+    sa_shm_size = 0;
+    sa_shm_created = 0;
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/*
+** Security Association Interaction Functions
+*/
+/**
+ * @brief Function: sa_get_from_spi
+ * Returns a private copy of the SA, released by sa_save_sa
+ * @param spi: uint16
+ * @param security_association: SecurityAssociation_t**
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_get_from_spi(uint16_t spi, SecurityAssociation_t** security_association)
+{
+    sa_shm_record_t* record;
+    sa_shm_entry_t entry;
+    uint32_t generation;
+
+    if (sa_shm_header == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    record = sa_shm_find_record(spi);
+    if (record == NULL)
+    {
+        return SADB_SPI_NOT_FOUND;
+    }
+    sa_shm_read(record, &entry, &generation);
+    return sa_shm_copy_out(&entry, generation, security_association);
+}
+
+/**
+ * @brief Function: sa_get_operational_sa_from_gvcid
+ * Returns a private copy of the operational SA and reserves the IV and ARSN it will be applied with
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8 // tc only
+ * @param security_association: SecurityAssociation_t**
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_get_operational_sa_from_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid,
+                                                  SecurityAssociation_t** security_association)
+{
+    int32_t status;
+    sa_shm_record_t* record;
+    sa_shm_entry_t entry;
+    uint32_t generation;
+    uint16_t idx;
+
+    if (sa_shm_header == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+
+    for (idx = sa_shm_index_find(tfvn, scid, vcid, mapid); idx != SA_SHM_RECORD_NONE;
+         idx = sa_shm_index_find(tfvn, scid, vcid, mapid))
+    {
+        record = &sa_shm_records[idx];
+        status = sa_shm_lock(record);
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            return status;
+        }
+        // A procedure may have stopped or moved the SA since the index was read, look again if so
+        if (!sa_shm_matches(&record->entry.sa, tfvn, scid, vcid, mapid))
+        {
+            sa_shm_unlock(record);
+            continue;
+        }
+        entry = record->entry;
+        generation = record->generation;
+        sa_shm_begin_write(record);
+        sa_shm_reserve(&record->entry.sa);
+        sa_shm_end_write(record);
+        sa_shm_unlock(record);
+
+        return sa_shm_copy_out(&entry, generation, security_association);
+    }
+#ifdef SA_DEBUG
+    printf(KRED "Error - No operational SA found for tfvn %02X scid %d vcid %d mapid %02X\n" RESET, tfvn, scid, vcid,
+           mapid);
+#endif
+    return CRYPTO_LIB_ERR_NO_OPERATIONAL_SA;
+}
+
+/**
+ * @brief Function: sa_save_sa
+ * Moves the shared IV and ARSN forward to the copy's values, writes back any other change and releases the copy
+ * @param sa: SecurityAssociation_t*
+ * @return int32: Success/Failure, SADB_SHM_SA_CHANGED if the record changed since the copy was taken
+ **/
+static int32_t sa_save_sa(SecurityAssociation_t* sa)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    sa_shm_copy_t* copy = (sa_shm_copy_t*)sa;
+    sa_shm_record_t* record;
+    sa_shm_entry_t image;
+    uint8_t changed;
+
+    if (sa == NULL)
+    {
+        return SADB_NULL_SA_USED;
+    }
+
+    sa_shm_entry_image(sa, &image);
+    changed = sa_shm_config_changed(&image, &copy->taken);
+    record = (sa_shm_header != NULL) ? sa_shm_find_record(copy->taken.sa.spi) : NULL;
+    if (record == NULL)
+    {
+        status = SADB_SPI_NOT_FOUND;
+    }
+    else if (changed)
+    {
+        status = sa_shm_table_lock();
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_shm_lock(record);
+        if ((status != CRYPTO_LIB_SUCCESS) && changed)
+        {
+            sa_shm_table_unlock();
+        }
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        if (changed && (record->generation == copy->generation))
+        {
+            sa_shm_write_entry((uint16_t)(record - sa_shm_records), &image, 0);
+        }
+        else
+        {
+            // Only the counters are the caller's to move, a stale copy's other changes are dropped
+            sa_shm_begin_write(record);
+            if ((image.sa.iv_len == record->entry.sa.iv_len) &&
+                (memcmp(image.sa.iv, record->entry.sa.iv, image.sa.iv_len) > 0))
+            {
+                memcpy(record->entry.sa.iv, image.sa.iv, image.sa.iv_len);
+            }
+            if ((image.sa.arsn_len == record->entry.sa.arsn_len) &&
+                (memcmp(image.sa.arsn, record->entry.sa.arsn, image.sa.arsn_len) > 0))
+            {
+                memcpy(record->entry.sa.arsn, image.sa.arsn, image.sa.arsn_len);
+            }
+            sa_shm_end_write(record);
+            if (changed)
+            {
+                printf(KRED "ERROR: Shared SA %d changed since it was read, only its IV and ARSN were saved\n" RESET,
+                       copy->taken.sa.spi);
+                status = SADB_SHM_SA_CHANGED;
+            }
+        }
+        sa_shm_unlock(record);
+        if (changed)
+        {
+            sa_shm_table_unlock();
+        }
+    }
+
+    // We free the allocated SA memory in the save function.
+    sa_shm_free_copy(sa);
+    return status;
+}
+
+/**
+ * @brief Function: sa_provision
+ * Runs each operation against the shared records, the same checks as the in-memory table
+ * @param ops: SaProvisionOp_t*
+ * @param num_ops: uint32
+ * @return int32: Success/Failure of the first operation that failed
+ **/
+static int32_t sa_provision(SaProvisionOp_t* ops, uint32_t num_ops)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    uint32_t i;
+
+    if ((ops == NULL) && (num_ops > 0))
+    {
+        return SADB_NULL_SA_USED;
+    }
+    if (sa_shm_header == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+
+    for (i = 0; i < num_ops; i++)
+    {
+        ops[i].status = sa_shm_provision_one(&ops[i]);
+        if ((status == CRYPTO_LIB_SUCCESS) && (ops[i].status != CRYPTO_LIB_SUCCESS))
+        {
+            status = ops[i].status;
+        }
+    }
+    return status;
+}
+
+/*
+** Security Association Management Services
+** The PDUs are read as the in-memory table reads them, each procedure then runs as an sa_provision operation on
+** the shared records. Unlike the in-memory table, a procedure the SA's state does not allow returns its error.
+*/
+/**
+ * @brief Function: sa_start
+ * @param tc_frame: TC_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_start(TC_t* tc_frame)
+{
+    int32_t status;
+    uint16_t spi = sa_shm_pdu_spi();
+    SecurityAssociation_t* sa_ptr = NULL;
+    crypto_gvcid_t channel;
+    crypto_gvcid_t gvcid;
+    uint8_t count = 2;
+
+    status = sa_shm_modify(spi, sa_shm_set_lpid);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_get_from_spi(spi, &sa_ptr);
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+        return status;
+    }
+    channel = sa_ptr->gvcid_blk;
+    sa_shm_free_copy(sa_ptr);
+
+    // Read in GVCID, the in-memory table also only ever takes the first one given
+    gvcid.tfvn = (sdls_frame.pdu.data[count] >> 4);
+    gvcid.scid = (sdls_frame.pdu.data[count] << 12) | (sdls_frame.pdu.data[count + 1] << 4) |
+                 (sdls_frame.pdu.data[count + 2] >> 4);
+    gvcid.vcid = (sdls_frame.pdu.data[count + 2] << 4) | (sdls_frame.pdu.data[count + 3] && 0x3F);
+    if (current_managed_parameters->has_segmentation_hdr == TC_HAS_SEGMENT_HDRS)
+    {
+        gvcid.mapid = (sdls_frame.pdu.data[count + 3]);
+    }
+    else
+    {
+        gvcid.mapid = 0;
+    }
+
+    // TC
+    if (gvcid.vcid != tc_frame->tc_header.vcid)
+    {
+        if (gvcid.mapid == TYPE_TC)
+        {
+            memset(&channel, 0, sizeof(crypto_gvcid_t));
+        }
+        if (gvcid.mapid != TYPE_MAP)
+        {
+            channel.tfvn = gvcid.tfvn;
+            channel.scid = gvcid.scid;
+            channel.mapid = gvcid.mapid;
+        }
+    }
+    // TM
+    if (gvcid.vcid != tm_frame_pri_hdr.vcid)
+    {
+        if (gvcid.mapid != TYPE_MAP)
+        {
+            channel = gvcid;
+        }
+    }
+
+    status = sa_shm_procedure(SA_START, spi, NULL, &channel);
+#ifdef PDU_DEBUG
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        printf("SPI %d changed to OPERATIONAL state. \n", spi);
+    }
+#endif
+    return status;
+}
+
+/**
+ * @brief Function: sa_stop
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_stop(void)
+{
+    uint16_t spi = sa_shm_pdu_spi();
+    int32_t status = sa_shm_modify(spi, sa_shm_set_lpid);
+
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_shm_procedure(SA_STOP, spi, NULL, NULL);
+    }
+    else
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_rekey
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_rekey(void)
+{
+    int32_t status;
+    uint16_t spi = sa_shm_pdu_spi();
+    SecurityAssociation_t* sa_ptr = NULL;
+    SecurityAssociation_t rekey;
+    int count = 2;
+    int x;
+
+    status = sa_shm_modify(spi, sa_shm_set_lpid);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_get_from_spi(spi, &sa_ptr);
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+        return status;
+    }
+    rekey = *sa_ptr;
+    sa_shm_free_copy(sa_ptr);
+
+    // Encryption Key
+    rekey.ekid = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count + 1];
+    count = count + 2;
+    // Set IV - authenticated encryption
+    for (x = 0; x < rekey.shivf_len; x++)
+    {
+        rekey.iv[x] = (uint8_t)sdls_frame.pdu.data[count + x];
+    }
+
+    status = sa_shm_procedure(SA_REKEY, spi, &rekey, NULL);
+#ifdef PDU_DEBUG
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        printf("SPI %d changed to KEYED state with encrypted Key ID %d. \n", spi, rekey.ekid);
+    }
+#endif
+    return status;
+}
+
+/**
+ * @brief Function: sa_expire
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_expire(void)
+{
+    uint16_t spi = sa_shm_pdu_spi();
+    int32_t status = sa_shm_modify(spi, sa_shm_set_lpid);
+
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_shm_procedure(SA_EXPIRE, spi, NULL, NULL);
+    }
+    else
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_create
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_create(void)
+{
+    uint16_t count = 6;
+    uint16_t spi = sa_shm_pdu_spi();
+    SecurityAssociation_t* sa_ptr = NULL;
+    SecurityAssociation_t new_sa;
+    uint8_t abm[ABM_SIZE];
+    uint16_t abm_len;
+    int x;
+
+    // An SPI that is already in use is overwritten, as in the in-memory table
+    memset(&new_sa, 0, sizeof(SecurityAssociation_t));
+    if (sa_get_from_spi(spi, &sa_ptr) == CRYPTO_LIB_SUCCESS)
+    {
+        new_sa = *sa_ptr;
+        sa_shm_free_copy(sa_ptr);
+    }
+    sa_ptr = &new_sa;
+    memset(abm, 0, ABM_SIZE);
+    sa_ptr->abm = abm;
+    sa_ptr->abm_idx = 0;
+    sa_ptr->ek_ref = NULL;
+    sa_ptr->ak_ref = NULL;
+    sa_ptr->spi = spi;
+
+    // Overwrite last PID
+    sa_ptr->lpid =
+        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+
+    // Write SA Configuration
+    sa_ptr->est = ((uint8_t)sdls_frame.pdu.data[2] & 0x80) >> 7;
+    sa_ptr->ast = ((uint8_t)sdls_frame.pdu.data[2] & 0x40) >> 6;
+    sa_ptr->shivf_len = ((uint8_t)sdls_frame.pdu.data[2] & 0x3F);
+    sa_ptr->shsnf_len = ((uint8_t)sdls_frame.pdu.data[3] & 0xFC) >> 2;
+    sa_ptr->shplf_len = ((uint8_t)sdls_frame.pdu.data[3] & 0x03);
+    sa_ptr->stmacf_len = ((uint8_t)sdls_frame.pdu.data[4]);
+    sa_ptr->ecs_len = ((uint8_t)sdls_frame.pdu.data[5]);
+    for (x = 0; x < sa_ptr->ecs_len; x++)
+    {
+        sa_ptr->ecs = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->shivf_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->shivf_len; x++)
+    {
+        sa_ptr->iv[x] = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->acs_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->acs_len; x++)
+    {
+        sa_ptr->acs = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    abm_len = ((uint8_t)sdls_frame.pdu.data[count] << 8) | (uint8_t)sdls_frame.pdu.data[count + 1];
+    count = count + 2;
+    if ((abm_len > ABM_SIZE) || (count + abm_len > TLV_DATA_SIZE))
+    {
+        printf(KRED "ERROR: ABM length %d does not fit for SPI %d.\n" RESET, abm_len, spi);
+        return CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE;
+    }
+    for (x = 0; x < abm_len; x++)
+    {
+        abm[x] = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->abm_len = abm_len;
+    sa_ptr->arsn_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->arsn_len; x++)
+    {
+        *(sa_ptr->arsn + x) = ((uint8_t)sdls_frame.pdu.data[count++]);
+    }
+    sa_ptr->arsnw_len = ((uint8_t)sdls_frame.pdu.data[count++]);
+    for (x = 0; x < sa_ptr->arsnw_len; x++)
+    {
+        sa_ptr->arsnw = sa_ptr->arsnw | (((uint8_t)sdls_frame.pdu.data[count++]) << (sa_ptr->arsnw_len - x));
+    }
+
+    // Set state to unkeyed
+    sa_ptr->sa_state = SA_UNKEYED;
+
+#ifdef PDU_DEBUG
+    Crypto_saPrint(sa_ptr);
+#endif
+
+    return sa_shm_procedure(SA_CREATE, spi, &new_sa, NULL);
+}
+
+/**
+ * @brief Function: sa_delete
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_delete(void)
+{
+    uint16_t spi = sa_shm_pdu_spi();
+    int32_t status = sa_shm_modify(spi, sa_shm_set_lpid);
+
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sa_shm_procedure(SA_DELETE, spi, NULL, NULL);
+    }
+    else
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_setASRN
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_setARSN(void)
+{
+    uint16_t spi = sa_shm_pdu_spi();
+    int32_t status = sa_shm_modify(spi, sa_shm_set_arsn);
+
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        printf("sa_setARSN ERROR: SPI %d does not exist.\n", spi);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_setARSNW
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_setARSNW(void)
+{
+    uint16_t spi = sa_shm_pdu_spi();
+    int32_t status = sa_shm_modify(spi, sa_shm_set_arsnw);
+
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        printf("sa_setARSNW ERROR: SPI %d does not exist.\n", spi);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_status
+ * @param ingest: uint8_t*
+ * @return int32: count
+ **/
+static int32_t sa_status(uint8_t* ingest)
+{
+    int count = 0;
+    uint16_t spi;
+    SecurityAssociation_t* sa_ptr = NULL;
+
+    if (ingest == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+
+    spi = sa_shm_pdu_spi();
+    if ((sa_shm_header != NULL) && (sa_get_from_spi(spi, &sa_ptr) == CRYPTO_LIB_SUCCESS))
+    {
+        // Prepare for Reply
+        sdls_frame.pdu.pdu_len = 3;
+        sdls_frame.hdr.pkt_length = sdls_frame.pdu.pdu_len + 9;
+        count = Crypto_Prep_Reply(ingest, 128);
+        // PDU
+        ingest[count++] = (spi & 0xFF00) >> 8;
+        ingest[count++] = (spi & 0x00FF);
+        ingest[count++] = sa_ptr->lpid;
+        sa_shm_free_copy(sa_ptr);
+    }
+    else
+    {
+        printf("sa_status ERROR: SPI %d does not exist.\n", spi);
+    }
+    return count;
+}
+
+/*
+** Shared-Memory Local Functions
+*/
+/**
+ * @brief Function: sa_shm_open
+ * Creates the shared memory object, or maps the existing one after checking it matches this build
+ * @param created: uint8_t*, set when this process created the object
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_shm_open(uint8_t* created)
+{
+    uint32_t capacity = (crypto_config.sa_capacity > 0) ? crypto_config.sa_capacity : NUM_SA;
+    size_t header_size = (sizeof(sa_shm_header_t) + 63) & ~(size_t)63;
+    uint32_t waited_ms = 0;
+    struct stat st;
+    void* base;
+    int fd;
+
+    *created = 0;
+    fd = shm_open(sa_shm_config->shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+    {
+        *created = 1;
+        sa_shm_size = header_size + ((size_t)capacity * sizeof(sa_shm_record_t));
+        if (ftruncate(fd, sa_shm_size) != 0)
+        {
+            close(fd);
+            shm_unlink(sa_shm_config->shm_name);
+            return SADB_SHM_OPEN_FAILED;
+        }
+    }
+    else if (errno == EEXIST)
+    {
+        fd = shm_open(sa_shm_config->shm_name, O_RDWR, 0600);
+        if (fd < 0)
+        {
+            return SADB_SHM_OPEN_FAILED;
+        }
+        // The creator may not have sized the object yet
+        do
+        {
+            if (fstat(fd, &st) != 0)
+            {
+                st.st_size = 0;
+                break;
+            }
+        } while (((size_t)st.st_size < sizeof(sa_shm_header_t)) && sa_shm_wait(&waited_ms));
+        if ((size_t)st.st_size < sizeof(sa_shm_header_t))
+        {
+            close(fd);
+            return SADB_SHM_OPEN_FAILED;
+        }
+        sa_shm_size = st.st_size;
+    }
+    else
+    {
+        printf(KRED "ERROR: Unable to open shared SA table %s\n" RESET, sa_shm_config->shm_name);
+        return SADB_SHM_OPEN_FAILED;
+    }
+
+    base = mmap(NULL, sa_shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        if (*created)
+            shm_unlink(sa_shm_config->shm_name);
+        return SADB_SHM_OPEN_FAILED;
+    }
+    sa_shm_header = (sa_shm_header_t*)base;
+    sa_shm_records = (sa_shm_record_t*)((uint8_t*)base + header_size);
+
+    if (*created)
+    {
+        sa_shm_header->version = SA_SHM_VERSION;
+        sa_shm_header->record_size = sizeof(sa_shm_record_t);
+        sa_shm_header->capacity = capacity;
+        __atomic_store_n(&sa_shm_header->magic, SA_SHM_MAGIC, __ATOMIC_RELEASE);
+        return CRYPTO_LIB_SUCCESS;
+    }
+
+    while ((__atomic_load_n(&sa_shm_header->magic, __ATOMIC_ACQUIRE) == 0) && sa_shm_wait(&waited_ms))
+    {
+    }
+    if ((sa_shm_header->magic != SA_SHM_MAGIC) || (sa_shm_header->version != SA_SHM_VERSION) ||
+        (sa_shm_header->record_size != sizeof(sa_shm_record_t)) ||
+        (sa_shm_size < header_size + ((size_t)sa_shm_header->capacity * sizeof(sa_shm_record_t))))
+    {
+        printf(KRED "ERROR: Shared SA table %s was created by an incompatible build\n" RESET, sa_shm_config->shm_name);
+        sa_close();
+        return SADB_SHM_TABLE_INCOMPATIBLE;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_shm_wait
+ * Sleeps for a millisecond while attaching to a table another process is still creating
+ * @param waited_ms: uint32_t*, time waited so far
+ * @return uint8_t: 0 once SA_SHM_ATTACH_TIMEOUT_MS has passed
+ **/
+static uint8_t sa_shm_wait(uint32_t* waited_ms)
+{
+    struct timespec pause = {0, 1000000};
+
+    if (*waited_ms >= SA_SHM_ATTACH_TIMEOUT_MS)
+    {
+        return 0;
+    }
+    nanosleep(&pause, NULL);
+    (*waited_ms)++;
+    return 1;
+}
+
+/**
+ * @brief Function: sa_shm_find_record
+ * @param spi: uint16
+ * @return sa_shm_record_t*: NULL if the SPI has no SA
+ **/
+static sa_shm_record_t* sa_shm_find_record(uint16_t spi)
+{
+    uint16_t idx = sa_shm_header->spi_map[spi];
+
+    if ((idx == SA_SHM_RECORD_NONE) || (idx >= sa_shm_header->num_records))
+    {
+        return NULL;
+    }
+    return &sa_shm_records[idx];
+}
+
+/**
+ * @brief Function: sa_shm_lock
+ * Takes a record's mutex, repairing the record if its previous holder died part way through a write
+ * @param record: sa_shm_record_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_shm_lock(sa_shm_record_t* record)
+{
+    int rc = pthread_mutex_lock(&record->lock);
+
+    if (rc == EOWNERDEAD)
+    {
+        uint32_t seq = __atomic_load_n(&record->seq, __ATOMIC_RELAXED);
+        if ((seq & 1) && record->undo_full)
+        {
+            memcpy(&record->entry, &record->undo_entry, sizeof(sa_shm_entry_t));
+            __atomic_store_n(&record->seq, seq + 1, __ATOMIC_RELEASE);
+        }
+        else if (seq & 1)
+        {
+            memcpy(record->entry.sa.iv, record->undo_iv, IV_SIZE);
+            memcpy(record->entry.sa.arsn, record->undo_arsn, ARSN_SIZE);
+            __atomic_store_n(&record->seq, seq + 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_consistent(&record->lock);
+        rc = 0;
+    }
+    return (rc == 0) ? CRYPTO_LIB_SUCCESS : SADB_SHM_LOCK_FAILED;
+}
+
+/**
+ * @brief Function: sa_shm_unlock
+ * @param record: sa_shm_record_t*
+ **/
+static void sa_shm_unlock(sa_shm_record_t* record)
+{
+    pthread_mutex_unlock(&record->lock);
+}
+
+/**
+ * @brief Function: sa_shm_begin_write
+ * Saves the undo image and makes the sequence odd, readers retry until sa_shm_end_write. Record must be locked.
+ * @param record: sa_shm_record_t*
+ **/
+static void sa_shm_begin_write(sa_shm_record_t* record)
+{
+    record->undo_full = 0;
+    memcpy(record->undo_iv, record->entry.sa.iv, IV_SIZE);
+    memcpy(record->undo_arsn, record->entry.sa.arsn, ARSN_SIZE);
+    __atomic_store_n(&record->seq, record->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: sa_shm_begin_update
+ * As sa_shm_begin_write, for a write that may change the whole entry. Record must be locked.
+ * @param record: sa_shm_record_t*
+ **/
+static void sa_shm_begin_update(sa_shm_record_t* record)
+{
+    memcpy(&record->undo_entry, &record->entry, sizeof(sa_shm_entry_t));
+    record->undo_full = 1;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&record->seq, record->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: sa_shm_end_write
+ * @param record: sa_shm_record_t*
+ **/
+static void sa_shm_end_write(sa_shm_record_t* record)
+{
+    __atomic_store_n(&record->seq, record->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: sa_shm_read
+ * Seqlock read of a record. A sequence that stays odd may mean the writer died, so the mutex is taken once to let
+ * the robust mutex repair the record.
+ * @param record: sa_shm_record_t*
+ * @param entry: sa_shm_entry_t*
+ * @param generation: uint32_t*, the record's generation at the time of the copy
+ **/
+static void sa_shm_read(sa_shm_record_t* record, sa_shm_entry_t* entry, uint32_t* generation)
+{
+    uint32_t spins = 0;
+    uint32_t seq;
+
+    for (;;)
+    {
+        seq = __atomic_load_n(&record->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+        {
+            if (++spins == SA_SHM_READ_SPINS)
+            {
+                if (sa_shm_lock(record) == CRYPTO_LIB_SUCCESS)
+                {
+                    sa_shm_unlock(record);
+                }
+                spins = 0;
+            }
+            sched_yield();
+            continue;
+        }
+        memcpy(entry, &record->entry, sizeof(sa_shm_entry_t));
+        *generation = record->generation;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&record->seq, __ATOMIC_RELAXED) == seq)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Function: sa_shm_reserve
+ * Advances an SA's counters by one applied frame, the same way the TC, TM and AOS apply paths do
+ * @param sa: SecurityAssociation_t*
+ **/
+static void sa_shm_reserve(SecurityAssociation_t* sa)
+{
+    if ((sa->est == 0) && (sa->ast == 0))
+    {
+        return; // Plaintext SAs do not advance their counters
+    }
+    if (sa->shivf_len > 0 && sa->iv_len != 0)
+    {
+        if (crypto_config.crypto_increment_nontransmitted_iv == SA_INCREMENT_NONTRANSMITTED_IV_TRUE)
+        {
+            Crypto_increment(sa->iv, sa->iv_len);
+        }
+        else
+        {
+            Crypto_increment(sa->iv + (sa->iv_len - sa->shivf_len), sa->shivf_len);
+        }
+    }
+    if (sa->shsnf_len > 0)
+    {
+        Crypto_increment(sa->arsn, sa->arsn_len);
+    }
+}
+
+/**
+ * @brief Function: sa_shm_copy_out
+ * Builds the caller's private copy of a shared SA
+ * @param entry: const sa_shm_entry_t*
+ * @param generation: uint32, the record's generation when entry was read
+ * @param security_association: SecurityAssociation_t**
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_shm_copy_out(const sa_shm_entry_t* entry, uint32_t generation,
+                               SecurityAssociation_t** security_association)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    sa_shm_copy_t* copy = malloc(sizeof(sa_shm_copy_t));
+    SecurityAssociation_t* sa;
+
+    if (copy == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    sa = &copy->sa;
+    *sa = entry->sa;
+    sa->abm = NULL;
+    sa->abm_idx = 0;
+    sa->ek_ref = (entry->ek_ref[0] != '\0') ? crypto_deep_copy_string((char*)entry->ek_ref) : NULL;
+    sa->ak_ref = (entry->ak_ref[0] != '\0') ? crypto_deep_copy_string((char*)entry->ak_ref) : NULL;
+    if (sa->abm_len > 0)
+    {
+        status = Crypto_SA_Set_ABM(sa, entry->abm, sa->abm_len);
+    }
+    copy->generation = generation;
+    sa_shm_entry_image(sa, &copy->taken);
+    *security_association = sa;
+#ifdef SA_DEBUG
+    printf(KYEL "DEBUG - Printing local copy of shared SA Entry for current SPI.\n" RESET);
+    Crypto_saPrint(sa);
+#endif
+    return status;
+}
+
+/**
+ * @brief Function: sa_shm_free_copy
+ * @param sa: SecurityAssociation_t*, a copy made by sa_shm_copy_out
+ **/
+static void sa_shm_free_copy(SecurityAssociation_t* sa)
+{
+    if (sa->ek_ref != NULL)
+        free(sa->ek_ref);
+    if (sa->ak_ref != NULL)
+        free(sa->ak_ref);
+    Crypto_SA_Release_ABM(sa);
+    free(sa);
+}
+
+/**
+ * @brief Function: sa_shm_entry_image
+ * Lays an SA out the way it is stored in a record, so two images compare byte for byte
+ * @param sa: const SecurityAssociation_t*
+ * @param image: sa_shm_entry_t*
+ **/
+static void sa_shm_entry_image(const SecurityAssociation_t* sa, sa_shm_entry_t* image)
+{
+    memset(image, 0, sizeof(sa_shm_entry_t));
+    memcpy(&image->sa, sa, sizeof(SecurityAssociation_t));
+    image->sa.ek_ref = NULL;
+    image->sa.ak_ref = NULL;
+    image->sa.abm = NULL;
+    image->sa.abm_idx = 0;
+    if (sa->abm != NULL)
+    {
+        memcpy(image->abm, sa->abm, (sa->abm_len < ABM_SIZE) ? sa->abm_len : ABM_SIZE);
+    }
+    if (sa->ek_ref != NULL)
+    {
+        strncpy(image->ek_ref, sa->ek_ref, SA_SHM_KEY_REF_SIZE - 1);
+    }
+    if (sa->ak_ref != NULL)
+    {
+        strncpy(image->ak_ref, sa->ak_ref, SA_SHM_KEY_REF_SIZE - 1);
+    }
+}
+
+/**
+ * @brief Function: sa_shm_config_changed
+ * @param image: const sa_shm_entry_t*, the caller's copy as it is being saved
+ * @param taken: const sa_shm_entry_t*, the copy as it was handed out
+ * @return uint8: 1 if anything other than the IV and ARSN changed
+ **/
+static uint8_t sa_shm_config_changed(const sa_shm_entry_t* image, const sa_shm_entry_t* taken)
+{
+    sa_shm_entry_t masked;
+
+    memcpy(&masked, image, sizeof(sa_shm_entry_t));
+    memcpy(masked.sa.iv, taken->sa.iv, IV_SIZE);
+    memcpy(masked.sa.arsn, taken->sa.arsn, ARSN_SIZE);
+    return memcmp(&masked, taken, sizeof(sa_shm_entry_t)) != 0;
+}
+
+/**
+ * @brief Function: sa_shm_table_lock
+ * Takes the table mutex, rebuilding the GVCID index if its previous holder died
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_shm_table_lock(void)
+{
+    int rc = pthread_mutex_lock(&sa_shm_header->table_lock);
+
+    if (rc == EOWNERDEAD)
+    {
+        sa_shm_index_rebuild();
+        pthread_mutex_consistent(&sa_shm_header->table_lock);
+        rc = 0;
+    }
+    return (rc == 0) ? CRYPTO_LIB_SUCCESS : SADB_SHM_LOCK_FAILED;
+}
+
+/**
+ * @brief Function: sa_shm_table_unlock
+ **/
+static void sa_shm_table_unlock(void)
+{
+    pthread_mutex_unlock(&sa_shm_header->table_lock);
+}
+
+/**
+ * @brief Function: sa_shm_write_entry
+ * Replaces a record's entry and keeps the GVCID index in step. Table and record must be locked.
+ * @param idx: uint16, record index
+ * @param image: const sa_shm_entry_t*
+ * @param set_counters: uint8, 0 keeps the shared IV and ARSN where they are further ahead than the image's
+ **/
+static void sa_shm_write_entry(uint16_t idx, const sa_shm_entry_t* image, uint8_t set_counters)
+{
+    sa_shm_record_t* record = &sa_shm_records[idx];
+    SecurityAssociation_t* sa = &record->entry.sa;
+    SecurityAssociation_t* old = &record->undo_entry.sa;
+
+    sa_shm_index_begin();
+    sa_shm_index_remove(idx);
+    sa_shm_begin_update(record);
+    memcpy(&record->entry, image, sizeof(sa_shm_entry_t));
+    if (!set_counters)
+    {
+        if ((sa->iv_len == old->iv_len) && (memcmp(old->iv, sa->iv, old->iv_len) > 0))
+        {
+            memcpy(sa->iv, old->iv, old->iv_len);
+        }
+        if ((sa->arsn_len == old->arsn_len) && (memcmp(old->arsn, sa->arsn, old->arsn_len) > 0))
+        {
+            memcpy(sa->arsn, old->arsn, old->arsn_len);
+        }
+    }
+    record->generation++;
+    sa_shm_end_write(record);
+    if (sa->sa_state == SA_OPERATIONAL)
+    {
+        sa_shm_index_add(idx);
+    }
+    sa_shm_index_end();
+}
+
+/**
+ * @brief Function: sa_shm_provision_one
+ * Checks and applies one operation as the in-memory table's sa_provision_check and sa_provision_apply do
+ * @param op: SaProvisionOp_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_shm_provision_one(SaProvisionOp_t* op)
+{
+    int32_t status;
+    sa_shm_record_t* record = NULL;
+    sa_shm_entry_t image;
+    uint32_t num_records;
+    uint16_t idx;
+    uint8_t from_state = SA_NONE;
+
+    switch (op->procedure)
+    {
+    case SA_CREATE:
+        if (op->sa == NULL)
+        {
+            return SADB_NULL_SA_USED;
+        }
+        if (op->sa->abm_len > ABM_SIZE)
+        {
+            return CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE;
+        }
+        break;
+    case SA_REKEY:
+        if (op->sa == NULL)
+        {
+            return SADB_NULL_SA_USED;
+        }
+        from_state = SA_UNKEYED;
+        break;
+    case SA_START:
+    case SA_EXPIRE:
+        from_state = SA_KEYED;
+        break;
+    case SA_STOP:
+        from_state = SA_OPERATIONAL;
+        break;
+    case SA_DELETE:
+        from_state = SA_UNKEYED;
+        break;
+    default:
+        return CRYPTO_LIB_ERROR;
+    }
+
+    status = sa_shm_table_lock();
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    // Records are only added under the table mutex
+    num_records = sa_shm_header->num_records;
+    idx = sa_shm_header->spi_map[op->spi];
+    if ((idx == SA_SHM_RECORD_NONE) || (idx >= num_records))
+    {
+        if (op->procedure != SA_CREATE)
+        {
+            status = SADB_SPI_NOT_FOUND;
+        }
+        else if (num_records == sa_shm_header->capacity)
+        {
+            status = SADB_SA_TABLE_FULL;
+        }
+        idx = (uint16_t)num_records;
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        record = &sa_shm_records[idx];
+        status = sa_shm_lock(record);
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        sa_shm_table_unlock();
+        return status;
+    }
+
+    memcpy(&image, &record->entry, sizeof(sa_shm_entry_t));
+    if ((op->procedure != SA_CREATE) && (image.sa.sa_state != from_state))
+    {
+        status = SADB_SA_WRONG_STATE;
+    }
+    else
+    {
+        switch (op->procedure)
+        {
+        case SA_CREATE:
+            sa_shm_entry_image(op->sa, &image);
+            image.sa.spi = op->spi;
+            break;
+        case SA_REKEY:
+            image.sa.ekid = op->sa->ekid;
+            memcpy(image.sa.iv, op->sa->iv, (image.sa.shivf_len < IV_SIZE) ? image.sa.shivf_len : IV_SIZE);
+            image.sa.sa_state = SA_KEYED;
+            break;
+        case SA_START:
+            image.sa.gvcid_blk = op->gvcid;
+            image.sa.sa_state = SA_OPERATIONAL;
+            break;
+        case SA_STOP:
+            memset(&image.sa.gvcid_blk, 0, sizeof(image.sa.gvcid_blk));
+            image.sa.sa_state = SA_KEYED;
+            break;
+        case SA_EXPIRE:
+            image.sa.sa_state = SA_UNKEYED;
+            break;
+        default: // SA_DELETE
+            image.sa.sa_state = SA_NONE;
+            break;
+        }
+
+        if (idx < num_records)
+        {
+            sa_shm_write_entry(idx, &image, (op->procedure == SA_CREATE) || (op->procedure == SA_REKEY));
+        }
+        else
+        {
+            // A new record is unreachable until num_records covers it, so it is written before it is published
+            memcpy(&record->entry, &image, sizeof(sa_shm_entry_t));
+            record->generation++;
+            sa_shm_header->spi_map[op->spi] = idx;
+            __atomic_store_n(&sa_shm_header->num_records, num_records + 1, __ATOMIC_RELEASE);
+            if (image.sa.sa_state == SA_OPERATIONAL)
+            {
+                sa_shm_index_begin();
+                sa_shm_index_add(idx);
+                sa_shm_index_end();
+            }
+        }
+    }
+    sa_shm_unlock(record);
+    sa_shm_table_unlock();
+    return status;
+}
+
+/**
+ * @brief Function: sa_shm_modify
+ * Applies a change that needs no state check to a shared record
+ * @param spi: uint16
+ * @param modify: void (*)(sa_shm_entry_t*), changes the image that is then written back whole
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_shm_modify(uint16_t spi, void (*modify)(sa_shm_entry_t*))
+{
+    int32_t status;
+    sa_shm_record_t* record;
+    sa_shm_entry_t image;
+
+    if (sa_shm_header == NULL)
+    {
+        return CRYPTO_LIB_ERR_NO_INIT;
+    }
+    status = sa_shm_table_lock();
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    record = sa_shm_find_record(spi);
+    if (record == NULL)
+    {
+        status = SADB_SPI_NOT_FOUND;
+    }
+    else
+    {
+        status = sa_shm_lock(record);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        memcpy(&image, &record->entry, sizeof(sa_shm_entry_t));
+        modify(&image);
+        sa_shm_write_entry((uint16_t)(record - sa_shm_records), &image, 1);
+        sa_shm_unlock(record);
+    }
+    sa_shm_table_unlock();
+    return status;
+}
+
+/**
+ * @brief Function: sa_shm_procedure
+ * Runs an SDLS procedure as a single sa_provision operation and reports why it was refused
+ * @param procedure: uint8
+ * @param spi: uint16
+ * @param sa: const SecurityAssociation_t*, for SA_CREATE and SA_REKEY
+ * @param gvcid: const crypto_gvcid_t*, for SA_START
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_shm_procedure(uint8_t procedure, uint16_t spi, const SecurityAssociation_t* sa,
+                                const crypto_gvcid_t* gvcid)
+{
+    int32_t status;
+    SaProvisionOp_t op;
+    const char* from_state;
+
+    memset(&op, 0, SA_PROVISION_OP_SIZE);
+    op.procedure = procedure;
+    op.spi = spi;
+    op.sa = sa;
+    if (gvcid != NULL)
+    {
+        op.gvcid = *gvcid;
+    }
+    status = sa_provision(&op, 1);
+
+    if (status == SADB_SA_WRONG_STATE)
+    {
+        switch (procedure)
+        {
+        case SA_STOP:
+            from_state = "OPERATIONAL";
+            break;
+        case SA_START:
+        case SA_EXPIRE:
+            from_state = "KEYED";
+            break;
+        default: // SA_REKEY, SA_DELETE
+            from_state = "UNKEYED";
+            break;
+        }
+        printf(KRED "ERROR: SPI %d is not in the %s state.\n" RESET, spi, from_state);
+    }
+    else if (status == SADB_SPI_NOT_FOUND)
+    {
+        printf(KRED "ERROR: SPI %d does not exist.\n" RESET, spi);
+    }
+    else if (status == SADB_SA_TABLE_FULL)
+    {
+        printf(KRED "ERROR: No room in the SA table for SPI %d.\n" RESET, spi);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: sa_shm_pdu_spi
+ * @return uint16: SPI the current SDLS PDU names
+ **/
+static uint16_t sa_shm_pdu_spi(void)
+{
+    return ((uint8_t)sdls_frame.pdu.data[0] << 8) | (uint8_t)sdls_frame.pdu.data[1];
+}
+
+/**
+ * @brief Function: sa_shm_set_lpid
+ * Overwrite last PID
+ * @param entry: sa_shm_entry_t*
+ **/
+static void sa_shm_set_lpid(sa_shm_entry_t* entry)
+{
+    entry->sa.lpid =
+        (sdls_frame.pdu.type << 7) | (sdls_frame.pdu.uf << 6) | (sdls_frame.pdu.sg << 4) | sdls_frame.pdu.pid;
+}
+
+/**
+ * @brief Function: sa_shm_set_arsn
+ * @param entry: sa_shm_entry_t*
+ **/
+static void sa_shm_set_arsn(sa_shm_entry_t* entry)
+{
+    int x;
+
+    if (entry->sa.shivf_len > 0)
+    { // Set IV - authenticated encryption
+        for (x = 0; x < IV_SIZE; x++)
+        {
+            entry->sa.iv[x] = (uint8_t)sdls_frame.pdu.data[x + 2];
+        }
+        Crypto_increment(entry->sa.iv, entry->sa.shivf_len);
+    }
+}
+
+/**
+ * @brief Function: sa_shm_set_arsnw
+ * @param entry: sa_shm_entry_t*
+ **/
+static void sa_shm_set_arsnw(sa_shm_entry_t* entry)
+{
+    int x;
+
+    entry->sa.arsnw_len = (uint8_t)sdls_frame.pdu.data[2];
+    // Check for out of bounds
+    if (entry->sa.arsnw_len > (ARSN_SIZE))
+    {
+        entry->sa.arsnw_len = ARSN_SIZE;
+    }
+    for (x = 0; x < entry->sa.arsnw_len; x++)
+    {
+        entry->sa.arsnw = (((uint8_t)sdls_frame.pdu.data[x + 3]) << (entry->sa.arsnw_len - x));
+    }
+}
+
+/*
+** GVCID Index Functions
+** Each bucket chains its operational records by gvcid_next in increasing record order, so a lookup returns the
+** same SA the full scan it replaces did. Writers hold the table mutex, readers follow the index seqlock.
+*/
+/**
+ * @brief Function: sa_shm_index_hash
+ * Same hash as the in-memory table's GVCID index
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @return uint32: bucket
+ **/
+static uint32_t sa_shm_index_hash(uint8_t tfvn, uint16_t scid, uint16_t vcid)
+{
+    uint32_t key = ((uint32_t)tfvn << 26) ^ ((uint32_t)scid << 6) ^ (uint32_t)vcid;
+
+    key *= 2654435761u;
+    return (key >> 16) & (SA_SHM_GVCID_BUCKETS - 1);
+}
+
+/**
+ * @brief Function: sa_shm_matches
+ * @param sa: const SecurityAssociation_t*
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8, only compared when SAs are unique per MAP ID
+ * @return uint8: 1 if the SA is operational on the channel
+ **/
+static uint8_t sa_shm_matches(const SecurityAssociation_t* sa, uint8_t tfvn, uint16_t scid, uint16_t vcid,
+                              uint8_t mapid)
+{
+    return (sa->sa_state == SA_OPERATIONAL) && (sa->gvcid_blk.tfvn == tfvn) && (sa->gvcid_blk.scid == scid) &&
+           (sa->gvcid_blk.vcid == vcid) &&
+           ((crypto_config.unique_sa_per_mapid != TC_UNIQUE_SA_PER_MAP_ID_TRUE) || (sa->gvcid_blk.mapid == mapid));
+}
+
+/**
+ * @brief Function: sa_shm_index_find
+ * Seqlock read of the GVCID index. An index sequence that stays odd may mean a procedure died, so the table mutex
+ * is taken once to let it rebuild the index.
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8
+ * @return uint16: first matching record, SA_SHM_RECORD_NONE if none
+ **/
+static uint16_t sa_shm_index_find(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid)
+{
+    sa_shm_record_t* record;
+    SecurityAssociation_t sa;
+    uint32_t bucket = sa_shm_index_hash(tfvn, scid, vcid);
+    uint32_t num_records;
+    uint32_t record_seq;
+    uint32_t seq;
+    uint32_t spins = 0;
+    uint16_t found;
+    uint16_t prev;
+    uint16_t idx;
+
+    for (;;)
+    {
+        seq = __atomic_load_n(&sa_shm_header->index_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+        {
+            if (++spins == SA_SHM_READ_SPINS)
+            {
+                if (sa_shm_table_lock() == CRYPTO_LIB_SUCCESS)
+                {
+                    sa_shm_table_unlock();
+                }
+                spins = 0;
+            }
+            sched_yield();
+            continue;
+        }
+
+        num_records = __atomic_load_n(&sa_shm_header->num_records, __ATOMIC_ACQUIRE);
+        found = SA_SHM_RECORD_NONE;
+        idx = __atomic_load_n(&sa_shm_header->gvcid_index[bucket], __ATOMIC_ACQUIRE);
+        while (idx < num_records)
+        {
+            // Only procedures change the GVCID and state, and they bump the index sequence around the write
+            record = &sa_shm_records[idx];
+            record_seq = __atomic_load_n(&record->seq, __ATOMIC_ACQUIRE);
+            sa.sa_state = record->entry.sa.sa_state;
+            sa.gvcid_blk = record->entry.sa.gvcid_blk;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if ((__atomic_load_n(&record->seq, __ATOMIC_RELAXED) == record_seq) &&
+                sa_shm_matches(&sa, tfvn, scid, vcid, mapid))
+            {
+                found = idx;
+                break;
+            }
+            prev = idx;
+            idx = __atomic_load_n(&record->gvcid_next, __ATOMIC_ACQUIRE);
+            if (idx <= prev)
+            {
+                break; // Relinked under us, the index sequence check retries
+            }
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&sa_shm_header->index_seq, __ATOMIC_RELAXED) == seq)
+        {
+            return found;
+        }
+    }
+}
+
+/**
+ * @brief Function: sa_shm_index_begin
+ * Makes the index sequence odd. Also closes a change a dead procedure left open, ahead of a rebuild.
+ **/
+static void sa_shm_index_begin(void)
+{
+    __atomic_store_n(&sa_shm_header->index_seq, sa_shm_header->index_seq | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: sa_shm_index_end
+ **/
+static void sa_shm_index_end(void)
+{
+    __atomic_store_n(&sa_shm_header->index_seq, sa_shm_header->index_seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: sa_shm_index_add
+ * Links an operational record into its bucket, in record order. Table must be locked.
+ * @param idx: uint16
+ **/
+static void sa_shm_index_add(uint16_t idx)
+{
+    SecurityAssociation_t* sa = &sa_shm_records[idx].entry.sa;
+    uint16_t* link = &sa_shm_header->gvcid_index[sa_shm_index_hash(sa->gvcid_blk.tfvn, sa->gvcid_blk.scid,
+                                                                   sa->gvcid_blk.vcid)];
+
+    while ((*link != SA_SHM_RECORD_NONE) && (*link < idx))
+    {
+        link = &sa_shm_records[*link].gvcid_next;
+    }
+    sa_shm_records[idx].gvcid_next = *link;
+    __atomic_store_n(link, idx, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Function: sa_shm_index_remove
+ * Unlinks a record from the bucket of its current GVCID, if it is there. Table must be locked.
+ * @param idx: uint16
+ **/
+static void sa_shm_index_remove(uint16_t idx)
+{
+    SecurityAssociation_t* sa = &sa_shm_records[idx].entry.sa;
+    uint16_t* link = &sa_shm_header->gvcid_index[sa_shm_index_hash(sa->gvcid_blk.tfvn, sa->gvcid_blk.scid,
+                                                                   sa->gvcid_blk.vcid)];
+
+    while ((*link != SA_SHM_RECORD_NONE) && (*link != idx))
+    {
+        link = &sa_shm_records[*link].gvcid_next;
+    }
+    if (*link == idx)
+    {
+        __atomic_store_n(link, sa_shm_records[idx].gvcid_next, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Function: sa_shm_index_rebuild
+ * Relinks every operational record. Table must be locked, or not yet ready.
+ **/
+static void sa_shm_index_rebuild(void)
+{
+    sa_shm_entry_t entry;
+    uint32_t generation;
+    uint32_t i;
+
+    sa_shm_index_begin();
+    for (i = 0; i < SA_SHM_GVCID_BUCKETS; i++)
+    {
+        sa_shm_header->gvcid_index[i] = SA_SHM_RECORD_NONE;
+    }
+    for (i = 0; i < sa_shm_header->num_records; i++)
+    {
+        // Reading repairs a record whose writer died
+        sa_shm_read(&sa_shm_records[i], &entry, &generation);
+        if (entry.sa.sa_state == SA_OPERATIONAL)
+        {
+            sa_shm_index_add((uint16_t)i);
+        }
+    }
+    sa_shm_index_end();
+}
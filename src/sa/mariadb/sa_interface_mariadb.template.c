@@ -17,11 +17,17 @@
 #include "crypto_print.h"
 #include "crypto_structs.h"
 #include "sa_interface.h"
+#include "crypto_context_internal.h"
 
+#include <errno.h>
+#include <mysql/errmsg.h>
 #include <mysql/mysql.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // Security Association Initialization Functions
 static int32_t sa_config(void);
@@ -43,37 +49,332 @@ static int32_t sa_setARSNW(void);
 static int32_t sa_delete(void);
 // MySQL local functions
 static int32_t finish_with_error(MYSQL **con_loc, int err);
+static int32_t mariadb_connect(MYSQL** con_loc);
+static void mariadb_bind_int(MYSQL_BIND* bind, int32_t* value);
+static void mariadb_bind_buffer(MYSQL_BIND* bind, enum enum_field_types type, void* buffer, unsigned long buffer_length,
+                                unsigned long* length);
+static char* mariadb_copy_string(const char* text);
+static void mariadb_release_sa(SecurityAssociation_t* sa);
+static uint64_t mariadb_now_ms(void);
+// Connection Pool Functions
+typedef struct sa_mariadb_conn sa_mariadb_conn_t;
+static int32_t mariadb_pool_open(void);
+static void mariadb_pool_close(void);
+static sa_mariadb_conn_t* mariadb_pool_acquire(uint8_t wait);
+static void mariadb_pool_release(sa_mariadb_conn_t* conn);
+static int32_t mariadb_conn_open(sa_mariadb_conn_t* conn);
+static void mariadb_conn_close(sa_mariadb_conn_t* conn);
+static int32_t mariadb_conn_prepare(sa_mariadb_conn_t* conn, const char* sql, MYSQL_STMT** stmt);
+static int32_t mariadb_conn_bind_statements(sa_mariadb_conn_t* conn);
+static int32_t mariadb_conn_execute(sa_mariadb_conn_t* conn, MYSQL_STMT** stmt);
+static void mariadb_conn_set_update_params(sa_mariadb_conn_t* conn, const SecurityAssociation_t* sa);
+static int32_t mariadb_column_int(const sa_mariadb_conn_t* conn, int col);
+static void mariadb_column_to_buffer(const sa_mariadb_conn_t* conn, int col, uint8_t* dest_buffer, size_t dest_size);
+static char* mariadb_column_text(sa_mariadb_conn_t* conn, int col);
+static char* mariadb_column_to_string(sa_mariadb_conn_t* conn, int col);
+// SA Cache Functions
+static int32_t sa_cache_check_version(sa_mariadb_conn_t* conn);
+static SecurityAssociation_t* sa_cache_find(uint16_t spi);
+static SecurityAssociation_t* sa_cache_find_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid);
+static void sa_cache_insert(const SecurityAssociation_t* sa, uint8_t operational, uint32_t generation);
+static void sa_cache_insert_locked(const SecurityAssociation_t* sa, uint8_t operational);
+static void sa_cache_update_counters(const SecurityAssociation_t* sa);
+static void sa_cache_clear(void);
+static int32_t sa_cache_copy(const SecurityAssociation_t* cached, SecurityAssociation_t** security_association);
+static uint32_t sa_cache_gvcid_hash(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid);
+// Write-Behind Functions
+static int32_t sa_write_behind_start(void);
+static void sa_write_behind_stop(void);
+static void* sa_write_behind_thread(void* arg);
+static int32_t sa_write_behind_save(const SecurityAssociation_t* sa);
+static void sa_write_behind_overlay(SecurityAssociation_t* sa);
+static void sa_write_behind_flush(void);
+static int32_t sa_write_behind_write_rows(uint32_t num_rows);
+static uint64_t sa_write_behind_oldest_ms(void);
+static void sa_write_behind_wait(uint32_t timeout_ms);
+// Nonblocking I/O Functions
+typedef struct sa_mariadb_async sa_mariadb_async_t;
+static int32_t sa_batch_begin(void);
+static int32_t sa_prefetch_operational_sa_from_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid);
+static int32_t sa_batch_end(void);
+static sa_mariadb_async_t* sa_async_find_prefetch(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid);
+static uint8_t sa_async_take_prefetch(sa_mariadb_async_t* op, SecurityAssociation_t** security_association,
+                                      int32_t* status);
+static uint8_t sa_async_start_save(const SecurityAssociation_t* sa);
+static void sa_async_record_save(const SecurityAssociation_t* sa);
+static void sa_async_overlay(SecurityAssociation_t* sa);
+static sa_mariadb_async_t* sa_async_free_op(void);
+static uint32_t sa_async_oldest_save(void);
+static void sa_async_start(sa_mariadb_async_t* op, sa_mariadb_conn_t* conn, MYSQL_STMT** stmt, uint8_t kind);
+static void sa_async_step(sa_mariadb_async_t* op, uint8_t block);
+static int sa_async_wait(MYSQL* con, int wait_status, uint8_t block);
+static void sa_async_poll(void);
+static void sa_async_complete(sa_mariadb_async_t* op);
+static uint8_t sa_async_complete_one(void);
+static void sa_async_complete_all(void);
 // MySQL Queries
 static const char* SQL_SADB_GET_SA_BY_SPI =
         "SELECT "
-        "spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,HEX(ecs)"
-        ",HEX(iv),iv_len,acs_len,HEX(acs),abm_len,HEX(abm),arsn_len,HEX(arsn),arsnw"
-        " FROM security_associations WHERE spi='%d'";
+        "spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,ecs"
+        ",iv,iv_len,acs_len,acs,abm_len,abm,arsn_len,arsn,arsnw"
+        " FROM security_associations WHERE spi=? LIMIT 1";
 static const char* SQL_SADB_GET_SA_BY_GVCID =
         "SELECT "
-        "spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,HEX(ecs)"
-        ",HEX(iv),iv_len,acs_len,HEX(acs),abm_len,HEX(abm),arsn_len,HEX(arsn),arsnw"
-        " FROM security_associations WHERE tfvn='%d' AND scid='%d' AND vcid='%d' AND mapid='%d' AND sa_state='%d'";
+        "spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,ecs"
+        ",iv,iv_len,acs_len,acs,abm_len,abm,arsn_len,arsn,arsnw"
+        " FROM security_associations WHERE tfvn=? AND scid=? AND vcid=? AND mapid=? AND sa_state=?"
+        " ORDER BY spi LIMIT 1"; // Served in order by the gvcid_state index, see create_sadb.sql
 static const char* SQL_SADB_UPDATE_IV_ARC_BY_SPI =
         "UPDATE security_associations"
-        " SET iv=X'%s', arsn=X'%s'"
-        " WHERE spi='%d' AND tfvn='%d' AND scid='%d' AND vcid='%d' AND mapid='%d'";
-static const char* SQL_SADB_UPDATE_IV_ARC_BY_SPI_NULL_IV =
-        "UPDATE security_associations"
-        " SET arsn=X'%s'"
-        " WHERE spi='%d' AND tfvn='%d' AND scid='%d' AND vcid='%d' AND mapid='%d'";
+        " SET iv=?, arsn=?"
+        " WHERE spi=? AND tfvn=? AND scid=? AND vcid=? AND mapid=?";
+static const char* SQL_SADB_GET_VERSION =
+        "SELECT version FROM sadb_version WHERE id=0";
 
 // sa_if mariaDB private helper functions
-static int32_t parse_sa_from_mysql_query(char* query, SecurityAssociation_t** security_association);
-static int32_t convert_hexstring_to_byte_array(char* hexstr, uint8_t* byte_array);
-static void convert_byte_array_to_hexstring(void* src_buffer, size_t buffer_length, char* dest_str);
+static int32_t parse_sa_from_mysql_stmt(sa_mariadb_conn_t* conn, MYSQL_STMT** stmt,
+                                        SecurityAssociation_t** security_association);
+static int32_t parse_sa_from_stored_result(sa_mariadb_conn_t* conn, MYSQL_STMT** stmt,
+                                           SecurityAssociation_t** security_association);
+
+/*
+** Defines
+*/
+#define SA_MARIADB_KEY_REF_SIZE 101 // ekid / akid are VARCHAR(100), plus the terminator
+#define SA_MARIADB_CACHE_BUCKETS 256 // Hash buckets of each SA cache index, must be a power of two
+#define SA_MARIADB_FLUSH_BATCH_ROWS 32 // Rows per execution of the write-behind batch update
+#define SA_MARIADB_FLUSH_ROW_PARAMS 7 // spi, tfvn, scid, vcid, mapid, iv, arsn
+#define SA_MARIADB_FLUSH_SQL_SIZE 2048
+#define SA_MARIADB_EWMA_ALPHA 0.2 // Weight of the newest flush in the flush latency EWMA
+#define SA_MARIADB_ASYNC_OPS 4 // Statements a thread may leave running during a batch
+#define SA_MARIADB_ASYNC_SAVES 8 // Saves of a thread laid over the SAs it reads, at least SA_MARIADB_ASYNC_OPS
+
+// Column order of the SELECT queries above
+typedef enum
+{
+    SA_MARIADB_COL_SPI = 0,
+    SA_MARIADB_COL_EKID,
+    SA_MARIADB_COL_AKID,
+    SA_MARIADB_COL_SA_STATE,
+    SA_MARIADB_COL_TFVN,
+    SA_MARIADB_COL_SCID,
+    SA_MARIADB_COL_VCID,
+    SA_MARIADB_COL_MAPID,
+    SA_MARIADB_COL_LPID,
+    SA_MARIADB_COL_EST,
+    SA_MARIADB_COL_AST,
+    SA_MARIADB_COL_SHIVF_LEN,
+    SA_MARIADB_COL_SHSNF_LEN,
+    SA_MARIADB_COL_SHPLF_LEN,
+    SA_MARIADB_COL_STMACF_LEN,
+    SA_MARIADB_COL_ECS_LEN,
+    SA_MARIADB_COL_ECS,
+    SA_MARIADB_COL_IV,
+    SA_MARIADB_COL_IV_LEN,
+    SA_MARIADB_COL_ACS_LEN,
+    SA_MARIADB_COL_ACS,
+    SA_MARIADB_COL_ABM_LEN,
+    SA_MARIADB_COL_ABM,
+    SA_MARIADB_COL_ARSN_LEN,
+    SA_MARIADB_COL_ARSN,
+    SA_MARIADB_COL_ARSNW,
+    SA_MARIADB_NUM_COLS
+} SaMariaDBColumn;
+
+// Parameters of SQL_SADB_UPDATE_IV_ARC_BY_SPI, in order
+typedef enum
+{
+    SA_MARIADB_UPDATE_IV = 0,
+    SA_MARIADB_UPDATE_ARSN,
+    SA_MARIADB_UPDATE_SPI,
+    SA_MARIADB_UPDATE_TFVN,
+    SA_MARIADB_UPDATE_SCID,
+    SA_MARIADB_UPDATE_VCID,
+    SA_MARIADB_UPDATE_MAPID,
+    SA_MARIADB_NUM_UPDATE_PARAMS
+} SaMariaDBUpdateParam;
+
+// Statement left running by a batch
+typedef enum
+{
+    SA_MARIADB_ASYNC_PREFETCH = 0,
+    SA_MARIADB_ASYNC_SAVE
+} SaMariaDBAsyncKind;
+typedef enum
+{
+    SA_MARIADB_ASYNC_EXECUTE = 0,
+    SA_MARIADB_ASYNC_STORE,
+    SA_MARIADB_ASYNC_DONE
+} SaMariaDBAsyncStage;
+
+/*
+** Structures
+*/
+// Pooled connection, with its own prepared statements and bound buffers
+struct sa_mariadb_conn
+{
+    pthread_mutex_t lock; // Held by the thread using the connection
+    MYSQL* con;
+    uint64_t last_used_ms;
+    // Prepared statements, created on connect and executed with binary parameters and results
+    MYSQL_STMT* stmt_get_sa_by_spi;
+    MYSQL_STMT* stmt_get_sa_by_gvcid;
+    MYSQL_STMT* stmt_update_iv_arc_by_spi;
+    MYSQL_STMT* stmt_get_sadb_version;
+    // SELECT result row, bound to both query statements. SA fields are bitfields, so rows land here and are copied.
+    MYSQL_BIND result_bind[SA_MARIADB_NUM_COLS];
+    int32_t result_int[SA_MARIADB_NUM_COLS];
+    unsigned long result_length[SA_MARIADB_NUM_COLS];
+    my_bool result_is_null[SA_MARIADB_NUM_COLS];
+    char result_ekid[SA_MARIADB_KEY_REF_SIZE];
+    char result_akid[SA_MARIADB_KEY_REF_SIZE];
+    uint8_t result_ecs[ECS_SIZE];
+    uint8_t result_iv[IV_SIZE];
+    uint8_t result_acs[ECS_SIZE];
+    uint8_t result_abm[ABM_SIZE];
+    uint8_t result_arsn[ARSN_SIZE];
+    // Query parameters
+    MYSQL_BIND spi_param_bind[1];
+    MYSQL_BIND gvcid_param_bind[5];
+    int32_t param_int[5];
+    MYSQL_BIND update_param_bind[SA_MARIADB_NUM_UPDATE_PARAMS];
+    int32_t update_param_int[SA_MARIADB_NUM_UPDATE_PARAMS];
+    unsigned long update_param_length[SA_MARIADB_NUM_UPDATE_PARAMS];
+    uint8_t update_param_iv[IV_SIZE];
+    uint8_t update_param_arsn[ARSN_SIZE];
+    MYSQL_BIND version_bind[1];
+    uint64_t version_result;
+};
+
+// Cached SA, with its own ABM pool reference and key reference strings
+typedef struct sa_cache_entry
+{
+    SecurityAssociation_t sa;
+    struct sa_cache_entry* next;
+} sa_cache_entry_t;
+
+// Latest IV/ARSN saved for an SPI, kept until sa_close once created
+typedef struct sa_write_behind_entry
+{
+    uint16_t spi;
+    crypto_gvcid_t gvcid;
+    uint8_t iv[IV_SIZE];
+    uint8_t iv_len;
+    uint8_t arsn[ARSN_SIZE];
+    uint8_t arsn_len;
+    uint8_t dirty;       // Saved since it was last taken by a flush
+    uint8_t flushing;    // Taken by the flush in progress
+    uint32_t num_saves;  // Saves coalesced since it was last taken by a flush
+    struct sa_write_behind_entry* next;
+    struct sa_write_behind_entry* next_dirty;
+} sa_write_behind_entry_t;
+
+// One row of the batch update, bound once into sa_flush_bind
+typedef struct
+{
+    int32_t spi;
+    int32_t tfvn;
+    int32_t scid;
+    int32_t vcid;
+    int32_t mapid;
+    uint8_t iv[IV_SIZE];
+    unsigned long iv_len;
+    uint8_t arsn[ARSN_SIZE];
+    unsigned long arsn_len;
+    uint32_t num_saves;
+} sa_flush_row_t;
+
+// Statement left running on a pooled connection by the calling thread
+struct sa_mariadb_async
+{
+    sa_mariadb_conn_t* conn; // Held until the statement is collected, NULL for a free slot
+    MYSQL_STMT** stmt;       // Member of conn
+    uint8_t kind;            // SaMariaDBAsyncKind
+    uint8_t stage;           // SaMariaDBAsyncStage
+    int wait_status;         // What the running _start / _cont call waits for, 0 once it returned
+    int result;              // Return value of the statement call that finished
+    int32_t status;
+    crypto_gvcid_t gvcid;    // Prefetch: channel looked up
+    uint32_t generation;     // Prefetch: sa_cache_generation when it started
+    uint32_t save_seq;       // Prefetch: first save the lookup may not see. Save: number of the save.
+};
+
+// IV/ARSN saved by the calling thread during its batch
+typedef struct
+{
+    uint16_t spi;
+    uint8_t iv[IV_SIZE];
+    uint8_t iv_len;
+    uint8_t arsn[ARSN_SIZE];
+    uint8_t arsn_len;
+} sa_async_save_t;
+
+// Operational SA last read for a GVCID
+typedef struct sa_cache_gvcid_entry
+{
+    crypto_gvcid_t gvcid;
+    uint16_t spi;
+    struct sa_cache_gvcid_entry* next;
+} sa_cache_gvcid_entry_t;
 
 /*
 ** Global Variables
 */
 // Security
 static SaInterfaceStruct sa_if_struct;
-static MYSQL *con;
+// Connection pool. A thread keeps the slot it was first given, and only looks for another while that one is busy.
+static sa_mariadb_conn_t* sa_pool = NULL;
+static uint32_t sa_pool_size = 0;
+static uint32_t sa_pool_next_slot = 0;
+static uint32_t sa_pool_generation = 0; // Bumped by every sa_init, so affinities from an earlier pool are dropped
+static uint32_t sa_pool_health_check_ms = 0;
+static __thread uint32_t sa_pool_affinity_slot = 0;
+static __thread uint32_t sa_pool_affinity_generation = 0;
+// Read-through SA cache, dropped whenever sadb_version changes
+static pthread_mutex_t sa_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t sa_cache_generation = 0; // Bumped by every clear, reads started before it are not cached
+static uint8_t sa_cache_enabled = 0;
+static uint32_t sa_cache_poll_interval_ms = 0;
+static sa_cache_entry_t* sa_cache[SA_MARIADB_CACHE_BUCKETS];
+static sa_cache_gvcid_entry_t* sa_cache_gvcid[SA_MARIADB_CACHE_BUCKETS];
+static uint64_t sa_cache_version = 0;
+static uint64_t sa_cache_last_poll_ms = 0;
+static uint8_t sa_cache_polled = 0;
+// Write-behind queue, flushed on its own connection by sa_write_behind_thread
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wake;          // Signals the writer
+    pthread_cond_t flushed;       // Broadcast after every flush attempt
+    pthread_t thread;
+    uint8_t running;
+    uint8_t flush_requested;
+    uint8_t last_flush_failed;
+    uint32_t flush_generation;
+    uint32_t saves_since_flush;
+    uint64_t oldest_dirty_ms;     // First save on the dirty list, 0 when it is empty
+    uint64_t oldest_flushing_ms;  // Oldest save in the flush in progress, 0 when none
+    sa_write_behind_entry_t* entries[SA_MARIADB_CACHE_BUCKETS];
+    sa_write_behind_entry_t* dirty;
+    SadbMariaDBWriteBehindStats_t stats;
+} sa_wb = {.lock = PTHREAD_MUTEX_INITIALIZER};
+static uint8_t sa_write_behind_enabled = 0;
+static uint32_t sa_write_behind_flush_frames = 0;
+static uint32_t sa_write_behind_flush_interval_ms = 0;
+static uint32_t sa_write_behind_max_staleness_ms = 0;
+static MYSQL* con_writer = NULL;
+static MYSQL_STMT* stmt_flush_iv_arsn = NULL;
+static char sa_flush_sql[SA_MARIADB_FLUSH_SQL_SIZE];
+static MYSQL_BIND sa_flush_bind[SA_MARIADB_FLUSH_BATCH_ROWS * SA_MARIADB_FLUSH_ROW_PARAMS];
+static sa_flush_row_t sa_flush_batch[SA_MARIADB_FLUSH_BATCH_ROWS];
+static sa_flush_row_t* sa_flush_rows = NULL; // Taken from the dirty list, written outside the lock
+static uint32_t sa_flush_rows_capacity = 0;
+// Statements the calling thread left running during its batch
+static __thread uint8_t sa_async_batch = 0;
+static __thread sa_mariadb_async_t sa_async_ops[SA_MARIADB_ASYNC_OPS];
+static __thread sa_async_save_t sa_async_saves[SA_MARIADB_ASYNC_SAVES]; // Indexed by save number
+static __thread uint32_t sa_async_num_saves = 0;
+static __thread int32_t sa_async_status = CRYPTO_LIB_SUCCESS; // First save of the batch that failed
 
 SaInterface get_sa_interface_mariadb(void)
 {
@@ -92,6 +393,9 @@ SaInterface get_sa_interface_mariadb(void)
     sa_if_struct.sa_setARSN = sa_setARSN;
     sa_if_struct.sa_setARSNW = sa_setARSNW;
     sa_if_struct.sa_delete = sa_delete;
+    sa_if_struct.sa_batch_begin = sa_batch_begin;
+    sa_if_struct.sa_prefetch_operational_sa_from_gvcid = sa_prefetch_operational_sa_from_gvcid;
+    sa_if_struct.sa_batch_end = sa_batch_end;
     return &sa_if_struct;
 }
 
@@ -105,157 +409,173 @@ static int32_t sa_init(void)
     int32_t status = CRYPTO_LIB_ERROR;
     if (sa_mariadb_config != NULL)
     {
-        con = mysql_init(con);
-        if (con != NULL)
+        sa_cache_enabled = sa_mariadb_config->sa_cache_enabled;
+        sa_cache_poll_interval_ms = sa_mariadb_config->sa_cache_poll_interval_ms;
+        status = mariadb_pool_open();
+        if ((status == CRYPTO_LIB_SUCCESS) && sa_mariadb_config->write_behind_enabled)
         {
-            //mysql_options is removed in MariaDB C connector v3, using mysql_optionsv
-            // Lots of small configuration differences between MySQL connector & MariaDB Connector
-            // Only MariaDB Connector is implemented here:
-            // https://wikidev.in/wiki/C/mysql_mysql_h/mysql_options | https://mariadb.com/kb/en/mysql_optionsv/
-            if(sa_mariadb_config->mysql_mtls_key != NULL)
-            {
-                mysql_optionsv(con, MYSQL_OPT_SSL_KEY, sa_mariadb_config->mysql_mtls_key);
-            }
-            if(sa_mariadb_config->mysql_mtls_cert != NULL)
-            {
-                mysql_optionsv(con, MYSQL_OPT_SSL_CERT, sa_mariadb_config->mysql_mtls_cert);
-            }
-            if(sa_mariadb_config->mysql_mtls_ca != NULL)
-            {
-                mysql_optionsv(con, MYSQL_OPT_SSL_CA, sa_mariadb_config->mysql_mtls_ca);
-            }
-            if(sa_mariadb_config->mysql_mtls_capath != NULL)
-            {
-                mysql_optionsv(con, MYSQL_OPT_SSL_CAPATH, sa_mariadb_config->mysql_mtls_capath);
-            }
-            if (sa_mariadb_config->mysql_tls_verify_server != CRYPTO_FALSE)
-            {
-                mysql_optionsv(con, MYSQL_OPT_SSL_VERIFY_SERVER_CERT, &(sa_mariadb_config->mysql_tls_verify_server));
-            }
-            if (sa_mariadb_config->mysql_mtls_client_key_password != NULL)
-            {
-                mysql_optionsv(con, MARIADB_OPT_TLS_PASSPHRASE, sa_mariadb_config->mysql_mtls_client_key_password);
-            }
-            if (sa_mariadb_config->mysql_require_secure_transport == CRYPTO_TRUE)
-            {
-                mysql_optionsv(con, MYSQL_OPT_SSL_ENFORCE,&(sa_mariadb_config->mysql_require_secure_transport));
-            }
-            //if encrypted connection (TLS) connection. No need for SSL Key
-            if (mysql_real_connect(con, sa_mariadb_config->mysql_hostname,
-                    sa_mariadb_config->mysql_username,
-                    sa_mariadb_config->mysql_password,
-                    sa_mariadb_config->mysql_database,
-                    sa_mariadb_config->mysql_port, NULL, 0) == NULL)
-            {
-                //0,NULL,0 are port number, unix socket, client flag
-                finish_with_error(&con, SADB_MARIADB_CONNECTION_FAILED);
-                status = CRYPTO_LIB_ERROR;
-            } else {
-                status = CRYPTO_LIB_SUCCESS;
-                if (status == CRYPTO_LIB_SUCCESS) {
+            status = sa_write_behind_start();
+        }
+        if (status == CRYPTO_LIB_SUCCESS) {
 #ifdef DEBUG
-                    printf("sa_init created mysql connection successfully. \n");
+            printf("sa_init created mysql connection successfully. \n");
 #endif
-                }
-            }
-        }
-        else
-        {
-            //error
-            fprintf(stderr, "Error: sa_init() MySQL API function mysql_init() returned a connection object that is NULL\n");
         }
-
     }
     return status;
 }//end int32_t sa_init()
 
 static int32_t sa_close(void)
 {
-    if(con)
-    {
-        mysql_close(con);
-        con = NULL;
-    }
-    
+    sa_async_complete_all();
+    sa_async_batch = 0;
+    sa_write_behind_stop();
+    pthread_mutex_lock(&sa_cache_lock);
+    sa_cache_clear();
+    sa_cache_polled = 0;
+    pthread_mutex_unlock(&sa_cache_lock);
+    mariadb_pool_close();
+
     return CRYPTO_LIB_SUCCESS;
 }
 
 // Security Association Interaction Functions
 static int32_t sa_get_from_spi(uint16_t spi, SecurityAssociation_t** security_association)
 {
-    int32_t status = CRYPTO_LIB_SUCCESS;
-
-    char spi_query[2048];
-    snprintf(spi_query, sizeof(spi_query), SQL_SADB_GET_SA_BY_SPI, spi);
+    int32_t status;
+    SecurityAssociation_t* cached;
+    sa_mariadb_conn_t* conn;
+    uint32_t generation;
 
-    status = parse_sa_from_mysql_query(&spi_query[0], security_association);
+    if (sa_async_batch)
+    {
+        sa_async_poll();
+    }
+    conn = mariadb_pool_acquire(1);
+    if (conn == NULL)
+    {
+        return SADB_MARIADB_CONNECTION_FAILED;
+    }
+    status = sa_cache_check_version(conn);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        mariadb_pool_release(conn);
+        return status;
+    }
+    pthread_mutex_lock(&sa_cache_lock);
+    generation = sa_cache_generation;
+    cached = sa_cache_find(spi);
+    if (cached != NULL)
+    {
+        status = sa_cache_copy(cached, security_association);
+        pthread_mutex_unlock(&sa_cache_lock);
+        mariadb_pool_release(conn);
+        return status;
+    }
+    pthread_mutex_unlock(&sa_cache_lock);
+    conn->param_int[0] = spi;
 
+    status = parse_sa_from_mysql_stmt(conn, &conn->stmt_get_sa_by_spi, security_association);
+    mariadb_pool_release(conn);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        sa_async_overlay(*security_association);
+        sa_write_behind_overlay(*security_association);
+        sa_cache_insert(*security_association, 0, generation);
+    }
     return status;
 }
 static int32_t sa_get_operational_sa_from_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid,
                                                   SecurityAssociation_t** security_association)
 {
-    int32_t status = CRYPTO_LIB_SUCCESS;
-
-    char gvcid_query[2048];
-    snprintf(gvcid_query, sizeof(gvcid_query), SQL_SADB_GET_SA_BY_GVCID, tfvn, scid, vcid, mapid, SA_OPERATIONAL);
+    int32_t status;
+    SecurityAssociation_t* cached;
+    sa_mariadb_conn_t* conn;
+    sa_mariadb_async_t* prefetch;
+    uint32_t generation;
 
-    status = parse_sa_from_mysql_query(&gvcid_query[0], security_association);
+    if (sa_async_batch)
+    {
+        sa_async_poll();
+        prefetch = sa_async_find_prefetch(tfvn, scid, vcid, mapid);
+        if ((prefetch != NULL) && sa_async_take_prefetch(prefetch, security_association, &status))
+        {
+            return status;
+        }
+    }
+    conn = mariadb_pool_acquire(1);
+    if (conn == NULL)
+    {
+        return SADB_MARIADB_CONNECTION_FAILED;
+    }
+    status = sa_cache_check_version(conn);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        mariadb_pool_release(conn);
+        return status;
+    }
+    pthread_mutex_lock(&sa_cache_lock);
+    generation = sa_cache_generation;
+    cached = sa_cache_find_gvcid(tfvn, scid, vcid, mapid);
+    if (cached != NULL)
+    {
+        status = sa_cache_copy(cached, security_association);
+        pthread_mutex_unlock(&sa_cache_lock);
+        mariadb_pool_release(conn);
+        return status;
+    }
+    pthread_mutex_unlock(&sa_cache_lock);
+    conn->param_int[0] = tfvn;
+    conn->param_int[1] = scid;
+    conn->param_int[2] = vcid;
+    conn->param_int[3] = mapid;
+    conn->param_int[4] = SA_OPERATIONAL;
 
+    status = parse_sa_from_mysql_stmt(conn, &conn->stmt_get_sa_by_gvcid, security_association);
+    mariadb_pool_release(conn);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        sa_async_overlay(*security_association);
+        sa_write_behind_overlay(*security_association);
+        sa_cache_insert(*security_association, 1, generation);
+    }
     return status;
 }
 static int32_t sa_save_sa(SecurityAssociation_t* sa)
 {
     int32_t status = CRYPTO_LIB_SUCCESS;
+    sa_mariadb_conn_t* conn;
+
     if (sa == NULL)
     {
         return SADB_NULL_SA_USED;
     }
 
-    char update_sa_query[2048];    
-    char* iv_h = malloc(sa->iv_len * 2 + 1);
-    
-    if(sa->iv != NULL){
-        convert_byte_array_to_hexstring(sa->iv, sa->iv_len, iv_h);
+    // The next frame on this SA is served from the cache, it must see the counters this one used
+    sa_cache_update_counters(sa);
+    sa_async_record_save(sa);
+    if (sa_write_behind_enabled)
+    {
+        status = sa_write_behind_save(sa);
     }
-    
-    char* arsn_h = malloc(sa->arsn_len * 2 + 1);
-    convert_byte_array_to_hexstring(sa->arsn, sa->arsn_len, arsn_h);
-
-    if(sa->iv != NULL){
-        snprintf(update_sa_query, sizeof(update_sa_query), SQL_SADB_UPDATE_IV_ARC_BY_SPI,
-             iv_h,
-             arsn_h, sa->spi, sa->gvcid_blk.tfvn,
-             sa->gvcid_blk.scid, sa->gvcid_blk.vcid, sa->gvcid_blk.mapid);
-        
-        free(iv_h);
+    else if (sa_async_batch && sa_async_start_save(sa))
+    {
+        status = CRYPTO_LIB_SUCCESS;
     }
-    else
+    else if ((conn = mariadb_pool_acquire(1)) == NULL)
     {
-        snprintf(update_sa_query, sizeof(update_sa_query), SQL_SADB_UPDATE_IV_ARC_BY_SPI_NULL_IV,
-             arsn_h,
-             sa->spi, sa->gvcid_blk.tfvn,
-             sa->gvcid_blk.scid, sa->gvcid_blk.vcid, sa->gvcid_blk.mapid);
-        free(iv_h);
+        status = SADB_MARIADB_CONNECTION_FAILED;
     }
-    
-    free(arsn_h);
-#ifdef SA_DEBUG
-    fprintf(stderr, "MySQL Insert SA Query: %s \n", update_sa_query);
-#endif
-
-    // Crypto_saPrint(sa);
-    if (mysql_query(con, update_sa_query))
+    else
     {
-        status = finish_with_error(&con, SADB_QUERY_FAILED);
+        mariadb_conn_set_update_params(conn, sa);
+        // Crypto_saPrint(sa);
+        status = mariadb_conn_execute(conn, &conn->stmt_update_iv_arc_by_spi);
+        mariadb_pool_release(conn);
     }
-    // todo - if query fails, need to push failure message to error stack instead of just return code.
 
     // We free the allocated SA memory in the save function.
-    if (sa->ek_ref != NULL)
-        free(sa->ek_ref);
-    if (sa->ak_ref != NULL)
-        free(sa->ak_ref);
+    mariadb_release_sa(sa);
     free(sa);
     return status;
 }
@@ -300,281 +620,1907 @@ static int32_t sa_delete(void)
 }
 
 // sa_if private helper functions
-static int32_t parse_sa_from_mysql_query(char* query, SecurityAssociation_t** security_association)
+static int32_t parse_sa_from_mysql_stmt(sa_mariadb_conn_t* conn, MYSQL_STMT** stmt,
+                                        SecurityAssociation_t** security_association)
 {
-    int32_t status = CRYPTO_LIB_SUCCESS;
-    SecurityAssociation_t* sa = calloc(1,sizeof(SecurityAssociation_t));
-
-#ifdef SA_DEBUG
-    fprintf(stderr, "MySQL Query: %s \n", query);
-#endif
+    int32_t status;
 
-    if (mysql_real_query(con, query, strlen(query)))
-    { // query should be NUL terminated!
-        status = finish_with_error(&con, SADB_QUERY_FAILED);
+    status = mariadb_conn_execute(conn, stmt);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
         return status;
     }
-    // todo - if query fails, need to push failure message to error stack instead of just return code.
-
-    MYSQL_RES *result = mysql_store_result(con);
-    if (result == NULL)
+    if (mysql_stmt_store_result(*stmt))
     {
-        status = finish_with_error(&con, SADB_QUERY_EMPTY_RESULTS);
-        return status;
+        fprintf(stderr, "%s\n", mysql_stmt_error(*stmt)); // todo - push failure message to error stack
+        mysql_stmt_free_result(*stmt);
+        return SADB_QUERY_FAILED;
     }
+    return parse_sa_from_stored_result(conn, stmt, security_association);
+}
+
+// Parses the first row of a query whose result was stored, and frees the result
+static int32_t parse_sa_from_stored_result(sa_mariadb_conn_t* conn, MYSQL_STMT** stmt,
+                                           SecurityAssociation_t** security_association)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    SecurityAssociation_t* sa = NULL;
+    int rc;
 
-    int num_rows = mysql_num_rows(result);
-    if(num_rows == 0) // No rows returned in query!!
+    // Only the first row is used if several SAs match
+    rc = mysql_stmt_fetch(*stmt);
+    if (rc == MYSQL_NO_DATA) // No rows returned in query!!
+    {
+        status = SADB_QUERY_EMPTY_RESULTS;
+    }
+    else if ((rc != 0) && (rc != MYSQL_DATA_TRUNCATED))
+    {
+        fprintf(stderr, "%s\n", mysql_stmt_error(*stmt)); // todo - push failure message to error stack
+        status = SADB_QUERY_FAILED;
+    }
+    else
+    {
+        sa = calloc(1, sizeof(SecurityAssociation_t));
+        if (sa == NULL)
+        {
+            status = CRYPTO_LIB_ERROR;
+        }
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
     {
-        status = finish_with_error(&con, SADB_QUERY_EMPTY_RESULTS);
+        mysql_stmt_free_result(*stmt);
         return status;
     }
 
-    int num_fields = mysql_num_fields(result);
-
-    MYSQL_ROW row;
-    MYSQL_FIELD *field;
-
-    char* field_names[num_fields]; //[64]; 64 == max length of column name in MySQL
-
-    // TODO -- Need to store mysql query hex string and then malloc sa->iv according to size.
-    // TODO -- IV && arsn && abm as uint8_t* instead of uint8[]!!!
-    char* iv_byte_str = NULL;
-    char* arc_byte_str = NULL;
-    char* abm_byte_str = NULL;
-    char* ecs_byte_str = NULL;
-    char* acs_byte_str = NULL;
-    while ((row = mysql_fetch_row(result)))
+    sa->spi = mariadb_column_int(conn, SA_MARIADB_COL_SPI);
+    if (!conn->result_is_null[SA_MARIADB_COL_EKID])
     {
-        for (int i = 0; i < num_fields; i++)
+        if (crypto_config.cryptography_type == CRYPTOGRAPHY_TYPE_LIBGCRYPT)
         {
-            // Parse out all the field names.
-            if (i == 0)
-            {
-                int field_idx = 0;
-                while ((field = mysql_fetch_field(result)))
-                {
-                    field_names[field_idx] = field->name;
-                    field_idx++;
-                }
-            }
-            // Handle query results
-            if (row[i] == NULL)
-            {
-                continue;
-            } // Don't do anything with NULL fields from MySQL query.
-            if (strcmp(field_names[i], "spi") == 0)
-            {
-                sa->spi = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "ekid") == 0)
-            {
-                if(crypto_config.cryptography_type==CRYPTOGRAPHY_TYPE_LIBGCRYPT)
-                {
-                    sa->ekid = atoi(row[i]);
-                } else // Cryptography Type KMC Crypto Service with PKCS12 String Key References
-                {
-                    sa->ekid = 0;
-                    sa->ek_ref = malloc((strlen(row[i])+1) * sizeof(char));
-                    memcpy(sa->ek_ref, row[i], strlen(row[i])+1);
-                }
-                continue;
-            }
-            if (strcmp(field_names[i], "akid") == 0)
-            {
-                if(crypto_config.cryptography_type==CRYPTOGRAPHY_TYPE_LIBGCRYPT)
-                {
-                    sa->akid = atoi(row[i]);
-                } else // Cryptography Type KMC Crypto Service with PKCS12 String Key References
-                {
-                    sa->ak_ref = malloc((strlen(row[i])+1) * sizeof(char));
-                    memcpy(sa->ak_ref, row[i], strlen(row[i])+1);
-                }
-                continue;
-            }
-            if (strcmp(field_names[i], "sa_state") == 0)
-            {
-                sa->sa_state = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "tfvn") == 0)
-            {
-                sa->gvcid_blk.tfvn = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "scid") == 0)
-            {
-                sa->gvcid_blk.scid = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "vcid") == 0)
-            {
-                sa->gvcid_blk.vcid = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "mapid") == 0)
-            {
-                sa->gvcid_blk.mapid = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "lpid") == 0)
-            {
-                sa->lpid = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "est") == 0)
-            {
-                sa->est = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "ast") == 0)
-            {
-                sa->ast = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "shivf_len") == 0)
-            {
-                sa->shivf_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "iv_len") == 0)
-            {
-                sa->iv_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "shsnf_len") == 0)
-            {
-                sa->shsnf_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "shplf_len") == 0)
-            {
-                sa->shplf_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "stmacf_len") == 0)
-            {
-                sa->stmacf_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "ecs_len") == 0)
-            {
-                sa->ecs_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "HEX(ecs)") == 0)
-            {
-                ecs_byte_str = row[i];
-                continue;
-            }
-            // if(strcmp(field_names[i],"HEX(iv)")==0){memcpy(&(sa->iv),&row[i],IV_SIZE);continue;}
-            if (strcmp(field_names[i], "HEX(iv)") == 0)
-            {
-                iv_byte_str = row[i];
-                continue;
-            }
-            if (strcmp(field_names[i], "acs_len") == 0)
-            {
-                sa->acs_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "HEX(acs)") == 0)
-            {
-                acs_byte_str = row[i];
-                continue;
-            }
-            if (strcmp(field_names[i], "abm_len") == 0)
-            {
-                sa->abm_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "HEX(abm)") == 0)
-            {
-                abm_byte_str = row[i];
-                continue;
-            }
-            // if(strcmp(field_names[i],"HEX(abm)")==0){convert_hexstring_to_byte_array(row[i],sa->abm);continue;}
-            if (strcmp(field_names[i], "arsn_len") == 0)
-            {
-                sa->arsn_len = atoi(row[i]);
-                continue;
-            }
-            if (strcmp(field_names[i], "HEX(arsn)") == 0)
-            {
-                arc_byte_str = row[i];
-                continue;
-            }
-            // if(strcmp(field_names[i],"HEX(arsn)")==0){convert_hexstring_to_byte_array(row[i],sa->arsn);continue;}
-            if (strcmp(field_names[i], "arsnw") == 0)
-            {
-                sa->arsnw = atoi(row[i]);
-                continue;
-            }
-            // printf("%s:%s ",field_names[i], row[i] ? row[i] : "NULL");
+            sa->ekid = atoi(mariadb_column_text(conn, SA_MARIADB_COL_EKID));
+        }
+        else // Cryptography Type KMC Crypto Service with PKCS12 String Key References
+        {
+            sa->ekid = 0;
+            sa->ek_ref = mariadb_column_to_string(conn, SA_MARIADB_COL_EKID);
         }
-        // printf("\n");
     }
+    if (!conn->result_is_null[SA_MARIADB_COL_AKID])
+    {
+        if (crypto_config.cryptography_type == CRYPTOGRAPHY_TYPE_LIBGCRYPT)
+        {
+            sa->akid = atoi(mariadb_column_text(conn, SA_MARIADB_COL_AKID));
+        }
+        else // Cryptography Type KMC Crypto Service with PKCS12 String Key References
+        {
+            sa->ak_ref = mariadb_column_to_string(conn, SA_MARIADB_COL_AKID);
+        }
+    }
+    sa->sa_state = mariadb_column_int(conn, SA_MARIADB_COL_SA_STATE);
+    sa->gvcid_blk.tfvn = mariadb_column_int(conn, SA_MARIADB_COL_TFVN);
+    sa->gvcid_blk.scid = mariadb_column_int(conn, SA_MARIADB_COL_SCID);
+    sa->gvcid_blk.vcid = mariadb_column_int(conn, SA_MARIADB_COL_VCID);
+    sa->gvcid_blk.mapid = mariadb_column_int(conn, SA_MARIADB_COL_MAPID);
+    sa->lpid = mariadb_column_int(conn, SA_MARIADB_COL_LPID);
+    sa->est = mariadb_column_int(conn, SA_MARIADB_COL_EST);
+    sa->ast = mariadb_column_int(conn, SA_MARIADB_COL_AST);
+    sa->shivf_len = mariadb_column_int(conn, SA_MARIADB_COL_SHIVF_LEN);
+    sa->shsnf_len = mariadb_column_int(conn, SA_MARIADB_COL_SHSNF_LEN);
+    sa->shplf_len = mariadb_column_int(conn, SA_MARIADB_COL_SHPLF_LEN);
+    sa->stmacf_len = mariadb_column_int(conn, SA_MARIADB_COL_STMACF_LEN);
+    sa->ecs_len = mariadb_column_int(conn, SA_MARIADB_COL_ECS_LEN);
+    sa->iv_len = mariadb_column_int(conn, SA_MARIADB_COL_IV_LEN);
+    sa->acs_len = mariadb_column_int(conn, SA_MARIADB_COL_ACS_LEN);
+    sa->abm_len = mariadb_column_int(conn, SA_MARIADB_COL_ABM_LEN);
+    sa->arsn_len = mariadb_column_int(conn, SA_MARIADB_COL_ARSN_LEN);
+    sa->arsnw = mariadb_column_int(conn, SA_MARIADB_COL_ARSNW);
 
-    if(iv_byte_str != NULL){
-        if(sa->iv_len > 0)   convert_hexstring_to_byte_array(iv_byte_str, sa->iv);
+    if (sa->iv_len > 0)   mariadb_column_to_buffer(conn, SA_MARIADB_COL_IV, sa->iv, IV_SIZE);
+    if (sa->arsn_len > 0) mariadb_column_to_buffer(conn, SA_MARIADB_COL_ARSN, sa->arsn, ARSN_SIZE);
+    if (sa->abm_len > 0)
+    {
+        uint8_t abm[ABM_SIZE] = {0};
+        mariadb_column_to_buffer(conn, SA_MARIADB_COL_ABM, abm, ABM_SIZE);
+        status = Crypto_SA_Set_ABM(sa, abm, sa->abm_len);
     }
-    
-    if(sa->arsn_len > 0) convert_hexstring_to_byte_array(arc_byte_str, sa->arsn);
-    if(sa->abm_len > 0)  convert_hexstring_to_byte_array(abm_byte_str, sa->abm);
-    if(sa->ecs_len > 0)  convert_hexstring_to_byte_array(ecs_byte_str, &sa->ecs);
-    if(sa->acs_len > 0)  convert_hexstring_to_byte_array(acs_byte_str, &sa->acs);
+    if (sa->ecs_len > 0)  mariadb_column_to_buffer(conn, SA_MARIADB_COL_ECS, &sa->ecs, sizeof(sa->ecs));
+    if (sa->acs_len > 0)  mariadb_column_to_buffer(conn, SA_MARIADB_COL_ACS, &sa->acs, sizeof(sa->acs));
 
     //arsnw_len is not necessary for mariadb interface, putty dummy/default value for prints.
     sa->arsnw_len = 1;
 
+    mysql_stmt_free_result(*stmt);
+
 #ifdef DEBUG
     printf("Parsed SA from SQL Query:\n");
     Crypto_saPrint(sa);
 #endif
 
     *security_association = sa;
-    mysql_free_result(result);
-
     return status;
 }
-static int32_t convert_hexstring_to_byte_array(char* source_str, uint8_t* dest_buffer)
-{ // https://stackoverflow.com/questions/3408706/hexadecimal-string-to-byte-array-in-c/56247335#56247335
-    char* line = source_str;
-    char* data = line;
-    int offset;
-    unsigned int read_byte;
-    uint32_t data_len = 0;
 
-    while (sscanf(data, " %02x%n", &read_byte, &offset) == 1)
-    {
-        dest_buffer[data_len++] = read_byte;
-        data += offset;
-    }
-    return data_len;
+static int32_t mariadb_column_int(const sa_mariadb_conn_t* conn, int col)
+{
+    return conn->result_is_null[col] ? 0 : conn->result_int[col];
 }
 
-static void convert_byte_array_to_hexstring(void* src_buffer, size_t buffer_length, char* dest_str)
+static void mariadb_column_to_buffer(const sa_mariadb_conn_t* conn, int col, uint8_t* dest_buffer, size_t dest_size)
 {
-    unsigned char* bytes = src_buffer;
+    size_t len = conn->result_length[col];
 
-    if (src_buffer != NULL)
+    if (!conn->result_is_null[col])
     {
-        for (size_t i = 0; i < buffer_length; i++)
+        if (len > conn->result_bind[col].buffer_length)
         {
-            uint8_t nib1 = (bytes[i] >> 4) & 0x0F;
-            uint8_t nib2 = (bytes[i]) & 0x0F;
-            dest_str[i * 2 + 0] = nib1 < 0xA ? '0' + nib1 : 'A' + nib1 - 0xA;
-            dest_str[i * 2 + 1] = nib2 < 0xA ? '0' + nib2 : 'A' + nib2 - 0xA;
+            len = conn->result_bind[col].buffer_length; // MYSQL_DATA_TRUNCATED, the bound buffer holds the start
         }
-        dest_str[buffer_length * 2] = '\0';
+        memcpy(dest_buffer, conn->result_bind[col].buffer, (len < dest_size) ? len : dest_size);
     }
 }
 
-static int32_t finish_with_error(MYSQL **con_loc, int err)
+// Key reference columns are bound with room for the terminator, which is written here
+static char* mariadb_column_text(sa_mariadb_conn_t* conn, int col)
 {
-    fprintf(stderr, "%s\n", mysql_error(*con_loc)); // todo - if query fails, need to push failure message to error stack
-    mysql_close(*con_loc);
-    *con_loc = NULL;
-    return err;
-}
\ No newline at end of file
+    char* str = conn->result_bind[col].buffer;
+    size_t len = conn->result_length[col];
+
+    if (len >= conn->result_bind[col].buffer_length)
+    {
+        len = conn->result_bind[col].buffer_length - 1;
+    }
+    str[len] = '\0';
+    return str;
+}
+
+static char* mariadb_column_to_string(sa_mariadb_conn_t* conn, int col)
+{
+    return mariadb_copy_string(mariadb_column_text(conn, col));
+}
+
+static char* mariadb_copy_string(const char* text)
+{
+    size_t text_len;
+    char* str;
+
+    if (text == NULL)
+    {
+        return NULL;
+    }
+    text_len = strlen(text);
+    str = malloc(text_len + 1);
+
+    if (str != NULL)
+    {
+        memcpy(str, text, text_len + 1);
+    }
+    return str;
+}
+
+static void mariadb_bind_int(MYSQL_BIND* bind, int32_t* value)
+{
+    memset(bind, 0, sizeof(MYSQL_BIND));
+    bind->buffer_type = MYSQL_TYPE_LONG;
+    bind->buffer = value;
+}
+
+static void mariadb_bind_buffer(MYSQL_BIND* bind, enum enum_field_types type, void* buffer, unsigned long buffer_length,
+                                unsigned long* length)
+{
+    memset(bind, 0, sizeof(MYSQL_BIND));
+    bind->buffer_type = type;
+    bind->buffer = buffer;
+    bind->buffer_length = buffer_length;
+    bind->length = length;
+}
+
+static int32_t mariadb_conn_bind_statements(sa_mariadb_conn_t* conn)
+{
+    int col;
+
+    for (col = 0; col < SA_MARIADB_NUM_COLS; col++)
+    {
+        mariadb_bind_int(&conn->result_bind[col], &conn->result_int[col]);
+    }
+    mariadb_bind_buffer(&conn->result_bind[SA_MARIADB_COL_EKID], MYSQL_TYPE_STRING, conn->result_ekid,
+                        SA_MARIADB_KEY_REF_SIZE - 1, &conn->result_length[SA_MARIADB_COL_EKID]);
+    mariadb_bind_buffer(&conn->result_bind[SA_MARIADB_COL_AKID], MYSQL_TYPE_STRING, conn->result_akid,
+                        SA_MARIADB_KEY_REF_SIZE - 1, &conn->result_length[SA_MARIADB_COL_AKID]);
+    mariadb_bind_buffer(&conn->result_bind[SA_MARIADB_COL_ECS], MYSQL_TYPE_BLOB, conn->result_ecs, ECS_SIZE,
+                        &conn->result_length[SA_MARIADB_COL_ECS]);
+    mariadb_bind_buffer(&conn->result_bind[SA_MARIADB_COL_IV], MYSQL_TYPE_BLOB, conn->result_iv, IV_SIZE,
+                        &conn->result_length[SA_MARIADB_COL_IV]);
+    mariadb_bind_buffer(&conn->result_bind[SA_MARIADB_COL_ACS], MYSQL_TYPE_BLOB, conn->result_acs, ECS_SIZE,
+                        &conn->result_length[SA_MARIADB_COL_ACS]);
+    mariadb_bind_buffer(&conn->result_bind[SA_MARIADB_COL_ABM], MYSQL_TYPE_BLOB, conn->result_abm, ABM_SIZE,
+                        &conn->result_length[SA_MARIADB_COL_ABM]);
+    mariadb_bind_buffer(&conn->result_bind[SA_MARIADB_COL_ARSN], MYSQL_TYPE_BLOB, conn->result_arsn, ARSN_SIZE,
+                        &conn->result_length[SA_MARIADB_COL_ARSN]);
+    for (col = 0; col < SA_MARIADB_NUM_COLS; col++)
+    {
+        conn->result_bind[col].is_null = &conn->result_is_null[col];
+    }
+
+    mariadb_bind_int(&conn->spi_param_bind[0], &conn->param_int[0]);
+    for (col = 0; col < 5; col++)
+    {
+        mariadb_bind_int(&conn->gvcid_param_bind[col], &conn->param_int[col]);
+    }
+    for (col = 0; col < SA_MARIADB_NUM_UPDATE_PARAMS; col++)
+    {
+        mariadb_bind_int(&conn->update_param_bind[col], &conn->update_param_int[col]);
+    }
+    mariadb_bind_buffer(&conn->update_param_bind[SA_MARIADB_UPDATE_IV], MYSQL_TYPE_BLOB, conn->update_param_iv, IV_SIZE,
+                        &conn->update_param_length[SA_MARIADB_UPDATE_IV]);
+    mariadb_bind_buffer(&conn->update_param_bind[SA_MARIADB_UPDATE_ARSN], MYSQL_TYPE_BLOB, conn->update_param_arsn,
+                        ARSN_SIZE, &conn->update_param_length[SA_MARIADB_UPDATE_ARSN]);
+
+    memset(conn->version_bind, 0, sizeof(conn->version_bind));
+    conn->version_bind[0].buffer_type = MYSQL_TYPE_LONGLONG;
+    conn->version_bind[0].buffer = &conn->version_result;
+    conn->version_bind[0].is_unsigned = 1;
+
+    // Bound once per connection; executions only refresh the buffers
+    if (mysql_stmt_bind_param(conn->stmt_get_sa_by_spi, conn->spi_param_bind) ||
+        mysql_stmt_bind_result(conn->stmt_get_sa_by_spi, conn->result_bind) ||
+        mysql_stmt_bind_param(conn->stmt_get_sa_by_gvcid, conn->gvcid_param_bind) ||
+        mysql_stmt_bind_result(conn->stmt_get_sa_by_gvcid, conn->result_bind) ||
+        mysql_stmt_bind_param(conn->stmt_update_iv_arc_by_spi, conn->update_param_bind) ||
+        ((conn->stmt_get_sadb_version != NULL) &&
+         mysql_stmt_bind_result(conn->stmt_get_sadb_version, conn->version_bind)))
+    {
+        fprintf(stderr, "%s\n", mysql_error(conn->con));
+        return SADB_QUERY_FAILED;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t mariadb_connect(MYSQL** con_loc)
+{
+    *con_loc = mysql_init(*con_loc);
+    if (*con_loc == NULL)
+    {
+        fprintf(stderr, "Error: sa_init() MySQL API function mysql_init() returned a connection object that is NULL\n");
+        return CRYPTO_LIB_ERROR;
+    }
+    //mysql_options is removed in MariaDB C connector v3, using mysql_optionsv
+    // Lots of small configuration differences between MySQL connector & MariaDB Connector
+    // Only MariaDB Connector is implemented here:
+    // https://wikidev.in/wiki/C/mysql_mysql_h/mysql_options | https://mariadb.com/kb/en/mysql_optionsv/
+    if(sa_mariadb_config->mysql_mtls_key != NULL)
+    {
+        mysql_optionsv(*con_loc, MYSQL_OPT_SSL_KEY, sa_mariadb_config->mysql_mtls_key);
+    }
+    if(sa_mariadb_config->mysql_mtls_cert != NULL)
+    {
+        mysql_optionsv(*con_loc, MYSQL_OPT_SSL_CERT, sa_mariadb_config->mysql_mtls_cert);
+    }
+    if(sa_mariadb_config->mysql_mtls_ca != NULL)
+    {
+        mysql_optionsv(*con_loc, MYSQL_OPT_SSL_CA, sa_mariadb_config->mysql_mtls_ca);
+    }
+    if(sa_mariadb_config->mysql_mtls_capath != NULL)
+    {
+        mysql_optionsv(*con_loc, MYSQL_OPT_SSL_CAPATH, sa_mariadb_config->mysql_mtls_capath);
+    }
+    if (sa_mariadb_config->mysql_tls_verify_server != CRYPTO_FALSE)
+    {
+        mysql_optionsv(*con_loc, MYSQL_OPT_SSL_VERIFY_SERVER_CERT, &(sa_mariadb_config->mysql_tls_verify_server));
+    }
+    if (sa_mariadb_config->mysql_mtls_client_key_password != NULL)
+    {
+        mysql_optionsv(*con_loc, MARIADB_OPT_TLS_PASSPHRASE, sa_mariadb_config->mysql_mtls_client_key_password);
+    }
+    if (sa_mariadb_config->mysql_require_secure_transport == CRYPTO_TRUE)
+    {
+        mysql_optionsv(*con_loc, MYSQL_OPT_SSL_ENFORCE,&(sa_mariadb_config->mysql_require_secure_transport));
+    }
+    // Blocking calls still work, this also allows the _start / _cont calls a batch uses
+    mysql_optionsv(*con_loc, MYSQL_OPT_NONBLOCK, 0);
+    //if encrypted connection (TLS) connection. No need for SSL Key
+    if (mysql_real_connect(*con_loc, sa_mariadb_config->mysql_hostname,
+            sa_mariadb_config->mysql_username,
+            sa_mariadb_config->mysql_password,
+            sa_mariadb_config->mysql_database,
+            sa_mariadb_config->mysql_port, NULL, 0) == NULL)
+    {
+        //0,NULL,0 are port number, unix socket, client flag
+        finish_with_error(con_loc, SADB_MARIADB_CONNECTION_FAILED);
+        return CRYPTO_LIB_ERROR;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t mariadb_conn_prepare(sa_mariadb_conn_t* conn, const char* sql, MYSQL_STMT** stmt)
+{
+    *stmt = mysql_stmt_init(conn->con);
+    if ((*stmt == NULL) || mysql_stmt_prepare(*stmt, sql, strlen(sql)))
+    {
+        if (*stmt != NULL)
+        {
+            fprintf(stderr, "%s\n", mysql_stmt_error(*stmt));
+        }
+        return SADB_QUERY_FAILED;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+// Releases what an SA owns besides its own memory
+static void mariadb_release_sa(SecurityAssociation_t* sa)
+{
+    if (sa->ek_ref != NULL)
+        free(sa->ek_ref);
+    if (sa->ak_ref != NULL)
+        free(sa->ak_ref);
+    sa->ek_ref = NULL;
+    sa->ak_ref = NULL;
+    Crypto_SA_Release_ABM(sa);
+}
+
+static uint64_t mariadb_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000) + ((uint64_t)ts.tv_nsec / 1000000);
+}
+
+/*
+** Connection Pool Functions
+** Crypto_Config_MariaDB_Pool sets how many connections sa_init opens. Every connection has its own prepared
+** statements and buffers, and is used by one thread at a time. A thread keeps the connection it was first given so
+** that its statements stay warm, and only takes another while that one is busy. Connections idle for longer than the
+** health check interval are pinged before use, and a connection the server dropped is reopened, including when a
+** statement fails with a lost connection, which is then retried once.
+*/
+/**
+ * @brief Function: mariadb_pool_open
+ * Opens every pooled connection, any failure closes the pool again
+ * @return int32: Success/Failure
+ **/
+static int32_t mariadb_pool_open(void)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    uint32_t slot;
+
+    sa_pool_size = (sa_mariadb_config->pool_size != 0) ? sa_mariadb_config->pool_size : 1;
+    sa_pool_health_check_ms = sa_mariadb_config->pool_health_check_interval_ms;
+    sa_pool = calloc(sa_pool_size, sizeof(sa_mariadb_conn_t));
+    if (sa_pool == NULL)
+    {
+        sa_pool_size = 0;
+        return CRYPTO_LIB_ERROR;
+    }
+    sa_pool_generation++;
+    sa_pool_next_slot = 0;
+    for (slot = 0; slot < sa_pool_size; slot++)
+    {
+        pthread_mutex_init(&sa_pool[slot].lock, NULL);
+    }
+    for (slot = 0; (slot < sa_pool_size) && (status == CRYPTO_LIB_SUCCESS); slot++)
+    {
+        status = mariadb_conn_open(&sa_pool[slot]);
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        mariadb_pool_close();
+    }
+    return status;
+}
+
+/**
+ * @brief Function: mariadb_pool_close
+ * Closes every pooled connection. No thread may be using the pool.
+ **/
+static void mariadb_pool_close(void)
+{
+    uint32_t slot;
+
+    for (slot = 0; slot < sa_pool_size; slot++)
+    {
+        mariadb_conn_close(&sa_pool[slot]);
+        pthread_mutex_destroy(&sa_pool[slot].lock);
+    }
+    free(sa_pool);
+    sa_pool = NULL;
+    sa_pool_size = 0;
+}
+
+/**
+ * @brief Function: mariadb_pool_acquire
+ * Locks the calling thread's connection, or any idle one while that is busy, and makes sure it is connected. While
+ * every connection is busy, statements the thread left running are collected before waiting for another thread's.
+ * @param wait: uint8, 0 to return NULL rather than wait for a busy connection
+ * @return sa_mariadb_conn_t*: Locked connection to pass to mariadb_pool_release, NULL if none could be connected
+ **/
+static sa_mariadb_conn_t* mariadb_pool_acquire(uint8_t wait)
+{
+    sa_mariadb_conn_t* conn = NULL;
+    uint32_t slot;
+    uint32_t i;
+
+    if (sa_pool == NULL)
+    {
+        return NULL;
+    }
+    if (sa_pool_affinity_generation != sa_pool_generation)
+    {
+        sa_pool_affinity_slot = __atomic_fetch_add(&sa_pool_next_slot, 1, __ATOMIC_RELAXED) % sa_pool_size;
+        sa_pool_affinity_generation = sa_pool_generation;
+    }
+    while (conn == NULL)
+    {
+        for (i = 0; i < sa_pool_size; i++)
+        {
+            slot = (sa_pool_affinity_slot + i) % sa_pool_size;
+            if (pthread_mutex_trylock(&sa_pool[slot].lock) == 0)
+            {
+                conn = &sa_pool[slot];
+                break;
+            }
+        }
+        if ((conn == NULL) && !wait)
+        {
+            return NULL;
+        }
+        if ((conn == NULL) && !sa_async_complete_one())
+        {
+            conn = &sa_pool[sa_pool_affinity_slot];
+            pthread_mutex_lock(&conn->lock);
+        }
+    }
+
+    // Health check
+    if ((conn->con != NULL) && (sa_pool_health_check_ms != 0) &&
+        ((mariadb_now_ms() - conn->last_used_ms) >= sa_pool_health_check_ms) && (mysql_ping(conn->con) != 0))
+    {
+        fprintf(stderr, "%s, reconnecting\n", mysql_error(conn->con));
+        mariadb_conn_close(conn);
+    }
+    if ((conn->con == NULL) && (mariadb_conn_open(conn) != CRYPTO_LIB_SUCCESS))
+    {
+        pthread_mutex_unlock(&conn->lock);
+        return NULL;
+    }
+    return conn;
+}
+
+/**
+ * @brief Function: mariadb_pool_release
+ * @param conn: sa_mariadb_conn_t*, from mariadb_pool_acquire
+ **/
+static void mariadb_pool_release(sa_mariadb_conn_t* conn)
+{
+    conn->last_used_ms = mariadb_now_ms();
+    pthread_mutex_unlock(&conn->lock);
+}
+
+/**
+ * @brief Function: mariadb_conn_open
+ * Connects with the configured TLS options and prepares and binds the statements. Closes the connection on failure.
+ * @param conn: sa_mariadb_conn_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t mariadb_conn_open(sa_mariadb_conn_t* conn)
+{
+    int32_t status = mariadb_connect(&conn->con);
+
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = mariadb_conn_prepare(conn, SQL_SADB_GET_SA_BY_SPI, &conn->stmt_get_sa_by_spi);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = mariadb_conn_prepare(conn, SQL_SADB_GET_SA_BY_GVCID, &conn->stmt_get_sa_by_gvcid);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = mariadb_conn_prepare(conn, SQL_SADB_UPDATE_IV_ARC_BY_SPI, &conn->stmt_update_iv_arc_by_spi);
+    }
+    if ((status == CRYPTO_LIB_SUCCESS) && sa_cache_enabled)
+    {
+        // Needs the sadb_version table, re-running create_sadb.sql adds it to an existing sadb
+        status = mariadb_conn_prepare(conn, SQL_SADB_GET_VERSION, &conn->stmt_get_sadb_version);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = mariadb_conn_bind_statements(conn);
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        mariadb_conn_close(conn);
+    }
+    conn->last_used_ms = mariadb_now_ms();
+    return status;
+}
+
+/**
+ * @brief Function: mariadb_conn_close
+ * @param conn: sa_mariadb_conn_t*
+ **/
+static void mariadb_conn_close(sa_mariadb_conn_t* conn)
+{
+    if (conn->stmt_get_sa_by_spi != NULL)
+    {
+        mysql_stmt_close(conn->stmt_get_sa_by_spi);
+        conn->stmt_get_sa_by_spi = NULL;
+    }
+    if (conn->stmt_get_sa_by_gvcid != NULL)
+    {
+        mysql_stmt_close(conn->stmt_get_sa_by_gvcid);
+        conn->stmt_get_sa_by_gvcid = NULL;
+    }
+    if (conn->stmt_update_iv_arc_by_spi != NULL)
+    {
+        mysql_stmt_close(conn->stmt_update_iv_arc_by_spi);
+        conn->stmt_update_iv_arc_by_spi = NULL;
+    }
+    if (conn->stmt_get_sadb_version != NULL)
+    {
+        mysql_stmt_close(conn->stmt_get_sadb_version);
+        conn->stmt_get_sadb_version = NULL;
+    }
+    if (conn->con != NULL)
+    {
+        mysql_close(conn->con);
+        conn->con = NULL;
+    }
+}
+
+/**
+ * @brief Function: mariadb_conn_execute
+ * Executes one of the connection's statements, reopening the connection and retrying once if the server went away
+ * @param conn: sa_mariadb_conn_t*
+ * @param stmt: MYSQL_STMT**, member of conn, refreshed if the connection is reopened
+ * @return int32: Success/Failure
+ **/
+static int32_t mariadb_conn_execute(sa_mariadb_conn_t* conn, MYSQL_STMT** stmt)
+{
+    unsigned int err;
+
+    if (*stmt == NULL)
+    {
+        return SADB_QUERY_FAILED;
+    }
+    if (mysql_stmt_execute(*stmt) == 0)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    err = mysql_stmt_errno(*stmt);
+    fprintf(stderr, "%s\n", mysql_stmt_error(*stmt)); // todo - push failure message to error stack
+    if ((err != CR_SERVER_GONE_ERROR) && (err != CR_SERVER_LOST))
+    {
+        return SADB_QUERY_FAILED;
+    }
+
+    mariadb_conn_close(conn);
+    if (mariadb_conn_open(conn) != CRYPTO_LIB_SUCCESS)
+    {
+        return SADB_MARIADB_CONNECTION_FAILED;
+    }
+    if (mysql_stmt_execute(*stmt))
+    {
+        fprintf(stderr, "%s\n", mysql_stmt_error(*stmt)); // todo - push failure message to error stack
+        return SADB_QUERY_FAILED;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: mariadb_conn_set_update_params
+ * Fills the parameters of the connection's IV/ARSN update with the counters of an SA
+ * @param conn: sa_mariadb_conn_t*
+ * @param sa: const SecurityAssociation_t*
+ **/
+static void mariadb_conn_set_update_params(sa_mariadb_conn_t* conn, const SecurityAssociation_t* sa)
+{
+    memcpy(conn->update_param_iv, sa->iv, sa->iv_len);
+    conn->update_param_length[SA_MARIADB_UPDATE_IV] = sa->iv_len;
+    memcpy(conn->update_param_arsn, sa->arsn, sa->arsn_len);
+    conn->update_param_length[SA_MARIADB_UPDATE_ARSN] = sa->arsn_len;
+    conn->update_param_int[SA_MARIADB_UPDATE_SPI] = sa->spi;
+    conn->update_param_int[SA_MARIADB_UPDATE_TFVN] = sa->gvcid_blk.tfvn;
+    conn->update_param_int[SA_MARIADB_UPDATE_SCID] = sa->gvcid_blk.scid;
+    conn->update_param_int[SA_MARIADB_UPDATE_VCID] = sa->gvcid_blk.vcid;
+    conn->update_param_int[SA_MARIADB_UPDATE_MAPID] = sa->gvcid_blk.mapid;
+}
+
+/*
+** SA Cache Functions
+** With Crypto_Config_MariaDB_Cache, SAs read from the database are kept and frames are served from the cache. The
+** triggers in create_sadb.sql bump sadb_version whenever an SA changes other than through its IV and ARSN, and the
+** cache is dropped when a poll sees a new version. IV and ARSN saves go to the cache as well as the database, so
+** the cache assumes it belongs to the only CryptoLib instance sending on its SAs. The cache is shared by every pooled
+** connection and guarded by sa_cache_lock.
+*/
+/**
+ * @brief Function: sa_cache_check_version
+ * Polls sadb_version once sa_cache_poll_interval_ms has passed since the last poll, on every call if it is 0
+ * @param conn: sa_mariadb_conn_t*, acquired by the caller
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_cache_check_version(sa_mariadb_conn_t* conn)
+{
+    int32_t status;
+    uint64_t now;
+    uint8_t due;
+
+    if (!sa_cache_enabled)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    now = mariadb_now_ms();
+    pthread_mutex_lock(&sa_cache_lock);
+    due = !sa_cache_polled || ((now - sa_cache_last_poll_ms) >= sa_cache_poll_interval_ms);
+    pthread_mutex_unlock(&sa_cache_lock);
+    if (!due)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+
+    status = mariadb_conn_execute(conn, &conn->stmt_get_sadb_version);
+    if ((status == CRYPTO_LIB_SUCCESS) &&
+        (mysql_stmt_store_result(conn->stmt_get_sadb_version) || (mysql_stmt_fetch(conn->stmt_get_sadb_version) != 0)))
+    {
+        fprintf(stderr, "%s\n", mysql_stmt_error(conn->stmt_get_sadb_version)); // todo - push failure message to error stack
+        status = SADB_QUERY_FAILED;
+    }
+    if (conn->stmt_get_sadb_version != NULL)
+    {
+        mysql_stmt_free_result(conn->stmt_get_sadb_version);
+    }
+
+    pthread_mutex_lock(&sa_cache_lock);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        // Coherence is unknown until a poll succeeds
+        sa_cache_clear();
+        sa_cache_polled = 0;
+    }
+    else
+    {
+        if (!sa_cache_polled || (conn->version_result != sa_cache_version))
+        {
+            sa_cache_clear();
+            sa_cache_version = conn->version_result;
+        }
+        sa_cache_polled = 1;
+        sa_cache_last_poll_ms = now;
+    }
+    pthread_mutex_unlock(&sa_cache_lock);
+    return status;
+}
+
+/**
+ * @brief Function: sa_cache_find
+ * Called with sa_cache_lock held, like the other cache functions unless they say otherwise
+ * @param spi: uint16
+ * @return SecurityAssociation_t*: The cached SA, NULL if it is not cached
+ **/
+static SecurityAssociation_t* sa_cache_find(uint16_t spi)
+{
+    sa_cache_entry_t* entry;
+
+    if (!sa_cache_enabled)
+    {
+        return NULL;
+    }
+    for (entry = sa_cache[spi & (SA_MARIADB_CACHE_BUCKETS - 1)]; entry != NULL; entry = entry->next)
+    {
+        if (entry->sa.spi == spi)
+        {
+            return &entry->sa;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Function: sa_cache_find_gvcid
+ * @param tfvn: uint8
+ * @param scid: uint16
+ * @param vcid: uint16
+ * @param mapid: uint8
+ * @return SecurityAssociation_t*: The cached operational SA for the GVCID, NULL if there is none
+ **/
+static SecurityAssociation_t* sa_cache_find_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid)
+{
+    sa_cache_gvcid_entry_t* entry;
+    SecurityAssociation_t* sa;
+
+    if (!sa_cache_enabled)
+    {
+        return NULL;
+    }
+    for (entry = sa_cache_gvcid[sa_cache_gvcid_hash(tfvn, scid, vcid, mapid)]; entry != NULL; entry = entry->next)
+    {
+        if ((entry->gvcid.tfvn == tfvn) && (entry->gvcid.scid == scid) && (entry->gvcid.vcid == vcid) &&
+            (entry->gvcid.mapid == mapid))
+        {
+            sa = sa_cache_find(entry->spi);
+            if ((sa != NULL) && (sa->sa_state == SA_OPERATIONAL))
+            {
+                return sa;
+            }
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Function: sa_cache_insert
+ * Caches a copy of an SA read from the database, replacing any cached copy. Allocation failures only leave the SA
+ * uncached. Takes sa_cache_lock.
+ * @param sa: const SecurityAssociation_t*
+ * @param operational: uint8, the SA was read as the operational SA of its GVCID
+ * @param generation: uint32, sa_cache_generation before the read, the SA may be stale if the cache was cleared since
+ **/
+static void sa_cache_insert(const SecurityAssociation_t* sa, uint8_t operational, uint32_t generation)
+{
+    if (!sa_cache_enabled)
+    {
+        return;
+    }
+    pthread_mutex_lock(&sa_cache_lock);
+    if (generation == sa_cache_generation)
+    {
+        sa_cache_insert_locked(sa, operational);
+    }
+    pthread_mutex_unlock(&sa_cache_lock);
+}
+
+static void sa_cache_insert_locked(const SecurityAssociation_t* sa, uint8_t operational)
+{
+    sa_cache_entry_t* entry;
+    sa_cache_gvcid_entry_t* gvcid_entry;
+    SecurityAssociation_t* cached;
+    uint32_t bucket;
+
+    cached = sa_cache_find(sa->spi);
+    if (cached != NULL)
+    {
+        mariadb_release_sa(cached);
+    }
+    else
+    {
+        entry = malloc(sizeof(sa_cache_entry_t));
+        if (entry == NULL)
+        {
+            return;
+        }
+        bucket = sa->spi & (SA_MARIADB_CACHE_BUCKETS - 1);
+        entry->next = sa_cache[bucket];
+        sa_cache[bucket] = entry;
+        cached = &entry->sa;
+    }
+    *cached = *sa;
+    cached->abm = NULL;
+    cached->abm_idx = 0;
+    if (sa->abm != NULL)
+    {
+        Crypto_SA_Set_ABM(cached, sa->abm, ABM_SIZE);
+        cached->abm_len = sa->abm_len;
+    }
+    cached->ek_ref = mariadb_copy_string(sa->ek_ref);
+    cached->ak_ref = mariadb_copy_string(sa->ak_ref);
+
+    if (!operational)
+    {
+        return;
+    }
+    bucket = sa_cache_gvcid_hash(sa->gvcid_blk.tfvn, sa->gvcid_blk.scid, sa->gvcid_blk.vcid, sa->gvcid_blk.mapid);
+    for (gvcid_entry = sa_cache_gvcid[bucket]; gvcid_entry != NULL; gvcid_entry = gvcid_entry->next)
+    {
+        if ((gvcid_entry->gvcid.tfvn == sa->gvcid_blk.tfvn) && (gvcid_entry->gvcid.scid == sa->gvcid_blk.scid) &&
+            (gvcid_entry->gvcid.vcid == sa->gvcid_blk.vcid) && (gvcid_entry->gvcid.mapid == sa->gvcid_blk.mapid))
+        {
+            gvcid_entry->spi = sa->spi;
+            return;
+        }
+    }
+    gvcid_entry = malloc(sizeof(sa_cache_gvcid_entry_t));
+    if (gvcid_entry != NULL)
+    {
+        gvcid_entry->gvcid = sa->gvcid_blk;
+        gvcid_entry->spi = sa->spi;
+        gvcid_entry->next = sa_cache_gvcid[bucket];
+        sa_cache_gvcid[bucket] = gvcid_entry;
+    }
+}
+
+/**
+ * @brief Function: sa_cache_update_counters
+ * Takes sa_cache_lock
+ * @param sa: const SecurityAssociation_t*, a copy handed out by the cache or read from the database
+ **/
+static void sa_cache_update_counters(const SecurityAssociation_t* sa)
+{
+    SecurityAssociation_t* cached;
+
+    if (!sa_cache_enabled)
+    {
+        return;
+    }
+    pthread_mutex_lock(&sa_cache_lock);
+    cached = sa_cache_find(sa->spi);
+    if (cached != NULL)
+    {
+        memcpy(cached->iv, sa->iv, IV_SIZE);
+        memcpy(cached->arsn, sa->arsn, ARSN_SIZE);
+    }
+    pthread_mutex_unlock(&sa_cache_lock);
+}
+
+/**
+ * @brief Function: sa_cache_clear
+ **/
+static void sa_cache_clear(void)
+{
+    sa_cache_entry_t* entry;
+    sa_cache_gvcid_entry_t* gvcid_entry;
+    uint32_t bucket;
+
+    sa_cache_generation++;
+    for (bucket = 0; bucket < SA_MARIADB_CACHE_BUCKETS; bucket++)
+    {
+        while (sa_cache[bucket] != NULL)
+        {
+            entry = sa_cache[bucket];
+            sa_cache[bucket] = entry->next;
+            mariadb_release_sa(&entry->sa);
+            free(entry);
+        }
+        while (sa_cache_gvcid[bucket] != NULL)
+        {
+            gvcid_entry = sa_cache_gvcid[bucket];
+            sa_cache_gvcid[bucket] = gvcid_entry->next;
+            free(gvcid_entry);
+        }
+    }
+}
+
+/**
+ * @brief Function: sa_cache_copy
+ * Hands out a copy of a cached SA, owned by the caller like one read from the database and freed by sa_save_sa
+ * @param cached: const SecurityAssociation_t*
+ * @param security_association: SecurityAssociation_t**
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_cache_copy(const SecurityAssociation_t* cached, SecurityAssociation_t** security_association)
+{
+    SecurityAssociation_t* sa = malloc(sizeof(SecurityAssociation_t));
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    if (sa == NULL)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    *sa = *cached;
+    sa->abm = NULL;
+    sa->abm_idx = 0;
+    if (cached->abm != NULL)
+    {
+        status = Crypto_SA_Set_ABM(sa, cached->abm, ABM_SIZE);
+        sa->abm_len = cached->abm_len;
+    }
+    sa->ek_ref = mariadb_copy_string(cached->ek_ref);
+    sa->ak_ref = mariadb_copy_string(cached->ak_ref);
+    *security_association = sa;
+    return status;
+}
+
+/**
+ * @brief Function: sa_cache_gvcid_hash
+ * @return uint32: Bucket of the GVCID index
+ **/
+static uint32_t sa_cache_gvcid_hash(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid)
+{
+    uint32_t key = ((uint32_t)tfvn << 28) ^ ((uint32_t)scid << 12) ^ ((uint32_t)vcid << 6) ^ mapid;
+    key *= 0x9E3779B1u; // Fibonacci hashing, the top bits are the best mixed
+    return key >> 24;
+}
+
+/*
+** Write-Behind Functions
+** With Crypto_Config_MariaDB_Write_Behind, sa_save_sa only records the IV and ARSN of the SPI and returns. A writer
+** thread commits every SPI with a new save as one transaction of batched updates, once flush_frames saves have queued
+** or the oldest has waited flush_interval_ms, and sa_close flushes whatever is left. SAs read from the database get
+** the queued counters laid over them, so lookups never see counters older than the last save.
+*/
+/**
+ * @brief Function: sa_write_behind_start
+ * Opens the writer's connection, prepares the batch update and starts the writer
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_write_behind_start(void)
+{
+    pthread_condattr_t cond_attr;
+    size_t len;
+    uint32_t row;
+    MYSQL_BIND* bind;
+
+    sa_write_behind_flush_frames = sa_mariadb_config->write_behind_flush_frames;
+    sa_write_behind_flush_interval_ms = sa_mariadb_config->write_behind_flush_interval_ms;
+    sa_write_behind_max_staleness_ms = sa_mariadb_config->write_behind_max_staleness_ms;
+
+    // Updates every listed row in one statement, SA_MARIADB_FLUSH_BATCH_ROWS at a time
+    len = snprintf(sa_flush_sql, SA_MARIADB_FLUSH_SQL_SIZE,
+                   "UPDATE security_associations AS s JOIN (SELECT ? AS spi,? AS tfvn,? AS scid,? AS vcid,? AS mapid"
+                   ",? AS iv,? AS arsn");
+    for (row = 1; row < SA_MARIADB_FLUSH_BATCH_ROWS; row++)
+    {
+        len += snprintf(sa_flush_sql + len, SA_MARIADB_FLUSH_SQL_SIZE - len, " UNION ALL SELECT ?,?,?,?,?,?,?");
+    }
+    snprintf(sa_flush_sql + len, SA_MARIADB_FLUSH_SQL_SIZE - len,
+             ") AS u ON s.spi=u.spi AND s.tfvn=u.tfvn AND s.scid=u.scid AND s.vcid=u.vcid AND s.mapid=u.mapid"
+             " SET s.iv=u.iv, s.arsn=u.arsn");
+
+    if (mariadb_connect(&con_writer) != CRYPTO_LIB_SUCCESS)
+    {
+        return SADB_MARIADB_CONNECTION_FAILED;
+    }
+    stmt_flush_iv_arsn = mysql_stmt_init(con_writer);
+    if ((stmt_flush_iv_arsn == NULL) || mysql_stmt_prepare(stmt_flush_iv_arsn, sa_flush_sql, strlen(sa_flush_sql)))
+    {
+        if (stmt_flush_iv_arsn != NULL)
+        {
+            fprintf(stderr, "%s\n", mysql_stmt_error(stmt_flush_iv_arsn));
+            mysql_stmt_close(stmt_flush_iv_arsn);
+            stmt_flush_iv_arsn = NULL;
+        }
+        return finish_with_error(&con_writer, SADB_QUERY_FAILED);
+    }
+    for (row = 0; row < SA_MARIADB_FLUSH_BATCH_ROWS; row++)
+    {
+        bind = &sa_flush_bind[row * SA_MARIADB_FLUSH_ROW_PARAMS];
+        mariadb_bind_int(&bind[0], &sa_flush_batch[row].spi);
+        mariadb_bind_int(&bind[1], &sa_flush_batch[row].tfvn);
+        mariadb_bind_int(&bind[2], &sa_flush_batch[row].scid);
+        mariadb_bind_int(&bind[3], &sa_flush_batch[row].vcid);
+        mariadb_bind_int(&bind[4], &sa_flush_batch[row].mapid);
+        mariadb_bind_buffer(&bind[5], MYSQL_TYPE_BLOB, sa_flush_batch[row].iv, IV_SIZE, &sa_flush_batch[row].iv_len);
+        mariadb_bind_buffer(&bind[6], MYSQL_TYPE_BLOB, sa_flush_batch[row].arsn, ARSN_SIZE,
+                            &sa_flush_batch[row].arsn_len);
+    }
+    if (mysql_stmt_bind_param(stmt_flush_iv_arsn, sa_flush_bind) || mysql_autocommit(con_writer, 0))
+    {
+        fprintf(stderr, "%s\n", mysql_stmt_error(stmt_flush_iv_arsn));
+        mysql_stmt_close(stmt_flush_iv_arsn);
+        stmt_flush_iv_arsn = NULL;
+        return finish_with_error(&con_writer, SADB_QUERY_FAILED);
+    }
+
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&sa_wb.wake, &cond_attr);
+    pthread_cond_init(&sa_wb.flushed, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    memset(&sa_wb.stats, 0, sizeof(sa_wb.stats));
+    sa_wb.running = CRYPTO_TRUE;
+    sa_write_behind_enabled = CRYPTO_TRUE;
+    if (pthread_create(&sa_wb.thread, NULL, sa_write_behind_thread, crypto_context_current) != 0)
+    {
+        sa_wb.running = CRYPTO_FALSE;
+        sa_write_behind_enabled = CRYPTO_FALSE;
+        return CRYPTO_LIB_ERROR;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_write_behind_stop
+ * Stops the writer, flushes what is still queued and frees the queue
+ **/
+static void sa_write_behind_stop(void)
+{
+    sa_write_behind_entry_t* entry;
+    uint32_t bucket;
+
+    pthread_mutex_lock(&sa_wb.lock);
+    if (sa_wb.running)
+    {
+        sa_wb.running = CRYPTO_FALSE;
+        pthread_cond_broadcast(&sa_wb.wake);
+        pthread_cond_broadcast(&sa_wb.flushed);
+        pthread_mutex_unlock(&sa_wb.lock);
+        pthread_join(sa_wb.thread, NULL);
+        sa_write_behind_flush();
+        pthread_mutex_lock(&sa_wb.lock);
+        if (sa_wb.dirty != NULL)
+        {
+            fprintf(stderr, "Error: sa_close() lost %u queued IV/ARSN updates\n", sa_wb.stats.num_pending);
+        }
+        pthread_cond_destroy(&sa_wb.wake);
+        pthread_cond_destroy(&sa_wb.flushed);
+    }
+    for (bucket = 0; bucket < SA_MARIADB_CACHE_BUCKETS; bucket++)
+    {
+        while (sa_wb.entries[bucket] != NULL)
+        {
+            entry = sa_wb.entries[bucket];
+            sa_wb.entries[bucket] = entry->next;
+            free(entry);
+        }
+    }
+    sa_wb.dirty = NULL;
+    sa_wb.oldest_dirty_ms = 0;
+    sa_wb.oldest_flushing_ms = 0;
+    sa_wb.saves_since_flush = 0;
+    sa_wb.flush_requested = CRYPTO_FALSE;
+    sa_wb.stats.num_pending = 0;
+    sa_write_behind_enabled = CRYPTO_FALSE;
+    pthread_mutex_unlock(&sa_wb.lock);
+
+    free(sa_flush_rows);
+    sa_flush_rows = NULL;
+    sa_flush_rows_capacity = 0;
+    if (stmt_flush_iv_arsn != NULL)
+    {
+        mysql_stmt_close(stmt_flush_iv_arsn);
+        stmt_flush_iv_arsn = NULL;
+    }
+    if (con_writer != NULL)
+    {
+        mysql_close(con_writer);
+        con_writer = NULL;
+    }
+}
+
+/**
+ * @brief Function: sa_write_behind_thread
+ * Flushes when a save asks for it or the oldest queued save reaches flush_interval_ms, until stopped by sa_close
+ * @param arg: CryptoContext_t*, the context the backend was brought up in
+ **/
+static void* sa_write_behind_thread(void* arg)
+{
+    uint64_t oldest;
+    uint64_t now;
+
+    // Reads the configuration of the context that started the backend
+    Crypto_Context_Enter((CryptoContext_t*)arg);
+    pthread_mutex_lock(&sa_wb.lock);
+    while (sa_wb.running)
+    {
+        oldest = sa_wb.oldest_dirty_ms;
+        now = mariadb_now_ms();
+        if (!sa_wb.flush_requested &&
+            ((oldest == 0) || ((now - oldest) < sa_write_behind_flush_interval_ms)))
+        {
+            sa_write_behind_wait((oldest == 0) ? 0 : (uint32_t)(oldest + sa_write_behind_flush_interval_ms - now));
+            continue;
+        }
+        pthread_mutex_unlock(&sa_wb.lock);
+        sa_write_behind_flush();
+        pthread_mutex_lock(&sa_wb.lock);
+    }
+    pthread_mutex_unlock(&sa_wb.lock);
+    return NULL;
+}
+
+// Waits on sa_wb.wake, for at most timeout_ms unless it is 0. Called with sa_wb.lock held.
+static void sa_write_behind_wait(uint32_t timeout_ms)
+{
+    struct timespec wake_time;
+
+    if (timeout_ms == 0)
+    {
+        pthread_cond_wait(&sa_wb.wake, &sa_wb.lock);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &wake_time);
+    wake_time.tv_sec += timeout_ms / 1000;
+    wake_time.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (wake_time.tv_nsec >= 1000000000)
+    {
+        wake_time.tv_sec++;
+        wake_time.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&sa_wb.wake, &sa_wb.lock, &wake_time);
+}
+
+/**
+ * @brief Function: sa_write_behind_save
+ * Queues the IV and ARSN of an SA, replacing any update already queued for its SPI. Waits for the writer while the
+ * oldest queued save is older than max_staleness_ms.
+ * @param sa: const SecurityAssociation_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_write_behind_save(const SecurityAssociation_t* sa)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    sa_write_behind_entry_t* entry;
+    uint32_t bucket = sa->spi & (SA_MARIADB_CACHE_BUCKETS - 1);
+    uint32_t generation;
+    uint64_t now = mariadb_now_ms();
+    uint64_t oldest;
+
+    pthread_mutex_lock(&sa_wb.lock);
+    for (entry = sa_wb.entries[bucket]; entry != NULL; entry = entry->next)
+    {
+        if (entry->spi == sa->spi)
+        {
+            break;
+        }
+    }
+    if (entry == NULL)
+    {
+        entry = calloc(1, sizeof(sa_write_behind_entry_t));
+        if (entry == NULL)
+        {
+            pthread_mutex_unlock(&sa_wb.lock);
+            return CRYPTO_LIB_ERROR;
+        }
+        entry->spi = sa->spi;
+        entry->next = sa_wb.entries[bucket];
+        sa_wb.entries[bucket] = entry;
+    }
+    entry->gvcid = sa->gvcid_blk;
+    entry->iv_len = (sa->iv_len < IV_SIZE) ? sa->iv_len : IV_SIZE;
+    memcpy(entry->iv, sa->iv, entry->iv_len);
+    entry->arsn_len = (sa->arsn_len < ARSN_SIZE) ? sa->arsn_len : ARSN_SIZE;
+    memcpy(entry->arsn, sa->arsn, entry->arsn_len);
+    entry->num_saves++;
+    if (!entry->dirty)
+    {
+        entry->dirty = CRYPTO_TRUE;
+        entry->next_dirty = sa_wb.dirty;
+        sa_wb.dirty = entry;
+        sa_wb.stats.num_pending++;
+        if (sa_wb.oldest_dirty_ms == 0)
+        {
+            sa_wb.oldest_dirty_ms = now;
+        }
+    }
+    sa_wb.stats.num_saves++;
+    sa_wb.saves_since_flush++;
+    if ((sa_write_behind_flush_frames != 0) && (sa_wb.saves_since_flush >= sa_write_behind_flush_frames))
+    {
+        sa_wb.flush_requested = CRYPTO_TRUE;
+        pthread_cond_signal(&sa_wb.wake);
+    }
+
+    if (sa_write_behind_max_staleness_ms != 0)
+    {
+        oldest = sa_write_behind_oldest_ms();
+        if ((oldest != 0) && ((now - oldest) >= sa_write_behind_max_staleness_ms))
+        {
+            sa_wb.stats.num_stale_waits++;
+        }
+        while (sa_wb.running && (oldest != 0) && ((mariadb_now_ms() - oldest) >= sa_write_behind_max_staleness_ms))
+        {
+            generation = sa_wb.flush_generation;
+            sa_wb.flush_requested = CRYPTO_TRUE;
+            pthread_cond_signal(&sa_wb.wake);
+            while (sa_wb.running && (generation == sa_wb.flush_generation))
+            {
+                pthread_cond_wait(&sa_wb.flushed, &sa_wb.lock);
+            }
+            if (sa_wb.last_flush_failed)
+            {
+                status = SADB_MARIADB_WRITE_BEHIND_STALE;
+                break;
+            }
+            oldest = sa_write_behind_oldest_ms();
+        }
+    }
+    pthread_mutex_unlock(&sa_wb.lock);
+    return status;
+}
+
+// Oldest save not yet committed, 0 if there is none. Called with sa_wb.lock held.
+static uint64_t sa_write_behind_oldest_ms(void)
+{
+    if ((sa_wb.oldest_flushing_ms != 0) &&
+        ((sa_wb.oldest_dirty_ms == 0) || (sa_wb.oldest_flushing_ms < sa_wb.oldest_dirty_ms)))
+    {
+        return sa_wb.oldest_flushing_ms;
+    }
+    return sa_wb.oldest_dirty_ms;
+}
+
+/**
+ * @brief Function: sa_write_behind_overlay
+ * Replaces the counters of an SA read from the database with those queued or being flushed for it
+ * @param sa: SecurityAssociation_t*
+ **/
+static void sa_write_behind_overlay(SecurityAssociation_t* sa)
+{
+    sa_write_behind_entry_t* entry;
+
+    if (!sa_write_behind_enabled)
+    {
+        return;
+    }
+    pthread_mutex_lock(&sa_wb.lock);
+    for (entry = sa_wb.entries[sa->spi & (SA_MARIADB_CACHE_BUCKETS - 1)]; entry != NULL; entry = entry->next)
+    {
+        if ((entry->spi == sa->spi) && (entry->dirty || entry->flushing))
+        {
+            memcpy(sa->iv, entry->iv, entry->iv_len);
+            memcpy(sa->arsn, entry->arsn, entry->arsn_len);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sa_wb.lock);
+}
+
+/**
+ * @brief Function: sa_write_behind_flush
+ * Takes the dirty list and commits it in one transaction. A failed flush puts its updates back on the dirty list,
+ * unless a newer save already has. Only one flush runs at a time: the writer's, or sa_close's once the writer stopped.
+ **/
+static void sa_write_behind_flush(void)
+{
+    sa_write_behind_entry_t* entry;
+    sa_flush_row_t* flush_row;
+    uint32_t num_rows = 0;
+    uint32_t num_saves = 0;
+    uint32_t row;
+    uint64_t start_ms;
+    uint64_t oldest;
+    double latency_ms;
+    int32_t status;
+
+    pthread_mutex_lock(&sa_wb.lock);
+    sa_wb.flush_requested = CRYPTO_FALSE;
+    if (sa_wb.dirty == NULL)
+    {
+        sa_wb.last_flush_failed = CRYPTO_FALSE;
+        sa_wb.flush_generation++;
+        pthread_cond_broadcast(&sa_wb.flushed);
+        pthread_mutex_unlock(&sa_wb.lock);
+        return;
+    }
+    if (sa_flush_rows_capacity < sa_wb.stats.num_pending)
+    {
+        flush_row = realloc(sa_flush_rows, sa_wb.stats.num_pending * sizeof(sa_flush_row_t));
+        if (flush_row == NULL)
+        {
+            sa_wb.stats.num_flush_failures++;
+            sa_wb.last_flush_failed = CRYPTO_TRUE;
+            sa_wb.flush_generation++;
+            pthread_cond_broadcast(&sa_wb.flushed);
+            pthread_mutex_unlock(&sa_wb.lock);
+            return;
+        }
+        sa_flush_rows = flush_row;
+        sa_flush_rows_capacity = sa_wb.stats.num_pending;
+    }
+    for (entry = sa_wb.dirty; entry != NULL; entry = entry->next_dirty)
+    {
+        flush_row = &sa_flush_rows[num_rows++];
+        flush_row->spi = entry->spi;
+        flush_row->tfvn = entry->gvcid.tfvn;
+        flush_row->scid = entry->gvcid.scid;
+        flush_row->vcid = entry->gvcid.vcid;
+        flush_row->mapid = entry->gvcid.mapid;
+        memcpy(flush_row->iv, entry->iv, entry->iv_len);
+        flush_row->iv_len = entry->iv_len;
+        memcpy(flush_row->arsn, entry->arsn, entry->arsn_len);
+        flush_row->arsn_len = entry->arsn_len;
+        flush_row->num_saves = entry->num_saves;
+        num_saves += entry->num_saves;
+        entry->num_saves = 0;
+        entry->dirty = CRYPTO_FALSE;
+        entry->flushing = CRYPTO_TRUE;
+    }
+    oldest = sa_wb.oldest_dirty_ms;
+    sa_wb.dirty = NULL;
+    sa_wb.stats.num_pending = 0;
+    sa_wb.oldest_dirty_ms = 0;
+    sa_wb.oldest_flushing_ms = oldest;
+    sa_wb.saves_since_flush = 0;
+    pthread_mutex_unlock(&sa_wb.lock);
+
+    start_ms = mariadb_now_ms();
+    status = sa_write_behind_write_rows(num_rows);
+    latency_ms = (double)(mariadb_now_ms() - start_ms);
+
+    pthread_mutex_lock(&sa_wb.lock);
+    for (row = 0; row < num_rows; row++)
+    {
+        for (entry = sa_wb.entries[sa_flush_rows[row].spi & (SA_MARIADB_CACHE_BUCKETS - 1)]; entry != NULL;
+             entry = entry->next)
+        {
+            if (entry->spi == sa_flush_rows[row].spi)
+            {
+                break;
+            }
+        }
+        entry->flushing = CRYPTO_FALSE;
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            entry->num_saves += sa_flush_rows[row].num_saves;
+        }
+        if ((status != CRYPTO_LIB_SUCCESS) && !entry->dirty)
+        {
+            entry->dirty = CRYPTO_TRUE;
+            entry->next_dirty = sa_wb.dirty;
+            sa_wb.dirty = entry;
+            sa_wb.stats.num_pending++;
+        }
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        sa_wb.stats.num_flushes++;
+        sa_wb.stats.num_rows_written += num_rows;
+        sa_wb.stats.num_saves_flushed += num_saves;
+        sa_wb.stats.coalescing_ratio = (double)sa_wb.stats.num_saves_flushed / (double)sa_wb.stats.num_rows_written;
+        sa_wb.stats.last_flush_latency_ms = latency_ms;
+        if (sa_wb.stats.num_flushes == 1)
+        {
+            sa_wb.stats.ewma_flush_latency_ms = latency_ms;
+        }
+        else
+        {
+            sa_wb.stats.ewma_flush_latency_ms += SA_MARIADB_EWMA_ALPHA * (latency_ms - sa_wb.stats.ewma_flush_latency_ms);
+        }
+        if (latency_ms > sa_wb.stats.max_flush_latency_ms)
+        {
+            sa_wb.stats.max_flush_latency_ms = latency_ms;
+        }
+    }
+    else
+    {
+        sa_wb.stats.num_flush_failures++;
+        if ((sa_wb.oldest_dirty_ms == 0) || (oldest < sa_wb.oldest_dirty_ms))
+        {
+            sa_wb.oldest_dirty_ms = oldest;
+        }
+    }
+    sa_wb.oldest_flushing_ms = 0;
+    sa_wb.last_flush_failed = (status != CRYPTO_LIB_SUCCESS);
+    sa_wb.flush_generation++;
+    pthread_cond_broadcast(&sa_wb.flushed);
+    pthread_mutex_unlock(&sa_wb.lock);
+}
+
+/**
+ * @brief Function: sa_write_behind_write_rows
+ * Writes sa_flush_rows in batches of SA_MARIADB_FLUSH_BATCH_ROWS and commits them. A short last batch repeats its
+ * last row, which updates that row to the same values again.
+ * @param num_rows: uint32
+ * @return int32: Success/Failure
+ **/
+static int32_t sa_write_behind_write_rows(uint32_t num_rows)
+{
+    uint32_t first;
+    uint32_t row;
+
+    for (first = 0; first < num_rows; first += SA_MARIADB_FLUSH_BATCH_ROWS)
+    {
+        for (row = 0; row < SA_MARIADB_FLUSH_BATCH_ROWS; row++)
+        {
+            sa_flush_batch[row] = sa_flush_rows[((first + row) < num_rows) ? (first + row) : (num_rows - 1)];
+        }
+        if (mysql_stmt_execute(stmt_flush_iv_arsn))
+        {
+            fprintf(stderr, "%s\n", mysql_stmt_error(stmt_flush_iv_arsn)); // todo - push failure message to error stack
+            mysql_rollback(con_writer);
+            return SADB_QUERY_FAILED;
+        }
+    }
+    if (mysql_commit(con_writer))
+    {
+        fprintf(stderr, "%s\n", mysql_error(con_writer));
+        mysql_rollback(con_writer);
+        return SADB_QUERY_FAILED;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: Crypto_Get_MariaDB_Write_Behind_Stats
+ *  Reports write-behind queue, coalescing and flush latency statistics of the MariaDB SA backend.
+ * @param stats: SadbMariaDBWriteBehindStats_t* to populate, zeroed while write-behind is off
+ * @return int32_t: Success/Failure
+**/
+int32_t Crypto_Get_MariaDB_Write_Behind_Stats(SadbMariaDBWriteBehindStats_t* stats)
+{
+    if (stats == NULL)
+    {
+        return CRYPTO_LIB_ERR_NULL_BUFFER;
+    }
+    pthread_mutex_lock(&sa_wb.lock);
+    *stats = sa_wb.stats;
+    pthread_mutex_unlock(&sa_wb.lock);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/*
+** Nonblocking I/O Functions
+** Between sa_batch_begin and sa_batch_end, a thread may leave statements running on pooled connections while it
+** encrypts: lookups started by sa_prefetch_operational_sa_from_gvcid, collected by its next lookup of that GVCID, and
+** IV/ARSN saves, collected once they finish or by sa_batch_end. They use the Connector/C _start / _cont calls and move
+** along whenever the thread calls into the backend. A lookup that ran before one of the thread's saves reached the
+** database would miss it, so SAs the thread reads during its batch get its last saves laid over them. A save that
+** fails is retried on a reopened connection with blocking calls, and sa_batch_end reports it if that fails too.
+** Running statements hold their connection, so a batch only overlaps anything with a pool of several connections,
+** and a thread must end its batch before sa_close.
+*/
+/**
+ * @brief Function: sa_batch_begin
+ * @return int32: Success
+ **/
+static int32_t sa_batch_begin(void)
+{
+    sa_async_complete_all();
+    sa_async_batch = 1;
+    sa_async_num_saves = 0;
+    sa_async_status = CRYPTO_LIB_SUCCESS;
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_prefetch_operational_sa_from_gvcid
+ * Starts looking up the operational SA of a GVCID, unless the cache has it or every connection is busy
+ * @return int32: Success, a lookup that could not start is left to sa_get_operational_sa_from_gvcid
+ **/
+static int32_t sa_prefetch_operational_sa_from_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid)
+{
+    sa_mariadb_async_t* op;
+    sa_mariadb_conn_t* conn;
+    uint32_t generation;
+    uint8_t cached;
+
+    if (!sa_async_batch)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    sa_async_poll();
+    if (sa_async_find_prefetch(tfvn, scid, vcid, mapid) != NULL)
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+    pthread_mutex_lock(&sa_cache_lock);
+    generation = sa_cache_generation;
+    cached = (sa_cache_find_gvcid(tfvn, scid, vcid, mapid) != NULL);
+    pthread_mutex_unlock(&sa_cache_lock);
+    if (cached || ((op = sa_async_free_op()) == NULL) || ((conn = mariadb_pool_acquire(0)) == NULL))
+    {
+        return CRYPTO_LIB_SUCCESS;
+    }
+
+    conn->param_int[0] = tfvn;
+    conn->param_int[1] = scid;
+    conn->param_int[2] = vcid;
+    conn->param_int[3] = mapid;
+    conn->param_int[4] = SA_OPERATIONAL;
+    op->gvcid.tfvn = tfvn;
+    op->gvcid.scid = scid;
+    op->gvcid.vcid = vcid;
+    op->gvcid.mapid = mapid;
+    op->generation = generation;
+    op->save_seq = sa_async_oldest_save();
+    sa_async_start(op, conn, &conn->stmt_get_sa_by_gvcid, SA_MARIADB_ASYNC_PREFETCH);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: sa_batch_end
+ * Waits for the saves the calling thread left running and drops the lookups it did not use
+ * @return int32: First save of the batch that failed, Success otherwise
+ **/
+static int32_t sa_batch_end(void)
+{
+    int32_t status;
+
+    sa_async_complete_all();
+    status = sa_async_status;
+    sa_async_batch = 0;
+    sa_async_num_saves = 0;
+    sa_async_status = CRYPTO_LIB_SUCCESS;
+    return status;
+}
+
+/**
+ * @brief Function: sa_async_find_prefetch
+ * @return sa_mariadb_async_t*: The calling thread's lookup of the GVCID, NULL if there is none
+ **/
+static sa_mariadb_async_t* sa_async_find_prefetch(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid)
+{
+    sa_mariadb_async_t* op;
+    uint32_t i;
+
+    for (i = 0; i < SA_MARIADB_ASYNC_OPS; i++)
+    {
+        op = &sa_async_ops[i];
+        if ((op->conn != NULL) && (op->kind == SA_MARIADB_ASYNC_PREFETCH) && (op->gvcid.tfvn == tfvn) &&
+            (op->gvcid.scid == scid) && (op->gvcid.vcid == vcid) && (op->gvcid.mapid == mapid))
+        {
+            return op;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Function: sa_async_take_prefetch
+ * Waits for a lookup and parses its row, unless the SA may have changed in a way the overlays cannot make up for
+ * @param op: sa_mariadb_async_t*, collected in either case
+ * @param security_association: SecurityAssociation_t**
+ * @param status: int32_t*, set when the lookup is used
+ * @return uint8: 1 if the lookup was used, 0 if it has to be run again
+ **/
+static uint8_t sa_async_take_prefetch(sa_mariadb_async_t* op, SecurityAssociation_t** security_association,
+                                      int32_t* status)
+{
+    sa_mariadb_conn_t* conn = op->conn;
+    uint32_t generation = op->generation;
+    uint8_t usable;
+
+    sa_async_step(op, 1);
+    usable = (op->status == CRYPTO_LIB_SUCCESS) &&
+             ((sa_async_num_saves - op->save_seq) <= SA_MARIADB_ASYNC_SAVES) &&
+             (sa_cache_check_version(conn) == CRYPTO_LIB_SUCCESS);
+    pthread_mutex_lock(&sa_cache_lock);
+    usable = usable && (sa_cache_generation == generation);
+    pthread_mutex_unlock(&sa_cache_lock);
+    if (!usable)
+    {
+        sa_async_complete(op);
+        return 0;
+    }
+
+    *status = parse_sa_from_stored_result(conn, op->stmt, security_association);
+    op->conn = NULL;
+    mariadb_pool_release(conn);
+    if (*status == CRYPTO_LIB_SUCCESS)
+    {
+        sa_async_overlay(*security_association);
+        sa_write_behind_overlay(*security_association);
+        sa_cache_insert(*security_association, 1, generation);
+    }
+    return 1;
+}
+
+/**
+ * @brief Function: sa_async_start_save
+ * Starts the IV/ARSN update of an SA on an idle connection
+ * @param sa: const SecurityAssociation_t*, already passed to sa_async_record_save
+ * @return uint8: 1 if the update is running, 0 if it has to be made with blocking calls
+ **/
+static uint8_t sa_async_start_save(const SecurityAssociation_t* sa)
+{
+    sa_mariadb_async_t* op;
+    sa_mariadb_conn_t* conn;
+
+    sa_async_poll();
+    if (((op = sa_async_free_op()) == NULL) || ((conn = mariadb_pool_acquire(0)) == NULL))
+    {
+        return 0;
+    }
+    mariadb_conn_set_update_params(conn, sa);
+    op->save_seq = sa_async_num_saves - 1;
+    sa_async_start(op, conn, &conn->stmt_update_iv_arc_by_spi, SA_MARIADB_ASYNC_SAVE);
+    return 1;
+}
+
+/**
+ * @brief Function: sa_async_record_save
+ * Keeps the counters saved during a batch for sa_async_overlay
+ * @param sa: const SecurityAssociation_t*
+ **/
+static void sa_async_record_save(const SecurityAssociation_t* sa)
+{
+    sa_async_save_t* save;
+
+    if (!sa_async_batch)
+    {
+        return;
+    }
+    save = &sa_async_saves[sa_async_num_saves % SA_MARIADB_ASYNC_SAVES];
+    save->spi = sa->spi;
+    save->iv_len = sa->iv_len;
+    memcpy(save->iv, sa->iv, sa->iv_len);
+    save->arsn_len = sa->arsn_len;
+    memcpy(save->arsn, sa->arsn, sa->arsn_len);
+    sa_async_num_saves++;
+}
+
+/**
+ * @brief Function: sa_async_overlay
+ * Lays the calling thread's last saves of its batch over an SA read from the database, oldest first
+ * @param sa: SecurityAssociation_t*
+ **/
+static void sa_async_overlay(SecurityAssociation_t* sa)
+{
+    const sa_async_save_t* save;
+    uint32_t seq = 0;
+
+    if (!sa_async_batch)
+    {
+        return;
+    }
+    if (sa_async_num_saves > SA_MARIADB_ASYNC_SAVES)
+    {
+        seq = sa_async_num_saves - SA_MARIADB_ASYNC_SAVES;
+    }
+    for (; seq < sa_async_num_saves; seq++)
+    {
+        save = &sa_async_saves[seq % SA_MARIADB_ASYNC_SAVES];
+        if (save->spi == sa->spi)
+        {
+            memcpy(sa->iv, save->iv, save->iv_len);
+            memcpy(sa->arsn, save->arsn, save->arsn_len);
+        }
+    }
+}
+
+/**
+ * @brief Function: sa_async_free_op
+ * @return sa_mariadb_async_t*: Unused slot of the calling thread, NULL if it has SA_MARIADB_ASYNC_OPS running
+ **/
+static sa_mariadb_async_t* sa_async_free_op(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < SA_MARIADB_ASYNC_OPS; i++)
+    {
+        if (sa_async_ops[i].conn == NULL)
+        {
+            return &sa_async_ops[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Function: sa_async_oldest_save
+ * @return uint32: Number of the calling thread's oldest save still running, or of its next save
+ **/
+static uint32_t sa_async_oldest_save(void)
+{
+    uint32_t oldest = sa_async_num_saves;
+    uint32_t i;
+
+    for (i = 0; i < SA_MARIADB_ASYNC_OPS; i++)
+    {
+        if ((sa_async_ops[i].conn != NULL) && (sa_async_ops[i].kind == SA_MARIADB_ASYNC_SAVE) &&
+            (sa_async_ops[i].save_seq < oldest))
+        {
+            oldest = sa_async_ops[i].save_seq;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief Function: sa_async_start
+ * Starts executing one of a held connection's statements, its parameters already set
+ * @param op: sa_mariadb_async_t*, free slot
+ * @param conn: sa_mariadb_conn_t*, from mariadb_pool_acquire, released when op is collected
+ * @param stmt: MYSQL_STMT**, member of conn
+ * @param kind: uint8, SaMariaDBAsyncKind
+ **/
+static void sa_async_start(sa_mariadb_async_t* op, sa_mariadb_conn_t* conn, MYSQL_STMT** stmt, uint8_t kind)
+{
+    op->conn = conn;
+    op->stmt = stmt;
+    op->kind = kind;
+    op->stage = SA_MARIADB_ASYNC_EXECUTE;
+    op->status = CRYPTO_LIB_SUCCESS;
+    op->result = 0;
+    op->wait_status = 0;
+    if (*stmt == NULL)
+    {
+        op->status = SADB_QUERY_FAILED;
+        op->stage = SA_MARIADB_ASYNC_DONE;
+        return;
+    }
+    op->wait_status = mysql_stmt_execute_start(&op->result, *stmt);
+    sa_async_step(op, 0);
+}
+
+/**
+ * @brief Function: sa_async_step
+ * Continues a running statement as far as its socket allows. A lookup stores its result once it executed.
+ * @param op: sa_mariadb_async_t*
+ * @param block: uint8, 1 to wait until the statement is done
+ **/
+static void sa_async_step(sa_mariadb_async_t* op, uint8_t block)
+{
+    int ready;
+
+    while (op->stage != SA_MARIADB_ASYNC_DONE)
+    {
+        if (op->wait_status != 0)
+        {
+            ready = sa_async_wait(op->conn->con, op->wait_status, block);
+            if ((ready == 0) && !block)
+            {
+                return;
+            }
+            if (ready == 0)
+            {
+                continue;
+            }
+            if (op->stage == SA_MARIADB_ASYNC_EXECUTE)
+            {
+                op->wait_status = mysql_stmt_execute_cont(&op->result, *op->stmt, ready);
+            }
+            else
+            {
+                op->wait_status = mysql_stmt_store_result_cont(&op->result, *op->stmt, ready);
+            }
+            continue;
+        }
+
+        // The call of this stage returned
+        if (op->result != 0)
+        {
+            fprintf(stderr, "%s\n", mysql_stmt_error(*op->stmt)); // todo - push failure message to error stack
+            op->status = SADB_QUERY_FAILED;
+            op->stage = SA_MARIADB_ASYNC_DONE;
+        }
+        else if ((op->stage == SA_MARIADB_ASYNC_EXECUTE) && (op->kind == SA_MARIADB_ASYNC_PREFETCH))
+        {
+            op->stage = SA_MARIADB_ASYNC_STORE;
+            op->wait_status = mysql_stmt_store_result_start(&op->result, *op->stmt);
+        }
+        else
+        {
+            op->stage = SA_MARIADB_ASYNC_DONE;
+        }
+    }
+}
+
+/**
+ * @brief Function: sa_async_wait
+ * Polls the socket of a connection for what a _start / _cont call waits for
+ * @param con: MYSQL*
+ * @param wait_status: int, MYSQL_WAIT_* flags returned by the call
+ * @param block: uint8, 1 to wait as long as the connection's timeout allows
+ * @return int: MYSQL_WAIT_* flags to pass to the next _cont call, 0 if nothing is ready yet
+ **/
+static int sa_async_wait(MYSQL* con, int wait_status, uint8_t block)
+{
+    struct pollfd pfd;
+    int timeout_ms = 0;
+    int ready = 0;
+    int rc;
+
+    pfd.fd = mysql_get_socket(con);
+    pfd.events = 0;
+    pfd.revents = 0;
+    if (wait_status & MYSQL_WAIT_READ)
+    {
+        pfd.events |= POLLIN;
+    }
+    if (wait_status & MYSQL_WAIT_WRITE)
+    {
+        pfd.events |= POLLOUT;
+    }
+    if (wait_status & MYSQL_WAIT_EXCEPT)
+    {
+        pfd.events |= POLLPRI;
+    }
+    if (block)
+    {
+        timeout_ms = (wait_status & MYSQL_WAIT_TIMEOUT) ? (int)mysql_get_timeout_value_ms(con) : -1;
+    }
+
+    rc = poll(&pfd, 1, timeout_ms);
+    if ((rc < 0) && (errno == EINTR))
+    {
+        return 0;
+    }
+    if (rc <= 0)
+    {
+        // Let the connector fail the statement rather than poll a broken socket forever
+        return block ? MYSQL_WAIT_TIMEOUT : 0;
+    }
+    if (pfd.revents & (POLLIN | POLLERR | POLLHUP | POLLNVAL))
+    {
+        ready |= MYSQL_WAIT_READ;
+    }
+    if (pfd.revents & POLLOUT)
+    {
+        ready |= MYSQL_WAIT_WRITE;
+    }
+    if (pfd.revents & POLLPRI)
+    {
+        ready |= MYSQL_WAIT_EXCEPT;
+    }
+    return ready;
+}
+
+/**
+ * @brief Function: sa_async_poll
+ * Moves the calling thread's statements along without waiting, and collects the saves that finished
+ **/
+static void sa_async_poll(void)
+{
+    sa_mariadb_async_t* op;
+    uint32_t i;
+
+    for (i = 0; i < SA_MARIADB_ASYNC_OPS; i++)
+    {
+        op = &sa_async_ops[i];
+        if (op->conn == NULL)
+        {
+            continue;
+        }
+        sa_async_step(op, 0);
+        if ((op->kind == SA_MARIADB_ASYNC_SAVE) && (op->stage == SA_MARIADB_ASYNC_DONE))
+        {
+            sa_async_complete(op);
+        }
+    }
+}
+
+/**
+ * @brief Function: sa_async_complete
+ * Waits for a statement and releases its connection, dropping a lookup's result. A connection whose statement failed
+ * is closed, and a failed save retried on it once reopened.
+ * @param op: sa_mariadb_async_t*
+ **/
+static void sa_async_complete(sa_mariadb_async_t* op)
+{
+    sa_mariadb_conn_t* conn = op->conn;
+
+    sa_async_step(op, 1);
+    if (op->status == CRYPTO_LIB_SUCCESS)
+    {
+        if (op->kind == SA_MARIADB_ASYNC_PREFETCH)
+        {
+            mysql_stmt_free_result(*op->stmt);
+        }
+    }
+    else
+    {
+        mariadb_conn_close(conn);
+        if (op->kind == SA_MARIADB_ASYNC_SAVE)
+        {
+            // The update parameters stay set, the next acquire reopens the connection if this fails
+            op->status = mariadb_conn_open(conn);
+            if (op->status == CRYPTO_LIB_SUCCESS)
+            {
+                op->status = mariadb_conn_execute(conn, op->stmt);
+            }
+            if ((op->status != CRYPTO_LIB_SUCCESS) && (sa_async_status == CRYPTO_LIB_SUCCESS))
+            {
+                sa_async_status = op->status;
+            }
+        }
+    }
+    op->conn = NULL;
+    mariadb_pool_release(conn);
+}
+
+/**
+ * @brief Function: sa_async_complete_one
+ * @return uint8: 1 if one of the calling thread's statements was collected, 0 if it has none running
+ **/
+static uint8_t sa_async_complete_one(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < SA_MARIADB_ASYNC_OPS; i++)
+    {
+        if (sa_async_ops[i].conn != NULL)
+        {
+            sa_async_complete(&sa_async_ops[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Function: sa_async_complete_all
+ **/
+static void sa_async_complete_all(void)
+{
+    while (sa_async_complete_one())
+    {
+    }
+}
+
+static int32_t finish_with_error(MYSQL **con_loc, int err)
+{
+    fprintf(stderr, "%s\n", mysql_error(*con_loc)); // todo - if query fails, need to push failure message to error stack
+    mysql_close(*con_loc);
+    *con_loc = NULL;
+    return err;
+}
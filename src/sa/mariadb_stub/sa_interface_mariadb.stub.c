@@ -12,6 +12,7 @@
  * foreign persons.
  */
 
+#include "crypto.h"
 #include "sa_interface.h"
 
 static SaInterfaceStruct sa_routine;
@@ -20,4 +21,10 @@ SaInterface get_sa_interface_mariadb(void)
 {
     fprintf(stderr,"ERROR: Loading mariadb stub source code. Rebuild CryptoLib with -DSA_MARIADB=ON to use proper MariaDB implementation.\n");
     return &sa_routine;
+}
+
+int32_t Crypto_Get_MariaDB_Write_Behind_Stats(SadbMariaDBWriteBehindStats_t* stats)
+{
+    stats = stats;
+    return SADB_INVALID_SADB_TYPE;
 }
\ No newline at end of file
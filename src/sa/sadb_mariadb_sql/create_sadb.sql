@@ -4,34 +4,67 @@ USE sadb;
 
 -- IV_LEN should probably not have that default -- to be reviewed.
 
+-- Counters and masks are binary columns read and written as-is by the backend's prepared statements. IV and ARSN are
+-- fixed width, iv_len and arsn_len give the bytes in use; ABM is longer than BINARY allows and stays VARBINARY.
+-- Existing databases are converted by migrate_sadb_binary_schema.sql.
+
 CREATE TABLE IF NOT EXISTS security_associations
 (
-  spi INT NOT NULL
-  ,ekid VARCHAR(100) CHARACTER SET utf8 DEFAULT NULL -- 'EG, for KMC Crypto KeyRef, 'kmc/test/KEY130', for libgcrypt '130'
-  ,akid VARCHAR(100) CHARACTER SET utf8 DEFAULT NULL -- Same as ekid
-  ,sa_state SMALLINT NOT NULL DEFAULT 0
-  ,tfvn TINYINT NOT NULL
-  ,scid SMALLINT NOT NULL
-  ,vcid TINYINT NOT NULL
-  ,mapid TINYINT NOT NULL DEFAULT 0
+  spi SMALLINT UNSIGNED NOT NULL
+  ,ekid VARCHAR(100) CHARACTER SET ascii DEFAULT NULL -- 'EG, for KMC Crypto KeyRef, 'kmc/test/KEY130', for libgcrypt '130'
+  ,akid VARCHAR(100) CHARACTER SET ascii DEFAULT NULL -- Same as ekid
+  ,sa_state TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,tfvn TINYINT UNSIGNED NOT NULL
+  ,scid SMALLINT UNSIGNED NOT NULL
+  ,vcid TINYINT UNSIGNED NOT NULL
+  ,mapid TINYINT UNSIGNED NOT NULL DEFAULT 0
   ,lpid SMALLINT
-  ,est SMALLINT NOT NULL DEFAULT 0
-  ,ast SMALLINT NOT NULL DEFAULT 0
-  ,shivf_len SMALLINT NOT NULL DEFAULT 0
-  ,shsnf_len SMALLINT NOT NULL DEFAULT 0
-  ,shplf_len SMALLINT NOT NULL DEFAULT 0
-  ,stmacf_len SMALLINT NOT NULL DEFAULT 0
-  ,ecs_len SMALLINT NOT NULL DEFAULT 1
-  ,ecs VARBINARY(4) NOT NULL DEFAULT X'01' -- ECS_SIZE=4
-  ,iv_len SMALLINT NOT NULL DEFAULT 0
-  ,iv VARBINARY(20) DEFAULT NULL -- IV_SIZE=12
-  ,acs_len SMALLINT NOT NULL DEFAULT 0
-  ,acs VARBINARY(4) NOT NULL DEFAULT X'00'
-  ,abm_len MEDIUMINT
-  ,abm VARBINARY(1024) NOT NULL DEFAULT X'0000FC0000FFFF000000000000000000000000' -- ABM_SIZE=1024
-  ,arsn_len SMALLINT NOT NULL DEFAULT 0
-  ,arsn VARBINARY(20) NOT NULL DEFAULT X'0000000000000000000000000000000000000000' -- ARSN_SIZE=20 , TBD why so large...
-  ,arsnw SMALLINT NOT NULL DEFAULT 0 -- ARSNW_SIZE=1
+  ,est TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,ast TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,shivf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,shsnf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,shplf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,stmacf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,ecs_len TINYINT UNSIGNED NOT NULL DEFAULT 1
+  ,ecs BINARY(4) NOT NULL DEFAULT X'01' -- ECS_SIZE=4
+  ,iv_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,iv BINARY(16) DEFAULT NULL -- IV_SIZE=16
+  ,acs_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,acs BINARY(4) NOT NULL DEFAULT X'00'
+  ,abm_len SMALLINT UNSIGNED
+  ,abm VARBINARY(1786) NOT NULL DEFAULT X'0000FC0000FFFF000000000000000000000000' -- ABM_SIZE=1786
+  ,arsn_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,arsn BINARY(20) NOT NULL DEFAULT X'0000000000000000000000000000000000000000' -- ARSN_SIZE=20
+  ,arsnw SMALLINT UNSIGNED NOT NULL DEFAULT 0 -- ARSNW_SIZE=1
+  ,PRIMARY KEY (spi,tfvn,scid,vcid,mapid)
+  -- Resolves the whole predicate of the operational SA lookup and, through the primary key, yields SPIs in order
+  ,INDEX gvcid_state (tfvn,scid,vcid,mapid,sa_state)
+);
+
+-- Bumped on every SA change except IV and ARSN saves, SA caches drop what they hold when it moves.
+-- Safe to re-run against an existing sadb to add it.
+CREATE TABLE IF NOT EXISTS sadb_version
+(
+  id TINYINT NOT NULL PRIMARY KEY DEFAULT 0
+  ,version BIGINT UNSIGNED NOT NULL DEFAULT 0
 );
 
-create unique index if not exists main_spi on security_associations (spi,scid,vcid,tfvn,mapid);
+INSERT IGNORE INTO sadb_version (id, version) VALUES (0, 0);
+
+CREATE TRIGGER IF NOT EXISTS sadb_version_insert AFTER INSERT ON security_associations FOR EACH ROW
+  UPDATE sadb_version SET version = version + 1 WHERE id = 0;
+
+CREATE TRIGGER IF NOT EXISTS sadb_version_delete AFTER DELETE ON security_associations FOR EACH ROW
+  UPDATE sadb_version SET version = version + 1 WHERE id = 0;
+
+CREATE TRIGGER IF NOT EXISTS sadb_version_update AFTER UPDATE ON security_associations FOR EACH ROW
+  UPDATE sadb_version SET version = version + 1 WHERE id = 0
+    AND NOT (NEW.spi <=> OLD.spi AND NEW.ekid <=> OLD.ekid AND NEW.akid <=> OLD.akid
+      AND NEW.sa_state <=> OLD.sa_state AND NEW.tfvn <=> OLD.tfvn AND NEW.scid <=> OLD.scid
+      AND NEW.vcid <=> OLD.vcid AND NEW.mapid <=> OLD.mapid AND NEW.lpid <=> OLD.lpid
+      AND NEW.est <=> OLD.est AND NEW.ast <=> OLD.ast AND NEW.shivf_len <=> OLD.shivf_len
+      AND NEW.shsnf_len <=> OLD.shsnf_len AND NEW.shplf_len <=> OLD.shplf_len
+      AND NEW.stmacf_len <=> OLD.stmacf_len AND NEW.ecs_len <=> OLD.ecs_len AND NEW.ecs <=> OLD.ecs
+      AND NEW.iv_len <=> OLD.iv_len AND NEW.acs_len <=> OLD.acs_len AND NEW.acs <=> OLD.acs
+      AND NEW.abm_len <=> OLD.abm_len AND NEW.abm <=> OLD.abm AND NEW.arsn_len <=> OLD.arsn_len
+      AND NEW.arsnw <=> OLD.arsnw);
@@ -1,3 +1,5 @@
 USE sadb;
 
 TRUNCATE TABLE security_associations;
+-- TRUNCATE does not fire the delete trigger
+UPDATE sadb_version SET version = version + 1 WHERE id = 0;
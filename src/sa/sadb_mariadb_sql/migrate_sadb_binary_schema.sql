@@ -0,0 +1,35 @@
+-- Converts a security_associations table created before the binary schema in create_sadb.sql.
+-- IV and ARSN become fixed width, shorter values are padded with zeros after iv_len / arsn_len bytes.
+-- Run as sa_admin while no CryptoLib instance is using the database.
+
+USE sadb;
+
+ALTER TABLE security_associations
+  MODIFY spi SMALLINT UNSIGNED NOT NULL
+  ,MODIFY ekid VARCHAR(100) CHARACTER SET ascii DEFAULT NULL
+  ,MODIFY akid VARCHAR(100) CHARACTER SET ascii DEFAULT NULL
+  ,MODIFY sa_state TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY tfvn TINYINT UNSIGNED NOT NULL
+  ,MODIFY scid SMALLINT UNSIGNED NOT NULL
+  ,MODIFY vcid TINYINT UNSIGNED NOT NULL
+  ,MODIFY mapid TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY est TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY ast TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY shivf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY shsnf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY shplf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY stmacf_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY ecs_len TINYINT UNSIGNED NOT NULL DEFAULT 1
+  ,MODIFY ecs BINARY(4) NOT NULL DEFAULT X'01'
+  ,MODIFY iv_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY iv BINARY(16) DEFAULT NULL
+  ,MODIFY acs_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY acs BINARY(4) NOT NULL DEFAULT X'00'
+  ,MODIFY abm_len SMALLINT UNSIGNED
+  ,MODIFY abm VARBINARY(1786) NOT NULL DEFAULT X'0000FC0000FFFF000000000000000000000000'
+  ,MODIFY arsn_len TINYINT UNSIGNED NOT NULL DEFAULT 0
+  ,MODIFY arsn BINARY(20) NOT NULL DEFAULT X'0000000000000000000000000000000000000000'
+  ,MODIFY arsnw SMALLINT UNSIGNED NOT NULL DEFAULT 0
+  ,DROP INDEX IF EXISTS main_spi
+  ,ADD PRIMARY KEY (spi,tfvn,scid,vcid,mapid)
+  ,ADD INDEX gvcid_state (tfvn,scid,vcid,mapid,sa_state);
@@ -0,0 +1,509 @@
+/*
+ * Copyright 2021, by the California Institute of Technology.
+ * ALL RIGHTS RESERVED. United States Government Sponsorship acknowledged.
+ * Any commercial use must be negotiated with the Office of Technology
+ * Transfer at the California Institute of Technology.
+ *
+ * This software may be subject to U.S. export control laws. By accepting
+ * this software, the user agrees to comply with all applicable U.S.
+ * export laws and regulations. User has the responsibility to obtain
+ * export licenses, or other export authority as may be required before
+ * exporting such information to foreign countries or providing access to
+ * foreign persons.
+ */
+
+#include "crypto.h"
+#include "crypto_context_internal.h"
+#include "crypto_config.h"
+#include "crypto_error.h"
+#include "crypto_print.h"
+#include "crypto_structs.h"
+#include "sa_interface.h"
+
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Security Association Initialization Functions
+static int32_t sa_config(void);
+static int32_t sa_init(void);
+static int32_t sa_close(void);
+// Security Association Interaction Functions
+static int32_t sa_get_from_spi(uint16_t, SecurityAssociation_t**);
+static int32_t sa_get_operational_sa_from_gvcid(uint8_t, uint16_t, uint16_t, uint8_t, SecurityAssociation_t**);
+static int32_t sa_save_sa(SecurityAssociation_t* sa);
+// Security Association Utility Functions
+static int32_t sa_stop(void);
+static int32_t sa_start(TC_t* tc_frame);
+static int32_t sa_expire(void);
+static int32_t sa_rekey(void);
+static int32_t sa_status(uint8_t* );
+static int32_t sa_create(void);
+static int32_t sa_setARSN(void);
+static int32_t sa_setARSNW(void);
+static int32_t sa_delete(void);
+// SQLite local functions
+static int32_t finish_with_error(int err);
+static int32_t sqlite_exec(const char* sql);
+static int32_t sqlite_prepare(const char* sql, sqlite3_stmt** stmt);
+static void sqlite_column_to_buffer(sqlite3_stmt* stmt, int col, uint8_t* dest_buffer, size_t dest_size);
+static char* sqlite_column_to_string(sqlite3_stmt* stmt, int col);
+static int32_t parse_sa_from_sqlite_stmt(sqlite3_stmt* stmt, SecurityAssociation_t** security_association);
+
+#define SA_SQLITE_BUSY_TIMEOUT_MS 1000
+
+// SQLite Schema, same table as sadb_mariadb_sql/create_sadb.sql with binary columns as BLOBs
+static const char* SQL_SADB_CREATE =
+        "CREATE TABLE IF NOT EXISTS security_associations"
+        "("
+        "  spi INTEGER NOT NULL"
+        "  ,ekid TEXT DEFAULT NULL"
+        "  ,akid TEXT DEFAULT NULL"
+        "  ,sa_state INTEGER NOT NULL DEFAULT 0"
+        "  ,tfvn INTEGER NOT NULL"
+        "  ,scid INTEGER NOT NULL"
+        "  ,vcid INTEGER NOT NULL"
+        "  ,mapid INTEGER NOT NULL DEFAULT 0"
+        "  ,lpid INTEGER"
+        "  ,est INTEGER NOT NULL DEFAULT 0"
+        "  ,ast INTEGER NOT NULL DEFAULT 0"
+        "  ,shivf_len INTEGER NOT NULL DEFAULT 0"
+        "  ,shsnf_len INTEGER NOT NULL DEFAULT 0"
+        "  ,shplf_len INTEGER NOT NULL DEFAULT 0"
+        "  ,stmacf_len INTEGER NOT NULL DEFAULT 0"
+        "  ,ecs_len INTEGER NOT NULL DEFAULT 1"
+        "  ,ecs BLOB NOT NULL DEFAULT X'01'"
+        "  ,iv_len INTEGER NOT NULL DEFAULT 0"
+        "  ,iv BLOB DEFAULT NULL"
+        "  ,acs_len INTEGER NOT NULL DEFAULT 0"
+        "  ,acs BLOB NOT NULL DEFAULT X'00'"
+        "  ,abm_len INTEGER"
+        "  ,abm BLOB NOT NULL DEFAULT X'0000FC0000FFFF000000000000000000000000'"
+        "  ,arsn_len INTEGER NOT NULL DEFAULT 0"
+        "  ,arsn BLOB NOT NULL DEFAULT X'0000000000000000000000000000000000000000'"
+        "  ,arsnw INTEGER NOT NULL DEFAULT 0"
+        ");"
+        "CREATE UNIQUE INDEX IF NOT EXISTS main_spi ON security_associations (spi,scid,vcid,tfvn,mapid);"
+        "CREATE INDEX IF NOT EXISTS gvcid_state ON security_associations (scid,vcid,tfvn,mapid,sa_state);";
+// SQLite Queries
+static const char* SQL_SADB_GET_SA_BY_SPI =
+        "SELECT "
+        "spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,ecs"
+        ",iv,iv_len,acs_len,acs,abm_len,abm,arsn_len,arsn,arsnw"
+        " FROM security_associations WHERE spi=?1";
+static const char* SQL_SADB_GET_SA_BY_GVCID =
+        "SELECT "
+        "spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,ecs"
+        ",iv,iv_len,acs_len,acs,abm_len,abm,arsn_len,arsn,arsnw"
+        " FROM security_associations WHERE tfvn=?1 AND scid=?2 AND vcid=?3 AND mapid=?4 AND sa_state=?5";
+static const char* SQL_SADB_UPDATE_IV_ARC_BY_SPI =
+        "UPDATE security_associations"
+        " SET iv=?1, arsn=?2"
+        " WHERE spi=?3 AND tfvn=?4 AND scid=?5 AND vcid=?6 AND mapid=?7";
+
+// Column order of the SELECT queries above
+typedef enum
+{
+    SA_SQLITE_COL_SPI = 0,
+    SA_SQLITE_COL_EKID,
+    SA_SQLITE_COL_AKID,
+    SA_SQLITE_COL_SA_STATE,
+    SA_SQLITE_COL_TFVN,
+    SA_SQLITE_COL_SCID,
+    SA_SQLITE_COL_VCID,
+    SA_SQLITE_COL_MAPID,
+    SA_SQLITE_COL_LPID,
+    SA_SQLITE_COL_EST,
+    SA_SQLITE_COL_AST,
+    SA_SQLITE_COL_SHIVF_LEN,
+    SA_SQLITE_COL_SHSNF_LEN,
+    SA_SQLITE_COL_SHPLF_LEN,
+    SA_SQLITE_COL_STMACF_LEN,
+    SA_SQLITE_COL_ECS_LEN,
+    SA_SQLITE_COL_ECS,
+    SA_SQLITE_COL_IV,
+    SA_SQLITE_COL_IV_LEN,
+    SA_SQLITE_COL_ACS_LEN,
+    SA_SQLITE_COL_ACS,
+    SA_SQLITE_COL_ABM_LEN,
+    SA_SQLITE_COL_ABM,
+    SA_SQLITE_COL_ARSN_LEN,
+    SA_SQLITE_COL_ARSN,
+    SA_SQLITE_COL_ARSNW
+} SaSqliteColumn;
+
+/*
+** Global Variables
+*/
+// Security
+static SaInterfaceStruct sa_if_struct;
+static sqlite3* db = NULL;
+// Prepared statements, compiled once in sa_init and reset between uses
+static sqlite3_stmt* stmt_get_sa_by_spi = NULL;
+static sqlite3_stmt* stmt_get_sa_by_gvcid = NULL;
+static sqlite3_stmt* stmt_update_iv_arc_by_spi = NULL;
+
+SaInterface get_sa_interface_sqlite(void)
+{
+    sa_if_struct.sa_config = sa_config;
+    sa_if_struct.sa_init = sa_init;
+    sa_if_struct.sa_close = sa_close;
+    sa_if_struct.sa_get_from_spi = sa_get_from_spi;
+    sa_if_struct.sa_get_operational_sa_from_gvcid = sa_get_operational_sa_from_gvcid;
+    sa_if_struct.sa_stop = sa_stop;
+    sa_if_struct.sa_save_sa = sa_save_sa;
+    sa_if_struct.sa_start = sa_start;
+    sa_if_struct.sa_expire = sa_expire;
+    sa_if_struct.sa_rekey = sa_rekey;
+    sa_if_struct.sa_status = sa_status;
+    sa_if_struct.sa_create = sa_create;
+    sa_if_struct.sa_setARSN = sa_setARSN;
+    sa_if_struct.sa_setARSNW = sa_setARSNW;
+    sa_if_struct.sa_delete = sa_delete;
+    return &sa_if_struct;
+}
+
+static int32_t sa_config(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t sa_init(void)
+{
+    int32_t status = CRYPTO_LIB_ERROR;
+
+    if (sa_sqlite_config == NULL)
+    {
+        return status;
+    }
+    sa_close();
+
+    if (sqlite3_open_v2(sa_sqlite_config->sqlite_path, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) !=
+        SQLITE_OK)
+    {
+        return finish_with_error(SADB_SQLITE_OPEN_FAILED);
+    }
+    sqlite3_busy_timeout(db, SA_SQLITE_BUSY_TIMEOUT_MS);
+
+    // WAL lets operators query the SADB while frames are being processed, and turns every save into a log append
+    status = sqlite_exec("PRAGMA journal_mode=WAL;");
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        if (sa_sqlite_config->sqlite_synchronous == SA_SQLITE_SYNC_FULL)
+        {
+            status = sqlite_exec("PRAGMA synchronous=FULL;");
+        }
+        else
+        {
+            status = sqlite_exec("PRAGMA synchronous=NORMAL;");
+        }
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sqlite_exec(SQL_SADB_CREATE);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sqlite_prepare(SQL_SADB_GET_SA_BY_SPI, &stmt_get_sa_by_spi);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sqlite_prepare(SQL_SADB_GET_SA_BY_GVCID, &stmt_get_sa_by_gvcid);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = sqlite_prepare(SQL_SADB_UPDATE_IV_ARC_BY_SPI, &stmt_update_iv_arc_by_spi);
+    }
+#ifdef DEBUG
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        printf("sa_init opened sqlite database %s successfully. \n", sa_sqlite_config->sqlite_path);
+    }
+#endif
+    return status;
+}//end int32_t sa_init()
+
+static int32_t sa_close(void)
+{
+    sqlite3_finalize(stmt_get_sa_by_spi);
+    sqlite3_finalize(stmt_get_sa_by_gvcid);
+    sqlite3_finalize(stmt_update_iv_arc_by_spi);
+    stmt_get_sa_by_spi = NULL;
+    stmt_get_sa_by_gvcid = NULL;
+    stmt_update_iv_arc_by_spi = NULL;
+    if (db)
+    {
+        sqlite3_close(db);
+        db = NULL;
+    }
+
+    return CRYPTO_LIB_SUCCESS;
+}
+
+// Security Association Interaction Functions
+static int32_t sa_get_from_spi(uint16_t spi, SecurityAssociation_t** security_association)
+{
+    if (stmt_get_sa_by_spi == NULL)
+    {
+        return SADB_QUERY_FAILED;
+    }
+    sqlite3_bind_int(stmt_get_sa_by_spi, 1, spi);
+
+    return parse_sa_from_sqlite_stmt(stmt_get_sa_by_spi, security_association);
+}
+static int32_t sa_get_operational_sa_from_gvcid(uint8_t tfvn, uint16_t scid, uint16_t vcid, uint8_t mapid,
+                                                  SecurityAssociation_t** security_association)
+{
+    if (stmt_get_sa_by_gvcid == NULL)
+    {
+        return SADB_QUERY_FAILED;
+    }
+    sqlite3_bind_int(stmt_get_sa_by_gvcid, 1, tfvn);
+    sqlite3_bind_int(stmt_get_sa_by_gvcid, 2, scid);
+    sqlite3_bind_int(stmt_get_sa_by_gvcid, 3, vcid);
+    sqlite3_bind_int(stmt_get_sa_by_gvcid, 4, mapid);
+    sqlite3_bind_int(stmt_get_sa_by_gvcid, 5, SA_OPERATIONAL);
+
+    return parse_sa_from_sqlite_stmt(stmt_get_sa_by_gvcid, security_association);
+}
+static int32_t sa_save_sa(SecurityAssociation_t* sa)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    if (sa == NULL)
+    {
+        return SADB_NULL_SA_USED;
+    }
+
+    if (stmt_update_iv_arc_by_spi == NULL)
+    {
+        status = SADB_QUERY_FAILED;
+    }
+    else
+    {
+        // The SA outlives the step, so the IV and ARSN are bound in place
+        sqlite3_bind_blob(stmt_update_iv_arc_by_spi, 1, sa->iv, sa->iv_len, SQLITE_STATIC);
+        sqlite3_bind_blob(stmt_update_iv_arc_by_spi, 2, sa->arsn, sa->arsn_len, SQLITE_STATIC);
+        sqlite3_bind_int(stmt_update_iv_arc_by_spi, 3, sa->spi);
+        sqlite3_bind_int(stmt_update_iv_arc_by_spi, 4, sa->gvcid_blk.tfvn);
+        sqlite3_bind_int(stmt_update_iv_arc_by_spi, 5, sa->gvcid_blk.scid);
+        sqlite3_bind_int(stmt_update_iv_arc_by_spi, 6, sa->gvcid_blk.vcid);
+        sqlite3_bind_int(stmt_update_iv_arc_by_spi, 7, sa->gvcid_blk.mapid);
+
+        if (sqlite3_step(stmt_update_iv_arc_by_spi) != SQLITE_DONE)
+        {
+            fprintf(stderr, "%s\n", sqlite3_errmsg(db)); // todo - push failure message to error stack
+            status = SADB_QUERY_FAILED;
+        }
+        sqlite3_reset(stmt_update_iv_arc_by_spi);
+        sqlite3_clear_bindings(stmt_update_iv_arc_by_spi);
+    }
+
+    // We free the allocated SA memory in the save function.
+    if (sa->ek_ref != NULL)
+        free(sa->ek_ref);
+    if (sa->ak_ref != NULL)
+        free(sa->ak_ref);
+    Crypto_SA_Release_ABM(sa);
+    free(sa);
+    return status;
+}
+// Security Association Utility Functions
+static int32_t sa_stop(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_start(TC_t* tc_frame)
+{
+    tc_frame = tc_frame;
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_expire(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_rekey(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_status(uint8_t* ingest)
+{
+    ingest = ingest;
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_create(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_setARSN(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_setARSNW(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+static int32_t sa_delete(void)
+{
+    return CRYPTO_LIB_SUCCESS;
+}
+
+// sa_if private helper functions
+static int32_t parse_sa_from_sqlite_stmt(sqlite3_stmt* stmt, SecurityAssociation_t** security_association)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    SecurityAssociation_t* sa = NULL;
+    int rc;
+
+#ifdef SA_DEBUG
+    fprintf(stderr, "SQLite Query: %s \n", sqlite3_expanded_sql(stmt));
+#endif
+
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_DONE) // No rows returned in query!!
+    {
+        status = SADB_QUERY_EMPTY_RESULTS;
+    }
+    else if (rc != SQLITE_ROW)
+    {
+        fprintf(stderr, "%s\n", sqlite3_errmsg(db)); // todo - push failure message to error stack
+        status = SADB_QUERY_FAILED;
+    }
+    else
+    {
+        sa = calloc(1, sizeof(SecurityAssociation_t));
+        if (sa == NULL)
+        {
+            status = CRYPTO_LIB_ERROR;
+        }
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        return status;
+    }
+
+    sa->spi = sqlite3_column_int(stmt, SA_SQLITE_COL_SPI);
+    if (sqlite3_column_type(stmt, SA_SQLITE_COL_EKID) != SQLITE_NULL)
+    {
+        if (crypto_config.cryptography_type == CRYPTOGRAPHY_TYPE_LIBGCRYPT)
+        {
+            sa->ekid = sqlite3_column_int(stmt, SA_SQLITE_COL_EKID);
+        }
+        else // Cryptography Type KMC Crypto Service with PKCS12 String Key References
+        {
+            sa->ekid = 0;
+            sa->ek_ref = sqlite_column_to_string(stmt, SA_SQLITE_COL_EKID);
+        }
+    }
+    if (sqlite3_column_type(stmt, SA_SQLITE_COL_AKID) != SQLITE_NULL)
+    {
+        if (crypto_config.cryptography_type == CRYPTOGRAPHY_TYPE_LIBGCRYPT)
+        {
+            sa->akid = sqlite3_column_int(stmt, SA_SQLITE_COL_AKID);
+        }
+        else // Cryptography Type KMC Crypto Service with PKCS12 String Key References
+        {
+            sa->ak_ref = sqlite_column_to_string(stmt, SA_SQLITE_COL_AKID);
+        }
+    }
+    sa->sa_state = sqlite3_column_int(stmt, SA_SQLITE_COL_SA_STATE);
+    sa->gvcid_blk.tfvn = sqlite3_column_int(stmt, SA_SQLITE_COL_TFVN);
+    sa->gvcid_blk.scid = sqlite3_column_int(stmt, SA_SQLITE_COL_SCID);
+    sa->gvcid_blk.vcid = sqlite3_column_int(stmt, SA_SQLITE_COL_VCID);
+    sa->gvcid_blk.mapid = sqlite3_column_int(stmt, SA_SQLITE_COL_MAPID);
+    sa->lpid = sqlite3_column_int(stmt, SA_SQLITE_COL_LPID);
+    sa->est = sqlite3_column_int(stmt, SA_SQLITE_COL_EST);
+    sa->ast = sqlite3_column_int(stmt, SA_SQLITE_COL_AST);
+    sa->shivf_len = sqlite3_column_int(stmt, SA_SQLITE_COL_SHIVF_LEN);
+    sa->shsnf_len = sqlite3_column_int(stmt, SA_SQLITE_COL_SHSNF_LEN);
+    sa->shplf_len = sqlite3_column_int(stmt, SA_SQLITE_COL_SHPLF_LEN);
+    sa->stmacf_len = sqlite3_column_int(stmt, SA_SQLITE_COL_STMACF_LEN);
+    sa->ecs_len = sqlite3_column_int(stmt, SA_SQLITE_COL_ECS_LEN);
+    sa->iv_len = sqlite3_column_int(stmt, SA_SQLITE_COL_IV_LEN);
+    sa->acs_len = sqlite3_column_int(stmt, SA_SQLITE_COL_ACS_LEN);
+    sa->abm_len = sqlite3_column_int(stmt, SA_SQLITE_COL_ABM_LEN);
+    sa->arsn_len = sqlite3_column_int(stmt, SA_SQLITE_COL_ARSN_LEN);
+    sa->arsnw = sqlite3_column_int(stmt, SA_SQLITE_COL_ARSNW);
+
+    if (sa->iv_len > 0)   sqlite_column_to_buffer(stmt, SA_SQLITE_COL_IV, sa->iv, IV_SIZE);
+    if (sa->arsn_len > 0) sqlite_column_to_buffer(stmt, SA_SQLITE_COL_ARSN, sa->arsn, ARSN_SIZE);
+    if (sa->abm_len > 0)
+    {
+        uint8_t abm[ABM_SIZE] = {0};
+        sqlite_column_to_buffer(stmt, SA_SQLITE_COL_ABM, abm, ABM_SIZE);
+        status = Crypto_SA_Set_ABM(sa, abm, sa->abm_len);
+    }
+    if (sa->ecs_len > 0)  sqlite_column_to_buffer(stmt, SA_SQLITE_COL_ECS, &sa->ecs, sizeof(sa->ecs));
+    if (sa->acs_len > 0)  sqlite_column_to_buffer(stmt, SA_SQLITE_COL_ACS, &sa->acs, sizeof(sa->acs));
+
+    //arsnw_len is not necessary for sqlite interface, putty dummy/default value for prints.
+    sa->arsnw_len = 1;
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+#ifdef DEBUG
+    printf("Parsed SA from SQLite Query:\n");
+    Crypto_saPrint(sa);
+#endif
+
+    *security_association = sa;
+    return status;
+}
+
+static void sqlite_column_to_buffer(sqlite3_stmt* stmt, int col, uint8_t* dest_buffer, size_t dest_size)
+{
+    const void* blob = sqlite3_column_blob(stmt, col);
+    size_t blob_len = (size_t)sqlite3_column_bytes(stmt, col);
+
+    if (blob != NULL)
+    {
+        memcpy(dest_buffer, blob, (blob_len < dest_size) ? blob_len : dest_size);
+    }
+}
+
+static char* sqlite_column_to_string(sqlite3_stmt* stmt, int col)
+{
+    const unsigned char* text = sqlite3_column_text(stmt, col);
+    size_t text_len = (size_t)sqlite3_column_bytes(stmt, col);
+    char* str = malloc(text_len + 1);
+
+    if (str != NULL)
+    {
+        memcpy(str, text, text_len);
+        str[text_len] = '\0';
+    }
+    return str;
+}
+
+static int32_t sqlite_exec(const char* sql)
+{
+    char* err_msg = NULL;
+
+    if (sqlite3_exec(db, sql, NULL, NULL, &err_msg) != SQLITE_OK)
+    {
+        fprintf(stderr, "%s\n", err_msg); // todo - push failure message to error stack
+        sqlite3_free(err_msg);
+        sa_close();
+        return SADB_QUERY_FAILED;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t sqlite_prepare(const char* sql, sqlite3_stmt** stmt)
+{
+    if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, stmt, NULL) != SQLITE_OK)
+    {
+        return finish_with_error(SADB_QUERY_FAILED);
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t finish_with_error(int err)
+{
+    fprintf(stderr, "%s\n", sqlite3_errmsg(db)); // todo - if query fails, need to push failure message to error stack
+    sa_close();
+    return err;
+}
@@ -0,0 +1,15 @@
+USE sadb;
+
+-- 4096 AES-GCM SAs on 64 spacecraft with 64 VCs each, SPIs 100 to 4195, every fourth one operational.
+-- Kept clear of the SPIs and SCIDs of the unit test scripts. Uses the sequence engine, loaded by default since 10.1.
+INSERT INTO security_associations (spi,ekid,sa_state,est,ast,shivf_len,iv_len,iv,stmacf_len,abm_len,abm,arsnw,arsn_len,tfvn,scid,vcid,mapid)
+SELECT seq,'130',IF(seq % 4 = 0,3,2),1,1,12,12,X'000000000000000000000001',16,19,X'00000000000000000000000000000000000000',5,0,0,256 + ((seq - 100) DIV 64),(seq - 100) % 64,0
+FROM seq_100_to_4195;
+
+-- Latency of the backend's lookups (r_total_time_ms), and the plan: the GVCID lookup should use gvcid_state with no
+-- filesort, the SPI lookup the primary key
+ANALYZE FORMAT=JSON SELECT spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,ecs,iv,iv_len,acs_len,acs,abm_len,abm,arsn_len,arsn,arsnw
+FROM security_associations WHERE tfvn=0 AND scid=300 AND vcid=32 AND mapid=0 AND sa_state=3 ORDER BY spi LIMIT 1;
+
+ANALYZE FORMAT=JSON SELECT spi,ekid,akid,sa_state,tfvn,scid,vcid,mapid,lpid,est,ast,shivf_len,shsnf_len,shplf_len,stmacf_len,ecs_len,ecs,iv,iv_len,acs_len,acs,abm_len,abm,arsn_len,arsn,arsnw
+FROM security_associations WHERE spi=2948 LIMIT 1;
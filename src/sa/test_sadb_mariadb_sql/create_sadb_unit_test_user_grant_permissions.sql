@@ -8,4 +8,5 @@ GRANT ALL PRIVILEGES ON sadb.* TO 'sa_admin'@'%';
 
 GRANT UPDATE (arsn) ON sadb.security_associations TO 'sa_user'@'%';
 GRANT UPDATE (iv) ON sadb.security_associations TO 'sa_user'@'%';
-GRANT SELECT ON sadb.security_associations TO 'sa_user'@'%';
\ No newline at end of file
+GRANT SELECT ON sadb.security_associations TO 'sa_user'@'%';
+GRANT SELECT ON sadb.sadb_version TO 'sa_user'@'%';
@@ -0,0 +1,1111 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/*******************************************************************************
+** KMC Crypto Service Stand-In
+** Serves the encrypt, decrypt, icv-create, icv-verify and CAM ssoToken endpoints
+** used by the KMC cryptography interface, backed by libgcrypt and a local test
+** key store. Latency and error injection make it usable for offline integration
+** tests and client load benchmarks, e.g.:
+**
+**   kmc_standin -p 8443 -l 2 -j 1 -e 0.01
+**   Crypto_Config_Kmc_Crypto_Service("http", "localhost", 8443, "crypto-service", ...);
+**
+** Pass -C/-K to serve HTTPS (requires a build with OpenSSL).
+*******************************************************************************/
+
+#include "kmc_standin.h"
+
+/*
+** Global Variables
+*/
+static volatile uint8_t keepRunning = 1;
+static int listen_fd = -1;
+static kmc_standin_config_t standin_config;
+static kmc_standin_key_t standin_keys[KMC_STANDIN_MAX_KEYS];
+static int standin_num_keys = 0;
+static uint8_t standin_token_secret[32];
+#ifdef KMC_STANDIN_TLS
+static SSL_CTX* ssl_ctx = NULL;
+#endif
+
+// Test keys, matching the internal key ring where the key references overlap
+static const struct
+{
+    const char* key_ref;
+    uint8_t algo;
+    const char* hex;
+} standin_default_keys[] = {
+    {"kmc/test/key128", KMC_STANDIN_ALGO_AES, "0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF"},
+    {"kmc/test/key130", KMC_STANDIN_ALGO_AES, "FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210"},
+    {"kmc/test/KEY130", KMC_STANDIN_ALGO_AES, "FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210"},
+    {"kmc/test/nist_cmac_90", KMC_STANDIN_ALGO_CMAC, "ff9f9284cf599eac3b119905a7d18851e7e374cf63aea04358586b0f757670f9"},
+    {"kmc/test/hmacsha256", KMC_STANDIN_ALGO_HMAC256, "ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789"},
+    {"kmc/test/nist_hmacsha256", KMC_STANDIN_ALGO_HMAC256, "ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789"},
+    {"kmc/test/hmacsha512", KMC_STANDIN_ALGO_HMAC512,
+     "ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789"
+     "9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA"},
+    {"kmc/test/nist_hmacsha512", KMC_STANDIN_ALGO_HMAC512,
+     "ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789ABCDEF0123456789"
+     "9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA9876543210FEDCBA"},
+};
+
+
+/*
+** Functions
+*/
+void kmc_standin_print_help(const char* argv0)
+{
+    printf("usage: %s [options]\n"
+           "----------------------------------------------------------------------\n"
+           "-p port         - Listen port (default %d)                            \n"
+           "-l ms           - Latency added to every crypto request               \n"
+           "-j ms           - Additional uniformly distributed latency jitter     \n"
+           "-e rate         - Fraction of crypto requests failed with HTTP 500    \n"
+           "-k file         - Key store, lines of '<keyRef> <algorithm> <hex>'    \n"
+           "                  algorithm: AES, AESCMAC, HmacSHA256, HmacSHA512     \n"
+           "-c              - Require a CAM SSO token cookie on crypto requests   \n"
+           "-t seconds      - CAM SSO token lifetime (default %d)                 \n"
+           "-C file -K file - TLS certificate and private key, serves HTTPS       \n"
+           "-h              - Display help                                        \n"
+           "\n",
+           argv0, KMC_STANDIN_DEFAULT_PORT, KMC_STANDIN_DEFAULT_TOKEN_LIFETIME);
+}
+
+static int32_t kmc_standin_hex_to_bytes(const char* hex, uint8_t* out, size_t max_len, uint8_t* out_len)
+{
+    size_t hex_len = strlen(hex);
+    if(hex_len % 2 != 0 || hex_len / 2 > max_len)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    for(size_t i = 0; i < hex_len / 2; i++)
+    {
+        unsigned int byte;
+        if(sscanf(&hex[i * 2], "%2x", &byte) != 1)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+        out[i] = (uint8_t)byte;
+    }
+    *out_len = (uint8_t)(hex_len / 2);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t kmc_standin_algo_from_str(const char* str, uint8_t* algo)
+{
+    if(strcmp(str, "AES") == 0)
+    {
+        *algo = KMC_STANDIN_ALGO_AES;
+    }
+    else if(strcmp(str, "AESCMAC") == 0)
+    {
+        *algo = KMC_STANDIN_ALGO_CMAC;
+    }
+    else if(strcmp(str, "HmacSHA256") == 0)
+    {
+        *algo = KMC_STANDIN_ALGO_HMAC256;
+    }
+    else if(strcmp(str, "HmacSHA512") == 0)
+    {
+        *algo = KMC_STANDIN_ALGO_HMAC512;
+    }
+    else
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t kmc_standin_add_key(const char* key_ref, uint8_t algo, const char* hex)
+{
+    if(standin_num_keys >= KMC_STANDIN_MAX_KEYS || strlen(key_ref) >= KMC_STANDIN_MAX_KEY_REF)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    kmc_standin_key_t* key = &standin_keys[standin_num_keys];
+    strcpy(key->key_ref, key_ref);
+    key->algo = algo;
+    if(kmc_standin_hex_to_bytes(hex, key->value, KMC_STANDIN_MAX_KEY_LEN, &key->len) != CRYPTO_LIB_SUCCESS)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    standin_num_keys++;
+    return CRYPTO_LIB_SUCCESS;
+}
+
+int32_t kmc_standin_load_keys(const char* key_file)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    char line[512];
+    char key_ref[KMC_STANDIN_MAX_KEY_REF];
+    char algo_str[32];
+    char hex[2 * KMC_STANDIN_MAX_KEY_LEN + 1];
+    uint8_t algo;
+
+    if(key_file == NULL)
+    {
+        for(size_t i = 0; i < sizeof(standin_default_keys) / sizeof(standin_default_keys[0]); i++)
+        {
+            kmc_standin_add_key(standin_default_keys[i].key_ref, standin_default_keys[i].algo,
+                                standin_default_keys[i].hex);
+        }
+        return status;
+    }
+
+    FILE* fp = fopen(key_file, "r");
+    if(fp == NULL)
+    {
+        printf("Unable to open key store %s\n", key_file);
+        return CRYPTO_LIB_ERROR;
+    }
+    while(fgets(line, sizeof(line), fp) != NULL)
+    {
+        if(line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if(sscanf(line, "%127s %31s %128s", key_ref, algo_str, hex) != 3 ||
+           kmc_standin_algo_from_str(algo_str, &algo) != CRYPTO_LIB_SUCCESS ||
+           kmc_standin_add_key(key_ref, algo, hex) != CRYPTO_LIB_SUCCESS)
+        {
+            printf("Invalid key store entry: %s", line);
+            status = CRYPTO_LIB_ERROR;
+            break;
+        }
+    }
+    fclose(fp);
+    return status;
+}
+
+const kmc_standin_key_t* kmc_standin_find_key(const char* key_ref)
+{
+    if(key_ref == NULL)
+    {
+        return NULL;
+    }
+    for(int i = 0; i < standin_num_keys; i++)
+    {
+        if(strcmp(standin_keys[i].key_ref, key_ref) == 0)
+        {
+            return &standin_keys[i];
+        }
+    }
+    return NULL;
+}
+
+static void kmc_standin_url_decode(char* str)
+{
+    char* out = str;
+    for(char* in = str; *in != '\0'; in++)
+    {
+        unsigned int byte;
+        if(in[0] == '%' && isxdigit((unsigned char)in[1]) && isxdigit((unsigned char)in[2]) &&
+           sscanf(in + 1, "%2x", &byte) == 1)
+        {
+            *out++ = (char)byte;
+            in += 2;
+        }
+        else
+        {
+            *out++ = *in;
+        }
+    }
+    *out = '\0';
+}
+
+void kmc_standin_parse_params(char* str, char separator, char assign, kmc_standin_params_t* params)
+{
+    char* saveptr = NULL;
+    char separators[2] = {separator, '\0'};
+
+    params->num_params = 0;
+    if(str == NULL)
+    {
+        return;
+    }
+    for(char* item = strtok_r(str, separators, &saveptr); item != NULL && params->num_params < KMC_STANDIN_MAX_PARAMS;
+        item = strtok_r(NULL, separators, &saveptr))
+    {
+        kmc_standin_param_t* param = &params->params[params->num_params];
+        char* value = strchr(item, assign);
+        if(value == NULL)
+        {
+            continue;
+        }
+        *value++ = '\0';
+        snprintf(param->name, sizeof(param->name), "%s", item);
+        snprintf(param->value, sizeof(param->value), "%s", value);
+        params->num_params++;
+    }
+}
+
+const char* kmc_standin_get_param(const kmc_standin_params_t* params, const char* name)
+{
+    for(int i = 0; i < params->num_params; i++)
+    {
+        if(strcmp(params->params[i].name, name) == 0)
+        {
+            return params->params[i].value;
+        }
+    }
+    return NULL;
+}
+
+static ssize_t kmc_standin_conn_read(kmc_standin_conn_t* conn, void* buf, size_t len)
+{
+#ifdef KMC_STANDIN_TLS
+    if(conn->ssl != NULL)
+    {
+        return SSL_read(conn->ssl, buf, (int)len);
+    }
+#endif
+    return recv(conn->fd, buf, len, 0);
+}
+
+static int32_t kmc_standin_conn_write(kmc_standin_conn_t* conn, const void* buf, size_t len)
+{
+    const uint8_t* ptr = (const uint8_t*)buf;
+    while(len > 0)
+    {
+        ssize_t sent;
+#ifdef KMC_STANDIN_TLS
+        if(conn->ssl != NULL)
+        {
+            sent = SSL_write(conn->ssl, ptr, (int)len);
+        }
+        else
+#endif
+        {
+            sent = send(conn->fd, ptr, len, MSG_NOSIGNAL);
+        }
+        if(sent <= 0)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+        ptr += sent;
+        len -= sent;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static const char* kmc_standin_find_header(const char* headers, const char* name)
+{
+    size_t name_len = strlen(name);
+    for(const char* line = headers; line != NULL && *line != '\0';)
+    {
+        if(strncasecmp(line, name, name_len) == 0 && line[name_len] == ':')
+        {
+            line += name_len + 1;
+            while(*line == ' ')
+            {
+                line++;
+            }
+            return line;
+        }
+        line = strstr(line, "\r\n");
+        if(line != NULL)
+        {
+            line += 2;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Function: kmc_standin_read_request
+ * Reads one HTTP/1.1 request from the connection. Bytes past the request are
+ * kept in the connection buffer for the next keep-alive request.
+ * @return int32_t: CRYPTO_LIB_SUCCESS, or CRYPTO_LIB_ERROR when the connection closed or the request is malformed
+ **/
+int32_t kmc_standin_read_request(kmc_standin_conn_t* conn, kmc_standin_request_t* request)
+{
+    char* header_end = NULL;
+
+    // Headers
+    while((header_end = memmem(conn->buf, conn->buf_len, "\r\n\r\n", 4)) == NULL)
+    {
+        if(conn->buf_len >= sizeof(conn->buf) - 1)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+        ssize_t n = kmc_standin_conn_read(conn, conn->buf + conn->buf_len, sizeof(conn->buf) - 1 - conn->buf_len);
+        if(n <= 0)
+        {
+            return CRYPTO_LIB_ERROR;
+        }
+        conn->buf_len += n;
+    }
+    *header_end = '\0';
+    size_t header_len = (header_end - conn->buf) + 4;
+
+    char target[KMC_STANDIN_MAX_HEADER];
+    char version[16];
+    if(sscanf(conn->buf, "%7s %8191s %15s", request->method, target, version) != 3)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    strcpy(request->path, target);
+    request->query = strchr(request->path, '?');
+    if(request->query != NULL)
+    {
+        *request->query++ = '\0';
+        kmc_standin_url_decode(request->query);
+    }
+
+    const char* headers = strstr(conn->buf, "\r\n");
+    const char* value = kmc_standin_find_header(headers, "Content-Length");
+    size_t content_length = (value != NULL) ? strtoul(value, NULL, 10) : 0;
+    if(content_length > KMC_STANDIN_MAX_BODY)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    request->cookie[0] = '\0';
+    value = kmc_standin_find_header(headers, "Cookie");
+    if(value != NULL)
+    {
+        size_t len = strcspn(value, "\r\n");
+        snprintf(request->cookie, sizeof(request->cookie), "%.*s", (int)len, value);
+    }
+    value = kmc_standin_find_header(headers, "Connection");
+    request->keep_alive = (strcmp(version, "HTTP/1.1") == 0);
+    if(value != NULL)
+    {
+        request->keep_alive = (strncasecmp(value, "close", 5) != 0);
+    }
+
+    // Body
+    request->body = malloc(content_length + 1);
+    request->body_len = content_length;
+    size_t buffered = conn->buf_len - header_len;
+    if(buffered > content_length)
+    {
+        buffered = content_length;
+    }
+    memcpy(request->body, conn->buf + header_len, buffered);
+    size_t consumed = header_len + buffered;
+    memmove(conn->buf, conn->buf + consumed, conn->buf_len - consumed);
+    conn->buf_len -= consumed;
+    while(buffered < content_length)
+    {
+        ssize_t n = kmc_standin_conn_read(conn, request->body + buffered, content_length - buffered);
+        if(n <= 0)
+        {
+            free(request->body);
+            request->body = NULL;
+            return CRYPTO_LIB_ERROR;
+        }
+        buffered += n;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+void kmc_standin_send_response(kmc_standin_conn_t* conn, int http_status, const char* extra_headers,
+                               const char* body, uint8_t keep_alive)
+{
+    char header[1024];
+    const char* reason = (http_status == 200) ? "OK" : (http_status == 302) ? "Found" : "Error";
+    int len = snprintf(header, sizeof(header),
+                       "HTTP/1.1 %d %s\r\n"
+                       "Content-Type: application/json\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: %s\r\n"
+                       "%s\r\n",
+                       http_status, reason, strlen(body), keep_alive ? "keep-alive" : "close",
+                       extra_headers != NULL ? extra_headers : "");
+    kmc_standin_conn_write(conn, header, len);
+    kmc_standin_conn_write(conn, body, strlen(body));
+}
+
+static void kmc_standin_send_error(kmc_standin_conn_t* conn, kmc_standin_request_t* request, int http_status,
+                                   const char* message)
+{
+    char body[512];
+    snprintf(body, sizeof(body), "{\"httpCode\":%d,\"message\":\"%s\"}", http_status, message);
+    kmc_standin_send_response(conn, http_status, NULL, body, request->keep_alive);
+}
+
+// Base64 (standard alphabet) of a buffer, caller frees
+static char* kmc_standin_base64(const uint8_t* data, size_t len)
+{
+    char* out = malloc(B64ENCODE_OUT_SAFESIZE(len) + 1);
+    base64Encode(data, len, out, NULL);
+    return out;
+}
+
+// Base64url (no padding) of a buffer, caller frees
+static char* kmc_standin_base64url(const uint8_t* data, size_t len)
+{
+    char* out = malloc(B64ENCODE_OUT_SAFESIZE(len) + 1);
+    base64urlEncode(data, len, out, NULL);
+    return out;
+}
+
+static int32_t kmc_standin_mac(const kmc_standin_key_t* key, uint8_t algo, const uint8_t* data, size_t len,
+                               uint8_t* mac, size_t* mac_len)
+{
+    gcry_mac_hd_t hd;
+    int gcry_algo;
+
+    switch(algo)
+    {
+        case KMC_STANDIN_ALGO_AES:
+        case KMC_STANDIN_ALGO_CMAC:
+            gcry_algo = GCRY_MAC_CMAC_AES;
+            break;
+        case KMC_STANDIN_ALGO_HMAC256:
+            gcry_algo = GCRY_MAC_HMAC_SHA256;
+            break;
+        default:
+            gcry_algo = GCRY_MAC_HMAC_SHA512;
+            break;
+    }
+    if(gcry_mac_open(&hd, gcry_algo, 0, NULL) != 0)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    if(gcry_mac_setkey(hd, key->value, key->len) != 0 || gcry_mac_write(hd, data, len) != 0 ||
+       gcry_mac_read(hd, mac, mac_len) != 0)
+    {
+        gcry_mac_close(hd);
+        return CRYPTO_LIB_ERROR;
+    }
+    gcry_mac_close(hd);
+    return CRYPTO_LIB_SUCCESS;
+}
+
+static int32_t kmc_standin_open_cipher(const kmc_standin_key_t* key, uint8_t gcm, const uint8_t* iv, size_t iv_len,
+                                       gcry_cipher_hd_t* hd)
+{
+    int gcry_algo = (key->len == 16) ? GCRY_CIPHER_AES128 : (key->len == 24) ? GCRY_CIPHER_AES192 : GCRY_CIPHER_AES256;
+    if(gcry_cipher_open(hd, gcry_algo, gcm ? GCRY_CIPHER_MODE_GCM : GCRY_CIPHER_MODE_CBC, 0) != 0)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    if(gcry_cipher_setkey(*hd, key->value, key->len) != 0 || gcry_cipher_setiv(*hd, iv, iv_len) != 0)
+    {
+        gcry_cipher_close(*hd);
+        return CRYPTO_LIB_ERROR;
+    }
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Function: kmc_standin_handle_encrypt
+ * encrypt?keyRef=&transformation=[&iv=][&encryptOffset=&macLength=]
+ * GCM returns aad || ciphertext || tag, CBC returns the PKCS5 padded ciphertext.
+ * A random IV is generated and returned in the metadata when none is given.
+ **/
+void kmc_standin_handle_encrypt(kmc_standin_conn_t* conn, kmc_standin_request_t* request)
+{
+    kmc_standin_params_t params;
+    uint8_t iv[64];
+    size_t iv_len = 0;
+    gcry_cipher_hd_t hd;
+
+    kmc_standin_parse_params(request->query, '&', '=', &params);
+    const kmc_standin_key_t* key = kmc_standin_find_key(kmc_standin_get_param(&params, "keyRef"));
+    const char* transformation = kmc_standin_get_param(&params, "transformation");
+    const char* iv_param = kmc_standin_get_param(&params, "iv");
+    const char* offset_param = kmc_standin_get_param(&params, "encryptOffset");
+    const char* mac_param = kmc_standin_get_param(&params, "macLength");
+    if(key == NULL || key->algo != KMC_STANDIN_ALGO_AES)
+    {
+        kmc_standin_send_error(conn, request, 400, "Unknown encryption keyRef");
+        return;
+    }
+    if(transformation == NULL || (strncmp(transformation, "AES/GCM", 7) != 0 && strncmp(transformation, "AES/CBC", 7) != 0))
+    {
+        kmc_standin_send_error(conn, request, 400, "Unsupported transformation");
+        return;
+    }
+    uint8_t gcm = (strncmp(transformation, "AES/GCM", 7) == 0);
+    size_t aad_len = (offset_param != NULL) ? strtoul(offset_param, NULL, 10) : 0;
+    size_t mac_len = (mac_param != NULL) ? strtoul(mac_param, NULL, 10) / 8 : KMC_STANDIN_AES_BLOCK_LEN;
+    if(!gcm)
+    {
+        aad_len = 0;
+        mac_len = 0;
+    }
+    if(aad_len > request->body_len || mac_len > KMC_STANDIN_AES_BLOCK_LEN)
+    {
+        kmc_standin_send_error(conn, request, 400, "Invalid encryptOffset or macLength");
+        return;
+    }
+    if(iv_param != NULL && strlen(iv_param) > 0)
+    {
+        if(B64DECODE_OUT_SAFESIZE(strlen(iv_param)) > sizeof(iv) ||
+           base64urlDecode(iv_param, strlen(iv_param), iv, &iv_len) != NO_ERROR)
+        {
+            kmc_standin_send_error(conn, request, 400, "Invalid iv");
+            return;
+        }
+    }
+    else
+    {
+        iv_len = gcm ? KMC_STANDIN_DEFAULT_GCM_IV_LEN : KMC_STANDIN_AES_BLOCK_LEN;
+        gcry_create_nonce(iv, iv_len);
+    }
+
+    size_t data_len = request->body_len - aad_len;
+    size_t pad_len = gcm ? 0 : KMC_STANDIN_AES_BLOCK_LEN - (data_len % KMC_STANDIN_AES_BLOCK_LEN);
+    size_t out_len = aad_len + data_len + pad_len + mac_len;
+    uint8_t* out = malloc(out_len + 1);
+    memcpy(out, request->body, request->body_len);
+    memset(out + request->body_len, (int)pad_len, pad_len);
+
+    if(kmc_standin_open_cipher(key, gcm, iv, iv_len, &hd) != CRYPTO_LIB_SUCCESS)
+    {
+        free(out);
+        kmc_standin_send_error(conn, request, 400, "Invalid key or iv");
+        return;
+    }
+    if(gcm)
+    {
+        gcry_cipher_authenticate(hd, out, aad_len);
+        gcry_cipher_final(hd);
+    }
+    gcry_cipher_encrypt(hd, out + aad_len, data_len + pad_len, NULL, 0);
+    if(gcm && mac_len > 0)
+    {
+        uint8_t tag[KMC_STANDIN_AES_BLOCK_LEN];
+        gcry_cipher_gettag(hd, tag, sizeof(tag));
+        memcpy(out + aad_len + data_len, tag, mac_len);
+    }
+    gcry_cipher_close(hd);
+
+    char* iv_b64 = kmc_standin_base64url(iv, iv_len);
+    char* ciphertext_b64 = kmc_standin_base64(out, out_len);
+    size_t body_len = strlen(ciphertext_b64) + strlen(iv_b64) + strlen(key->key_ref) + strlen(transformation) + 256;
+    char* body = malloc(body_len);
+    snprintf(body, body_len,
+             "{\"httpCode\":200,\"metadata\":\"keyLength:%d,keyRef:%s,cipherTransformation:%s,initialVector:%s,"
+             "cryptoAlgorithm:AES,macLength:%zu,encryptOffset:%zu,metadataType:EncryptionMetadata\","
+             "\"base64ciphertext\":\"%s\"}",
+             key->len * 8, key->key_ref, transformation, iv_b64, mac_len * 8, aad_len, ciphertext_b64);
+    kmc_standin_send_response(conn, 200, NULL, body, request->keep_alive);
+    free(body);
+    free(ciphertext_b64);
+    free(iv_b64);
+    free(out);
+}
+
+/**
+ * @brief Function: kmc_standin_handle_decrypt
+ * decrypt?metadata=keyRef:,cipherTransformation:,initialVector:[,macLength:,encryptOffset:],...
+ * GCM takes aad || ciphertext || tag and returns aad || cleartext, CBC strips PKCS5 padding.
+ **/
+void kmc_standin_handle_decrypt(kmc_standin_conn_t* conn, kmc_standin_request_t* request)
+{
+    kmc_standin_params_t query;
+    kmc_standin_params_t params;
+    uint8_t iv[64];
+    size_t iv_len = 0;
+    gcry_cipher_hd_t hd;
+
+    kmc_standin_parse_params(request->query, '&', '=', &query);
+    const char* metadata = kmc_standin_get_param(&query, "metadata");
+    char metadata_copy[KMC_STANDIN_MAX_PARAM_LEN];
+    snprintf(metadata_copy, sizeof(metadata_copy), "%s", metadata != NULL ? metadata : "");
+    kmc_standin_parse_params(metadata_copy, ',', ':', &params);
+
+    const kmc_standin_key_t* key = kmc_standin_find_key(kmc_standin_get_param(&params, "keyRef"));
+    const char* transformation = kmc_standin_get_param(&params, "cipherTransformation");
+    const char* iv_param = kmc_standin_get_param(&params, "initialVector");
+    const char* offset_param = kmc_standin_get_param(&params, "encryptOffset");
+    const char* mac_param = kmc_standin_get_param(&params, "macLength");
+    if(key == NULL || key->algo != KMC_STANDIN_ALGO_AES)
+    {
+        kmc_standin_send_error(conn, request, 400, "Unknown decryption keyRef");
+        return;
+    }
+    if(transformation == NULL || (strncmp(transformation, "AES/GCM", 7) != 0 && strncmp(transformation, "AES/CBC", 7) != 0))
+    {
+        kmc_standin_send_error(conn, request, 400, "Unsupported transformation");
+        return;
+    }
+    if(iv_param == NULL || B64DECODE_OUT_SAFESIZE(strlen(iv_param)) > sizeof(iv) ||
+       base64urlDecode(iv_param, strlen(iv_param), iv, &iv_len) != NO_ERROR)
+    {
+        kmc_standin_send_error(conn, request, 400, "Invalid initialVector");
+        return;
+    }
+    uint8_t gcm = (strncmp(transformation, "AES/GCM", 7) == 0);
+    size_t aad_len = (gcm && offset_param != NULL) ? strtoul(offset_param, NULL, 10) : 0;
+    size_t mac_len = (gcm && mac_param != NULL) ? strtoul(mac_param, NULL, 10) / 8 : 0;
+    if(aad_len + mac_len > request->body_len || mac_len > KMC_STANDIN_AES_BLOCK_LEN ||
+       (!gcm && request->body_len % KMC_STANDIN_AES_BLOCK_LEN != 0))
+    {
+        kmc_standin_send_error(conn, request, 400, "Invalid ciphertext length");
+        return;
+    }
+
+    size_t data_len = request->body_len - aad_len - mac_len;
+    uint8_t* out = malloc(aad_len + data_len + 1);
+    memcpy(out, request->body, aad_len + data_len);
+
+    if(kmc_standin_open_cipher(key, gcm, iv, iv_len, &hd) != CRYPTO_LIB_SUCCESS)
+    {
+        free(out);
+        kmc_standin_send_error(conn, request, 400, "Invalid key or initialVector");
+        return;
+    }
+    if(gcm)
+    {
+        gcry_cipher_authenticate(hd, out, aad_len);
+        gcry_cipher_final(hd);
+    }
+    gcry_cipher_decrypt(hd, out + aad_len, data_len, NULL, 0);
+    if(gcm && mac_len > 0 && gcry_cipher_checktag(hd, request->body + aad_len + data_len, mac_len) != 0)
+    {
+        gcry_cipher_close(hd);
+        free(out);
+        kmc_standin_send_error(conn, request, 400, "Tag mismatch");
+        return;
+    }
+    gcry_cipher_close(hd);
+    if(!gcm && data_len > 0)
+    {
+        uint8_t pad_len = out[data_len - 1];
+        if(pad_len > 0 && pad_len <= KMC_STANDIN_AES_BLOCK_LEN && pad_len <= data_len)
+        {
+            data_len -= pad_len;
+        }
+    }
+
+    char* cleartext_b64 = kmc_standin_base64(out, aad_len + data_len);
+    size_t body_len = strlen(cleartext_b64) + 64;
+    char* body = malloc(body_len);
+    snprintf(body, body_len, "{\"httpCode\":200,\"base64cleartext\":\"%s\"}", cleartext_b64);
+    kmc_standin_send_response(conn, 200, NULL, body, request->keep_alive);
+    free(body);
+    free(cleartext_b64);
+    free(out);
+}
+
+/**
+ * @brief Function: kmc_standin_handle_icv_create
+ * icv-create?keyRef= ; the MAC algorithm follows the key type
+ **/
+void kmc_standin_handle_icv_create(kmc_standin_conn_t* conn, kmc_standin_request_t* request)
+{
+    kmc_standin_params_t params;
+    uint8_t mac[64];
+    size_t mac_len = sizeof(mac);
+    static const char* algo_names[] = {"AESCMAC", "AESCMAC", "HmacSHA256", "HmacSHA512"};
+
+    kmc_standin_parse_params(request->query, '&', '=', &params);
+    const kmc_standin_key_t* key = kmc_standin_find_key(kmc_standin_get_param(&params, "keyRef"));
+    if(key == NULL)
+    {
+        kmc_standin_send_error(conn, request, 400, "Unknown integrity keyRef");
+        return;
+    }
+    if(kmc_standin_mac(key, key->algo, request->body, request->body_len, mac, &mac_len) != CRYPTO_LIB_SUCCESS)
+    {
+        kmc_standin_send_error(conn, request, 400, "Integrity check value creation failed");
+        return;
+    }
+
+    char* icv_b64 = kmc_standin_base64url(mac, mac_len);
+    char body[512];
+    snprintf(body, sizeof(body),
+             "{\"httpCode\":200,\"metadata\":\"integrityCheckValue:%s,keyRef:%s,cryptoAlgorithm:%s,macLength:%zu,"
+             "metadataType:IntegrityCheckMetadata\"}",
+             icv_b64, key->key_ref, algo_names[key->algo], mac_len * 8);
+    kmc_standin_send_response(conn, 200, NULL, body, request->keep_alive);
+    free(icv_b64);
+}
+
+/**
+ * @brief Function: kmc_standin_handle_icv_verify
+ * icv-verify?metadata=integrityCheckValue:,keyRef:,cryptoAlgorithm:,macLength:,...
+ * The MAC is compared over its first macLength bits.
+ **/
+void kmc_standin_handle_icv_verify(kmc_standin_conn_t* conn, kmc_standin_request_t* request)
+{
+    kmc_standin_params_t query;
+    kmc_standin_params_t params;
+    uint8_t mac[64];
+    size_t mac_len = sizeof(mac);
+    uint8_t icv[64];
+    size_t icv_len = 0;
+    uint8_t algo;
+
+    kmc_standin_parse_params(request->query, '&', '=', &query);
+    const char* metadata = kmc_standin_get_param(&query, "metadata");
+    char metadata_copy[KMC_STANDIN_MAX_PARAM_LEN];
+    snprintf(metadata_copy, sizeof(metadata_copy), "%s", metadata != NULL ? metadata : "");
+    kmc_standin_parse_params(metadata_copy, ',', ':', &params);
+
+    const kmc_standin_key_t* key = kmc_standin_find_key(kmc_standin_get_param(&params, "keyRef"));
+    const char* icv_param = kmc_standin_get_param(&params, "integrityCheckValue");
+    const char* algo_param = kmc_standin_get_param(&params, "cryptoAlgorithm");
+    const char* mac_param = kmc_standin_get_param(&params, "macLength");
+    if(key == NULL)
+    {
+        kmc_standin_send_error(conn, request, 400, "Unknown integrity keyRef");
+        return;
+    }
+    if(algo_param == NULL || kmc_standin_algo_from_str(algo_param, &algo) != CRYPTO_LIB_SUCCESS)
+    {
+        algo = key->algo;
+    }
+    if(icv_param == NULL || B64DECODE_OUT_SAFESIZE(strlen(icv_param)) > sizeof(icv) ||
+       base64urlDecode(icv_param, strlen(icv_param), icv, &icv_len) != NO_ERROR)
+    {
+        kmc_standin_send_error(conn, request, 400, "Invalid integrityCheckValue");
+        return;
+    }
+    if(kmc_standin_mac(key, algo, request->body, request->body_len, mac, &mac_len) != CRYPTO_LIB_SUCCESS)
+    {
+        kmc_standin_send_error(conn, request, 400, "Integrity check value creation failed");
+        return;
+    }
+    size_t compare_len = (mac_param != NULL) ? strtoul(mac_param, NULL, 10) / 8 : icv_len;
+    if(compare_len > icv_len)
+    {
+        compare_len = icv_len;
+    }
+    uint8_t match = (compare_len > 0 && compare_len <= mac_len && memcmp(mac, icv, compare_len) == 0);
+
+    char body[128];
+    snprintf(body, sizeof(body), "{\"httpCode\":200,\"result\":\"%s\"}", match ? "true" : "false");
+    kmc_standin_send_response(conn, 200, NULL, body, request->keep_alive);
+}
+
+// Tokens are "<expiry>.<hmac>" so any token this process issued validates without shared state
+static void kmc_standin_make_token(time_t expiry, char* token, size_t token_size)
+{
+    kmc_standin_key_t secret;
+    uint8_t mac[32];
+    size_t mac_len = sizeof(mac);
+    char expiry_str[32];
+    int len;
+
+    memcpy(secret.value, standin_token_secret, sizeof(standin_token_secret));
+    secret.len = sizeof(standin_token_secret);
+    len = snprintf(expiry_str, sizeof(expiry_str), "%ld", (long)expiry);
+    kmc_standin_mac(&secret, KMC_STANDIN_ALGO_HMAC256, (uint8_t*)expiry_str, len, mac, &mac_len);
+    len = snprintf(token, token_size, "%s.", expiry_str);
+    for(size_t i = 0; i < 16 && (size_t)len + 2 < token_size; i++)
+    {
+        len += snprintf(token + len, token_size - len, "%02x", mac[i]);
+    }
+}
+
+static uint8_t kmc_standin_valid_token(const char* cookie)
+{
+    char token[128];
+    char expected[128];
+    const char* value = strstr(cookie, KMC_STANDIN_SSO_COOKIE "=");
+
+    if(value == NULL)
+    {
+        return 0;
+    }
+    value += strlen(KMC_STANDIN_SSO_COOKIE "=");
+    snprintf(token, sizeof(token), "%.*s", (int)strcspn(value, "; "), value);
+    time_t expiry = (time_t)strtol(token, NULL, 10);
+    if(expiry <= time(NULL))
+    {
+        return 0;
+    }
+    kmc_standin_make_token(expiry, expected, sizeof(expected));
+    return strcmp(token, expected) == 0;
+}
+
+/**
+ * @brief Function: kmc_standin_handle_sso_token
+ * cam-api/ssoToken ; any login is accepted and answered with an SSO token cookie
+ **/
+void kmc_standin_handle_sso_token(kmc_standin_conn_t* conn, kmc_standin_request_t* request)
+{
+    char token[128];
+    char expires[64];
+    char headers[512];
+    struct tm expiry_tm;
+
+    time_t expiry = time(NULL) + standin_config.token_lifetime;
+    kmc_standin_make_token(expiry, token, sizeof(token));
+    gmtime_r(&expiry, &expiry_tm);
+    strftime(expires, sizeof(expires), "%a, %d %b %Y %H:%M:%S GMT", &expiry_tm);
+    snprintf(headers, sizeof(headers), "Set-Cookie: %s=%s; Path=/; Expires=%s\r\n", KMC_STANDIN_SSO_COOKIE, token,
+             expires);
+    kmc_standin_send_response(conn, 200, headers, "{\"httpCode\":200}", request->keep_alive);
+}
+
+static void kmc_standin_inject_latency(kmc_standin_conn_t* conn)
+{
+    uint32_t delay_ms = standin_config.latency_ms;
+    if(standin_config.jitter_ms > 0)
+    {
+        delay_ms += rand_r(&conn->seed) % (standin_config.jitter_ms + 1);
+    }
+    if(delay_ms > 0)
+    {
+        struct timespec delay = {delay_ms / 1000, (delay_ms % 1000) * 1000000L};
+        nanosleep(&delay, NULL);
+    }
+}
+
+static void kmc_standin_dispatch(kmc_standin_conn_t* conn, kmc_standin_request_t* request)
+{
+    const char* endpoint = strrchr(request->path, '/');
+    endpoint = (endpoint != NULL) ? endpoint + 1 : request->path;
+
+#ifdef KMC_STANDIN_DEBUG
+    printf("%s %s?%s (%zu bytes)\n", request->method, request->path, request->query ? request->query : "",
+           request->body_len);
+#endif
+
+    if(strcmp(endpoint, "ssoToken") == 0)
+    {
+        kmc_standin_handle_sso_token(conn, request);
+        return;
+    }
+    if(strcmp(endpoint, "status") == 0)
+    {
+        kmc_standin_send_response(conn, 200, NULL, "{\"httpCode\":200,\"status\":\"OK\"}", request->keep_alive);
+        return;
+    }
+
+    kmc_standin_inject_latency(conn);
+    if(standin_config.require_cam && !kmc_standin_valid_token(request->cookie))
+    {
+        kmc_standin_send_response(conn, 302, "Location: /cam-api/login\r\n", "{\"httpCode\":302}", request->keep_alive);
+        return;
+    }
+    if(standin_config.error_rate > 0 && ((double)rand_r(&conn->seed) / RAND_MAX) < standin_config.error_rate)
+    {
+        kmc_standin_send_error(conn, request, 500, "Injected failure");
+        return;
+    }
+
+    if(strcmp(endpoint, "encrypt") == 0)
+    {
+        kmc_standin_handle_encrypt(conn, request);
+    }
+    else if(strcmp(endpoint, "decrypt") == 0)
+    {
+        kmc_standin_handle_decrypt(conn, request);
+    }
+    else if(strcmp(endpoint, "icv-create") == 0)
+    {
+        kmc_standin_handle_icv_create(conn, request);
+    }
+    else if(strcmp(endpoint, "icv-verify") == 0)
+    {
+        kmc_standin_handle_icv_verify(conn, request);
+    }
+    else
+    {
+        kmc_standin_send_error(conn, request, 404, "Unknown endpoint");
+    }
+}
+
+void* kmc_standin_connection(void* arg)
+{
+    kmc_standin_conn_t* conn = (kmc_standin_conn_t*)arg;
+    kmc_standin_request_t* request = malloc(sizeof(kmc_standin_request_t));
+    int one = 1;
+
+    setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef KMC_STANDIN_TLS
+    if(ssl_ctx != NULL)
+    {
+        conn->ssl = SSL_new(ssl_ctx);
+        SSL_set_fd(conn->ssl, conn->fd);
+        if(SSL_accept(conn->ssl) <= 0)
+        {
+            goto cleanup; // Handshake failures only affect this client
+        }
+    }
+#endif
+
+    while(keepRunning && kmc_standin_read_request(conn, request) == CRYPTO_LIB_SUCCESS)
+    {
+        kmc_standin_dispatch(conn, request);
+        free(request->body);
+        request->body = NULL;
+        if(!request->keep_alive)
+        {
+            break;
+        }
+    }
+
+#ifdef KMC_STANDIN_TLS
+cleanup:
+    if(conn->ssl != NULL)
+    {
+        SSL_shutdown(conn->ssl);
+        SSL_free(conn->ssl);
+    }
+#endif
+    close(conn->fd);
+    free(request);
+    free(conn);
+    return NULL;
+}
+
+void kmc_standin_cleanup(const int signal)
+{
+    if(signal == SIGINT || signal == SIGTERM)
+    {
+        keepRunning = 0;
+        if(listen_fd >= 0)
+        {
+            shutdown(listen_fd, SHUT_RDWR);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int opt;
+    char* key_file = NULL;
+    struct sockaddr_in addr;
+    int one = 1;
+
+    standin_config.port = KMC_STANDIN_DEFAULT_PORT;
+    standin_config.token_lifetime = KMC_STANDIN_DEFAULT_TOKEN_LIFETIME;
+    while((opt = getopt(argc, argv, "p:l:j:e:k:ct:C:K:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'p':
+                standin_config.port = (uint16_t)atoi(optarg);
+                break;
+            case 'l':
+                standin_config.latency_ms = (uint32_t)atoi(optarg);
+                break;
+            case 'j':
+                standin_config.jitter_ms = (uint32_t)atoi(optarg);
+                break;
+            case 'e':
+                standin_config.error_rate = atof(optarg);
+                break;
+            case 'k':
+                key_file = optarg;
+                break;
+            case 'c':
+                standin_config.require_cam = 1;
+                break;
+            case 't':
+                standin_config.token_lifetime = (uint32_t)atoi(optarg);
+                break;
+            case 'C':
+                standin_config.tls_cert_path = optarg;
+                break;
+            case 'K':
+                standin_config.tls_key_path = optarg;
+                break;
+            default:
+                kmc_standin_print_help(argv[0]);
+                return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if(!gcry_check_version(GCRYPT_VERSION))
+    {
+        printf("libgcrypt version mismatch\n");
+        return 1;
+    }
+    gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
+    gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+    gcry_randomize(standin_token_secret, sizeof(standin_token_secret), GCRY_STRONG_RANDOM);
+
+    if(kmc_standin_load_keys(key_file) != CRYPTO_LIB_SUCCESS)
+    {
+        return 1;
+    }
+
+    if(standin_config.tls_cert_path != NULL || standin_config.tls_key_path != NULL)
+    {
+#ifdef KMC_STANDIN_TLS
+        ssl_ctx = SSL_CTX_new(TLS_server_method());
+        if(ssl_ctx == NULL ||
+           SSL_CTX_use_certificate_chain_file(ssl_ctx, standin_config.tls_cert_path) <= 0 ||
+           SSL_CTX_use_PrivateKey_file(ssl_ctx, standin_config.tls_key_path, SSL_FILETYPE_PEM) <= 0)
+        {
+            ERR_print_errors_fp(stdout);
+            return 1;
+        }
+#else
+        printf("HTTPS requested but the stand-in was built without OpenSSL\n");
+        return 1;
+#endif
+    }
+
+    signal(SIGINT, kmc_standin_cleanup);
+    signal(SIGTERM, kmc_standin_cleanup);
+    signal(SIGPIPE, SIG_IGN);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(standin_config.port);
+    if(bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 128) < 0)
+    {
+        printf("Unable to listen on port %d: %s\n", standin_config.port, strerror(errno));
+        return 1;
+    }
+
+    printf("KMC stand-in listening on %s://0.0.0.0:%d/ (%d keys, latency %u+%u ms, error rate %.3f%s)\n",
+           standin_config.tls_cert_path != NULL ? "https" : "http", standin_config.port, standin_num_keys,
+           standin_config.latency_ms, standin_config.jitter_ms, standin_config.error_rate,
+           standin_config.require_cam ? ", CAM required" : "");
+    fflush(stdout);
+
+    unsigned int seed = (unsigned int)time(NULL);
+    while(keepRunning)
+    {
+        int fd = accept(listen_fd, NULL, NULL);
+        if(fd < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        kmc_standin_conn_t* conn = calloc(1, sizeof(kmc_standin_conn_t));
+        conn->fd = fd;
+        conn->seed = rand_r(&seed);
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, kmc_standin_connection, conn) != 0)
+        {
+            close(fd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    close(listen_fd);
+#ifdef KMC_STANDIN_TLS
+    if(ssl_ctx != NULL)
+    {
+        SSL_CTX_free(ssl_ctx);
+    }
+#endif
+    printf("KMC stand-in stopped\n");
+    return 0;
+}
@@ -0,0 +1,167 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+#ifndef CRYPTOLIB_KMC_STANDIN_H
+#define CRYPTOLIB_KMC_STANDIN_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+/*
+** Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <gcrypt.h>
+#ifdef KMC_STANDIN_TLS
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+#include "crypto_error.h"
+#include "base64.h"
+#include "base64url.h"
+
+
+/*
+** Configuration
+*/
+#define KMC_STANDIN_DEFAULT_PORT 8443
+#define KMC_STANDIN_DEFAULT_TOKEN_LIFETIME 3600 // seconds
+#define KMC_STANDIN_SSO_COOKIE "iPlanetDirectoryPro"
+
+//#define KMC_STANDIN_DEBUG
+
+
+/*
+** Defines
+*/
+#define KMC_STANDIN_MAX_HEADER 8192
+#define KMC_STANDIN_MAX_BODY (1024 * 1024)
+#define KMC_STANDIN_MAX_KEYS 64
+#define KMC_STANDIN_MAX_KEY_REF 128
+#define KMC_STANDIN_MAX_KEY_LEN 64
+#define KMC_STANDIN_MAX_PARAMS 16
+#define KMC_STANDIN_MAX_PARAM_LEN 256
+#define KMC_STANDIN_DEFAULT_GCM_IV_LEN 12
+#define KMC_STANDIN_AES_BLOCK_LEN 16
+
+#define KMC_STANDIN_ALGO_AES     0
+#define KMC_STANDIN_ALGO_CMAC    1
+#define KMC_STANDIN_ALGO_HMAC256 2
+#define KMC_STANDIN_ALGO_HMAC512 3
+
+
+/*
+** Structures
+*/
+typedef struct
+{
+    char key_ref[KMC_STANDIN_MAX_KEY_REF];
+    uint8_t algo;
+    uint8_t value[KMC_STANDIN_MAX_KEY_LEN];
+    uint8_t len;
+} kmc_standin_key_t;
+
+typedef struct
+{
+    uint16_t port;
+    uint32_t latency_ms;   // Added to every crypto response
+    uint32_t jitter_ms;    // Uniformly distributed extra latency
+    double error_rate;     // Fraction of crypto requests answered with HTTP 500
+    uint8_t require_cam;   // Crypto requests without the SSO cookie are redirected (HTTP 302)
+    uint32_t token_lifetime;
+    char* tls_cert_path;
+    char* tls_key_path;
+} kmc_standin_config_t;
+
+typedef struct
+{
+    int fd;
+#ifdef KMC_STANDIN_TLS
+    SSL* ssl;
+#endif
+    char buf[KMC_STANDIN_MAX_HEADER]; // Bytes received but not yet consumed
+    size_t buf_len;
+    unsigned int seed;                // rand_r() state for latency jitter and error injection
+} kmc_standin_conn_t;
+
+typedef struct
+{
+    char method[8];
+    char path[KMC_STANDIN_MAX_HEADER];
+    char* query;
+    char cookie[KMC_STANDIN_MAX_HEADER];
+    uint8_t keep_alive;
+    uint8_t* body;
+    size_t body_len;
+} kmc_standin_request_t;
+
+typedef struct
+{
+    char name[KMC_STANDIN_MAX_PARAM_LEN];
+    char value[KMC_STANDIN_MAX_PARAM_LEN];
+} kmc_standin_param_t;
+
+typedef struct
+{
+    kmc_standin_param_t params[KMC_STANDIN_MAX_PARAMS];
+    int num_params;
+} kmc_standin_params_t;
+
+
+/*
+** Prototypes
+*/
+void kmc_standin_print_help(const char* argv0);
+int32_t kmc_standin_load_keys(const char* key_file);
+const kmc_standin_key_t* kmc_standin_find_key(const char* key_ref);
+void kmc_standin_parse_params(char* str, char separator, char assign, kmc_standin_params_t* params);
+const char* kmc_standin_get_param(const kmc_standin_params_t* params, const char* name);
+int32_t kmc_standin_read_request(kmc_standin_conn_t* conn, kmc_standin_request_t* request);
+void kmc_standin_send_response(kmc_standin_conn_t* conn, int http_status, const char* extra_headers,
+                               const char* body, uint8_t keep_alive);
+void kmc_standin_handle_encrypt(kmc_standin_conn_t* conn, kmc_standin_request_t* request);
+void kmc_standin_handle_decrypt(kmc_standin_conn_t* conn, kmc_standin_request_t* request);
+void kmc_standin_handle_icv_create(kmc_standin_conn_t* conn, kmc_standin_request_t* request);
+void kmc_standin_handle_icv_verify(kmc_standin_conn_t* conn, kmc_standin_request_t* request);
+void kmc_standin_handle_sso_token(kmc_standin_conn_t* conn, kmc_standin_request_t* request);
+void* kmc_standin_connection(void* arg);
+void kmc_standin_cleanup(const int signal);
+
+
+#ifdef __cplusplus
+} /* Close scope of 'extern "C"' declaration which encloses file. */
+#endif
+
+#endif //CRYPTOLIB_KMC_STANDIN_H
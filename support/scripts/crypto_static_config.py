@@ -0,0 +1,380 @@
+# Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+# All Foreign Rights are Reserved to the U.S. Government.
+#
+# This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+# including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+# of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+# documentation will conform to the program, or any warranty that the software will be error free.
+#
+# In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+# consequential damages, arising out of, resulting from, or in any way connected with the software or its
+# documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+# from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+#
+# ITC Team
+# NASA IV&V
+# jstar-development-team@mail.nasa.gov
+
+"""
+Generates const-initialized CryptoLib tables from a declarative configuration file.
+
+    crypto_static_config.py <config.ini> <output directory>
+
+Writes crypto_static_tables.h and crypto_static_tables.c, built into the library when CMake is configured with
+-DCRYPTO_STATIC_CONFIG=<config.ini>. The in-memory SA backend then takes its SAs, SPI to slot map and operational
+SA index from these tables instead of building them in sa_config, the internal key interface takes its key ring from
+them, and Crypto_Init_Static_Config initializes from the [config] and [gvcid] entries without any configuration calls.
+
+Configuration file sections (see support/static_config/crypto_unit_test.ini):
+    [config]        CryptoConfig_t fields, as passed to Crypto_Config_CryptoLib
+    [gvcid <name>]  GvcidManagedParameters_t fields, one section per managed GVCID, kept in file order
+    [sa <spi>]      SecurityAssociation_t fields; iv and arsn are hex strings, abm is a hex string or
+                    abm_fill a byte value repeated abm_len times; tfvn, scid, vcid and mapid set gvcid_blk
+    [key <id>]      value (hex string), key_state and optionally key_len
+Values are copied into the C source as written, so CryptoLib constants (e.g. SA_OPERATIONAL, TC_HAS_FECF) may be
+used. SPIs, key IDs and the tfvn, scid, vcid and sa_state of each SA must be numbers or, for sa_state, one of the
+SA_ state names, as the generator needs them to lay out the indexes.
+"""
+
+import configparser
+import os
+import sys
+
+# Geometry of the in-memory SA backend, checked against its own definitions when the tables are compiled
+SA_TABLE_CHUNK_SIZE = 16
+SA_SLOT_MAP_PAGE_SIZE = 256
+SA_GVCID_INDEX_MIN_SIZE = 64
+SA_SLOT_NONE = 0xFFFF
+
+SA_STATES = {"SA_NONE": 0, "SA_UNKEYED": 1, "SA_KEYED": 2, "SA_OPERATIONAL": 3}
+
+CONFIG_FIELDS = ["key_type", "mc_type", "sa_type", "cryptography_type", "iv_type", "crypto_create_fecf",
+                 "process_sdls_pdus", "has_pus_hdr", "ignore_sa_state", "ignore_anti_replay", "unique_sa_per_mapid",
+                 "crypto_check_fecf", "vcid_bitmask", "crypto_increment_nontransmitted_iv", "sa_capacity",
+                 "key_capacity", "thread_safe"]
+GVCID_FIELDS = ["tfvn", "scid", "vcid", "has_fecf", "aos_has_fhec", "aos_has_iz", "aos_iz_len",
+                "has_segmentation_hdr", "max_frame_size", "has_ocf"]
+SA_FIELDS = ["ekid", "akid", "sa_state", "est", "ast", "shivf_len", "shsnf_len", "shplf_len", "stmacf_len", "ecs",
+             "acs", "iv_len", "arsn_len", "arsnw_len", "arsnw", "abm_len", "lpid", "ecs_len", "acs_len"]
+SA_GVCID_FIELDS = {"tfvn": 0xF, "scid": 0xFFFF, "vcid": 0x3F, "mapid": None} # Hashed fields with their widths
+SA_OTHER_FIELDS = ["iv", "arsn", "abm", "abm_fill", "ek_ref", "ak_ref"]
+KEY_FIELDS = ["value", "key_len", "key_state"]
+
+
+class ConfigError(Exception):
+    pass
+
+
+"""
+Function: parse_number
+@param text: str
+@param what: str, named in the error if text is not a number
+@return int
+"""
+def parse_number(text, what):
+    try:
+        return int(text, 0)
+    except ValueError:
+        raise ConfigError("%s must be a number, not '%s'" % (what, text))
+
+
+"""
+Function: parse_hex
+@param text: str
+@param what: str
+@return bytes
+"""
+def parse_hex(text, what):
+    try:
+        return bytes.fromhex(text.replace(" ", ""))
+    except ValueError:
+        raise ConfigError("%s must be a hex string" % what)
+
+
+"""
+Function: check_fields
+Rejects keys a section does not know, which are most likely typos
+"""
+def check_fields(section, known):
+    for field in section:
+        if field not in known:
+            raise ConfigError("[%s] has no field '%s'" % (section.name, field))
+
+
+"""
+Function: c_bytes
+@return str: C initializer for a byte array
+"""
+def c_bytes(data):
+    return "{" + ", ".join("0x%02X" % b for b in data) + "}"
+
+
+"""
+Function: c_string
+@return str: C string literal
+"""
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+"""
+Function: gvcid_index_hash
+Mirror of sa_gvcid_index_hash in sa_interface_inmemory.template.c
+"""
+def gvcid_index_hash(tfvn, scid, vcid, size):
+    key = ((tfvn << 26) ^ (scid << 6) ^ vcid) & 0xFFFFFFFF
+    key = (key * 2654435761) & 0xFFFFFFFF
+    return (key >> 16) & (size - 1)
+
+
+"""
+Class: StaticConfig
+The parsed configuration and the indexes laid out from it
+"""
+class StaticConfig:
+    def __init__(self, path):
+        parser = configparser.ConfigParser(inline_comment_prefixes=("#", ";"), interpolation=None)
+        parser.optionxform = str
+        with open(path) as config_file:
+            parser.read_file(config_file)
+
+        self.path = path
+        self.crypto_config = None
+        self.gvcids = []
+        self.sas = []
+        self.keys = []
+        for name in parser.sections():
+            section = parser[name]
+            kind, _, ident = name.partition(" ")
+            if kind == "config":
+                check_fields(section, CONFIG_FIELDS)
+                self.crypto_config = section
+            elif kind == "gvcid":
+                check_fields(section, GVCID_FIELDS)
+                self.gvcids.append(section)
+            elif kind == "sa":
+                check_fields(section, SA_FIELDS + list(SA_GVCID_FIELDS) + SA_OTHER_FIELDS)
+                self.sas.append((parse_number(ident, "SPI of [%s]" % name), section))
+            elif kind == "key":
+                check_fields(section, KEY_FIELDS)
+                self.keys.append((parse_number(ident, "key ID of [%s]" % name), section))
+            else:
+                raise ConfigError("unknown section [%s]" % name)
+
+        if not self.sas:
+            raise ConfigError("no [sa <spi>] sections")
+        self.sas.sort(key=lambda sa: sa[0])
+        self.keys.sort(key=lambda key: key[0])
+        for spis, what in (([spi for spi, _ in self.sas], "SPI"), ([kid for kid, _ in self.keys], "key ID")):
+            for i in range(1, len(spis)):
+                if spis[i] == spis[i - 1]:
+                    raise ConfigError("%s %d is configured twice" % (what, spis[i]))
+        if self.sas[-1][0] > 0xFFFF:
+            raise ConfigError("SPI %d does not fit in 16 bits" % self.sas[-1][0])
+
+        self.layout_indexes()
+
+    """
+    Function: layout_indexes
+    Slots are handed out in SPI order. Operational SAs are chained into the GVCID index buckets in ascending SPI
+    order, as sa_gvcid_index_rebuild would.
+    """
+    def layout_indexes(self):
+        self.index_size = SA_GVCID_INDEX_MIN_SIZE
+        while self.index_size < len(self.sas):
+            self.index_size <<= 1
+        self.index = [SA_SLOT_NONE] * self.index_size
+        self.index_next = [SA_SLOT_NONE] * len(self.sas)
+        self.index_bucket = [SA_SLOT_NONE] * len(self.sas)
+        tails = {}
+
+        for slot, (spi, section) in enumerate(self.sas):
+            state = section.get("sa_state", "SA_NONE")
+            state = SA_STATES[state] if state in SA_STATES else parse_number(state, "sa_state of SPI %d" % spi)
+            if state != SA_STATES["SA_OPERATIONAL"]:
+                continue
+            gvcid = {}
+            for field, mask in SA_GVCID_FIELDS.items():
+                if mask is None:
+                    continue
+                gvcid[field] = parse_number(section.get(field, "0"), "%s of SPI %d" % (field, spi))
+                if gvcid[field] & ~mask:
+                    raise ConfigError("%s of SPI %d does not fit in its field" % (field, spi))
+            bucket = gvcid_index_hash(gvcid["tfvn"], gvcid["scid"], gvcid["vcid"], self.index_size)
+            if bucket in tails:
+                self.index_next[tails[bucket]] = slot
+            else:
+                self.index[bucket] = slot
+            tails[bucket] = slot
+            self.index_bucket[slot] = bucket
+
+        self.pages = {}
+        for slot, (spi, _) in enumerate(self.sas):
+            page = self.pages.setdefault(spi // SA_SLOT_MAP_PAGE_SIZE, [SA_SLOT_NONE] * SA_SLOT_MAP_PAGE_SIZE)
+            page[spi % SA_SLOT_MAP_PAGE_SIZE] = slot
+
+    """
+    Function: write_header
+    """
+    def write_header(self, out):
+        out.write(self.banner())
+        out.write("#ifndef CRYPTO_STATIC_TABLES_H\n#define CRYPTO_STATIC_TABLES_H\n\n")
+        out.write('#include "crypto.h"\n\n')
+        out.write("#define CRYPTO_STATIC_NUM_GVCIDS %d\n" % len(self.gvcids))
+        out.write("#define CRYPTO_STATIC_NUM_SAS %d\n" % len(self.sas))
+        out.write("#define CRYPTO_STATIC_NUM_SA_CHUNKS %d\n" %
+                  ((len(self.sas) + SA_TABLE_CHUNK_SIZE - 1) // SA_TABLE_CHUNK_SIZE))
+        out.write("#define CRYPTO_STATIC_NUM_SLOT_PAGES %d\n" % len(self.pages))
+        out.write("#define CRYPTO_STATIC_NUM_KEYS %d\n\n" % len(self.keys))
+        out.write("// In-memory SA backend geometry the indexes were laid out for\n")
+        out.write("#define CRYPTO_STATIC_SA_TABLE_CHUNK_SIZE %d\n" % SA_TABLE_CHUNK_SIZE)
+        out.write("#define CRYPTO_STATIC_SA_SLOT_MAP_PAGE_SIZE %d\n" % SA_SLOT_MAP_PAGE_SIZE)
+        out.write("#define CRYPTO_STATIC_SA_GVCID_INDEX_MIN_SIZE %d\n" % SA_GVCID_INDEX_MIN_SIZE)
+        out.write("#define CRYPTO_STATIC_SA_GVCID_INDEX_SIZE %d\n\n" % self.index_size)
+        out.write("typedef struct\n{\n    uint32_t key_id;\n    crypto_key_t key;\n} crypto_static_key_t;\n\n")
+        out.write("// init_status is UNITIALIZED if the file has no [config] section\n")
+        out.write("extern const CryptoConfig_t crypto_static_crypto_config;\n")
+        out.write("extern const GvcidManagedParameters_t crypto_static_managed_parameters[CRYPTO_STATIC_NUM_GVCIDS];\n")
+        out.write("extern const SecurityAssociation_t crypto_static_sas[CRYPTO_STATIC_NUM_SAS];\n")
+        out.write("extern const uint16_t crypto_static_sa_index_next[CRYPTO_STATIC_NUM_SAS];\n")
+        out.write("extern const uint16_t crypto_static_sa_index_bucket[CRYPTO_STATIC_NUM_SAS];\n")
+        out.write("extern const uint16_t crypto_static_sa_gvcid_index[CRYPTO_STATIC_SA_GVCID_INDEX_SIZE];\n")
+        out.write("extern const uint16_t crypto_static_sa_slot_pages[CRYPTO_STATIC_NUM_SLOT_PAGES]"
+                  "[CRYPTO_STATIC_SA_SLOT_MAP_PAGE_SIZE];\n")
+        out.write("extern const uint16_t* const crypto_static_sa_slot_map[0x10000 / CRYPTO_STATIC_SA_SLOT_MAP_PAGE_SIZE];\n")
+        out.write("extern const crypto_static_key_t crypto_static_keys[CRYPTO_STATIC_NUM_KEYS];\n")
+        out.write("\n#endif // CRYPTO_STATIC_TABLES_H\n")
+
+    """
+    Function: write_source
+    """
+    def write_source(self, out):
+        out.write(self.banner())
+        out.write('#include "crypto_static_tables.h"\n\n')
+
+        out.write("const CryptoConfig_t crypto_static_crypto_config = {\n")
+        if self.crypto_config is not None:
+            out.write("    .init_status = INITIALIZED,\n")
+            for field, value in self.crypto_config.items():
+                out.write("    .%s = %s,\n" % (field, value))
+        else:
+            out.write("    .init_status = UNITIALIZED,\n")
+        out.write("};\n\n")
+
+        out.write("const GvcidManagedParameters_t crypto_static_managed_parameters[CRYPTO_STATIC_NUM_GVCIDS] = {\n")
+        for i, section in enumerate(self.gvcids):
+            out.write("    // %s\n    {\n" % section.name)
+            for field, value in section.items():
+                out.write("        .%s = %s,\n" % (field, value))
+            if i + 1 < len(self.gvcids):
+                out.write("        .next = (GvcidManagedParameters_t*)&crypto_static_managed_parameters[%d],\n"
+                          % (i + 1))
+            out.write("    },\n")
+        out.write("};\n\n")
+
+        # Bit masks are shared between SAs the way the ABM pool would share them
+        masks = {}
+        for spi, section in self.sas:
+            masks.setdefault(self.sa_mask(spi, section), len(masks))
+        out.write("// Authentication bit masks, ABM_SIZE bytes each\n")
+        for mask, i in masks.items():
+            out.write("static const uint8_t crypto_static_abm_%d[ABM_SIZE] = %s;\n" % (i, mask))
+        out.write("\n")
+
+        out.write("const SecurityAssociation_t crypto_static_sas[CRYPTO_STATIC_NUM_SAS] = {\n")
+        for slot, (spi, section) in enumerate(self.sas):
+            out.write("    // SPI %d, slot %d\n    {\n        .spi = %d,\n" % (spi, slot, spi))
+            out.write("        .ekid = %s,\n" % section.get("ekid", str(spi)))
+            out.write("        .akid = %s,\n" % section.get("akid", str(spi)))
+            for field in SA_FIELDS:
+                if field in section and field not in ("ekid", "akid"):
+                    out.write("        .%s = %s,\n" % (field, section[field]))
+            gvcid = [".%s = %s" % (field, section[field]) for field in SA_GVCID_FIELDS if field in section]
+            if gvcid:
+                out.write("        .gvcid_blk = {%s},\n" % ", ".join(gvcid))
+            out.write("        .abm = crypto_static_abm_%d,\n" % masks[self.sa_mask(spi, section)])
+            for field in ("iv", "arsn"):
+                if field in section:
+                    out.write("        .%s = %s,\n" % (field, c_bytes(parse_hex(section[field], "%s of SPI %d" %
+                                                                                  (field, spi)))))
+            for field in ("ek_ref", "ak_ref"):
+                if field in section:
+                    out.write("        .%s = (char*)%s,\n" % (field, c_string(section[field])))
+            out.write("    },\n")
+        out.write("};\n\n")
+
+        out.write(self.c_table("const uint16_t crypto_static_sa_index_next[CRYPTO_STATIC_NUM_SAS]", self.index_next))
+        out.write(self.c_table("const uint16_t crypto_static_sa_index_bucket[CRYPTO_STATIC_NUM_SAS]",
+                               self.index_bucket))
+        out.write(self.c_table("const uint16_t crypto_static_sa_gvcid_index[CRYPTO_STATIC_SA_GVCID_INDEX_SIZE]",
+                               self.index))
+
+        out.write("const uint16_t crypto_static_sa_slot_pages[CRYPTO_STATIC_NUM_SLOT_PAGES]"
+                  "[CRYPTO_STATIC_SA_SLOT_MAP_PAGE_SIZE] = {\n")
+        for page_num in sorted(self.pages):
+            out.write("    // SPIs 0x%04X - 0x%04X\n" % (page_num * SA_SLOT_MAP_PAGE_SIZE,
+                                                        (page_num + 1) * SA_SLOT_MAP_PAGE_SIZE - 1))
+            out.write(self.c_rows(self.pages[page_num], "    {", "    },\n", 8))
+        out.write("};\n\n")
+        out.write("const uint16_t* const crypto_static_sa_slot_map[0x10000 / CRYPTO_STATIC_SA_SLOT_MAP_PAGE_SIZE] = {\n")
+        for i, page_num in enumerate(sorted(self.pages)):
+            out.write("    [%d] = crypto_static_sa_slot_pages[%d],\n" % (page_num, i))
+        out.write("};\n")
+
+        out.write("\nconst crypto_static_key_t crypto_static_keys[CRYPTO_STATIC_NUM_KEYS] = {\n")
+        for key_id, section in self.keys:
+            value = parse_hex(section.get("value", ""), "value of key %d" % key_id)
+            out.write("    {\n        .key_id = %d,\n" % key_id)
+            out.write("        .key = {\n")
+            out.write("            .value = %s,\n" % c_bytes(value))
+            out.write("            .key_len = %s,\n" % section.get("key_len", str(len(value))))
+            out.write("            .key_state = %s,\n" % section.get("key_state", "KEY_PREACTIVE"))
+            out.write("        },\n    },\n")
+        out.write("};\n")
+        for key_id, section in self.keys:
+            out.write("_Static_assert(%d < NUM_KEYS, \"key %d is outside the key ring\");\n" % (key_id, key_id))
+
+    """
+    Function: sa_mask
+    @return str: C initializer for an SA's bit mask
+    """
+    def sa_mask(self, spi, section):
+        if "abm" in section:
+            return c_bytes(parse_hex(section["abm"], "abm of SPI %d" % spi))
+        if "abm_fill" in section:
+            return "{[0 ... (%s) - 1] = %s}" % (section.get("abm_len", "ABM_SIZE"), section["abm_fill"])
+        return "{0}"
+
+    def banner(self):
+        return ("/* Generated by support/scripts/crypto_static_config.py from %s, do not edit. */\n\n"
+                % os.path.basename(self.path))
+
+    def c_table(self, declaration, values):
+        return declaration + " = " + self.c_rows(values, "{", "};\n\n", 12)
+
+    def c_rows(self, values, open_text, close_text, per_row):
+        rows = []
+        for i in range(0, len(values), per_row):
+            rows.append(", ".join("0x%04X" % v for v in values[i:i + per_row]))
+        return open_text + "\n        " + ",\n        ".join(rows) + "\n" + close_text
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("usage: %s <config.ini> <output directory>\n" % argv[0])
+        return 2
+    try:
+        config = StaticConfig(argv[1])
+    except (ConfigError, configparser.Error, KeyError) as error:
+        sys.stderr.write("%s: %s\n" % (argv[1], error))
+        return 1
+    os.makedirs(argv[2], exist_ok=True)
+    with open(os.path.join(argv[2], "crypto_static_tables.h"), "w") as out:
+        config.write_header(out)
+    with open(os.path.join(argv[2], "crypto_static_tables.c"), "w") as out:
+        config.write_source(out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
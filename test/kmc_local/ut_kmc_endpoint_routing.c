@@ -0,0 +1,318 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests for KMC Crypto Service endpoint routing and request hedging, run against local stand-in services.
+ **/
+#include "crypto.h"
+#include "crypto_error.h"
+#include "cryptography_interface.h"
+#include "utest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// "abc", the cleartext every stand-in decrypt returns
+#define STANDIN_CLEARTEXT_B64 "YWJj"
+#define STANDIN_CLEARTEXT_LEN 3
+
+typedef struct
+{
+    int listen_fd;
+    uint16_t port;
+    uint32_t latency_ms;
+    int http_status;
+    volatile int running;
+    pthread_t thread;
+} standin_server_t;
+
+static standin_server_t fast_server;
+static standin_server_t slow_server;
+
+static void* standin_handle_connection(void* arg)
+{
+    standin_server_t* server = (standin_server_t*)((void**)arg)[0];
+    int fd = (int)(intptr_t)((void**)arg)[1];
+    free(arg);
+
+    // Read headers and body; the body is not inspected
+    char request[4096];
+    size_t received = 0;
+    long content_length = -1;
+    char* body = NULL;
+    while(received < sizeof(request) - 1)
+    {
+        ssize_t n = recv(fd, request + received, sizeof(request) - 1 - received, 0);
+        if(n <= 0)
+        {
+            break;
+        }
+        received += n;
+        request[received] = '\0';
+        if(body == NULL && (body = strstr(request, "\r\n\r\n")) != NULL)
+        {
+            body += 4;
+            char* cl = strstr(request, "Content-Length:");
+            content_length = (cl != NULL) ? strtol(cl + 15, NULL, 10) : 0;
+        }
+        if(body != NULL && (long)(received - (body - request)) >= content_length)
+        {
+            break;
+        }
+    }
+
+    struct timespec delay = {server->latency_ms / 1000, (server->latency_ms % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+
+    char json[128];
+    snprintf(json, sizeof(json), "{\"httpCode\":%d,\"base64cleartext\":\"%s\"}", server->http_status,
+             STANDIN_CLEARTEXT_B64);
+    char response[256];
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 %d X\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n"
+                       "Connection: close\r\n\r\n%s",
+                       server->http_status, strlen(json), json);
+    send(fd, response, len, MSG_NOSIGNAL);
+    close(fd);
+    return NULL;
+}
+
+static void* standin_accept_loop(void* arg)
+{
+    standin_server_t* server = (standin_server_t*)arg;
+    while(server->running)
+    {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if(fd < 0)
+        {
+            continue;
+        }
+        void** conn_arg = malloc(2 * sizeof(void*));
+        conn_arg[0] = server;
+        conn_arg[1] = (void*)(intptr_t)fd;
+        pthread_t conn_thread;
+        pthread_create(&conn_thread, NULL, standin_handle_connection, conn_arg);
+        pthread_detach(conn_thread);
+    }
+    return NULL;
+}
+
+static void standin_start(standin_server_t* server, uint32_t latency_ms, int http_status)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    bind(server->listen_fd, (struct sockaddr*)&addr, sizeof(addr));
+    listen(server->listen_fd, 16);
+    getsockname(server->listen_fd, (struct sockaddr*)&addr, &addr_len);
+    server->port = ntohs(addr.sin_port);
+    server->latency_ms = latency_ms;
+    server->http_status = http_status;
+    server->running = 1;
+    pthread_create(&server->thread, NULL, standin_accept_loop, server);
+}
+
+static void standin_stop(standin_server_t* server)
+{
+    server->running = 0;
+    shutdown(server->listen_fd, SHUT_RDWR);
+    close(server->listen_fd);
+    pthread_join(server->thread, NULL);
+}
+
+static double now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec * 1000.0) + (now.tv_nsec / 1000000.0);
+}
+
+// Primary endpoint is the slow server, the replica is the fast one
+static int32_t kmc_local_init(uint8_t hedging, uint32_t hedge_min_delay_ms)
+{
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    Crypto_Config_Kmc_Crypto_Service("http", "127.0.0.1", slow_server.port, "crypto-service", NULL, NULL,
+                                     CRYPTO_FALSE, NULL, NULL, NULL, NULL, NULL);
+    status = Crypto_Config_Kmc_Crypto_Service_Add_Endpoint("127.0.0.1", fast_server.port);
+    if(status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    status = Crypto_Config_Kmc_Crypto_Service_Hedging(hedging, hedge_min_delay_ms);
+    if(status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    cryptography_if = get_cryptography_interface_kmc_crypto_service();
+    status = cryptography_if->cryptography_init();
+    if(status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    return cryptography_if->cryptography_config();
+}
+
+static int32_t kmc_local_decrypt(uint8_t* cleartext)
+{
+    SecurityAssociation_t test_sa;
+    uint8_t ciphertext[16] = {0};
+    uint8_t iv[16] = {0};
+
+    memset(&test_sa, 0, sizeof(test_sa));
+    test_sa.ek_ref = (char*)"kmc/test/key130";
+    return cryptography_if->cryptography_decrypt(cleartext, STANDIN_CLEARTEXT_LEN, ciphertext, sizeof(ciphertext),
+                                                 NULL, 32, &test_sa, iv, sizeof(iv), NULL, NULL, NULL);
+}
+
+/**
+ * @brief Unit Test: Replica endpoints cannot be added before the KMC Crypto Service is configured
+ **/
+UTEST(KMC_ENDPOINT_ROUTING, ADD_ENDPOINT_REQUIRES_CONFIG)
+{
+    ASSERT_EQ(CRYPTOGRAPHY_KMC_CRYPTO_SERVICE_CONFIGURATION_NOT_COMPLETE,
+              Crypto_Config_Kmc_Crypto_Service_Add_Endpoint("127.0.0.1", 8443));
+    ASSERT_EQ(CRYPTOGRAPHY_KMC_CRYPTO_SERVICE_CONFIGURATION_NOT_COMPLETE,
+              Crypto_Config_Kmc_Crypto_Service_Hedging(CRYPTO_TRUE, 10));
+}
+
+/**
+ * @brief Unit Test: After measuring both endpoints, requests are routed to the faster replica
+ **/
+UTEST(KMC_ENDPOINT_ROUTING, ROUTES_TO_FASTEST_ENDPOINT)
+{
+    uint8_t cleartext[STANDIN_CLEARTEXT_LEN];
+    KmcEndpointStats_t slow_stats;
+    KmcEndpointStats_t fast_stats;
+
+    standin_start(&slow_server, 80, 200);
+    standin_start(&fast_server, 0, 200);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, kmc_local_init(CRYPTO_FALSE, 0));
+
+    for(int i = 0; i < 20; i++)
+    {
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, kmc_local_decrypt(cleartext));
+        ASSERT_EQ(0, memcmp(cleartext, "abc", STANDIN_CLEARTEXT_LEN));
+    }
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_Kmc_Endpoint_Stats(0, &slow_stats));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_Kmc_Endpoint_Stats(1, &fast_stats));
+    ASSERT_EQ(CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_ENDPOINT_OUT_OF_RANGE, Crypto_Get_Kmc_Endpoint_Stats(2, &fast_stats));
+    // Each endpoint is measured once, then the fast replica takes all traffic
+    ASSERT_EQ(1, (int)slow_stats.num_requests);
+    ASSERT_EQ(19, (int)fast_stats.num_requests);
+    ASSERT_GT(slow_stats.ewma_latency_ms, fast_stats.ewma_latency_ms);
+    ASSERT_EQ(0, (int)fast_stats.num_hedges_sent);
+
+    Crypto_Shutdown();
+    standin_stop(&slow_server);
+    standin_stop(&fast_server);
+}
+
+/**
+ * @brief Unit Test: A slow idempotent request is hedged to the replica, which answers first
+ **/
+UTEST(KMC_ENDPOINT_ROUTING, HEDGED_DECRYPT_BOUNDS_LATENCY)
+{
+    uint8_t cleartext[STANDIN_CLEARTEXT_LEN];
+    KmcEndpointStats_t fast_stats;
+
+    standin_start(&slow_server, 1000, 200);
+    standin_start(&fast_server, 0, 200);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, kmc_local_init(CRYPTO_TRUE, 20));
+
+    // The unmeasured primary is tried first and stalls
+    double start_ms = now_ms();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, kmc_local_decrypt(cleartext));
+    double elapsed_ms = now_ms() - start_ms;
+    ASSERT_EQ(0, memcmp(cleartext, "abc", STANDIN_CLEARTEXT_LEN));
+    ASSERT_LT(elapsed_ms, 500.0);
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_Kmc_Endpoint_Stats(1, &fast_stats));
+    ASSERT_EQ(1, (int)fast_stats.num_hedges_sent);
+    ASSERT_EQ(1, (int)fast_stats.num_hedges_won);
+
+    Crypto_Shutdown();
+    standin_stop(&slow_server);
+    standin_stop(&fast_server);
+}
+
+/**
+ * @brief Unit Test: A 5xx from the primary fails the hedged request over to the replica immediately
+ **/
+UTEST(KMC_ENDPOINT_ROUTING, HEDGED_DECRYPT_FAILS_OVER_ON_SERVER_ERROR)
+{
+    uint8_t cleartext[STANDIN_CLEARTEXT_LEN];
+    KmcEndpointStats_t failing_stats;
+
+    standin_start(&slow_server, 0, 503);
+    standin_start(&fast_server, 0, 200);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, kmc_local_init(CRYPTO_TRUE, 1000));
+
+    double start_ms = now_ms();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, kmc_local_decrypt(cleartext));
+    ASSERT_LT(now_ms() - start_ms, 500.0);
+    ASSERT_EQ(0, memcmp(cleartext, "abc", STANDIN_CLEARTEXT_LEN));
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_Kmc_Endpoint_Stats(0, &failing_stats));
+    ASSERT_EQ(1, (int)failing_stats.num_errors);
+    ASSERT_GT(failing_stats.ewma_error_rate, 0.0);
+
+    Crypto_Shutdown();
+    standin_stop(&slow_server);
+    standin_stop(&fast_server);
+}
+
+/**
+ * @brief Unit Test: A 4xx from the primary is the answer every replica would give, it is returned without a hedge
+ **/
+UTEST(KMC_ENDPOINT_ROUTING, HEDGED_DECRYPT_RETURNS_CLIENT_ERROR)
+{
+    uint8_t cleartext[STANDIN_CLEARTEXT_LEN];
+    KmcEndpointStats_t primary_stats;
+    KmcEndpointStats_t replica_stats;
+
+    standin_start(&slow_server, 0, 400);
+    standin_start(&fast_server, 0, 200);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, kmc_local_init(CRYPTO_TRUE, 1000));
+
+    ASSERT_EQ(CRYPTOGRAHPY_KMC_CRYPTO_SERVICE_GENERIC_FAILURE, kmc_local_decrypt(cleartext));
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_Kmc_Endpoint_Stats(0, &primary_stats));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_Kmc_Endpoint_Stats(1, &replica_stats));
+    ASSERT_EQ(1, (int)primary_stats.num_requests);
+    ASSERT_EQ(0, (int)primary_stats.num_errors);
+    ASSERT_EQ(0, (int)replica_stats.num_hedges_sent);
+    ASSERT_EQ(0, (int)replica_stats.num_requests);
+
+    Crypto_Shutdown();
+    standin_stop(&slow_server);
+    standin_stop(&fast_server);
+}
+
+UTEST_MAIN();
@@ -0,0 +1,257 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  KMC regression tests: TC frames through the KMC Crypto Service interface against the support/kmc_standin server.
+ **/
+#include "crypto.h"
+#include "crypto_error.h"
+#include "sa_interface.h"
+#include "shared_util.h"
+#include "utest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef KMC_STANDIN_PATH
+#error "KMC_STANDIN_PATH must name the kmc_standin executable"
+#endif
+
+#define STANDIN_COOKIE_FILE "/tmp/ut_kmc_standin_cookies.txt"
+
+typedef struct
+{
+    pid_t pid;
+    uint16_t port;
+} standin_process_t;
+
+static char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+
+/**
+ * @brief Function: standin_free_port
+ * @return uint16: A loopback port nothing was listening on a moment ago
+ **/
+static uint16_t standin_free_port(void)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    getsockname(fd, (struct sockaddr*)&addr, &addr_len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+/**
+ * @brief Function: standin_start
+ * Runs kmc_standin on a free port and waits until it accepts connections
+ * @param require_cam: uint8, start it with -c
+ * @return int32: Success/Failure
+ **/
+static int32_t standin_start(standin_process_t* standin, uint8_t require_cam)
+{
+    struct sockaddr_in addr;
+    char port_str[8];
+
+    standin->port = standin_free_port();
+    snprintf(port_str, sizeof(port_str), "%u", standin->port);
+    standin->pid = fork();
+    if (standin->pid < 0)
+    {
+        return CRYPTO_LIB_ERROR;
+    }
+    if (standin->pid == 0)
+    {
+        if (require_cam)
+        {
+            execl(KMC_STANDIN_PATH, KMC_STANDIN_PATH, "-p", port_str, "-c", (char*)NULL);
+        }
+        else
+        {
+            execl(KMC_STANDIN_PATH, KMC_STANDIN_PATH, "-p", port_str, (char*)NULL);
+        }
+        _exit(127);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(standin->port);
+    for (int attempt = 0; attempt < 500; attempt++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int connected = connect(fd, (struct sockaddr*)&addr, sizeof(addr));
+        close(fd);
+        if (connected == 0)
+        {
+            return CRYPTO_LIB_SUCCESS;
+        }
+        struct timespec delay = {0, 10 * 1000000L};
+        nanosleep(&delay, NULL);
+    }
+    kill(standin->pid, SIGKILL);
+    waitpid(standin->pid, NULL, 0);
+    return CRYPTO_LIB_ERROR;
+}
+
+static void standin_stop(standin_process_t* standin)
+{
+    if (standin->pid > 0)
+    {
+        kill(standin->pid, SIGTERM);
+        waitpid(standin->pid, NULL, 0);
+        standin->pid = 0;
+    }
+}
+
+/*
+** Each test starts its own stand-in; the teardown stops it even when an assertion bails out early
+*/
+struct KMC_STANDIN
+{
+    standin_process_t standin;
+};
+
+UTEST_F_SETUP(KMC_STANDIN)
+{
+    (void)utest_result;
+    utest_fixture->standin.pid = 0;
+}
+
+UTEST_F_TEARDOWN(KMC_STANDIN)
+{
+    (void)utest_result;
+    Crypto_Shutdown();
+    standin_stop(&utest_fixture->standin);
+    unlink(STANDIN_COOKIE_FILE);
+}
+
+/**
+ * @brief Function: standin_init
+ * The TC unit test configuration on the KMC Crypto Service, with SA 10 (AES-GCM, kmc/test/key130, the stand-in's copy
+ * of internal key 130) operational on SCID 3 VC 0
+ * @param port: uint16, stand-in port
+ * @return int32: Success/Failure
+ **/
+static int32_t standin_init(uint16_t port)
+{
+    SecurityAssociation_t* test_association;
+    int32_t status;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_INMEMORY, CRYPTOGRAPHY_TYPE_KMCCRYPTO,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_TRUE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    Crypto_Config_Kmc_Crypto_Service("http", "127.0.0.1", port, "crypto-service", NULL, NULL, CRYPTO_FALSE, NULL, NULL,
+                                     NULL, NULL, NULL);
+    status = Crypto_Init();
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+
+    sa_if->sa_get_from_spi(1, &test_association);
+    test_association->sa_state = SA_NONE;
+    sa_if->sa_get_from_spi(10, &test_association);
+    test_association->sa_state = SA_OPERATIONAL;
+    test_association->gvcid_blk.scid = 0x0003;
+    test_association->gvcid_blk.vcid = 0;
+    test_association->arsn_len = 0;
+    return CRYPTO_LIB_SUCCESS;
+}
+
+/**
+ * @brief Unit Test: An AEAD frame encrypted by the KMC Crypto Service matches the libgcrypt backend's, and decrypts back
+ **/
+UTEST_F(KMC_STANDIN, TC_AEAD_KNOWN_ANSWER_AND_ROUND_TRIP)
+{
+    standin_process_t* standin = &utest_fixture->standin;
+    // SA 10's first frame as the libgcrypt backend applies it
+    char* expected_h = "200300330000000a00000000000000000000000064db31bbc4656f072a8e4a706f95cfa3c765644528f622c738f6ba148871da5e";
+    char* expected_b = NULL;
+    int expected_len = 0;
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* kmc_frame = NULL;
+    uint16_t kmc_frame_len = 0;
+    TC_t* tc_processed_frame = calloc(1, sizeof(TC_t));
+    int ingest_len;
+
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    hex_conversion(expected_h, &expected_b, &expected_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, standin_start(standin, CRYPTO_FALSE));
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, standin_init(standin->port));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len,
+                                                          &kmc_frame, &kmc_frame_len));
+    ASSERT_EQ(expected_len, (int)kmc_frame_len);
+    ASSERT_EQ(0, memcmp(expected_b, kmc_frame, kmc_frame_len));
+
+    ingest_len = kmc_frame_len;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_TC_ProcessSecurity(kmc_frame, &ingest_len, tc_processed_frame));
+    // Segment header onwards, less the FECF
+    ASSERT_EQ(raw_tc_sdls_ping_len - 5 - 1 - 2, (int)tc_processed_frame->tc_pdu_len);
+    ASSERT_EQ(0, memcmp(tc_processed_frame->tc_pdu, raw_tc_sdls_ping_b + 6, tc_processed_frame->tc_pdu_len));
+    free(raw_tc_sdls_ping_b);
+    free(expected_b);
+    free(kmc_frame);
+    free(tc_processed_frame);
+}
+
+/**
+ * @brief Unit Test: With CAM required, the SSO token is fetched at start up and frames are accepted with it
+ **/
+UTEST_F(KMC_STANDIN, CAM_TOKEN_FETCHED_AT_START_UP)
+{
+    standin_process_t* standin = &utest_fixture->standin;
+    char access_manager_uri[64];
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* kmc_frame = NULL;
+    uint16_t kmc_frame_len = 0;
+    CamTokenStats_t stats;
+
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, standin_start(standin, CRYPTO_TRUE));
+    snprintf(access_manager_uri, sizeof(access_manager_uri), "http://127.0.0.1:%u", standin->port);
+    unlink(STANDIN_COOKIE_FILE);
+
+    Crypto_Config_Cam(CRYPTO_TRUE, STANDIN_COOKIE_FILE, NULL, CAM_LOGIN_KERBEROS, access_manager_uri, NULL, NULL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, standin_init(standin->port));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len,
+                                                          &kmc_frame, &kmc_frame_len));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_Cam_Token_Stats(&stats));
+    ASSERT_EQ(1, (int)stats.refresh_count);
+    ASSERT_EQ(0, (int)stats.refresh_failure_count);
+    ASSERT_EQ(CRYPTO_TRUE, stats.token_cached);
+    free(raw_tc_sdls_ping_b);
+    free(kmc_frame);
+}
+
+UTEST_MAIN();
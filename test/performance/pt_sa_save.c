@@ -0,0 +1,190 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Per-frame SA lookup + sa_save_sa cost of each SADB backend.
+ *  Build CryptoLib with -DSA_SQLITE=ON (and -DSA_MARIADB=ON for the MariaDB case) and link this file with -lsqlite3.
+ *  BE SURE TO HAVE THE UNIT TEST SA's LOADED IN MARIADB FOR THE MDB TEST
+ **/
+#include "crypto.h"
+#include "crypto_error.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include "shared_util.h"
+#include <sqlite3.h>
+#include <stdio.h>
+
+#include <time.h>
+#include <unistd.h>
+
+#define PT_SA_SAVE_SQLITE_PATH "pt_sa_save.db"
+#define PT_SA_SAVE_MMAP_PATH "pt_sa_save.store"
+
+int num_saves = 10000;
+
+void Write_To_File(float total_time, char* test_name, int num_frames, int reset)
+{
+    if(reset == 1)
+    {
+        if(access("PERFORMANCE_RESULTS_SA_SAVE.csv", F_OK) == 0)
+        {
+            int deleted = remove("PERFORMANCE_RESULTS_SA_SAVE.csv");
+            if(deleted){printf("ERROR Deleting File!\n");}
+        }
+    }
+
+    FILE *fp = NULL;
+    fp = fopen("PERFORMANCE_RESULTS_SA_SAVE.csv", "a");
+    if (fp != NULL)
+    {
+        if(reset ==1) fprintf(fp, "Name of Test,Frames,Total Time,Microseconds per Frame\n");
+        fprintf(fp, "%s,%d,%f,%f\n", test_name, num_frames, total_time, (total_time * 1e6) / num_frames);
+        fclose(fp);
+    }
+}
+
+double Save_SA_Loop(uint16_t spi, int num_loops)
+{
+    struct timespec begin, end;
+    SecurityAssociation_t* sa_ptr = NULL;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for(int i = 0; i < num_loops; i++)
+    {
+        // What the frame paths do per frame: look the SA up, advance its IV, write it back
+        status = sa_if->sa_get_from_spi(spi, &sa_ptr);
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            break;
+        }
+        Crypto_increment(sa_ptr->iv, sa_ptr->iv_len);
+        status = sa_if->sa_save_sa(sa_ptr);
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            break;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        printf("ERROR: %d\n", status);
+        return -1.0;
+    }
+    return (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) * 1e-9;
+}
+
+void Print_Result(char* test_name, double total_time, int reset)
+{
+    printf("\n%s\n", test_name);
+    printf("\tSaves: %d\n", num_saves);
+    printf("\t\tTotal Time: %f\n", total_time);
+    printf("\tMicroseconds per Frame: %f\n", (total_time * 1e6) / num_saves);
+    printf("\n");
+    Write_To_File(total_time, test_name, num_saves, reset);
+}
+
+void Config_TC(uint8_t sa_type)
+{
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, sa_type, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_FALSE, TC_NO_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_TRUE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+}
+
+int32_t Init_SQLite(uint8_t sqlite_synchronous)
+{
+    sqlite3* db = NULL;
+    int32_t status;
+
+    remove(PT_SA_SAVE_SQLITE_PATH);
+    remove(PT_SA_SAVE_SQLITE_PATH "-wal");
+    remove(PT_SA_SAVE_SQLITE_PATH "-shm");
+    Config_TC(SA_TYPE_SQLITE);
+    Crypto_Config_Sa_Sqlite(PT_SA_SAVE_SQLITE_PATH, sqlite_synchronous);
+    status = Crypto_Init();
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        sqlite3_open(PT_SA_SAVE_SQLITE_PATH, &db);
+        sqlite3_exec(db,
+                     "INSERT INTO security_associations"
+                     " (spi,ekid,sa_state,tfvn,scid,vcid,mapid,est,ast,shivf_len,iv_len,iv,stmacf_len,ecs_len,ecs"
+                     ",abm_len,arsn_len,arsnw)"
+                     " VALUES (4,'130',3,0,3,0,0,1,1,12,12,X'000000000000000000000000',16,1,X'01',19,0,5)",
+                     NULL, NULL, NULL);
+        sqlite3_close(db);
+    }
+    return status;
+}
+
+UTEST(PERFORMANCE, LSA_SAVE)
+{
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Print_Result("LSA sa_save_sa", Save_SA_Loop(4, num_saves), 1);
+    Crypto_Shutdown();
+}
+
+UTEST(PERFORMANCE, MMAP_SAVE)
+{
+    remove(PT_SA_SAVE_MMAP_PATH);
+    Config_TC(SA_TYPE_MMAP);
+    Crypto_Config_Sa_Mmap(PT_SA_SAVE_MMAP_PATH, 1, 0);
+    int32_t status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Print_Result("MMAP sa_save_sa (checkpoint every save)", Save_SA_Loop(4, num_saves), 0);
+    Crypto_Shutdown();
+    remove(PT_SA_SAVE_MMAP_PATH);
+}
+
+UTEST(PERFORMANCE, SQLITE_NORMAL_SAVE)
+{
+    int32_t status = Init_SQLite(SA_SQLITE_SYNC_NORMAL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Print_Result("SQLITE sa_save_sa (WAL, synchronous=NORMAL)", Save_SA_Loop(4, num_saves), 0);
+    Crypto_Shutdown();
+}
+
+UTEST(PERFORMANCE, SQLITE_FULL_SAVE)
+{
+    int32_t status = Init_SQLite(SA_SQLITE_SYNC_FULL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Print_Result("SQLITE sa_save_sa (WAL, synchronous=FULL)", Save_SA_Loop(4, num_saves), 0);
+    Crypto_Shutdown();
+}
+
+UTEST(PERFORMANCE, MDB_SAVE)
+{
+    Config_TC(SA_TYPE_MARIADB);
+    Crypto_Config_MariaDB("client-demo-kmc.example.com","sadb", 3306,CRYPTO_TRUE,CRYPTO_TRUE, "/home/itc/Desktop/CERTS/ammos-ca-bundle.crt", NULL,  "/home/itc/Desktop/CERTS/ammos-client-cert.pem", "/home/itc/Desktop/CERTS/ammos-client-key.pem",NULL,"robert", NULL);
+    int32_t status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Print_Result("MDB sa_save_sa", Save_SA_Loop(4, num_saves), 0);
+    Crypto_Shutdown();
+}
+
+UTEST_MAIN();
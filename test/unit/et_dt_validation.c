@@ -1209,7 +1209,7 @@ UTEST(NIST_ENC_MAC_VALIDATION, AES_GCM_256_IV_96_PT_128_TEST_1)
     test_association->arsn_len = 0;
     test_association->shivf_len = 12;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_AES256_GCM;
@@ -1301,7 +1301,7 @@ UTEST(NIST_DEC_MAC_VALIDATION, AES_GCM_256_IV_96_PT_128_TEST_0)
     test_association->est = 0;
     test_association->arsn_len = 0;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t)));
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len);
     test_association->shivf_len = 12;
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
@@ -1425,7 +1425,7 @@ UTEST(NIST_DEC_MAC_VALIDATION, AES_GCM_256_IV_96_PT_128_TEST_0_BAD_DATA)
     test_association->est = 0;
     test_association->arsn_len = 0;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t)));
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len);
     test_association->shivf_len = 12;
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
@@ -1527,7 +1527,7 @@ UTEST(NIST_DEC_MAC_VALIDATION, AES_GCM_256_IV_96_PT_128_TEST_0_BAD_MAC)
     test_association->est = 0;
     test_association->arsn_len = 0;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t)));
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len);
     test_association->shivf_len = 12;
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
@@ -1628,7 +1628,7 @@ UTEST(NIST_ENC_CMAC_VALIDATION, AES_CMAC_256_PT_128_TEST_0)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0x00, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0x00, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -1721,7 +1721,7 @@ UTEST(NIST_ENC_CMAC_VALIDATION, AES_CMAC_256_PT_128_TEST_1)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -1809,7 +1809,7 @@ UTEST(NIST_DEC_CMAC_VALIDATION, AES_CMAC_256_PT_128_TEST_0)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0x00, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0x00, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -1902,7 +1902,7 @@ UTEST(NIST_DEC_CMAC_VALIDATION, AES_CMAC_256_PT_128_TEST_1)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -1996,7 +1996,7 @@ UTEST(NIST_ENC_HMAC_VALIDATION, SHA_256_PT_128_TEST_0)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0x00, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0x00, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2089,7 +2089,7 @@ UTEST(NIST_ENC_HMAC_VALIDATION, SHA_256_PT_128_TEST_1)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2183,7 +2183,7 @@ UTEST(NIST_ENC_HMAC_VALIDATION, SHA_512_PT_128_TEST_0)
    test_association->shsnf_len = 4;
    test_association->arsn_len = 4;
    test_association->abm_len = 1024;
-   memset(test_association->abm, 0x00, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+   Crypto_SA_Fill_ABM(test_association, 0x00, test_association->abm_len); // Bitmask
    test_association->stmacf_len = 16;
    test_association->sa_state = SA_OPERATIONAL;
    test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2274,7 +2274,7 @@ UTEST(NIST_ENC_HMAC_VALIDATION, SHA_512_PT_128_TEST_1)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2365,7 +2365,7 @@ UTEST(NIST_DEC_HMAC_VALIDATION, SHA_256_PT_128_TEST_0)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0x00, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0x00, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2459,7 +2459,7 @@ UTEST(NIST_DEC_HMAC_VALIDATION, SHA_256_PT_128_TEST_1)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2549,7 +2549,7 @@ UTEST(NIST_DEC_HMAC_VALIDATION, SHA_512_PT_128_TEST_0)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0x00, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0x00, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2638,7 +2638,7 @@ UTEST(NIST_DEC_HMAC_VALIDATION, SHA_512_PT_128_TEST_1)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2766,7 +2766,7 @@ UTEST(NIST_ENC_HMAC_VALIDATION, SHA_512_SHORT_KEY)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
@@ -2846,7 +2846,7 @@ UTEST(NIST_DEC_HMAC_VALIDATION, SHA_512_SHORT_KEY)
     test_association->shsnf_len = 4;
     test_association->arsn_len = 4;
     test_association->abm_len = 1024;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->stmacf_len = 16;
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs = CRYPTO_CIPHER_NONE;
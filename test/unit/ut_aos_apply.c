@@ -440,7 +440,7 @@ UTEST(AOS_APPLY, AES_CMAC_256_TEST_BITMASK_0)
     // Configure SA 15 on
     sa_if->sa_get_from_spi(15, &sa_ptr);
     sa_ptr->sa_state = SA_OPERATIONAL;
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask
 
     status = Crypto_AOS_ApplySecurity((uint8_t*)test_aos_b);
     ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
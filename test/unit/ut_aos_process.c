@@ -303,7 +303,7 @@ UTEST(AOS_PROCESS, AES_CMAC_256_TEST_0)
     // Expose/setup SA for testing
     // Configure SA 15
     sa_if->sa_get_from_spi(15, &sa_ptr);
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask of zeros
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask of zeros
 
     status = Crypto_AOS_ProcessSecurity((uint8_t* )framed_aos_b, framed_aos_len, &ptr_processed_frame, &processed_aos_len);
     ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
@@ -421,7 +421,7 @@ UTEST(AOS_PROCESS, AES_HMAC_256_TEST_0)
     // Expose/setup SA for testing
     // Configure SA 15
     sa_if->sa_get_from_spi(15, &sa_ptr);
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask of zeros
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask of zeros
     sa_ptr->acs = CRYPTO_MAC_HMAC_SHA256;
 
     status = Crypto_AOS_ProcessSecurity((uint8_t* )framed_aos_b, framed_aos_len, &ptr_processed_frame, &processed_aos_len);
@@ -547,7 +547,7 @@ UTEST(AOS_PROCESS, AES_HMAC_512_TEST_0)
     // Expose/setup SA for testing
     // Configure SA 15
     sa_if->sa_get_from_spi(15, &sa_ptr);
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask of zeros
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask of zeros
     sa_ptr->acs = CRYPTO_MAC_HMAC_SHA512;
 
     status = Crypto_AOS_ProcessSecurity((uint8_t* )framed_aos_b, framed_aos_len, &ptr_processed_frame, &processed_aos_len);
@@ -681,7 +681,7 @@ UTEST(AOS_PROCESS, AES_GCM_DEC_ONLY)
     sa_if->sa_get_from_spi(9, &test_association);
     test_association->arsn_len = 0;
     test_association->abm_len = 1786;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs_len = 1;
     test_association->ecs = CRYPTO_CIPHER_AES256_GCM;
@@ -247,6 +247,94 @@ UTEST(CRYPTO_C, PDU_SWITCH)
     ASSERT_EQ(status, CRYPTO_LIB_SUCCESS);
 }
 
+/**
+ * @brief Unit Test: OTAR installs every key block after one authenticated decryption, and key verification encrypts
+ * the challenges with the keys named in the command
+ **/
+UTEST(CRYPTO_C, OTAR_AND_KEY_VERIFICATION)
+{
+    uint8_t plaintext[3 * (2 + OTAR_KEY_SIZE)];
+    uint8_t iv[OTAR_IV_SIZE];
+    uint8_t challenge[CHALLENGE_SIZE];
+    uint8_t decrypted[CHALLENGE_SIZE];
+    uint8_t ingest[TC_SIZE] = {0};
+    uint8_t ecs = CRYPTO_CIPHER_AES256_GCM;
+    uint8_t* reply;
+    crypto_key_t* key;
+    TC_t tc_frame;
+    int32_t status;
+    int i;
+
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Keys 140 to 142 under master key 0
+    for (i = 0; i < 3; i++)
+    {
+        plaintext[i * (2 + OTAR_KEY_SIZE)] = 0x00;
+        plaintext[(i * (2 + OTAR_KEY_SIZE)) + 1] = (uint8_t)(140 + i);
+        memset(&plaintext[(i * (2 + OTAR_KEY_SIZE)) + 2], 0x40 + i, OTAR_KEY_SIZE);
+    }
+    memset(iv, 0x5A, OTAR_IV_SIZE);
+    memset(&sdls_frame.pdu, 0, sizeof(sdls_frame.pdu));
+    sdls_frame.pdu.pdu_len = 2 + OTAR_IV_SIZE + sizeof(plaintext) + MAC_SIZE;
+    memcpy(&sdls_frame.pdu.data[2], iv, OTAR_IV_SIZE);
+    key = key_if->get_key(0);
+    status = cryptography_if->cryptography_aead_encrypt(&sdls_frame.pdu.data[2 + OTAR_IV_SIZE], sizeof(plaintext),
+                                                        plaintext, sizeof(plaintext), key->value, key->key_len, NULL,
+                                                        iv, OTAR_IV_SIZE,
+                                                        &sdls_frame.pdu.data[2 + OTAR_IV_SIZE + sizeof(plaintext)],
+                                                        MAC_SIZE, NULL, 0, CRYPTO_TRUE, CRYPTO_TRUE, CRYPTO_FALSE, &ecs,
+                                                        NULL, NULL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // A damaged MAC installs nothing
+    sdls_frame.pdu.data[sdls_frame.pdu.pdu_len - 1] ^= 0x01;
+    status = Crypto_Key_OTAR();
+    ASSERT_NE(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_NE(0x40, key_if->get_key(140)->value[0]);
+
+    status = cryptography_if->cryptography_aead_encrypt(&sdls_frame.pdu.data[2 + OTAR_IV_SIZE], sizeof(plaintext),
+                                                        plaintext, sizeof(plaintext), key->value, key->key_len, NULL,
+                                                        iv, OTAR_IV_SIZE,
+                                                        &sdls_frame.pdu.data[2 + OTAR_IV_SIZE + sizeof(plaintext)],
+                                                        MAC_SIZE, NULL, 0, CRYPTO_TRUE, CRYPTO_TRUE, CRYPTO_FALSE, &ecs,
+                                                        NULL, NULL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = Crypto_Key_OTAR();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    for (i = 0; i < 3; i++)
+    {
+        key = key_if->get_key(140 + i);
+        ASSERT_EQ(OTAR_KEY_SIZE, (int)key->key_len);
+        ASSERT_EQ(KEY_PREACTIVE, key->key_state);
+        ASSERT_EQ(0x40 + i, key->value[0]);
+        ASSERT_EQ(0x40 + i, key->value[OTAR_KEY_SIZE - 1]);
+        ASSERT_EQ(0x00, key->value[OTAR_KEY_SIZE]);
+    }
+
+    // Verify key 141
+    memset(challenge, 0xA7, CHALLENGE_SIZE);
+    memset(&sdls_frame.pdu, 0, sizeof(sdls_frame.pdu));
+    sdls_frame.pdu.pdu_len = 2 + CHALLENGE_SIZE;
+    sdls_frame.pdu.data[1] = 141;
+    memcpy(&sdls_frame.pdu.data[2], challenge, CHALLENGE_SIZE);
+    memset(tc_frame.tc_sec_header.iv, 0, IV_SIZE);
+    status = Crypto_Key_verify(ingest, &tc_frame);
+    ASSERT_GT(status, 0);
+    reply = &ingest[status - (2 + IV_SIZE + CHALLENGE_SIZE + CHALLENGE_MAC_SIZE)];
+    ASSERT_EQ(0x00, reply[0]);
+    ASSERT_EQ(141, reply[1]);
+    key = key_if->get_key(141);
+    status = cryptography_if->cryptography_aead_decrypt(decrypted, CHALLENGE_SIZE, &reply[2 + IV_SIZE], CHALLENGE_SIZE,
+                                                        key->value, key->key_len, NULL, &reply[2], IV_SIZE,
+                                                        &reply[2 + IV_SIZE + CHALLENGE_SIZE], CHALLENGE_MAC_SIZE,
+                                                        NULL, 0, CRYPTO_TRUE, CRYPTO_TRUE, CRYPTO_FALSE, &ecs, NULL,
+                                                        NULL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0, memcmp(challenge, decrypted, CHALLENGE_SIZE));
+}
+
 /**
  * @brief Unit Test: Crypto Extended Procedures PDU Test
  **/
@@ -35,6 +35,18 @@ UTEST(CRYPTO_CONFIG, CRYPTO_INIT_WITH_INCOMPLETE_CONFIG)
     ASSERT_EQ(CRYPTO_CONFIGURATION_NOT_COMPLETE, status);
 }
 
+#ifndef CRYPTO_STATIC_CONFIG
+/**
+ * @brief Unit Test: Crypto Init from static tables in a build without them
+ **/
+UTEST(CRYPTO_CONFIG, CRYPTO_INIT_STATIC_CONFIG_NOT_BUILT)
+{
+    int32_t status = CRYPTO_LIB_ERROR;
+    status = Crypto_Init_Static_Config();
+    ASSERT_EQ(CRYPTO_STATIC_CONFIG_NOT_AVAILABLE, status);
+}
+#endif
+
 /**
  * @brief Unit Test: Crypto Init with no managed parameters configuration
  **/
@@ -0,0 +1,135 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that run several CryptoLib contexts side by side.
+ **/
+#include "ut_crypto_context.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "utest.h"
+
+/**
+ * @brief Unit Test: Configuration and frame state stay with the context that set them, the default context included
+ **/
+UTEST(CRYPTO_CONTEXT, CONTEXTS_KEEP_THEIR_OWN_STATE)
+{
+    char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* ptr_enc_frame = NULL;
+    uint16_t enc_frame_len = 0;
+    CryptoContext_t* ctx_a = Crypto_Context_Create();
+    CryptoContext_t* ctx_b = Crypto_Context_Create();
+    CryptoContext_t* prev_ctx;
+    SaInterface sa_interface_a;
+    int32_t status;
+
+    ASSERT_TRUE(ctx_a != NULL);
+    ASSERT_TRUE(ctx_b != NULL);
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+
+    status = Crypto_Init_TC_Unit_Test_Ctx(ctx_a);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = Crypto_Config_CryptoLib_Ctx(ctx_b, KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_INMEMORY,
+                                         CRYPTOGRAPHY_TYPE_LIBGCRYPT, IV_INTERNAL, CRYPTO_TC_CREATE_FECF_FALSE,
+                                         TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR, TC_IGNORE_SA_STATE_FALSE,
+                                         TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                                         TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = Crypto_Config_Add_Gvcid_Managed_Parameter_Ctx(ctx_b, 0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024,
+                                                           AOS_FHEC_NA, AOS_IZ_NA, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = Crypto_Init_Ctx(ctx_b);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // The default context was never configured
+    ASSERT_EQ((int)UNITIALIZED, (int)crypto_config.init_status);
+    status = Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &ptr_enc_frame,
+                                     &enc_frame_len);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_CONFIG, status);
+
+    status = Crypto_TC_ApplySecurity_Ctx(ctx_a, (uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &ptr_enc_frame,
+                                         &enc_frame_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    free(ptr_enc_frame);
+    ptr_enc_frame = NULL;
+
+    prev_ctx = Crypto_Context_Enter(ctx_a);
+    ASSERT_TRUE(Crypto_Context_Get() == ctx_a);
+    ASSERT_EQ((int)CRYPTO_TC_CREATE_FECF_TRUE, (int)ctx_a->crypto_config->crypto_create_fecf);
+    ASSERT_TRUE(*ctx_a->current_managed_parameters != NULL);
+    sa_interface_a = *ctx_a->sa_if;
+    Crypto_Context_Exit(prev_ctx);
+
+    // Both contexts run on the one in-memory SA backend
+    ASSERT_EQ((int)CRYPTO_TC_CREATE_FECF_FALSE, (int)ctx_b->crypto_config->crypto_create_fecf);
+    ASSERT_TRUE(*ctx_b->current_managed_parameters == NULL);
+    ASSERT_TRUE(sa_interface_a == *ctx_b->sa_if);
+    ASSERT_TRUE(Crypto_Context_Get() == &crypto_context_default);
+    ASSERT_TRUE(sa_if == NULL);
+
+    free(raw_tc_sdls_ping_b);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Context_Free(ctx_b));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Context_Free(ctx_a));
+}
+
+/**
+ * @brief Unit Test: Shutting down one context leaves the backends another context still uses running
+ **/
+UTEST(CRYPTO_CONTEXT, SHARED_BACKENDS_OUTLIVE_A_CONTEXT)
+{
+    char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* ptr_enc_frame = NULL;
+    uint16_t enc_frame_len = 0;
+    CryptoContext_t* ctx_a = Crypto_Context_Create();
+    CryptoContext_t* ctx_b = Crypto_Context_Create();
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status;
+
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Init_TC_Unit_Test_Ctx(ctx_a));
+
+    // Joining the SA backend must not reset the SA table ctx_a set up
+    status = (*ctx_a->sa_if)->sa_get_from_spi(1, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    test_association->arsnw = 7;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Init_TC_Unit_Test_Ctx(ctx_b));
+    status = (*ctx_b->sa_if)->sa_get_from_spi(1, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(7, test_association->arsnw);
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Shutdown_Ctx(ctx_a));
+    status = Crypto_TC_ApplySecurity_Ctx(ctx_b, (uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &ptr_enc_frame,
+                                         &enc_frame_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    free(ptr_enc_frame);
+
+    // ctx_a may come back while ctx_b is running
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Init_TC_Unit_Test_Ctx(ctx_a));
+    ASSERT_FALSE(Crypto_Context_Backends_In_Use() == CRYPTO_FALSE);
+
+    free(raw_tc_sdls_ping_b);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Context_Free(ctx_a));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Context_Free(ctx_b));
+    ASSERT_EQ(CRYPTO_FALSE, Crypto_Context_Backends_In_Use());
+}
+
+UTEST_MAIN();
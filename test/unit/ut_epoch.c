@@ -0,0 +1,460 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that exercise publishing SA and key records while frames are reading them.
+ **/
+#include "ut_epoch.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "key_interface.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+typedef struct
+{
+    sem_t entered;
+    sem_t release;
+    SecurityAssociation_t* sa; // SA 4 as loaded inside the read section, NULL to only enter
+} ut_epoch_reader_t;
+
+typedef struct
+{
+    pthread_barrier_t* inside; // Waited on once inside the read section, so every writer is in one before any writes
+    uint16_t spi;              // SA to start and stop, 0 to only synchronize
+    int32_t status;
+} ut_epoch_writer_t;
+
+static uint32_t ut_epoch_num_freed = 0;
+static uint8_t ut_epoch_writer_done = 0;
+
+static void ut_epoch_count_free(void* ptr)
+{
+    __atomic_add_fetch(&ut_epoch_num_freed, 1, __ATOMIC_SEQ_CST);
+    free(ptr);
+}
+
+// Stands in for a frame function: enters, optionally loads SA 4, then holds the read section until released
+static void* ut_epoch_reader(void* arg)
+{
+    ut_epoch_reader_t* reader = (ut_epoch_reader_t*)arg;
+
+    Crypto_Epoch_Enter();
+    if (reader->sa != NULL)
+    {
+        sa_if->sa_get_from_spi(4, &reader->sa);
+    }
+    sem_post(&reader->entered);
+    sem_wait(&reader->release);
+    if (reader->sa != NULL)
+    {
+        Crypto_increment(reader->sa->iv, reader->sa->iv_len);
+    }
+    Crypto_Epoch_Exit();
+    return NULL;
+}
+
+// Stands in for a frame with thread safety set: holds SA 4's frame lock until released, advances the IV in the SA it
+// found, then lets go of the lock but stays inside the read section until released again
+static void* ut_epoch_locked_reader(void* arg)
+{
+    ut_epoch_reader_t* reader = (ut_epoch_reader_t*)arg;
+
+    Crypto_Epoch_Enter();
+    sa_if->sa_get_from_spi(4, &reader->sa);
+    Crypto_SA_Lock(4);
+    sem_post(&reader->entered);
+    sem_wait(&reader->release);
+    Crypto_increment(reader->sa->iv, reader->sa->iv_len);
+    Crypto_SA_Unlock();
+    sem_post(&reader->entered);
+    sem_wait(&reader->release);
+    Crypto_Epoch_Exit();
+    return NULL;
+}
+
+static void* ut_epoch_sa_stop(void* arg)
+{
+    (void)arg;
+    sa_if->sa_stop();
+    __atomic_store_n(&ut_epoch_writer_done, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+// Stands in for an SDLS PDU in a frame function: writes from inside the read section
+static void* ut_epoch_writer(void* arg)
+{
+    ut_epoch_writer_t* writer = (ut_epoch_writer_t*)arg;
+    SaProvisionOp_t op;
+    uint32_t round;
+
+    Crypto_Epoch_Enter();
+    pthread_barrier_wait(writer->inside);
+    writer->status = CRYPTO_LIB_SUCCESS;
+    if (writer->spi == 0)
+    {
+        Crypto_Epoch_Synchronize();
+    }
+    memset(&op, 0, sizeof(op));
+    op.spi = writer->spi;
+    op.gvcid.scid = SCID;
+    op.gvcid.vcid = writer->spi;
+    for (round = 0; (writer->spi != 0) && (round < 100) && (writer->status == CRYPTO_LIB_SUCCESS); round++)
+    {
+        op.procedure = SA_START;
+        writer->status = sa_if->sa_provision(&op, 1);
+        if (writer->status == CRYPTO_LIB_SUCCESS)
+        {
+            op.procedure = SA_STOP;
+            writer->status = sa_if->sa_provision(&op, 1);
+        }
+    }
+    Crypto_Epoch_Exit();
+    return NULL;
+}
+
+/**
+ * @brief Function: ut_epoch_run_writers
+ * Runs two writers side by side, each inside its own read section before either writes
+ * @param writers: ut_epoch_writer_t*, two of them
+ **/
+static void ut_epoch_run_writers(ut_epoch_writer_t* writers)
+{
+    pthread_barrier_t inside;
+    pthread_t threads[2];
+    int i;
+
+    pthread_barrier_init(&inside, NULL, 2);
+    for (i = 0; i < 2; i++)
+    {
+        writers[i].inside = &inside;
+        writers[i].status = CRYPTO_LIB_ERROR;
+        pthread_create(&threads[i], NULL, ut_epoch_writer, &writers[i]);
+    }
+    for (i = 0; i < 2; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&inside);
+}
+
+static void ut_epoch_reader_init(ut_epoch_reader_t* reader)
+{
+    sem_init(&reader->entered, 0, 0);
+    sem_init(&reader->release, 0, 0);
+    reader->sa = NULL;
+}
+
+/**
+ * @brief Unit Test: A retired record is only freed once the readers that were inside have left
+ **/
+UTEST(EPOCH, RETIRE_DEFERS_UNTIL_READERS_EXIT)
+{
+    ut_epoch_reader_t reader;
+    pthread_t thread;
+
+    ut_epoch_reader_init(&reader);
+    ut_epoch_num_freed = 0;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, ut_epoch_reader, &reader));
+    sem_wait(&reader.entered);
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Epoch_Retire(malloc(16), ut_epoch_count_free));
+    Crypto_Epoch_Enter();
+    Crypto_Epoch_Exit();
+    ASSERT_EQ(0u, __atomic_load_n(&ut_epoch_num_freed, __ATOMIC_SEQ_CST));
+
+    sem_post(&reader.release);
+    pthread_join(thread, NULL);
+    Crypto_Epoch_Synchronize();
+    ASSERT_EQ(1u, __atomic_load_n(&ut_epoch_num_freed, __ATOMIC_SEQ_CST));
+
+    ASSERT_EQ(CRYPTO_LIB_ERROR, Crypto_Epoch_Retire(NULL, ut_epoch_count_free));
+    sem_destroy(&reader.entered);
+    sem_destroy(&reader.release);
+}
+
+/**
+ * @brief Unit Test: Publishing a key leaves the version a frame already holds untouched
+ **/
+UTEST(EPOCH, KEY_PUBLISH_KEEPS_OLD_VERSION_FOR_READERS)
+{
+    crypto_key_t* old_key;
+    crypto_key_t new_key;
+    uint8_t old_value[KEY_SIZE];
+    int32_t status;
+
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Crypto_Epoch_Enter();
+    old_key = key_if->get_key(130);
+    ASSERT_TRUE(old_key != NULL);
+    memcpy(old_value, old_key->value, KEY_SIZE);
+
+    new_key = *old_key;
+    memset(new_key.value, 0x5A, KEY_SIZE);
+    status = Crypto_Key_Publish(130, &new_key);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    ASSERT_EQ(0, memcmp(old_value, old_key->value, KEY_SIZE));
+    ASSERT_EQ(0x5A, key_if->get_key(130)->value[0]);
+    ASSERT_EQ(0x5A, key_if->get_key(130)->value[KEY_SIZE - 1]);
+    Crypto_Epoch_Exit();
+
+    Crypto_Shutdown();
+}
+
+#ifndef CRYPTO_STATIC_CONFIG
+/**
+ * @brief Unit Test: A key ring configured for fewer keys has no IDs above them, and reuses published versions
+ **/
+UTEST(EPOCH, KEY_CAPACITY_LIMITS_KEY_RING)
+{
+    crypto_key_t new_key;
+    int32_t status;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_INMEMORY, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    status = Crypto_Config_Key_Capacity(NUM_KEYS + 1);
+    ASSERT_EQ(CRYPTO_LIB_ERR_KEY_ID_ERROR, status);
+    status = Crypto_Config_Key_Capacity(129);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Unit test keys below the capacity are loaded, the ones above are not
+    ASSERT_TRUE(key_if->get_key(128) != NULL);
+    ASSERT_EQ(KEY_ACTIVE, key_if->get_key(128)->key_state);
+    ASSERT_EQ(0xEF, key_if->get_key(128)->value[31]);
+    ASSERT_TRUE(key_if->get_key(129) == NULL);
+    ASSERT_TRUE(key_if->get_key(NUM_KEYS - 1) == NULL);
+
+    new_key = *key_if->get_key(128);
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        new_key.value[0] = (uint8_t)i;
+        status = Crypto_Key_Publish(128, &new_key);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    }
+    ASSERT_EQ(199, key_if->get_key(128)->value[0]);
+    status = Crypto_Key_Publish(129, &new_key);
+    ASSERT_EQ(CRYPTO_LIB_ERR_KEY_ID_ERROR, status);
+
+    Crypto_Shutdown();
+}
+#endif
+
+/**
+ * @brief Unit Test: Stopping an SA waits for frames using it, and keeps the IV they advanced
+ **/
+UTEST(EPOCH, SA_STOP_WAITS_FOR_FRAMES)
+{
+    ut_epoch_reader_t reader;
+    SecurityAssociation_t* test_association = NULL;
+    pthread_t reader_thread;
+    pthread_t writer_thread;
+    struct timespec wait_time = {0, 50000000};
+    uint8_t iv[IV_SIZE];
+    int32_t status;
+
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_OPERATIONAL, test_association->sa_state);
+    memcpy(iv, test_association->iv, IV_SIZE);
+    Crypto_increment(iv, test_association->iv_len);
+
+    ut_epoch_reader_init(&reader);
+    reader.sa = test_association;
+    ASSERT_EQ(0, pthread_create(&reader_thread, NULL, ut_epoch_reader, &reader));
+    sem_wait(&reader.entered);
+
+    sdls_frame.pdu.data[0] = 0x00;
+    sdls_frame.pdu.data[1] = 0x04;
+    ut_epoch_writer_done = 0;
+    ASSERT_EQ(0, pthread_create(&writer_thread, NULL, ut_epoch_sa_stop, NULL));
+    nanosleep(&wait_time, NULL);
+
+    // New lookups already see the stopped SA, the frame in flight still has the operational one
+    ASSERT_EQ(0, __atomic_load_n(&ut_epoch_writer_done, __ATOMIC_SEQ_CST));
+    ASSERT_EQ(SA_OPERATIONAL, reader.sa->sa_state);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+
+    sem_post(&reader.release);
+    pthread_join(reader_thread, NULL);
+    pthread_join(writer_thread, NULL);
+    ASSERT_EQ(1, __atomic_load_n(&ut_epoch_writer_done, __ATOMIC_SEQ_CST));
+
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_EQ(0, memcmp(iv, test_association->iv, test_association->iv_len));
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 4, 0, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, status);
+
+    sem_destroy(&reader.entered);
+    sem_destroy(&reader.release);
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: IV values frames take while an SA is stopped are carried into every later version, whichever
+ * version the frame had
+ **/
+UTEST(EPOCH, SA_STOP_KEEPS_COUNTERS_FRAMES_ADVANCE)
+{
+    ut_epoch_reader_t locked_reader;
+    ut_epoch_reader_t reader;
+    SecurityAssociation_t* test_association = NULL;
+    pthread_t locked_reader_thread;
+    pthread_t reader_thread;
+    pthread_t writer_thread;
+    struct timespec wait_time = {0, 50000000};
+    uint8_t iv[IV_SIZE];
+    uint8_t iv_len;
+    int32_t status;
+
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = Crypto_Config_Thread_Safety(CRYPTO_THREAD_SAFE_TRUE);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    memcpy(iv, test_association->iv, IV_SIZE);
+    iv_len = test_association->iv_len;
+
+    // A frame holds SA 4 and its lock, so the stop blocks after changing the shadow and before publishing it
+    ut_epoch_reader_init(&locked_reader);
+    ASSERT_EQ(0, pthread_create(&locked_reader_thread, NULL, ut_epoch_locked_reader, &locked_reader));
+    sem_wait(&locked_reader.entered);
+    sdls_frame.pdu.data[0] = 0x00;
+    sdls_frame.pdu.data[1] = 0x04;
+    ut_epoch_writer_done = 0;
+    ASSERT_EQ(0, pthread_create(&writer_thread, NULL, ut_epoch_sa_stop, NULL));
+    nanosleep(&wait_time, NULL);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_OPERATIONAL, test_association->sa_state);
+
+    // Advanced between open and publish: the published shadow starts from it
+    sem_post(&locked_reader.release);
+    sem_wait(&locked_reader.entered);
+    nanosleep(&wait_time, NULL);
+    Crypto_increment(iv, iv_len);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_EQ(0, memcmp(iv, test_association->iv, iv_len));
+
+    // Advanced while the shadow is published, by a frame that then holds the shadow past the commit
+    Crypto_increment(test_association->iv, test_association->iv_len);
+    ut_epoch_reader_init(&reader);
+    reader.sa = test_association;
+    ASSERT_EQ(0, pthread_create(&reader_thread, NULL, ut_epoch_reader, &reader));
+    sem_wait(&reader.entered);
+    sem_post(&locked_reader.release);
+    pthread_join(locked_reader_thread, NULL);
+    nanosleep(&wait_time, NULL);
+    Crypto_increment(iv, iv_len);
+    ASSERT_EQ(0, __atomic_load_n(&ut_epoch_writer_done, __ATOMIC_SEQ_CST));
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_EQ(0, memcmp(iv, test_association->iv, iv_len));
+
+    // Advanced on the shadow after the commit
+    sem_post(&reader.release);
+    pthread_join(reader_thread, NULL);
+    pthread_join(writer_thread, NULL);
+    Crypto_increment(iv, iv_len);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_EQ(0, memcmp(iv, test_association->iv, iv_len));
+
+    sem_destroy(&locked_reader.entered);
+    sem_destroy(&locked_reader.release);
+    sem_destroy(&reader.entered);
+    sem_destroy(&reader.release);
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: Two threads synchronizing from inside their read sections do not wait on each other
+ **/
+UTEST(EPOCH, SYNCHRONIZE_FROM_READ_SECTIONS)
+{
+    ut_epoch_writer_t writers[2];
+
+    memset(writers, 0, sizeof(writers));
+    ut_epoch_run_writers(writers);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, writers[0].status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, writers[1].status);
+}
+
+/**
+ * @brief Unit Test: SA procedures run from two frames at once, as SDLS PDUs in TC ProcessSecurity are, both complete
+ **/
+UTEST(EPOCH, CONCURRENT_PROVISIONING_FROM_FRAMES)
+{
+    ut_epoch_writer_t writers[2];
+    SecurityAssociation_t* test_association = NULL;
+    SecurityAssociation_t copy;
+    int32_t status;
+    int i;
+
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    copy = *test_association;
+    copy.sa_state = SA_KEYED;
+    memset(writers, 0, sizeof(writers));
+    for (i = 0; i < 2; i++)
+    {
+        copy.spi = (uint16_t)(40 + i);
+        status = sa_if->sa_insert(&copy);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        writers[i].spi = copy.spi;
+    }
+
+    ut_epoch_run_writers(writers);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, writers[0].status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, writers[1].status);
+    for (i = 0; i < 2; i++)
+    {
+        status = sa_if->sa_get_from_spi(writers[i].spi, &test_association);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    }
+
+    Crypto_Shutdown();
+}
+
+UTEST_MAIN();
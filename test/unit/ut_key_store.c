@@ -0,0 +1,192 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that seal the internal key ring into an encrypted key store and start CryptoLib from it.
+ **/
+#include "ut_key_store.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "key_interface.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define UT_KEY_STORE_PATH "ut_key_store.img"
+#define UT_KEY_STORE_HEADER_SIZE 40 // Index of record offsets follows
+
+static uint8_t ut_key_store_kek[KEY_STORE_KEK_SIZE] = {
+    0x5A, 0x11, 0x3C, 0x7E, 0x90, 0x0D, 0xB2, 0x48, 0x66, 0xE1, 0x2F, 0x93, 0xC4, 0x08, 0x7A, 0xDB,
+    0x31, 0xF0, 0x5E, 0x87, 0x2A, 0xCC, 0x49, 0x16, 0xBD, 0x73, 0x04, 0xA9, 0xE8, 0x5F, 0x92, 0x3B};
+
+// Saves the unit test keys, with key 130 replaced, to UT_KEY_STORE_PATH
+static int32_t ut_key_store_save(void)
+{
+    crypto_key_t new_key;
+    int32_t status;
+
+    remove(UT_KEY_STORE_PATH);
+    status = Crypto_Init_TC_Unit_Test();
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        new_key = *key_if->get_key(130);
+        memset(new_key.value, 0xC3, KEY_SIZE);
+        Crypto_Key_Publish(130, &new_key);
+        Crypto_Config_Key_Store(UT_KEY_STORE_PATH, ut_key_store_kek, KEY_STORE_KEK_SIZE);
+        status = Crypto_Key_Store_Save(UT_KEY_STORE_PATH);
+    }
+    Crypto_Shutdown();
+    return status;
+}
+
+// Flips one bit of the byte at offset in UT_KEY_STORE_PATH
+static void ut_key_store_flip(off_t offset)
+{
+    uint8_t byte;
+    int fd;
+
+    fd = open(UT_KEY_STORE_PATH, O_RDWR);
+    if (fd >= 0)
+    {
+        if (pread(fd, &byte, 1, offset) == 1)
+        {
+            byte ^= 0x01;
+            pwrite(fd, &byte, 1, offset);
+        }
+        close(fd);
+    }
+}
+
+/**
+ * @brief Unit Test: Keys opened from a key store match the ones it was saved from, IDs without a record stay unused
+ **/
+UTEST(KEY_STORE, SAVE_AND_LOAD_KEYS)
+{
+    char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* ptr_enc_frame = NULL;
+    uint16_t enc_frame_len = 0;
+    char* expected_key_136 = NULL;
+    int expected_key_136_len = 0;
+    crypto_key_t* key;
+    int32_t status;
+
+    status = Crypto_Key_Store_Save(UT_KEY_STORE_PATH);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_INIT, status);
+    status = Crypto_Config_Key_Store(UT_KEY_STORE_PATH, ut_key_store_kek, 16);
+    ASSERT_EQ(CRYPTO_KEY_STORE_CONFIGURATION_NOT_COMPLETE, status);
+    status = ut_key_store_save();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    status = Crypto_Config_Key_Store(UT_KEY_STORE_PATH, ut_key_store_kek, KEY_STORE_KEK_SIZE);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    key = key_if->get_key(130);
+    ASSERT_EQ(32, (int)key->key_len);
+    ASSERT_EQ(KEY_ACTIVE, key->key_state);
+    ASSERT_EQ(0xC3, key->value[0]);
+    ASSERT_EQ(0xC3, key->value[31]);
+    key = key_if->get_key(132);
+    ASSERT_EQ(KEY_PREACTIVE, key->key_state);
+    key = key_if->get_key(136);
+    hex_conversion("ff9f9284cf599eac3b119905a7d18851e7e374cf63aea04358586b0f757670f9", &expected_key_136,
+                   &expected_key_136_len);
+    ASSERT_EQ(KEY_DEACTIVATED, key->key_state);
+    ASSERT_EQ(0, memcmp(expected_key_136, key->value, expected_key_136_len));
+    free(expected_key_136);
+    key = key_if->get_key(3);
+    ASSERT_EQ(0, (int)key->key_len);
+    key = key_if->get_key(NUM_KEYS - 1);
+    ASSERT_EQ(0, (int)key->key_len);
+
+    // SA 4 encrypts with the key opened from the store
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    status = Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &ptr_enc_frame, &enc_frame_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    free(raw_tc_sdls_ping_b);
+    free(ptr_enc_frame);
+    Crypto_Shutdown();
+    remove(UT_KEY_STORE_PATH);
+}
+
+/**
+ * @brief Unit Test: Records that do not authenticate read as corrupted keys, and damaged or missing stores are refused
+ **/
+UTEST(KEY_STORE, REFUSES_BAD_STORES)
+{
+    uint8_t wrong_kek[KEY_STORE_KEK_SIZE];
+    uint32_t offset = 0;
+    crypto_key_t* key;
+    int32_t status;
+    int fd;
+
+    status = ut_key_store_save();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Another KEK opens nothing
+    memcpy(wrong_kek, ut_key_store_kek, KEY_STORE_KEK_SIZE);
+    wrong_kek[0] ^= 0x80;
+    Crypto_Config_Key_Store(UT_KEY_STORE_PATH, wrong_kek, KEY_STORE_KEK_SIZE);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    key = key_if->get_key(128);
+    ASSERT_EQ(KEY_CORRUPTED, key->key_state);
+    ASSERT_EQ(0, (int)key->key_len);
+    Crypto_Shutdown();
+
+    // One flipped bit in the sealed value of key 130 only affects key 130
+    fd = open(UT_KEY_STORE_PATH, O_RDONLY);
+    ASSERT_NE(-1, fd);
+    ASSERT_EQ(4, pread(fd, &offset, 4, UT_KEY_STORE_HEADER_SIZE + (130 * 4)));
+    close(fd);
+    ASSERT_NE(0, (int)offset);
+    ut_key_store_flip(offset + 40);
+    Crypto_Config_Key_Store(UT_KEY_STORE_PATH, ut_key_store_kek, KEY_STORE_KEK_SIZE);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(KEY_CORRUPTED, key_if->get_key(130)->key_state);
+    ASSERT_EQ(KEY_ACTIVE, key_if->get_key(128)->key_state);
+    ASSERT_EQ(0x01, key_if->get_key(128)->value[0]);
+    Crypto_Shutdown();
+
+    // The header is authenticated with every record
+    ut_key_store_flip(UT_KEY_STORE_HEADER_SIZE - 1);
+    Crypto_Config_Key_Store(UT_KEY_STORE_PATH, ut_key_store_kek, KEY_STORE_KEK_SIZE);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(KEY_CORRUPTED, key_if->get_key(128)->key_state);
+    Crypto_Shutdown();
+
+    ut_key_store_flip(0);
+    Crypto_Config_Key_Store(UT_KEY_STORE_PATH, ut_key_store_kek, KEY_STORE_KEK_SIZE);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_KEY_STORE_INVALID, status);
+
+    remove(UT_KEY_STORE_PATH);
+    Crypto_Config_Key_Store(UT_KEY_STORE_PATH, ut_key_store_kek, KEY_STORE_KEK_SIZE);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_KEY_STORE_FILE_ERROR, status);
+}
+
+UTEST_MAIN();
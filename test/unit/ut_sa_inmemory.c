@@ -0,0 +1,426 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that exercise the in-memory SA interface directly.
+ **/
+#include "ut_sa_inmemory.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+/**
+ * @brief Unit Test: GVCID lookup returns the operational SA
+ **/
+UTEST(SA_INMEMORY, GVCID_LOOKUP)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(1, test_association->spi);
+
+    // Unknown channel is a miss
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 5, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, status);
+
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: SA state changed through sa_get_from_spi is picked up by the GVCID lookup
+ **/
+UTEST(SA_INMEMORY, GVCID_LOOKUP_AFTER_DIRECT_UPDATE)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Prime the index with SA 1
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(1, test_association->spi);
+
+    // Swap SA 1 out for SA 4 behind the index's back
+    sa_if->sa_get_from_spi(1, &test_association);
+    test_association->sa_state = SA_NONE;
+    sa_if->sa_get_from_spi(4, &test_association);
+    test_association->sa_state = SA_OPERATIONAL;
+    test_association->gvcid_blk.vcid = 0;
+
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(4, test_association->spi);
+
+    // SA 4 moved off its old channel
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 4, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, status);
+
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: An SA started in place on an indexed channel wins over the indexed SA if its SPI is lower
+ **/
+UTEST(SA_INMEMORY, GVCID_LOOKUP_PREFERS_LOWEST_SPI_AFTER_DIRECT_UPDATE)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    sa_if->sa_get_from_spi(1, &test_association);
+    test_association->sa_state = SA_NONE;
+    sa_if->sa_get_from_spi(4, &test_association);
+    test_association->sa_state = SA_OPERATIONAL;
+    test_association->gvcid_blk.vcid = 0;
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(4, test_association->spi);
+
+    // SA 4 is indexed now, and the lookup for the channel no longer misses
+    sa_if->sa_get_from_spi(1, &test_association);
+    test_association->sa_state = SA_OPERATIONAL;
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(1, test_association->spi);
+
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: SA stop and expire remove the SA from the GVCID lookup
+ **/
+UTEST(SA_INMEMORY, GVCID_LOOKUP_AFTER_STOP)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Stop SPI 1
+    sdls_frame.pdu.data[0] = 0x00;
+    sdls_frame.pdu.data[1] = 0x01;
+    sa_if->sa_stop();
+    sa_if->sa_get_from_spi(1, &test_association);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+
+    // SA 12 shares the channel and takes over
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(12, test_association->spi);
+
+    // Expire SPI 1
+    sa_if->sa_expire();
+    sa_if->sa_get_from_spi(1, &test_association);
+    ASSERT_EQ(SA_UNKEYED, test_association->sa_state);
+
+    // Stop SPI 12, SA 13 is next on the channel
+    sdls_frame.pdu.data[1] = 0x0C;
+    sa_if->sa_stop();
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(13, test_association->spi);
+
+    // Stop SPI 13
+    sdls_frame.pdu.data[1] = 0x0D;
+    sa_if->sa_stop();
+
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, status);
+
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: Mismatch diagnosis reports the field that did not match
+ **/
+UTEST(SA_INMEMORY, DIAGNOSE_GVCID)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Bad SCID is only a plain miss on the lookup path
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID + 1, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, status);
+
+    status = sa_if->sa_diagnose_gvcid(0, SCID + 1, 0, TYPE_TC);
+    ASSERT_EQ(CRYPTO_LIB_ERR_INVALID_SCID, status);
+
+    // Keyed but not started
+    status = sa_if->sa_diagnose_gvcid(0, SCID, 1, TYPE_TC);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, status);
+
+    status = sa_if->sa_diagnose_gvcid(0, SCID, 0, TYPE_TC);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: A TC frame with no operational SA reports the field that did not match
+ **/
+UTEST(SA_INMEMORY, FRAME_REPORTS_DIAGNOSED_MISMATCH)
+{
+    // TC ping on MAP ID 1, the operational SA on the channel is on MAP ID 0
+    char* raw_tc_sdls_ping_h = "20030015000180d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* ptr_enc_frame = NULL;
+    uint16_t enc_frame_len = 0;
+    int32_t status;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_INMEMORY, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_TRUE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024,
+                                              AOS_FHEC_NA, AOS_IZ_NA, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+
+    status = Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &ptr_enc_frame,
+                                     &enc_frame_len);
+    ASSERT_EQ(CRYPTO_LIB_ERR_INVALID_MAPID, status);
+
+    free(raw_tc_sdls_ping_b);
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: Sparse 16-bit SPIs beyond NUM_SA, up to the configured capacity
+ **/
+UTEST(SA_INMEMORY, SPARSE_SPI_CAPACITY)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status = CRYPTO_LIB_ERROR;
+    uint16_t spi;
+    uint16_t num_created = 0;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_INMEMORY, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    status = Crypto_Config_Sa_Capacity(1024);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA, AOS_IZ_NA, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Unconfigured SPIs are not found
+    status = sa_if->sa_get_from_spi(0xBEEF, &test_association);
+    ASSERT_EQ(SADB_SPI_NOT_FOUND, status);
+
+    // Create SAs spread over the whole SPI range until the table is full
+    memset(sdls_frame.pdu.data, 0, 12);
+    for (spi = 0x0100; spi < 0xFF00; spi += 0x003B)
+    {
+        sdls_frame.pdu.data[0] = (spi & 0xFF00) >> 8;
+        sdls_frame.pdu.data[1] = (spi & 0x00FF);
+        status = sa_if->sa_create();
+        if (status != CRYPTO_LIB_SUCCESS)
+        {
+            break;
+        }
+        num_created++;
+    }
+    ASSERT_EQ(SADB_SA_TABLE_FULL, status);
+    ASSERT_EQ(1024 - 18, num_created); // sa_config holds SPIs 0 through 17
+
+    // Every created SA is reachable, and the pointers are stable
+    status = sa_if->sa_get_from_spi(0x0100, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_UNKEYED, test_association->sa_state);
+    spi = 0x0100 + ((num_created - 1) * 0x003B);
+    status = sa_if->sa_get_from_spi(spi, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_UNKEYED, test_association->sa_state);
+
+    // Default SAs are unaffected
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(1, test_association->spi);
+
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: A provisioning batch creates and starts many SAs, and reports each operation's status
+ **/
+UTEST(SA_INMEMORY, BULK_PROVISIONING)
+{
+    SecurityAssociation_t* test_association = NULL;
+    SecurityAssociation_t template_association;
+    SecurityAssociation_t rekey_association;
+    SaProvisionOp_t ops[300];
+    uint32_t num_ops = sizeof(ops) / SA_PROVISION_OP_SIZE;
+    int32_t status;
+    uint32_t i;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_INMEMORY, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    status = Crypto_Config_Sa_Capacity(1024);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA, AOS_IZ_NA, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_TRUE(sa_if->sa_provision != NULL);
+
+    // Create keyed copies of SA 2, then start them all on VCID 2
+    sa_if->sa_get_from_spi(2, &test_association);
+    template_association = *test_association;
+    memset(ops, 0, sizeof(ops));
+    for (i = 0; i < num_ops; i++)
+    {
+        ops[i].procedure = SA_CREATE;
+        ops[i].spi = (uint16_t)(0x1000 + i);
+        ops[i].sa = &template_association;
+    }
+    status = sa_if->sa_provision(ops, num_ops);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    for (i = 0; i < num_ops; i++)
+    {
+        ops[i].procedure = SA_START;
+        ops[i].gvcid.tfvn = 0;
+        ops[i].gvcid.scid = SCID;
+        ops[i].gvcid.vcid = 2;
+        ops[i].gvcid.mapid = TYPE_TC;
+    }
+    status = sa_if->sa_provision(ops, num_ops);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = sa_if->sa_get_from_spi((uint16_t)(0x1000 + num_ops - 1), &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_OPERATIONAL, test_association->sa_state);
+    ASSERT_EQ(template_association.ekid, test_association->ekid);
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 2, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0x1000, test_association->spi);
+
+    // Two procedures on one SA run in order; failures do not stop the rest of the batch
+    memset(ops, 0, 6 * SA_PROVISION_OP_SIZE);
+    ops[0].procedure = SA_STOP;
+    ops[0].spi = 0x1000;
+    ops[1].procedure = SA_EXPIRE;
+    ops[1].spi = 0x1000;
+    ops[2].procedure = SA_START;
+    ops[2].spi = 0xBEEF;
+    ops[3].procedure = SA_DELETE;
+    ops[3].spi = 0x1001;
+    ops[4].procedure = 0xEE;
+    ops[4].spi = 0x1001;
+    ops[5].procedure = SA_STOP;
+    ops[5].spi = 0x1001;
+    status = sa_if->sa_provision(ops, 6);
+    ASSERT_EQ(SADB_SPI_NOT_FOUND, status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ops[0].status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ops[1].status);
+    ASSERT_EQ(SADB_SPI_NOT_FOUND, ops[2].status);
+    ASSERT_EQ(SADB_SA_WRONG_STATE, ops[3].status);
+    ASSERT_EQ(CRYPTO_LIB_ERROR, ops[4].status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ops[5].status);
+    sa_if->sa_get_from_spi(0x1000, &test_association);
+    ASSERT_EQ(SA_UNKEYED, test_association->sa_state);
+    sa_if->sa_get_from_spi(0x1001, &test_association);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 2, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0x1002, test_association->spi);
+
+    // Rekey takes the key and IV from the given SA
+    rekey_association = template_association;
+    rekey_association.ekid = 131;
+    memset(rekey_association.iv, 0x5A, IV_SIZE);
+    memset(ops, 0, SA_PROVISION_OP_SIZE);
+    ops[0].procedure = SA_REKEY;
+    ops[0].spi = 0x1000;
+    ops[0].sa = &rekey_association;
+    status = sa_if->sa_provision(ops, 1);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    sa_if->sa_get_from_spi(0x1000, &test_association);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_EQ(131, test_association->ekid);
+    ASSERT_EQ(0x5A, test_association->iv[test_association->shivf_len - 1]);
+
+    Crypto_Shutdown();
+}
+
+// Generated SAs keep their masks in read-only memory, out of the pool this test counts
+#ifndef CRYPTO_STATIC_CONFIG
+/**
+ * @brief Unit Test: Identical ABMs are stored once in the pool and released with their SAs
+ **/
+UTEST(SA_INMEMORY, ABM_POOL_DEDUPLICATION)
+{
+    SecurityAssociation_t* sa_1 = NULL;
+    SecurityAssociation_t* sa_2 = NULL;
+    AbmPoolStats_t stats;
+    uint8_t abm[ABM_SIZE] = {0};
+    int32_t status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Default SAs share the all-zero mask and the all-ones mask
+    status = Crypto_Get_ABM_Pool_Stats(&stats);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(2, stats.num_entries);
+    ASSERT_EQ(18u, stats.num_refs);
+
+    abm[0] = 0xFF;
+    abm[1] = 0x0F;
+    sa_if->sa_get_from_spi(1, &sa_1);
+    sa_if->sa_get_from_spi(2, &sa_2);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_SA_Set_ABM(sa_1, abm, 20));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_SA_Set_ABM(sa_2, abm, 6));
+    ASSERT_TRUE(sa_1->abm == sa_2->abm);
+    ASSERT_EQ(20, sa_1->abm_len);
+    ASSERT_EQ(6, sa_2->abm_len);
+    ASSERT_EQ(0x0F, sa_2->abm[1]);
+    ASSERT_EQ(0x00, sa_2->abm[ABM_SIZE - 1]);
+    Crypto_Get_ABM_Pool_Stats(&stats);
+    ASSERT_EQ(3, stats.num_entries);
+    ASSERT_EQ(18u, stats.num_refs);
+
+    // Changing one SA's mask leaves the other untouched
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_SA_Fill_ABM(sa_1, 0x00, 20));
+    ASSERT_EQ(0x0F, sa_2->abm[1]);
+    Crypto_Get_ABM_Pool_Stats(&stats);
+    ASSERT_EQ(3, stats.num_entries);
+
+    // Last reference gone, entry freed
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_SA_Fill_ABM(sa_2, 0x00, 6));
+    Crypto_Get_ABM_Pool_Stats(&stats);
+    ASSERT_EQ(2, stats.num_entries);
+
+    status = Crypto_SA_Fill_ABM(sa_2, 0xFF, ABM_SIZE + 1);
+    ASSERT_EQ(CRYPTO_LIB_ERR_ABM_LEN_GREATER_THAN_ABM_SIZE, status);
+
+    Crypto_Shutdown();
+    Crypto_Get_ABM_Pool_Stats(&stats);
+    ASSERT_EQ(0, stats.num_entries);
+    ASSERT_EQ(0u, stats.num_refs);
+}
+#endif
+
+UTEST_MAIN();
@@ -0,0 +1,335 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that exercise the memory-mapped SA store (SA_TYPE_MMAP).
+ **/
+#include "ut_sa_mmap.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define UT_SA_MMAP_PATH "ut_sa_mmap.store"
+#define UT_SA_MMAP_PAGE_SIZE 4096
+#define UT_SA_MMAP_CRASH_SAVES 50
+
+static int32_t ut_sa_mmap_init(uint32_t checkpoint_interval, uint32_t checkpoint_interval_ms)
+{
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_MMAP, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    Crypto_Config_Sa_Mmap(UT_SA_MMAP_PATH, checkpoint_interval, checkpoint_interval_ms);
+    return Crypto_Init();
+}
+
+static void ut_sa_mmap_corrupt_header(int header_idx)
+{
+    uint8_t garbage[16];
+    FILE* fp = fopen(UT_SA_MMAP_PATH, "r+b");
+    memset(garbage, 0xA5, sizeof(garbage));
+    fseek(fp, (header_idx * UT_SA_MMAP_PAGE_SIZE) + 8, SEEK_SET);
+    fwrite(garbage, 1, sizeof(garbage), fp);
+    fclose(fp);
+}
+
+static void ut_sa_mmap_corrupt_live_state(void)
+{
+    uint8_t garbage[16];
+    FILE* fp = fopen(UT_SA_MMAP_PATH, "r+b");
+    memset(garbage, 0xA5, sizeof(garbage));
+    fseek(fp, 2 * UT_SA_MMAP_PAGE_SIZE, SEEK_SET);
+    fwrite(garbage, 1, sizeof(garbage), fp);
+    fclose(fp);
+}
+
+/**
+ * Creates the store, then crashes a child process that saves SPI 4's IV and SPI 5's ARSN UT_SA_MMAP_CRASH_SAVES
+ * times between checkpoints. Returns the checkpointed IV and ARSN.
+ **/
+static int ut_sa_mmap_crash(uint8_t* iv, uint8_t* arsn)
+{
+    SecurityAssociation_t* test_association = NULL;
+    pid_t pid;
+    int child_status = -1;
+    int i;
+
+    remove(UT_SA_MMAP_PATH);
+    if (ut_sa_mmap_init(1000, 1000) != CRYPTO_LIB_SUCCESS)
+    {
+        return -1;
+    }
+    sa_if->sa_get_from_spi(4, &test_association);
+    memcpy(iv, test_association->iv, test_association->iv_len);
+    sa_if->sa_get_from_spi(5, &test_association);
+    memcpy(arsn, test_association->arsn, test_association->arsn_len);
+    Crypto_Shutdown();
+
+    pid = fork();
+    if (pid == 0)
+    {
+        if (ut_sa_mmap_init(1000, 1000) != CRYPTO_LIB_SUCCESS)
+        {
+            _exit(1);
+        }
+        for (i = 0; i < UT_SA_MMAP_CRASH_SAVES; i++)
+        {
+            sa_if->sa_get_from_spi(4, &test_association);
+            Crypto_increment(test_association->iv, test_association->iv_len);
+            sa_if->sa_save_sa(test_association);
+            sa_if->sa_get_from_spi(5, &test_association);
+            Crypto_increment(test_association->arsn, test_association->arsn_len);
+            sa_if->sa_save_sa(test_association);
+        }
+        // No Crypto_Shutdown, the store is left as a crash leaves it
+        _exit(0);
+    }
+    if ((pid < 0) || (waitpid(pid, &child_status, 0) != pid))
+    {
+        return -1;
+    }
+    return (WIFEXITED(child_status) && (WEXITSTATUS(child_status) == 0)) ? 0 : -1;
+}
+
+/**
+ * @brief Unit Test: SA changes made in place survive a restart, the defaults are not loaded over them
+ **/
+UTEST(SA_MMAP, PERSISTS_ACROSS_RESTART)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status;
+
+    remove(UT_SA_MMAP_PATH);
+    status = ut_sa_mmap_init(1000, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    sa_if->sa_get_from_spi(2, &test_association);
+    memset(test_association->iv, 0xDE, test_association->iv_len);
+    sa_if->sa_save_sa(test_association);
+    sa_if->sa_get_from_spi(4, &test_association);
+    test_association->sa_state = SA_KEYED;
+    test_association->ek_ref = (char*)"kmc/test/persisted";
+    Crypto_SA_Fill_ABM(test_association, 0xA5, 12);
+    Crypto_Shutdown();
+
+    status = ut_sa_mmap_init(1000, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    sa_if->sa_get_from_spi(2, &test_association);
+    ASSERT_EQ(0xDE, test_association->iv[0]);
+    ASSERT_EQ(0xDE, test_association->iv[test_association->iv_len - 1]);
+    sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_STREQ("kmc/test/persisted", test_association->ek_ref);
+    ASSERT_EQ(12, test_association->abm_len);
+    ASSERT_EQ(0xA5, test_association->abm[11]);
+    ASSERT_EQ(0x00, test_association->abm[12]);
+
+    // Restored SAs are indexed for GVCID lookups
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, TYPE_TC, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(1, test_association->spi);
+
+    Crypto_Shutdown();
+    remove(UT_SA_MMAP_PATH);
+}
+
+/**
+ * @brief Unit Test: A torn checkpoint falls back to the previous one, and IVs move past any that may have been used
+ **/
+UTEST(SA_MMAP, TORN_CHECKPOINT_FALLS_BACK)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status;
+
+    remove(UT_SA_MMAP_PATH);
+    // Checkpoints: 1 defaults (header 1), 2 and 3 saves (headers 0, 1), 4 clean close (header 0)
+    status = ut_sa_mmap_init(1, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    sa_if->sa_get_from_spi(2, &test_association);
+    memset(test_association->iv, 0x00, test_association->iv_len);
+    test_association->iv[test_association->iv_len - 1] = 0x11;
+    sa_if->sa_save_sa(test_association);
+    test_association->iv[test_association->iv_len - 1] = 0x22;
+    sa_if->sa_save_sa(test_association);
+    test_association->iv[test_association->iv_len - 1] = 0x33;
+    Crypto_Shutdown();
+
+    ut_sa_mmap_corrupt_header(0);
+    // With the live table lost as well, 0x22 is moved on by twice the interval
+    ut_sa_mmap_corrupt_live_state();
+
+    status = ut_sa_mmap_init(1, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    sa_if->sa_get_from_spi(2, &test_association);
+    ASSERT_EQ(0x24, test_association->iv[test_association->iv_len - 1]);
+
+    Crypto_Shutdown();
+    remove(UT_SA_MMAP_PATH);
+}
+
+/**
+ * @brief Unit Test: After a process crash between checkpoints, the IVs and ARSNs saved since come from the live table
+ **/
+UTEST(SA_MMAP, CRASH_RECOVERS_LIVE_COUNTERS)
+{
+    SecurityAssociation_t* test_association = NULL;
+    uint8_t iv[IV_SIZE] = {0};
+    uint8_t arsn[ARSN_SIZE] = {0};
+    int32_t status;
+    int i;
+
+    ASSERT_EQ(0, ut_sa_mmap_crash(iv, arsn));
+
+    status = ut_sa_mmap_init(1000, 1000);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    sa_if->sa_get_from_spi(4, &test_association);
+    for (i = 0; i < UT_SA_MMAP_CRASH_SAVES; i++)
+    {
+        Crypto_increment(iv, test_association->iv_len);
+    }
+    ASSERT_EQ(0, memcmp(iv, test_association->iv, test_association->iv_len));
+    sa_if->sa_get_from_spi(5, &test_association);
+    for (i = 0; i < UT_SA_MMAP_CRASH_SAVES; i++)
+    {
+        Crypto_increment(arsn, test_association->arsn_len);
+    }
+    ASSERT_EQ(0, memcmp(arsn, test_association->arsn, test_association->arsn_len));
+
+    Crypto_Shutdown();
+    remove(UT_SA_MMAP_PATH);
+}
+
+/**
+ * @brief Unit Test: After a process crash with the live table unusable, IVs and ARSNs are advanced past any saved
+ * since the checkpoint, also when checkpoints are taken by time
+ **/
+UTEST(SA_MMAP, CRASH_WITHOUT_LIVE_TABLE_ADVANCES_COUNTERS)
+{
+    SecurityAssociation_t* test_association = NULL;
+    uint8_t iv[IV_SIZE] = {0};
+    uint8_t arsn[ARSN_SIZE] = {0};
+    int32_t status;
+    int i;
+
+    ASSERT_EQ(0, ut_sa_mmap_crash(iv, arsn));
+    ut_sa_mmap_corrupt_live_state();
+
+    status = ut_sa_mmap_init(1000, 1000);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    sa_if->sa_get_from_spi(4, &test_association);
+    for (i = 0; i < 2 * 1000; i++)
+    {
+        Crypto_increment(iv, test_association->iv_len);
+    }
+    ASSERT_EQ(0, memcmp(iv, test_association->iv, test_association->iv_len));
+    sa_if->sa_get_from_spi(5, &test_association);
+    for (i = 0; i < 2 * 1000; i++)
+    {
+        Crypto_increment(arsn, test_association->arsn_len);
+    }
+    ASSERT_EQ(0, memcmp(arsn, test_association->arsn, test_association->arsn_len));
+
+    Crypto_Shutdown();
+    remove(UT_SA_MMAP_PATH);
+}
+
+/**
+ * @brief Unit Test: A checkpoint interval of 0 would leave the counters unbounded after a crash, and is refused
+ **/
+UTEST(SA_MMAP, ZERO_CHECKPOINT_INTERVAL_REFUSED)
+{
+    int32_t status;
+
+    status = Crypto_Config_Sa_Mmap(UT_SA_MMAP_PATH, 0, 1000);
+    ASSERT_EQ(CRYPTO_MMAP_CONFIGURATION_NOT_COMPLETE, status);
+}
+
+/**
+ * @brief Unit Test: A store without any valid checkpoint is refused rather than overwritten
+ **/
+UTEST(SA_MMAP, NO_VALID_CHECKPOINT)
+{
+    int32_t status;
+
+    remove(UT_SA_MMAP_PATH);
+    status = ut_sa_mmap_init(1000, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Shutdown();
+
+    ut_sa_mmap_corrupt_header(0);
+    ut_sa_mmap_corrupt_header(1);
+    status = ut_sa_mmap_init(1000, 0);
+    ASSERT_EQ(SADB_MMAP_STORE_CORRUPT, status);
+
+    Crypto_Shutdown();
+    remove(UT_SA_MMAP_PATH);
+}
+
+/**
+ * @brief Unit Test: A store sized for another SA capacity is refused
+ **/
+UTEST(SA_MMAP, INCOMPATIBLE_CAPACITY)
+{
+    int32_t status;
+
+    remove(UT_SA_MMAP_PATH);
+    status = ut_sa_mmap_init(1000, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Shutdown();
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_MMAP, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Sa_Capacity(NUM_SA * 2);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    Crypto_Config_Sa_Mmap(UT_SA_MMAP_PATH, 1000, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(SADB_MMAP_STORE_INCOMPATIBLE, status);
+
+    Crypto_Shutdown();
+    remove(UT_SA_MMAP_PATH);
+}
+
+/**
+ * @brief Unit Test: SA_TYPE_MMAP requires the store to be configured
+ **/
+UTEST(SA_MMAP, NOT_CONFIGURED)
+{
+    int32_t status;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_MMAP, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_MMAP_CONFIGURATION_NOT_COMPLETE, status);
+
+    Crypto_Shutdown();
+}
+
+UTEST_MAIN();
@@ -0,0 +1,506 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that exercise the shared-memory SA table (SA_TYPE_SHM) from several processes.
+ **/
+#include "ut_sa_shm.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define UT_SA_SHM_NAME "/ut_sa_shm"
+#define UT_SA_SHM_PROCESSES 4
+#define UT_SA_SHM_FRAMES 250
+#define UT_SA_SHM_VCID 4 // In-memory SA 4, AES-GCM with a 12 byte IV, is operational on VC 4
+
+static int32_t ut_sa_shm_init(void)
+{
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_SHM, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    Crypto_Config_Sa_Shm(UT_SA_SHM_NAME);
+    return Crypto_Init();
+}
+
+// Reserves one frame's IV on VC 4 the way TC ApplySecurity does: look up, use, increment, save
+static int32_t ut_sa_shm_apply_frame(uint8_t* iv_used)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, UT_SA_SHM_VCID, 0, &test_association);
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+    if (iv_used != NULL)
+    {
+        memcpy(iv_used, test_association->iv, test_association->iv_len);
+    }
+    Crypto_increment(test_association->iv, test_association->iv_len);
+    return sa_if->sa_save_sa(test_association);
+}
+
+static uint32_t ut_sa_shm_iv_low_word(const uint8_t* iv)
+{
+    return ((uint32_t)iv[8] << 24) | ((uint32_t)iv[9] << 16) | ((uint32_t)iv[10] << 8) | iv[11];
+}
+
+/**
+ * @brief Unit Test: A second attach sees the first's saves, and saves never move an IV backwards
+ **/
+UTEST(SA_SHM, SAVES_ARE_SHARED_AND_MONOTONIC)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(4, test_association->spi);
+    ASSERT_EQ(130, test_association->ekid);
+    ASSERT_EQ(12, test_association->iv_len);
+    ASSERT_EQ(ABM_SIZE, test_association->abm_len);
+    test_association->iv[11] = 0x10;
+    status = sa_if->sa_save_sa(test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Shutdown();
+
+    // Attaches to the existing table rather than loading the defaults again
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0x10, test_association->iv[11]);
+    test_association->iv[11] = 0x01;
+    sa_if->sa_save_sa(test_association);
+
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0x10, test_association->iv[11]);
+    sa_if->sa_save_sa(test_association);
+
+    status = sa_if->sa_get_from_spi(0x1234, &test_association);
+    ASSERT_EQ(SADB_SPI_NOT_FOUND, status);
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: Processes applying security on the same SA at once never use the same IV
+ **/
+UTEST(SA_SHM, CONCURRENT_PROCESSES_RESERVE_UNIQUE_IVS)
+{
+    uint8_t seen[UT_SA_SHM_PROCESSES * UT_SA_SHM_FRAMES] = {0};
+    uint8_t iv[IV_SIZE];
+    SecurityAssociation_t* test_association = NULL;
+    pid_t children[UT_SA_SHM_PROCESSES];
+    int pipe_fds[2];
+    int child_status;
+    uint32_t value;
+    int32_t status;
+    int i;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0, pipe(pipe_fds));
+
+    for (i = 0; i < UT_SA_SHM_PROCESSES; i++)
+    {
+        children[i] = fork();
+        ASSERT_NE(-1, children[i]);
+        if (children[i] == 0)
+        {
+            int frame;
+            close(pipe_fds[0]);
+            Crypto_Shutdown();
+            if (ut_sa_shm_init() != CRYPTO_LIB_SUCCESS)
+            {
+                _exit(1);
+            }
+            for (frame = 0; frame < UT_SA_SHM_FRAMES; frame++)
+            {
+                if ((ut_sa_shm_apply_frame(iv) != CRYPTO_LIB_SUCCESS) || (write(pipe_fds[1], iv, 12) != 12))
+                {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+    }
+    close(pipe_fds[1]);
+
+    for (i = 0; i < UT_SA_SHM_PROCESSES * UT_SA_SHM_FRAMES; i++)
+    {
+        ASSERT_EQ(12, read(pipe_fds[0], iv, 12));
+        value = ut_sa_shm_iv_low_word(iv);
+        ASSERT_LT(value, (uint32_t)(UT_SA_SHM_PROCESSES * UT_SA_SHM_FRAMES));
+        ASSERT_EQ(0, seen[value]);
+        seen[value] = 1;
+    }
+    close(pipe_fds[0]);
+    for (i = 0; i < UT_SA_SHM_PROCESSES; i++)
+    {
+        ASSERT_EQ(children[i], waitpid(children[i], &child_status, 0));
+        ASSERT_TRUE(WIFEXITED(child_status));
+        ASSERT_EQ(0, WEXITSTATUS(child_status));
+    }
+
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ((uint32_t)(UT_SA_SHM_PROCESSES * UT_SA_SHM_FRAMES), ut_sa_shm_iv_low_word(test_association->iv));
+    sa_if->sa_save_sa(test_association);
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: Killing a process while it is applying security does not wedge the others
+ **/
+UTEST(SA_SHM, SURVIVES_KILLED_PROCESS)
+{
+    uint8_t iv_before[IV_SIZE];
+    uint8_t iv_after[IV_SIZE];
+    struct timespec run_time = {0, 20000000};
+    pid_t child;
+    int32_t status;
+    int i;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_sa_shm_apply_frame(iv_before));
+
+    for (i = 0; i < 5; i++)
+    {
+        child = fork();
+        ASSERT_NE(-1, child);
+        if (child == 0)
+        {
+            for (;;)
+            {
+                ut_sa_shm_apply_frame(NULL);
+            }
+        }
+        nanosleep(&run_time, NULL);
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+    }
+
+    // A wedged record mutex would hang here, let the alarm fail the test instead
+    alarm(10);
+    status = ut_sa_shm_apply_frame(iv_after);
+    alarm(0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_GT(memcmp(iv_after, iv_before, 12), 0);
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: An SDLS stop in one process takes the SA off its channel for every process
+ **/
+UTEST(SA_SHM, PROCEDURES_CHANGE_SHARED_STATE)
+{
+    SecurityAssociation_t* test_association = NULL;
+    SaProvisionOp_t op;
+    pid_t child;
+    int child_status;
+    int32_t status;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_sa_shm_apply_frame(NULL));
+
+    child = fork();
+    ASSERT_NE(-1, child);
+    if (child == 0)
+    {
+        Crypto_Shutdown();
+        if (ut_sa_shm_init() != CRYPTO_LIB_SUCCESS)
+        {
+            _exit(1);
+        }
+        sdls_frame.pdu.data[0] = 0x00;
+        sdls_frame.pdu.data[1] = 0x04;
+        _exit((sa_if->sa_stop() == CRYPTO_LIB_SUCCESS) ? 0 : 1);
+    }
+    ASSERT_EQ(child, waitpid(child, &child_status, 0));
+    ASSERT_TRUE(WIFEXITED(child_status));
+    ASSERT_EQ(0, WEXITSTATUS(child_status));
+
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, ut_sa_shm_apply_frame(NULL));
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_EQ(0, test_association->gvcid_blk.vcid);
+    sa_if->sa_save_sa(test_association);
+
+    // Ground commands the SA's state does not allow are refused rather than acknowledged
+    sdls_frame.pdu.data[0] = 0x00;
+    sdls_frame.pdu.data[1] = 0x04;
+    ASSERT_EQ(SADB_SA_WRONG_STATE, sa_if->sa_stop());
+    ASSERT_EQ(SADB_SA_WRONG_STATE, sa_if->sa_delete());
+    sdls_frame.pdu.data[0] = 0x12;
+    sdls_frame.pdu.data[1] = 0x34;
+    ASSERT_EQ(SADB_SPI_NOT_FOUND, sa_if->sa_stop());
+
+    memset(&op, 0, SA_PROVISION_OP_SIZE);
+    op.procedure = SA_START;
+    op.spi = 4;
+    op.gvcid.scid = SCID;
+    op.gvcid.vcid = UT_SA_SHM_VCID;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_provision(&op, 1));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_sa_shm_apply_frame(NULL));
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: Changes other than the counters are saved, unless the SA changed since the copy was taken
+ **/
+UTEST(SA_SHM, SAVES_WRITE_BACK_CHANGES)
+{
+    SecurityAssociation_t* first = NULL;
+    SecurityAssociation_t* second = NULL;
+    int32_t status;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_get_from_spi(4, &first));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_get_from_spi(4, &second));
+    first->ekid = 200;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_save_sa(first));
+    second->ekid = 201;
+    second->iv[11] = 0x20;
+    ASSERT_EQ(SADB_SHM_SA_CHANGED, sa_if->sa_save_sa(second));
+
+    // Another attach sees the first change and the second copy's IV only
+    Crypto_Shutdown();
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_get_from_spi(4, &first));
+    ASSERT_EQ(200, first->ekid);
+    ASSERT_EQ(0x20, first->iv[11]);
+
+    // A saved state change moves the SA off its channel
+    first->sa_state = SA_KEYED;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_save_sa(first));
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA, ut_sa_shm_apply_frame(NULL));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_get_from_spi(4, &first));
+    first->sa_state = SA_OPERATIONAL;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_save_sa(first));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_sa_shm_apply_frame(NULL));
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: The GVCID lookup follows created, started and stopped SAs, lowest record first
+ **/
+UTEST(SA_SHM, GVCID_LOOKUP_FOLLOWS_PROCEDURES)
+{
+    SecurityAssociation_t* test_association = NULL;
+    SecurityAssociation_t created;
+    SaProvisionOp_t op;
+    pid_t child;
+    int child_status;
+    int32_t status;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // SPI 70, a copy of SA 4 operational on VC 5, is added after the default SAs
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_get_from_spi(4, &test_association));
+    created = *test_association;
+    created.gvcid_blk.vcid = 5;
+    memset(&op, 0, SA_PROVISION_OP_SIZE);
+    op.procedure = SA_CREATE;
+    op.spi = 70;
+    op.sa = &created;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_provision(&op, 1));
+    sa_if->sa_save_sa(test_association);
+
+    child = fork();
+    ASSERT_NE(-1, child);
+    if (child == 0)
+    {
+        Crypto_Shutdown();
+        if ((ut_sa_shm_init() != CRYPTO_LIB_SUCCESS) ||
+            (sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 5, 0, &test_association) != CRYPTO_LIB_SUCCESS))
+        {
+            _exit(1);
+        }
+        _exit((test_association->spi == 70) ? 0 : 1);
+    }
+    ASSERT_EQ(child, waitpid(child, &child_status, 0));
+    ASSERT_TRUE(WIFEXITED(child_status));
+    ASSERT_EQ(0, WEXITSTATUS(child_status));
+
+    // Moved onto VC 4 the default SA 4 still comes first, until it is stopped
+    op.procedure = SA_STOP;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_provision(&op, 1));
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_OPERATIONAL_SA,
+              sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 5, 0, &test_association));
+    op.procedure = SA_START;
+    op.gvcid.scid = SCID;
+    op.gvcid.vcid = UT_SA_SHM_VCID;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_provision(&op, 1));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS,
+              sa_if->sa_get_operational_sa_from_gvcid(0, SCID, UT_SA_SHM_VCID, 0, &test_association));
+    ASSERT_EQ(4, test_association->spi);
+    sa_if->sa_save_sa(test_association);
+
+    op.procedure = SA_STOP;
+    op.spi = 4;
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_provision(&op, 1));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS,
+              sa_if->sa_get_operational_sa_from_gvcid(0, SCID, UT_SA_SHM_VCID, 0, &test_association));
+    ASSERT_EQ(70, test_association->spi);
+    sa_if->sa_save_sa(test_association);
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: Killing a process part way through stopping and starting SAs leaves a usable table and index
+ **/
+UTEST(SA_SHM, SURVIVES_KILLED_PROCEDURE)
+{
+    SecurityAssociation_t* test_association = NULL;
+    struct timespec run_time = {0, 20000000};
+    SaProvisionOp_t op;
+    pid_t child;
+    int32_t status;
+    int i;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    status = ut_sa_shm_init();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    memset(&op, 0, SA_PROVISION_OP_SIZE);
+    op.spi = 4;
+    op.gvcid.scid = SCID;
+    op.gvcid.vcid = UT_SA_SHM_VCID;
+
+    for (i = 0; i < 5; i++)
+    {
+        child = fork();
+        ASSERT_NE(-1, child);
+        if (child == 0)
+        {
+            for (;;)
+            {
+                op.procedure = SA_STOP;
+                sa_if->sa_provision(&op, 1);
+                op.procedure = SA_START;
+                sa_if->sa_provision(&op, 1);
+            }
+        }
+        nanosleep(&run_time, NULL);
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+    }
+
+    // A wedged table mutex or index would hang here, let the alarm fail the test instead
+    alarm(10);
+    status = ut_sa_shm_apply_frame(NULL);
+    ASSERT_TRUE((status == CRYPTO_LIB_SUCCESS) || (status == CRYPTO_LIB_ERR_NO_OPERATIONAL_SA));
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    if (test_association->sa_state == SA_KEYED)
+    {
+        op.procedure = SA_START;
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, sa_if->sa_provision(&op, 1));
+    }
+    sa_if->sa_save_sa(test_association);
+    status = ut_sa_shm_apply_frame(NULL);
+    alarm(0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: An object that is not a CryptoLib SA table is refused
+ **/
+UTEST(SA_SHM, REFUSES_INCOMPATIBLE_TABLE)
+{
+    uint8_t garbage[4096];
+    int32_t status;
+    int fd;
+
+    shm_unlink(UT_SA_SHM_NAME);
+    fd = shm_open(UT_SA_SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0600);
+    ASSERT_NE(-1, fd);
+    ASSERT_EQ(0, ftruncate(fd, 1 << 20));
+    memset(garbage, 0xA5, sizeof(garbage));
+    ASSERT_EQ((ssize_t)sizeof(garbage), write(fd, garbage, sizeof(garbage)));
+    close(fd);
+
+    status = ut_sa_shm_init();
+    ASSERT_EQ(SADB_SHM_TABLE_INCOMPATIBLE, status);
+
+    Crypto_Shutdown();
+    shm_unlink(UT_SA_SHM_NAME);
+}
+
+/**
+ * @brief Unit Test: SA_TYPE_SHM requires the shared memory object to be named
+ **/
+UTEST(SA_SHM, NOT_CONFIGURED)
+{
+    int32_t status;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_SHM, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_SHM_CONFIGURATION_NOT_COMPLETE, status);
+
+    Crypto_Shutdown();
+}
+
+UTEST_MAIN();
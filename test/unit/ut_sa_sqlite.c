@@ -0,0 +1,204 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that exercise the SQLite SADB (SA_TYPE_SQLITE). Only built with -DSA_SQLITE=ON.
+ **/
+#include "ut_sa_sqlite.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include <sqlite3.h>
+
+#define UT_SA_SQLITE_PATH "ut_sa_sqlite.db"
+
+static void ut_sa_sqlite_remove(void)
+{
+    remove(UT_SA_SQLITE_PATH);
+    remove(UT_SA_SQLITE_PATH "-wal");
+    remove(UT_SA_SQLITE_PATH "-shm");
+}
+
+static int32_t ut_sa_sqlite_init(uint8_t sqlite_synchronous)
+{
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_SQLITE, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    Crypto_Config_Sa_Sqlite(UT_SA_SQLITE_PATH, sqlite_synchronous);
+    return Crypto_Init();
+}
+
+// Equivalent of in-memory SA 4 (AES-GCM, Key-ID 130) made operational on VC 0
+static int ut_sa_sqlite_insert_sa_4(sqlite3* test_db)
+{
+    char sql[1024];
+    snprintf(sql, sizeof(sql),
+             "INSERT INTO security_associations"
+             " (spi,ekid,sa_state,tfvn,scid,vcid,mapid,est,ast,shivf_len,iv_len,iv,stmacf_len,ecs_len,ecs,abm_len,abm"
+             ",arsn_len,arsnw)"
+             " VALUES (4,'130',%d,0,%d,0,0,1,0,12,12,X'000000000000000000000001',16,1,X'%02X',19"
+             ",X'00000000000000000000000000000000000000',0,5)",
+             SA_OPERATIONAL, SCID, CRYPTO_CIPHER_AES256_GCM);
+    return sqlite3_exec(test_db, sql, NULL, NULL, NULL);
+}
+
+static void ut_sa_sqlite_query_text(sqlite3* test_db, const char* sql, char* result, size_t result_size)
+{
+    sqlite3_stmt* stmt = NULL;
+
+    result[0] = '\0';
+    if (sqlite3_prepare_v2(test_db, sql, -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        snprintf(result, result_size, "%s", (const char*)sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+}
+
+/**
+ * @brief Unit Test: The SADB schema is created on first use and the database runs in WAL mode
+ **/
+UTEST(SA_SQLITE, CREATES_SCHEMA_IN_WAL_MODE)
+{
+    sqlite3* test_db = NULL;
+    char result[64];
+    int32_t status;
+
+    ut_sa_sqlite_remove();
+    status = ut_sa_sqlite_init(SA_SQLITE_SYNC_NORMAL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(UT_SA_SQLITE_PATH, &test_db));
+    ut_sa_sqlite_query_text(test_db, "PRAGMA journal_mode;", result, sizeof(result));
+    ASSERT_STREQ("wal", result);
+    ut_sa_sqlite_query_text(test_db, "SELECT name FROM sqlite_master WHERE name='security_associations';", result,
+                            sizeof(result));
+    ASSERT_STREQ("security_associations", result);
+    sqlite3_close(test_db);
+
+    Crypto_Shutdown();
+    ut_sa_sqlite_remove();
+}
+
+/**
+ * @brief Unit Test: SAs are read by SPI and GVCID, and saved IVs are stored as binary blobs
+ **/
+UTEST(SA_SQLITE, GET_AND_SAVE_SA)
+{
+    SecurityAssociation_t* test_association = NULL;
+    sqlite3* test_db = NULL;
+    char result[64];
+    int32_t status;
+
+    ut_sa_sqlite_remove();
+    status = ut_sa_sqlite_init(SA_SQLITE_SYNC_FULL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(UT_SA_SQLITE_PATH, &test_db));
+    ASSERT_EQ(SQLITE_OK, ut_sa_sqlite_insert_sa_4(test_db));
+
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(4, test_association->spi);
+    ASSERT_EQ(130, test_association->ekid);
+    ASSERT_EQ(SA_OPERATIONAL, test_association->sa_state);
+    ASSERT_EQ(CRYPTO_CIPHER_AES256_GCM, test_association->ecs);
+    ASSERT_EQ(12, test_association->iv_len);
+    ASSERT_EQ(0x01, test_association->iv[11]);
+    ASSERT_EQ(19, test_association->abm_len);
+    ASSERT_EQ(0x00, test_association->abm[18]);
+
+    test_association->iv[0] = 0xAB;
+    test_association->iv[11] = 0xCD;
+    status = sa_if->sa_save_sa(test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ut_sa_sqlite_query_text(test_db, "SELECT typeof(iv) || ':' || hex(iv) FROM security_associations WHERE spi=4;",
+                            result, sizeof(result));
+    ASSERT_STREQ("blob:AB00000000000000000000CD", result);
+
+    status = sa_if->sa_get_operational_sa_from_gvcid(0, SCID, 0, 0, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(4, test_association->spi);
+    ASSERT_EQ(0xAB, test_association->iv[0]);
+    ASSERT_EQ(0xCD, test_association->iv[11]);
+    sa_if->sa_save_sa(test_association);
+
+    status = sa_if->sa_get_from_spi(5, &test_association);
+    ASSERT_EQ(SADB_QUERY_EMPTY_RESULTS, status);
+
+    sqlite3_close(test_db);
+    Crypto_Shutdown();
+    ut_sa_sqlite_remove();
+}
+
+/**
+ * @brief Unit Test: TC ApplySecurity persists the advanced IV to the database
+ **/
+UTEST(SA_SQLITE, TC_APPLY_SAVES_IV)
+{
+    sqlite3* test_db = NULL;
+    char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* ptr_enc_frame = NULL;
+    uint16_t enc_frame_len = 0;
+    char result[64];
+    int32_t status;
+
+    ut_sa_sqlite_remove();
+    status = ut_sa_sqlite_init(SA_SQLITE_SYNC_NORMAL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(UT_SA_SQLITE_PATH, &test_db));
+    ASSERT_EQ(SQLITE_OK, ut_sa_sqlite_insert_sa_4(test_db));
+
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    status = Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &ptr_enc_frame, &enc_frame_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ut_sa_sqlite_query_text(test_db, "SELECT hex(iv) FROM security_associations WHERE spi=4;", result, sizeof(result));
+    ASSERT_STREQ("000000000000000000000002", result);
+
+    free(raw_tc_sdls_ping_b);
+    free(ptr_enc_frame);
+    sqlite3_close(test_db);
+    Crypto_Shutdown();
+    ut_sa_sqlite_remove();
+}
+
+/**
+ * @brief Unit Test: SA_TYPE_SQLITE requires the database to be configured
+ **/
+UTEST(SA_SQLITE, NOT_CONFIGURED)
+{
+    int32_t status;
+
+    Crypto_Config_CryptoLib(KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_SQLITE, CRYPTOGRAPHY_TYPE_LIBGCRYPT,
+                            IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE, TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR,
+                            TC_IGNORE_SA_STATE_FALSE, TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                            TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024, AOS_FHEC_NA,
+                                              AOS_IZ_NA, 0);
+    status = Crypto_Init();
+    ASSERT_EQ(CRYPTO_SQLITE_CONFIGURATION_NOT_COMPLETE, status);
+
+    Crypto_Shutdown();
+}
+
+UTEST_MAIN();
@@ -0,0 +1,181 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that save the runtime state to a snapshot and restart CryptoLib from it.
+ **/
+#include "ut_snapshot.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "key_interface.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define UT_SNAPSHOT_PATH "ut_snapshot.img"
+
+// Moves SA 4 and key 130 away from the unit test defaults, and adds SPI 0x0100 as a copy of SA 4
+static void ut_snapshot_change_state(void)
+{
+    SecurityAssociation_t* test_association = NULL;
+    SecurityAssociation_t new_association;
+    crypto_key_t new_key;
+
+    sa_if->sa_get_from_spi(4, &test_association);
+    test_association->iv[10] = 0x12;
+    test_association->iv[11] = 0x34;
+    new_association = *test_association;
+    new_association.spi = 0x0100;
+    new_association.sa_state = SA_KEYED;
+    new_association.arsn_len = 4;
+    memset(new_association.arsn, 0, ARSN_SIZE);
+    new_association.arsn[3] = 0xFF;
+    sa_if->sa_insert(&new_association);
+
+    new_key = *key_if->get_key(130);
+    memset(new_key.value, 0xC3, KEY_SIZE);
+    Crypto_Key_Publish(130, &new_key);
+}
+
+/**
+ * @brief Unit Test: Loading a snapshot restores the configuration, keys, SAs and counters it was saved with
+ **/
+UTEST(SNAPSHOT, SAVE_AND_LOAD_RESTORES_STATE)
+{
+    SecurityAssociation_t* test_association = NULL;
+    GvcidManagedParameters_t* mp = NULL;
+    char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* ptr_enc_frame = NULL;
+    uint16_t enc_frame_len = 0;
+    int32_t status;
+
+    remove(UT_SNAPSHOT_PATH);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ut_snapshot_change_state();
+    status = Crypto_Snapshot_Save(UT_SNAPSHOT_PATH);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Shutdown();
+
+    status = Crypto_Snapshot_Load(UT_SNAPSHOT_PATH, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_TYPE_INMEMORY, (int)crypto_config.sa_type);
+    ASSERT_EQ(TC_PROCESS_SDLS_PDUS_TRUE, (int)crypto_config.process_sdls_pdus);
+    status = Crypto_Get_Managed_Parameters_For_Gvcid(0, 0x0003, 4, gvcid_managed_parameters, &mp);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(1024, mp->max_frame_size);
+    ASSERT_EQ(TC_HAS_SEGMENT_HDRS, (int)mp->has_segmentation_hdr);
+
+    ASSERT_EQ(0xC3, key_if->get_key(130)->value[0]);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_OPERATIONAL, test_association->sa_state);
+    ASSERT_EQ(0x12, test_association->iv[10]);
+    ASSERT_EQ(0x34, test_association->iv[11]);
+    status = sa_if->sa_get_from_spi(0x0100, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    ASSERT_EQ(0xFF, test_association->arsn[3]);
+
+    // The restored SA is indexed and usable
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    status = Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &ptr_enc_frame, &enc_frame_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    free(raw_tc_sdls_ping_b);
+    free(ptr_enc_frame);
+    Crypto_Shutdown();
+    remove(UT_SNAPSHOT_PATH);
+}
+
+/**
+ * @brief Unit Test: A counter skip moves every IV and ARSN past the frames sent after the snapshot
+ **/
+UTEST(SNAPSHOT, COUNTER_SKIP_ADVANCES_COUNTERS)
+{
+    SecurityAssociation_t* test_association = NULL;
+    int32_t status;
+
+    remove(UT_SNAPSHOT_PATH);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ut_snapshot_change_state();
+    status = Crypto_Snapshot_Save(UT_SNAPSHOT_PATH);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Shutdown();
+
+    status = Crypto_Snapshot_Load(UT_SNAPSHOT_PATH, 0x0201);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = sa_if->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0x14, test_association->iv[10]);
+    ASSERT_EQ(0x35, test_association->iv[11]);
+    status = sa_if->sa_get_from_spi(0x0100, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(0x03, test_association->arsn[2]);
+    ASSERT_EQ(0x00, test_association->arsn[3]);
+
+    Crypto_Shutdown();
+    remove(UT_SNAPSHOT_PATH);
+}
+
+/**
+ * @brief Unit Test: Damaged, truncated and missing snapshots are refused
+ **/
+UTEST(SNAPSHOT, REFUSES_BAD_IMAGES)
+{
+    uint8_t byte;
+    off_t size;
+    int32_t status;
+    int fd;
+
+    remove(UT_SNAPSHOT_PATH);
+    status = Crypto_Snapshot_Save(UT_SNAPSHOT_PATH);
+    ASSERT_EQ(CRYPTO_LIB_ERR_NO_INIT, status);
+    status = Crypto_Init_TC_Unit_Test();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = Crypto_Snapshot_Save(UT_SNAPSHOT_PATH);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Shutdown();
+
+    // One flipped bit in the SA section
+    fd = open(UT_SNAPSHOT_PATH, O_RDWR);
+    ASSERT_NE(-1, fd);
+    size = lseek(fd, 0, SEEK_END);
+    ASSERT_EQ(1, pread(fd, &byte, 1, size - 600));
+    byte ^= 0x01;
+    ASSERT_EQ(1, pwrite(fd, &byte, 1, size - 600));
+    status = Crypto_Snapshot_Load(UT_SNAPSHOT_PATH, 0);
+    ASSERT_EQ(CRYPTO_SNAPSHOT_INVALID, status);
+    ASSERT_EQ(UNITIALIZED, (int)crypto_config.init_status);
+
+    ASSERT_EQ(0, ftruncate(fd, size / 2));
+    close(fd);
+    status = Crypto_Snapshot_Load(UT_SNAPSHOT_PATH, 0);
+    ASSERT_EQ(CRYPTO_SNAPSHOT_INVALID, status);
+
+    remove(UT_SNAPSHOT_PATH);
+    status = Crypto_Snapshot_Load(UT_SNAPSHOT_PATH, 0);
+    ASSERT_EQ(CRYPTO_SNAPSHOT_FILE_ERROR, status);
+}
+
+UTEST_MAIN();
@@ -0,0 +1,184 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that initialize CryptoLib from the tables generated from CRYPTO_STATIC_CONFIG.
+ *  Built only with CRYPTO_STATIC_CONFIG set; the checks hold for any configuration file that has a [config] section
+ *  selecting the in-memory SA backend and internal keys.
+ **/
+#include "ut_static_config.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "crypto_static_tables.h"
+#include "key_interface.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+/**
+ * @brief Unit Test: Crypto_Init_Static_Config brings up the generated configuration without any Crypto_Config calls
+ **/
+UTEST(STATIC_CONFIG, LOADS_GENERATED_TABLES)
+{
+    SecurityAssociation_t* test_association = NULL;
+    GvcidManagedParameters_t* mp = NULL;
+    const SecurityAssociation_t* expected;
+    const GvcidManagedParameters_t* expected_mp;
+    crypto_key_t* key;
+    int32_t status;
+    uint32_t i;
+
+    status = Crypto_Init_Static_Config();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ((int)crypto_static_crypto_config.sa_type, (int)crypto_config.sa_type);
+    ASSERT_TRUE(gvcid_managed_parameters == crypto_static_managed_parameters);
+
+    for (i = 0; i < CRYPTO_STATIC_NUM_GVCIDS; i++)
+    {
+        expected_mp = &crypto_static_managed_parameters[i];
+        status = Crypto_Get_Managed_Parameters_For_Gvcid(expected_mp->tfvn, expected_mp->scid, expected_mp->vcid,
+                                                         gvcid_managed_parameters, &mp);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        ASSERT_EQ(expected_mp->max_frame_size, mp->max_frame_size);
+    }
+
+    for (i = 0; i < CRYPTO_STATIC_NUM_SAS; i++)
+    {
+        expected = &crypto_static_sas[i];
+        status = sa_if->sa_get_from_spi(expected->spi, &test_association);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        ASSERT_EQ(expected->spi, test_association->spi);
+        ASSERT_EQ((int)expected->sa_state, (int)test_association->sa_state);
+        ASSERT_EQ(expected->ekid, test_association->ekid);
+        ASSERT_EQ(expected->abm_len, test_association->abm_len);
+        ASSERT_EQ(0, memcmp(expected->abm, test_association->abm, ABM_SIZE));
+        if (expected->sa_state != SA_OPERATIONAL)
+        {
+            continue;
+        }
+        // The precomputed index finds the first operational SA on the GVCID, which is this one or a lower SPI
+        status = sa_if->sa_get_operational_sa_from_gvcid(expected->gvcid_blk.tfvn, expected->gvcid_blk.scid,
+                                                         expected->gvcid_blk.vcid, expected->gvcid_blk.mapid,
+                                                         &test_association);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        ASSERT_EQ(SA_OPERATIONAL, test_association->sa_state);
+        ASSERT_EQ(expected->gvcid_blk.vcid, test_association->gvcid_blk.vcid);
+        ASSERT_LE(test_association->spi, expected->spi);
+    }
+
+    for (i = 0; i < CRYPTO_STATIC_NUM_KEYS; i++)
+    {
+        key = key_if->get_key(crypto_static_keys[i].key_id);
+        ASSERT_TRUE(key != NULL);
+        ASSERT_EQ(crypto_static_keys[i].key.key_len, key->key_len);
+        ASSERT_EQ(crypto_static_keys[i].key.key_state, key->key_state);
+        ASSERT_EQ(0, memcmp(crypto_static_keys[i].key.value, key->value, key->key_len));
+    }
+
+    Crypto_Shutdown();
+}
+
+/**
+ * @brief Unit Test: SAs and managed parameters added at runtime move the tables off the generated ones, and
+ * re-initializing starts again from the generated tables
+ **/
+UTEST(STATIC_CONFIG, CHANGES_LEAVE_GENERATED_TABLES_INTACT)
+{
+    SecurityAssociation_t* test_association = NULL;
+    SecurityAssociation_t new_association;
+    GvcidManagedParameters_t* mp = NULL;
+    const SecurityAssociation_t* operational = NULL;
+    uint16_t new_spi = crypto_static_sas[CRYPTO_STATIC_NUM_SAS - 1].spi + 1;
+    uint32_t num_new = (CRYPTO_STATIC_NUM_SA_CHUNKS * CRYPTO_STATIC_SA_TABLE_CHUNK_SIZE) - CRYPTO_STATIC_NUM_SAS + 1;
+    int32_t status;
+    uint32_t i;
+
+    status = Crypto_Init_Static_Config();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    for (i = 0; (i < CRYPTO_STATIC_NUM_SAS) && (operational == NULL); i++)
+    {
+        if (crypto_static_sas[i].sa_state == SA_OPERATIONAL)
+        {
+            operational = &crypto_static_sas[i];
+        }
+    }
+
+    // Grow past the static slots, new SPIs go through copies of the SPI map page and the chunk array
+    for (i = 0; i < num_new; i++)
+    {
+        new_association = crypto_static_sas[0];
+        new_association.spi = (uint16_t)(new_spi + i);
+        new_association.sa_state = SA_KEYED;
+        status = sa_if->sa_insert(&new_association);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    }
+    for (i = 0; i < num_new; i++)
+    {
+        status = sa_if->sa_get_from_spi((uint16_t)(new_spi + i), &test_association);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        ASSERT_EQ(SA_KEYED, test_association->sa_state);
+    }
+    status = sa_if->sa_get_from_spi(crypto_static_sas[0].spi, &test_association);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    // Taking an SA out of service unlinks it from the generated index
+    if (operational != NULL)
+    {
+        new_association = *operational;
+        new_association.sa_state = SA_KEYED;
+        memset(new_association.iv, 0xA5, IV_SIZE);
+        status = sa_if->sa_insert(&new_association);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        status = sa_if->sa_get_operational_sa_from_gvcid(operational->gvcid_blk.tfvn, operational->gvcid_blk.scid,
+                                                         operational->gvcid_blk.vcid, operational->gvcid_blk.mapid,
+                                                         &test_association);
+        if (status == CRYPTO_LIB_SUCCESS)
+        {
+            ASSERT_NE(operational->spi, test_association->spi);
+        }
+    }
+
+    status = Crypto_Config_Add_Gvcid_Managed_Parameter(0, 0x0042, 7, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 512,
+                                                       AOS_FHEC_NA, AOS_IZ_NA, 0);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_TRUE(gvcid_managed_parameters != crypto_static_managed_parameters);
+    status = Crypto_Get_Managed_Parameters_For_Gvcid(0, 0x0042, 7, gvcid_managed_parameters, &mp);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    ASSERT_EQ(512, mp->max_frame_size);
+    status = Crypto_Get_Managed_Parameters_For_Gvcid(crypto_static_managed_parameters[0].tfvn,
+                                                     crypto_static_managed_parameters[0].scid,
+                                                     crypto_static_managed_parameters[0].vcid,
+                                                     gvcid_managed_parameters, &mp);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    Crypto_Shutdown();
+
+    // Back to the generated tables as they were built
+    status = Crypto_Init_Static_Config();
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    status = sa_if->sa_get_from_spi(new_spi, &test_association);
+    ASSERT_NE(CRYPTO_LIB_SUCCESS, status);
+    if (operational != NULL)
+    {
+        status = sa_if->sa_get_from_spi(operational->spi, &test_association);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        ASSERT_EQ(SA_OPERATIONAL, test_association->sa_state);
+        ASSERT_EQ(0, memcmp(operational->iv, test_association->iv, IV_SIZE));
+    }
+    Crypto_Shutdown();
+}
+
+UTEST_MAIN();
@@ -1173,4 +1173,130 @@ UTEST(TC_APPLY_SECURITY, PLAINTEXT_W_ARSN)
     ASSERT_EQ(CRYPTO_LIB_SUCCESS, return_val);
 }
 
+// Makes SA 4 the operational encrypting SA of VCID 0, as in HAPPY_PATH_ENC
+static void ut_tc_apply_batch_setup(void)
+{
+    SecurityAssociation_t* test_association;
+
+    Crypto_Init_TC_Unit_Test();
+    sa_if->sa_get_from_spi(1, &test_association);
+    test_association->sa_state = SA_NONE;
+    sa_if->sa_get_from_spi(4, &test_association);
+    test_association->gvcid_blk.vcid = 0;
+    test_association->sa_state = SA_OPERATIONAL;
+    test_association->ast = 0;
+    test_association->arsn_len = 0;
+}
+
+/**
+ * @brief Unit Test: A batch gives every frame the result applying it on its own would, and reports the first failure
+ **/
+UTEST(TC_APPLY_SECURITY, BATCH_MATCHES_SINGLE_FRAMES)
+{
+    char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t short_frame[4] = {0x20, 0x03, 0x00, 0x15};
+    uint8_t* expected[2] = {NULL, NULL};
+    uint16_t expected_len[2] = {0, 0};
+    TcBatchFrame_t frames[3];
+    int32_t status;
+    int i;
+
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    ut_tc_apply_batch_setup();
+    for (i = 0; i < 2; i++)
+    {
+        status = Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &expected[i],
+                                         &expected_len[i]);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+    }
+    Crypto_Shutdown();
+
+    ut_tc_apply_batch_setup();
+    frames[0].in_frame = (uint8_t*)raw_tc_sdls_ping_b;
+    frames[0].in_frame_length = raw_tc_sdls_ping_len;
+    frames[1].in_frame = short_frame;
+    frames[1].in_frame_length = sizeof(short_frame);
+    frames[2] = frames[0];
+    status = Crypto_TC_ApplySecurity_Batch(frames, 3);
+    Crypto_Shutdown();
+
+    ASSERT_EQ(CRYPTO_LIB_ERR_INPUT_FRAME_TOO_SHORT_FOR_TC_STANDARD, status);
+    ASSERT_EQ(CRYPTO_LIB_ERR_INPUT_FRAME_TOO_SHORT_FOR_TC_STANDARD, frames[1].status);
+    ASSERT_TRUE(frames[1].enc_frame == NULL);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, frames[0].status);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, frames[2].status);
+    ASSERT_EQ(expected_len[0], frames[0].enc_frame_length);
+    ASSERT_EQ(expected_len[1], frames[2].enc_frame_length);
+    ASSERT_EQ(0, memcmp(expected[0], frames[0].enc_frame, expected_len[0]));
+    ASSERT_EQ(0, memcmp(expected[1], frames[2].enc_frame, expected_len[1]));
+
+    free(raw_tc_sdls_ping_b);
+    free(expected[0]);
+    free(expected[1]);
+    free(frames[0].enc_frame);
+    free(frames[2].enc_frame);
+}
+
+/**
+ * @brief Unit Test: Frames after a key is published, or written in place, do not reuse the old key schedule
+ **/
+UTEST(TC_APPLY_SECURITY, KEY_CHANGES_REACH_CACHED_KEY_SCHEDULES)
+{
+    char* raw_tc_sdls_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    SecurityAssociation_t* test_association;
+    crypto_key_t old_key;
+    crypto_key_t new_key;
+    uint8_t iv[IV_SIZE];
+    uint8_t* enc_frame[4] = {NULL, NULL, NULL, NULL};
+    uint16_t enc_frame_len[4] = {0, 0, 0, 0};
+    uint32_t generation;
+    int32_t status;
+    int i;
+
+    hex_conversion(raw_tc_sdls_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    ut_tc_apply_batch_setup();
+    sa_if->sa_get_from_spi(4, &test_association);
+    memcpy(iv, test_association->iv, IV_SIZE);
+    old_key = *key_if->get_key(130);
+    generation = Crypto_Key_Generation(130);
+
+    // The same key and IV twice, then a published key, then the old key written back in place
+    for (i = 0; i < 4; i++)
+    {
+        if (i == 2)
+        {
+            new_key = old_key;
+            memset(new_key.value, 0x3C, KEY_SIZE);
+            status = Crypto_Key_Publish(130, &new_key);
+            ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+            ASSERT_EQ(generation + 1, Crypto_Key_Generation(130));
+        }
+        if (i == 3)
+        {
+            memcpy(key_if->get_key(130)->value, old_key.value, KEY_SIZE);
+        }
+        sa_if->sa_get_from_spi(4, &test_association);
+        memcpy(test_association->iv, iv, IV_SIZE);
+        status = Crypto_TC_ApplySecurity((uint8_t*)raw_tc_sdls_ping_b, raw_tc_sdls_ping_len, &enc_frame[i],
+                                         &enc_frame_len[i]);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+        ASSERT_EQ(enc_frame_len[0], enc_frame_len[i]);
+    }
+    Crypto_Shutdown();
+
+    ASSERT_EQ(0, memcmp(enc_frame[0], enc_frame[1], enc_frame_len[0]));
+    ASSERT_NE(0, memcmp(enc_frame[0], enc_frame[2], enc_frame_len[0]));
+    ASSERT_EQ(0, memcmp(enc_frame[0], enc_frame[3], enc_frame_len[0]));
+
+    free(raw_tc_sdls_ping_b);
+    for (i = 0; i < 4; i++)
+    {
+        free(enc_frame[i]);
+    }
+}
+
 UTEST_MAIN();
@@ -0,0 +1,736 @@
+/* Copyright (C) 2009 - 2022 National Aeronautics and Space Administration.
+   All Foreign Rights are Reserved to the U.S. Government.
+
+   This software is provided "as is" without any warranty of any kind, either expressed, implied, or statutory,
+   including, but not limited to, any warranty that the software will conform to specifications, any implied warranties
+   of merchantability, fitness for a particular purpose, and freedom from infringement, and any warranty that the
+   documentation will conform to the program, or any warranty that the software will be error free.
+
+   In no event shall NASA be liable for any damages, including, but not limited to direct, indirect, special or
+   consequential damages, arising out of, resulting from, or in any way connected with the software or its
+   documentation, whether or not based upon warranty, contract, tort or otherwise, and whether or not loss was sustained
+   from, or arose out of the results of, or use of, the software, documentation or services provided hereunder.
+
+   ITC Team
+   NASA IV&V
+   jstar-development-team@mail.nasa.gov
+*/
+
+/**
+ *  Unit Tests that run TC frames on one thread per core, each thread with its own context and thread safety set.
+ **/
+#include "ut_thread_safety.h"
+#include "crypto.h"
+#include "crypto_error.h"
+#include "sa_interface.h"
+#include "utest.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define UT_THREAD_SAFETY_MAX_THREADS 32
+#define UT_THREAD_SAFETY_IV_OFFSET 8 // Primary header, segment header and SPI come before the IV
+#define UT_THREAD_SAFETY_IV_LEN 12
+#define UT_THREAD_SAFETY_SPI_BASE 100
+#define UT_THREAD_SAFETY_CHURN_SPI_BASE 40 // Below the SAs frames run on, so a churned SA sits ahead of them in a chain
+#define UT_THREAD_SAFETY_NUM_CHURN 48      // Enough SAs to grow the operational SA index past its first size
+#define UT_THREAD_SAFETY_SDLS_SPI_BASE 60  // Clear mode SAs SDLS PDUs are sent on, one per thread
+#define UT_THREAD_SAFETY_SDLS_FRAME_LEN 27
+
+typedef struct
+{
+    CryptoContext_t* ctx;
+    pthread_barrier_t* start;
+    uint8_t frame[22];
+    uint32_t num_frames;
+    uint8_t* ivs; // IV of each frame applied, NULL to not keep them
+    int32_t status;
+} ut_thread_safety_worker_t;
+
+typedef struct
+{
+    CryptoContext_t* ctx;
+    uint8_t stop; // Set once the frames are done
+    int32_t status;
+} ut_thread_safety_churn_t;
+
+typedef struct
+{
+    CryptoContext_t* ctx;
+    pthread_barrier_t* start;
+    uint8_t vcid;        // Channel of the clear mode SA UT_THREAD_SAFETY_SDLS_SPI_BASE + vcid - 1 the PDUs are sent on
+    uint16_t target_spi; // SA started directly and stopped by SDLS PDU, over and over
+    uint32_t num_rounds;
+    int32_t status;
+} ut_thread_safety_sdls_t;
+
+static char* ut_thread_safety_ping_h = "20030015000080d2c70008197f0b00310000b1fe3128";
+
+/**
+ * @brief Function: ut_thread_safety_num_threads
+ * @return uint32: One thread per online core, at least two
+ **/
+static uint32_t ut_thread_safety_num_threads(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cores < 2)
+    {
+        return 2;
+    }
+    return (cores > UT_THREAD_SAFETY_MAX_THREADS) ? UT_THREAD_SAFETY_MAX_THREADS : (uint32_t)cores;
+}
+
+/**
+ * @brief Function: ut_thread_safety_init
+ * The TC unit test configuration with thread safety set and a managed parameter for every VCID the tests use
+ * @param ctx: CryptoContext_t*
+ * @return int32: Success/Failure
+ **/
+static int32_t ut_thread_safety_init(CryptoContext_t* ctx)
+{
+    int32_t status;
+    uint8_t vcid;
+
+    status = Crypto_Config_CryptoLib_Ctx(ctx, KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_INMEMORY,
+                                         CRYPTOGRAPHY_TYPE_LIBGCRYPT, IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE,
+                                         TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR, TC_IGNORE_SA_STATE_FALSE,
+                                         TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                                         TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE);
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = Crypto_Config_Thread_Safety_Ctx(ctx, CRYPTO_THREAD_SAFE_TRUE);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = Crypto_Config_Sa_Capacity_Ctx(ctx, 128);
+    }
+    for (vcid = 0; (vcid <= UT_THREAD_SAFETY_MAX_THREADS) && (status == CRYPTO_LIB_SUCCESS); vcid++)
+    {
+        status = Crypto_Config_Add_Gvcid_Managed_Parameter_Ctx(ctx, 0, 0x0003, vcid, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS,
+                                                               1024, AOS_FHEC_NA, AOS_IZ_NA, 0);
+    }
+    if (status == CRYPTO_LIB_SUCCESS)
+    {
+        status = Crypto_Init_Ctx(ctx);
+    }
+    return status;
+}
+
+/**
+ * @brief Function: ut_thread_safety_setup
+ * Brings up one context per thread on the shared backends, and puts SA 4 into service on VCID 0 and a copy of it,
+ * SPI UT_THREAD_SAFETY_SPI_BASE + n, on VCID n + 1 for each thread
+ * @param ctx: CryptoContext_t**, num_threads of them
+ * @param num_threads: uint32
+ * @return int32: Success/Failure
+ **/
+static int32_t ut_thread_safety_setup(CryptoContext_t** ctx, uint32_t num_threads)
+{
+    SecurityAssociation_t* test_association;
+    SecurityAssociation_t copy;
+    CryptoContext_t* prev_ctx;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    uint32_t i;
+
+    for (i = 0; i < num_threads; i++)
+    {
+        ctx[i] = Crypto_Context_Create();
+        if ((ctx[i] == NULL) || (status != CRYPTO_LIB_SUCCESS))
+        {
+            status = CRYPTO_LIB_ERROR;
+            continue;
+        }
+        status = ut_thread_safety_init(ctx[i]);
+    }
+    if (status != CRYPTO_LIB_SUCCESS)
+    {
+        return status;
+    }
+
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    (*ctx[0]->sa_if)->sa_get_from_spi(1, &test_association);
+    test_association->sa_state = SA_NONE;
+    (*ctx[0]->sa_if)->sa_get_from_spi(4, &test_association);
+    test_association->gvcid_blk.vcid = 0;
+    test_association->sa_state = SA_OPERATIONAL;
+    test_association->ast = 0;
+    test_association->arsn_len = 0;
+    copy = *test_association;
+    for (i = 0; (i < num_threads) && (status == CRYPTO_LIB_SUCCESS); i++)
+    {
+        copy.spi = (uint16_t)(UT_THREAD_SAFETY_SPI_BASE + i);
+        copy.gvcid_blk.vcid = (uint16_t)(i + 1);
+        status = (*ctx[0]->sa_if)->sa_insert(&copy);
+    }
+    Crypto_Context_Exit(prev_ctx);
+    return status;
+}
+
+/**
+ * @brief Function: ut_thread_safety_teardown
+ * @param ctx: CryptoContext_t**
+ * @param num_threads: uint32
+ **/
+static void ut_thread_safety_teardown(CryptoContext_t** ctx, uint32_t num_threads)
+{
+    uint32_t i;
+
+    // Contexts joined the backends after ctx[0], let go of them first
+    for (i = num_threads; i > 0; i--)
+    {
+        if (ctx[i - 1] != NULL)
+        {
+            Crypto_Context_Free(ctx[i - 1]);
+        }
+    }
+}
+
+/**
+ * @brief Function: ut_thread_safety_worker
+ * Applies its frame num_frames times under its own context
+ * @param arg: ut_thread_safety_worker_t*
+ * @return void*: NULL
+ **/
+static void* ut_thread_safety_worker(void* arg)
+{
+    ut_thread_safety_worker_t* worker = (ut_thread_safety_worker_t*)arg;
+    uint8_t* enc_frame = NULL;
+    uint16_t enc_frame_len = 0;
+    uint32_t i;
+
+    Crypto_Context_Enter(worker->ctx);
+    worker->status = CRYPTO_LIB_SUCCESS;
+    pthread_barrier_wait(worker->start);
+    for (i = 0; (i < worker->num_frames) && (worker->status == CRYPTO_LIB_SUCCESS); i++)
+    {
+        worker->status = Crypto_TC_ApplySecurity(worker->frame, sizeof(worker->frame), &enc_frame, &enc_frame_len);
+        if ((worker->status == CRYPTO_LIB_SUCCESS) && (worker->ivs != NULL))
+        {
+            memcpy(&worker->ivs[i * UT_THREAD_SAFETY_IV_LEN], enc_frame + UT_THREAD_SAFETY_IV_OFFSET,
+                   UT_THREAD_SAFETY_IV_LEN);
+        }
+        free(enc_frame);
+        enc_frame = NULL;
+    }
+    Crypto_Context_Exit(NULL);
+    return NULL;
+}
+
+/**
+ * @brief Function: ut_thread_safety_run
+ * Runs one worker per thread to completion
+ * @param workers: ut_thread_safety_worker_t*
+ * @param num_threads: uint32
+ * @return double: Seconds from the start barrier to the last thread finishing
+ **/
+static double ut_thread_safety_run(ut_thread_safety_worker_t* workers, uint32_t num_threads)
+{
+    pthread_t threads[UT_THREAD_SAFETY_MAX_THREADS];
+    pthread_barrier_t start;
+    struct timespec begin;
+    struct timespec end;
+    uint32_t i;
+
+    pthread_barrier_init(&start, NULL, num_threads + 1);
+    for (i = 0; i < num_threads; i++)
+    {
+        workers[i].start = &start;
+        pthread_create(&threads[i], NULL, ut_thread_safety_worker, &workers[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    pthread_barrier_wait(&start);
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_barrier_destroy(&start);
+    return (double)(end.tv_sec - begin.tv_sec) + ((double)(end.tv_nsec - begin.tv_nsec) / 1e9);
+}
+
+/**
+ * @brief Function: ut_thread_safety_churn
+ * Creates UT_THREAD_SAFETY_NUM_CHURN keyed SAs, then keeps starting and stopping them on channels no frame uses until
+ * told to stop
+ * @param arg: ut_thread_safety_churn_t*
+ * @return void*: NULL
+ **/
+static void* ut_thread_safety_churn(void* arg)
+{
+    ut_thread_safety_churn_t* churn = (ut_thread_safety_churn_t*)arg;
+    SaInterface sa_interface = *churn->ctx->sa_if;
+    SecurityAssociation_t* test_association;
+    SecurityAssociation_t copy;
+    SaProvisionOp_t op;
+    uint32_t round;
+    uint32_t k;
+
+    Crypto_Context_Enter(churn->ctx);
+    churn->status = sa_interface->sa_get_from_spi(4, &test_association);
+    copy = *test_association;
+    copy.sa_state = SA_KEYED;
+    for (k = 0; (k < UT_THREAD_SAFETY_NUM_CHURN) && (churn->status == CRYPTO_LIB_SUCCESS); k++)
+    {
+        copy.spi = (uint16_t)(UT_THREAD_SAFETY_CHURN_SPI_BASE + k);
+        churn->status = sa_interface->sa_insert(&copy);
+    }
+    memset(&op, 0, sizeof(op));
+    for (round = 0; (churn->status == CRYPTO_LIB_SUCCESS) && !__atomic_load_n(&churn->stop, __ATOMIC_ACQUIRE);
+         round++)
+    {
+        k = round % UT_THREAD_SAFETY_NUM_CHURN;
+        op.spi = (uint16_t)(UT_THREAD_SAFETY_CHURN_SPI_BASE + k);
+        op.procedure = SA_START;
+        op.gvcid.scid = (uint16_t)(0x100 + k);
+        op.gvcid.vcid = (uint16_t)(round % 64);
+        churn->status = sa_interface->sa_provision(&op, 1);
+        if (churn->status == CRYPTO_LIB_SUCCESS)
+        {
+            op.procedure = SA_STOP;
+            churn->status = sa_interface->sa_provision(&op, 1);
+        }
+    }
+    Crypto_Context_Exit(NULL);
+    return NULL;
+}
+
+/**
+ * @brief Function: ut_thread_safety_abm_worker
+ * Keeps pointing an SA of its own at one of a few bit masks, all of them shared with the other threads through the
+ * ABM pool, then lets go of it
+ * @param arg: ut_thread_safety_worker_t*, num_frames is the number of masks set
+ * @return void*: NULL
+ **/
+static void* ut_thread_safety_abm_worker(void* arg)
+{
+    ut_thread_safety_worker_t* worker = (ut_thread_safety_worker_t*)arg;
+    SecurityAssociation_t sa;
+    uint32_t i;
+
+    memset(&sa, 0, sizeof(sa));
+    worker->status = CRYPTO_LIB_SUCCESS;
+    pthread_barrier_wait(worker->start);
+    for (i = 0; (i < worker->num_frames) && (worker->status == CRYPTO_LIB_SUCCESS); i++)
+    {
+        worker->status = Crypto_SA_Fill_ABM(&sa, (uint8_t)(0xA0 + (i % 4)), 16);
+        if ((worker->status == CRYPTO_LIB_SUCCESS) && (sa.abm[15] != (uint8_t)(0xA0 + (i % 4))))
+        {
+            worker->status = CRYPTO_LIB_ERROR;
+        }
+    }
+    if (worker->status == CRYPTO_LIB_SUCCESS)
+    {
+        worker->status = Crypto_SA_Release_ABM(&sa);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Function: ut_thread_safety_sdls_frame
+ * Builds a TC frame with an SA Stop PDU for target_spi, on the clear mode SA on vcid
+ * @param frame: uint8_t*, UT_THREAD_SAFETY_SDLS_FRAME_LEN bytes
+ * @param vcid: uint8
+ * @param arsn: uint16, one more than the last frame on the SA
+ * @param target_spi: uint16
+ **/
+static void ut_thread_safety_sdls_frame(uint8_t* frame, uint8_t vcid, uint16_t arsn, uint16_t target_spi)
+{
+    // Primary header, segment header, SPI and ARSN, then the packet with its PUS header and the PDU's TLV
+    const uint8_t pdu[] = {0x18, 0x80, 0xd2, 0xc9, 0x00, 0x02, 0x19, 0x7f, 0x0b, 0x00, 0x1e, 0x00, 0x10};
+    uint16_t carrier_spi = (uint16_t)(UT_THREAD_SAFETY_SDLS_SPI_BASE + vcid - 1);
+    uint16_t fecf;
+
+    frame[0] = 0x20;
+    frame[1] = 0x03;
+    frame[2] = (uint8_t)(vcid << 2);
+    frame[3] = UT_THREAD_SAFETY_SDLS_FRAME_LEN - 1;
+    frame[4] = 0x00;
+    frame[5] = 0xFF;
+    frame[6] = (uint8_t)(carrier_spi >> 8);
+    frame[7] = (uint8_t)carrier_spi;
+    frame[8] = (uint8_t)(arsn >> 8);
+    frame[9] = (uint8_t)arsn;
+    memcpy(&frame[10], pdu, sizeof(pdu));
+    frame[23] = (uint8_t)(target_spi >> 8);
+    frame[24] = (uint8_t)target_spi;
+    fecf = Crypto_Calc_FECF(frame, UT_THREAD_SAFETY_SDLS_FRAME_LEN - 2);
+    frame[25] = (uint8_t)(fecf >> 8);
+    frame[26] = (uint8_t)fecf;
+}
+
+/**
+ * @brief Function: ut_thread_safety_sdls_worker
+ * Starts its target SA, then stops it again with an SDLS PDU through TC ProcessSecurity, num_rounds times
+ * @param arg: ut_thread_safety_sdls_t*
+ * @return void*: NULL
+ **/
+static void* ut_thread_safety_sdls_worker(void* arg)
+{
+    ut_thread_safety_sdls_t* worker = (ut_thread_safety_sdls_t*)arg;
+    SaInterface sa_interface = *worker->ctx->sa_if;
+    SecurityAssociation_t* test_association;
+    uint8_t frame[UT_THREAD_SAFETY_SDLS_FRAME_LEN];
+    TC_t* tc_sdls_processed_frame = (TC_t*)calloc(1, sizeof(TC_t));
+    SaProvisionOp_t op;
+    int frame_len;
+    uint32_t round;
+
+    Crypto_Context_Enter(worker->ctx);
+    worker->status = (tc_sdls_processed_frame != NULL) ? CRYPTO_LIB_SUCCESS : CRYPTO_LIB_ERROR;
+    memset(&op, 0, sizeof(op));
+    op.spi = worker->target_spi;
+    op.procedure = SA_START;
+    op.gvcid.scid = (uint16_t)(0x100 + worker->vcid);
+    pthread_barrier_wait(worker->start);
+    for (round = 0; (round < worker->num_rounds) && (worker->status == CRYPTO_LIB_SUCCESS); round++)
+    {
+        worker->status = sa_interface->sa_provision(&op, 1);
+        if (worker->status != CRYPTO_LIB_SUCCESS)
+        {
+            break;
+        }
+        ut_thread_safety_sdls_frame(frame, worker->vcid, (uint16_t)(round + 1), worker->target_spi);
+        frame_len = sizeof(frame);
+        worker->status = Crypto_TC_ProcessSecurity(frame, &frame_len, tc_sdls_processed_frame);
+        if (worker->status != CRYPTO_LIB_SUCCESS)
+        {
+            break;
+        }
+        sa_interface->sa_get_from_spi(worker->target_spi, &test_association);
+        if (test_association->sa_state != SA_KEYED)
+        {
+            worker->status = CRYPTO_LIB_ERROR;
+        }
+    }
+    free(tc_sdls_processed_frame);
+    Crypto_Context_Exit(NULL);
+    return NULL;
+}
+
+static int ut_thread_safety_iv_compare(const void* a, const void* b)
+{
+    return memcmp(a, b, UT_THREAD_SAFETY_IV_LEN);
+}
+
+/**
+ * @brief Unit Test: Frames racing on one SA each take their own IV, and the SA ends up advanced once per frame
+ **/
+UTEST(THREAD_SAFETY, FRAMES_ON_ONE_SA_NEVER_SHARE_AN_IV)
+{
+    CryptoContext_t* ctx[UT_THREAD_SAFETY_MAX_THREADS] = {NULL};
+    ut_thread_safety_worker_t workers[UT_THREAD_SAFETY_MAX_THREADS];
+    uint32_t num_threads = ut_thread_safety_num_threads();
+    uint32_t frames_per_thread = 500;
+    uint32_t total = num_threads * frames_per_thread;
+    uint8_t expected_iv[UT_THREAD_SAFETY_IV_LEN];
+    SecurityAssociation_t* test_association;
+    CryptoContext_t* prev_ctx;
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint8_t* ivs;
+    uint32_t i;
+
+    hex_conversion(ut_thread_safety_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    ASSERT_EQ((int)sizeof(workers[0].frame), raw_tc_sdls_ping_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_thread_safety_setup(ctx, num_threads));
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    (*ctx[0]->sa_if)->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(UT_THREAD_SAFETY_IV_LEN, test_association->iv_len);
+    memcpy(expected_iv, test_association->iv, UT_THREAD_SAFETY_IV_LEN);
+    Crypto_Context_Exit(prev_ctx);
+
+    ivs = (uint8_t*)malloc(total * UT_THREAD_SAFETY_IV_LEN);
+    ASSERT_TRUE(ivs != NULL);
+    for (i = 0; i < num_threads; i++)
+    {
+        workers[i].ctx = ctx[i];
+        memcpy(workers[i].frame, raw_tc_sdls_ping_b, sizeof(workers[i].frame));
+        workers[i].num_frames = frames_per_thread;
+        workers[i].ivs = &ivs[i * frames_per_thread * UT_THREAD_SAFETY_IV_LEN];
+    }
+    ut_thread_safety_run(workers, num_threads);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, workers[i].status);
+    }
+    qsort(ivs, total, UT_THREAD_SAFETY_IV_LEN, ut_thread_safety_iv_compare);
+    // The frames used every IV from the SA's starting one on, each once
+    ASSERT_EQ(0, memcmp(expected_iv, ivs, UT_THREAD_SAFETY_IV_LEN));
+    for (i = 1; i < total; i++)
+    {
+        Crypto_increment(expected_iv, UT_THREAD_SAFETY_IV_LEN);
+        ASSERT_EQ(0, memcmp(expected_iv, &ivs[i * UT_THREAD_SAFETY_IV_LEN], UT_THREAD_SAFETY_IV_LEN));
+    }
+    Crypto_increment(expected_iv, UT_THREAD_SAFETY_IV_LEN);
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    (*ctx[0]->sa_if)->sa_get_from_spi(4, &test_association);
+    ASSERT_EQ(0, memcmp(expected_iv, test_association->iv, UT_THREAD_SAFETY_IV_LEN));
+    Crypto_Context_Exit(prev_ctx);
+
+    free(ivs);
+    free(raw_tc_sdls_ping_b);
+    ut_thread_safety_teardown(ctx, num_threads);
+}
+
+/**
+ * @brief Unit Test: Frames on separate SAs run side by side, each advancing only its own SA. TC frames per second on
+ * one thread and on one thread per core are printed for reference only; nothing is asserted about them.
+ **/
+UTEST(THREAD_SAFETY, FRAMES_ON_SEPARATE_SAS_ADVANCE_ONLY_THEIR_OWN_SA)
+{
+    CryptoContext_t* ctx[UT_THREAD_SAFETY_MAX_THREADS] = {NULL};
+    ut_thread_safety_worker_t workers[UT_THREAD_SAFETY_MAX_THREADS];
+    uint32_t num_threads = ut_thread_safety_num_threads();
+    uint32_t frames_per_thread = 4000;
+    uint8_t start_iv[UT_THREAD_SAFETY_IV_LEN];
+    SecurityAssociation_t* test_association;
+    CryptoContext_t* prev_ctx;
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    double single_seconds;
+    double parallel_seconds;
+    uint32_t i;
+
+    hex_conversion(ut_thread_safety_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_thread_safety_setup(ctx, num_threads));
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    (*ctx[0]->sa_if)->sa_get_from_spi(UT_THREAD_SAFETY_SPI_BASE, &test_association);
+    memcpy(start_iv, test_association->iv, UT_THREAD_SAFETY_IV_LEN);
+    Crypto_Context_Exit(prev_ctx);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        workers[i].ctx = ctx[i];
+        memcpy(workers[i].frame, raw_tc_sdls_ping_b, sizeof(workers[i].frame));
+        workers[i].frame[2] = (uint8_t)((i + 1) << 2); // VCID i + 1, SPI UT_THREAD_SAFETY_SPI_BASE + i
+        workers[i].num_frames = frames_per_thread;
+        workers[i].ivs = NULL;
+    }
+    single_seconds = ut_thread_safety_run(workers, 1);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, workers[0].status);
+    parallel_seconds = ut_thread_safety_run(workers, num_threads);
+    printf("TC ApplySecurity, %u frames per thread: 1 thread %.0f frames/s, %u threads %.0f frames/s\n",
+           frames_per_thread, frames_per_thread / single_seconds, num_threads,
+           (num_threads * frames_per_thread) / parallel_seconds);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, workers[i].status);
+    }
+    // Each SA was advanced by its own thread's frames only, the first one ran both rounds
+    for (i = 0; i < frames_per_thread; i++)
+    {
+        Crypto_increment(start_iv, UT_THREAD_SAFETY_IV_LEN);
+    }
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    (*ctx[0]->sa_if)->sa_get_from_spi((uint16_t)(UT_THREAD_SAFETY_SPI_BASE + num_threads - 1), &test_association);
+    ASSERT_EQ(0, memcmp(start_iv, test_association->iv, UT_THREAD_SAFETY_IV_LEN));
+    for (i = 0; i < frames_per_thread; i++)
+    {
+        Crypto_increment(start_iv, UT_THREAD_SAFETY_IV_LEN);
+    }
+    (*ctx[0]->sa_if)->sa_get_from_spi(UT_THREAD_SAFETY_SPI_BASE, &test_association);
+    ASSERT_EQ(0, memcmp(start_iv, test_association->iv, UT_THREAD_SAFETY_IV_LEN));
+    Crypto_Context_Exit(prev_ctx);
+
+    free(raw_tc_sdls_ping_b);
+    ut_thread_safety_teardown(ctx, num_threads);
+}
+
+/**
+ * @brief Unit Test: Frames keep finding their SAs while another thread creates SAs, growing the operational SA index,
+ * and starts and stops them
+ **/
+UTEST(THREAD_SAFETY, LOOKUPS_RACE_INDEX_CHANGES)
+{
+    CryptoContext_t* ctx[UT_THREAD_SAFETY_MAX_THREADS + 1] = {NULL};
+    ut_thread_safety_worker_t workers[UT_THREAD_SAFETY_MAX_THREADS];
+    ut_thread_safety_churn_t churn;
+    pthread_t churn_thread;
+    uint32_t num_threads = ut_thread_safety_num_threads();
+    uint32_t frames_per_thread = 2000;
+    uint8_t start_iv[UT_THREAD_SAFETY_IV_LEN];
+    uint8_t expected_iv[UT_THREAD_SAFETY_IV_LEN];
+    SecurityAssociation_t* test_association;
+    CryptoContext_t* prev_ctx;
+    char* raw_tc_sdls_ping_b = NULL;
+    int raw_tc_sdls_ping_len = 0;
+    uint32_t i;
+
+    hex_conversion(ut_thread_safety_ping_h, &raw_tc_sdls_ping_b, &raw_tc_sdls_ping_len);
+    // One more context for the thread that changes the index
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_thread_safety_setup(ctx, num_threads + 1));
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    (*ctx[0]->sa_if)->sa_get_from_spi(UT_THREAD_SAFETY_SPI_BASE, &test_association);
+    memcpy(start_iv, test_association->iv, UT_THREAD_SAFETY_IV_LEN);
+    Crypto_Context_Exit(prev_ctx);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        workers[i].ctx = ctx[i];
+        memcpy(workers[i].frame, raw_tc_sdls_ping_b, sizeof(workers[i].frame));
+        workers[i].frame[2] = (uint8_t)((i + 1) << 2); // VCID i + 1, SPI UT_THREAD_SAFETY_SPI_BASE + i
+        workers[i].num_frames = frames_per_thread;
+        workers[i].ivs = NULL;
+    }
+    churn.ctx = ctx[num_threads];
+    churn.stop = 0;
+    churn.status = CRYPTO_LIB_SUCCESS;
+    ASSERT_EQ(0, pthread_create(&churn_thread, NULL, ut_thread_safety_churn, &churn));
+    ut_thread_safety_run(workers, num_threads);
+    __atomic_store_n(&churn.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(churn_thread, NULL);
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, churn.status);
+    for (i = 0; i < num_threads; i++)
+    {
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, workers[i].status);
+    }
+    // Every frame was applied with its own thread's SA
+    memcpy(expected_iv, start_iv, UT_THREAD_SAFETY_IV_LEN);
+    for (i = 0; i < frames_per_thread; i++)
+    {
+        Crypto_increment(expected_iv, UT_THREAD_SAFETY_IV_LEN);
+    }
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    for (i = 0; i < num_threads; i++)
+    {
+        (*ctx[0]->sa_if)->sa_get_from_spi((uint16_t)(UT_THREAD_SAFETY_SPI_BASE + i), &test_association);
+        ASSERT_EQ(0, memcmp(expected_iv, test_association->iv, UT_THREAD_SAFETY_IV_LEN));
+    }
+    Crypto_Context_Exit(prev_ctx);
+
+    free(raw_tc_sdls_ping_b);
+    ut_thread_safety_teardown(ctx, num_threads + 1);
+}
+
+/**
+ * @brief Unit Test: SDLS PDUs processed on several threads at once each run their SA procedure, none waits forever
+ * on another thread's frame while that one waits on it
+ **/
+UTEST(THREAD_SAFETY, SDLS_PDUS_FROM_SEVERAL_THREADS)
+{
+    CryptoContext_t* ctx[UT_THREAD_SAFETY_MAX_THREADS] = {NULL};
+    ut_thread_safety_sdls_t workers[UT_THREAD_SAFETY_MAX_THREADS];
+    pthread_t threads[UT_THREAD_SAFETY_MAX_THREADS];
+    pthread_barrier_t start;
+    uint32_t num_threads = ut_thread_safety_num_threads();
+    SecurityAssociation_t* test_association;
+    SecurityAssociation_t carrier;
+    SecurityAssociation_t target;
+    CryptoContext_t* prev_ctx;
+    int32_t status = CRYPTO_LIB_SUCCESS;
+    uint32_t i;
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_thread_safety_setup(ctx, num_threads));
+    prev_ctx = Crypto_Context_Enter(ctx[0]);
+    (*ctx[0]->sa_if)->sa_get_from_spi(1, &test_association);
+    carrier = *test_association;
+    carrier.sa_state = SA_OPERATIONAL;
+    (*ctx[0]->sa_if)->sa_get_from_spi(4, &test_association);
+    target = *test_association;
+    target.sa_state = SA_KEYED;
+    for (i = 0; (i < num_threads) && (status == CRYPTO_LIB_SUCCESS); i++)
+    {
+        // Below SPI UT_THREAD_SAFETY_SPI_BASE + i, so it is the SA found for frames on the thread's channel
+        carrier.spi = (uint16_t)(UT_THREAD_SAFETY_SDLS_SPI_BASE + i);
+        carrier.gvcid_blk.vcid = (uint16_t)(i + 1);
+        status = (*ctx[0]->sa_if)->sa_insert(&carrier);
+        if (status == CRYPTO_LIB_SUCCESS)
+        {
+            target.spi = (uint16_t)(UT_THREAD_SAFETY_CHURN_SPI_BASE + i);
+            status = (*ctx[0]->sa_if)->sa_insert(&target);
+        }
+    }
+    Crypto_Context_Exit(prev_ctx);
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, status);
+
+    pthread_barrier_init(&start, NULL, num_threads);
+    for (i = 0; i < num_threads; i++)
+    {
+        workers[i].ctx = ctx[i];
+        workers[i].start = &start;
+        workers[i].vcid = (uint8_t)(i + 1);
+        workers[i].target_spi = (uint16_t)(UT_THREAD_SAFETY_CHURN_SPI_BASE + i);
+        workers[i].num_rounds = 200;
+        workers[i].status = CRYPTO_LIB_ERROR;
+        pthread_create(&threads[i], NULL, ut_thread_safety_sdls_worker, &workers[i]);
+    }
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&start);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, workers[i].status);
+    }
+    ut_thread_safety_teardown(ctx, num_threads);
+}
+
+/**
+ * @brief Unit Test: Threads sharing bit masks through the ABM pool leave it as they found it
+ **/
+UTEST(THREAD_SAFETY, ABM_POOL_SHARED_ACROSS_THREADS)
+{
+    CryptoContext_t* ctx[UT_THREAD_SAFETY_MAX_THREADS] = {NULL};
+    ut_thread_safety_worker_t workers[UT_THREAD_SAFETY_MAX_THREADS];
+    pthread_t threads[UT_THREAD_SAFETY_MAX_THREADS];
+    pthread_barrier_t start;
+    uint32_t num_threads = ut_thread_safety_num_threads();
+    AbmPoolStats_t before;
+    AbmPoolStats_t after;
+    uint32_t i;
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, ut_thread_safety_setup(ctx, 1));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_ABM_Pool_Stats(&before));
+
+    pthread_barrier_init(&start, NULL, num_threads);
+    for (i = 0; i < num_threads; i++)
+    {
+        workers[i].start = &start;
+        workers[i].num_frames = 5000;
+        pthread_create(&threads[i], NULL, ut_thread_safety_abm_worker, &workers[i]);
+    }
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+        ASSERT_EQ(CRYPTO_LIB_SUCCESS, workers[i].status);
+    }
+    pthread_barrier_destroy(&start);
+
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Get_ABM_Pool_Stats(&after));
+    ASSERT_EQ(before.num_entries, after.num_entries);
+    ASSERT_EQ(before.num_refs, after.num_refs);
+    ut_thread_safety_teardown(ctx, 1);
+}
+
+/**
+ * @brief Unit Test: Thread safety is refused with backends that cannot run frames from several threads
+ **/
+UTEST(THREAD_SAFETY, UNSUPPORTED_BACKENDS_ARE_REFUSED)
+{
+    CryptoContext_t* ctx = Crypto_Context_Create();
+
+    ASSERT_TRUE(ctx != NULL);
+    ASSERT_EQ(CRYPTO_CONFIGURATION_NOT_COMPLETE, Crypto_Config_Thread_Safety_Ctx(ctx, CRYPTO_THREAD_SAFE_TRUE));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS,
+              Crypto_Config_CryptoLib_Ctx(ctx, KEY_TYPE_INTERNAL, MC_TYPE_INTERNAL, SA_TYPE_MARIADB,
+                                          CRYPTOGRAPHY_TYPE_LIBGCRYPT, IV_INTERNAL, CRYPTO_TC_CREATE_FECF_TRUE,
+                                          TC_PROCESS_SDLS_PDUS_TRUE, TC_HAS_PUS_HDR, TC_IGNORE_SA_STATE_FALSE,
+                                          TC_IGNORE_ANTI_REPLAY_FALSE, TC_UNIQUE_SA_PER_MAP_ID_FALSE,
+                                          TC_CHECK_FECF_TRUE, 0x3F, SA_INCREMENT_NONTRANSMITTED_IV_TRUE));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS, Crypto_Config_Thread_Safety_Ctx(ctx, CRYPTO_THREAD_SAFE_TRUE));
+    ASSERT_EQ(CRYPTO_LIB_SUCCESS,
+              Crypto_Config_Add_Gvcid_Managed_Parameter_Ctx(ctx, 0, 0x0003, 0, TC_HAS_FECF, TC_HAS_SEGMENT_HDRS, 1024,
+                                                            AOS_FHEC_NA, AOS_IZ_NA, 0));
+    ASSERT_EQ(CRYPTO_THREAD_SAFETY_NOT_SUPPORTED, Crypto_Init_Ctx(ctx));
+    ASSERT_EQ(CRYPTO_FALSE, Crypto_Context_Backends_In_Use());
+    Crypto_Context_Free(ctx);
+}
+
+UTEST_MAIN();
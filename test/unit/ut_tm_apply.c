@@ -341,7 +341,7 @@ UTEST(TM_APPLY_SECURITY, SECONDARY_HDR_PRESENT_MAC)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -419,7 +419,7 @@ UTEST(TM_APPLY_SECURITY, AES_CMAC_256_TEST_0)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
     sa_ptr->acs = CRYPTO_MAC_CMAC_AES256;
@@ -511,7 +511,7 @@ UTEST(TM_APPLY_SECURITY, AES_CMAC_256_TEST_1)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
     sa_ptr->acs = CRYPTO_MAC_CMAC_AES256;
@@ -599,7 +599,7 @@ UTEST(TM_APPLY_ENC_VAL, AES_HMAC_SHA_256_TEST_0)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
     sa_ptr->acs = CRYPTO_MAC_HMAC_SHA256;
@@ -685,7 +685,7 @@ UTEST(TM_APPLY_ENC_VAL, AES_HMAC_SHA_256_TEST_1)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -773,7 +773,7 @@ UTEST(TM_APPLY_ENC_VAL, AES_HMAC_SHA_512_TEST_0)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -870,7 +870,7 @@ UTEST(TM_APPLY_ENC_VAL, AES_HMAC_SHA_512_TEST_1)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -951,7 +951,7 @@ UTEST(TM_APPLY_ENC_VAL, AES_GCM_BITMASK_1)
     sa_ptr->gvcid_blk.scid = 44;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs_len = 1;
     sa_ptr->ecs = CRYPTO_CIPHER_AES256_GCM;
@@ -1044,7 +1044,7 @@ UTEST(TM_APPLY_ENC_VAL, AEAD_AES_GCM_BITMASK_1)
     sa_ptr->gvcid_blk.scid = 44;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ast =1;
     sa_ptr->ecs_len = 1;
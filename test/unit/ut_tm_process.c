@@ -264,7 +264,7 @@ UTEST(TM_PROCESS_SECURITY, SECONDARY_HDR_PRESENT_MAC)
     sa_ptr->iv_len = 0;
     sa_ptr->shsnf_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -340,7 +340,7 @@ UTEST(TM_PROCESS_SECURITY, AES_CMAC_256_TEST_0)
     sa_ptr->iv_len = 0;
     sa_ptr->shsnf_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -435,7 +435,7 @@ UTEST(TM_PROCESS_SECURITY, AES_CMAC_256_TEST_1)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -528,7 +528,7 @@ UTEST(TM_PROCESS_ENC_VAL, AES_HMAC_SHA_256_TEST_0)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -621,7 +621,7 @@ UTEST(TM_PROCESS_ENC_VAL, AES_HMAC_SHA_256_TEST_1)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -715,7 +715,7 @@ UTEST(TM_PROCESS_ENC_VAL, AES_HMAC_SHA_512_TEST_0)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0x00, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0x00, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -813,7 +813,7 @@ UTEST(TM_PROCESS_ENC_VAL, AES_HMAC_SHA_512_TEST_1)
     sa_ptr->shsnf_len = 0;
     sa_ptr->arsn_len = 0;
     sa_ptr->abm_len = 1786;
-    memset(sa_ptr->abm, 0xFF, (sa_ptr->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(sa_ptr, 0xFF, sa_ptr->abm_len); // Bitmask
     sa_ptr->stmacf_len = 16;
     sa_ptr->sa_state = SA_OPERATIONAL;
     sa_ptr->ecs = CRYPTO_CIPHER_NONE;
@@ -914,7 +914,7 @@ UTEST(TM_PROCESS_ENC_VAL, AES_GCM_BITMASK_1)
     sa_if->sa_get_from_spi(9, &test_association);
     test_association->arsn_len = 0;
     test_association->abm_len = 1786;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ecs_len = 1;
     test_association->ecs = CRYPTO_CIPHER_AES256_GCM;
@@ -1017,7 +1017,7 @@ UTEST(TM_PROCESS_ENC_VAL, AEAD_AES_GCM_BITMASK_1)
     sa_if->sa_get_from_spi(9, &test_association);
     test_association->arsn_len = 0;
     test_association->abm_len = 1786;
-    memset(test_association->abm, 0xFF, (test_association->abm_len * sizeof(uint8_t))); // Bitmask
+    Crypto_SA_Fill_ABM(test_association, 0xFF, test_association->abm_len); // Bitmask
     test_association->sa_state = SA_OPERATIONAL;
     test_association->ast = 1;
     test_association->est = 1;